@@ -164,6 +164,7 @@ public:
     int _creatingTree;
     mutable QMutex renderQueueMutex;
     std::list<RenderQueueItem> renderQueue, activeRenders;
+    bool blockingRenderFailed; //< protected by renderQueueMutex
     mutable QMutex invalidExprKnobsMutex;
     std::list<KnobIWPtr> invalidExprKnobs;
 
@@ -184,6 +185,7 @@ public:
         , renderQueueMutex()
         , renderQueue()
         , activeRenders()
+        , blockingRenderFailed(false)
         , invalidExprKnobsMutex()
         , invalidExprKnobs()
         , projectBeingLoaded()
@@ -605,6 +607,21 @@ AppInstance::loadInternal(const CLArgs& cl,
 
 
         if ( info.suffix() == QString::fromUtf8(NATRON_PROJECT_FILE_EXT) ) {
+            ///When rendering given Write nodes, a binary project only needs to load them and what they depend on.
+            ///A script passed with --onload may access any node, in which case the whole project is loaded.
+            const std::list<CLArgs::WriterArg>& writerArgs = cl.getWriterArgs();
+            if ( !writerArgs.empty() && cl.getDefaultOnProjectLoadedScript().isEmpty() ) {
+                std::list<std::string> nodesToLoad;
+                for (std::list<CLArgs::WriterArg>::const_iterator it = writerArgs.begin(); it != writerArgs.end(); ++it) {
+                    nodesToLoad.push_back( it->name.toStdString() );
+                }
+                const std::list<CLArgs::ReaderArg>& readerArgs = cl.getReaderArgs();
+                for (std::list<CLArgs::ReaderArg>::const_iterator it = readerArgs.begin(); it != readerArgs.end(); ++it) {
+                    nodesToLoad.push_back( it->name.toStdString() );
+                }
+                _imp->_currentProject->setNodesToLoadOnNextLoad(nodesToLoad);
+            }
+
             ///Load the project
             if ( !_imp->_currentProject->loadProject( info.path(), info.fileName() ) ) {
                 throw std::invalid_argument( tr("Project file loading failed.").toStdString() );
@@ -1776,13 +1793,18 @@ AppInstance::startWritersRendering(bool doBlockingRender,
         RenderQueueItem item;
         item.work = *it;
         if ( !_imp->validateRenderOptions(item.work, &item.work.firstFrame, &item.work.lastFrame, &item.work.frameStep) ) {
-            continue;;
+            if (appPTR->isBackground() || doBlockingRender) {
+                QMutexLocker k(&_imp->renderQueueMutex);
+                _imp->blockingRenderFailed = true;
+            }
+            continue;
         }
         _imp->getSequenceNameFromWriter(it->writer, &item.sequenceName);
         item.savePath = savePath;
 
         if (renderInSeparateProcess) {
-            item.process = boost::make_shared<ProcessHandler>(savePath, item.work.writer);
+            item.process = boost::make_shared<ProcessHandler>(savePath, item.work.writer, item.work.firstFrame, item.work.lastFrame, item.work.frameStep,
+                                                              appPTR->getCurrentSettings()->getNumberOfRenderProcesses());
             QObject::connect( item.process.get(), SIGNAL(processFinished(int)), this, SLOT(onBackgroundRenderProcessFinished()) );
         } else {
             QObject::connect(item.work.writer->getRenderEngine().get(), SIGNAL(renderFinished(int)), this, SLOT(onQueuedRenderFinished(int)), Qt::UniqueConnection);
@@ -1899,7 +1921,12 @@ AppInstancePrivate::startRenderingFullSequence(bool blocking,
 {
     if (blocking) {
         BlockingBackgroundRender backgroundRender(w.work.writer);
-        backgroundRender.blockingRender(w.work.useRenderStats, w.work.firstFrame, w.work.lastFrame, w.work.frameStep); //< doesn't return before rendering is finished
+        // blockingRender() doesn't return before rendering is finished
+        if ( !backgroundRender.blockingRender(w.work.useRenderStats, w.work.firstFrame, w.work.lastFrame, w.work.frameStep) ) {
+            QMutexLocker k(&renderQueueMutex);
+            blockingRenderFailed = true;
+        }
+
         return;
     }
 
@@ -1917,6 +1944,14 @@ AppInstancePrivate::startRenderingFullSequence(bool blocking,
     }
 }
 
+bool
+AppInstance::hasBlockingRenderFailed() const
+{
+    QMutexLocker k(&_imp->renderQueueMutex);
+
+    return _imp->blockingRenderFailed;
+}
+
 void
 AppInstance::onQueuedRenderFinished(int /*retCode*/)
 {
@@ -303,6 +303,12 @@ public:
                                         const std::list<std::pair<int, std::pair<int, int> > >& frameRanges);
     void startWritersRendering(bool doBlockingRender, const std::list<RenderWork>& writers);
 
+    /**
+     * @brief Returns true if a blocking render (e.g: the renders of a background instance) was aborted,
+     * or could not start because of invalid render options.
+     **/
+    bool hasBlockingRenderFailed() const;
+
 public:
 
     void addInvalidExpressionKnob(const KnobIPtr& knob);
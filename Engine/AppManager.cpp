@@ -52,6 +52,7 @@
 #include <stdexcept>
 #include <cstring> // for std::memcpy
 #include <sstream> // stringstream
+#include <iostream> // cin, cout
 #include <locale>
 
 #include <QtCore/QtGlobal> // for Q_OS_*
@@ -126,6 +127,7 @@
 #include "Engine/Project.h"
 #include "Engine/PrecompNode.h"
 #include "Engine/ReadNode.h"
+#include "Engine/RenderWorker.h"
 #include "Engine/RotoPaint.h"
 #include "Engine/RotoSmear.h"
 #include "Engine/StandardPaths.h"
@@ -395,6 +397,12 @@ AppManager::getMaxThreadCount()
     return QThreadPool::globalInstance()->maxThreadCount();
 }
 
+TaskScheduler*
+AppManager::getTaskScheduler() const
+{
+    return _imp->taskScheduler.get();
+}
+
 AppManager::AppManager()
     : QObject()
     , _imp( new AppManagerPrivate() )
@@ -506,6 +514,9 @@ AppManager::loadFromArgs(const CLArgs& cl)
     QThreadPool::globalInstance()->setExpiryTimeout(-1); //< make threads never exit on their own
     //otherwise it might crash with thread-local storage
 
+    // Same number of threads as the global thread pool, updated by the Settings
+    _imp->taskScheduler.reset( new TaskScheduler( QThreadPool::globalInstance()->maxThreadCount() ) );
+
 
     ///the QCoreApplication must have been created so far.
     assert(qApp);
@@ -590,6 +601,9 @@ AppManager::~AppManager()
     ///Caches may have launched some threads to delete images, wait for them to be done
     QThreadPool::globalInstance()->waitForDone();
 
+    ///All renders are done, quit the task scheduler threads
+    _imp->taskScheduler.reset();
+
     ///Kill caches now because decreaseNCacheFilesOpened can be called
     _imp->_nodeCache->waitForDeleterThread();
     _imp->_diskCache->waitForDeleterThread();
@@ -1067,10 +1081,12 @@ AppManager::loadInternalAfterInitGui(const CLArgs& cl)
         size_t maxCacheRAM = _imp->_settings->getRamMaximumPercent() * getSystemTotalRAM();
         U64 viewerCacheSize = _imp->_settings->getMaximumViewerDiskCacheSize();
         U64 maxDiskCacheNode = _imp->_settings->getMaximumDiskCacheNodeSize();
+        unsigned int nCacheShards = _imp->_settings->getCacheShardsCount();
 
-        _imp->_nodeCache = boost::make_shared<Cache<Image> >("NodeCache", NATRON_CACHE_VERSION, maxCacheRAM, 1.);
-        _imp->_diskCache = boost::make_shared<Cache<Image> >("DiskCache", NATRON_CACHE_VERSION, maxDiskCacheNode, 0.);
-        _imp->_viewerCache = boost::make_shared<Cache<FrameEntry> >("ViewerCache", NATRON_CACHE_VERSION, viewerCacheSize, 0.);
+        _imp->_nodeCache = boost::make_shared<Cache<Image> >("NodeCache", NATRON_CACHE_VERSION, maxCacheRAM, 1., nCacheShards);
+        _imp->_diskCache = boost::make_shared<Cache<Image> >("DiskCache", NATRON_CACHE_VERSION, maxDiskCacheNode, 0., nCacheShards);
+        _imp->_viewerCache = boost::make_shared<Cache<FrameEntry> >("ViewerCache", NATRON_CACHE_VERSION, viewerCacheSize, 0., nCacheShards);
+        setApplicationsCachesEvictionPolicy( _imp->_settings->getCacheEvictionPolicy() );
         _imp->setViewerCacheTileSize();
     } catch (std::logic_error&) {
         // ignore
@@ -1142,6 +1158,10 @@ AppManager::loadInternalAfterInitGui(const CLArgs& cl)
         args = cl;
     }
 
+    if ( isBackground() && cl.isWorkerMode() ) {
+        return runRenderWorker(args);
+    }
+
     AppInstancePtr mainInstance = newAppInstance(args, false);
 
     hideSplashScreen();
@@ -1183,6 +1203,36 @@ AppManager::loadInternalAfterInitGui(const CLArgs& cl)
     }
 } // AppManager::loadInternalAfterInitGui
 
+bool
+AppManager::runRenderWorker(const CLArgs& cl)
+{
+    // The main instance stays empty for the lifetime of the worker, each job gets its own instance
+    AppInstancePtr mainInstance = newAppInstance(cl, true);
+
+    hideSplashScreen();
+
+    if (!mainInstance) {
+        qApp->quit();
+
+        return false;
+    }
+    onLoadCompleted();
+
+    // Jobs load a project and render it, as a background auto-run process does
+    _imp->_appType = eAppTypeBackgroundAutoRun;
+
+    RenderWorker worker(std::cin, std::cout);
+    int nFailedJobs = worker.run();
+
+    try {
+        mainInstance->quitNow();
+    } catch (std::logic_error&) {
+        // ignore
+    }
+
+    return nFailedJobs == 0;
+}
+
 void
 AppManager::onViewerTileCacheSizeChanged()
 {
@@ -1242,14 +1292,14 @@ AppManager::newAppInstanceInternal(const CLArgs& cl,
         instance->load(cl, makeEmptyInstance);
     } catch (const std::exception & e) {
         Dialogs::errorDialog( NATRON_APPLICATION_NAME, e.what(), false );
-        removeInstance(_imp->_availableID);
+        removeInstance( instance->getAppID() );
         instance.reset();
         --_imp->_availableID;
 
         return instance;
     } catch (...) {
         Dialogs::errorDialog( NATRON_APPLICATION_NAME, tr("Cannot load project").toStdString(), false );
-        removeInstance(_imp->_availableID);
+        removeInstance( instance->getAppID() );
         instance.reset();
         --_imp->_availableID;
 
@@ -1507,6 +1557,14 @@ AppManager::setApplicationsCachesMaximumDiskSpace(unsigned long long size)
     _imp->_diskCache->setMaximumCacheSize(size);
 }
 
+void
+AppManager::setApplicationsCachesEvictionPolicy(CacheEvictionPolicyEnum policy)
+{
+    // The viewer cache is filled in playback order, it always evicts in LRU order
+    _imp->_nodeCache->setEvictionPolicy(policy);
+    _imp->_diskCache->setEvictionPolicy(policy);
+}
+
 void
 AppManager::loadAllPlugins()
 {
@@ -228,6 +228,8 @@ public:
 
     void setApplicationsCachesMaximumDiskSpace(unsigned long long size);
 
+    void setApplicationsCachesEvictionPolicy(CacheEvictionPolicyEnum policy);
+
     void removeFromNodeCache(const ImagePtr & image);
     void removeFromViewerCache(const FrameEntryPtr & texture);
 
@@ -362,6 +364,12 @@ public:
     int getHardwareIdealThreadCount();
     int getMaxThreadCount(); //!<  actual number of threads in the thread pool (depends on application settings)
 
+    /**
+     * @brief Returns the work-stealing scheduler used to render tiles and pre-render inputs in parallel.
+     * This is NULL until the application is loaded.
+     **/
+    TaskScheduler* getTaskScheduler() const;
+
 
     /**
      * @brief Toggle on/off multi-threading globally in Natron
@@ -670,6 +678,12 @@ protected:
 
     bool loadInternalAfterInitGui(const CLArgs& cl);
 
+    /**
+     * @brief Runs the jobs read from the standard input until its end (see RenderWorker), then quits.
+     * @returns False if the worker could not start or if any job failed.
+     **/
+    bool runRenderWorker(const CLArgs& cl);
+
 private:
 
     void findAllScriptsRecursive(const QDir& directory,
@@ -114,6 +114,7 @@ AppManagerPrivate::AppManagerPrivate()
     , nThreadsPerEffect(0)
     , useThreadPool(true)
     , nThreadsMutex()
+    , taskScheduler()
     , runningThreadsCount()
     , lastProjectLoadedCreatedDuringRC2Or3(false)
     , commandLineArgsUtf8()
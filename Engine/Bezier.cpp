@@ -39,6 +39,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 // /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
 #include <boost/bind.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
 #include <boost/math/special_functions/fpclassify.hpp>
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
@@ -48,6 +49,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/BezierCP.h"
 #include "Engine/FeatherPoint.h"
 #include "Engine/Interpolation.h"
+#include "Engine/ParallelRenderArgs.h"
 #include "Engine/TimeLine.h"
 #include "Engine/Image.h"
 #include "Engine/ImageParams.h"
@@ -82,11 +84,6 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 //This will enable correct evaluation of beziers
 //#define ROTO_USE_MESH_PATTERN_ONLY
 
-// The number of pressure levels is 256 on an old Wacom Graphire 4, and 512 on an entry-level Wacom Bamboo
-// 512 should be OK, see:
-// http://www.davidrevoy.com/article182/calibrating-wacom-stylus-pressure-on-krita
-#define ROTO_PRESSURE_LEVELS 512
-
 #ifndef M_PI
 #define M_PI        3.14159265358979323846264338327950288   /* pi             */
 #endif
@@ -946,6 +943,113 @@ bezierSegmenEqual(bool useGuiCurves,
 
 ////////////////////////////////////Bezier////////////////////////////////////
 
+// The maximum number of polygons cached by a Bezier: above that, the cache is cleared
+#define ROTO_BEZIER_POLYGON_CACHE_SIZE 64
+
+static bool
+transformsEqual(const Transform::Matrix3x3& m1,
+                const Transform::Matrix3x3& m2)
+{
+    return m1.a == m2.a && m1.b == m2.b && m1.c == m2.c &&
+           m1.d == m2.d && m1.e == m2.e && m1.f == m2.f &&
+           m1.g == m2.g && m1.h == m2.h && m1.i == m2.i;
+}
+
+/**
+ * @brief Returns the polygon cached for the given key if it was evaluated at the given age of the item
+ * and with the given transform, or NULL.
+ **/
+static BezierPolygonPtr
+getCachedPolygon(BezierPrivate* imp,
+                 const BezierPolygonKey& key,
+                 U64 age,
+                 const Transform::Matrix3x3& transform)
+{
+    QMutexLocker k(&imp->polygonCacheMutex);
+
+    if (age != imp->polygonCacheAge) {
+        if (age > imp->polygonCacheAge) {
+            // The item changed since the polygons were evaluated
+            imp->polygonCache.clear();
+            imp->polygonCacheAge = age;
+        }
+        ++imp->polygonCacheMisses;
+
+        return BezierPolygonPtr();
+    }
+    std::map<BezierPolygonKey, BezierPolygonPtr>::const_iterator found = imp->polygonCache.find(key);
+    // The transform may change without the age of the item, e.g: if it has an expression
+    if ( ( found == imp->polygonCache.end() ) || !transformsEqual(found->second->transform, transform) ) {
+        ++imp->polygonCacheMisses;
+
+        return BezierPolygonPtr();
+    }
+    ++imp->polygonCacheHits;
+
+    return found->second;
+}
+
+static void
+insertCachedPolygon(BezierPrivate* imp,
+                    const BezierPolygonKey& key,
+                    U64 age,
+                    const BezierPolygonPtr& polygon)
+{
+    QMutexLocker k(&imp->polygonCacheMutex);
+
+    if (age != imp->polygonCacheAge) {
+        // The item changed while the polygon was evaluated
+        return;
+    }
+    if (imp->polygonCache.size() >= ROTO_BEZIER_POLYGON_CACHE_SIZE) {
+        imp->polygonCache.clear();
+    }
+    imp->polygonCache[key] = polygon;
+}
+
+/**
+ * @brief Appends the given polygon to either points or pointsSingleList and unites bbox with its bounding box.
+ **/
+static void
+appendPolygon(const BezierPolygon& polygon,
+              std::list<std::list<ParametricPoint> >* points,
+              std::list<ParametricPoint >* pointsSingleList,
+              RectD* bbox)
+{
+    if (points) {
+        points->insert( points->end(), polygon.points.begin(), polygon.points.end() );
+    } else {
+        assert(pointsSingleList);
+        for (std::list<std::list<ParametricPoint> >::const_iterator it = polygon.points.begin(); it != polygon.points.end(); ++it) {
+            pointsSingleList->insert( pointsSingleList->end(), it->begin(), it->end() );
+        }
+    }
+    if ( bbox && !polygon.points.empty() ) {
+        bbox->x1 = std::min(bbox->x1, polygon.bbox.x1);
+        bbox->x2 = std::max(bbox->x2, polygon.bbox.x2);
+        bbox->y1 = std::min(bbox->y1, polygon.bbox.y1);
+        bbox->y2 = std::max(bbox->y2, polygon.bbox.y2);
+    }
+}
+
+/**
+ * @brief Reports a hit or a miss of the polygon cache to the stats of the render of the item, if any.
+ **/
+static void
+reportPolygonCacheAccess(const Bezier* bezier,
+                         bool isCacheMiss)
+{
+    NodePtr effectNode = bezier->getEffectNode();
+
+    if (!effectNode) {
+        return;
+    }
+    ParallelRenderArgsPtr frameArgs = effectNode->getEffectInstance()->getParallelRenderArgsTLS();
+    if ( frameArgs && frameArgs->stats && frameArgs->stats->isInDepthProfilingEnabled() ) {
+        frameArgs->stats->addRotoPolygonCacheInfosForNode(effectNode, isCacheMiss);
+    }
+}
+
 namespace  {
 enum SplineChangedReason
 {
@@ -1039,6 +1143,7 @@ Bezier::clearAllPoints()
     _imp->featherPoints.clear();
     _imp->isClockwiseOriented.clear();
     _imp->finished = false;
+    incrementAge();
 }
 
 void
@@ -2588,6 +2693,16 @@ Bezier::deCastelJau(bool isOpenBezier,
     } // for()
 }
 
+void
+Bezier::getPolygonCacheAccessInfos(int* nbCacheMisses,
+                                   int* nbCacheHits) const
+{
+    QMutexLocker k(&_imp->polygonCacheMutex);
+
+    *nbCacheMisses = _imp->polygonCacheMisses;
+    *nbCacheHits = _imp->polygonCacheHits;
+}
+
 void
 Bezier::evaluateAtTime_DeCasteljau(bool useGuiPoints,
                                    double time,
@@ -2644,17 +2759,42 @@ Bezier::evaluateAtTime_DeCasteljau_internal(bool useGuiCurves,
                                             RectD* bbox) const
 {
     assert((points && !pointsSingleList) || (!points && pointsSingleList));
-    Transform::Matrix3x3 transform;
 
+    BezierPolygonKey key;
+    key.isFeather = false;
+    key.useGuiCurves = useGuiCurves;
+    key.evaluateIfEqual = true;
+    key.mipmapLevel = mipMapLevel;
+    key.time = time;
+#ifdef ROTO_BEZIER_EVAL_ITERATIVE
+    key.precision = nbPointsPerSegment;
+#else
+    key.precision = errorScale;
+#endif
+    U64 age = getAge();
+    Transform::Matrix3x3 transform;
     getTransformAtTime(time, &transform);
-    QMutexLocker l(&itemMutex);
-    deCastelJau(isOpenBezier(), useGuiCurves, _imp->points, time, mipMapLevel, _imp->finished,
+    BezierPolygonPtr polygon = getCachedPolygon(_imp.get(), key, age, transform);
+    reportPolygonCacheAccess(this, !polygon);
+
+    if (!polygon) {
+        boost::shared_ptr<BezierPolygon> evaluated = boost::make_shared<BezierPolygon>();
+        evaluated->bbox.setupInfinity();
+        evaluated->transform = transform;
+        {
+            QMutexLocker l(&itemMutex);
+            deCastelJau(isOpenBezier(), useGuiCurves, _imp->points, time, mipMapLevel, _imp->finished,
 #ifdef ROTO_BEZIER_EVAL_ITERATIVE
-                nbPointsPerSegment,
+                        nbPointsPerSegment,
 #else
-                errorScale,
+                        errorScale,
 #endif
-                transform, points, pointsSingleList, bbox);
+                        transform, &evaluated->points, 0, &evaluated->bbox);
+        }
+        polygon = evaluated;
+        insertCachedPolygon(_imp.get(), key, age, polygon);
+    }
+    appendPolygon(*polygon, points, pointsSingleList, bbox);
 }
 
 void
@@ -2711,40 +2851,62 @@ Bezier::evaluateFeatherPointsAtTime_DeCasteljau_internal(bool useGuiPoints,
 {
     assert((points && !pointsSingleList) || (!points && pointsSingleList));
     assert( useFeatherPoints() );
-    QMutexLocker l(&itemMutex);
 
+    BezierPolygonKey key;
+    key.isFeather = true;
+    key.useGuiCurves = useGuiPoints;
+    key.evaluateIfEqual = evaluateIfEqual;
+    key.mipmapLevel = mipMapLevel;
+    key.time = time;
+#ifdef ROTO_BEZIER_EVAL_ITERATIVE
+    key.precision = nbPointsPerSegment;
+#else
+    key.precision = errorScale;
+#endif
+    U64 age = getAge();
+    Transform::Matrix3x3 transform;
+    getTransformAtTime(time, &transform);
+    BezierPolygonPtr polygon = getCachedPolygon(_imp.get(), key, age, transform);
+    reportPolygonCacheAccess(this, !polygon);
+
+    if (polygon) {
+        appendPolygon(*polygon, points, pointsSingleList, bbox);
 
-    if ( _imp->points.empty() ) {
         return;
     }
-    BezierCPs::const_iterator itCp = _imp->points.begin();
-    BezierCPs::const_iterator next = _imp->featherPoints.begin();
-    if ( next != _imp->featherPoints.end() ) {
-        ++next;
-    }
-    BezierCPs::const_iterator nextCp = itCp;
-    if ( nextCp != _imp->points.end() ) {
-        ++nextCp;
-    }
 
-    Transform::Matrix3x3 transform;
-    getTransformAtTime(time, &transform);
+    boost::shared_ptr<BezierPolygon> evaluated = boost::make_shared<BezierPolygon>();
+    evaluated->bbox.setupInfinity();
+    evaluated->transform = transform;
 
-    for (BezierCPs::const_iterator it = _imp->featherPoints.begin(); it != _imp->featherPoints.end();
-         ++it) {
-        if ( next == _imp->featherPoints.end() ) {
-            next = _imp->featherPoints.begin();
-        }
-        if ( nextCp == _imp->points.end() ) {
-            if (!_imp->finished) {
-                break;
-            }
-            nextCp = _imp->points.begin();
+    {
+        QMutexLocker l(&itemMutex);
+
+        // If there are no points, the loop below does nothing and an empty polygon is cached
+        BezierCPs::const_iterator itCp = _imp->points.begin();
+        BezierCPs::const_iterator next = _imp->featherPoints.begin();
+        if ( next != _imp->featherPoints.end() ) {
+            ++next;
         }
-        if ( !evaluateIfEqual && bezierSegmenEqual(useGuiPoints, time, ViewIdx(0), **itCp, **nextCp, **it, **next) ) {
-            continue;
+        BezierCPs::const_iterator nextCp = itCp;
+        if ( nextCp != _imp->points.end() ) {
+            ++nextCp;
         }
-        if (points) {
+
+        for (BezierCPs::const_iterator it = _imp->featherPoints.begin(); it != _imp->featherPoints.end();
+             ++it) {
+            if ( next == _imp->featherPoints.end() ) {
+                next = _imp->featherPoints.begin();
+            }
+            if ( nextCp == _imp->points.end() ) {
+                if (!_imp->finished) {
+                    break;
+                }
+                nextCp = _imp->points.begin();
+            }
+            if ( !evaluateIfEqual && bezierSegmenEqual(useGuiPoints, time, ViewIdx(0), **itCp, **nextCp, **it, **next) ) {
+                continue;
+            }
             std::list<ParametricPoint> segmentPoints;
             bezierSegmentEval(useGuiPoints, *(*it), *(*next), time, ViewIdx(0),  mipMapLevel,
 #ifdef ROTO_BEZIER_EVAL_ITERATIVE
@@ -2752,7 +2914,7 @@ Bezier::evaluateFeatherPointsAtTime_DeCasteljau_internal(bool useGuiPoints,
 #else
                               errorScale,
 #endif
-                              transform, &segmentPoints, bbox);
+                              transform, &segmentPoints, &evaluated->bbox);
 
             // If we are a closed bezier or we are not on the last segment, remove the last point so we don't add duplicates
             if (!isOpenBezier() || next != _imp->featherPoints.end()) {
@@ -2760,37 +2922,24 @@ Bezier::evaluateFeatherPointsAtTime_DeCasteljau_internal(bool useGuiPoints,
                     segmentPoints.pop_back();
                 }
             }
-            points->push_back(segmentPoints);
-        } else {
-            assert(pointsSingleList);
-            bezierSegmentEval(useGuiPoints, *(*it), *(*next), time, ViewIdx(0),  mipMapLevel,
-#ifdef ROTO_BEZIER_EVAL_ITERATIVE
-                              nbPointsPerSegment,
-#else
-                              errorScale,
-#endif
-                              transform, pointsSingleList, bbox);
-            // If we are a closed bezier or we are not on the last segment, remove the last point so we don't add duplicates
-            if (!isOpenBezier() || next != _imp->featherPoints.end()) {
-                if (!pointsSingleList->empty()) {
-                    pointsSingleList->pop_back();
-                }
-            }
-        }
+            evaluated->points.push_back(segmentPoints);
 
-        // increment for next iteration
-        if ( itCp != _imp->featherPoints.end() ) {
-            ++itCp;
-        }
-        if ( next != _imp->featherPoints.end() ) {
-            ++next;
-        }
-        if ( nextCp != _imp->featherPoints.end() ) {
-            ++nextCp;
-        }
-    } // for(it)
-
-}
+            // increment for next iteration
+            if ( itCp != _imp->featherPoints.end() ) {
+                ++itCp;
+            }
+            if ( next != _imp->featherPoints.end() ) {
+                ++next;
+            }
+            if ( nextCp != _imp->featherPoints.end() ) {
+                ++nextCp;
+            }
+        } // for(it)
+    }
+    polygon = evaluated;
+    insertCachedPolygon(_imp.get(), key, age, polygon);
+    appendPolygon(*polygon, points, pointsSingleList, bbox);
+} // Bezier::evaluateFeatherPointsAtTime_DeCasteljau_internal
 
 void
 Bezier::evaluateFeatherPointsAtTime_DeCasteljau(bool useGuiPoints,
@@ -3343,6 +3492,7 @@ Bezier::load(const RotoItemSerialization & obj)
         copyInternalPointsToGuiPoints();
     }
     refreshPolygonOrientation(false);
+    incrementAge();
     RotoDrawableItem::load(obj);
 }
 
@@ -3425,6 +3575,7 @@ Bezier::setKeyFrameInterpolation(KeyframeTypeEnum interp,
             ++fp;
         }
     }
+    incrementAge();
 }
 
 void
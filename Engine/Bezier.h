@@ -397,6 +397,12 @@ public:
                                     std::list<ParametricPoint >* points,
                                     RectD* bbox) const;
 
+    /**
+     * @brief Returns the number of look-ups of the polygons cached by evaluateAtTime_DeCasteljau and
+     * evaluateFeatherPointsAtTime_DeCasteljau which missed or hit the cache since this Bezier was created.
+     **/
+    void getPolygonCacheAccessInfos(int* nbCacheMisses, int* nbCacheHits) const;
+
 private:
 
     void evaluateAtTime_DeCasteljau_internal(bool useGuiCurves,
@@ -42,11 +42,12 @@ NATRON_NAMESPACE_ENTER
 
 BlockingBackgroundRender::BlockingBackgroundRender(OutputEffectInstance* writer)
     : _running(false)
+    , _aborted(false)
     , _writer(writer)
 {
 }
 
-void
+bool
 BlockingBackgroundRender::blockingRender(bool enableRenderStats,
                                          int first,
                                          int last,
@@ -66,15 +67,18 @@ BlockingBackgroundRender::blockingRender(bool enableRenderStats,
             _runningCond.wait(&_runningMutex);
         }
     }
+
+    return !_aborted;
 }
 
 void
-BlockingBackgroundRender::notifyFinished()
+BlockingBackgroundRender::notifyFinished(bool aborted)
 {
     QMutexLocker locker(&_runningMutex);
 
     assert(_running == true);
     _running = false;
+    _aborted = aborted;
     _runningCond.wakeOne();
 }
 
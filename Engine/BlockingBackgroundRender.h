@@ -37,6 +37,7 @@ NATRON_NAMESPACE_ENTER
 class BlockingBackgroundRender
 {
     bool _running;
+    bool _aborted;
     QWaitCondition _runningCond;
     mutable QMutex _runningMutex;
     OutputEffectInstance* _writer;
@@ -54,9 +55,13 @@ public:
         return _writer;
     }
 
-    void notifyFinished();
+    void notifyFinished(bool aborted);
 
-    void blockingRender(bool enableRenderStats, int first, int last, int frameStep);
+    /**
+     * @brief Renders the sequence and returns once it is finished.
+     * @returns False if the render was aborted, e.g: because a frame failed to render.
+     **/
+    bool blockingRender(bool enableRenderStats, int first, int last, int frameStep);
 };
 
 NATRON_NAMESPACE_EXIT
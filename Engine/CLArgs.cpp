@@ -63,6 +63,7 @@ public:
     QString ipcPipe;
     int error;
     bool isInterpreterMode;
+    bool isWorkerMode;
     std::list<std::pair<int, std::pair<int, int> > > frameRanges;
     bool rangeSet;
     bool enableRenderStats;
@@ -90,6 +91,7 @@ public:
         , ipcPipe()
         , error(0)
         , isInterpreterMode(false)
+        , isWorkerMode(false)
         , frameRanges()
         , rangeSet(false)
         , enableRenderStats(false)
@@ -226,6 +228,7 @@ CLArgs::operator=(const CLArgs& other)
     _imp->ipcPipe = other._imp->ipcPipe;
     _imp->error = other._imp->error;
     _imp->isInterpreterMode = other._imp->isInterpreterMode;
+    _imp->isWorkerMode = other._imp->isWorkerMode;
     _imp->frameRanges = other._imp->frameRanges;
     _imp->rangeSet = other._imp->rangeSet;
     _imp->enableRenderStats = other._imp->enableRenderStats;
@@ -280,6 +283,15 @@ CLArgs::printUsage(const std::string& programName)
         "    script: it must be started explicitly.\n"
         "    %1Renderer and %1 do the same thing in this mode, only the\n"
         "    init.py script is loaded.\n"
+        "  --worker\n"
+        "    Enable render worker mode. Plug-ins are loaded once, then render jobs\n"
+        "    are read from the standard input, one per line. Each line holds the\n"
+        "    options and the project file path of one render as they would be given\n"
+        "    to %1Renderer, e.g: -w MyWriter 1-10 /Users/Me/MyProject.ntp\n"
+        "    Images are kept in the cache between jobs. A line containing \"quit\"\n"
+        "    or the end of the input stops the worker. For each job, a line starting\n"
+        "    with \"Job started:\" is printed, then a line starting with\n"
+        "    \"Job finished:\" or \"Job failed:\" once it is done.\n"
         "  --clear-cache\n"
         "    Clears the cache on startup.\n"
         "  --no-settings\n"
@@ -466,6 +478,12 @@ CLArgs::isInterpreterMode() const
     return _imp->isInterpreterMode;
 }
 
+bool
+CLArgs::isWorkerMode() const
+{
+    return _imp->isWorkerMode;
+}
+
 const QString&
 CLArgs::getScriptFilename() const
 {
@@ -790,6 +808,15 @@ CLArgsPrivate::parse()
         }
     }
 
+    {
+        QStringList::iterator it = hasToken( QString::fromUtf8("worker"), QString() );
+        if ( it != args.end() ) {
+            isWorkerMode = true;
+            isBackground = true;
+            args.erase(it);
+        }
+    }
+
     {
         QStringList::iterator it = hasToken( QString::fromUtf8("render-stats"), QString::fromUtf8("s") );
         if ( it != args.end() ) {
@@ -115,6 +115,8 @@ public:
 
     bool isInterpreterMode() const;
 
+    bool isWorkerMode() const;
+
     bool isCacheClearRequestedOnLaunch() const;
     
     /*
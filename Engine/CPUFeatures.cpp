@@ -0,0 +1,101 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "CPUFeatures.h"
+
+#if defined(NATRON_SIMD_AVX2) && defined(_MSC_VER)
+#include <intrin.h> // __cpuid, __cpuidex
+#include <immintrin.h> // _xgetbv
+#endif
+
+NATRON_NAMESPACE_ENTER
+
+namespace {
+// Written once by detectSIMDLevel(): racing threads all compute the same value
+volatile int gSupportedSIMDLevel = -1;
+volatile int gMaximumSIMDLevel = (int)eSIMDLevelAVX2;
+
+SIMDLevelEnum
+detectSIMDLevel()
+{
+#ifndef NATRON_SIMD_SSE2
+
+    return eSIMDLevelNone;
+#else
+#ifdef NATRON_SIMD_AVX2
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] >= 7) {
+        __cpuid(info, 1);
+        // The OS must save the YMM registers (OSXSAVE and XCR0 bits 1 and 2)
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if ( osxsave && avx && ( (_xgetbv(0) & 0x6) == 0x6 ) ) {
+            __cpuidex(info, 7, 0);
+            if ( info[1] & (1 << 5) ) {
+                return eSIMDLevelAVX2;
+            }
+        }
+    }
+#else
+    // Also checks that the OS saves the YMM registers
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports("avx2") ) {
+        return eSIMDLevelAVX2;
+    }
+#endif
+#endif // NATRON_SIMD_AVX2
+
+    return eSIMDLevelSSE2;
+#endif // NATRON_SIMD_SSE2
+}
+} // anon namespace
+
+SIMDLevelEnum
+getSupportedSIMDLevel()
+{
+    if (gSupportedSIMDLevel < 0) {
+        gSupportedSIMDLevel = (int)detectSIMDLevel();
+    }
+
+    return (SIMDLevelEnum)gSupportedSIMDLevel;
+}
+
+SIMDLevelEnum
+getSIMDLevel()
+{
+    int supported = (int)getSupportedSIMDLevel();
+    int maximum = gMaximumSIMDLevel;
+
+    return (SIMDLevelEnum)(supported < maximum ? supported : maximum);
+}
+
+void
+setMaximumSIMDLevel(SIMDLevelEnum level)
+{
+    gMaximumSIMDLevel = (int)level;
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,87 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_CPUFEATURES_H
+#define NATRON_ENGINE_CPUFEATURES_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+/*
+ * NATRON_SIMD_SSE2 is defined when SSE2 intrinsics may be used without any particular compiler flag,
+ * i.e: on x86-64 and on x86 builds that target SSE2.
+ * NATRON_SIMD_AVX2 is defined when the compiler can build AVX2 functions in a translation unit that is
+ * not compiled with -mavx2: such functions must be declared with NATRON_SIMD_TARGET_AVX2 and may only
+ * be called when getSIMDLevel() returns eSIMDLevelAVX2.
+ */
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NATRON_SIMD_SSE2
+#endif
+
+#ifdef NATRON_SIMD_SSE2
+#if defined(__clang__)
+#if (__clang_major__ > 3) || (__clang_major__ == 3 && __clang_minor__ >= 8)
+#define NATRON_SIMD_AVX2
+#define NATRON_SIMD_TARGET_AVX2 __attribute__( ( target("avx2") ) )
+#endif
+#elif defined(__GNUC__)
+#if (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define NATRON_SIMD_AVX2
+#define NATRON_SIMD_TARGET_AVX2 __attribute__( ( target("avx2") ) )
+#endif
+#elif defined(_MSC_VER) && (_MSC_VER >= 1800)
+#define NATRON_SIMD_AVX2
+#define NATRON_SIMD_TARGET_AVX2
+#endif
+#endif // NATRON_SIMD_SSE2
+
+NATRON_NAMESPACE_ENTER
+
+enum SIMDLevelEnum
+{
+    eSIMDLevelNone = 0, //< scalar code only
+    eSIMDLevelSSE2,
+    eSIMDLevelAVX2
+};
+
+/**
+ * @brief Returns the best instruction set supported by both the build and the CPU (and OS) running it.
+ * The CPU is queried once.
+ **/
+SIMDLevelEnum getSupportedSIMDLevel();
+
+/**
+ * @brief Returns the instruction set the SIMD kernels should use: getSupportedSIMDLevel(), lowered
+ * to the level set with setMaximumSIMDLevel().
+ **/
+SIMDLevelEnum getSIMDLevel();
+
+/**
+ * @brief Caps the instruction set used by the SIMD kernels, mainly to compare them with the scalar code
+ * in tests and benchmarks.
+ **/
+void setMaximumSIMDLevel(SIMDLevelEnum level);
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_CPUFEATURES_H
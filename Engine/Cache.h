@@ -48,6 +48,7 @@ GCC_DIAG_OFF(deprecated)
 #include <QtCore/QObject>
 #include <QtCore/QBuffer>
 #include <QtCore/QRunnable>
+#include <QtCore/QAtomicInt>
 GCC_DIAG_ON(deprecated)
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
@@ -72,8 +73,93 @@ GCC_DIAG_ON(deprecated)
 ///When defined, number of opened files, memory size and disk size of the cache are printed whenever there's activity.
 //#define NATRON_DEBUG_CACHE
 
+///When defined, the cache sizes are maintained with 64-bit atomics instead of a mutex
+#if QT_VERSION >= QT_VERSION_CHECK(5, 3, 0) && defined(Q_ATOMIC_INT64_IS_SUPPORTED)
+#define NATRON_CACHE_ATOMIC_SIZE
+#endif
+
 NATRON_NAMESPACE_ENTER
 
+/**
+ * @brief A byte counter used for the size accounting of the cache.
+ * Entries notify the cache of their allocations from any render thread, so this is
+ * lock-free whenever the platform has 64-bit atomics.
+ * Subtractions saturate at 0 because the sizes reported by the entries are not always balanced.
+ **/
+class CacheSizeCounter
+{
+#ifdef NATRON_CACHE_ATOMIC_SIZE
+    QAtomicInteger<quint64> _value;
+#else
+    mutable QMutex _valueMutex;
+    quint64 _value;
+#endif
+
+public:
+
+    explicit CacheSizeCounter(quint64 value = 0)
+#ifdef NATRON_CACHE_ATOMIC_SIZE
+        : _value(value)
+#else
+        : _valueMutex()
+        , _value(value)
+#endif
+    {
+    }
+
+    quint64 get() const
+    {
+#ifdef NATRON_CACHE_ATOMIC_SIZE
+        return _value.loadAcquire();
+#else
+        QMutexLocker k(&_valueMutex);
+
+        return _value;
+#endif
+    }
+
+    void set(quint64 value)
+    {
+#ifdef NATRON_CACHE_ATOMIC_SIZE
+        _value.storeRelease(value);
+#else
+        QMutexLocker k(&_valueMutex);
+        _value = value;
+#endif
+    }
+
+    void add(quint64 value)
+    {
+#ifdef NATRON_CACHE_ATOMIC_SIZE
+        _value.fetchAndAddOrdered(value);
+#else
+        QMutexLocker k(&_valueMutex);
+        _value += value;
+#endif
+    }
+
+    void subtract(quint64 value)
+    {
+#ifdef NATRON_CACHE_ATOMIC_SIZE
+        for (;;) {
+            quint64 cur = _value.loadAcquire();
+            quint64 newValue = value > cur ? 0 : cur - value;
+            if ( _value.testAndSetOrdered(cur, newValue) ) {
+                return;
+            }
+        }
+#else
+        QMutexLocker k(&_valueMutex);
+        _value = value > _value ? 0 : _value - value;
+#endif
+    }
+
+private:
+
+    CacheSizeCounter(const CacheSizeCounter&);
+    CacheSizeCounter& operator=(const CacheSizeCounter&);
+};
+
 /**
  * @brief The point of this thread is to delete the content of the list in a separate thread so the thread calling
  * get() doesn't wait for all the entries to be deleted (which can be expensive for large images)
@@ -400,7 +486,27 @@ public:
 public:
 
 
-#ifdef USE_VARIADIC_TEMPLATES
+#if defined(NATRON_CACHE_USE_INTRUSIVE_LRU)
+
+    // The cost of an entry is the time it took to render, @see CacheEntryHelper::getRenderCost()
+    struct EntryRenderCost
+    {
+        double operator()(const EntryTypePtr & entry) const
+        {
+            return entry->getRenderCost();
+        }
+    };
+
+    typedef IntrusiveLRUHashTable<hash_type, EntryTypePtr, EntryRenderCost> CacheContainer;
+    typedef typename CacheContainer::iterator CacheIterator;
+    typedef typename CacheContainer::iterator ConstCacheIterator;
+    typedef typename CacheContainer::value_type EntriesList;
+    static EntriesList &  getValueFromIterator(CacheIterator it)
+    {
+        return it->second;
+    }
+
+#elif defined(USE_VARIADIC_TEMPLATES)
 
 #ifdef NATRON_CACHE_USE_BOOST
 #ifdef NATRON_CACHE_USE_HASH
@@ -410,6 +516,7 @@ public:
 #endif
     typedef typename CacheContainer::container_type::left_iterator CacheIterator;
     typedef typename CacheContainer::container_type::left_const_iterator ConstCacheIterator;
+    typedef std::list<EntryTypePtr> EntriesList;
     static std::list<CachedValue> &  getValueFromIterator(CacheIterator it)
     {
         return it->second;
@@ -424,6 +531,7 @@ public:
 #endif
     typedef typename CacheContainer::key_to_value_type::iterator CacheIterator;
     typedef typename CacheContainer::key_to_value_type::const_iterator ConstCacheIterator;
+    typedef std::list<EntryTypePtr> EntriesList;
     static std::list<EntryTypePtr> &  getValueFromIterator(CacheIterator it)
     {
         return it->second;
@@ -441,6 +549,7 @@ public:
 #endif
     typedef typename CacheContainer::container_type::left_iterator CacheIterator;
     typedef typename CacheContainer::container_type::left_const_iterator ConstCacheIterator;
+    typedef std::list<EntryTypePtr> EntriesList;
     static std::list<EntryTypePtr> &  getValueFromIterator(CacheIterator it)
     {
         return it->second;
@@ -451,6 +560,7 @@ public:
     typedef StlLRUHashTable<hash_type, EntryTypePtr> CacheContainer;
     typedef typename CacheContainer::key_to_value_type::iterator CacheIterator;
     typedef typename CacheContainer::key_to_value_type::const_iterator ConstCacheIterator;
+    typedef std::list<EntryTypePtr> EntriesList;
     static std::list<EntryTypePtr> &   getValueFromIterator(CacheIterator it)
     {
         return it->second.first;
@@ -458,28 +568,54 @@ public:
 
 #endif // NATRON_CACHE_USE_BOOST
 
-#endif // USE_VARIADIC_TEMPLATES
+#endif // NATRON_CACHE_USE_INTRUSIVE_LRU
 
 private:
 
+    /**
+     * @brief A shard owns the LRU containers of all hash keys that map to it and has its own locks,
+     * so that threads looking-up keys in different shards never contend.
+     * With a single shard, the cache behaves as a global LRU.
+     **/
+    struct CacheShard
+    {
+        mutable QMutex lock; //protects memoryCache & diskCache
+        mutable QMutex getLock;  //prevents get() and getOrCreate() to be called simultaneously for keys of this shard
 
-    std::size_t _maximumInMemorySize;     // the maximum size of the in-memory portion of the cache.(in % of the maximum cache size)
-    std::size_t _maximumCacheSize;     // maximum size allowed for the cache
+        /*These 2 are mutable because we need to modify the LRU list even
+             when we call get() and we want this function to be const.*/
+        mutable CacheContainer memoryCache;
+        mutable CacheContainer diskCache;
+
+        CacheShard()
+            : lock()
+            , getLock()
+            , memoryCache()
+            , diskCache()
+        {
+        }
+    };
+
+    typedef boost::shared_ptr<CacheShard> CacheShardPtr;
+
+    CacheSizeCounter _maximumInMemorySize;     // the maximum size of the in-memory portion of the cache.(in % of the maximum cache size)
+    CacheSizeCounter _maximumCacheSize;     // maximum size allowed for the cache
 
     /*mutable because we need to change modify it in the sealEntryInternal function which
          is called by an external object that have a const ref to the cache.
      */
-    mutable std::size_t _memoryCacheSize;     // current size of the cache in bytes
-    mutable std::size_t _diskCacheSize;
-    mutable QMutex _sizeLock; // protects _memoryCacheSize & _diskCacheSize & _maximumInMemorySize & _maximumCacheSize
-    mutable QMutex _lock; //protects _memoryCache & _diskCache
-    mutable QMutex _getLock;  //prevents get() and getOrCreate() to be called simultaneously
+    mutable CacheSizeCounter _memoryCacheSize;     // current size of the cache in bytes
+    mutable CacheSizeCounter _diskCacheSize;
+    mutable QMutex _memoryFullMutex; // used along with _memoryFullCondition
 
+    // The number of shards is a power of 2 so that the shard of a hash is found with a mask
+    std::vector<CacheShardPtr> _shards;
 
-    /*These 2 are mutable because we need to modify the LRU list even
-         when we call get() and we want this function to be const.*/
-    mutable CacheContainer _memoryCache;
-    mutable CacheContainer _diskCache;
+    // Shard where the next eviction attempt starts, so that all shards are evicted evenly
+    mutable QAtomicInt _nextEvictedShard;
+
+    // A CacheEvictionPolicyEnum, applied to the containers of all shards
+    QAtomicInt _evictionPolicy;
     const std::string _cacheName;
     const unsigned int _version;
 
@@ -491,7 +627,7 @@ private:
     std::size_t _maxPhysicalRAM;
     bool _tearingDown;
     mutable DeleterThread<EntryType> _deleterThread;
-    mutable QWaitCondition _memoryFullCondition; //< protected by _sizeLock
+    mutable QWaitCondition _memoryFullCondition; //< protected by _memoryFullMutex
     mutable CacheCleanerThread _cleanerThread;
 
     // If tiled, the cache will consist only of a few large files that each contain tiles of the same size.
@@ -512,21 +648,27 @@ private:
 public:
 
 
+    /**
+     * @brief Creates a cache. The cache is split in nShards shards, rounded to the
+     * next power of 2 and capped to NATRON_CACHE_MAX_SHARDS. A single shard keeps a
+     * strict LRU order over all entries whereas several shards remove the
+     * contention between threads at the expense of an LRU order that is only per shard.
+     **/
     Cache(const std::string & cacheName,
           unsigned int version,
           U64 maximumCacheSize,      // total size
-          double maximumInMemoryPercentage //how much should live in RAM
+          double maximumInMemoryPercentage, //how much should live in RAM
+          unsigned int nShards = 1
           )
         : CacheAPI()
         , _maximumInMemorySize(maximumCacheSize * maximumInMemoryPercentage)
         , _maximumCacheSize(maximumCacheSize)
         , _memoryCacheSize(0)
         , _diskCacheSize(0)
-        , _sizeLock()
-        , _lock()
-        , _getLock()
-        , _memoryCache()
-        , _diskCache()
+        , _memoryFullMutex()
+        , _shards()
+        , _nextEvictedShard(0)
+        , _evictionPolicy( (int)eCacheEvictionPolicyLRU )
         , _cacheName(cacheName)
         , _version(version)
         , _signalEmitter()
@@ -543,16 +685,52 @@ public:
         , _nextAvailableCacheFile()
         , _nextAvailableCacheFileIndex(-1)
     {
+        unsigned int shardsCount = 1;
+        while ( shardsCount < nShards && shardsCount < NATRON_CACHE_MAX_SHARDS ) {
+            shardsCount *= 2;
+        }
+        _shards.resize(shardsCount);
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            _shards[i] = boost::make_shared<CacheShard>();
+        }
         _signalEmitter = boost::make_shared<CacheSignalEmitter>();
     }
 
     virtual ~Cache()
     {
-        QMutexLocker locker(&_lock);
-
         _tearingDown = true;
-        _memoryCache.clear();
-        _diskCache.clear();
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            QMutexLocker locker(&_shards[i]->lock);
+            _shards[i]->memoryCache.clear();
+            _shards[i]->diskCache.clear();
+        }
+    }
+
+    /**
+     * @brief Returns the number of shards the cache is split into.
+     **/
+    std::size_t getShardsCount() const
+    {
+        return _shards.size();
+    }
+
+    /**
+     * @brief Selects which entry is evicted first when the cache is full, @see CacheEvictionPolicyEnum.
+     * Only the IntrusiveLRUHashTable container implements the policies other than LRU.
+     **/
+    void setEvictionPolicy(CacheEvictionPolicyEnum policy)
+    {
+        _evictionPolicy.fetchAndStoreRelaxed( (int)policy );
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            QMutexLocker locker(&_shards[i]->lock);
+            applyEvictionPolicy(_shards[i]->memoryCache);
+            applyEvictionPolicy(_shards[i]->diskCache);
+        }
+    }
+
+    CacheEvictionPolicyEnum getEvictionPolicy() const
+    {
+        return (CacheEvictionPolicyEnum)(int)_evictionPolicy;
     }
 
     virtual bool isTileCache() const OVERRIDE FINAL
@@ -600,17 +778,33 @@ public:
     bool get(const typename EntryType::key_type & key,
              std::list<EntryTypePtr>* returnValue) const
     {
+        CacheShard& shard = getShard( key.getHash() );
+
         ///Be atomic, so it cannot be created by another thread in the meantime
-        QMutexLocker getlocker(&_getLock);
+        QMutexLocker getlocker(&shard.getLock);
 
         ///lock the cache before reading it.
-        QMutexLocker locker(&_lock);
+        QMutexLocker locker(&shard.lock);
 
-        return getInternal(key, returnValue);
+        return getInternal(shard, key, returnValue);
     } // get
 
 private:
 
+    /**
+     * @brief Returns the shard owning the given hash key. The high bits are folded in
+     * since the low bits alone of some keys are poorly distributed.
+     **/
+    CacheShard& getShard(hash_type hash) const
+    {
+        U64 h = (U64)hash;
+
+        h ^= (h >> 32);
+        h ^= (h >> 16);
+
+        return *_shards[h & (_shards.size() - 1)];
+    }
+
 
 
     virtual TileCacheFilePtr getTileCacheFile(const std::string& filepath, std::size_t dataOffset) OVERRIDE FINAL WARN_UNUSED_RETURN
@@ -774,7 +968,7 @@ private:
                         ImageLockerHelper<EntryType>* entryLocker,
                         EntryTypePtr* returnValue) const
     {
-        //_lock must not be taken here
+        //No shard lock must be taken here, except the getLock of the shard of the key
 
         ///Before allocating the memory check that there's enough space to fit in memory
         appPTR->checkCacheFreeMemoryIsGoodEnough();
@@ -793,21 +987,16 @@ private:
             ++safeCounter;
         }
 
-        U64 memoryCacheSize, maximumInMemorySize;
-        {
-            QMutexLocker k(&_sizeLock);
-            memoryCacheSize = _memoryCacheSize;
-            maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize );
-        }
+        U64 memoryCacheSize = _memoryCacheSize.get();
+        U64 maximumInMemorySize = std::max( (U64)1, (U64)_maximumInMemorySize.get() );
         {
-            QMutexLocker locker(&_lock);
             std::list<EntryTypePtr> entriesToBeDeleted;
             double occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
             ///While the current cache size can't fit the new entry, erase the last recently used entries.
             ///Also if the total free RAM is under the limit of the system free RAM to keep free, erase LRU entries.
             while (occupationPercentage > NATRON_CACHE_LIMIT_PERCENT) {
                 std::list<EntryTypePtr> deleted;
-                if ( !tryEvictInMemoryEntry(deleted) ) {
+                if ( !tryEvictInMemoryEntryFromAnyShard(deleted) ) {
                     break;
                 }
 
@@ -830,31 +1019,26 @@ private:
         }
         {
             //If _maximumcacheSize == 0 we don't return 1 otherwise we would cause a deadlock
-            QMutexLocker k(&_sizeLock);
-            double occupationPercentage =  _maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize / _maximumCacheSize;
+            QMutexLocker k(&_memoryFullMutex);
+            double occupationPercentage = getMemoryOccupationRatio();
 
             //_memoryCacheSize member will get updated while images are being destroyed by the parallel thread.
             //we wait for cache memory occupation to be < 100% to be sure we don't hit swap here
             while ( occupationPercentage >= 1. && _deleterThread.isWorking() ) {
-                _memoryFullCondition.wait(&_sizeLock);
-                occupationPercentage =  _maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize / _maximumCacheSize;
+                _memoryFullCondition.wait(&_memoryFullMutex);
+                occupationPercentage = getMemoryOccupationRatio();
             }
         }
         if (_isTiled) {
 
-            QMutexLocker locker(&_lock);
             // For tiled caches, we insert directly into the disk cache, so make sure there is room for it
             std::list<EntryTypePtr> entriesToBeDeleted;
-            U64 diskCacheSize, maximumDiskCacheSize;
-            {
-                QMutexLocker k(&_sizeLock);
-                diskCacheSize = _diskCacheSize;
-                maximumDiskCacheSize = std::max( (std::size_t)1, _maximumCacheSize - _maximumInMemorySize );
-            }
+            U64 diskCacheSize = _diskCacheSize.get();
+            U64 maximumDiskCacheSize = std::max( (U64)1, (U64)( _maximumCacheSize.get() - _maximumInMemorySize.get() ) );
             double diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
             while (diskPercentage >= NATRON_CACHE_LIMIT_PERCENT) {
                 std::list<EntryTypePtr> deleted;
-                if ( !tryEvictDiskEntry(deleted) ) {
+                if ( !tryEvictDiskEntryFromAnyShard(deleted) ) {
                     break;
                 }
 
@@ -875,7 +1059,8 @@ private:
 
         }
         {
-            QMutexLocker locker(&_lock);
+            CacheShard& shard = getShard( key.getHash() );
+            QMutexLocker locker(&shard.lock);
 
             try {
                 returnValue->reset( new EntryType(key, params, this ) );
@@ -894,25 +1079,33 @@ private:
                 if (entryLocker) {
                     entryLocker->lock(*returnValue);
                 }
-                sealEntry(*returnValue, _isTiled ? false : true);
+                sealEntry(shard, *returnValue, _isTiled ? false : true);
             }
         }
     } // createInternal
 
+    double getMemoryOccupationRatio() const
+    {
+        U64 maximumCacheSize = _maximumCacheSize.get();
+
+        return maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize.get() / maximumCacheSize;
+    }
+
 public:
 
     void swapOrInsert(const EntryTypePtr& entryToBeEvicted,
                       const EntryTypePtr& newEntry)
     {
-        QMutexLocker locker(&_lock);
-
         const typename EntryType::key_type& key = entryToBeEvicted->getKey();
         typename EntryType::hash_type hash = entryToBeEvicted->getHashKey();
+        CacheShard& shard = getShard(hash);
+        QMutexLocker locker(&shard.lock);
+
         ///find a matching value in the internal memory container
-        CacheIterator memoryCached = _memoryCache(hash);
-        if ( memoryCached != _memoryCache.end() ) {
-            std::list<EntryTypePtr> & ret = getValueFromIterator(memoryCached);
-            for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
+        CacheIterator memoryCached = shard.memoryCache.peek(hash);
+        if ( memoryCached != shard.memoryCache.end() ) {
+            EntriesList & ret = getValueFromIterator(memoryCached);
+            for (typename EntriesList::iterator it = ret.begin(); it != ret.end(); ++it) {
                 if ( ( (*it)->getKey() == key ) && ( (*it)->getParams() == entryToBeEvicted->getParams() ) ) {
                     ret.erase(it);
                     break;
@@ -922,11 +1115,11 @@ public:
             ret.push_back(newEntry);
         } else {
             ///Look in disk cache
-            CacheIterator diskCached = _diskCache(hash);
-            if ( diskCached != _diskCache.end() ) {
+            CacheIterator diskCached = shard.diskCache.peek(hash);
+            if ( diskCached != shard.diskCache.end() ) {
                 ///Remove the old entry
-                std::list<EntryTypePtr> & ret = getValueFromIterator(diskCached);
-                for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
+                EntriesList & ret = getValueFromIterator(diskCached);
+                for (typename EntriesList::iterator it = ret.begin(); it != ret.end(); ++it) {
                     if ( ( (*it)->getKey() == key ) && ( (*it)->getParams() == entryToBeEvicted->getParams() ) ) {
                         ret.erase(it);
                         break;
@@ -934,7 +1127,7 @@ public:
                 }
             }
             ///Insert in mem cache
-            _memoryCache.insert(hash, newEntry);
+            shard.memoryCache.insert(hash, newEntry);
         }
     }
 
@@ -975,12 +1168,13 @@ public:
 
         {
             ///Be atomic, so it cannot be created by another thread in the meantime
-            QMutexLocker getlocker(&_getLock);
+            CacheShard& shard = getShard( key.getHash() );
+            QMutexLocker getlocker(&shard.getLock);
             std::list<EntryTypePtr> entries;
             bool didGetSucceed;
             {
-                QMutexLocker locker(&_lock);
-                didGetSucceed = getInternal(key, &entries);
+                QMutexLocker locker(&shard.lock);
+                didGetSucceed = getInternal(shard, key, &entries);
             }
             if (didGetSucceed) {
                 for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
@@ -1014,13 +1208,16 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-        std::pair<hash_type, EntryTypePtr> evictedFromMemory = _memoryCache.evict();
-        while (evictedFromMemory.second) {
-            if ( !_isTiled && evictedFromMemory.second->isStoredOnDisk() ) {
-                evictedFromMemory.second->removeAnyBackingFile();
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
+            std::pair<hash_type, EntryTypePtr> evictedFromMemory = shard.memoryCache.evict();
+            while (evictedFromMemory.second) {
+                if ( !_isTiled && evictedFromMemory.second->isStoredOnDisk() ) {
+                    evictedFromMemory.second->removeAnyBackingFile();
+                }
+                evictedFromMemory = shard.memoryCache.evict();
             }
-            evictedFromMemory = _memoryCache.evict();
         }
 
         if (_signalEmitter) {
@@ -1044,19 +1241,22 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-
-        /// An entry which has a use_count greater than 1 is not removable:
-        /// The backing file must not be removed because it might be read/written to
-        /// at the same time. The best we can do is just let it here in the cache.
-        std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
-        //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
-        //we'll let the user of these entries purge the extra entries left in the cache later on
-        while (evictedFromDisk.second) {
-            if (!_isTiled) {
-                evictedFromDisk.second->removeAnyBackingFile();
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
+
+            /// An entry which has a use_count greater than 1 is not removable:
+            /// The backing file must not be removed because it might be read/written to
+            /// at the same time. The best we can do is just let it here in the cache.
+            std::pair<hash_type, EntryTypePtr> evictedFromDisk = shard.diskCache.evict();
+            //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
+            //we'll let the user of these entries purge the extra entries left in the cache later on
+            while (evictedFromDisk.second) {
+                if (!_isTiled) {
+                    evictedFromDisk.second->removeAnyBackingFile();
+                }
+                evictedFromDisk = shard.diskCache.evict();
             }
-            evictedFromDisk = _diskCache.evict();
         }
 
 
@@ -1073,51 +1273,47 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-        std::pair<hash_type, EntryTypePtr> evictedFromMemory = _memoryCache.evict();
-        while (evictedFromMemory.second) {
-            // Move back the entry on disk if it can be store on disk
-            // For tiled caches, the tile is sharing the same file with other entries
-            // so we cannot close it, just remove the entry
-            if ( evictedFromMemory.second->isStoredOnDisk() && !_isTiled) {
-                evictedFromMemory.second->deallocate();
-                /*insert it back into the disk portion */
-
-                U64 diskCacheSize, maximumCacheSize;
-                {
-                    QMutexLocker k(&_sizeLock);
-                    diskCacheSize = _diskCacheSize;
-                    maximumCacheSize = _maximumCacheSize;
-                }
-
-                /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
-                while (diskCacheSize + evictedFromMemory.second->size() >= maximumCacheSize) {
-                    {
-                        std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
-                        //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
-                        //we'll let the user of these entries purge the extra entries left in the cache later on
-                        if (!evictedFromDisk.second) {
-                            break;
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
+            std::pair<hash_type, EntryTypePtr> evictedFromMemory = shard.memoryCache.evict();
+            while (evictedFromMemory.second) {
+                // Move back the entry on disk if it can be store on disk
+                // For tiled caches, the tile is sharing the same file with other entries
+                // so we cannot close it, just remove the entry
+                if ( evictedFromMemory.second->isStoredOnDisk() && !_isTiled) {
+                    evictedFromMemory.second->deallocate();
+                    /*insert it back into the disk portion */
+
+                    U64 diskCacheSize = _diskCacheSize.get();
+                    U64 maximumCacheSize = _maximumCacheSize.get();
+
+                    /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
+                    while (diskCacheSize + evictedFromMemory.second->size() >= maximumCacheSize) {
+                        {
+                            std::pair<hash_type, EntryTypePtr> evictedFromDisk = shard.diskCache.evict();
+                            //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
+                            //we'll let the user of these entries purge the extra entries left in the cache later on
+                            if (!evictedFromDisk.second) {
+                                break;
+                            }
+                            ///Erase the file from the disk if we reach the limit.
+                            evictedFromDisk.second->removeAnyBackingFile();
                         }
-                        ///Erase the file from the disk if we reach the limit.
-                        evictedFromDisk.second->removeAnyBackingFile();
+                        diskCacheSize = _diskCacheSize.get();
+                        maximumCacheSize = _maximumCacheSize.get();
                     }
-                    {
-                        QMutexLocker k(&_sizeLock);
-                        diskCacheSize = _diskCacheSize;
-                        maximumCacheSize = _maximumCacheSize;
+
+                    /*update the disk cache size*/
+                    CacheIterator existingDiskCacheEntry = shard.diskCache.peek( evictedFromMemory.second->getHashKey() );
+                    /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
+                    if ( existingDiskCacheEntry == shard.diskCache.end() ) {
+                        shard.diskCache.insert(evictedFromMemory.second->getHashKey(), evictedFromMemory.second);
                     }
                 }
 
-                /*update the disk cache size*/
-                CacheIterator existingDiskCacheEntry = _diskCache( evictedFromMemory.second->getHashKey() );
-                /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
-                if ( existingDiskCacheEntry == _diskCache.end() ) {
-                    _diskCache.insert(evictedFromMemory.second->getHashKey(), evictedFromMemory.second);
-                }
+                evictedFromMemory = shard.memoryCache.evict();
             }
-
-            evictedFromMemory = _memoryCache.evict();
         }
 
         _signalEmitter->blockSignals(false);
@@ -1133,17 +1329,12 @@ public:
         std::list<EntryTypePtr> entriesToBeDeleted;
 
         {
-            QMutexLocker locker(&_lock);
-            U64 memoryCacheSize, maximumInMemorySize;
-            {
-                QMutexLocker k(&_sizeLock);
-                memoryCacheSize = _memoryCacheSize;
-                maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize );
-            }
+            U64 memoryCacheSize = _memoryCacheSize.get();
+            U64 maximumInMemorySize = std::max( (U64)1, (U64)_maximumInMemorySize.get() );
             double occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
             while (occupationPercentage >= NATRON_CACHE_LIMIT_PERCENT) {
                 std::list<EntryTypePtr> deleted;
-                if ( !tryEvictInMemoryEntry(deleted) ) {
+                if ( !tryEvictInMemoryEntryFromAnyShard(deleted) ) {
                     break;
                 }
 
@@ -1156,16 +1347,12 @@ public:
                 occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
             }
 
-            U64 diskCacheSize, maximumDiskCacheSize;
-            {
-                QMutexLocker k(&_sizeLock);
-                diskCacheSize = _diskCacheSize;
-                maximumDiskCacheSize = std::max( (std::size_t)1, _maximumCacheSize - _maximumInMemorySize );
-            }
+            U64 diskCacheSize = _diskCacheSize.get();
+            U64 maximumDiskCacheSize = std::max( (U64)1, (U64)( _maximumCacheSize.get() - _maximumInMemorySize.get() ) );
             double diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
             while (diskPercentage >= NATRON_CACHE_LIMIT_PERCENT) {
                 std::list<EntryTypePtr> deleted;
-                if ( !tryEvictDiskEntry(deleted) ) {
+                if ( !tryEvictDiskEntryFromAnyShard(deleted) ) {
                     break;
                 }
 
@@ -1187,15 +1374,18 @@ public:
      **/
     void getCopy(std::list<EntryTypePtr>* copy) const
     {
-        QMutexLocker locker(&_lock);
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            const CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
 
-        for (CacheIterator it = _memoryCache.begin(); it != _memoryCache.end(); ++it) {
-            const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
-            copy->insert( copy->end(), entries.begin(), entries.end() );
-        }
-        for (CacheIterator it = _diskCache.begin(); it != _diskCache.end(); ++it) {
-            const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
-            copy->insert( copy->end(), entries.begin(), entries.end() );
+            for (CacheIterator it = shard.memoryCache.begin(); it != shard.memoryCache.end(); ++it) {
+                const EntriesList & entries = getValueFromIterator(it);
+                copy->insert( copy->end(), entries.begin(), entries.end() );
+            }
+            for (CacheIterator it = shard.diskCache.begin(); it != shard.diskCache.end(); ++it) {
+                const EntriesList & entries = getValueFromIterator(it);
+                copy->insert( copy->end(), entries.begin(), entries.end() );
+            }
         }
     }
 
@@ -1209,13 +1399,8 @@ public:
         ///Make sure the shared_ptrs live in this list and are destroyed not while under the lock
         ///so that the memory freeing (which might be expensive for large images) doesn't happen while under the lock
         std::list<EntryTypePtr> entriesToBeDeleted;
-        bool ret;
-        {
-            QMutexLocker locker(&_lock);
-            ret = tryEvictInMemoryEntry(entriesToBeDeleted);
-        }
 
-        return ret;
+        return tryEvictInMemoryEntryFromAnyShard(entriesToBeDeleted);
     }
 
     /**
@@ -1225,10 +1410,9 @@ public:
      **/
     bool evictLRUDiskEntry() const
     {
-
-        QMutexLocker locker(&_lock);
         std::list<EntryTypePtr> entriesToBeDeleted;
-        return tryEvictDiskEntry(entriesToBeDeleted);
+
+        return tryEvictDiskEntryFromAnyShard(entriesToBeDeleted);
     }
 
     /**
@@ -1239,21 +1423,18 @@ public:
                                         std::size_t newSize) const OVERRIDE FINAL
     {
         ///The entry has notified it's memory layout has changed, it must have been due to an action from the cache
-        QMutexLocker k(&_sizeLock);
 
         ///This function can only be called for RAM buffers or while a memory mapped file is mapped into the RAM, so
         ///we just have to modify the RAM size.
 
         ///Avoid overflows, _memoryCacheSize may not always fallback to 0
-        qint64 diff = (qint64)newSize - (qint64)oldSize;
-
-        if (diff < 0) {
-            _memoryCacheSize = diff > (qint64)_memoryCacheSize ? 0 : _memoryCacheSize + diff;
+        if (newSize < oldSize) {
+            _memoryCacheSize.subtract(oldSize - newSize);
         } else {
-            _memoryCacheSize += diff;
+            _memoryCacheSize.add(newSize - oldSize);
         }
 #ifdef NATRON_DEBUG_CACHE
-        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
+        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.get() );
 #endif
     }
 
@@ -1264,27 +1445,23 @@ public:
                                       std::size_t size,
                                       StorageModeEnum storage) const OVERRIDE FINAL
     {
-        ///The entry has notified it's memory layout has changed, it must have been due to an action from the cache, hence the
-        ///lock should already be taken.
-        QMutexLocker k(&_sizeLock);
-
         if (storage == eStorageModeDisk) {
             if (_isTiled) {
                 // For tile caches, we do not control which portion of the cache is in memory, so just keep track of the disk portion
-                _diskCacheSize += size;
+                _diskCacheSize.add(size);
             } else {
-                _memoryCacheSize += size;
+                _memoryCacheSize.add(size);
                 appPTR->increaseNCacheFilesOpened();
             }
         } else {
-            _memoryCacheSize += size;
+            _memoryCacheSize.add(size);
         }
 
         _signalEmitter->emitAddedEntry(time);
 
 
 #ifdef NATRON_DEBUG_CACHE
-        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
+        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.get() );
 #endif
     }
 
@@ -1295,17 +1472,15 @@ public:
                                       std::size_t size,
                                       StorageModeEnum storage) const OVERRIDE FINAL
     {
-        QMutexLocker k(&_sizeLock);
-
         if (storage == eStorageModeRAM) {
-            _memoryCacheSize = size > _memoryCacheSize ? 0 : _memoryCacheSize - size;
+            _memoryCacheSize.subtract(size);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
+            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.get() );
 #endif
         } else if (storage == eStorageModeDisk) {
-            _diskCacheSize = size > _diskCacheSize ? 0 : _diskCacheSize - size;
+            _diskCacheSize.subtract(size);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
+            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM( _diskCacheSize.get() );
 #endif
         }
 
@@ -1315,7 +1490,7 @@ public:
 
     virtual void notifyMemoryDeallocated() const OVERRIDE FINAL
     {
-        QMutexLocker k(&_sizeLock);
+        QMutexLocker k(&_memoryFullMutex);
 
         _memoryFullCondition.wakeAll();
     }
@@ -1334,33 +1509,32 @@ public:
         if (_tearingDown) {
             return;
         }
-        QMutexLocker k(&_sizeLock);
 
         assert(oldStorage != newStorage);
         assert(newStorage != eStorageModeNone);
         if (oldStorage == eStorageModeRAM) {
-            _memoryCacheSize = size > _memoryCacheSize ? 0 : _memoryCacheSize - size;
-            _diskCacheSize += size;
+            _memoryCacheSize.subtract(size);
+            _diskCacheSize.add(size);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
-            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
+            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.get() );
+            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM( _diskCacheSize.get() );
 #endif
             ///We switched from RAM to DISK that means the MemoryFile object has been destroyed hence the file has been closed.
             appPTR->decreaseNCacheFilesOpened();
         } else if (oldStorage == eStorageModeDisk) {
-            _memoryCacheSize += size;
-            _diskCacheSize = size > _diskCacheSize ? 0 : _diskCacheSize - size;
+            _memoryCacheSize.add(size);
+            _diskCacheSize.subtract(size);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
-            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
+            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.get() );
+            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM( _diskCacheSize.get() );
 #endif
             ///We switched from DISK to RAM that means the MemoryFile object has been created and the file opened
             appPTR->increaseNCacheFilesOpened();
         } else {
             if (newStorage == eStorageModeRAM) {
-                _memoryCacheSize += size;
+                _memoryCacheSize.add(size);
             } else if (newStorage == eStorageModeDisk) {
-                _diskCacheSize += size;
+                _diskCacheSize.add(size);
             }
         }
 
@@ -1411,44 +1585,32 @@ public:
 
     void setMaximumCacheSize(U64 newSize)
     {
-        QMutexLocker k(&_sizeLock);
-
-        _maximumCacheSize = newSize;
+        _maximumCacheSize.set(newSize);
     }
 
     void setMaximumInMemorySize(double percentage)
     {
-        QMutexLocker k(&_sizeLock);
-
-        _maximumInMemorySize = _maximumCacheSize * percentage;
+        _maximumInMemorySize.set( _maximumCacheSize.get() * percentage );
     }
 
     std::size_t getMaximumSize() const
     {
-        QMutexLocker k(&_sizeLock);
-
-        return _maximumCacheSize;
+        return _maximumCacheSize.get();
     }
 
     std::size_t getMaximumMemorySize() const
     {
-        QMutexLocker k(&_sizeLock);
-
-        return _maximumInMemorySize;
+        return _maximumInMemorySize.get();
     }
 
     std::size_t getMemoryCacheSize() const
     {
-        QMutexLocker k(&_sizeLock);
-
-        return _memoryCacheSize;
+        return _memoryCacheSize.get();
     }
 
     std::size_t getDiskCacheSize() const
     {
-        QMutexLocker k(&_sizeLock);
-
-        return _diskCacheSize;
+        return _diskCacheSize.get();
     }
 
     CacheSignalEmitterPtr activateSignalEmitter() const
@@ -1468,11 +1630,12 @@ public:
         std::list<EntryTypePtr> toRemove;
 
         {
-            QMutexLocker l(&_lock);
-            CacheIterator existingEntry = _memoryCache( entry->getHashKey() );
-            if ( existingEntry != _memoryCache.end() ) {
-                std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
-                for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
+            CacheShard& shard = getShard( entry->getHashKey() );
+            QMutexLocker l(&shard.lock);
+            CacheIterator existingEntry = shard.memoryCache.peek( entry->getHashKey() );
+            if ( existingEntry != shard.memoryCache.end() ) {
+                EntriesList & ret = getValueFromIterator(existingEntry);
+                for (typename EntriesList::iterator it = ret.begin(); it != ret.end(); ++it) {
                     if ( (*it)->getKey() == entry->getKey() ) {
                         toRemove.push_back(*it);
                         ret.erase(it);
@@ -1480,13 +1643,13 @@ public:
                     }
                 }
                 if ( ret.empty() ) {
-                    _memoryCache.erase(existingEntry);
+                    shard.memoryCache.erase(existingEntry);
                 }
             } else {
-                existingEntry = _diskCache( entry->getHashKey() );
-                if ( existingEntry != _diskCache.end() ) {
-                    std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
-                    for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
+                existingEntry = shard.diskCache.peek( entry->getHashKey() );
+                if ( existingEntry != shard.diskCache.end() ) {
+                    EntriesList & ret = getValueFromIterator(existingEntry);
+                    for (typename EntriesList::iterator it = ret.begin(); it != ret.end(); ++it) {
                         if ( (*it)->getKey() == entry->getKey() ) {
                             toRemove.push_back(*it);
                             ret.erase(it);
@@ -1494,11 +1657,11 @@ public:
                         }
                     }
                     if ( ret.empty() ) {
-                        _diskCache.erase(existingEntry);
+                        shard.diskCache.erase(existingEntry);
                     }
                 }
             }
-        } // QMutexLocker l(&_lock);
+        } // QMutexLocker l(&shard.lock);
         if ( !toRemove.empty() ) {
             _deleterThread.appendToQueue(toRemove);
 
@@ -1512,25 +1675,26 @@ public:
     {
         std::list<EntryTypePtr> toRemove;
         {
-            QMutexLocker l(&_lock);
-            CacheIterator existingEntry = _memoryCache( hash);
-            if ( existingEntry != _memoryCache.end() ) {
-                std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
-                for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
+            CacheShard& shard = getShard(hash);
+            QMutexLocker l(&shard.lock);
+            CacheIterator existingEntry = shard.memoryCache.peek(hash);
+            if ( existingEntry != shard.memoryCache.end() ) {
+                EntriesList & ret = getValueFromIterator(existingEntry);
+                for (typename EntriesList::iterator it = ret.begin(); it != ret.end(); ++it) {
                     toRemove.push_back(*it);
                 }
-                _memoryCache.erase(existingEntry);
+                shard.memoryCache.erase(existingEntry);
             } else {
-                existingEntry = _diskCache( hash );
-                if ( existingEntry != _diskCache.end() ) {
-                    std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
-                    for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
+                existingEntry = shard.diskCache.peek( hash );
+                if ( existingEntry != shard.diskCache.end() ) {
+                    EntriesList & ret = getValueFromIterator(existingEntry);
+                    for (typename EntriesList::iterator it = ret.begin(); it != ret.end(); ++it) {
                         toRemove.push_back(*it);
                     }
-                    _diskCache.erase(existingEntry);
+                    shard.diskCache.erase(existingEntry);
                 }
             }
-        } // QMutexLocker l(&_lock);
+        } // QMutexLocker l(&shard.lock);
 
         if ( !toRemove.empty() ) {
             _deleterThread.appendToQueue(toRemove);
@@ -1574,29 +1738,33 @@ public:
         *diskOccupied = 0;
 
         std::string holderID = holder->getCacheID();
-        QMutexLocker locker(&_lock);
 
-        for (CacheIterator memIt = _memoryCache.begin(); memIt != _memoryCache.end(); ++memIt) {
-            std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
-            if ( !entries.empty() ) {
-                const EntryTypePtr & front = entries.front();
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            const CacheShard& shard = *_shards[i];
+            QMutexLocker locker(&shard.lock);
 
-                if (front->getKey().getCacheHolderID() == holderID) {
-                    for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
-                        *ramOccupied += (*it)->size();
+            for (CacheIterator memIt = shard.memoryCache.begin(); memIt != shard.memoryCache.end(); ++memIt) {
+                EntriesList & entries = getValueFromIterator(memIt);
+                if ( !entries.empty() ) {
+                    const EntryTypePtr & front = entries.front();
+
+                    if (front->getKey().getCacheHolderID() == holderID) {
+                        for (typename EntriesList::iterator it = entries.begin(); it != entries.end(); ++it) {
+                            *ramOccupied += (*it)->size();
+                        }
                     }
                 }
             }
-        }
 
-        for (CacheIterator memIt = _diskCache.begin(); memIt != _diskCache.end(); ++memIt) {
-            std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
-            if ( !entries.empty() ) {
-                const EntryTypePtr & front = entries.front();
+            for (CacheIterator memIt = shard.diskCache.begin(); memIt != shard.diskCache.end(); ++memIt) {
+                EntriesList & entries = getValueFromIterator(memIt);
+                if ( !entries.empty() ) {
+                    const EntryTypePtr & front = entries.front();
 
-                if (front->getKey().getCacheHolderID() == holderID) {
-                    for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
-                        *diskOccupied += (*it)->size();
+                    if (front->getKey().getCacheHolderID() == holderID) {
+                        for (typename EntriesList::iterator it = entries.begin(); it != entries.end(); ++it) {
+                            *diskOccupied += (*it)->size();
+                        }
                     }
                 }
             }
@@ -1610,18 +1778,19 @@ private:
                                                                        bool removeAll) OVERRIDE FINAL
     {
         std::list<EntryTypePtr> toDelete;
-        CacheContainer newMemCache, newDiskCache;
-        {
-            QMutexLocker locker(&_lock);
+        for (std::size_t i = 0; i < _shards.size(); ++i) {
+            CacheShard& shard = *_shards[i];
+            CacheContainer newMemCache, newDiskCache;
+            QMutexLocker locker(&shard.lock);
 
-            for (CacheIterator memIt = _memoryCache.begin(); memIt != _memoryCache.end(); ++memIt) {
-                std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
+            for (CacheIterator memIt = shard.memoryCache.begin(); memIt != shard.memoryCache.end(); ++memIt) {
+                EntriesList & entries = getValueFromIterator(memIt);
                 if ( !entries.empty() ) {
                     const EntryTypePtr & front = entries.front();
 
                     if ( (front->getKey().getCacheHolderID() == holderID) &&
                          ( ( front->getKey().getTreeVersion() != nodeHash) || removeAll ) ) {
-                        for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                        for (typename EntriesList::iterator it = entries.begin(); it != entries.end(); ++it) {
                             toDelete.push_back(*it);
                         }
                     } else {
@@ -1631,14 +1800,14 @@ private:
                 }
             }
 
-            for (CacheIterator dIt = _diskCache.begin(); dIt != _diskCache.end(); ++dIt) {
-                std::list<EntryTypePtr> & entries = getValueFromIterator(dIt);
+            for (CacheIterator dIt = shard.diskCache.begin(); dIt != shard.diskCache.end(); ++dIt) {
+                EntriesList & entries = getValueFromIterator(dIt);
                 if ( !entries.empty() ) {
                     const EntryTypePtr & front = entries.front();
 
                     if ( (front->getKey().getCacheHolderID() == holderID) &&
                          ( ( front->getKey().getTreeVersion() != nodeHash) || removeAll ) ) {
-                        for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                        for (typename EntriesList::iterator it = entries.begin(); it != entries.end(); ++it) {
                             toDelete.push_back(*it);
                         }
                     } else {
@@ -1648,9 +1817,11 @@ private:
                 }
             }
 
-            _memoryCache = newMemCache;
-            _diskCache = newDiskCache;
-        } // QMutexLocker locker(&_lock);
+            applyEvictionPolicy(newMemCache);
+            applyEvictionPolicy(newDiskCache);
+            shard.memoryCache = newMemCache;
+            shard.diskCache = newDiskCache;
+        } // for all shards
 
         if ( !toDelete.empty() ) {
             _deleterThread.appendToQueue(toDelete);
@@ -1661,20 +1832,21 @@ private:
         }
     } // removeAllEntriesWithDifferentNodeHashForHolderPrivate
 
-    bool getInternal(const typename EntryType::key_type & key,
+    bool getInternal(CacheShard& shard,
+                     const typename EntryType::key_type & key,
                      std::list<EntryTypePtr>* returnValue) const
     {
         ///Private should be locked
-        assert( !_lock.tryLock() );
+        assert( !shard.lock.tryLock() );
 
         ///find a matching value in the internal memory container
-        CacheIterator memoryCached = _memoryCache( key.getHash() );
+        CacheIterator memoryCached = shard.memoryCache( key.getHash() );
 
-        if ( memoryCached != _memoryCache.end() ) {
+        if ( memoryCached != shard.memoryCache.end() ) {
             ///we found something with a matching hash key. There may be several entries linked to
             ///this key, we need to find one with matching params
-            std::list<EntryTypePtr> & ret = getValueFromIterator(memoryCached);
-            for (typename std::list<EntryTypePtr>::const_iterator it = ret.begin(); it != ret.end(); ++it) {
+            EntriesList & ret = getValueFromIterator(memoryCached);
+            for (typename EntriesList::const_iterator it = ret.begin(); it != ret.end(); ++it) {
                 if ( (*it)->getKey() == key ) {
                     returnValue->push_back(*it);
 
@@ -1689,80 +1861,64 @@ private:
             return returnValue->size() > 0;
         } else {
             ///fallback on the disk cache internal container
-            CacheIterator diskCached = _diskCache( key.getHash() );
+            CacheIterator diskCached = shard.diskCache( key.getHash() );
 
-            if ( diskCached == _diskCache.end() ) {
+            if ( diskCached == shard.diskCache.end() ) {
                 /*the entry was neither in memory or disk, just allocate a new one*/
                 return false;
             } else {
                 /*we found something with a matching hash key. There may be several entries linked to
                    this key, we need to find one with matching values(operator ==)*/
-                std::list<EntryTypePtr> & ret = getValueFromIterator(diskCached);
+                EntriesList & ret = getValueFromIterator(diskCached);
 
-                for (typename std::list<EntryTypePtr>::iterator it = ret.begin();
+                for (typename EntriesList::iterator it = ret.begin();
                      it != ret.end(); ++it) {
                     if ( (*it)->getKey() == key ) {
+                        EntryTypePtr entry = *it;
 
-
-                        /*If we found 1 entry in the list that has exactly the same key params,
-                         we re-open the mapping to the RAM put the entry
-                         back into the memoryCache.*/
                         if (!_isTiled) {
+                            ///Remove it from the disk cache before the memory cache insertion and eviction below,
+                            ///which may modify shard.diskCache and invalidate diskCached
+                            ret.erase(it);
+                            shard.diskCache.erase(diskCached);
+
+                            /*If we found 1 entry in the list that has exactly the same key params,
+                             we re-open the mapping to the RAM put the entry
+                             back into the memoryCache.*/
                             try {
-                                (*it)->reOpenFileMapping();
+                                entry->reOpenFileMapping();
                             } catch (const std::exception & e) {
                                 qDebug() << "Error while reopening cache file: " << e.what();
-                                ret.erase(it);
 
                                 return false;
                             } catch (...) {
                                 qDebug() << "Error while reopening cache file";
-                                ret.erase(it);
 
                                 return false;
                             }
 
                             //put it back into the RAM
-                            _memoryCache.insert( (*it)->getHashKey(), *it );
+                            shard.memoryCache.insert(entry->getHashKey(), entry);
 
 
-                            U64 memoryCacheSize, maximumInMemorySize;
-                            {
-                                QMutexLocker k(&_sizeLock);
-                                memoryCacheSize = _memoryCacheSize;
-                                maximumInMemorySize = _maximumInMemorySize;
-                            }
                             std::list<EntryTypePtr> entriesToBeDeleted;
 
                             //now clear extra entries from the disk cache so it doesn't exceed the RAM limit.
-                            while (memoryCacheSize > maximumInMemorySize) {
-                                if ( !tryEvictInMemoryEntry(entriesToBeDeleted) ) {
+                            //Only this shard may be evicted since its lock is already taken.
+                            while ( _memoryCacheSize.get() > _maximumInMemorySize.get() ) {
+                                if ( !tryEvictInMemoryEntry(shard, entriesToBeDeleted) ) {
                                     break;
                                 }
-
-                                {
-                                    QMutexLocker k(&_sizeLock);
-                                    memoryCacheSize = _memoryCacheSize;
-                                    maximumInMemorySize = _maximumInMemorySize;
-                                }
                             }
                         }
-                        
-                        returnValue->push_back(*it);
+
+                        returnValue->push_back(entry);
                         ///Q_EMIT the added signal otherwise when first reading something that's already cached
                         ///the timeline wouldn't update
                         if (_signalEmitter) {
                             _signalEmitter->emitAddedEntry( key.getTime() );
                         }
 
-                        if (!_isTiled) {
-
-                            ret.erase(it);
-
-                            ///Remove it from the disk cache
-                            _diskCache.erase(diskCached);
-                        }
-
                         return true;
                     }
                 }
@@ -1774,28 +1930,38 @@ private:
         }
     } // getInternal
 
+    void applyEvictionPolicy(CacheContainer& container) const
+    {
+#ifdef NATRON_CACHE_USE_INTRUSIVE_LRU
+        container.setEvictionPolicy( getEvictionPolicy() );
+#else
+        Q_UNUSED(container);
+#endif
+    }
+
     /** @brief Inserts into the cache an entry that was previously allocated by the createInternal()
      * function. This is called directly by createInternal() if the allocation was successful
      **/
-    void sealEntry(const EntryTypePtr & entry,
+    void sealEntry(CacheShard& shard,
+                   const EntryTypePtr & entry,
                    bool inMemory) const
     {
-        assert( !_lock.tryLock() );   // must be locked
+        assert( !shard.lock.tryLock() );   // must be locked
         typename EntryType::hash_type hash = entry->getHashKey();
 
         if (inMemory) {
             /*if the entry doesn't exist on the memory cache,make a new list and insert it*/
-            CacheIterator existingEntry = _memoryCache(hash);
-            if ( existingEntry == _memoryCache.end() ) {
-                _memoryCache.insert(hash, entry);
+            CacheIterator existingEntry = shard.memoryCache.peek(hash);
+            if ( existingEntry == shard.memoryCache.end() ) {
+                shard.memoryCache.insert(hash, entry);
             } else {
                 /*append to the existing list*/
                 getValueFromIterator(existingEntry).push_back(entry);
             }
         } else {
-            CacheIterator existingEntry = _diskCache(hash);
-            if ( existingEntry == _diskCache.end() ) {
-                _diskCache.insert(hash, entry);
+            CacheIterator existingEntry = shard.diskCache.peek(hash);
+            if ( existingEntry == shard.diskCache.end() ) {
+                shard.diskCache.insert(hash, entry);
             } else {
                 /*append to the existing list*/
                 getValueFromIterator(existingEntry).push_back(entry);
@@ -1803,10 +1969,51 @@ private:
         }
     }
 
-    bool tryEvictInMemoryEntry(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    /**
+     * @brief Evicts an in-memory entry from the first shard that has something to evict, starting from
+     * a different shard at each call. No shard lock must be held by the caller since the shards
+     * are locked one after another.
+     **/
+    bool tryEvictInMemoryEntryFromAnyShard(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    {
+        std::size_t nShards = _shards.size();
+        std::size_t startShard = nShards == 1 ? 0 : (unsigned int)_nextEvictedShard.fetchAndAddRelaxed(1) % nShards;
+
+        for (std::size_t i = 0; i < nShards; ++i) {
+            CacheShard& shard = *_shards[(startShard + i) % nShards];
+            QMutexLocker locker(&shard.lock);
+            if ( tryEvictInMemoryEntry(shard, entriesToBeDeleted) ) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Same as tryEvictInMemoryEntryFromAnyShard() but for the disk portion.
+     **/
+    bool tryEvictDiskEntryFromAnyShard(std::list<EntryTypePtr> & entriesToBeDeleted) const
     {
-        assert( !_lock.tryLock() );
-        std::pair<hash_type, EntryTypePtr> evicted = _memoryCache.evict();
+        std::size_t nShards = _shards.size();
+        std::size_t startShard = nShards == 1 ? 0 : (unsigned int)_nextEvictedShard.fetchAndAddRelaxed(1) % nShards;
+
+        for (std::size_t i = 0; i < nShards; ++i) {
+            CacheShard& shard = *_shards[(startShard + i) % nShards];
+            QMutexLocker locker(&shard.lock);
+            if ( tryEvictDiskEntry(shard, entriesToBeDeleted) ) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool tryEvictInMemoryEntry(CacheShard& shard,
+                               std::list<EntryTypePtr> & entriesToBeDeleted) const
+    {
+        assert( !shard.lock.tryLock() );
+        std::pair<hash_type, EntryTypePtr> evicted = shard.memoryCache.evict();
         //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
         //we'll let the user of these entries purge the extra entries left in the cache later on
         if (!evicted.second) {
@@ -1827,17 +2034,13 @@ private:
 
             /*insert it back into the disk portion */
 
-            U64 diskCacheSize, maximumCacheSize, maximumInMemorySize;
-            {
-                QMutexLocker k(&_sizeLock);
-                diskCacheSize = _diskCacheSize;
-                maximumInMemorySize = _maximumInMemorySize;
-                maximumCacheSize = _maximumCacheSize;
-            }
+            U64 diskCacheSize = _diskCacheSize.get();
+            U64 maximumInMemorySize = _maximumInMemorySize.get();
+            U64 maximumCacheSize = _maximumCacheSize.get();
 
             /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
             while ( ( diskCacheSize  + evicted.second->size() ) >= (maximumCacheSize - maximumInMemorySize) ) {
-                std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
+                std::pair<hash_type, EntryTypePtr> evictedFromDisk = shard.diskCache.evict();
                 //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
                 //we'll let the user of these entries purge the extra entries left in the cache later on
                 if (!evictedFromDisk.second) {
@@ -1849,11 +2052,8 @@ private:
 
                 entriesToBeDeleted.push_back(evictedFromDisk.second);
 
-                {
-                    QMutexLocker k(&_sizeLock);
-                    maximumInMemorySize = _maximumInMemorySize;
-                    maximumCacheSize = _maximumCacheSize;
-                }
+                maximumInMemorySize = _maximumInMemorySize.get();
+                maximumCacheSize = _maximumCacheSize.get();
 
                 //The entry is not yet deleted for real since it's done in a separate thread when this function
                 ///size() will return 0 at this point, we have to recompute it
@@ -1861,10 +2061,10 @@ private:
                 diskCacheSize -= fsize;
             }
 
-            CacheIterator existingDiskCacheEntry = _diskCache(evicted.first);
+            CacheIterator existingDiskCacheEntry = shard.diskCache.peek(evicted.first);
             /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
-            if ( existingDiskCacheEntry == _diskCache.end() ) {
-                _diskCache.insert(evicted.first, evicted.second);
+            if ( existingDiskCacheEntry == shard.diskCache.end() ) {
+                shard.diskCache.insert(evicted.first, evicted.second);
             } else {   /*append to the existing list*/
                 getValueFromIterator(existingDiskCacheEntry).push_back(evicted.second);
             }
@@ -1873,11 +2073,12 @@ private:
         return true;
     } // tryEvictEntry
 
-    bool tryEvictDiskEntry(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    bool tryEvictDiskEntry(CacheShard& shard,
+                           std::list<EntryTypePtr> & entriesToBeDeleted) const
     {
 
-        assert( !_lock.tryLock() );
-        std::pair<hash_type, EntryTypePtr> evicted = _diskCache.evict();
+        assert( !shard.lock.tryLock() );
+        std::pair<hash_type, EntryTypePtr> evicted = shard.diskCache.evict();
         //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
         //we'll let the user of these entries purge the extra entries left in the cache later on
         if (!evicted.second) {
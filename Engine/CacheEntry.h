@@ -29,6 +29,8 @@
 
 #include <iostream>
 #include <cassert>
+#include <climits> // INT_MAX
+#include <algorithm> // min
 #include <cstdio> // for std::remove
 #include <cstring> // for std::memcpy
 #include <stdexcept>
@@ -50,6 +52,7 @@
 
 #include <QtCore/QFile>
 #include <QtCore/QMutex>
+#include <QtCore/QAtomicInt>
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QDir>
 #include <QtCore/QDebug>
@@ -768,6 +771,7 @@ public:
         , _cache()
         , _entryLock(QReadWriteLock::Recursive)
         , _removeBackingFileBeforeDestruction(false)
+        , _renderCostMicroSeconds()
     {
     }
 
@@ -786,6 +790,7 @@ public:
         , _cache(cache)
         , _entryLock(QReadWriteLock::Recursive)
         , _removeBackingFileBeforeDestruction(false)
+        , _renderCostMicroSeconds()
     {
     }
 
@@ -1083,6 +1088,32 @@ public:
         return _key.getTime();
     }
 
+    /**
+     * @brief Accumulates the time (in seconds) spent rendering into this entry.
+     * This is the cost of the entry for the cost-aware eviction policy of the cache.
+     * This does not take _entryLock so that it can be called while rendering.
+     **/
+    void addRenderCost(double seconds)
+    {
+        int us = seconds > 0. ? (int)std::min(seconds * 1e6, (double)INT_MAX) : 0;
+
+        for (;;) {
+            int cur = (int)_renderCostMicroSeconds;
+            int newValue = us > INT_MAX - cur ? INT_MAX : cur + us;
+            if ( _renderCostMicroSeconds.testAndSetRelaxed(cur, newValue) ) {
+                return;
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the time in seconds spent rendering into this entry.
+     **/
+    double getRenderCost() const
+    {
+        return (int)_renderCostMicroSeconds / 1e6;
+    }
+
     ParamsTypePtr getParams() const WARN_UNUSED_RETURN
     {
         return _params;
@@ -1250,6 +1281,9 @@ protected:
     const CacheAPI* _cache;
     mutable QReadWriteLock _entryLock;
     bool _removeBackingFileBeforeDestruction;
+
+    // Saturates at INT_MAX (about 35 minutes)
+    QAtomicInt _renderCostMicroSeconds;
 };
 
 NATRON_NAMESPACE_EXIT
@@ -31,6 +31,7 @@
 #if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 #include <boost/math/special_functions/fpclassify.hpp>
+#include <boost/make_shared.hpp>
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #endif
 #include "Engine/AppManager.h"
@@ -304,6 +305,7 @@ Curve::setPeriodic(bool periodic)
     QMutexLocker k(&_imp->_lock);
     _imp->isPeriodic = periodic;
     _imp->keyFrames.clear();
+    _imp->invalidateSnapshot();
 }
 
 bool
@@ -324,6 +326,7 @@ Curve::clearKeyFrames()
     QMutexLocker l(&_imp->_lock);
 
     _imp->keyFrames.clear();
+    _imp->invalidateSnapshot();
 }
 
 bool
@@ -783,15 +786,31 @@ Curve::getKeyFrameWithTime(double time,
     return true;
 }
 
-/// compute interpolation parameters from keyframes and an iterator
+/// find the first keyframe with time greater than t
+static KeyFrameSet::const_iterator
+upperBound(const KeyFrameSet &keyFrames,
+           double t)
+{
+    return keyFrames.upper_bound( KeyFrame(t, 0.) );
+}
+
+static std::vector<KeyFrame>::const_iterator
+upperBound(const std::vector<KeyFrame> &keyFrames,
+           double t)
+{
+    return std::upper_bound( keyFrames.begin(), keyFrames.end(), KeyFrame(t, 0.), KeyFrame_compare_time() );
+}
+
+/// compute interpolation parameters from keyframes (a KeyFrameSet or a sorted vector) and an iterator
 /// to the next keyframe (the first with time > t)
+template <typename KeyFrameContainer>
 static void
-interParams(const KeyFrameSet &keyFrames,
+interParams(const KeyFrameContainer &keyFrames,
             bool isPeriodic,
             double xMin,
             double xMax,
             double *t,
-            KeyFrameSet::const_iterator itup,
+            typename KeyFrameContainer::const_iterator itup,
             double *tcur,
             double *vcur,
             double *vcurDerivRight,
@@ -817,7 +836,7 @@ interParams(const KeyFrameSet &keyFrames,
             }
             assert(*t >= minKeyFrameX && *t <= minKeyFrameX + period);
         }
-        itup = keyFrames.upper_bound(KeyFrame(*t, 0.));
+        itup = upperBound(keyFrames, *t);
     }
     if ( itup == keyFrames.begin() ) {
         // We are in the case where all keys have a greater time
@@ -827,7 +846,7 @@ interParams(const KeyFrameSet &keyFrames,
             *vnext = itup->getValue();
             *vnextDerivLeft = itup->getLeftDerivative();
             *interpNext = itup->getInterpolation();
-            KeyFrameSet::const_reverse_iterator last =  keyFrames.rbegin();
+            typename KeyFrameContainer::const_reverse_iterator last =  keyFrames.rbegin();
             *tcur = last->getTime() - period;
             *vcur = last->getValue();
             *vcurDerivRight = last->getRightDerivative();
@@ -848,8 +867,8 @@ interParams(const KeyFrameSet &keyFrames,
         // We are in the case where no key has a greater time
         // If periodic, we are in-between the last keyframe and xMax
         if (isPeriodic) {
-            KeyFrameSet::const_iterator next = keyFrames.begin();
-            KeyFrameSet::const_reverse_iterator prev = keyFrames.rbegin();
+            typename KeyFrameContainer::const_iterator next = keyFrames.begin();
+            typename KeyFrameContainer::const_reverse_iterator prev = keyFrames.rbegin();
             *tcur = prev->getTime();
             *vcur = prev->getValue();
             *vcurDerivRight = prev->getRightDerivative();
@@ -860,7 +879,7 @@ interParams(const KeyFrameSet &keyFrames,
             *interpNext = next->getInterpolation();
         } else {
 
-            KeyFrameSet::const_reverse_iterator itlast = keyFrames.rbegin();
+            typename KeyFrameContainer::const_reverse_iterator itlast = keyFrames.rbegin();
             *tcur = itlast->getTime();
             *vcur = itlast->getValue();
             *vcurDerivRight = itlast->getRightDerivative();
@@ -874,7 +893,7 @@ interParams(const KeyFrameSet &keyFrames,
     } else {
         // between two keyframes
         // get the last keyframe with time <= t
-        KeyFrameSet::const_iterator itcur = itup;
+        typename KeyFrameContainer::const_iterator itcur = itup;
         --itcur;
         assert(itcur->getTime() <= *t);
         *tcur = itcur->getTime();
@@ -888,13 +907,14 @@ interParams(const KeyFrameSet &keyFrames,
     }
 }
 
-double
-Curve::getValueAt(double t,
-                  bool doClamp) const
+/// interpolate the curve stored in a snapshot at time t, clamping the result to range if doClamp is true
+static double
+interpolateSnapshot(const CurveSnapshot& snapshot,
+                    double t,
+                    bool doClamp,
+                    const Curve::YRange& range)
 {
-    QMutexLocker l(&_imp->_lock);
-
-    if ( _imp->keyFrames.empty() ) {
+    if ( snapshot.keys.empty() ) {
         //throw std::runtime_error("Curve has no control points!");
 
         // A curve with no control points is considered to be 0
@@ -902,62 +922,46 @@ Curve::getValueAt(double t,
         return 0.;
 
         // There is no special case for a curve with one (1) keyframe: the result is a linear curve before and after the keyframe.
-    //} else if (_imp->keyFrames.size() == 1) {
-    //    return _imp->keyFrames.begin()->getValue();
     }
 
-    double v;
-#ifdef NATRON_CURVE_USE_CACHE
-    std::map<double, double>::const_iterator foundCached = _imp->resultCache.find(t);
-    if ( foundCached != _imp->resultCache.end() ) {
-        v = foundCached->second;
-    } else
-#endif
-    {
-        // even when there is only one keyframe, there may be tangents!
-        //if (_imp->keyFrames.size() == 1) {
-        //    //if there's only 1 keyframe, don't bother interpolating
-        //    return (*_imp->keyFrames.begin()).getValue();
-        //}
-        double tcur, tnext;
-        double vcurDerivRight, vnextDerivLeft, vcur, vnext;
-        KeyframeTypeEnum interp, interpNext;
-        KeyFrame k(t, 0.);
-        // find the first keyframe with time greater than t
-        KeyFrameSet::const_iterator itup;
-        itup = _imp->keyFrames.upper_bound(k);
-        interParams(_imp->keyFrames,
-                    _imp->isPeriodic,
-                    _imp->xMin,
-                    _imp->xMax,
-                    &t,
-                    itup,
-                    &tcur,
-                    &vcur,
-                    &vcurDerivRight,
-                    &interp,
-                    &tnext,
-                    &vnext,
-                    &vnextDerivLeft,
-                    &interpNext);
+    // even when there is only one keyframe, there may be tangents!
+    double tcur, tnext;
+    double vcurDerivRight, vnextDerivLeft, vcur, vnext;
+    KeyframeTypeEnum interp, interpNext;
+    // find the first keyframe with time greater than t
+    std::vector<KeyFrame>::const_iterator itup = upperBound(snapshot.keys, t);
+    interParams(snapshot.keys,
+                snapshot.isPeriodic,
+                snapshot.xMin,
+                snapshot.xMax,
+                &t,
+                itup,
+                &tcur,
+                &vcur,
+                &vcurDerivRight,
+                &interp,
+                &tnext,
+                &vnext,
+                &vnextDerivLeft,
+                &interpNext);
 
-        v = Interpolation::interpolate(tcur, vcur,
-                                       vcurDerivRight,
-                                       vnextDerivLeft,
-                                       tnext, vnext,
-                                       t,
-                                       interp,
-                                       interpNext);
-#ifdef NATRON_CURVE_USE_CACHE
-        _imp->resultCache[t] = v;
-#endif
-    }
+    double v = Interpolation::interpolate(tcur, vcur,
+                                          vcurDerivRight,
+                                          vnextDerivLeft,
+                                          tnext, vnext,
+                                          t,
+                                          interp,
+                                          interpNext);
 
-    if ( doClamp && mustClamp() ) {
-        v = clampValueToCurveYRange(v);
+    if (doClamp) {
+        if (v > range.max) {
+            v = range.max;
+        } else if (v < range.min) {
+            v = range.min;
+        }
     }
 
-    switch (_imp->type) {
+    switch (snapshot.type) {
     case CurvePrivate::eCurveTypeString:
     case CurvePrivate::eCurveTypeInt:
 
@@ -972,7 +976,84 @@ Curve::getValueAt(double t,
 
         return v;
     }
-} // getValueAt
+} // interpolateSnapshot
+
+CurveSnapshotPtr
+Curve::getSnapshot() const
+{
+    CurveSnapshotPtr ret = boost::atomic_load(&_imp->snapshot);
+
+    if (ret) {
+        return ret;
+    }
+
+    QMutexLocker l(&_imp->_lock);
+    // Another thread may have built it while we were waiting for the lock
+    ret = boost::atomic_load(&_imp->snapshot);
+    if (!ret) {
+        boost::shared_ptr<CurveSnapshot> s = boost::make_shared<CurveSnapshot>();
+        s->keys.assign( _imp->keyFrames.begin(), _imp->keyFrames.end() );
+        s->type = _imp->type;
+        s->xMin = _imp->xMin;
+        s->xMax = _imp->xMax;
+        s->yMin = _imp->yMin;
+        s->yMax = _imp->yMax;
+        s->mustClamp = mustClamp();
+        s->isPeriodic = _imp->isPeriodic;
+        ret = s;
+        boost::atomic_store(&_imp->snapshot, ret);
+    }
+
+    return ret;
+}
+
+CurveSnapshotPtr
+Curve::getAnimationSnapshot() const
+{
+    CurveSnapshotPtr ret = getSnapshot();
+
+    return ret->keys.empty() ? CurveSnapshotPtr() : ret;
+}
+
+double
+Curve::getValueAt(double t,
+                  bool doClamp) const
+{
+    // Do not lock: the snapshot is immutable
+    return getValueAt(*getSnapshot(), t, doClamp);
+}
+
+double
+Curve::getValueAt(const CurveSnapshot& snapshot,
+                  double t,
+                  bool doClamp) const
+{
+    doClamp = doClamp && snapshot.mustClamp && !snapshot.keys.empty();
+    if (!doClamp) {
+        return interpolateSnapshot( snapshot, t, false, YRange(0., 0.) );
+    }
+
+    return interpolateSnapshot( snapshot, t, true, getCurveYRange_internal(snapshot.yMin, snapshot.yMax) );
+}
+
+void
+Curve::getValuesAt(const std::vector<double>& times,
+                   std::vector<double>* values,
+                   bool doClamp) const
+{
+    assert(values);
+    // All the values are computed from the same snapshot, so they are consistent even if the curve
+    // is modified concurrently
+    CurveSnapshotPtr snapshot = getSnapshot();
+
+    doClamp = doClamp && snapshot->mustClamp && !snapshot->keys.empty();
+    YRange range = doClamp ? getCurveYRange_internal(snapshot->yMin, snapshot->yMax) : YRange(0., 0.);
+
+    values->resize( times.size() );
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        (*values)[i] = interpolateSnapshot(*snapshot, times[i], doClamp, range);
+    }
+}
 
 double
 Curve::getDerivativeAt(double t) const
@@ -1191,8 +1272,19 @@ Curve::YRange Curve::getCurveYRange() const
     if ( !mustClamp() ) {
         return YRange( -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity() );
     }
+
+    return getCurveYRange_internal(_imp->yMin, _imp->yMax);
+}
+
+Curve::YRange
+Curve::getCurveYRange_internal(double yMin,
+                               double yMax) const
+{
+    // PRIVATE - should not lock
+    // The owner does not change during the lifetime of the curve, but yMin and yMax must be read under the lock
+    // or from a snapshot
     if (!_imp->owner) {
-        return YRange(_imp->yMin, _imp->yMax);
+        return YRange(yMin, yMax);
     }
 
     KnobDoubleBase* isDouble = dynamic_cast<KnobDoubleBase*>(_imp->owner);
@@ -1216,23 +1308,6 @@ Curve::YRange Curve::getCurveYRange() const
     } else {
         return YRange( -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity() );
     }
-
-}
-
-double
-Curve::clampValueToCurveYRange(double v) const
-{
-    // PRIVATE - should not lock
-    ////clamp to min/max if the owner of the curve is a Double or Int knob.
-    YRange minmax = getCurveYRange();
-
-    if (v > minmax.max) {
-        return minmax.max;
-    } else if (v < minmax.min) {
-        return minmax.min;
-    }
-
-    return v;
 }
 
 bool
@@ -1252,6 +1327,7 @@ Curve::setXRange(double a,
 
     _imp->xMin = a;
     _imp->xMax = b;
+    _imp->invalidateSnapshot();
 }
 
 std::pair<double, double> Curve::getXRange() const
@@ -1817,6 +1893,7 @@ Curve::setYRange(double yMin,
 
     _imp->yMin = yMin;
     _imp->yMax = yMax;
+    _imp->invalidateSnapshot();
 }
 
 bool
@@ -1833,9 +1910,7 @@ Curve::onCurveChanged()
     if (_imp->owner) {
         _imp->owner->clearExpressionsResults(_imp->dimensionInOwner);
     }
-#ifdef NATRON_CURVE_USE_CACHE
-    _imp->resultCache.clear();
-#endif
+    _imp->invalidateSnapshot();
 }
 
 void
@@ -253,6 +253,23 @@ public:
      */
     double getValueAt(double t, bool clamp = true) const WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Same as getValueAt() for each time in times, which is much cheaper than calling getValueAt() in a loop
+     * since the curve is read once. This is used to draw the curve in the curve editor.
+     **/
+    void getValuesAt(const std::vector<double>& times, std::vector<double>* values, bool clamp = true) const;
+
+    /**
+     * @brief Returns an immutable copy of the animation of the curve, or NULL if the curve has no keyframe.
+     * The snapshot can be evaluated with getValueAt() while the curve is modified by another thread.
+     **/
+    CurveSnapshotPtr getAnimationSnapshot() const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Same as getValueAt() but evaluates the given snapshot of this curve instead of its current state.
+     **/
+    double getValueAt(const CurveSnapshot& snapshot, double t, bool clamp = true) const WARN_UNUSED_RETURN;
+
     double getDerivativeAt(double t) const WARN_UNUSED_RETURN;
 
     double getIntegrateFromTo(double t1, double t2) const WARN_UNUSED_RETURN;
@@ -364,12 +381,11 @@ private:
     KeyFrameSet::const_iterator atIndex(int index) const WARN_UNUSED_RETURN;
     KeyFrameSet::const_iterator begin() const WARN_UNUSED_RETURN;
     KeyFrameSet::const_iterator end() const WARN_UNUSED_RETURN;
-    YRange getCurveYRange_internal() const WARN_UNUSED_RETURN;
+    YRange getCurveYRange_internal(double yMin, double yMax) const WARN_UNUSED_RETURN;
+    CurveSnapshotPtr getSnapshot() const WARN_UNUSED_RETURN;
 
     void removeKeyFrame(KeyFrameSet::const_iterator it);
 
-    double clampValueToCurveYRange(double v) const WARN_UNUSED_RETURN;
-
     void setKeyframesInternal(const KeyFrameSet& keys, bool refreshDerivatives);
 
     ///returns an iterator to the new keyframe in the keyframe set and
@@ -27,6 +27,8 @@
 
 #include "Global/Macros.h"
 
+#include <vector>
+
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
 #endif
@@ -39,8 +41,6 @@
 #include "Engine/KnobFile.h"
 #include "Engine/EngineFwd.h"
 
-//#define NATRON_CURVE_USE_CACHE
-
 NATRON_NAMESPACE_ENTER
 
 struct CurvePrivate
@@ -57,10 +57,6 @@ struct CurvePrivate
 
     KeyFrameSet keyFrames;
 
-#ifdef NATRON_CURVE_USE_CACHE
-    std::map<double, double> resultCache; //< a cache for interpolations
-#endif
-
     KnobI* owner;
     int dimensionInOwner;
     CurveTypeEnum type;
@@ -70,11 +66,11 @@ struct CurvePrivate
     bool isParametric;
     bool isPeriodic;
 
+    /// Only accessed with boost::atomic_load and boost::atomic_store, NULL when it must be rebuilt (@see Curve::getSnapshot())
+    mutable CurveSnapshotPtr snapshot;
+
     CurvePrivate()
         : keyFrames()
-#ifdef NATRON_CURVE_USE_CACHE
-        , resultCache()
-#endif
         , owner(NULL)
         , dimensionInOwner(-1)
         , type(eCurveTypeDouble)
@@ -85,11 +81,13 @@ struct CurvePrivate
         , _lock(QMutex::Recursive)
         , isParametric(false)
         , isPeriodic(false)
+        , snapshot()
     {
     }
 
     CurvePrivate(const CurvePrivate & other)
         : _lock(QMutex::Recursive)
+        , snapshot()
     {
         *this = other;
     }
@@ -106,9 +104,32 @@ struct CurvePrivate
         yMin = other.yMin;
         yMax = other.yMax;
         isPeriodic = other.isPeriodic;
+        invalidateSnapshot();
+    }
+
+    /**
+     * @brief Must be called with the lock taken, after any change of the members copied in the snapshot.
+     **/
+    void invalidateSnapshot()
+    {
+        boost::atomic_store( &snapshot, CurveSnapshotPtr() );
     }
+};
 
-    
+/**
+ * @brief An immutable copy of everything needed to evaluate a curve, with the keyframes stored
+ * in a sorted array. A snapshot is never modified once published: the evaluation functions only have to
+ * load the current snapshot to read a consistent curve without taking the lock, while writers
+ * modify keyFrames under the lock and invalidate the snapshot, which is rebuilt by the next reader.
+ **/
+struct CurveSnapshot
+{
+    std::vector<KeyFrame> keys;
+    CurvePrivate::CurveTypeEnum type;
+    double xMin, xMax;
+    double yMin, yMax;
+    bool mustClamp;
+    bool isPeriodic;
 };
 
 NATRON_NAMESPACE_EXIT
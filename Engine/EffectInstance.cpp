@@ -60,6 +60,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/ImageParams.h"
 #include "Engine/KnobFile.h"
 #include "Engine/KnobTypes.h"
+#include "Engine/KnobsSnapshot.h"
 #include "Engine/Log.h"
 #include "Engine/MemoryInfo.h" // printAsRAM
 #include "Engine/Node.h"
@@ -294,7 +295,8 @@ EffectInstance::setParallelRenderArgsTLS(double time,
                                          PluginOpenGLRenderSupport currentOpenGLSupport,
                                          bool doNanHandling,
                                          bool draftMode,
-                                         const RenderStatsPtr & stats)
+                                         const RenderStatsPtr & stats,
+                                         bool isPrefetch)
 {
     EffectTLSDataPtr tls = _imp->tlsData->getOrCreateTLSData();
     std::list<ParallelRenderArgsPtr>& argsList = tls->frameArgs;
@@ -305,6 +307,7 @@ EffectInstance::setParallelRenderArgsTLS(double time,
     args->view = view;
     args->isRenderResponseToUserInteraction = isRenderUserInteraction;
     args->isSequentialRender = isSequential;
+    args->isPrefetch = isPrefetch;
     args->request = nodeRequest;
     if (nodeRequest) {
         args->nodeHash = nodeRequest->nodeHash;
@@ -325,6 +328,10 @@ EffectInstance::setParallelRenderArgsTLS(double time,
     args->draftMode = draftMode;
     args->tilesSupported = getNode()->getCurrentSupportTiles();
     args->stats = stats;
+    if (!isAnalysis) {
+        // Analysis may modify the knobs and read them back while rendering
+        args->knobsSnapshot = boost::make_shared<KnobsSnapshot>(*this);
+    }
     args->openGLContext = glContext;
     argsList.push_back(args);
 }
@@ -391,6 +398,16 @@ EffectInstance::getParallelRenderArgsTLS() const
     return tls->frameArgs.back();
 }
 
+void
+EffectInstance::addInputImageCopyStats(U64 nBytes) const
+{
+    ParallelRenderArgsPtr frameArgs = getParallelRenderArgsTLS();
+
+    if ( frameArgs && frameArgs->stats && frameArgs->stats->isInDepthProfilingEnabled() ) {
+        frameArgs->stats->addInputImageCopyInfosForNode(getNode(), nBytes);
+    }
+}
+
 U64
 EffectInstance::getHash() const
 {
@@ -1054,7 +1071,11 @@ EffectInstance::getImage(int inputNb,
         }
 
         if (mapToClipPrefs) {
-            inputImg = convertPlanesFormatsIfNeeded(getApp(), inputImg, pixelRoI, clipPrefComps, depth, node->usesAlpha0ToConvertFromRGBToRGBA(), eImagePremultiplicationPremultiplied, channelForMask);
+            ImagePtr convertedImg = convertPlanesFormatsIfNeeded(getApp(), inputImg, pixelRoI, clipPrefComps, depth, node->usesAlpha0ToConvertFromRGBToRGBA(), eImagePremultiplicationPremultiplied, channelForMask);
+            if (convertedImg != inputImg) {
+                addInputImageCopyStats( convertedImg->size() );
+                inputImg = convertedImg;
+            }
         }
 
         return inputImg;
@@ -1122,6 +1143,7 @@ EffectInstance::getImage(int inputNb,
         ImagePtr rescaledImg = boost::make_shared<Image>( inputImg->getComponents(), inputImg->getRoD(),
                                                          bounds, 0, par, bitdepth, inputImg->getPremultiplication(), inputImg->getFieldingOrder() );
         inputImg->upscaleMipMap( inputImg->getBounds(), inputImgMipMapLevel, 0, rescaledImg.get() );
+        addInputImageCopyStats( rescaledImg->size() );
         if (roiPixel) {
             RectD canonicalPixelRoI;
 
@@ -1150,7 +1172,11 @@ EffectInstance::getImage(int inputNb,
 
 
     if (mapToClipPrefs) {
-        inputImg = convertPlanesFormatsIfNeeded(getApp(), inputImg, pixelRoI, clipPrefComps, depth, node->usesAlpha0ToConvertFromRGBToRGBA(), outputPremult, channelForMask);
+        ImagePtr convertedImg = convertPlanesFormatsIfNeeded(getApp(), inputImg, pixelRoI, clipPrefComps, depth, node->usesAlpha0ToConvertFromRGBToRGBA(), outputPremult, channelForMask);
+        if (convertedImg != inputImg) {
+            addInputImageCopyStats( convertedImg->size() );
+            inputImg = convertedImg;
+        }
     }
 
 #ifdef DEBUG
@@ -2151,8 +2177,10 @@ EffectInstance::Implementation::tiledRenderingFunctor(EffectInstance::Implementa
     if (callingThread != curThread) {
         ///We are in the case of host frame threading, see kOfxImageEffectPluginPropHostFrameThreading
         ///We know that in the renderAction, TLS will be needed, so we do a deep copy of the TLS from the caller thread
-        ///to this thread
-        appPTR->getAppTLS()->copyTLS(callingThread, curThread);
+        ///to this thread. The caller thread modifies its TLS while rendering tiles itself: copy the snapshot it took
+        ///before scheduling the tiles.
+        assert(args.tlsSnapshot);
+        appPTR->getAppTLS()->copyTLS(args.tlsSnapshot.get(), curThread);
     }
 
 
@@ -2177,11 +2205,66 @@ EffectInstance::Implementation::tiledRenderingFunctor(EffectInstance::Implementa
                                                                         args.planes);
 
     //Exit of the host frame threading thread
-    appPTR->getAppTLS()->cleanupTLSForThread();
+    //The calling thread may also run some of the tiles while waiting on the others: do not clear its TLS
+    if (callingThread != curThread) {
+        appPTR->getAppTLS()->cleanupTLSForThread();
+    }
 
     return ret;
 }
 
+void
+EffectInstance::Implementation::tiledRenderingTask(EffectInstance::Implementation::TiledRenderingFunctorArgs & args,
+                                                   const RectToRender & specificData,
+                                                   QThread* callingThread,
+                                                   EffectInstance::RenderingFunctorRetEnum* ret)
+{
+    *ret = tiledRenderingFunctor(args, specificData, callingThread);
+}
+
+void
+EffectInstance::Implementation::inputImagesRenderingFunctor(const EffectInstance::Implementation::InputImagesRenderingFunctorArgs & args,
+                                                            RectToRender* rectToRender,
+                                                            QThread* callingThread,
+                                                            EffectInstance::RenderRoIRetCode* ret)
+{
+    QThread* curThread = QThread::currentThread();
+
+    if (callingThread != curThread) {
+        ///Inputs are rendered with the TLS of the caller, see tiledRenderingFunctor
+        assert(args.tlsSnapshot);
+        appPTR->getAppTLS()->copyTLS(args.tlsSnapshot.get(), curThread);
+    }
+
+    RectD canonicalRoI;
+    if (args.renderFullScaleThenDownscale) {
+        rectToRender->rect.toCanonical(0, args.par, args.rod, &canonicalRoI);
+    } else {
+        rectToRender->rect.toCanonical(args.mipMapLevel, args.par, args.rod, &canonicalRoI);
+    }
+
+    *ret = _publicInterface->renderInputImagesForRoI(args.request,
+                                                     args.useTransforms,
+                                                     args.renderStorageMode,
+                                                     args.time,
+                                                     args.view,
+                                                     args.rod,
+                                                     canonicalRoI,
+                                                     args.transformMatrix,
+                                                     args.mipMapLevel,
+                                                     args.renderMappedScale,
+                                                     args.useScaleOneInputImages,
+                                                     args.byPassCache,
+                                                     *args.framesNeeded,
+                                                     *args.compsNeeded,
+                                                     &rectToRender->imgs,
+                                                     &rectToRender->inputRois);
+
+    if (callingThread != curThread) {
+        appPTR->getAppTLS()->cleanupTLSForThread();
+    }
+}
+
 EffectInstance::RenderingFunctorRetEnum
 EffectInstance::Implementation::tiledRenderingFunctor(const RectToRender & rectToRender,
                                                       const bool renderFullScaleThenDownscale,
@@ -2397,13 +2480,10 @@ EffectInstance::Implementation::renderHandler(const EffectTLSDataPtr& tls,
                                               const ImagePremultiplicationEnum originalImagePremultiplication,
                                               ImagePlanesToRender & planes)
 {
-    TimeLapsePtr timeRecorder;
+    // Always measured: this is the cost of the rendered images for the cost-aware cache eviction policy
+    TimeLapse timeRecorder;
     const ParallelRenderArgsPtr& frameArgs = tls->frameArgs.back();
 
-    if (frameArgs->stats) {
-        timeRecorder = boost::make_shared<TimeLapse>();
-    }
-
     const EffectInstance::PlaneToRender & firstPlane = planes.planes.begin()->second;
     const double time = tls->currentRenderArgs.time;
     const ViewIdx view = tls->currentRenderArgs.view;
@@ -2491,7 +2571,7 @@ EffectInstance::Implementation::renderHandler(const EffectTLSDataPtr& tls,
                 it->second.renderMappedImage->fillZero(renderMappedRectToRender, glContext);
 
                 if ( frameArgs->stats && frameArgs->stats->isInDepthProfilingEnabled() ) {
-                    frameArgs->stats->addRenderInfosForNode( _publicInterface->getNode(),  NodePtr(), it->first.getChannelsLabel(), renderMappedRectToRender, timeRecorder->getTimeSinceCreation() );
+                    frameArgs->stats->addRenderInfosForNode( _publicInterface->getNode(),  NodePtr(), it->first.getChannelsLabel(), renderMappedRectToRender, timeRecorder.getTimeSinceCreation() );
                 }
             }
 
@@ -2508,7 +2588,7 @@ EffectInstance::Implementation::renderHandler(const EffectTLSDataPtr& tls,
                     it->second.renderMappedImage->fillZero(renderMappedRectToRender, glContext);
 
                     if ( frameArgs->stats && frameArgs->stats->isInDepthProfilingEnabled() ) {
-                        frameArgs->stats->addRenderInfosForNode( _publicInterface->getNode(),  tls->currentRenderArgs.identityInput->getNode(), it->first.getChannelsLabel(), renderMappedRectToRender, timeRecorder->getTimeSinceCreation() );
+                        frameArgs->stats->addRenderInfosForNode( _publicInterface->getNode(),  tls->currentRenderArgs.identityInput->getNode(), it->first.getChannelsLabel(), renderMappedRectToRender, timeRecorder.getTimeSinceCreation() );
                     }
                 }
 
@@ -2582,7 +2662,7 @@ EffectInstance::Implementation::renderHandler(const EffectTLSDataPtr& tls,
                     }
 
                     if ( frameArgs->stats && frameArgs->stats->isInDepthProfilingEnabled() ) {
-                        frameArgs->stats->addRenderInfosForNode( _publicInterface->getNode(),  tls->currentRenderArgs.identityInput->getNode(), it->first.getChannelsLabel(), renderMappedRectToRender, timeRecorder->getTimeSinceCreation() );
+                        frameArgs->stats->addRenderInfosForNode( _publicInterface->getNode(),  tls->currentRenderArgs.identityInput->getNode(), it->first.getChannelsLabel(), renderMappedRectToRender, timeRecorder.getTimeSinceCreation() );
                     }
                 }
 
@@ -2907,8 +2987,16 @@ EffectInstance::Implementation::renderHandler(const EffectTLSDataPtr& tls,
             } // if (renderFullScaleThenDownscale) {
         } // if (it->second.isAllocatedOnTheFly) {
 
+        double timeSpent = timeRecorder.getTimeSinceCreation();
+        if (it->second.downscaleImage) {
+            it->second.downscaleImage->addRenderCost(timeSpent);
+        }
+        if ( it->second.fullscaleImage && (it->second.fullscaleImage != it->second.downscaleImage) ) {
+            it->second.fullscaleImage->addRenderCost(timeSpent);
+        }
+
         if ( frameArgs->stats && frameArgs->stats->isInDepthProfilingEnabled() ) {
-            frameArgs->stats->addRenderInfosForNode( _publicInterface->getNode(),  NodePtr(), it->first.getChannelsLabel(), renderMappedRectToRender, timeRecorder->getTimeSinceCreation() );
+            frameArgs->stats->addRenderInfosForNode( _publicInterface->getNode(),  NodePtr(), it->first.getChannelsLabel(), renderMappedRectToRender, timeSpent );
         }
     } // for (std::map<ImagePlaneDesc,PlaneToRender>::const_iterator it = outputPlanes.begin(); it != outputPlanes.end(); ++it) {
 
@@ -5200,6 +5288,18 @@ EffectInstance::getCurrentTime() const
     return app->getTimeLine()->currentFrame();
 }
 
+KnobsSnapshotPtr
+EffectInstance::getKnobsSnapshotTLS() const
+{
+    EffectTLSDataPtr tls = _imp->tlsData->getTLSData();
+
+    if ( !tls || tls->frameArgs.empty() ) {
+        return KnobsSnapshotPtr();
+    }
+
+    return tls->frameArgs.back()->knobsSnapshot;
+}
+
 ViewIdx
 EffectInstance::getCurrentView() const
 {
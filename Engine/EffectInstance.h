@@ -671,7 +671,8 @@ public:
                                   PluginOpenGLRenderSupport currentOpenGLSupport,
                                   bool doNanHandling,
                                   bool draftMode,
-                                  const RenderStatsPtr & stats);
+                                  const RenderStatsPtr & stats,
+                                  bool isPrefetch = false);
 
     void setDuringPaintStrokeCreationThreadLocal(bool duringPaintStroke);
 
@@ -686,6 +687,26 @@ public:
 
     ParallelRenderArgsPtr getParallelRenderArgsTLS() const;
 
+    /**
+     * @brief Records in the stats of the render in progress on this thread, if in-depth profiling is enabled,
+     * that nBytes were copied to give an input image to this effect instead of the cached image, or to return
+     * the image rendered by this effect in the format requested by renderRoI.
+     **/
+    void addInputImageCopyStats(U64 nBytes) const;
+
+    /**
+     * @brief Returns inputImage itself if it already has the target components count and bitdepth, otherwise
+     * a new image, not cached, containing only the part of inputImage within roi converted to that format.
+     **/
+    static ImagePtr convertPlanesFormatsIfNeeded(const AppInstancePtr& app,
+                                                 const ImagePtr& inputImage,
+                                                 const RectI& roi,
+                                                 const ImagePlaneDesc& targetComponents,
+                                                 ImageBitDepthEnum targetDepth,
+                                                 bool useAlpha0ForRGBToRGBAConversion,
+                                                 ImagePremultiplicationEnum outputPremult,
+                                                 int channelForAlpha);
+
     //Implem in ParallelRenderArgs.cpp
     static StatusEnum getInputsRoIsFunctor(bool useTransforms,
                                            double time,
@@ -859,6 +880,7 @@ public:
     virtual void abortAnyEvaluation(bool keepOldestRender = true) OVERRIDE FINAL;
     virtual double getCurrentTime() const OVERRIDE WARN_UNUSED_RETURN;
     virtual ViewIdx getCurrentView() const OVERRIDE WARN_UNUSED_RETURN;
+    virtual KnobsSnapshotPtr getKnobsSnapshotTLS() const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual bool getCanTransform() const
     {
         return false;
@@ -2179,15 +2201,6 @@ private:
                                              EffectInstance::InputImagesMap *inputImages,
                                              RoIMap* inputsRoI);
 
-    static ImagePtr convertPlanesFormatsIfNeeded(const AppInstancePtr& app,
-                                                                 const ImagePtr& inputImage,
-                                                                 const RectI& roi,
-                                                                 const ImagePlaneDesc& targetComponents,
-                                                                 ImageBitDepthEnum targetDepth,
-                                                                 bool useAlpha0ForRGBToRGBAConversion,
-                                                                 ImagePremultiplicationEnum outputPremult,
-                                                                 int channelForAlpha);
-
 
     /**
      * @brief Called by getImage when the thread-storage was not set by the caller thread (mostly because this is a thread that is not
@@ -334,11 +334,51 @@ public:
         bool byPassCache;
         std::bitset<4> processChannels;
         ImagePlanesToRenderPtr planes;
+        // The TLS of the calling thread, copied by the other threads before it starts rendering tiles itself
+        TLSSnapshotPtr tlsSnapshot;
     };
 
     RenderingFunctorRetEnum tiledRenderingFunctor(TiledRenderingFunctorArgs & args,  const RectToRender & specificData,
                                                   QThread* callingThread);
 
+    /**
+     * @brief Same as tiledRenderingFunctor but stores the result in ret, to be scheduled on the TaskScheduler
+     **/
+    void tiledRenderingTask(TiledRenderingFunctorArgs & args,
+                            const RectToRender & specificData,
+                            QThread* callingThread,
+                            RenderingFunctorRetEnum* ret);
+
+    struct InputImagesRenderingFunctorArgs
+    {
+        const FrameViewRequest* request;
+        bool useTransforms;
+        StorageModeEnum renderStorageMode;
+        bool renderFullScaleThenDownscale;
+        double time;
+        ViewIdx view;
+        RectD rod;
+        double par;
+        InputMatrixMapPtr transformMatrix;
+        unsigned int mipMapLevel;
+        RenderScale renderMappedScale;
+        bool useScaleOneInputImages;
+        bool byPassCache;
+        const FramesNeededMap* framesNeeded;
+        const ComponentsNeededMap* compsNeeded;
+        // The TLS of the calling thread, copied by the other threads before it starts rendering inputs itself
+        TLSSnapshotPtr tlsSnapshot;
+    };
+
+    /**
+     * @brief Pre-renders the input images needed to render the given rectangle and stores them in the rectangle.
+     * If called from another thread than callingThread, the snapshot of the thread-local storage of callingThread is copied first.
+     **/
+    void inputImagesRenderingFunctor(const InputImagesRenderingFunctorArgs & args,
+                                     RectToRender* rectToRender,
+                                     QThread* callingThread,
+                                     RenderRoIRetCode* ret);
+
     RenderingFunctorRetEnum tiledRenderingFunctor(const RectToRender & rectToRender,
                                                   const bool renderFullScaleThenDownscale,
                                                   const bool isSequentialRender,
@@ -32,14 +32,13 @@
 #include <cassert>
 #include <stdexcept>
 #include <sstream> // stringstream
+#include <vector>
 
 #include <boost/scoped_ptr.hpp>
 
 #include <QtCore/QThreadPool>
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QCoreApplication>
-#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
-#include <QtConcurrentRun> // QtCore on Qt4, QtConcurrent on Qt5
 
 #if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
@@ -73,6 +72,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/RotoContext.h"
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/Settings.h"
+#include "Engine/TaskScheduler.h"
 #include "Engine/Timer.h"
 #include "Engine/Transform.h"
 #include "Engine/ThreadPool.h"
@@ -187,10 +187,15 @@ EffectInstance::convertPlanesFormatsIfNeeded(const AppInstancePtr& app,
          **/
         Image::ReadAccess acc = inputImage->getReadRights();
         RectI bounds = inputImage->getBounds();
+        RectI clippedRoi;
+        if ( !roi.intersect(bounds, &clippedRoi) ) {
+            clippedRoi = bounds;
+        }
+        // Only the requested part of the image is converted: do not allocate the full bounds
 #if 0 //def BOOST_NO_CXX11_VARIADIC_TEMPLATES
        ImagePtr tmp( new Image(targetComponents,
                                 inputImage->getRoD(),
-                                bounds,
+                                clippedRoi,
                                 inputImage->getMipMapLevel(),
                                 inputImage->getPixelAspectRatio(),
                                 targetDepth,
@@ -200,7 +205,7 @@ EffectInstance::convertPlanesFormatsIfNeeded(const AppInstancePtr& app,
 #else
         ImagePtr tmp = boost::make_shared<Image>(targetComponents,
                                                  inputImage->getRoD(),
-                                                 bounds,
+                                                 clippedRoi,
                                                  inputImage->getMipMapLevel(),
                                                  inputImage->getPixelAspectRatio(),
                                                  targetDepth,
@@ -210,8 +215,6 @@ EffectInstance::convertPlanesFormatsIfNeeded(const AppInstancePtr& app,
 
 #endif
         tmp->setKey(inputImage->getKey());
-        RectI clippedRoi;
-        roi.intersect(bounds, &clippedRoi);
 
         bool unPremultIfNeeded = outputPremult == eImagePremultiplicationPremultiplied && inputImage->getComponentsCount() == 4 && tmp->getComponentsCount() == 3;
 
@@ -701,6 +704,9 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
 
                             ImagePtr tmp = convertPlanesFormatsIfNeeded(app, it->second, args.roi, *compIt, inputArgs->bitdepth, useAlpha0ForRGBToRGBAConversion, premult, -1);
                             assert(tmp);
+                            if (tmp != it->second) {
+                                addInputImageCopyStats( tmp->size() );
+                            }
                             convertedPlanes[it->first] = tmp;
                         }
                         *outputPlanes = convertedPlanes;
@@ -1266,9 +1272,11 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
         // If the plug-in is eRenderSafetyFullySafeFrame that means it wants the host to perform SMP aka slice up the RoI into chunks
         // but if the effect doesn't support tiles it won't work.
         // Also check that the number of threads indicating by the settings are appropriate for this render mode.
+        // Tiles are rendered on the TaskScheduler: the thread waiting for them renders them too, so there is no need
+        // to fall back to a single thread when all workers are busy, as was done with the global thread pool.
         if ( !frameArgs->tilesSupported || (nbThreads == -1) || (nbThreads == 1) ||
             ( (nbThreads == 0) && (appPTR->getHardwareIdealThreadCount() == 1) ) ||
-            ( QThreadPool::globalInstance()->activeThreadCount() >= QThreadPool::globalInstance()->maxThreadCount() )) {
+            !appPTR->getTaskScheduler() ) {
             safety = eRenderSafetyFullySafe;
         }
     }
@@ -1320,36 +1328,64 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
             planesToRender->outputPremult = eImagePremultiplicationOpaque;
         }
     }
-    for (std::list<RectToRender>::iterator it = planesToRender->rectsToRender.begin(); it != planesToRender->rectsToRender.end(); ++it) {
-        if (it->isIdentity) {
-            continue;
-        }
-        RenderRoIRetCode inputCode;
-        {
-            RectD canonicalRoI;
-            if (renderFullScaleThenDownscale) {
-                it->rect.toCanonical(0, par, rod, &canonicalRoI);
-            } else {
-                it->rect.toCanonical(args.mipMapLevel, par, rod, &canonicalRoI);
+    Implementation::InputImagesRenderingFunctorArgs inputImagesArgs;
+    inputImagesArgs.request = requestPassData;
+    inputImagesArgs.useTransforms = useTransforms;
+    inputImagesArgs.renderStorageMode = storage;
+    inputImagesArgs.renderFullScaleThenDownscale = renderFullScaleThenDownscale;
+    inputImagesArgs.time = args.time;
+    inputImagesArgs.view = args.view;
+    inputImagesArgs.rod = rod;
+    inputImagesArgs.par = par;
+    inputImagesArgs.transformMatrix = tls->currentRenderArgs.transformRedirections;
+    inputImagesArgs.mipMapLevel = args.mipMapLevel;
+    inputImagesArgs.renderMappedScale = renderMappedScale;
+    inputImagesArgs.useScaleOneInputImages = renderScaleOneUpstreamIfRenderScaleSupportDisabled;
+    inputImagesArgs.byPassCache = byPassCache;
+    inputImagesArgs.framesNeeded = framesNeeded.get();
+    inputImagesArgs.compsNeeded = neededComps.get();
+
+    std::vector<RenderRoIRetCode> inputCodes( planesToRender->rectsToRender.size(), eRenderRoIRetCodeOk );
+    {
+        // If the rectangles are going to be rendered concurrently, their inputs can be rendered concurrently too.
+        // OpenGL renders need the context attached to this thread.
+        TaskScheduler* scheduler = 0;
+        if ( (safety == eRenderSafetyFullySafeFrame) && (planesToRender->rectsToRender.size() > 1) && (storage != eStorageModeGLTex) ) {
+            scheduler = appPTR->getTaskScheduler();
+        }
+        QThread* currentThread = QThread::currentThread();
+        if (scheduler) {
+            inputImagesArgs.tlsSnapshot = appPTR->getAppTLS()->takeSnapshot(currentThread);
+        }
+        TaskGroup inputsGroup( scheduler, frameArgs->getRenderPriority() );
+        int i = 0;
+        for (std::list<RectToRender>::iterator it = planesToRender->rectsToRender.begin(); it != planesToRender->rectsToRender.end(); ++it, ++i) {
+            if (it->isIdentity) {
+                continue;
+            }
+            inputsGroup.run( boost::bind(&EffectInstance::Implementation::inputImagesRenderingFunctor,
+                                         _imp.get(),
+                                         boost::cref(inputImagesArgs),
+                                         &*it,
+                                         currentThread,
+                                         &inputCodes[i]) );
+        }
+        if ( !inputsGroup.wait() ) {
+            // A task exited with an exception, it is reported as a failure of its rectangle below
+            for (std::size_t j = 0; j < inputCodes.size(); ++j) {
+                if (inputCodes[j] == eRenderRoIRetCodeOk) {
+                    inputCodes[j] = eRenderRoIRetCodeFailed;
+                }
             }
+        }
+    }
 
-            inputCode = renderInputImagesForRoI(requestPassData,
-                                                useTransforms,
-                                                storage,
-                                                args.time,
-                                                args.view,
-                                                rod,
-                                                canonicalRoI,
-                                                tls->currentRenderArgs.transformRedirections,
-                                                args.mipMapLevel,
-                                                renderMappedScale,
-                                                renderScaleOneUpstreamIfRenderScaleSupportDisabled,
-                                                byPassCache,
-                                                *framesNeeded,
-                                                *neededComps,
-                                                &it->imgs,
-                                                &it->inputRois);
+    int rectIndex = 0;
+    for (std::list<RectToRender>::iterator it = planesToRender->rectsToRender.begin(); it != planesToRender->rectsToRender.end(); ++it, ++rectIndex) {
+        if (it->isIdentity) {
+            continue;
         }
+        RenderRoIRetCode inputCode = inputCodes[rectIndex];
         if ( planesToRender->inputPremult.empty() ) {
             for (InputImagesMap::iterator it2 = it->imgs.begin(); it2 != it->imgs.end(); ++it2) {
                 EffectInstancePtr input = getInput(it2->first);
@@ -1788,7 +1824,11 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
         assert(comp);
         ///The image might need to be converted to fit the original requested format
         if (comp) {
-            it->second.downscaleImage = convertPlanesFormatsIfNeeded(getApp(), it->second.downscaleImage, originalRoI, *comp, args.bitdepth, useAlpha0ForRGBToRGBAConversion, planesToRender->outputPremult, -1);
+            ImagePtr convertedImage = convertPlanesFormatsIfNeeded(getApp(), it->second.downscaleImage, originalRoI, *comp, args.bitdepth, useAlpha0ForRGBToRGBAConversion, planesToRender->outputPremult, -1);
+            if (convertedImage != it->second.downscaleImage) {
+                addInputImageCopyStats( convertedImage->size() );
+                it->second.downscaleImage = convertedImage;
+            }
             assert(it->second.downscaleImage->getComponents() == *comp && it->second.downscaleImage->getBitDepth() == args.bitdepth);
 
             StorageModeEnum imageStorage = it->second.downscaleImage->getStorageMode();
@@ -1982,29 +2022,34 @@ EffectInstance::renderRoIInternal(EffectInstance* self,
             tiledArgs->compsNeeded = compsNeeded;
 
 
+            std::vector<EffectInstance::RenderingFunctorRetEnum> ret( planesToRender->rectsToRender.size(), eRenderingFunctorRetOK );
 #ifdef NATRON_HOSTFRAMETHREADING_SEQUENTIAL
-            std::vector<EffectInstance::RenderingFunctorRetEnum> ret( tiledData.size() );
             int i = 0;
             for (std::list<RectToRender>::const_iterator it = planesToRender->rectsToRender.begin(); it != planesToRender->rectsToRender.end(); ++it, ++i) {
-                ret[i] = self->_imp->tiledRenderingFunctor(tiledArgs,
+                ret[i] = self->_imp->tiledRenderingFunctor(*tiledArgs,
                                                *it,
                                                currentThread);
             }
-            std::vector<EffectInstance::RenderingFunctorRetEnum>::const_iterator it2;
-
 #else
-
-
-            QFuture<RenderingFunctorRetEnum> ret = QtConcurrent::mapped( planesToRender->rectsToRender,
-                                                                         boost::bind(&EffectInstance::Implementation::tiledRenderingFunctor,
-                                                                                     self->_imp.get(),
-                                                                                     *tiledArgs,
-                                                                                     _1,
-                                                                                     currentThread) );
-            ret.waitForFinished();
-            QFuture<EffectInstance::RenderingFunctorRetEnum>::const_iterator it2;
-
+            {
+                // This thread renders the tiles that are not picked up by the scheduler workers while it waits
+                tiledArgs->tlsSnapshot = appPTR->getAppTLS()->takeSnapshot(currentThread);
+                TaskGroup tilesGroup( appPTR->getTaskScheduler(), frameArgs->getRenderPriority() );
+                int i = 0;
+                for (std::list<RectToRender>::const_iterator it = planesToRender->rectsToRender.begin(); it != planesToRender->rectsToRender.end(); ++it, ++i) {
+                    tilesGroup.run( boost::bind(&EffectInstance::Implementation::tiledRenderingTask,
+                                                self->_imp.get(),
+                                                boost::ref(*tiledArgs),
+                                                boost::cref(*it),
+                                                currentThread,
+                                                &ret[i]) );
+                }
+                if ( !tilesGroup.wait() ) {
+                    renderStatus = eRenderingFunctorRetFailed;
+                }
+            }
 #endif
+            std::vector<EffectInstance::RenderingFunctorRetEnum>::const_iterator it2;
             for (it2 = ret.begin(); it2 != ret.end(); ++it2) {
                 if ( (*it2) == EffectInstance::eRenderingFunctorRetFailed ) {
                     renderStatus = eRenderingFunctorRetFailed;
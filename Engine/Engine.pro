@@ -75,6 +75,7 @@ SOURCES += \
     BezierCP.cpp \
     BlockingBackgroundRender.cpp \
     CLArgs.cpp \
+    CPUFeatures.cpp \
     Cache.cpp \
     CoonsRegularization.cpp \
     CreateNodeArgs.cpp \
@@ -105,6 +106,7 @@ SOURCES += \
     Image.cpp \
     ImageConvert.cpp \
     ImageCopyChannels.cpp \
+    ImageHalveKernels.cpp \
     ImageKey.cpp \
     ImageMaskMix.cpp \
     ImageParamsSerialization.cpp \
@@ -115,13 +117,16 @@ SOURCES += \
     KnobFactory.cpp \
     KnobFile.cpp \
     KnobSerialization.cpp \
+    KnobsSnapshot.cpp \
     KnobTypes.cpp \
     LibraryBinary.cpp \
     Log.cpp \
     Lut.cpp \
+    LutKernels.cpp \
     Markdown.cpp \
     MemoryFile.cpp \
     MemoryInfo.cpp \
+    NativeExpression.cpp \
     NoOpBase.cpp \
     Node.cpp \
     NodeDocumentation.cpp \
@@ -156,6 +161,7 @@ SOURCES += \
     PrecompNode.cpp \
     ProcessHandler.cpp \
     Project.cpp \
+    ProjectBinaryFormat.cpp \
     ProjectPrivate.cpp \
     ProjectSerialization.cpp \
     PyAppInstance.cpp \
@@ -170,12 +176,14 @@ SOURCES += \
     RectD.cpp \
     RectI.cpp \
     RenderStats.cpp \
+    RenderWorker.cpp \
     RotoContext.cpp \
     RotoDrawableItem.cpp \
     RotoItem.cpp \
     RotoLayer.cpp \
     RotoPaint.cpp \
     RotoPaintInteract.cpp \
+    RotoShapeRasterizer.cpp \
     RotoSmear.cpp \
     RotoStrokeItem.cpp \
     RotoUndoCommand.cpp \
@@ -185,6 +193,7 @@ SOURCES += \
     StandardPaths.cpp \
     StringAnimationManager.cpp \
     TLSHolder.cpp \
+    TaskScheduler.cpp \
     Texture.cpp \
     TextureRect.cpp \
     ThreadPool.cpp \
@@ -271,6 +280,7 @@ HEADERS += \
     BlockingBackgroundRender.h \
     BufferableObject.h \
     CLArgs.h \
+    CPUFeatures.h \
     Cache.h \
     CacheEntry.h \
     CacheEntryHolder.h \
@@ -310,6 +320,7 @@ HEADERS += \
     HistogramCPU.h \
     HostOverlaySupport.h \
     Image.h \
+    ImageHalveKernels.h \
     ImageKey.h \
     ImageLocker.h \
     ImageParams.h \
@@ -325,16 +336,19 @@ HEADERS += \
     KnobGuiI.h \
     KnobImpl.h \
     KnobSerialization.h \
+    KnobsSnapshot.h \
     KnobTypes.h \
     LRUHashTable.h \
     LibraryBinary.h \
     Log.h \
     LogEntry.h \
     Lut.h \
+    LutKernels.h \
     Markdown.h \
     MemoryFile.h \
     MemoryInfo.h \
     MergingEnum.h \
+    NativeExpression.h \
     NoOpBase.h \
     Node.h \
     NodeGraphI.h \
@@ -371,6 +385,7 @@ HEADERS += \
     PrecompNode.h \
     ProcessHandler.h \
     Project.h \
+    ProjectBinaryFormat.h \
     ProjectPrivate.h \
     ProjectSerialization.h \
     PyAppInstance.h \
@@ -388,6 +403,7 @@ HEADERS += \
     RectI.h \
     RectISerialization.h \
     RenderStats.h \
+    RenderWorker.h \
     RotoContext.h \
     RotoContextPrivate.h \
     RotoContextSerialization.h \
@@ -400,6 +416,7 @@ HEADERS += \
     RotoPaint.h \
     RotoPaintInteract.h \
     RotoPoint.h \
+    RotoShapeRasterizer.h \
     RotoSmear.h \
     RotoStrokeItem.h \
     RotoStrokeItemSerialization.h \
@@ -412,6 +429,7 @@ HEADERS += \
     StringAnimationManager.h \
     TLSHolder.h \
     TLSHolderImpl.h \
+    TaskScheduler.h \
     Texture.h \
     TextureRect.h \
     TextureRectSerialization.h \
@@ -424,6 +442,7 @@ HEADERS += \
     TrackerContext.h \
     TrackerContextPrivate.h \
     TrackerFrameAccessor.h \
+    TrackerFrameAccessorPrivate.h \
     TrackerNode.h \
     TrackerNodeInteract.h \
     TrackerSerialization.h \
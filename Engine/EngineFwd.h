@@ -134,6 +134,7 @@ class CacheSignalEmitter;
 class ChoiceExtraData;
 class CreateNodeArgs;
 class Curve;
+struct CurveSnapshot;
 class Dimension;
 class DockablePanelI;
 class EffectInstance;
@@ -187,12 +188,14 @@ class KnobSeparator;
 class KnobSerialization;
 class KnobSerializationBase;
 class KnobSignalSlotHandler;
+class KnobsSnapshot;
 class KnobString;
 class KnobTLSData;
 class KnobTable;
 class LibraryBinary;
 class LogEntry;
 class MemoryFile;
+class NativeExpression;
 class Node;
 class NodeCollection;
 class NodeFrameRequest;
@@ -249,6 +252,9 @@ class RotoStrokeItemSerialization;
 class Settings;
 class StringAnimationManager;
 class TLSHolderBase;
+class TLSSnapshot;
+class TaskGroup;
+class TaskScheduler;
 class Texture;
 class TextureRect;
 class TileCacheFile;
@@ -331,6 +337,7 @@ typedef boost::shared_ptr<BezierSerialization> BezierSerializationPtr;
 typedef boost::shared_ptr<BufferableObject> BufferableObjectPtr;
 typedef boost::shared_ptr<CacheSignalEmitter> CacheSignalEmitterPtr;
 typedef boost::shared_ptr<Curve> CurvePtr;
+typedef boost::shared_ptr<const CurveSnapshot> CurveSnapshotPtr;
 typedef boost::shared_ptr<EffectInstance> EffectInstancePtr;
 typedef boost::shared_ptr<ExistenceCheckerThread> ExistenceCheckerThreadPtr;
 typedef boost::shared_ptr<FileSystemItem> FileSystemItemPtr;
@@ -374,10 +381,12 @@ typedef boost::shared_ptr<KnobSerialization> KnobSerializationPtr;
 typedef boost::shared_ptr<KnobSerializationBase> KnobSerializationBasePtr;
 typedef boost::shared_ptr<KnobSerializationBase> KnobsSerializationBasePtr;
 typedef boost::shared_ptr<KnobSignalSlotHandler> KnobSignalSlotHandlerPtr;
+typedef boost::shared_ptr<KnobsSnapshot> KnobsSnapshotPtr;
 typedef boost::shared_ptr<KnobString> KnobStringPtr;
 typedef boost::shared_ptr<KnobTLSData> KnobTLSDataPtr;
 typedef boost::shared_ptr<KnobTable> KnobTablePtr;
 typedef boost::shared_ptr<MemoryFile> MemoryFilePtr;
+typedef boost::shared_ptr<NativeExpression> NativeExpressionPtr;
 typedef boost::shared_ptr<Node> NodePtr;
 typedef boost::shared_ptr<NodeCollection> NodeCollectionPtr;
 typedef boost::shared_ptr<NodeFrameRequest> NodeFrameRequestPtr;
@@ -413,6 +422,7 @@ typedef boost::shared_ptr<RotoStrokeItem> RotoStrokeItemPtr;
 typedef boost::shared_ptr<RotoStrokeItemSerialization> RotoStrokeItemSerializationPtr;
 typedef boost::shared_ptr<Settings> SettingsPtr;
 typedef boost::shared_ptr<TLSHolderBase const> TLSHolderBaseConstPtr;
+typedef boost::shared_ptr<TLSSnapshot> TLSSnapshotPtr;
 typedef boost::shared_ptr<Texture> GLTexturePtr;
 typedef boost::shared_ptr<Texture> TexturePtr;
 typedef boost::shared_ptr<TileCacheFile> TileCacheFilePtr;
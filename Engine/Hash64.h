@@ -27,8 +27,10 @@
 
 #include "Global/Macros.h"
 
+#include <cstddef>
 #include <vector>
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/crc.hpp>
 #include <boost/static_assert.hpp>
 #endif
 
@@ -38,22 +40,26 @@
 
 NATRON_NAMESPACE_ENTER
 
-/*The hash of a Node is the checksum of the vector of data containing:
+/*The hash of a Node is the checksum of the sequence of data containing:
     - the values of the current knob for this node + the name of the node
     - the hash values for the  tree upstream
+
+   Values are fed to the CRC as they are appended, so that no buffer grows with the number of values.
+   A Hash64 may be copied after appending a common prefix to continue from that state later on.
  */
 
 class Hash64
 {
 public:
     Hash64()
+        : hash(0)
+        , nValues(0)
+        , crc_64()
     {
-        hash = 0;
     }
 
     ~Hash64()
     {
-        node_values.clear();
     }
 
     U64 value() const
@@ -86,7 +92,10 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
     template<typename T>
     void append(T value)
     {
-        node_values.push_back( toU64(value) );
+        U64 raw = toU64(value);
+
+        crc_64.process_bytes( &raw, sizeof(raw) );
+        ++nValues;
     }
 
     bool operator== (const Hash64 & h) const
@@ -115,8 +124,11 @@ private:
         };
     };
 
+    typedef boost::crc_optimal<64, 0x42F0E1EBA9EA3693ULL, 0, 0, false, false> CRC64;
+
     U64 hash;
-    std::vector<U64> node_values;
+    std::size_t nValues;
+    CRC64 crc_64;
 };
 
 void Hash64_appendQString(Hash64* hash, const QString & str);
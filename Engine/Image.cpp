@@ -42,6 +42,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/GPUContextPool.h"
 #include "Engine/OSGLContext.h"
 #include "Engine/GLShader.h"
+#include "Engine/ImageHalveKernels.h"
 
 NATRON_NAMESPACE_ENTER
 
@@ -1807,6 +1808,19 @@ Image::getRowElements() const
     return getComponentsCount() * _bounds.width();
 }
 
+// floor(v / 2.) and ceil(v / 2.), also for negative coordinates
+static inline int
+floorHalf(int v)
+{
+    return v >= 0 ? v / 2 : -( (1 - v) / 2 );
+}
+
+static inline int
+ceilHalf(int v)
+{
+    return -floorHalf(-v);
+}
+
 // code proofread and fixed by @devernay on 4/12/2014
 template <typename PIX, int maxValue>
 void
@@ -1873,6 +1887,11 @@ Image::halveRoIForDepth(const RectI & roi,
     const char* const srcBmData = srcBmPixels - (srcBmBounds.x1 + srcBmRowSize * srcBmBounds.y1);
     char* const dstBmData       = dstBmPixels - (dstBmBounds.x1 + dstBmRowSize * dstBmBounds.y1);
 
+    // The destination pixels whose 2x2 source block lies within srcBounds are computed by the SIMD kernels
+    const SIMDLevelEnum simdLevel = getSIMDLevel();
+    const int simdRowX1 = std::max( dstRoI.x1, ceilHalf(srcBounds.x1) );
+    const int simdRowX2 = std::min( dstRoI.x2, floorHalf(srcBounds.x2) );
+
     for (int y = dstRoI.y1; y < dstRoI.y2; ++y) {
         const PIX* const srcLineStart    = srcData + y * 2 * srcRowSize;
         PIX* const dstLineStart          = dstData + y     * dstRowSize;
@@ -1887,7 +1906,24 @@ Image::halveRoIForDepth(const RectI & roi,
         int sumH = (int)pickNextRow + (int)pickThisRow;
         assert(sumH == 1 || sumH == 2);
 
+        // [simdX1, simdX2) is the range of pixels of this row computed by the SIMD kernel, if any
+        int simdX1 = dstRoI.x2;
+        int simdX2 = dstRoI.x2;
+        if ( (sumH == 2) && (simdRowX1 < simdRowX2) &&
+             halveImageRow(getBitDepth(), _nbComponents, srcLineStart + simdRowX1 * 2 * _nbComponents,
+                           srcLineStart + simdRowX1 * 2 * _nbComponents + srcRowSize, dstLineStart + simdRowX1 * _nbComponents,
+                           simdRowX2 - simdRowX1, simdLevel) ) {
+            simdX1 = simdRowX1;
+            simdX2 = simdRowX2;
+        }
+
         for (int x = dstRoI.x1; x < dstRoI.x2; ++x) {
+            if ( (x == simdX1) && !copyBitMap ) {
+                // Nothing left to do up to simdX2
+                x = simdX2 - 1;
+                continue;
+            }
+
             const PIX* const srcPixStart    = srcLineStart   + x * 2 * _nbComponents;
             const char* const srcBmPixStart = srcBmLineStart + x * 2;
             PIX* const dstPixStart          = dstLineStart   + x * _nbComponents;
@@ -1913,18 +1949,20 @@ Image::halveRoIForDepth(const RectI & roi,
                 continue;
             }
 
-            for (int k = 0; k < _nbComponents; ++k) {
-                ///a b
-                ///c d
+            if ( (x < simdX1) || (x >= simdX2) ) {
+                for (int k = 0; k < _nbComponents; ++k) {
+                    ///a b
+                    ///c d
 
-                const PIX a = (pickThisCol && pickThisRow) ? *(srcPixStart + k) : 0;
-                const PIX b = (pickNextCol && pickThisRow) ? *(srcPixStart + k + _nbComponents) : 0;
-                const PIX c = (pickThisCol && pickNextRow) ? *(srcPixStart + k + srcRowSize) : 0;
-                const PIX d = (pickNextCol && pickNextRow) ? *(srcPixStart + k + srcRowSize  + _nbComponents)  : 0;
+                    const PIX a = (pickThisCol && pickThisRow) ? *(srcPixStart + k) : 0;
+                    const PIX b = (pickNextCol && pickThisRow) ? *(srcPixStart + k + _nbComponents) : 0;
+                    const PIX c = (pickThisCol && pickNextRow) ? *(srcPixStart + k + srcRowSize) : 0;
+                    const PIX d = (pickNextCol && pickNextRow) ? *(srcPixStart + k + srcRowSize  + _nbComponents)  : 0;
 
-                assert( sumW == 2 || ( sumW == 1 && ( (a == 0 && c == 0) || (b == 0 && d == 0) ) ) );
-                assert( sumH == 2 || ( sumH == 1 && ( (a == 0 && b == 0) || (c == 0 && d == 0) ) ) );
-                dstPixStart[k] = (a + b + c + d) / sum;
+                    assert( sumW == 2 || ( sumW == 1 && ( (a == 0 && c == 0) || (b == 0 && d == 0) ) ) );
+                    assert( sumH == 2 || ( sumH == 1 && ( (a == 0 && b == 0) || (c == 0 && d == 0) ) ) );
+                    dstPixStart[k] = (a + b + c + d) / sum;
+                }
             }
 
             if (copyBitMap) {
@@ -27,6 +27,7 @@
 #include <algorithm> // min, max
 #include <cassert>
 #include <stdexcept>
+#include <vector>
 
 #ifndef Q_MOC_RUN
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
@@ -132,6 +133,53 @@ lutFromColorspace(ViewerColorSpaceEnum cs)
     return lut;
 }
 
+/**
+ * @brief Computes the linear float values of the color channels of a row of width pixels, as the per pixel loops
+ * below do, and stores them in row, 3 floats per pixel. The float values are then converted at once with the
+ * batched lut conversions, which use the SIMD kernels: if dstIsFloat, they are also converted to the dst
+ * color-space. Channels at or above nColorComps are set to 0.
+ **/
+template <typename SRCPIX, int srcMaxValue>
+static void
+convertRowToLinearForColorSpace(const SRCPIX* srcPixels,
+                                int width,
+                                int srcNComps,
+                                int nColorComps,
+                                bool unpremult,
+                                const Color::Lut* srcLut,
+                                const Color::Lut* dstLut,
+                                bool dstIsFloat,
+                                float* row)
+{
+    float* rowPixels = row;
+
+    for (int x = 0; x < width; ++x, srcPixels += srcNComps, rowPixels += 3) {
+        float alpha = unpremult ? Image::convertPixelDepth<SRCPIX, float>(srcPixels[srcNComps - 1]) : 1.f;
+        for (int k = 0; k < 3; ++k) {
+            if (k >= nColorComps) {
+                rowPixels[k] = 0.f;
+            } else if (unpremult) {
+                float pixFloat = Image::convertPixelDepth<SRCPIX, float>(srcPixels[k]);
+                rowPixels[k] = alpha == 0.f ? 0.f : pixFloat / alpha;
+            } else if ( srcLut && (srcMaxValue == 255) ) {
+                rowPixels[k] = srcLut->fromColorSpaceUint8ToLinearFloatFast(srcPixels[k]);
+            } else if ( srcLut && (srcMaxValue == 65535) ) {
+                rowPixels[k] = srcLut->fromColorSpaceUint16ToLinearFloatFast(srcPixels[k]);
+            } else {
+                rowPixels[k] = Image::convertPixelDepth<SRCPIX, float>(srcPixels[k]);
+            }
+        }
+    }
+
+    ///The remaining float values in the src color-space
+    if ( srcLut && ( unpremult || ( (srcMaxValue != 255) && (srcMaxValue != 65535) ) ) ) {
+        srcLut->fromColorSpaceFloatToLinearFloatBatch(row, row, width * 3);
+    }
+    if (dstLut && dstIsFloat) {
+        dstLut->toColorSpaceFloatFromLinearFloatBatch(row, row, width * 3);
+    }
+}
+
 ///Fast version when components are the same
 template <typename SRCPIX, typename DSTPIX, int srcMaxValue, int dstMaxValue>
 void
@@ -150,7 +198,6 @@ Image::convertToFormatInternal_sameComps(const RectI & renderWindow,
     }
 
     ImageBitDepthEnum dstDepth = dstImg.getBitDepth();
-    ImageBitDepthEnum srcDepth = srcImg.getBitDepth();
     int nComp = (int)srcImg.getComponentsCount();
     const Color::Lut* const srcLut_ = lutFromColorspace(srcColorSpace);
     const Color::Lut* const dstLut_ = lutFromColorspace(dstColorSpace);
@@ -162,7 +209,20 @@ Image::convertToFormatInternal_sameComps(const RectI & renderWindow,
     if ( intersection.isNull() ) {
         return;
     }
+
+    ///The color channels of a row, converted to linear (and to the dst color-space if dst is float) before the loop
+    std::vector<float> linearRow;
+    if (srcLut || dstLut) {
+        linearRow.resize(intersection.width() * 3);
+    }
+
     for (int y = 0; y < intersection.height(); ++y) {
+        if (srcLut || dstLut) {
+            convertRowToLinearForColorSpace<SRCPIX, srcMaxValue>( (const SRCPIX*)srcImg.pixelAt(intersection.x1, intersection.y1 + y),
+                                                                  intersection.width(), nComp, std::min(nComp, 3), false,
+                                                                  srcLut, dstLut, dstDepth == eImageBitDepthFloat, &linearRow[0] );
+        }
+
         // coverity[dont_call]
         int start = rand() % intersection.width();
         const SRCPIX* srcPixels = (const SRCPIX*)srcImg.pixelAt(intersection.x1 + start, intersection.y1 + y);
@@ -186,19 +246,7 @@ Image::convertToFormatInternal_sameComps(const RectI & renderWindow,
                     if ( (k == 3) || (!srcLut && !dstLut) ) {
                         pix = convertPixelDepth<SRCPIX, DSTPIX>(srcPixels[k]);
                     } else {
-                        float pixFloat;
-
-                        if (srcLut) {
-                            if (srcDepth == eImageBitDepthByte) {
-                                pixFloat = srcLut->fromColorSpaceUint8ToLinearFloatFast(srcPixels[k]);
-                            } else if (srcDepth == eImageBitDepthShort) {
-                                pixFloat = srcLut->fromColorSpaceUint16ToLinearFloatFast(srcPixels[k]);
-                            } else {
-                                pixFloat = srcLut->fromColorSpaceFloatToLinearFloat(srcPixels[k]);
-                            }
-                        } else {
-                            pixFloat = convertPixelDepth<SRCPIX, float>(srcPixels[k]);
-                        }
+                        float pixFloat = linearRow[x * 3 + k];
 
                         if (dstDepth == eImageBitDepthByte) {
                             ///small increase in perf we use Luts. This should be anyway the most used case.
@@ -209,9 +257,7 @@ Image::convertToFormatInternal_sameComps(const RectI & renderWindow,
                             pix = dstLut ? dstLut->toColorSpaceUint16FromLinearFloatFast(pixFloat) :
                                   convertPixelDepth<float, DSTPIX>(pixFloat);
                         } else {
-                            if (dstLut) {
-                                pixFloat = dstLut->toColorSpaceFloatFromLinearFloat(pixFloat);
-                            }
+                            ///Already in the dst color-space
                             pix = convertPixelDepth<float, DSTPIX>(pixFloat);
                         }
                     }
@@ -306,7 +352,21 @@ Image::convertToFormatInternalForColorSpace(const RectI & renderWindow,
     const Color::Lut* const srcLut = useColorspaces ? lutFromColorspace( (ViewerColorSpaceEnum)srcColorSpace ) : 0;
     const Color::Lut* const dstLut = useColorspaces ? lutFromColorspace( (ViewerColorSpaceEnum)dstColorSpace ) : 0;
 
+    ///The color channels of a row, converted to linear (and to the dst color-space if dst is float) before the loop
+    const bool convertRows = useColorspaces && (srcLut || dstLut) && (srcNComps > 1) && (dstNComps > 1);
+    std::vector<float> linearRow;
+    if (convertRows) {
+        linearRow.resize(renderWindow.width() * 3);
+    }
+
     for (int y = 0; y < renderWindow.height(); ++y) {
+        if (convertRows) {
+            const int nColorComps = std::min( 3, std::min(srcNComps, dstNComps) );
+            convertRowToLinearForColorSpace<SRCPIX, srcMaxValue>( (const SRCPIX*)srcImg.pixelAt(renderWindow.x1, renderWindow.y1 + y),
+                                                                  renderWindow.width(), srcNComps, nColorComps, requiresUnpremult,
+                                                                  srcLut, dstLut, (dstMaxValue != 255) && (dstMaxValue != 65535), &linearRow[0] );
+        }
+
         ///Start of the line for error diffusion
         // coverity[dont_call]
         int start = rand() % renderWindow.width();
@@ -369,18 +429,6 @@ Image::convertToFormatInternalForColorSpace(const RectI & renderWindow,
                         ///In this case we've XY, RGB or RGBA input and outputs
                         assert(srcNComps != dstNComps);
 
-                        const bool unpremultChannel = ( //srcNComps == 4 && // test already done in convertToFormatInternalForDepth
-                                                        //dstNComps == 3 && // test already done in convertToFormatInternalForDepth
-                            requiresUnpremult);
-
-                        ///This is only set if unpremultChannel is true
-                        float alphaForUnPremult;
-                        if (unpremultChannel) {
-                            alphaForUnPremult = convertPixelDepth<SRCPIX, float>(srcPixels[srcNComps - 1]);
-                        } else {
-                            alphaForUnPremult = 1.;
-                        }
-
                         for (int k = 0; k < 3 && k < dstNComps; ++k) {
                             if (k >= srcNComps) { // e.g. srcNComps = 2 && dstNComps == 3 or 4
                                 dstPixels[k] =  0;
@@ -397,27 +445,8 @@ Image::convertToFormatInternalForColorSpace(const RectI & renderWindow,
                                     pix = convertPixelDepth<SRCPIX, DSTPIX>(sourcePixel);
                                 }
                             } else {
-                                ///For RGB channels
-                                float pixFloat;
-
-                                ///Unpremult before doing colorspace conversion from linear to X
-                                if (unpremultChannel) {
-                                    pixFloat = convertPixelDepth<SRCPIX, float>(sourcePixel);
-                                    pixFloat = alphaForUnPremult == 0.f ? 0. : pixFloat / alphaForUnPremult;
-                                    if (srcLut) {
-                                        pixFloat = srcLut->fromColorSpaceFloatToLinearFloat(pixFloat);
-                                    }
-                                } else if (srcLut) {
-                                    if (srcMaxValue == 255) {
-                                        pixFloat = srcLut->fromColorSpaceUint8ToLinearFloatFast(sourcePixel);
-                                    } else if (srcMaxValue == 65535) {
-                                        pixFloat = srcLut->fromColorSpaceUint16ToLinearFloatFast(sourcePixel);
-                                    } else {
-                                        pixFloat = srcLut->fromColorSpaceFloatToLinearFloat(sourcePixel);
-                                    }
-                                } else {
-                                    pixFloat = convertPixelDepth<SRCPIX, float>(sourcePixel);
-                                }
+                                ///For RGB channels, unpremultiplied if needed before doing colorspace conversion from linear to X
+                                float pixFloat = linearRow[x * 3 + k];
 
                                 ///Apply dst color-space
                                 if (dstMaxValue == 255) {
@@ -429,9 +458,7 @@ Image::convertToFormatInternalForColorSpace(const RectI & renderWindow,
                                     pix = dstLut ? dstLut->toColorSpaceUint16FromLinearFloatFast(pixFloat) :
                                           convertPixelDepth<float, DSTPIX>(pixFloat);
                                 } else {
-                                    if (dstLut) {
-                                        pixFloat = dstLut->toColorSpaceFloatFromLinearFloat(pixFloat);
-                                    }
+                                    ///Already in the dst color-space
                                     pix = convertPixelDepth<float, DSTPIX>(pixFloat);
                                 }
                             } // if (!useColorspaces || (!srcLut && !dstLut)) {
@@ -0,0 +1,440 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ImageHalveKernels.h"
+
+#include <cassert>
+
+#ifdef NATRON_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef NATRON_SIMD_AVX2
+#include <immintrin.h>
+#endif
+
+/*
+ * Each kernel processes as many pixels as its vectors hold and leaves the remaining pixels of the row
+ * to the narrower kernel (AVX2 -> SSE2 -> scalar).
+ *
+ * Bit-exactness with Image::halveRoIForDepth:
+ * - 8 and 16 bits: (a + b + c + d) / 4 on non-negative integers is (a + b + c + d) >> 2, whatever the order
+ * of the additions. 16 bits sums do not fit in 16 bits and are done on 32 bits.
+ * - float: the sum is done in the same order, ((a + b) + c) + d, a being the top-left pixel, b the top-right,
+ * c the bottom-left and d the bottom-right. Multiplying by 0.25 is exact, hence the same as dividing by 4.
+ *
+ * The kernels for 3 components write one component past the last pixel of each iteration: it is the first
+ * component of the next pixel, which is written by the next iteration or by the scalar code.
+ */
+
+NATRON_NAMESPACE_ENTER
+
+namespace {
+template <typename PIX>
+void
+halveRowScalar(int nComps,
+               const PIX* srcRow0,
+               const PIX* srcRow1,
+               PIX* dstRow,
+               int x1,
+               int x2)
+{
+    for (int x = x1; x < x2; ++x) {
+        const PIX* s0 = srcRow0 + x * 2 * nComps;
+        const PIX* s1 = srcRow1 + x * 2 * nComps;
+        PIX* d = dstRow + x * nComps;
+        for (int k = 0; k < nComps; ++k) {
+            const PIX a = s0[k];
+            const PIX b = s0[k + nComps];
+            const PIX c = s1[k];
+            const PIX e = s1[k + nComps];
+
+            d[k] = (a + b + c + e) / 4;
+        }
+    }
+}
+
+#ifdef NATRON_SIMD_SSE2
+
+void
+halveRowFloatSSE2(int nComps,
+                  const float* srcRow0,
+                  const float* srcRow1,
+                  float* dstRow,
+                  int n)
+{
+    const __m128 quarter = _mm_set1_ps(0.25f);
+    int x = 0;
+
+    if (nComps == 1) {
+        for (; x + 4 <= n; x += 4) {
+            const __m128 v0 = _mm_loadu_ps(srcRow0 + 2 * x);
+            const __m128 v1 = _mm_loadu_ps(srcRow0 + 2 * x + 4);
+            const __m128 w0 = _mm_loadu_ps(srcRow1 + 2 * x);
+            const __m128 w1 = _mm_loadu_ps(srcRow1 + 2 * x + 4);
+            const __m128 a = _mm_shuffle_ps( v0, v1, _MM_SHUFFLE(2, 0, 2, 0) );
+            const __m128 b = _mm_shuffle_ps( v0, v1, _MM_SHUFFLE(3, 1, 3, 1) );
+            const __m128 c = _mm_shuffle_ps( w0, w1, _MM_SHUFFLE(2, 0, 2, 0) );
+            const __m128 d = _mm_shuffle_ps( w0, w1, _MM_SHUFFLE(3, 1, 3, 1) );
+            const __m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(a, b), c), d);
+            _mm_storeu_ps( dstRow + x, _mm_mul_ps(sum, quarter) );
+        }
+    } else if (nComps == 4) {
+        for (; x < n; ++x) {
+            const __m128 a = _mm_loadu_ps(srcRow0 + 8 * x);
+            const __m128 b = _mm_loadu_ps(srcRow0 + 8 * x + 4);
+            const __m128 c = _mm_loadu_ps(srcRow1 + 8 * x);
+            const __m128 d = _mm_loadu_ps(srcRow1 + 8 * x + 4);
+            const __m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(a, b), c), d);
+            _mm_storeu_ps( dstRow + 4 * x, _mm_mul_ps(sum, quarter) );
+        }
+    } else if (nComps == 3) {
+        // b and d read the first component of the next block: the last pixel is left to the scalar code
+        for (; x + 1 < n; ++x) {
+            const __m128 a = _mm_loadu_ps(srcRow0 + 6 * x);
+            const __m128 b = _mm_loadu_ps(srcRow0 + 6 * x + 3);
+            const __m128 c = _mm_loadu_ps(srcRow1 + 6 * x);
+            const __m128 d = _mm_loadu_ps(srcRow1 + 6 * x + 3);
+            const __m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(a, b), c), d);
+            _mm_storeu_ps( dstRow + 3 * x, _mm_mul_ps(sum, quarter) );
+        }
+    }
+    halveRowScalar<float>(nComps, srcRow0, srcRow1, dstRow, x, n);
+}
+
+void
+halveRowByteSSE2(int nComps,
+                 const unsigned char* srcRow0,
+                 const unsigned char* srcRow1,
+                 unsigned char* dstRow,
+                 int n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+
+    if (nComps == 1) {
+        const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+        for (; x + 8 <= n; x += 8) {
+            const __m128i v = _mm_loadu_si128( (const __m128i*)(srcRow0 + 2 * x) );
+            const __m128i w = _mm_loadu_si128( (const __m128i*)(srcRow1 + 2 * x) );
+            // Each 16-bit lane holds a horizontal pair: add its 2 bytes
+            const __m128i top = _mm_add_epi16( _mm_and_si128(v, lowBytes), _mm_srli_epi16(v, 8) );
+            const __m128i bottom = _mm_add_epi16( _mm_and_si128(w, lowBytes), _mm_srli_epi16(w, 8) );
+            const __m128i avg = _mm_srli_epi16(_mm_add_epi16(top, bottom), 2);
+            _mm_storel_epi64( (__m128i*)(dstRow + x), _mm_packus_epi16(avg, avg) );
+        }
+    } else if (nComps == 4) {
+        for (; x + 2 <= n; x += 2) {
+            const __m128i v = _mm_loadu_si128( (const __m128i*)(srcRow0 + 8 * x) );
+            const __m128i w = _mm_loadu_si128( (const __m128i*)(srcRow1 + 8 * x) );
+            // lo: source pixels 0 and 1 of both rows, hi: source pixels 2 and 3
+            __m128i lo = _mm_add_epi16( _mm_unpacklo_epi8(v, zero), _mm_unpacklo_epi8(w, zero) );
+            __m128i hi = _mm_add_epi16( _mm_unpackhi_epi8(v, zero), _mm_unpackhi_epi8(w, zero) );
+            lo = _mm_add_epi16( lo, _mm_srli_si128(lo, 8) );
+            hi = _mm_add_epi16( hi, _mm_srli_si128(hi, 8) );
+            const __m128i avg = _mm_srli_epi16(_mm_unpacklo_epi64(lo, hi), 2);
+            _mm_storel_epi64( (__m128i*)(dstRow + 4 * x), _mm_packus_epi16(avg, avg) );
+        }
+    } else if (nComps == 3) {
+        // Each iteration reads 2 bytes of the block after the 2 pixels it writes and writes
+        // 2 bytes of the pixel after them
+        const __m128i firstPixel = _mm_set_epi16(0, 0, 0, 0, 0, -1, -1, -1);
+        for (; x + 2 < n; x += 2) {
+            __m128i p0 = _mm_add_epi16( _mm_unpacklo_epi8(_mm_loadl_epi64( (const __m128i*)(srcRow0 + 6 * x) ), zero),
+                                        _mm_unpacklo_epi8(_mm_loadl_epi64( (const __m128i*)(srcRow1 + 6 * x) ), zero) );
+            __m128i p1 = _mm_add_epi16( _mm_unpacklo_epi8(_mm_loadl_epi64( (const __m128i*)(srcRow0 + 6 * x + 6) ), zero),
+                                        _mm_unpacklo_epi8(_mm_loadl_epi64( (const __m128i*)(srcRow1 + 6 * x + 6) ), zero) );
+            p0 = _mm_add_epi16( p0, _mm_srli_si128(p0, 6) );
+            p1 = _mm_add_epi16( p1, _mm_srli_si128(p1, 6) );
+            const __m128i sum = _mm_or_si128( _mm_and_si128(p0, firstPixel), _mm_slli_si128(p1, 6) );
+            const __m128i avg = _mm_srli_epi16(sum, 2);
+            _mm_storel_epi64( (__m128i*)(dstRow + 3 * x), _mm_packus_epi16(avg, avg) );
+        }
+    }
+    halveRowScalar<unsigned char>(nComps, srcRow0, srcRow1, dstRow, x, n);
+}
+
+// Packs 32-bit lanes holding values in [0, 65535] to 16-bit lanes: SSE2 only has a signed saturating pack
+inline __m128i
+packUnsigned32To16SSE2(__m128i lo,
+                       __m128i hi)
+{
+    const __m128i bias32 = _mm_set1_epi32(32768);
+    const __m128i bias16 = _mm_set1_epi16( (short)0x8000 );
+
+    return _mm_add_epi16( _mm_packs_epi32( _mm_sub_epi32(lo, bias32), _mm_sub_epi32(hi, bias32) ), bias16 );
+}
+
+void
+halveRowShortSSE2(int nComps,
+                  const unsigned short* srcRow0,
+                  const unsigned short* srcRow1,
+                  unsigned short* dstRow,
+                  int n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+
+    if (nComps == 1) {
+        const __m128i lowShorts = _mm_set1_epi32(0xFFFF);
+        for (; x + 8 <= n; x += 8) {
+            __m128i sums[2];
+            for (int i = 0; i < 2; ++i) {
+                const __m128i v = _mm_loadu_si128( (const __m128i*)(srcRow0 + 2 * x + 8 * i) );
+                const __m128i w = _mm_loadu_si128( (const __m128i*)(srcRow1 + 2 * x + 8 * i) );
+                // Each 32-bit lane holds a horizontal pair: add its 2 shorts
+                const __m128i top = _mm_add_epi32( _mm_and_si128(v, lowShorts), _mm_srli_epi32(v, 16) );
+                const __m128i bottom = _mm_add_epi32( _mm_and_si128(w, lowShorts), _mm_srli_epi32(w, 16) );
+                sums[i] = _mm_srli_epi32(_mm_add_epi32(top, bottom), 2);
+            }
+            _mm_storeu_si128( (__m128i*)(dstRow + x), packUnsigned32To16SSE2(sums[0], sums[1]) );
+        }
+    } else if (nComps == 4) {
+        for (; x + 2 <= n; x += 2) {
+            __m128i sums[2];
+            for (int i = 0; i < 2; ++i) {
+                const __m128i v = _mm_loadu_si128( (const __m128i*)(srcRow0 + 8 * x + 8 * i) );
+                const __m128i w = _mm_loadu_si128( (const __m128i*)(srcRow1 + 8 * x + 8 * i) );
+                const __m128i top = _mm_add_epi32( _mm_unpacklo_epi16(v, zero), _mm_unpackhi_epi16(v, zero) );
+                const __m128i bottom = _mm_add_epi32( _mm_unpacklo_epi16(w, zero), _mm_unpackhi_epi16(w, zero) );
+                sums[i] = _mm_srli_epi32(_mm_add_epi32(top, bottom), 2);
+            }
+            _mm_storeu_si128( (__m128i*)(dstRow + 4 * x), packUnsigned32To16SSE2(sums[0], sums[1]) );
+        }
+    } else if (nComps == 3) {
+        // b and d read the first component of the next block: the last pixel is left to the scalar code
+        for (; x + 1 < n; ++x) {
+            const __m128i a = _mm_unpacklo_epi16(_mm_loadl_epi64( (const __m128i*)(srcRow0 + 6 * x) ), zero);
+            const __m128i b = _mm_unpacklo_epi16(_mm_loadl_epi64( (const __m128i*)(srcRow0 + 6 * x + 3) ), zero);
+            const __m128i c = _mm_unpacklo_epi16(_mm_loadl_epi64( (const __m128i*)(srcRow1 + 6 * x) ), zero);
+            const __m128i d = _mm_unpacklo_epi16(_mm_loadl_epi64( (const __m128i*)(srcRow1 + 6 * x + 3) ), zero);
+            const __m128i avg = _mm_srli_epi32(_mm_add_epi32( _mm_add_epi32(a, b), _mm_add_epi32(c, d) ), 2);
+            _mm_storel_epi64( (__m128i*)(dstRow + 3 * x), packUnsigned32To16SSE2(avg, avg) );
+        }
+    }
+    halveRowScalar<unsigned short>(nComps, srcRow0, srcRow1, dstRow, x, n);
+}
+
+#endif // NATRON_SIMD_SSE2
+
+#ifdef NATRON_SIMD_AVX2
+
+// The AVX2 kernels handle 1 and 4 components, 3 components are done by the SSE2 kernels
+
+NATRON_SIMD_TARGET_AVX2
+void
+halveRowFloatAVX2(int nComps,
+                  const float* srcRow0,
+                  const float* srcRow1,
+                  float* dstRow,
+                  int n)
+{
+    const __m256 quarter = _mm256_set1_ps(0.25f);
+    int x = 0;
+
+    if (nComps == 1) {
+        for (; x + 8 <= n; x += 8) {
+            const __m256 v0 = _mm256_loadu_ps(srcRow0 + 2 * x);
+            const __m256 v1 = _mm256_loadu_ps(srcRow0 + 2 * x + 8);
+            const __m256 w0 = _mm256_loadu_ps(srcRow1 + 2 * x);
+            const __m256 w1 = _mm256_loadu_ps(srcRow1 + 2 * x + 8);
+            // The shuffles work within 128-bit lanes: the outputs are in the order 0 1 4 5 2 3 6 7
+            const __m256 a = _mm256_shuffle_ps( v0, v1, _MM_SHUFFLE(2, 0, 2, 0) );
+            const __m256 b = _mm256_shuffle_ps( v0, v1, _MM_SHUFFLE(3, 1, 3, 1) );
+            const __m256 c = _mm256_shuffle_ps( w0, w1, _MM_SHUFFLE(2, 0, 2, 0) );
+            const __m256 d = _mm256_shuffle_ps( w0, w1, _MM_SHUFFLE(3, 1, 3, 1) );
+            const __m256 avg = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(a, b), c), d), quarter);
+            const __m256d ordered = _mm256_permute4x64_pd( _mm256_castps_pd(avg), _MM_SHUFFLE(3, 1, 2, 0) );
+            _mm256_storeu_ps( dstRow + x, _mm256_castpd_ps(ordered) );
+        }
+    } else {
+        assert(nComps == 4);
+        for (; x + 2 <= n; x += 2) {
+            const __m256 v0 = _mm256_loadu_ps(srcRow0 + 8 * x);
+            const __m256 v1 = _mm256_loadu_ps(srcRow0 + 8 * x + 8);
+            const __m256 w0 = _mm256_loadu_ps(srcRow1 + 8 * x);
+            const __m256 w1 = _mm256_loadu_ps(srcRow1 + 8 * x + 8);
+            const __m256 a = _mm256_permute2f128_ps(v0, v1, 0x20);
+            const __m256 b = _mm256_permute2f128_ps(v0, v1, 0x31);
+            const __m256 c = _mm256_permute2f128_ps(w0, w1, 0x20);
+            const __m256 d = _mm256_permute2f128_ps(w0, w1, 0x31);
+            const __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(a, b), c), d);
+            _mm256_storeu_ps( dstRow + 4 * x, _mm256_mul_ps(sum, quarter) );
+        }
+    }
+    halveRowFloatSSE2(nComps, srcRow0 + 2 * x * nComps, srcRow1 + 2 * x * nComps, dstRow + x * nComps, n - x);
+}
+
+NATRON_SIMD_TARGET_AVX2
+void
+halveRowByteAVX2(int nComps,
+                 const unsigned char* srcRow0,
+                 const unsigned char* srcRow1,
+                 unsigned char* dstRow,
+                 int n)
+{
+    int x = 0;
+
+    if (nComps == 1) {
+        const __m256i lowBytes = _mm256_set1_epi16(0x00FF);
+        for (; x + 16 <= n; x += 16) {
+            const __m256i v = _mm256_loadu_si256( (const __m256i*)(srcRow0 + 2 * x) );
+            const __m256i w = _mm256_loadu_si256( (const __m256i*)(srcRow1 + 2 * x) );
+            const __m256i top = _mm256_add_epi16( _mm256_and_si256(v, lowBytes), _mm256_srli_epi16(v, 8) );
+            const __m256i bottom = _mm256_add_epi16( _mm256_and_si256(w, lowBytes), _mm256_srli_epi16(w, 8) );
+            const __m256i avg = _mm256_srli_epi16(_mm256_add_epi16(top, bottom), 2);
+            // The pack works within 128-bit lanes: gather the 64-bit halves holding the results
+            const __m256i packed = _mm256_permute4x64_epi64( _mm256_packus_epi16(avg, avg), _MM_SHUFFLE(3, 1, 2, 0) );
+            _mm_storeu_si128( (__m128i*)(dstRow + x), _mm256_castsi256_si128(packed) );
+        }
+    } else {
+        assert(nComps == 4);
+        for (; x + 4 <= n; x += 4) {
+            // Source pixels 0-3 and 4-7 of both rows, one 16-bit lane per component
+            __m256i p03 = _mm256_add_epi16( _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i*)(srcRow0 + 8 * x) ) ),
+                                            _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i*)(srcRow1 + 8 * x) ) ) );
+            __m256i p47 = _mm256_add_epi16( _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i*)(srcRow0 + 8 * x + 16) ) ),
+                                            _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i*)(srcRow1 + 8 * x + 16) ) ) );
+            // Each 64-bit block is a pixel: reorder to 0 2 1 3 and 4 6 5 7, then split even and odd pixels
+            p03 = _mm256_permute4x64_epi64( p03, _MM_SHUFFLE(3, 1, 2, 0) );
+            p47 = _mm256_permute4x64_epi64( p47, _MM_SHUFFLE(3, 1, 2, 0) );
+            const __m256i even = _mm256_permute2x128_si256(p03, p47, 0x20);
+            const __m256i odd = _mm256_permute2x128_si256(p03, p47, 0x31);
+            const __m256i avg = _mm256_srli_epi16(_mm256_add_epi16(even, odd), 2);
+            const __m256i packed = _mm256_permute4x64_epi64( _mm256_packus_epi16(avg, avg), _MM_SHUFFLE(3, 1, 2, 0) );
+            _mm_storeu_si128( (__m128i*)(dstRow + 4 * x), _mm256_castsi256_si128(packed) );
+        }
+    }
+    halveRowByteSSE2(nComps, srcRow0 + 2 * x * nComps, srcRow1 + 2 * x * nComps, dstRow + x * nComps, n - x);
+}
+
+NATRON_SIMD_TARGET_AVX2
+void
+halveRowShortAVX2(int nComps,
+                  const unsigned short* srcRow0,
+                  const unsigned short* srcRow1,
+                  unsigned short* dstRow,
+                  int n)
+{
+    const __m256i bias32 = _mm256_set1_epi32(32768);
+    const __m256i bias16 = _mm256_set1_epi16( (short)0x8000 );
+    int x = 0;
+
+    if (nComps == 1) {
+        const __m256i lowShorts = _mm256_set1_epi32(0xFFFF);
+        for (; x + 8 <= n; x += 8) {
+            const __m256i v = _mm256_loadu_si256( (const __m256i*)(srcRow0 + 2 * x) );
+            const __m256i w = _mm256_loadu_si256( (const __m256i*)(srcRow1 + 2 * x) );
+            const __m256i top = _mm256_add_epi32( _mm256_and_si256(v, lowShorts), _mm256_srli_epi32(v, 16) );
+            const __m256i bottom = _mm256_add_epi32( _mm256_and_si256(w, lowShorts), _mm256_srli_epi32(w, 16) );
+            const __m256i avg = _mm256_sub_epi32(_mm256_srli_epi32(_mm256_add_epi32(top, bottom), 2), bias32);
+            const __m256i packed = _mm256_permute4x64_epi64( _mm256_packs_epi32(avg, avg), _MM_SHUFFLE(3, 1, 2, 0) );
+            _mm_storeu_si128( (__m128i*)(dstRow + x), _mm256_castsi256_si128( _mm256_add_epi16(packed, bias16) ) );
+        }
+    } else {
+        assert(nComps == 4);
+        for (; x + 2 <= n; x += 2) {
+            // Source pixels 0-1 and 2-3 of both rows, one 32-bit lane per component
+            const __m256i p01 = _mm256_add_epi32( _mm256_cvtepu16_epi32( _mm_loadu_si128( (const __m128i*)(srcRow0 + 8 * x) ) ),
+                                                  _mm256_cvtepu16_epi32( _mm_loadu_si128( (const __m128i*)(srcRow1 + 8 * x) ) ) );
+            const __m256i p23 = _mm256_add_epi32( _mm256_cvtepu16_epi32( _mm_loadu_si128( (const __m128i*)(srcRow0 + 8 * x + 8) ) ),
+                                                  _mm256_cvtepu16_epi32( _mm_loadu_si128( (const __m128i*)(srcRow1 + 8 * x + 8) ) ) );
+            const __m256i even = _mm256_permute2x128_si256(p01, p23, 0x20);
+            const __m256i odd = _mm256_permute2x128_si256(p01, p23, 0x31);
+            const __m256i avg = _mm256_sub_epi32(_mm256_srli_epi32(_mm256_add_epi32(even, odd), 2), bias32);
+            const __m256i packed = _mm256_permute4x64_epi64( _mm256_packs_epi32(avg, avg), _MM_SHUFFLE(3, 1, 2, 0) );
+            _mm_storeu_si128( (__m128i*)(dstRow + 4 * x), _mm256_castsi256_si128( _mm256_add_epi16(packed, bias16) ) );
+        }
+    }
+    halveRowShortSSE2(nComps, srcRow0 + 2 * x * nComps, srcRow1 + 2 * x * nComps, dstRow + x * nComps, n - x);
+}
+
+#endif // NATRON_SIMD_AVX2
+} // anon namespace
+
+bool
+halveImageRow(ImageBitDepthEnum depth,
+              int nComps,
+              const void* srcRow0,
+              const void* srcRow1,
+              void* dstRow,
+              int nDstPixels,
+              SIMDLevelEnum level)
+{
+    if ( (level == eSIMDLevelNone) || ( (nComps != 1) && (nComps != 3) && (nComps != 4) ) ) {
+        return false;
+    }
+#ifdef NATRON_SIMD_SSE2
+#ifdef NATRON_SIMD_AVX2
+    const bool useAVX2 = (level == eSIMDLevelAVX2) && (nComps != 3);
+#endif
+    switch (depth) {
+    case eImageBitDepthByte:
+#ifdef NATRON_SIMD_AVX2
+        if (useAVX2) {
+            halveRowByteAVX2(nComps, (const unsigned char*)srcRow0, (const unsigned char*)srcRow1, (unsigned char*)dstRow, nDstPixels);
+
+            return true;
+        }
+#endif
+        halveRowByteSSE2(nComps, (const unsigned char*)srcRow0, (const unsigned char*)srcRow1, (unsigned char*)dstRow, nDstPixels);
+
+        return true;
+    case eImageBitDepthShort:
+#ifdef NATRON_SIMD_AVX2
+        if (useAVX2) {
+            halveRowShortAVX2(nComps, (const unsigned short*)srcRow0, (const unsigned short*)srcRow1, (unsigned short*)dstRow, nDstPixels);
+
+            return true;
+        }
+#endif
+        halveRowShortSSE2(nComps, (const unsigned short*)srcRow0, (const unsigned short*)srcRow1, (unsigned short*)dstRow, nDstPixels);
+
+        return true;
+    case eImageBitDepthFloat:
+#ifdef NATRON_SIMD_AVX2
+        if (useAVX2) {
+            halveRowFloatAVX2(nComps, (const float*)srcRow0, (const float*)srcRow1, (float*)dstRow, nDstPixels);
+
+            return true;
+        }
+#endif
+        halveRowFloatSSE2(nComps, (const float*)srcRow0, (const float*)srcRow1, (float*)dstRow, nDstPixels);
+
+        return true;
+    case eImageBitDepthHalf:
+    case eImageBitDepthNone:
+        break;
+    }
+#else
+    Q_UNUSED(depth);
+    Q_UNUSED(srcRow0);
+    Q_UNUSED(srcRow1);
+    Q_UNUSED(dstRow);
+    Q_UNUSED(nDstPixels);
+#endif // NATRON_SIMD_SSE2
+
+    return false;
+}
+
+NATRON_NAMESPACE_EXIT
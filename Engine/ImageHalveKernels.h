@@ -0,0 +1,56 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_IMAGEHALVEKERNELS_H
+#define NATRON_ENGINE_IMAGEHALVEKERNELS_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include "Global/Enums.h"
+
+#include "Engine/CPUFeatures.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Box-filters one row of the next mipmap level: each of the nDstPixels destination pixels is the
+ * average of the 2x2 block of source pixels below it, taken on the rows srcRow0 and srcRow1.
+ * The result is bit-exact with Image::halveRoI(): integer averages are truncated and float sums
+ * are done in the same order.
+ * Pixels are packed with nComps components of the type matching depth.
+ * All the source pixels must be readable: this only handles blocks that lie within the source bounds.
+ * Returns false if there is no SIMD kernel for this level, depth and number of components, in which case
+ * nothing was written.
+ **/
+bool halveImageRow(ImageBitDepthEnum depth,
+                   int nComps,
+                   const void* srcRow0,
+                   const void* srcRow1,
+                   void* dstRow,
+                   int nDstPixels,
+                   SIMDLevelEnum level);
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_IMAGEHALVEKERNELS_H
@@ -49,6 +49,7 @@
 #include "Engine/KnobSerialization.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/LibraryBinary.h"
+#include "Engine/NativeExpression.h"
 #include "Engine/Node.h"
 #include "Engine/Project.h"
 #include "Engine/StringAnimationManager.h"
@@ -225,10 +226,13 @@ struct Expr
     ///The list of pair<knob, dimension> dpendencies for an expression
     std::list<std::pair<KnobIWPtr, int> > dependencies;
 
+    ///The expression compiled to native code, if it could be
+    NativeExpressionPtr native;
+
     //PyObject* code;
 
     Expr()
-        : expression(), originalExpression(), exprInvalid(), hasRet(false) /*, code(0)*/ {}
+        : expression(), originalExpression(), exprInvalid(), hasRet(false), native() /*, code(0)*/ {}
 };
 
 struct KnobHelperPrivate
@@ -2665,10 +2669,17 @@ KnobHelper::setExpressionInternal(int dimension,
         }
     }
 
+    ///Single-line expressions using only numbers and parameters do not need Python to be evaluated
+    NativeExpressionPtr native;
+    if ( exprInvalid.empty() && !hasRetVariable && !dynamic_cast<KnobStringBase*>(this) ) {
+        native = NativeExpression::compile( expression, shared_from_this(), dimension );
+    }
+
     //Set internal fields
 
     {
         QMutexLocker k(&_imp->expressionMutex);
+        _imp->expressions[dimension].native = native;
         _imp->expressions[dimension].hasRet = hasRetVariable;
         _imp->expressions[dimension].expression = exprCpy;
         _imp->expressions[dimension].originalExpression = expression;
@@ -2738,6 +2749,35 @@ KnobHelper::isExpressionUsingRetVariable(int dimension) const
     return _imp->expressions[dimension].hasRet;
 }
 
+bool
+KnobHelper::isExpressionNative(int dimension) const
+{
+    QMutexLocker k(&_imp->expressionMutex);
+
+    return _imp->expressions[dimension].native.get() != 0;
+}
+
+bool
+KnobHelper::evaluateNativeExpression(double time,
+                                     ViewIdx view,
+                                     int dimension,
+                                     double* ret) const
+{
+    NativeExpressionPtr native;
+    {
+        QMutexLocker k(&_imp->expressionMutex);
+        native = _imp->expressions[dimension].native;
+    }
+    if (!native) {
+        return false;
+    }
+
+    ///As for Python expressions, the parameters read by the expression must not evaluate the expression of this one again
+    EXPR_RECURSION_LEVEL();
+
+    return native->evaluate(time, view, ret);
+}
+
 bool
 KnobHelper::getExpressionDependencies(int dimension,
                                       std::list<std::pair<KnobIWPtr, int> >& dependencies) const
@@ -2765,6 +2805,7 @@ KnobHelper::clearExpression(int dimension,
         _imp->expressions[dimension].expression.clear();
         _imp->expressions[dimension].originalExpression.clear();
         _imp->expressions[dimension].exprInvalid.clear();
+        _imp->expressions[dimension].native.reset();
         //Py_XDECREF(_imp->expressions[dimension].code); //< new ref
         //_imp->expressions[dimension].code = 0;
     }
@@ -558,6 +558,14 @@ public:
      **/
     virtual double getValueAtWithExpression(double time, ViewSpec view, int dimension) = 0;
 
+    /**
+     * @brief Copies the static value and the animation of the given dimension, for the KnobsSnapshot of a render.
+     * curve and animation are NULL if the dimension has no keyframe.
+     * @returns False if the dimension cannot be copied: it is driven by an expression or a master knob,
+     * or the knob does not hold a PoD.
+     **/
+    virtual bool getValueSnapshot(int dimension, double* value, CurvePtr* curve, CurveSnapshotPtr* animation) = 0;
+
 protected:
 
 
@@ -1454,11 +1462,29 @@ protected:
     template <typename T>
     static T pyObjectToType(PyObject* o);
 
+    /**
+     * @brief Converts the result of a NativeExpression like pyObjectToType converts the result of the Python expression
+     **/
+    template <typename T>
+    static T nativeExpressionResultToType(double value);
+
+    /**
+     * @brief If the expression of the given dimension was compiled to a NativeExpression, evaluates it without Python.
+     * Recursive evaluations of the expression are prevented the same way as for Python expressions.
+     * @returns False if the expression must be run by Python.
+     **/
+    bool evaluateNativeExpression(double time, ViewIdx view, int dimension, double* ret) const WARN_UNUSED_RETURN;
+
     virtual void refreshListenersAfterValueChange(ViewSpec view, ValueChangedReasonEnum reason, int dimension) OVERRIDE FINAL;
 
 public:
 
     virtual bool isExpressionUsingRetVariable(int dimension = 0) const OVERRIDE FINAL WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Returns true if the expression of the given dimension is evaluated natively, without Python.
+     **/
+    bool isExpressionNative(int dimension = 0) const WARN_UNUSED_RETURN;
     virtual bool getExpressionDependencies(int dimension, std::list<std::pair<KnobIWPtr, int> >& dependencies) const OVERRIDE FINAL;
     virtual std::string getExpression(int dimension) const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual const std::vector<boost::shared_ptr<Curve>  > & getCurves() const OVERRIDE FINAL WARN_UNUSED_RETURN;
@@ -1795,6 +1821,7 @@ public:
 
     virtual double getRawCurveValueAt(double time, ViewSpec view,  int dimension)  OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual double getValueAtWithExpression(double time, ViewSpec view, int dimension)  OVERRIDE FINAL WARN_UNUSED_RETURN;
+    virtual bool getValueSnapshot(int dimension, double* value, CurvePtr* curve, CurveSnapshotPtr* animation) OVERRIDE FINAL WARN_UNUSED_RETURN;
 
 private:
 
@@ -2065,6 +2092,11 @@ public:
 
     bool getValueFromCurve(double time, ViewSpec view, int dimension, bool useGuiCurve, bool byPassMaster, bool clamp, T* ret);
 
+    /**
+     * @brief Reads the value from the KnobsSnapshot of the frame being rendered by this thread, if any.
+     **/
+    bool getValueFromKnobsSnapshot(double time, int dimension, bool clamp, T* ret);
+
 protected:
 
     virtual void resetExtraToDefaultValue(int /*dimension*/) {}
@@ -2643,6 +2675,15 @@ public:
         return ViewIdx(0);
     }
 
+    /**
+     * @brief Returns the copy of the knobs values taken when the render of the current frame started
+     * in this thread, or NULL if this thread is not rendering.
+     **/
+    virtual KnobsSnapshotPtr getKnobsSnapshotTLS() const
+    {
+        return KnobsSnapshotPtr();
+    }
+
     int getPageIndex(const KnobPage* page) const;
 
 
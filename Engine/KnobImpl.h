@@ -56,6 +56,7 @@ GCC_DIAG_ON(unused-parameter)
 #include "Engine/Project.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/KnobTypes.h"
+#include "Engine/KnobsSnapshot.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/EngineFwd.h"
 
@@ -387,6 +388,37 @@ KnobHelper::pyObjectToType(PyObject* o)
     return std::string( PyString_AsString(o) );
 }
 
+template <>
+int
+KnobHelper::nativeExpressionResultToType(double value)
+{
+    return (int)value;
+}
+
+template <>
+bool
+KnobHelper::nativeExpressionResultToType(double value)
+{
+    return value != 0.;
+}
+
+template <>
+double
+KnobHelper::nativeExpressionResultToType(double value)
+{
+    return value;
+}
+
+template <>
+std::string
+KnobHelper::nativeExpressionResultToType(double /*value*/)
+{
+    // Expressions of string parameters are never compiled
+    assert(false);
+
+    return std::string();
+}
+
 inline unsigned int
 hashFunction(unsigned int a)
 {
@@ -427,6 +459,14 @@ Knob<T>::evaluateExpression(double time,
                             T* value,
                             std::string* error)
 {
+    double nativeRet;
+
+    if ( evaluateNativeExpression(time, view, dimension, &nativeRet) ) {
+        *value = nativeExpressionResultToType<T>(nativeRet);
+
+        return true;
+    }
+
     PythonGILLocker pgl;
     PyObject *ret;
 
@@ -449,6 +489,10 @@ Knob<T>::evaluateExpression_pod(double time,
                                 double* value,
                                 std::string* error)
 {
+    if ( evaluateNativeExpression(time, view, dimension, value) ) {
+        return true;
+    }
+
     PythonGILLocker pgl;
     PyObject *ret;
 
@@ -693,6 +737,85 @@ Knob<T>::getValueFromMaster(ViewSpec view,
     return T();
 }
 
+template <typename T>
+bool
+Knob<T>::getValueFromKnobsSnapshot(double time,
+                                   int dimension,
+                                   bool clamp,
+                                   T* ret)
+{
+    KnobHolder* holder = getHolder();
+
+    if (!holder) {
+        return false;
+    }
+    KnobsSnapshotPtr snapshot = holder->getKnobsSnapshotTLS();
+    if (!snapshot) {
+        return false;
+    }
+    const KnobsSnapshot::DimensionValue* value = snapshot->getValue(this, dimension);
+    if (!value) {
+        return false;
+    }
+    if (value->animation) {
+        //getValueAt already clamps to the range for us
+        *ret = (T)value->curve->getValueAt(*value->animation, time, clamp);
+    } else if (clamp) {
+        *ret = clampToMinMax( (T)value->value, dimension );
+    } else {
+        *ret = (T)value->value;
+    }
+
+    return true;
+}
+
+template <>
+bool
+KnobStringBase::getValueFromKnobsSnapshot(double /*time*/,
+                                          int /*dimension*/,
+                                          bool /*clamp*/,
+                                          std::string* /*ret*/)
+{
+    // String knobs are not copied in the snapshot
+    return false;
+}
+
+template <typename T>
+bool
+Knob<T>::getValueSnapshot(int dimension,
+                          double* value,
+                          CurvePtr* curve,
+                          CurveSnapshotPtr* animation)
+{
+    if ( ( dimension >= (int)_values.size() ) || (dimension < 0) ) {
+        return false;
+    }
+    if ( !getExpression(dimension).empty() || getMaster(dimension).second ) {
+        return false;
+    }
+
+    *curve = getCurve(ViewIdx(0), dimension, true);
+    *animation = *curve ? (*curve)->getAnimationSnapshot() : CurveSnapshotPtr();
+    if (!*animation) {
+        curve->reset();
+    }
+
+    QMutexLocker l(&_valueMutex);
+    *value = (double)_values[dimension];
+
+    return true;
+}
+
+template <>
+bool
+KnobStringBase::getValueSnapshot(int /*dimension*/,
+                                 double* /*value*/,
+                                 CurvePtr* /*curve*/,
+                                 CurveSnapshotPtr* /*animation*/)
+{
+    return false;
+}
+
 template <typename T>
 T
 Knob<T>::getValue(int dimension,
@@ -721,6 +844,13 @@ Knob<T>::getValue(int dimension,
         }
     }
 
+    if (!useGuiValues) {
+        T ret;
+        if ( getValueFromKnobsSnapshot(getCurrentTime(), dimension, clamp, &ret) ) {
+            return ret;
+        }
+    }
+
     if ( isAnimated(dimension, view) ) {
         return getValueAtTime(getCurrentTime(), dimension, view, clamp);
     }
@@ -840,6 +970,13 @@ Knob<T>::getValueAtTime(double time,
         }
     }
 
+    if (!useGuiValues) {
+        T ret;
+        if ( getValueFromKnobsSnapshot(time, dimension, clamp, &ret) ) {
+            return ret;
+        }
+    }
+
     ///if the knob is slaved to another knob, returns the other knob value
     std::pair<int, KnobIPtr> master = getMaster(dimension);
     if (!byPassMaster && master.second) {
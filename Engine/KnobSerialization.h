@@ -952,6 +952,16 @@ public:
     static KnobIPtr createKnob(const std::string & typeName, int dimension);
     const TypeExtraData* getExtraData() const { return _extraData; }
 
+    const std::list<MasterSerialization>& getMasters() const
+    {
+        return _masters;
+    }
+
+    const std::vector<std::pair<std::string, bool> >& getExpressions() const
+    {
+        return _expressions;
+    }
+
     bool isPersistent() const
     {
         return _isPersistent;
@@ -0,0 +1,59 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "KnobsSnapshot.h"
+
+#include "Engine/Knob.h"
+
+NATRON_NAMESPACE_ENTER
+
+KnobsSnapshot::KnobsSnapshot(const KnobHolder& holder)
+    : _values()
+{
+    const std::vector<KnobIPtr> knobs = holder.getKnobs_mt_safe();
+
+    for (std::vector<KnobIPtr>::const_iterator it = knobs.begin(); it != knobs.end(); ++it) {
+        if ( !(*it)->isTypePOD() ) {
+            continue;
+        }
+        int nDims = (*it)->getDimension();
+        for (int i = 0; i < nDims; ++i) {
+            DimensionValue v;
+            if ( (*it)->getValueSnapshot(i, &v.value, &v.curve, &v.animation) ) {
+                _values.insert( std::make_pair(std::make_pair(static_cast<const KnobI*>( it->get() ), i), v) );
+            }
+        }
+    }
+}
+
+const KnobsSnapshot::DimensionValue*
+KnobsSnapshot::getValue(const KnobI* knob,
+                        int dimension) const
+{
+    DimensionValueMap::const_iterator found = _values.find( std::make_pair(knob, dimension) );
+
+    return found == _values.end() ? 0 : &found->second;
+}
+
+NATRON_NAMESPACE_EXIT
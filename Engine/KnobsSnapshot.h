@@ -0,0 +1,83 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_KNOBSSNAPSHOT_H
+#define NATRON_ENGINE_KNOBSSNAPSHOT_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <map>
+#include <utility>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include "Engine/Curve.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief An immutable copy of the values and animation curves of the knobs of a holder, taken by the
+ * ParallelRenderArgsSetter when the render of a frame starts. The render threads read the knobs values
+ * from it (@see KnobHolder::getKnobsSnapshotTLS()) instead of locking each knob for every read, and all the
+ * reads of a frame render see the same values even if the user changes a parameter in the meantime.
+ *
+ * Dimensions driven by an expression or slaved to another knob, and string knobs, are not copied:
+ * they are read from the knob as usual.
+ **/
+class KnobsSnapshot
+{
+public:
+
+    struct DimensionValue
+    {
+        ///The static value of the knob, converted to a double
+        double value;
+
+        ///The animation curve of the knob, only set if it had keyframes, in which case value is not used
+        CurvePtr curve;
+
+        ///The keyframes of curve when the snapshot was taken
+        CurveSnapshotPtr animation;
+    };
+
+    explicit KnobsSnapshot(const KnobHolder& holder);
+
+    /**
+     * @brief Returns the copy of the given dimension of knob, or NULL if it was not copied.
+     **/
+    const DimensionValue* getValue(const KnobI* knob, int dimension) const WARN_UNUSED_RETURN;
+
+private:
+
+    typedef std::map<std::pair<const KnobI*, int>, DimensionValue> DimensionValueMap;
+
+    DimensionValueMap _values;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_KNOBSSNAPSHOT_H
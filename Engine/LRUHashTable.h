@@ -44,7 +44,10 @@
 
 #include <map>
 #include <list>
+#include <deque>
+#include <vector>
 #include <utility>
+#include <cassert>
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 CLANG_DIAG_OFF(unknown-pragmas)
 CLANG_DIAG_OFF(redeclared-class-member)
@@ -58,12 +61,15 @@ CLANG_DIAG_ON(unknown-pragmas)
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #endif
 
+#include "Global/GlobalDefines.h"
+
 #include "Engine/EngineFwd.h"
 
 
 //#define USE_VARIADIC_TEMPLATES
 #define NATRON_CACHE_USE_HASH
 #define NATRON_CACHE_USE_BOOST
+#define NATRON_CACHE_USE_INTRUSIVE_LRU
 
 
 /**@brief 4 types of LRU caches are defined here:
@@ -93,7 +99,529 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
  * defined otherwise it will not compile. (no std::unordered_map
  * support on c++98)
  *
+ * NATRON_CACHE_USE_INTRUSIVE_LRU : define this to use IntrusiveLRUHashTable
+ * for all caches, regardless of the defines above. It does not allocate
+ * on look-ups and recycles its nodes on insertion. It is the only container
+ * implementing the SLRU and cost-aware eviction policies (@see CacheEvictionPolicyEnum),
+ * the others always evict in LRU order.
+ *
+ **/
+
+/**
+ * @brief Default cost functor of IntrusiveLRUHashTable: all values cost the same, hence
+ * eCacheEvictionPolicyCostAware falls back to LRU.
+ **/
+struct IntrusiveLRUNoCost
+{
+    template <typename V>
+    double operator()(const V & /*value*/) const
+    {
+        return 0.;
+    }
+};
+
+/**
+ * @brief An LRU hash table whose records live in a pool of nodes. Each node carries
+ * its own LRU hook (indices of the previous and next node in the access order) and
+ * the index of the hash table is an open-addressing table of node indices.
+ *
+ * - A look-up hashes the key, probes the index and relinks the node at the
+ * most-recently-used end: it never allocates.
+ * - Removed nodes are put on a free list and keep the capacity of their values vector,
+ * so that inserting after the pool has warmed-up does not allocate either.
+ *
+ * The records are kept in 2 LRU lists (segments): probation and protected.
+ * Which record evict() returns depends on the eviction policy:
+ * - eCacheEvictionPolicyLRU: only the probation segment is used, this is a plain LRU.
+ * - eCacheEvictionPolicySLRU: a record looked-up again after its insertion is promoted
+ * to the protected segment. When evicting, the protected segment is first trimmed to
+ * NATRON_CACHE_SLRU_PROTECTED_PERCENT % of the records.
+ * Records are evicted from the probation segment first, so that a sequence of records used once
+ * (e.g: a playback) does not flush the records that are used over and over.
+ * - eCacheEvictionPolicyCostAware: among the NATRON_CACHE_COST_EVICTION_WINDOW least recently used
+ * evictable values, the one with the lowest COST is evicted.
+ *
+ * K must be an integral type (the caches use 64-bit hash keys).
+ * V must have a use_count() method, typically a shared_ptr.
+ * COST is a functor returning the cost (a double) of re-creating a value once evicted.
  **/
+template <typename K, typename V, typename COST = IntrusiveLRUNoCost>
+class IntrusiveLRUHashTable
+{
+public:
+
+    typedef K key_type;
+    // The values sharing the same key
+    typedef std::vector<V> value_type;
+
+    enum SegmentEnum
+    {
+        eSegmentProbation = 0,
+        eSegmentProtected,
+        eSegmentCount
+    };
+
+    struct Node
+    {
+        // Named first/second so that iterators can be used like std::map iterators
+        key_type first;
+        value_type second;
+
+        // LRU hook: -1 at the ends. For a free node, lruNext links the free list
+        int lruPrev;
+        int lruNext;
+        unsigned char segment;
+        bool used;
+
+        Node()
+            : first()
+            , second()
+            , lruPrev(-1)
+            , lruNext(-1)
+            , segment(eSegmentProbation)
+            , used(false)
+        {
+        }
+    };
+
+    /**
+     * @brief Iterates over the records from the least recently used to the most recently used,
+     * the probation segment first.
+     * Iterators are not invalidated by insertions, only by the erasure of the record they point to.
+     **/
+    class iterator
+    {
+        IntrusiveLRUHashTable* _table;
+        int _index;
+
+    public:
+
+        iterator()
+            : _table(0)
+            , _index(-1)
+        {
+        }
+
+        iterator(IntrusiveLRUHashTable* table,
+                 int index)
+            : _table(table)
+            , _index(index)
+        {
+        }
+
+        Node& operator*() const
+        {
+            return _table->_nodes[_index];
+        }
+
+        Node* operator->() const
+        {
+            return &_table->_nodes[_index];
+        }
+
+        iterator& operator++()
+        {
+            const Node& node = _table->_nodes[_index];
+
+            _index = node.lruNext;
+            if ( (_index == -1) && (node.segment == eSegmentProbation) ) {
+                _index = _table->_lruHead[eSegmentProtected];
+            }
+
+            return *this;
+        }
+
+        bool operator==(const iterator& other) const
+        {
+            return _index == other._index;
+        }
+
+        bool operator!=(const iterator& other) const
+        {
+            return _index != other._index;
+        }
+
+        int index() const
+        {
+            return _index;
+        }
+    };
+
+    IntrusiveLRUHashTable()
+        : _nodes()
+        , _index()
+        , _freeHead(-1)
+        , _size(0)
+        , _protectedSize(0)
+        , _policy(NATRON_NAMESPACE::eCacheEvictionPolicyLRU)
+    {
+        for (int i = 0; i < eSegmentCount; ++i) {
+            _lruHead[i] = _lruTail[i] = -1;
+        }
+    }
+
+    /**
+     * @brief Changes the policy used by evict(). When leaving the SLRU policy, the protected records
+     * are moved after the most recently used record of the probation segment.
+     **/
+    void setEvictionPolicy(NATRON_NAMESPACE::CacheEvictionPolicyEnum policy)
+    {
+        if ( (policy != NATRON_NAMESPACE::eCacheEvictionPolicySLRU) && (_lruHead[eSegmentProtected] != -1) ) {
+            for (int i = _lruHead[eSegmentProtected]; i != -1; i = _nodes[i].lruNext) {
+                _nodes[i].segment = eSegmentProbation;
+            }
+            if (_lruTail[eSegmentProbation] != -1) {
+                _nodes[_lruTail[eSegmentProbation]].lruNext = _lruHead[eSegmentProtected];
+                _nodes[_lruHead[eSegmentProtected]].lruPrev = _lruTail[eSegmentProbation];
+            } else {
+                _lruHead[eSegmentProbation] = _lruHead[eSegmentProtected];
+            }
+            _lruTail[eSegmentProbation] = _lruTail[eSegmentProtected];
+            _lruHead[eSegmentProtected] = _lruTail[eSegmentProtected] = -1;
+            _protectedSize = 0;
+        }
+        _policy = policy;
+    }
+
+    NATRON_NAMESPACE::CacheEvictionPolicyEnum getEvictionPolicy() const
+    {
+        return _policy;
+    }
+
+    // Obtain the record for k and mark it as the most recently used
+    iterator operator()(const key_type & k)
+    {
+        int slot = findSlot(k);
+
+        if (slot == -1) {
+            return end();
+        }
+        int nodeIndex = _index[slot];
+        Node& node = _nodes[nodeIndex];
+        if ( (_policy == NATRON_NAMESPACE::eCacheEvictionPolicySLRU) && (node.segment == eSegmentProbation) ) {
+            // Second access: promote to the protected segment
+            lruUnlink(nodeIndex);
+            node.segment = eSegmentProtected;
+            ++_protectedSize;
+            lruPushBack(nodeIndex);
+        } else if (nodeIndex != _lruTail[node.segment]) {
+            lruUnlink(nodeIndex);
+            lruPushBack(nodeIndex);
+        }
+
+        return iterator(this, nodeIndex);
+    }
+
+    // Obtain the record for k without changing its recency, for the internal book-keeping of the cache
+    iterator peek(const key_type & k)
+    {
+        int slot = findSlot(k);
+
+        return slot == -1 ? end() : iterator(this, _index[slot]);
+    }
+
+    void erase(iterator it)
+    {
+        assert( it.index() >= 0 && _nodes[it.index()].used );
+        eraseNode( it.index() );
+    }
+
+    iterator end()
+    {
+        return iterator(this, -1);
+    }
+
+    iterator begin()
+    {
+        return iterator(this, _lruHead[eSegmentProbation] != -1 ? _lruHead[eSegmentProbation] : _lruHead[eSegmentProtected]);
+    }
+
+    void insert(const key_type & k,
+                const value_type& list)
+    {
+        iterator found = peek(k);
+
+        if ( found != end() ) {
+            found->second.insert( found->second.end(), list.begin(), list.end() );
+        } else {
+            Node& node = _nodes[allocateNode(k)];
+            node.second.assign( list.begin(), list.end() );
+        }
+    }
+
+    void insert(const key_type & k,
+                const V & v)
+    {
+        iterator found = peek(k);
+
+        if ( found != end() ) {
+            found->second.push_back(v);
+        } else {
+            _nodes[allocateNode(k)].second.push_back(v);
+        }
+    }
+
+    void clear()
+    {
+        _nodes.clear();
+        _index.clear();
+        _freeHead = -1;
+        for (int i = 0; i < eSegmentCount; ++i) {
+            _lruHead[i] = _lruTail[i] = -1;
+        }
+        _size = 0;
+        _protectedSize = 0;
+    }
+
+    std::pair<key_type, V> evict()
+    {
+        if (_policy == NATRON_NAMESPACE::eCacheEvictionPolicyCostAware) {
+            return evictCheapest();
+        } else if (_policy == NATRON_NAMESPACE::eCacheEvictionPolicySLRU) {
+            demoteExceedingProtected();
+        }
+        for (iterator it = begin(); it != end(); ++it) {
+            value_type& values = it->second;
+            for (typename value_type::iterator it2 = values.begin(); it2 != values.end(); ++it2) {
+                if ( (*it2).use_count() == 1 ) {
+                    std::pair<key_type, V> ret = std::make_pair(it->first, *it2);
+                    removeValue(it.index(), it2);
+
+                    return ret;
+                }
+            }
+        }
+
+        return std::make_pair( key_type(), V() );
+    }
+
+    unsigned int size()
+    {
+        return _size;
+    }
+
+private:
+
+    // The protected share is enforced when evicting, i.e: when the table is at its largest
+    void demoteExceedingProtected()
+    {
+        // Demote the least recently used protected records to the most recently used end of the probation segment
+        while (_protectedSize * 100 > _size * NATRON_CACHE_SLRU_PROTECTED_PERCENT) {
+            int demoted = _lruHead[eSegmentProtected];
+            lruUnlink(demoted);
+            _nodes[demoted].segment = eSegmentProbation;
+            --_protectedSize;
+            lruPushBack(demoted);
+        }
+    }
+
+    // Evicts the value with the lowest cost among the NATRON_CACHE_COST_EVICTION_WINDOW least recently used evictable values.
+    // Among values of equal cost, the least recently used one is evicted.
+    std::pair<key_type, V> evictCheapest()
+    {
+        COST cost;
+        int bestNode = -1;
+        typename value_type::iterator bestValue;
+        double bestCost = 0.;
+        int nCandidates = 0;
+
+        for (iterator it = begin(); it != end() && nCandidates < NATRON_CACHE_COST_EVICTION_WINDOW; ++it) {
+            value_type& values = it->second;
+            for (typename value_type::iterator it2 = values.begin(); it2 != values.end() && nCandidates < NATRON_CACHE_COST_EVICTION_WINDOW; ++it2) {
+                if ( (*it2).use_count() == 1 ) {
+                    double c = cost(*it2);
+                    if ( (bestNode == -1) || (c < bestCost) ) {
+                        bestNode = it.index();
+                        bestValue = it2;
+                        bestCost = c;
+                    }
+                    ++nCandidates;
+                }
+            }
+        }
+        if (bestNode == -1) {
+            return std::make_pair( key_type(), V() );
+        }
+        std::pair<key_type, V> ret = std::make_pair(_nodes[bestNode].first, *bestValue);
+        removeValue(bestNode, bestValue);
+
+        return ret;
+    }
+
+    void removeValue(int nodeIndex,
+                     typename value_type::iterator value)
+    {
+        value_type& values = _nodes[nodeIndex].second;
+
+        if (values.size() == 1) {
+            eraseNode(nodeIndex);
+        } else {
+            values.erase(value);
+        }
+    }
+
+    static std::size_t hashKey(const key_type& k)
+    {
+        // Finalizer of MurmurHash3: the cache keys are already hashes but their low bits
+        // may not be evenly distributed
+        U64 h = (U64)k;
+
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+
+        return (std::size_t)h;
+    }
+
+    // Returns the slot in _index of k or -1
+    int findSlot(const key_type& k) const
+    {
+        if ( _index.empty() ) {
+            return -1;
+        }
+        std::size_t mask = _index.size() - 1;
+        for (std::size_t slot = hashKey(k) & mask;; slot = (slot + 1) & mask) {
+            int nodeIndex = _index[slot];
+            if (nodeIndex == -1) {
+                return -1;
+            }
+            if (_nodes[nodeIndex].first == k) {
+                return (int)slot;
+            }
+        }
+    }
+
+    void indexInsert(int nodeIndex)
+    {
+        std::size_t mask = _index.size() - 1;
+        std::size_t slot = hashKey(_nodes[nodeIndex].first) & mask;
+
+        while (_index[slot] != -1) {
+            slot = (slot + 1) & mask;
+        }
+        _index[slot] = nodeIndex;
+    }
+
+    // Keep the load factor of the index under 1/2
+    void growIndexIfNeeded()
+    {
+        if ( (_size + 1) * 2 <= _index.size() ) {
+            return;
+        }
+        std::size_t newSize = _index.empty() ? 16 : _index.size() * 2;
+        _index.assign(newSize, -1);
+        for (iterator it = begin(); it != end(); ++it) {
+            indexInsert( it.index() );
+        }
+    }
+
+    // Backward shift deletion, so that the index never contains tombstones
+    void indexErase(std::size_t slot)
+    {
+        std::size_t mask = _index.size() - 1;
+        std::size_t hole = slot;
+
+        for (std::size_t next = (hole + 1) & mask; _index[next] != -1; next = (next + 1) & mask) {
+            std::size_t ideal = hashKey(_nodes[_index[next]].first) & mask;
+            // Move the record into the hole unless its ideal slot is cyclically in (hole, next]
+            bool stays = (hole <= next) ? (ideal > hole && ideal <= next) : (ideal > hole || ideal <= next);
+            if (!stays) {
+                _index[hole] = _index[next];
+                hole = next;
+            }
+        }
+        _index[hole] = -1;
+    }
+
+    void lruUnlink(int nodeIndex)
+    {
+        Node& node = _nodes[nodeIndex];
+
+        if (node.lruPrev != -1) {
+            _nodes[node.lruPrev].lruNext = node.lruNext;
+        } else {
+            _lruHead[node.segment] = node.lruNext;
+        }
+        if (node.lruNext != -1) {
+            _nodes[node.lruNext].lruPrev = node.lruPrev;
+        } else {
+            _lruTail[node.segment] = node.lruPrev;
+        }
+        node.lruPrev = node.lruNext = -1;
+    }
+
+    // Links the node at the most recently used end of its segment
+    void lruPushBack(int nodeIndex)
+    {
+        Node& node = _nodes[nodeIndex];
+        int& tail = _lruTail[node.segment];
+
+        node.lruPrev = tail;
+        node.lruNext = -1;
+        if (tail != -1) {
+            _nodes[tail].lruNext = nodeIndex;
+        } else {
+            _lruHead[node.segment] = nodeIndex;
+        }
+        tail = nodeIndex;
+    }
+
+    // Takes a node from the free list (or grows the pool), indexes it and marks it as the most recently used
+    int allocateNode(const key_type& k)
+    {
+        growIndexIfNeeded();
+
+        int nodeIndex;
+        if (_freeHead != -1) {
+            nodeIndex = _freeHead;
+            _freeHead = _nodes[nodeIndex].lruNext;
+        } else {
+            // std::deque does not move the existing nodes when growing
+            nodeIndex = (int)_nodes.size();
+            _nodes.push_back( Node() );
+        }
+        Node& node = _nodes[nodeIndex];
+        node.first = k;
+        node.used = true;
+        node.segment = eSegmentProbation;
+        assert( node.second.empty() );
+        lruPushBack(nodeIndex);
+        indexInsert(nodeIndex);
+        ++_size;
+
+        return nodeIndex;
+    }
+
+    void eraseNode(int nodeIndex)
+    {
+        Node& node = _nodes[nodeIndex];
+        int slot = findSlot(node.first);
+
+        assert(slot != -1 && _index[slot] == nodeIndex);
+        indexErase(slot);
+        lruUnlink(nodeIndex);
+        if (node.segment == eSegmentProtected) {
+            --_protectedSize;
+        }
+
+        // clear() keeps the capacity of the vector for the next record using this node
+        node.second.clear();
+        node.used = false;
+        node.segment = eSegmentProbation;
+        node.lruNext = _freeHead;
+        _freeHead = nodeIndex;
+        --_size;
+    }
+
+    std::deque<Node> _nodes;
+    std::vector<int> _index;
+    int _freeHead;
+    int _lruHead[eSegmentCount];
+    int _lruTail[eSegmentCount];
+    std::size_t _size;
+    std::size_t _protectedSize;
+    NATRON_NAMESPACE::CacheEvictionPolicyEnum _policy;
+};
 
 #ifdef USE_VARIADIC_TEMPLATES // c++11 is defined as well as unordered_map
 
@@ -146,6 +674,12 @@ public:
         return it;
     }
 
+    // Obtain the record for k without changing its recency
+    typename key_to_value_type::iterator peek(const key_type & k)
+    {
+        return _key_to_value.find(k);
+    }
+
     void erase(typename key_to_value_type::iterator it)
     {
         _key_tracker.erase(it->second.second);
@@ -264,6 +798,12 @@ public:
         return it;
     }
 
+    // Obtain the record for k without changing its recency
+    typename container_type::left_iterator peek(const key_type & k)
+    {
+        return _container.left.find(k);
+    }
+
     void erase(typename container_type::left_iterator it)
     {
         _container.left.erase(it);
@@ -293,7 +833,7 @@ public:
         // Create a new record from the key and the value
         // bimap's list_view defaults to inserting this at
         // the list tail (considered most-recently-used).
-        typename container_type::left_iterator found = this->operator ()(k);
+        typename container_type::left_iterator found = peek(k);
         if ( found != _container.left.end() ) {
             found->second.push_back(v);
         } else {
@@ -380,6 +920,12 @@ public:
         return it;
     }
 
+    // Obtain the record for k without changing its recency
+    typename key_to_value_type::iterator peek(const key_type & k)
+    {
+        return _key_to_value.find(k);
+    }
+
     void erase(typename key_to_value_type::iterator it)
     {
         _key_tracker.erase(it->second.second);
@@ -494,6 +1040,12 @@ public:
         return it;
     }
 
+    // Obtain the record for k without changing its recency
+    typename container_type::left_iterator peek(const key_type & k)
+    {
+        return _container.left.find(k);
+    }
+
     void erase(typename container_type::left_iterator it)
     {
         _container.left.erase(it);
@@ -523,7 +1075,7 @@ public:
         // Create a new record from the key and the value
         // bimap's list_view defaults to inserting this at
         // the list tail (considered most-recently-used).
-        typename container_type::left_iterator found = this->operator ()(k);
+        typename container_type::left_iterator found = peek(k);
         if ( found != _container.left.end() ) {
             found->second.push_back(v);
         } else {
@@ -596,6 +1148,12 @@ public:
         return it;
     }
 
+    // Obtain the record for k without changing its recency
+    typename container_type::left_iterator peek(const key_type & k)
+    {
+        return _container.left.find(k);
+    }
+
     void erase(typename container_type::left_iterator it)
     {
         _container.left.erase(it);
@@ -625,7 +1183,7 @@ public:
         // Create a new record from the key and the value
         // bimap's list_view defaults to inserting this at
         // the list tail (considered most-recently-used).
-        typename container_type::left_iterator found = this->operator ()(k);
+        typename container_type::left_iterator found = peek(k);
         if ( found != _container.left.end() ) {
             found->second.push_back(v);
         } else {
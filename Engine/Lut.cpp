@@ -27,8 +27,10 @@
 #include <cstring> // for std::memcpy
 #include <algorithm> // min, max
 #include <cassert>
+#include <limits>
 #include <stdexcept>
 
+#include "Engine/CPUFeatures.h"
 #include "Engine/RectI.h"
 
 /*
@@ -128,6 +130,61 @@ index_to_float(const unsigned short i)
     return tmp.f;
 }
 
+// same as index_to_float, but returns the first float of the range instead of the middle one
+static float
+index_to_float_start(const unsigned short i)
+{
+    union
+    {
+        float f;
+        unsigned short us[2];
+    }
+
+    tmp;
+
+    if ( ( i < 0x80) || ( ( i >= 0x8000) && ( i < 0x8080) ) ) {
+        return 0;
+    }
+    if ( ( i >= 0x7f80) && ( i < 0x8000) ) {
+        return std::numeric_limits<float>::max();
+    }
+    if (i >= 0xff80) {
+        return -std::numeric_limits<float>::max();
+    }
+    if (O32_HOST_ORDER == O32_BIG_ENDIAN) {
+        tmp.us[0] = i;
+        tmp.us[1] = 0;
+    } else if (O32_HOST_ORDER == O32_LITTLE_ENDIAN) {
+        tmp.us[0] = 0;
+        tmp.us[1] = i;
+    } else {
+        assert( (O32_HOST_ORDER == O32_LITTLE_ENDIAN) || (O32_HOST_ORDER == O32_BIG_ENDIAN) );
+    }
+
+    return tmp.f;
+}
+
+// fills a table for interpolateFloatTableBatch(): infinite values are clamped and NaNs become 0, so that
+// interpolating between two entries never gives a NaN
+static void
+fillFloatTable(float (*func)(float),
+               std::vector<float>* table)
+{
+    table->resize(0x10001);
+    for (int i = 0; i < 0x10000; ++i) {
+        float f = func( index_to_float_start( (unsigned short)i ) );
+        if (f != f) {
+            f = 0.f;
+        } else if ( f > std::numeric_limits<float>::max() ) {
+            f = std::numeric_limits<float>::max();
+        } else if ( f < -std::numeric_limits<float>::max() ) {
+            f = -std::numeric_limits<float>::max();
+        }
+        (*table)[i] = f;
+    }
+    (*table)[0x10000] = (*table)[0xffff];
+}
+
 ///initialize the singleton
 LutManager LutManager::m_instance = LutManager();
 LutManager::LutManager()
@@ -138,7 +195,9 @@ LutManager::LutManager()
 const Lut*
 LutManager::getLut(const std::string & name,
                    fromColorSpaceFunctionV1 fromFunc,
-                   toColorSpaceFunctionV1 toFunc)
+                   toColorSpaceFunctionV1 toFunc,
+                   const PowerTransferFunction* fromPower,
+                   const PowerTransferFunction* toPower)
 {
     LutsMap::iterator found = LutManager::m_instance.luts.find(name);
 
@@ -146,7 +205,7 @@ LutManager::getLut(const std::string & name,
         return found->second;
     } else {
         std::pair<LutsMap::iterator, bool> ret =
-            LutManager::m_instance.luts.insert( std::make_pair( name, new Lut(name, fromFunc, toFunc) ) );
+            LutManager::m_instance.luts.insert( std::make_pair( name, new Lut(name, fromFunc, toFunc, fromPower, toPower) ) );
         assert(ret.second);
 
         return ret.first->second;
@@ -342,6 +401,61 @@ Lut::fillTables() const
         int i = hipart(f);
         toFunc_hipart_to_uint8xx[i] = Color::charToUint8xx(b);
     }
+    if (!_hasFromPower) {
+        fillFloatTable(_fromFunc, &fromFunc_hipart_to_float);
+    }
+    if (!_hasToPower) {
+        fillFloatTable(_toFunc, &toFunc_hipart_to_float);
+    }
+}
+
+void
+Lut::fromColorSpaceFloatToLinearFloatBatch(const float* from,
+                                           float* to,
+                                           int n) const
+{
+    assert(init_);
+    SIMDLevelEnum level = getSIMDLevel();
+    if (_hasFromPower) {
+        if ( applyPowerTransferFunctionBatch(_fromPower, from, to, n, level) ) {
+            return;
+        }
+    } else if ( interpolateFloatTableBatch(&fromFunc_hipart_to_float[0], from, to, n, level) ) {
+        return;
+    }
+    for (int i = 0; i < n; ++i) {
+        to[i] = _fromFunc(from[i]);
+    }
+}
+
+void
+Lut::toColorSpaceFloatFromLinearFloatBatch(const float* from,
+                                           float* to,
+                                           int n) const
+{
+    assert(init_);
+    SIMDLevelEnum level = getSIMDLevel();
+    if (_hasToPower) {
+        if ( applyPowerTransferFunctionBatch(_toPower, from, to, n, level) ) {
+            return;
+        }
+    } else if ( interpolateFloatTableBatch(&toFunc_hipart_to_float[0], from, to, n, level) ) {
+        return;
+    }
+    for (int i = 0; i < n; ++i) {
+        to[i] = _toFunc(from[i]);
+    }
+}
+
+void
+Lut::toColorSpaceUint8xxFromLinearFloatBatch(const float* from,
+                                             unsigned short* to,
+                                             int n) const
+{
+    assert(init_);
+    for (int i = 0; i < n; ++i) {
+        to[i] = toFunc_hipart_to_uint8xx[hipart(from[i])];
+    }
 }
 
 #ifdef DEAD_CODE
@@ -464,6 +578,10 @@ Lut::to_byte_packed(unsigned char* to,
 
     validate();
 
+    // the premultiplied values of a row, then their lut values, 3 per pixel
+    std::vector<float> rowValues( (rect.x2 - rect.x1) * 3 );
+    std::vector<unsigned short> rowUint8xx( rowValues.size() );
+
     for (int y = rect.y1; y < rect.y2; ++y) {
         // coverity[dont_call]
         int start = rand() % (rect.x2 - rect.x1) + rect.x1;
@@ -478,14 +596,23 @@ Lut::to_byte_packed(unsigned char* to,
         int dstY = dstBounds.y2 - y - 1;
         const float *src_pixels = from + (srcY * (srcBounds.x2 - srcBounds.x1) * inPackingSize);
         unsigned char *dst_pixels = to + (dstY * (dstBounds.x2 - dstBounds.x1) * outPackingSize);
+        for (int x = rect.x1, i = 0; x < rect.x2; ++x, i += 3) {
+            int inCol = x * inPackingSize;
+            float a = (inputHasAlpha && premult) ? src_pixels[inCol + inAOffset] : 1.f;
+            rowValues[i] = src_pixels[inCol + inROffset] * a;
+            rowValues[i + 1] = src_pixels[inCol + inGOffset] * a;
+            rowValues[i + 2] = src_pixels[inCol + inBOffset] * a;
+        }
+        toColorSpaceUint8xxFromLinearFloatBatch( &rowValues[0], &rowUint8xx[0], (int)rowValues.size() );
+        const unsigned short* uint8xx_pixels = &rowUint8xx[0] - rect.x1 * 3;
         /* go forwards from starting point to end of line: */
         for (int x = start; x < rect.x2; ++x) {
             int inCol = x * inPackingSize;
             int outCol = x * outPackingSize;
             float a = (inputHasAlpha && premult) ? src_pixels[inCol + inAOffset] : 1.f;
-            error_r = (error_r & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inROffset] * a)];
-            error_g = (error_g & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inGOffset] * a)];
-            error_b = (error_b & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inBOffset] * a)];
+            error_r = (error_r & 0xff) + uint8xx_pixels[x * 3];
+            error_g = (error_g & 0xff) + uint8xx_pixels[x * 3 + 1];
+            error_b = (error_b & 0xff) + uint8xx_pixels[x * 3 + 2];
             assert(error_r < 0x10000 && error_g < 0x10000 && error_b < 0x10000);
             dst_pixels[outCol + outROffset] = (unsigned char)(error_r >> 8);
             dst_pixels[outCol + outGOffset] = (unsigned char)(error_g >> 8);
@@ -501,9 +628,9 @@ Lut::to_byte_packed(unsigned char* to,
             int inCol = x * inPackingSize;
             int outCol = x * outPackingSize;
             float a = (inputHasAlpha && premult) ? src_pixels[inCol + inAOffset] : 1.f;
-            error_r = (error_r & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inROffset] * a)];
-            error_g = (error_g & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inGOffset] * a)];
-            error_b = (error_b & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inBOffset] * a)];
+            error_r = (error_r & 0xff) + uint8xx_pixels[x * 3];
+            error_g = (error_g & 0xff) + uint8xx_pixels[x * 3 + 1];
+            error_b = (error_b & 0xff) + uint8xx_pixels[x * 3 + 2];
             assert(error_r < 0x10000 && error_g < 0x10000 && error_b < 0x10000);
             dst_pixels[outCol + outROffset] = (unsigned char)(error_r >> 8);
             dst_pixels[outCol + outGOffset] = (unsigned char)(error_g >> 8);
@@ -564,6 +691,9 @@ Lut::to_float_packed(float* to,
 
     validate();
 
+    // the premultiplied values of a row, 3 per pixel, converted at once
+    std::vector<float> rowValues( (rect.x2 - rect.x1) * 3 );
+
     for (int y = rect.y1; y < rect.y2; ++y) {
         int srcY = y;
         if (invertY) {
@@ -573,14 +703,21 @@ Lut::to_float_packed(float* to,
         int dstY = dstBounds.y2 - y - 1;
         const float *src_pixels = from + (srcY * (srcBounds.x2 - srcBounds.x1) * inPackingSize);
         float *dst_pixels = to + (dstY * (dstBounds.x2 - dstBounds.x1) * outPackingSize);
-        /* go forwards from starting point to end of line: */
-        for (int x = rect.x1; x < rect.x2; ++x) {
+        for (int x = rect.x1, i = 0; x < rect.x2; ++x, i += 3) {
+            int inCol = x * inPackingSize;
+            float a = (inputHasAlpha && premult) ? src_pixels[inCol + inAOffset] : 1.f;
+            rowValues[i] = src_pixels[inCol + inROffset] * a;
+            rowValues[i + 1] = src_pixels[inCol + inGOffset] * a;
+            rowValues[i + 2] = src_pixels[inCol + inBOffset] * a;
+        }
+        toColorSpaceFloatFromLinearFloatBatch( &rowValues[0], &rowValues[0], (int)rowValues.size() );
+        for (int x = rect.x1, i = 0; x < rect.x2; ++x, i += 3) {
             int inCol = x * inPackingSize;
             int outCol = x * outPackingSize;
-            float a = (inputHasAlpha && premult) ? src_pixels[inCol + inAOffset] : 1.f;;
-            dst_pixels[outCol + outROffset] = toColorSpaceFloatFromLinearFloat(src_pixels[inCol + inROffset] * a);
-            dst_pixels[outCol + outGOffset] = toColorSpaceFloatFromLinearFloat(src_pixels[inCol + inGOffset] * a);
-            dst_pixels[outCol + outBOffset] = toColorSpaceFloatFromLinearFloat(src_pixels[inCol + inBOffset] * a);
+            float a = (inputHasAlpha && premult) ? src_pixels[inCol + inAOffset] : 1.f;
+            dst_pixels[outCol + outROffset] = rowValues[i];
+            dst_pixels[outCol + outGOffset] = rowValues[i + 1];
+            dst_pixels[outCol + outBOffset] = rowValues[i + 2];
             if (outputHasAlpha) {
                 // alpha is linear and should not be dithered
                 dst_pixels[outCol + outAOffset] = a;
@@ -770,6 +907,9 @@ Lut::from_float_packed(float* to,
 
     validate();
 
+    // the unpremultiplied values of a row, 3 per pixel, converted at once
+    std::vector<float> rowValues( (rect.x2 - rect.x1) * 3 );
+
     for (int y = rect.y1; y < rect.y2; ++y) {
         int srcY = y;
         if (invertY) {
@@ -777,19 +917,27 @@ Lut::from_float_packed(float* to,
         }
         const float *src_pixels = from + (srcY * (srcBounds.x2 - srcBounds.x1) * inPackingSize);
         float *dst_pixels = to + (y * (dstBounds.x2 - dstBounds.x1) * outPackingSize);
-        for (int x = rect.x1; x < rect.x2; ++x) {
+        for (int x = rect.x1, i = 0; x < rect.x2; ++x, i += 3) {
             int inCol = x * inPackingSize;
-            int outCol = x * outPackingSize;
-            float a = (inputHasAlpha && premult) ? src_pixels[inCol + inAOffset] : 1.f;;
+            float a = (inputHasAlpha && premult) ? src_pixels[inCol + inAOffset] : 1.f;
             float rf = 0., gf = 0., bf = 0.;
             if (a > 0.) {
                 rf = src_pixels[inCol + inROffset] / a;
                 gf = src_pixels[inCol + inGOffset] / a;
                 bf = src_pixels[inCol + inBOffset] / a;
             }
-            dst_pixels[outCol + outROffset] = fromColorSpaceFloatToLinearFloat(rf) * a;
-            dst_pixels[outCol + outGOffset] = fromColorSpaceFloatToLinearFloat(gf) * a;
-            dst_pixels[outCol + outBOffset] = fromColorSpaceFloatToLinearFloat(bf) * a;
+            rowValues[i] = rf;
+            rowValues[i + 1] = gf;
+            rowValues[i + 2] = bf;
+        }
+        fromColorSpaceFloatToLinearFloatBatch( &rowValues[0], &rowValues[0], (int)rowValues.size() );
+        for (int x = rect.x1, i = 0; x < rect.x2; ++x, i += 3) {
+            int inCol = x * inPackingSize;
+            int outCol = x * outPackingSize;
+            float a = (inputHasAlpha && premult) ? src_pixels[inCol + inAOffset] : 1.f;
+            dst_pixels[outCol + outROffset] = rowValues[i] * a;
+            dst_pixels[outCol + outGOffset] = rowValues[i + 1] * a;
+            dst_pixels[outCol + outBOffset] = rowValues[i + 2] * a;
             if (outputHasAlpha) {
                 // alpha is linear
                 dst_pixels[outCol + outAOffset] = a;
@@ -1286,10 +1434,18 @@ to_float_packed(float* to,
 } // to_float_packed
 } // namespace Linear
 
+// from_func_srgb and to_func_srgb as PowerTransferFunction, for the batched conversions
+static const PowerTransferFunction from_power_srgb = {
+    0.04045f, 1.0f / 12.92f, 0.055f, 1.0f / 1.055f, 2.4f, 1.0f, 0.0f
+};
+static const PowerTransferFunction to_power_srgb = {
+    0.0031308f, 12.92f, 0.0f, 1.0f, 1.0f / 2.4f, 1.055f, -0.055f
+};
+
 const Lut*
 LutManager::sRGBLut()
 {
-    return LutManager::m_instance.getLut("sRGB", from_func_srgb, to_func_srgb);
+    return LutManager::m_instance.getLut("sRGB", from_func_srgb, to_func_srgb, &from_power_srgb, &to_power_srgb);
 }
 
 // Rec.709 and Rec.2020 share the same transfer function (and illuminant), except that
@@ -1326,10 +1482,17 @@ to_func_Rec709(float v)
     }
 }
 
+static const PowerTransferFunction from_power_Rec709 = {
+    0.08145f, 1.0f / 4.5f, 0.0993f, 1.0f / 1.0993f, 1.0f / 0.45f, 1.0f, 0.0f
+};
+static const PowerTransferFunction to_power_Rec709 = {
+    0.0181f, 4.5f, 0.0f, 1.0f, 0.45f, 1.0993f, -(1.0993f - 1.f)
+};
+
 const Lut*
 LutManager::Rec709Lut()
 {
-    return LutManager::m_instance.getLut("Rec709", from_func_Rec709, to_func_Rec709);
+    return LutManager::m_instance.getLut("Rec709", from_func_Rec709, to_func_Rec709, &from_power_Rec709, &to_power_Rec709);
 }
 
 /*
@@ -35,12 +35,14 @@
 #include <cmath>
 #include <map>
 #include <string>
+#include <vector>
 
 CLANG_DIAG_OFF(deprecated)
 #include <QtCore/QMutex>
 CLANG_DIAG_ON(deprecated)
 
 #include "Engine/EngineFwd.h"
+#include "Engine/LutKernels.h"
 
 #define NATRON_COLOR_HUE_CIRCLE 1. // if hue should be between 0 and 1
 //#define NATRON_COLOR_HUE_CIRCLE 360. // if hue should be in degrees
@@ -81,9 +83,12 @@ public:
     /**
      * @brief Returns a pointer to a lut with the given name and the given from and to functions.
      * If a lut with the same name didn't already exist, then it will create one.
+     * fromPower and toPower may describe fromFunc and toFunc if they have the form of a PowerTransferFunction,
+     * in which case the batched conversions evaluate them directly instead of interpolating a table.
      * WARNING : NOT THREAD-SAFE
      **/
-    static const Lut * getLut(const std::string & name, fromColorSpaceFunctionV1 fromFunc, toColorSpaceFunctionV1 toFunc);
+    static const Lut * getLut(const std::string & name, fromColorSpaceFunctionV1 fromFunc, toColorSpaceFunctionV1 toFunc,
+                              const PowerTransferFunction* fromPower = NULL, const PowerTransferFunction* toPower = NULL);
 
     ///buit-ins color-spaces
     static const Lut* sRGBLut();
@@ -139,6 +144,14 @@ class Lut
     /// and never change afterwards
     mutable unsigned short toFunc_hipart_to_uint8xx[0x10000];         /// contains  2^16 = 65536 values between 0-255
     mutable float fromFunc_uint8_to_float[256];         /// values between 0-1.f
+    /// tables for the batched float conversions (see interpolateFloatTableBatch()), left empty when the function
+    /// is a PowerTransferFunction
+    mutable std::vector<float> fromFunc_hipart_to_float;
+    mutable std::vector<float> toFunc_hipart_to_float;
+    PowerTransferFunction _fromPower;
+    PowerTransferFunction _toPower;
+    bool _hasFromPower;
+    bool _hasToPower;
     mutable bool init_;         ///< false if the tables are not yet initialized
     mutable QMutex _lock;         ///< protects init_
 
@@ -146,13 +159,27 @@ class Lut
     ///private constructor, used by LutManager
     Lut(const std::string & name,
         fromColorSpaceFunctionV1 fromFunc,
-        toColorSpaceFunctionV1 toFunc)
+        toColorSpaceFunctionV1 toFunc,
+        const PowerTransferFunction* fromPower,
+        const PowerTransferFunction* toPower)
         : _name(name)
         , _fromFunc(fromFunc)
         , _toFunc(toFunc)
+        , fromFunc_hipart_to_float()
+        , toFunc_hipart_to_float()
+        , _fromPower()
+        , _toPower()
+        , _hasFromPower(fromPower != NULL)
+        , _hasToPower(toPower != NULL)
         , init_(false)
         , _lock()
     {
+        if (fromPower) {
+            _fromPower = *fromPower;
+        }
+        if (toPower) {
+            _toPower = *toPower;
+        }
     }
 
     ///init luts
@@ -230,6 +257,24 @@ public:
      */
     float fromColorSpaceUint16ToLinearFloatFast(unsigned short v) const;
 
+    /* @brief Same as fromColorSpaceFloatToLinearFloat() on the n values of from, written to to which may be equal to from.
+     * The values are converted with the SIMD kernels of LutKernels.h when the CPU has them: the sRGB and Rec.709 curves
+     * are evaluated with polynomial approximations, the other curves are interpolated in a table. Otherwise this
+     * calls fromColorSpaceFloatToLinearFloat() on each value.
+     */
+    void fromColorSpaceFloatToLinearFloatBatch(const float* from, float* to, int n) const;
+
+    /* @brief Same as toColorSpaceFloatFromLinearFloat() on the n values of from, written to to which may be equal to from.
+     * @see fromColorSpaceFloatToLinearFloatBatch()
+     */
+    void toColorSpaceFloatFromLinearFloatBatch(const float* from, float* to, int n) const;
+
+    /* @brief Same as toColorSpaceUint8xxFromLinearFloatFast() on the n values of from.
+     * Doing the lookups of a whole row before the error diffusion, which must go pixel after pixel,
+     * lets the CPU overlap the memory accesses.
+     */
+    void toColorSpaceUint8xxFromLinearFloatBatch(const float* from, unsigned short* to, int n) const;
+
 
     /////@TODO the following functions expects a float input buffer, one could extend it to cover all bitdepths.
 
@@ -0,0 +1,375 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "LutKernels.h"
+
+#include <limits>
+
+#ifdef NATRON_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef NATRON_SIMD_AVX2
+#include <immintrin.h>
+#endif
+
+/*
+ * pow(x, e) is computed as exp2(e * log2(x)), x > 0:
+ * - log2(x) = exponent + log2(m), m being the mantissa brought in [sqrt(1/2), sqrt(2)). With t = (m - 1) / (m + 1),
+ * ln(m) = 2 * (t + t^3/3 + t^5/5 + ...) and |t| < 0.172, so that 5 terms are enough for float precision.
+ * - exp2(y) = 2^n * exp(f * ln(2)), n being the integer closest to y and |f| <= 0.5, with the Taylor series of exp
+ * up to the 7th degree. 2^n is built directly in the exponent bits, y being clamped so that n + 127 stays in [1, 255]:
+ * 255 gives infinity.
+ *
+ * Each kernel processes as many values as its vectors hold and leaves the remaining values to the narrower
+ * kernel (AVX2 -> SSE2). The SSE2 kernels process the last values in a padded vector, so that all values
+ * get the same approximation.
+ */
+
+NATRON_NAMESPACE_ENTER
+namespace Color {
+namespace {
+// 2 / (k * ln(2)), for the odd k of the ln series
+const float kLog2C1 = 2.8853900817779268f;
+const float kLog2C3 = 0.96179669392597560f;
+const float kLog2C5 = 0.57707801635558536f;
+const float kLog2C7 = 0.41219858311113240f;
+const float kLog2C9 = 0.32059889797532520f;
+
+// ln(2)^k / k!
+const float kExp2C1 = 0.69314718055994531f;
+const float kExp2C2 = 0.24022650695910071f;
+const float kExp2C3 = 0.055504108664821580f;
+const float kExp2C4 = 0.0096181291076284772f;
+const float kExp2C5 = 0.0013333558146428443f;
+const float kExp2C6 = 0.00015403530393381609f;
+const float kExp2C7 = 0.000015252733804059841f;
+
+#ifdef NATRON_SIMD_SSE2
+
+inline __m128
+selectSSE2(__m128 mask,
+           __m128 a,
+           __m128 b)
+{
+    return _mm_or_ps( _mm_and_ps(mask, a), _mm_andnot_ps(mask, b) );
+}
+
+// x must be a positive normal float
+inline __m128
+log2SSE2(__m128 x)
+{
+    const __m128i bits = _mm_castps_si128(x);
+    __m128i exponent = _mm_sub_epi32( _mm_srli_epi32(bits, 23), _mm_set1_epi32(127) );
+    __m128 m = _mm_castsi128_ps( _mm_or_si128( _mm_and_si128( bits, _mm_set1_epi32(0x007fffff) ), _mm_set1_epi32(0x3f800000) ) );
+    const __m128 large = _mm_cmpge_ps( m, _mm_set1_ps(1.41421356f) );
+
+    m = selectSSE2( large, _mm_mul_ps( m, _mm_set1_ps(0.5f) ), m );
+    // large is -1 where true
+    exponent = _mm_sub_epi32( exponent, _mm_castps_si128(large) );
+
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 t = _mm_div_ps( _mm_sub_ps(m, one), _mm_add_ps(m, one) );
+    const __m128 t2 = _mm_mul_ps(t, t);
+    __m128 p = _mm_set1_ps(kLog2C9);
+    p = _mm_add_ps( _mm_mul_ps(p, t2), _mm_set1_ps(kLog2C7) );
+    p = _mm_add_ps( _mm_mul_ps(p, t2), _mm_set1_ps(kLog2C5) );
+    p = _mm_add_ps( _mm_mul_ps(p, t2), _mm_set1_ps(kLog2C3) );
+    p = _mm_add_ps( _mm_mul_ps(p, t2), _mm_set1_ps(kLog2C1) );
+
+    return _mm_add_ps( _mm_cvtepi32_ps(exponent), _mm_mul_ps(p, t) );
+}
+
+inline __m128
+exp2SSE2(__m128 y)
+{
+    y = _mm_min_ps( _mm_max_ps( y, _mm_set1_ps(-126.f) ), _mm_set1_ps(128.f) );
+
+    const __m128i n = _mm_cvtps_epi32(y);
+    const __m128 f = _mm_sub_ps( y, _mm_cvtepi32_ps(n) );
+    __m128 p = _mm_set1_ps(kExp2C7);
+    p = _mm_add_ps( _mm_mul_ps(p, f), _mm_set1_ps(kExp2C6) );
+    p = _mm_add_ps( _mm_mul_ps(p, f), _mm_set1_ps(kExp2C5) );
+    p = _mm_add_ps( _mm_mul_ps(p, f), _mm_set1_ps(kExp2C4) );
+    p = _mm_add_ps( _mm_mul_ps(p, f), _mm_set1_ps(kExp2C3) );
+    p = _mm_add_ps( _mm_mul_ps(p, f), _mm_set1_ps(kExp2C2) );
+    p = _mm_add_ps( _mm_mul_ps(p, f), _mm_set1_ps(kExp2C1) );
+    p = _mm_add_ps( _mm_mul_ps(p, f), _mm_set1_ps(1.f) );
+
+    const __m128 scale = _mm_castsi128_ps( _mm_slli_epi32(_mm_add_epi32( n, _mm_set1_epi32(127) ), 23) );
+
+    return _mm_mul_ps(p, scale);
+}
+
+inline __m128
+powerTransferSSE2(const PowerTransferFunction& func,
+                  __m128 v)
+{
+    const __m128 linear = _mm_mul_ps( _mm_max_ps( v, _mm_setzero_ps() ), _mm_set1_ps(func.linearSlope) );
+    const __m128 base = _mm_mul_ps( _mm_add_ps( v, _mm_set1_ps(func.powInOffset) ), _mm_set1_ps(func.powInScale) );
+    const __m128 power = exp2SSE2( _mm_mul_ps( log2SSE2(base), _mm_set1_ps(func.exponent) ) );
+    const __m128 curve = _mm_add_ps( _mm_mul_ps( power, _mm_set1_ps(func.powScale) ), _mm_set1_ps(func.powOutOffset) );
+    // the power segment is also computed on the linear lanes, where it may be garbage
+    const __m128 result = selectSSE2( _mm_cmplt_ps( v, _mm_set1_ps(func.breakPoint) ), linear, curve );
+    // f(NaN) is NaN and f(+inf) is +inf, which exp2SSE2() cannot return from a finite log2
+    const __m128 keep = _mm_or_ps( _mm_cmpunord_ps(v, v), _mm_cmpeq_ps( v, _mm_set1_ps( std::numeric_limits<float>::infinity() ) ) );
+
+    return selectSSE2(keep, v, result);
+}
+
+void
+applyPowerTransferFunctionSSE2(const PowerTransferFunction& func,
+                               const float* from,
+                               float* to,
+                               int n)
+{
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps( to + i, powerTransferSSE2( func, _mm_loadu_ps(from + i) ) );
+    }
+    if (i < n) {
+        float tail[4] = { 1.f, 1.f, 1.f, 1.f };
+        for (int j = i; j < n; ++j) {
+            tail[j - i] = from[j];
+        }
+        _mm_storeu_ps( tail, powerTransferSSE2( func, _mm_loadu_ps(tail) ) );
+        for (int j = i; j < n; ++j) {
+            to[j] = tail[j - i];
+        }
+    }
+}
+
+inline __m128
+interpolateTableSSE2(const float* table,
+                     __m128 v)
+{
+    const __m128i bits = _mm_castps_si128(v);
+    int index[4];
+
+    _mm_storeu_si128( (__m128i*)index, _mm_srli_epi32(bits, 16) );
+
+    const __m128 frac = _mm_mul_ps( _mm_cvtepi32_ps( _mm_and_si128( bits, _mm_set1_epi32(0xffff) ) ), _mm_set1_ps(1.f / 65536.f) );
+    const __m128 lo = _mm_setr_ps(table[index[0]], table[index[1]], table[index[2]], table[index[3]]);
+    const __m128 hi = _mm_setr_ps(table[index[0] + 1], table[index[1] + 1], table[index[2] + 1], table[index[3] + 1]);
+    const __m128 result = _mm_add_ps( lo, _mm_mul_ps(_mm_sub_ps(hi, lo), frac) );
+
+    return selectSSE2(_mm_cmpunord_ps(v, v), v, result);
+}
+
+void
+interpolateFloatTableSSE2(const float* table,
+                          const float* from,
+                          float* to,
+                          int n)
+{
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps( to + i, interpolateTableSSE2( table, _mm_loadu_ps(from + i) ) );
+    }
+    if (i < n) {
+        float tail[4] = { 0.f, 0.f, 0.f, 0.f };
+        for (int j = i; j < n; ++j) {
+            tail[j - i] = from[j];
+        }
+        _mm_storeu_ps( tail, interpolateTableSSE2( table, _mm_loadu_ps(tail) ) );
+        for (int j = i; j < n; ++j) {
+            to[j] = tail[j - i];
+        }
+    }
+}
+
+#endif // NATRON_SIMD_SSE2
+
+#ifdef NATRON_SIMD_AVX2
+
+// Same algorithms as the SSE2 functions above, on 8 values
+
+NATRON_SIMD_TARGET_AVX2
+inline __m256
+log2AVX2(__m256 x)
+{
+    const __m256i bits = _mm256_castps_si256(x);
+    __m256i exponent = _mm256_sub_epi32( _mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127) );
+    __m256 m = _mm256_castsi256_ps( _mm256_or_si256( _mm256_and_si256( bits, _mm256_set1_epi32(0x007fffff) ), _mm256_set1_epi32(0x3f800000) ) );
+    const __m256 large = _mm256_cmp_ps(m, _mm256_set1_ps(1.41421356f), _CMP_GE_OQ);
+
+    m = _mm256_blendv_ps( m, _mm256_mul_ps( m, _mm256_set1_ps(0.5f) ), large );
+    exponent = _mm256_sub_epi32( exponent, _mm256_castps_si256(large) );
+
+    const __m256 one = _mm256_set1_ps(1.f);
+    const __m256 t = _mm256_div_ps( _mm256_sub_ps(m, one), _mm256_add_ps(m, one) );
+    const __m256 t2 = _mm256_mul_ps(t, t);
+    __m256 p = _mm256_set1_ps(kLog2C9);
+    p = _mm256_add_ps( _mm256_mul_ps(p, t2), _mm256_set1_ps(kLog2C7) );
+    p = _mm256_add_ps( _mm256_mul_ps(p, t2), _mm256_set1_ps(kLog2C5) );
+    p = _mm256_add_ps( _mm256_mul_ps(p, t2), _mm256_set1_ps(kLog2C3) );
+    p = _mm256_add_ps( _mm256_mul_ps(p, t2), _mm256_set1_ps(kLog2C1) );
+
+    return _mm256_add_ps( _mm256_cvtepi32_ps(exponent), _mm256_mul_ps(p, t) );
+}
+
+NATRON_SIMD_TARGET_AVX2
+inline __m256
+exp2AVX2(__m256 y)
+{
+    y = _mm256_min_ps( _mm256_max_ps( y, _mm256_set1_ps(-126.f) ), _mm256_set1_ps(128.f) );
+
+    const __m256i n = _mm256_cvtps_epi32(y);
+    const __m256 f = _mm256_sub_ps( y, _mm256_cvtepi32_ps(n) );
+    __m256 p = _mm256_set1_ps(kExp2C7);
+    p = _mm256_add_ps( _mm256_mul_ps(p, f), _mm256_set1_ps(kExp2C6) );
+    p = _mm256_add_ps( _mm256_mul_ps(p, f), _mm256_set1_ps(kExp2C5) );
+    p = _mm256_add_ps( _mm256_mul_ps(p, f), _mm256_set1_ps(kExp2C4) );
+    p = _mm256_add_ps( _mm256_mul_ps(p, f), _mm256_set1_ps(kExp2C3) );
+    p = _mm256_add_ps( _mm256_mul_ps(p, f), _mm256_set1_ps(kExp2C2) );
+    p = _mm256_add_ps( _mm256_mul_ps(p, f), _mm256_set1_ps(kExp2C1) );
+    p = _mm256_add_ps( _mm256_mul_ps(p, f), _mm256_set1_ps(1.f) );
+
+    const __m256 scale = _mm256_castsi256_ps( _mm256_slli_epi32(_mm256_add_epi32( n, _mm256_set1_epi32(127) ), 23) );
+
+    return _mm256_mul_ps(p, scale);
+}
+
+NATRON_SIMD_TARGET_AVX2
+void
+applyPowerTransferFunctionAVX2(const PowerTransferFunction& func,
+                               const float* from,
+                               float* to,
+                               int n)
+{
+    const __m256 linearSlope = _mm256_set1_ps(func.linearSlope);
+    const __m256 powInOffset = _mm256_set1_ps(func.powInOffset);
+    const __m256 powInScale = _mm256_set1_ps(func.powInScale);
+    const __m256 exponent = _mm256_set1_ps(func.exponent);
+    const __m256 powScale = _mm256_set1_ps(func.powScale);
+    const __m256 powOutOffset = _mm256_set1_ps(func.powOutOffset);
+    const __m256 breakPoint = _mm256_set1_ps(func.breakPoint);
+    const __m256 infinity = _mm256_set1_ps( std::numeric_limits<float>::infinity() );
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        const __m256 v = _mm256_loadu_ps(from + i);
+        const __m256 linear = _mm256_mul_ps( _mm256_max_ps( v, _mm256_setzero_ps() ), linearSlope );
+        const __m256 base = _mm256_mul_ps( _mm256_add_ps(v, powInOffset), powInScale );
+        const __m256 power = exp2AVX2( _mm256_mul_ps(log2AVX2(base), exponent) );
+        const __m256 curve = _mm256_add_ps( _mm256_mul_ps(power, powScale), powOutOffset );
+        const __m256 result = _mm256_blendv_ps( curve, linear, _mm256_cmp_ps(v, breakPoint, _CMP_LT_OQ) );
+        const __m256 keep = _mm256_or_ps( _mm256_cmp_ps(v, v, _CMP_UNORD_Q), _mm256_cmp_ps(v, infinity, _CMP_EQ_OQ) );
+        _mm256_storeu_ps( to + i, _mm256_blendv_ps(result, v, keep) );
+    }
+    applyPowerTransferFunctionSSE2(func, from + i, to + i, n - i);
+}
+
+NATRON_SIMD_TARGET_AVX2
+void
+interpolateFloatTableAVX2(const float* table,
+                          const float* from,
+                          float* to,
+                          int n)
+{
+    const __m256i lowBits = _mm256_set1_epi32(0xffff);
+    const __m256 fracScale = _mm256_set1_ps(1.f / 65536.f);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        const __m256 v = _mm256_loadu_ps(from + i);
+        const __m256i bits = _mm256_castps_si256(v);
+        const __m256i index = _mm256_srli_epi32(bits, 16);
+        const __m256 frac = _mm256_mul_ps( _mm256_cvtepi32_ps( _mm256_and_si256(bits, lowBits) ), fracScale );
+        const __m256 lo = _mm256_i32gather_ps(table, index, 4);
+        const __m256 hi = _mm256_i32gather_ps(table + 1, index, 4);
+        const __m256 result = _mm256_add_ps( lo, _mm256_mul_ps(_mm256_sub_ps(hi, lo), frac) );
+        _mm256_storeu_ps( to + i, _mm256_blendv_ps( result, v, _mm256_cmp_ps(v, v, _CMP_UNORD_Q) ) );
+    }
+    interpolateFloatTableSSE2(table, from + i, to + i, n - i);
+}
+
+#endif // NATRON_SIMD_AVX2
+} // anon namespace
+
+bool
+applyPowerTransferFunctionBatch(const PowerTransferFunction& func,
+                                const float* from,
+                                float* to,
+                                int n,
+                                SIMDLevelEnum level)
+{
+#ifdef NATRON_SIMD_SSE2
+#ifdef NATRON_SIMD_AVX2
+    if (level == eSIMDLevelAVX2) {
+        applyPowerTransferFunctionAVX2(func, from, to, n);
+
+        return true;
+    }
+#endif
+    if (level != eSIMDLevelNone) {
+        applyPowerTransferFunctionSSE2(func, from, to, n);
+
+        return true;
+    }
+#else
+    Q_UNUSED(func);
+    Q_UNUSED(from);
+    Q_UNUSED(to);
+    Q_UNUSED(n);
+    Q_UNUSED(level);
+#endif // NATRON_SIMD_SSE2
+
+    return false;
+}
+
+bool
+interpolateFloatTableBatch(const float* table,
+                           const float* from,
+                           float* to,
+                           int n,
+                           SIMDLevelEnum level)
+{
+#ifdef NATRON_SIMD_SSE2
+#ifdef NATRON_SIMD_AVX2
+    if (level == eSIMDLevelAVX2) {
+        interpolateFloatTableAVX2(table, from, to, n);
+
+        return true;
+    }
+#endif
+    if (level != eSIMDLevelNone) {
+        interpolateFloatTableSSE2(table, from, to, n);
+
+        return true;
+    }
+#else
+    Q_UNUSED(table);
+    Q_UNUSED(from);
+    Q_UNUSED(to);
+    Q_UNUSED(n);
+    Q_UNUSED(level);
+#endif // NATRON_SIMD_SSE2
+
+    return false;
+}
+} // namespace Color
+
+NATRON_NAMESPACE_EXIT
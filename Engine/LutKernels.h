@@ -0,0 +1,81 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_LUTKERNELS_H
+#define NATRON_ENGINE_LUTKERNELS_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include "Engine/CPUFeatures.h"
+
+NATRON_NAMESPACE_ENTER
+namespace Color {
+/**
+ * @brief A transfer function made of a linear segment near black followed by a power segment:
+ * f(v) = v < breakPoint ? max(v, 0) * linearSlope : powScale * pow( (v + powInOffset) * powInScale, exponent ) + powOutOffset
+ * The sRGB and Rec.709 curves have this form in both directions.
+ **/
+struct PowerTransferFunction
+{
+    float breakPoint;
+    float linearSlope;
+    float powInOffset;
+    float powInScale;
+    float exponent;
+    float powScale;
+    float powOutOffset;
+};
+
+/**
+ * @brief Applies func to the n values of from and writes them to to, which may be equal to from.
+ * pow() is evaluated with polynomial approximations of log2 and exp2, without any table lookup, so that
+ * the whole computation stays in vector registers. The relative error is below 1e-6 on the power segment.
+ * NaNs and +infinity are kept.
+ * Returns false if there is no SIMD kernel for this level, in which case nothing was written.
+ **/
+bool applyPowerTransferFunctionBatch(const PowerTransferFunction& func,
+                                     const float* from,
+                                     float* to,
+                                     int n,
+                                     SIMDLevelEnum level);
+
+/**
+ * @brief Interpolates the n values of from in table and writes the result to to, which may be equal to from.
+ * table has 0x10001 entries: entry i is the function at the float whose 16 high bits are i and whose 16 low
+ * bits are 0, the last entry repeats the previous one. The 16 low bits of the input select the position between
+ * two consecutive entries, hence the table covers the whole float range with a constant relative precision:
+ * on the positive values of the builtin curves of LutManager, the relative error stays below 2e-3.
+ * NaNs are kept.
+ * Returns false if there is no SIMD kernel for this level, in which case nothing was written.
+ **/
+bool interpolateFloatTableBatch(const float* table,
+                                const float* from,
+                                float* to,
+                                int n,
+                                SIMDLevelEnum level);
+} // namespace Color
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_LUTKERNELS_H
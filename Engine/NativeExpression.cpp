@@ -0,0 +1,1664 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "NativeExpression.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/make_shared.hpp>
+#include <boost/math/special_functions/fpclassify.hpp>
+
+#include "Engine/EffectInstance.h"
+#include "Engine/Knob.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/Node.h"
+#include "Engine/NodeGroup.h"
+
+#ifndef M_PI
+#define M_PI        3.14159265358979323846264338327950288   /* pi             */
+#endif
+#ifndef M_E
+#define M_E         2.71828182845904523536028747135266250   /* e              */
+#endif
+
+// Integers are stored in doubles: beyond that they would lose precision whereas Python uses longs
+#define NATIVE_EXPRESSION_MAX_INT 9007199254740992. // 2^53
+
+NATRON_NAMESPACE_ENTER
+
+namespace {
+/**
+ * @brief A Python int (or bool) or float
+ **/
+struct ExprValue
+{
+    double v;
+    bool isInt;
+
+    ExprValue()
+        : v(0.)
+        , isInt(true)
+    {
+    }
+
+    ExprValue(double v,
+              bool isInt)
+        : v(v)
+        , isInt(isInt)
+    {
+    }
+};
+
+struct ExprEvalArgs
+{
+    double time;
+    ViewIdx view;
+};
+
+inline bool
+isValidInt(double v)
+{
+    return std::fabs(v) <= NATIVE_EXPRESSION_MAX_INT;
+}
+
+inline bool
+isDigit(char c)
+{
+    return std::isdigit( (unsigned char)c ) != 0;
+}
+
+inline bool
+isNameChar(char c)
+{
+    return std::isalnum( (unsigned char)c ) || (c == '_');
+}
+
+inline bool
+isFinite(double v)
+{
+    return (boost::math::isfinite)(v);
+}
+
+class ExprNode
+{
+public:
+
+    virtual ~ExprNode()
+    {
+    }
+
+    virtual bool eval(const ExprEvalArgs& args, ExprValue* ret) const = 0;
+};
+
+typedef boost::shared_ptr<ExprNode> ExprNodePtr;
+
+class ConstantNode
+    : public ExprNode
+{
+    ExprValue _value;
+
+public:
+
+    ConstantNode(const ExprValue& value)
+        : _value(value)
+    {
+    }
+
+    virtual bool eval(const ExprEvalArgs& /*args*/,
+                      ExprValue* ret) const OVERRIDE FINAL
+    {
+        *ret = _value;
+
+        return true;
+    }
+};
+
+class FrameNode
+    : public ExprNode
+{
+public:
+
+    virtual bool eval(const ExprEvalArgs& args,
+                      ExprValue* ret) const OVERRIDE FINAL
+    {
+        // Python receives an int if the time is integral
+        ret->v = args.time;
+        ret->isInt = std::floor(args.time) == args.time;
+
+        return true;
+    }
+};
+
+class ViewNode
+    : public ExprNode
+{
+public:
+
+    virtual bool eval(const ExprEvalArgs& args,
+                      ExprValue* ret) const OVERRIDE FINAL
+    {
+        ret->v = (int)args.view;
+        ret->isInt = true;
+
+        return true;
+    }
+};
+
+enum UnaryOpEnum
+{
+    eUnaryOpMinus,
+    eUnaryOpPlus,
+    eUnaryOpNot
+};
+
+class UnaryNode
+    : public ExprNode
+{
+    UnaryOpEnum _op;
+    ExprNodePtr _operand;
+
+public:
+
+    UnaryNode(UnaryOpEnum op,
+              const ExprNodePtr& operand)
+        : _op(op)
+        , _operand(operand)
+    {
+    }
+
+    virtual bool eval(const ExprEvalArgs& args,
+                      ExprValue* ret) const OVERRIDE FINAL
+    {
+        if ( !_operand->eval(args, ret) ) {
+            return false;
+        }
+        switch (_op) {
+        case eUnaryOpMinus:
+            ret->v = -ret->v;
+            break;
+        case eUnaryOpPlus:
+            break;
+        case eUnaryOpNot:
+            ret->v = ret->v == 0. ? 1. : 0.;
+            ret->isInt = true;
+            break;
+        }
+
+        return true;
+    }
+};
+
+enum BinaryOpEnum
+{
+    eBinaryOpAdd,
+    eBinaryOpSub,
+    eBinaryOpMul,
+    eBinaryOpDiv,
+    eBinaryOpFloorDiv,
+    eBinaryOpMod,
+    eBinaryOpPow,
+    eBinaryOpLess,
+    eBinaryOpLessEqual,
+    eBinaryOpGreater,
+    eBinaryOpGreaterEqual,
+    eBinaryOpEqual,
+    eBinaryOpNotEqual
+};
+
+/**
+ * @brief Python 2 divmod on floats (see float_divmod in floatobject.c)
+ **/
+void
+floatDivMod(double a,
+            double b,
+            double* floorDiv,
+            double* mod)
+{
+    double m = std::fmod(a, b);
+    double div = (a - m) / b;
+
+    if (m != 0.) {
+        if ( (b < 0.) != (m < 0.) ) {
+            m += b;
+            div -= 1.;
+        }
+    } else {
+        m = b < 0. ? -0. : 0.;
+    }
+    double fdiv;
+    if (div != 0.) {
+        fdiv = std::floor(div);
+        if (div - fdiv > 0.5) {
+            fdiv += 1.;
+        }
+    } else {
+        fdiv = 0.;
+    }
+    *floorDiv = fdiv;
+    *mod = m;
+}
+
+/**
+ * @brief Python 2 divmod on ints: the quotient is rounded toward -inf and the remainder has the sign of b.
+ **/
+void
+intDivMod(double a,
+          double b,
+          double* floorDiv,
+          double* mod)
+{
+    long long ia = (long long)a;
+    long long ib = (long long)b;
+    long long q = ia / ib;
+    long long r = ia % ib;
+
+    if ( (r != 0) && ( (r < 0) != (ib < 0) ) ) {
+        r += ib;
+        q -= 1;
+    }
+    *floorDiv = (double)q;
+    *mod = (double)r;
+}
+
+bool
+evalPow(const ExprValue& a,
+        const ExprValue& b,
+        ExprValue* ret)
+{
+    if ( (a.v == 0.) && (b.v < 0.) ) {
+        // ZeroDivisionError
+        return false;
+    }
+    if ( a.isInt && b.isInt && (b.v >= 0.) ) {
+        double r = 1.;
+        double base = a.v;
+        long long e = (long long)b.v;
+        while (e > 0) {
+            if (e & 1) {
+                r *= base;
+                if ( !isValidInt(r) ) {
+                    return false;
+                }
+            }
+            e >>= 1;
+            if (e > 0) {
+                base *= base;
+                if ( !isValidInt(base) ) {
+                    return false;
+                }
+            }
+        }
+        *ret = ExprValue(r, true);
+
+        return true;
+    }
+    if ( (a.v < 0.) && (std::floor(b.v) != b.v) ) {
+        // ValueError: negative number cannot be raised to a fractional power
+        return false;
+    }
+    double r = std::pow(a.v, b.v);
+    if ( !isFinite(r) ) {
+        // OverflowError
+        return false;
+    }
+    *ret = ExprValue(r, false);
+
+    return true;
+}
+
+class BinaryNode
+    : public ExprNode
+{
+    BinaryOpEnum _op;
+    ExprNodePtr _a, _b;
+
+public:
+
+    BinaryNode(BinaryOpEnum op,
+               const ExprNodePtr& a,
+               const ExprNodePtr& b)
+        : _op(op)
+        , _a(a)
+        , _b(b)
+    {
+    }
+
+    virtual bool eval(const ExprEvalArgs& args,
+                      ExprValue* ret) const OVERRIDE FINAL
+    {
+        ExprValue a, b;
+
+        if ( !_a->eval(args, &a) || !_b->eval(args, &b) ) {
+            return false;
+        }
+        bool bothInt = a.isInt && b.isInt;
+        switch (_op) {
+        case eBinaryOpAdd:
+            *ret = ExprValue(a.v + b.v, bothInt);
+            break;
+        case eBinaryOpSub:
+            *ret = ExprValue(a.v - b.v, bothInt);
+            break;
+        case eBinaryOpMul:
+            *ret = ExprValue(a.v * b.v, bothInt);
+            break;
+        case eBinaryOpDiv:
+        case eBinaryOpFloorDiv:
+        case eBinaryOpMod: {
+            if (b.v == 0.) {
+                // ZeroDivisionError
+                return false;
+            }
+#if PY_MAJOR_VERSION >= 3
+            // Python 3 / is always a true division
+            if (_op == eBinaryOpDiv) {
+#else
+            if ( (_op == eBinaryOpDiv) && !bothInt ) {
+#endif
+                *ret = ExprValue(a.v / b.v, false);
+                break;
+            }
+            double floorDiv, mod;
+            if (bothInt) {
+                intDivMod(a.v, b.v, &floorDiv, &mod);
+            } else {
+                floatDivMod(a.v, b.v, &floorDiv, &mod);
+            }
+            *ret = ExprValue(_op == eBinaryOpMod ? mod : floorDiv, bothInt);
+            break;
+        }
+        case eBinaryOpPow:
+            if ( !evalPow(a, b, ret) ) {
+                return false;
+            }
+            break;
+        case eBinaryOpLess:
+            *ret = ExprValue(a.v < b.v, true);
+            break;
+        case eBinaryOpLessEqual:
+            *ret = ExprValue(a.v <= b.v, true);
+            break;
+        case eBinaryOpGreater:
+            *ret = ExprValue(a.v > b.v, true);
+            break;
+        case eBinaryOpGreaterEqual:
+            *ret = ExprValue(a.v >= b.v, true);
+            break;
+        case eBinaryOpEqual:
+            *ret = ExprValue(a.v == b.v, true);
+            break;
+        case eBinaryOpNotEqual:
+            *ret = ExprValue(a.v != b.v, true);
+            break;
+        } // switch
+        if ( ret->isInt ? !isValidInt(ret->v) : !isFinite(ret->v) ) {
+            return false;
+        }
+
+        return true;
+    } // eval
+};
+
+/**
+ * @brief "a and b", "a or b": like in Python the result is one of the operands
+ **/
+class BoolOpNode
+    : public ExprNode
+{
+    bool _isAnd;
+    ExprNodePtr _a, _b;
+
+public:
+
+    BoolOpNode(bool isAnd,
+               const ExprNodePtr& a,
+               const ExprNodePtr& b)
+        : _isAnd(isAnd)
+        , _a(a)
+        , _b(b)
+    {
+    }
+
+    virtual bool eval(const ExprEvalArgs& args,
+                      ExprValue* ret) const OVERRIDE FINAL
+    {
+        if ( !_a->eval(args, ret) ) {
+            return false;
+        }
+        bool isTrue = ret->v != 0.;
+        if (isTrue != _isAnd) {
+            return true;
+        }
+
+        return _b->eval(args, ret);
+    }
+};
+
+/**
+ * @brief "a if condition else b"
+ **/
+class ConditionalNode
+    : public ExprNode
+{
+    ExprNodePtr _condition, _a, _b;
+
+public:
+
+    ConditionalNode(const ExprNodePtr& condition,
+                    const ExprNodePtr& a,
+                    const ExprNodePtr& b)
+        : _condition(condition)
+        , _a(a)
+        , _b(b)
+    {
+    }
+
+    virtual bool eval(const ExprEvalArgs& args,
+                      ExprValue* ret) const OVERRIDE FINAL
+    {
+        ExprValue c;
+
+        if ( !_condition->eval(args, &c) ) {
+            return false;
+        }
+
+        return c.v != 0. ? _a->eval(args, ret) : _b->eval(args, ret);
+    }
+};
+
+enum FunctionEnum
+{
+    eFunctionAbs,
+    eFunctionMin,
+    eFunctionMax,
+    eFunctionInt,
+    eFunctionFloat,
+    eFunctionRound,
+    eFunctionSin,
+    eFunctionCos,
+    eFunctionTan,
+    eFunctionAsin,
+    eFunctionAcos,
+    eFunctionAtan,
+    eFunctionAtan2,
+    eFunctionSinh,
+    eFunctionCosh,
+    eFunctionTanh,
+    eFunctionExp,
+    eFunctionLog,
+    eFunctionLog10,
+    eFunctionSqrt,
+    eFunctionPow,
+    eFunctionFabs,
+    eFunctionFloor,
+    eFunctionCeil,
+    eFunctionFmod,
+    eFunctionHypot,
+    eFunctionDegrees,
+    eFunctionRadians
+};
+
+struct FunctionDesc
+{
+    const char* name;
+    FunctionEnum function;
+    int minArgs;
+    int maxArgs; //< -1 for any
+};
+
+const FunctionDesc functions[] = {
+    {"abs", eFunctionAbs, 1, 1},
+    {"min", eFunctionMin, 2, -1},
+    {"max", eFunctionMax, 2, -1},
+    {"int", eFunctionInt, 1, 1},
+    {"float", eFunctionFloat, 1, 1},
+    {"round", eFunctionRound, 1, 1},
+    {"sin", eFunctionSin, 1, 1},
+    {"cos", eFunctionCos, 1, 1},
+    {"tan", eFunctionTan, 1, 1},
+    {"asin", eFunctionAsin, 1, 1},
+    {"acos", eFunctionAcos, 1, 1},
+    {"atan", eFunctionAtan, 1, 1},
+    {"atan2", eFunctionAtan2, 2, 2},
+    {"sinh", eFunctionSinh, 1, 1},
+    {"cosh", eFunctionCosh, 1, 1},
+    {"tanh", eFunctionTanh, 1, 1},
+    {"exp", eFunctionExp, 1, 1},
+    {"log", eFunctionLog, 1, 2},
+    {"log10", eFunctionLog10, 1, 1},
+    {"sqrt", eFunctionSqrt, 1, 1},
+    {"pow", eFunctionPow, 2, 2},
+    {"fabs", eFunctionFabs, 1, 1},
+    {"floor", eFunctionFloor, 1, 1},
+    {"ceil", eFunctionCeil, 1, 1},
+    {"fmod", eFunctionFmod, 2, 2},
+    {"hypot", eFunctionHypot, 2, 2},
+    {"degrees", eFunctionDegrees, 1, 1},
+    {"radians", eFunctionRadians, 1, 1},
+    {0, eFunctionAbs, 0, 0}
+};
+
+const FunctionDesc*
+findFunction(const std::string& name)
+{
+    for (const FunctionDesc* f = functions; f->name; ++f) {
+        if (name == f->name) {
+            return f;
+        }
+    }
+
+    return 0;
+}
+
+class FunctionNode
+    : public ExprNode
+{
+    FunctionEnum _function;
+    std::vector<ExprNodePtr> _args;
+
+public:
+
+    FunctionNode(FunctionEnum function,
+                 const std::vector<ExprNodePtr>& args)
+        : _function(function)
+        , _args(args)
+    {
+    }
+
+    virtual bool eval(const ExprEvalArgs& args,
+                      ExprValue* ret) const OVERRIDE FINAL
+    {
+        ExprValue a, b;
+
+        if ( !_args[0]->eval(args, &a) ) {
+            return false;
+        }
+        if ( (_args.size() > 1) && ( (_function != eFunctionMin) && (_function != eFunctionMax) ) ) {
+            if ( !_args[1]->eval(args, &b) ) {
+                return false;
+            }
+        }
+
+        double r = 0.;
+        switch (_function) {
+        case eFunctionAbs:
+            *ret = ExprValue(std::fabs(a.v), a.isInt);
+
+            return true;
+        case eFunctionMin:
+        case eFunctionMax: {
+            // Like Python, returns the first of the extremal operands, with its type
+            *ret = a;
+            for (std::size_t i = 1; i < _args.size(); ++i) {
+                if ( !_args[i]->eval(args, &b) ) {
+                    return false;
+                }
+                if ( (_function == eFunctionMin) ? (b.v < ret->v) : (b.v > ret->v) ) {
+                    *ret = b;
+                }
+            }
+
+            return true;
+        }
+        case eFunctionInt: {
+            double t = a.v < 0. ? std::ceil(a.v) : std::floor(a.v);
+            if ( !isValidInt(t) ) {
+                return false;
+            }
+            *ret = ExprValue(t, true);
+
+            return true;
+        }
+        case eFunctionFloat:
+            r = a.v;
+            break;
+        case eFunctionRound: {
+            // x - floor(x) is exact
+            r = std::floor(a.v);
+            double diff = a.v - r;
+#if PY_MAJOR_VERSION >= 3
+            // Python 3 rounds half to even and returns an int
+            if ( (diff > 0.5) || ( (diff == 0.5) && (std::fmod(r, 2.) != 0.) ) ) {
+                r += 1.;
+            }
+            if ( !isValidInt(r) ) {
+                return false;
+            }
+            *ret = ExprValue(r, true);
+
+            return true;
+#else
+            // Python 2 rounds half away from zero and returns a float
+            if ( (diff > 0.5) || ( (diff == 0.5) && (a.v > 0.) ) ) {
+                r += 1.;
+            }
+            break;
+#endif
+        }
+        case eFunctionSin:
+            r = std::sin(a.v);
+            break;
+        case eFunctionCos:
+            r = std::cos(a.v);
+            break;
+        case eFunctionTan:
+            r = std::tan(a.v);
+            break;
+        case eFunctionAsin:
+        case eFunctionAcos:
+            if ( (a.v < -1.) || (a.v > 1.) ) {
+                return false;
+            }
+            r = _function == eFunctionAsin ? std::asin(a.v) : std::acos(a.v);
+            break;
+        case eFunctionAtan:
+            r = std::atan(a.v);
+            break;
+        case eFunctionAtan2:
+            r = std::atan2(a.v, b.v);
+            break;
+        case eFunctionSinh:
+            r = std::sinh(a.v);
+            break;
+        case eFunctionCosh:
+            r = std::cosh(a.v);
+            break;
+        case eFunctionTanh:
+            r = std::tanh(a.v);
+            break;
+        case eFunctionExp:
+            r = std::exp(a.v);
+            break;
+        case eFunctionLog:
+            if (a.v <= 0.) {
+                return false;
+            }
+            r = std::log(a.v);
+            if (_args.size() > 1) {
+                if ( (b.v <= 0.) || (b.v == 1.) ) {
+                    return false;
+                }
+                r /= std::log(b.v);
+            }
+            break;
+        case eFunctionLog10:
+            if (a.v <= 0.) {
+                return false;
+            }
+            r = std::log10(a.v);
+            break;
+        case eFunctionSqrt:
+            if (a.v < 0.) {
+                return false;
+            }
+            r = std::sqrt(a.v);
+            break;
+        case eFunctionPow:
+            if ( ( (a.v == 0.) && (b.v < 0.) ) || ( (a.v < 0.) && (std::floor(b.v) != b.v) ) ) {
+                return false;
+            }
+            r = std::pow(a.v, b.v);
+            break;
+        case eFunctionFabs:
+            r = std::fabs(a.v);
+            break;
+        case eFunctionFloor:
+            r = std::floor(a.v);
+            break;
+        case eFunctionCeil:
+            r = std::ceil(a.v);
+            break;
+        case eFunctionFmod:
+            if (b.v == 0.) {
+                return false;
+            }
+            r = std::fmod(a.v, b.v);
+            break;
+        case eFunctionHypot:
+            r = std::sqrt(a.v * a.v + b.v * b.v);
+            break;
+        case eFunctionDegrees:
+            r = a.v * 180. / M_PI;
+            break;
+        case eFunctionRadians:
+            r = a.v * M_PI / 180.;
+            break;
+        } // switch
+        if ( !isFinite(r) ) {
+            // ValueError or OverflowError
+            return false;
+        }
+        // The functions of the math module return floats
+        *ret = ExprValue(r, false);
+
+        return true;
+    } // eval
+};
+
+enum KnobTypeEnum
+{
+    eKnobTypeInt,
+    eKnobTypeBool,
+    eKnobTypeDouble
+};
+
+enum KnobCallEnum
+{
+    eKnobCallGet, //< get(), getValue(dimension)
+    eKnobCallGetAtTime, //< get(frame), getValueAtTime(frame, dimension)
+    eKnobCallCurve //< curve(frame, dimension)
+};
+
+/**
+ * @brief Reads a parameter with the same functions as the Python API
+ **/
+class KnobValueNode
+    : public ExprNode
+{
+    KnobIWPtr _knob;
+    NodeWPtr _node;
+    KnobTypeEnum _type;
+    KnobCallEnum _call;
+    int _dimension;
+    ExprNodePtr _time;
+
+public:
+
+    KnobValueNode(const KnobIPtr& knob,
+                  const NodePtr& node,
+                  KnobTypeEnum type,
+                  KnobCallEnum call,
+                  int dimension,
+                  const ExprNodePtr& time)
+        : _knob(knob)
+        , _node(node)
+        , _type(type)
+        , _call(call)
+        , _dimension(dimension)
+        , _time(time)
+    {
+    }
+
+    virtual bool eval(const ExprEvalArgs& args,
+                      ExprValue* ret) const OVERRIDE FINAL
+    {
+        double time = 0.;
+
+        if (_time) {
+            ExprValue t;
+            if ( !_time->eval(args, &t) ) {
+                return false;
+            }
+            time = t.v;
+        }
+
+        // The Python variable of a deactivated node is not declared: let Python report the error
+        KnobIPtr knob = _knob.lock();
+        NodePtr node = _node.lock();
+        if ( !knob || !node || !node->isActivated() ) {
+            return false;
+        }
+        if ( _dimension >= knob->getDimension() ) {
+            return false;
+        }
+
+        if (_call == eKnobCallCurve) {
+            *ret = ExprValue(knob->getRawCurveValueAt(time, ViewSpec::current(), _dimension), false);
+
+            return true;
+        }
+
+        switch (_type) {
+        case eKnobTypeInt: {
+            Knob<int>* k = static_cast<Knob<int>*>( knob.get() );
+            *ret = ExprValue(_call == eKnobCallGet ? k->getValue(_dimension) : k->getValueAtTime(time, _dimension), true);
+            break;
+        }
+        case eKnobTypeBool: {
+            Knob<bool>* k = static_cast<Knob<bool>*>( knob.get() );
+            *ret = ExprValue(_call == eKnobCallGet ? k->getValue(_dimension) : k->getValueAtTime(time, _dimension), true);
+            break;
+        }
+        case eKnobTypeDouble: {
+            Knob<double>* k = static_cast<Knob<double>*>( knob.get() );
+            *ret = ExprValue(_call == eKnobCallGet ? k->getValue(_dimension) : k->getValueAtTime(time, _dimension), false);
+            break;
+        }
+        }
+
+        return true;
+    } // eval
+};
+
+/************************************ Parser ************************************/
+
+enum TokenTypeEnum
+{
+    eTokenTypeNumber,
+    eTokenTypeName,
+    eTokenTypeOperator,
+    eTokenTypeEnd
+};
+
+struct Token
+{
+    TokenTypeEnum type;
+    std::string text;
+    ExprValue number;
+};
+
+/**
+ * @brief Thrown when the expression cannot be compiled: it is not necessarily invalid, but it must be run by Python
+ **/
+class UnsupportedExpression
+    : public std::runtime_error
+{
+public:
+
+    UnsupportedExpression(const std::string& what)
+        : std::runtime_error(what)
+    {
+    }
+};
+
+void
+tokenize(const std::string& expr,
+         std::vector<Token>* tokens)
+{
+    std::size_t i = 0;
+
+    while ( i < expr.size() ) {
+        char c = expr[i];
+        if ( (c == ' ') || (c == '\t') ) {
+            ++i;
+            continue;
+        }
+        Token t;
+        if ( isDigit(c) || ( (c == '.') && ( i + 1 < expr.size() ) && isDigit(expr[i + 1]) ) ) {
+            std::size_t start = i;
+            bool isInt = true;
+            while ( i < expr.size() && isDigit(expr[i]) ) {
+                ++i;
+            }
+            if ( ( i < expr.size() ) && (expr[i] == '.') ) {
+                isInt = false;
+                ++i;
+                while ( i < expr.size() && isDigit(expr[i]) ) {
+                    ++i;
+                }
+            }
+            if ( ( i < expr.size() ) && ( (expr[i] == 'e') || (expr[i] == 'E') ) ) {
+                std::size_t expStart = i;
+                ++i;
+                if ( ( i < expr.size() ) && ( (expr[i] == '+') || (expr[i] == '-') ) ) {
+                    ++i;
+                }
+                if ( ( i >= expr.size() ) || !isDigit(expr[i]) ) {
+                    i = expStart;
+                } else {
+                    isInt = false;
+                    while ( i < expr.size() && isDigit(expr[i]) ) {
+                        ++i;
+                    }
+                }
+            }
+            // Hexadecimal, long (L suffix) or complex (j suffix) literals
+            if ( ( i < expr.size() ) && isNameChar(expr[i]) ) {
+                throw UnsupportedExpression("unsupported number literal");
+            }
+            t.text = expr.substr(start, i - start);
+            // Leading zeroes denote octal numbers in Python 2
+            if ( isInt && (t.text.size() > 1) && (t.text[0] == '0') ) {
+                throw UnsupportedExpression("unsupported octal literal");
+            }
+            t.type = eTokenTypeNumber;
+            t.number = ExprValue(std::strtod(t.text.c_str(), 0), isInt);
+            if ( isInt ? !isValidInt(t.number.v) : !isFinite(t.number.v) ) {
+                throw UnsupportedExpression("number out of range");
+            }
+        } else if ( isNameChar(c) ) {
+            std::size_t start = i;
+            while ( i < expr.size() && isNameChar(expr[i]) ) {
+                ++i;
+            }
+            t.type = eTokenTypeName;
+            t.text = expr.substr(start, i - start);
+        } else {
+            static const char* operators[] = {
+                "**", "//", "<=", ">=", "==", "!=",
+                "+", "-", "*", "/", "%", "<", ">", "(", ")", ",", ".", 0
+            };
+            t.type = eTokenTypeOperator;
+            for (const char** op = operators; *op; ++op) {
+                if (expr.compare(i, std::string(*op).size(), *op) == 0) {
+                    t.text = *op;
+                    break;
+                }
+            }
+            if ( t.text.empty() ) {
+                throw UnsupportedExpression(std::string("unsupported character: ") + c);
+            }
+            i += t.text.size();
+        }
+        tokens->push_back(t);
+    }
+    Token end;
+    end.type = eTokenTypeEnd;
+    tokens->push_back(end);
+} // tokenize
+
+/**
+ * @brief What a Python name or attribute refers to while parsing
+ **/
+struct Operand
+{
+    enum KindEnum
+    {
+        eKindValue, //< a number
+        eKindNode, //< a node, its attributes are its parameters and its children if it is a group
+        eKindCollection, //< thisGroup when the node is at the root of the project: its attributes are the nodes
+        eKindParam, //< a parameter
+        eKindParamMethod, //< a bound method of a parameter
+        eKindTuple, //< the return value of get() of a parameter with several dimensions
+        eKindFunction //< a function of the math module or a builtin
+    };
+
+    KindEnum kind;
+    ExprNodePtr value;
+    NodePtr node;
+    NodeCollectionPtr collection;
+    KnobIPtr knob;
+    std::string method;
+    ExprNodePtr time; //< for eKindTuple, the frame passed to get() if any
+    const FunctionDesc* function;
+
+    Operand()
+        : kind(eKindValue)
+        , value()
+        , node()
+        , collection()
+        , knob()
+        , method()
+        , time()
+        , function(0)
+    {
+    }
+};
+
+class Parser
+{
+    std::vector<Token> _tokens;
+    std::size_t _pos;
+    KnobIPtr _knob;
+    NodePtr _node;
+    NodeCollectionPtr _collection;
+    int _dimension;
+
+public:
+
+    Parser(const std::string& expr,
+           const KnobIPtr& knob,
+           int dimension)
+        : _tokens()
+        , _pos(0)
+        , _knob(knob)
+        , _node()
+        , _collection()
+        , _dimension(dimension)
+    {
+        tokenize(expr, &_tokens);
+        if (knob) {
+            EffectInstance* effect = dynamic_cast<EffectInstance*>( knob->getHolder() );
+            if (effect) {
+                _node = effect->getNode();
+            }
+            if (!_node) {
+                throw UnsupportedExpression("the parameter does not belong to a node");
+            }
+            _collection = _node->getGroup();
+        }
+    }
+
+    ExprNodePtr parse()
+    {
+        ExprNodePtr ret = parseTest();
+
+        if (current().type != eTokenTypeEnd) {
+            throw UnsupportedExpression("unexpected token: " + current().text);
+        }
+
+        return ret;
+    }
+
+private:
+
+    const Token& current() const
+    {
+        return _tokens[_pos];
+    }
+
+    bool isOperator(const char* op) const
+    {
+        return current().type == eTokenTypeOperator && current().text == op;
+    }
+
+    bool isKeyword(const char* keyword) const
+    {
+        return current().type == eTokenTypeName && current().text == keyword;
+    }
+
+    void expectOperator(const char* op)
+    {
+        if ( !isOperator(op) ) {
+            throw UnsupportedExpression(std::string("expected ") + op);
+        }
+        ++_pos;
+    }
+
+    // test: or_test ['if' or_test 'else' test]
+    ExprNodePtr parseTest()
+    {
+        ExprNodePtr a = parseOrTest();
+
+        if ( isKeyword("if") ) {
+            ++_pos;
+            ExprNodePtr condition = parseOrTest();
+            if ( !isKeyword("else") ) {
+                throw UnsupportedExpression("expected else");
+            }
+            ++_pos;
+            ExprNodePtr b = parseTest();
+
+            return boost::make_shared<ConditionalNode>(condition, a, b);
+        }
+
+        return a;
+    }
+
+    ExprNodePtr parseOrTest()
+    {
+        ExprNodePtr a = parseAndTest();
+
+        while ( isKeyword("or") ) {
+            ++_pos;
+            a = boost::make_shared<BoolOpNode>(false, a, parseAndTest());
+        }
+
+        return a;
+    }
+
+    ExprNodePtr parseAndTest()
+    {
+        ExprNodePtr a = parseNotTest();
+
+        while ( isKeyword("and") ) {
+            ++_pos;
+            a = boost::make_shared<BoolOpNode>(true, a, parseNotTest());
+        }
+
+        return a;
+    }
+
+    ExprNodePtr parseNotTest()
+    {
+        if ( isKeyword("not") ) {
+            ++_pos;
+
+            return boost::make_shared<UnaryNode>(eUnaryOpNot, parseNotTest());
+        }
+
+        return parseComparison();
+    }
+
+    bool parseComparisonOperator(BinaryOpEnum* op)
+    {
+        if ( isOperator("<") ) {
+            *op = eBinaryOpLess;
+        } else if ( isOperator("<=") ) {
+            *op = eBinaryOpLessEqual;
+        } else if ( isOperator(">") ) {
+            *op = eBinaryOpGreater;
+        } else if ( isOperator(">=") ) {
+            *op = eBinaryOpGreaterEqual;
+        } else if ( isOperator("==") ) {
+            *op = eBinaryOpEqual;
+        } else if ( isOperator("!=") ) {
+            *op = eBinaryOpNotEqual;
+        } else {
+            return false;
+        }
+        ++_pos;
+
+        return true;
+    }
+
+    ExprNodePtr parseComparison()
+    {
+        ExprNodePtr a = parseArith();
+        BinaryOpEnum op;
+
+        if ( parseComparisonOperator(&op) ) {
+            a = boost::make_shared<BinaryNode>(op, a, parseArith());
+            if ( parseComparisonOperator(&op) ) {
+                throw UnsupportedExpression("chained comparisons are not supported");
+            }
+        }
+
+        return a;
+    }
+
+    ExprNodePtr parseArith()
+    {
+        ExprNodePtr a = parseTerm();
+
+        for (;;) {
+            if ( isOperator("+") ) {
+                ++_pos;
+                a = boost::make_shared<BinaryNode>(eBinaryOpAdd, a, parseTerm());
+            } else if ( isOperator("-") ) {
+                ++_pos;
+                a = boost::make_shared<BinaryNode>(eBinaryOpSub, a, parseTerm());
+            } else {
+                return a;
+            }
+        }
+    }
+
+    ExprNodePtr parseTerm()
+    {
+        ExprNodePtr a = parseFactor();
+
+        for (;;) {
+            BinaryOpEnum op;
+            if ( isOperator("*") ) {
+                op = eBinaryOpMul;
+            } else if ( isOperator("/") ) {
+                op = eBinaryOpDiv;
+            } else if ( isOperator("//") ) {
+                op = eBinaryOpFloorDiv;
+            } else if ( isOperator("%") ) {
+                op = eBinaryOpMod;
+            } else {
+                return a;
+            }
+            ++_pos;
+            a = boost::make_shared<BinaryNode>(op, a, parseFactor());
+        }
+    }
+
+    ExprNodePtr parseFactor()
+    {
+        if ( isOperator("-") ) {
+            ++_pos;
+
+            return boost::make_shared<UnaryNode>(eUnaryOpMinus, parseFactor());
+        } else if ( isOperator("+") ) {
+            ++_pos;
+
+            return boost::make_shared<UnaryNode>(eUnaryOpPlus, parseFactor());
+        }
+
+        return parsePower();
+    }
+
+    // power: postfix ['**' factor], ** is right-associative and binds tighter than the unary operator on its left
+    ExprNodePtr parsePower()
+    {
+        ExprNodePtr a = toValue( parsePostfix() );
+
+        if ( isOperator("**") ) {
+            ++_pos;
+
+            return boost::make_shared<BinaryNode>(eBinaryOpPow, a, parseFactor());
+        }
+
+        return a;
+    }
+
+    ExprNodePtr toValue(const Operand& operand) const
+    {
+        if (operand.kind != Operand::eKindValue) {
+            throw UnsupportedExpression("the expression does not return a number");
+        }
+
+        return operand.value;
+    }
+
+    Operand parsePostfix()
+    {
+        Operand operand = parseAtom();
+
+        for (;;) {
+            if ( isOperator(".") ) {
+                ++_pos;
+                if (current().type != eTokenTypeName) {
+                    throw UnsupportedExpression("expected an attribute name");
+                }
+                std::string name = current().text;
+                ++_pos;
+                operand = getAttribute(operand, name);
+            } else if ( isOperator("(") ) {
+                ++_pos;
+                std::vector<ExprNodePtr> args;
+                if ( !isOperator(")") ) {
+                    for (;;) {
+                        args.push_back( parseTest() );
+                        if ( isOperator(",") ) {
+                            ++_pos;
+                        } else {
+                            break;
+                        }
+                    }
+                }
+                expectOperator(")");
+                operand = call(operand, args);
+            } else {
+                return operand;
+            }
+        }
+    }
+
+    Operand parseAtom()
+    {
+        const Token& t = current();
+
+        if (t.type == eTokenTypeNumber) {
+            ++_pos;
+            Operand ret;
+            ret.value = boost::make_shared<ConstantNode>(t.number);
+
+            return ret;
+        } else if ( isOperator("(") ) {
+            ++_pos;
+            ExprNodePtr value = parseTest();
+            expectOperator(")");
+            Operand ret;
+            ret.value = value;
+
+            return ret;
+        } else if (t.type == eTokenTypeName) {
+            ++_pos;
+
+            return resolveName(t.text);
+        }
+
+        throw UnsupportedExpression("unexpected token: " + t.text);
+    }
+
+    static Operand makeConstant(double v,
+                                bool isInt)
+    {
+        Operand ret;
+
+        ret.value = boost::make_shared<ConstantNode>( ExprValue(v, isInt) );
+
+        return ret;
+    }
+
+    static NodePtr findNodeInCollection(const NodeCollectionPtr& collection,
+                                        const std::string& name)
+    {
+        if (!collection) {
+            return NodePtr();
+        }
+        NodesList nodes = collection->getNodes();
+        for (NodesList::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+            if ( (*it)->isActivated() && !(*it)->getParentMultiInstance() && ( (*it)->getScriptName_mt_safe() == name ) ) {
+                return *it;
+            }
+        }
+
+        return NodePtr();
+    }
+
+    // Follows the variables declared by KnobHelperPrivate::declarePythonVariables, which shadow the globals
+    Operand resolveName(const std::string& name) const
+    {
+        Operand ret;
+
+        if (_knob) {
+            if (name == "thisParam") {
+                ret.kind = Operand::eKindParam;
+                ret.knob = _knob;
+                ret.node = _node;
+
+                return ret;
+            } else if (name == "curve") {
+                ret.kind = Operand::eKindParamMethod;
+                ret.knob = _knob;
+                ret.node = _node;
+                ret.method = name;
+
+                return ret;
+            } else if (name == "thisNode") {
+                ret.kind = Operand::eKindNode;
+                ret.node = _node;
+
+                return ret;
+            } else if (name == "thisGroup") {
+                NodeGroup* isGroup = dynamic_cast<NodeGroup*>( _collection.get() );
+                if (isGroup) {
+                    ret.kind = Operand::eKindNode;
+                    ret.node = isGroup->getNode();
+                } else {
+                    ret.kind = Operand::eKindCollection;
+                    ret.collection = _collection;
+                }
+
+                return ret;
+            } else if ( (name == "random") || (name == "randomInt") || (name == "app") ) {
+                throw UnsupportedExpression(name + " is not supported");
+            }
+        }
+        if (name == "dimension") {
+            return makeConstant(_dimension, true);
+        }
+        NodePtr sibling = findNodeInCollection(_collection, name);
+        if (sibling) {
+            ret.kind = Operand::eKindNode;
+            ret.node = sibling;
+
+            return ret;
+        }
+        if (name == "frame") {
+            ret.value = boost::make_shared<FrameNode>();
+
+            return ret;
+        } else if (name == "view") {
+            ret.value = boost::make_shared<ViewNode>();
+
+            return ret;
+        } else if (name == "True") {
+            return makeConstant(1., true);
+        } else if (name == "False") {
+            return makeConstant(0., true);
+        } else if (name == "pi") {
+            return makeConstant(M_PI, false);
+        } else if (name == "e") {
+            return makeConstant(M_E, false);
+        }
+        const FunctionDesc* function = findFunction(name);
+        if (function) {
+            ret.kind = Operand::eKindFunction;
+            ret.function = function;
+
+            return ret;
+        }
+
+        throw UnsupportedExpression("unknown name: " + name);
+    } // resolveName
+
+    static bool isSupportedKnob(const KnobIPtr& knob)
+    {
+        // Only the types whose Python class has the get() and getValue() functions
+        return dynamic_cast<KnobDouble*>( knob.get() ) || dynamic_cast<KnobColor*>( knob.get() ) ||
+               dynamic_cast<KnobInt*>( knob.get() ) || dynamic_cast<KnobBool*>( knob.get() ) ||
+               dynamic_cast<KnobChoice*>( knob.get() );
+    }
+
+    Operand getAttribute(const Operand& operand,
+                         const std::string& name) const
+    {
+        Operand ret;
+
+        switch (operand.kind) {
+        case Operand::eKindCollection: {
+            ret.node = findNodeInCollection(operand.collection, name);
+            if (!ret.node) {
+                throw UnsupportedExpression("unknown node: " + name);
+            }
+            ret.kind = Operand::eKindNode;
+
+            return ret;
+        }
+        case Operand::eKindNode: {
+            // A group also has its children nodes as attributes
+            NodeGroupPtr isGroup = boost::dynamic_pointer_cast<NodeGroup>( operand.node->getEffectInstance() );
+            NodePtr child = isGroup ? findNodeInCollection(isGroup, name) : NodePtr();
+            KnobIPtr knob = operand.node->getKnobByName(name);
+            if (child && knob) {
+                throw UnsupportedExpression("ambiguous attribute: " + name);
+            }
+            if (child) {
+                ret.kind = Operand::eKindNode;
+                ret.node = child;
+
+                return ret;
+            }
+            if ( !knob || !isSupportedKnob(knob) ) {
+                throw UnsupportedExpression("unsupported parameter: " + name);
+            }
+            ret.kind = Operand::eKindParam;
+            ret.knob = knob;
+            ret.node = operand.node;
+
+            return ret;
+        }
+        case Operand::eKindParam:
+            if ( (name == "get") || (name == "getValue") || (name == "getValueAtTime") || (name == "curve") ) {
+                ret = operand;
+                ret.kind = Operand::eKindParamMethod;
+                ret.method = name;
+
+                return ret;
+            }
+            break;
+        case Operand::eKindTuple: {
+            bool isColor = dynamic_cast<KnobColor*>( operand.knob.get() ) != 0;
+            int nDims = operand.knob->getDimension();
+            static const char* xyz[] = { "x", "y", "z", 0 };
+            static const char* rgba[] = { "r", "g", "b", "a", 0 };
+            const char** members = isColor ? rgba : xyz;
+            for (int i = 0; members[i]; ++i) {
+                if (name != members[i]) {
+                    continue;
+                }
+                if ( isColor && (i == 3) && (nDims == 3) ) {
+                    // ColorParam.get() returns an alpha of 1 for RGB colors
+                    return makeConstant(1., false);
+                }
+                if (i >= nDims) {
+                    break;
+                }
+                ret.value = makeKnobValue(operand.knob, operand.node, operand.time ? eKnobCallGetAtTime : eKnobCallGet, i, operand.time);
+
+                return ret;
+            }
+            break;
+        }
+        case Operand::eKindValue:
+        case Operand::eKindParamMethod:
+        case Operand::eKindFunction:
+            break;
+        } // switch
+
+        throw UnsupportedExpression("unsupported attribute: " + name);
+    } // getAttribute
+
+    static ExprNodePtr makeKnobValue(const KnobIPtr& knob,
+                                     const NodePtr& node,
+                                     KnobCallEnum call,
+                                     int dimension,
+                                     const ExprNodePtr& time)
+    {
+        KnobTypeEnum type;
+
+        if ( dynamic_cast<Knob<int>*>( knob.get() ) ) {
+            type = eKnobTypeInt;
+        } else if ( dynamic_cast<Knob<bool>*>( knob.get() ) ) {
+            type = eKnobTypeBool;
+        } else {
+            assert( dynamic_cast<Knob<double>*>( knob.get() ) );
+            type = eKnobTypeDouble;
+        }
+
+        return boost::make_shared<KnobValueNode>(knob, node, type, call, dimension, time);
+    }
+
+    /**
+     * @brief Only constant dimensions are supported so that they can be checked against the knob
+     **/
+    static int getConstantDimension(const ExprNodePtr& arg)
+    {
+        const ConstantNode* isConstant = dynamic_cast<const ConstantNode*>( arg.get() );
+        ExprValue v;
+        ExprEvalArgs args;
+
+        args.time = 0.;
+        if ( !isConstant || !isConstant->eval(args, &v) || !v.isInt || (v.v < 0) ) {
+            throw UnsupportedExpression("the dimension must be a number");
+        }
+
+        return (int)v.v;
+    }
+
+    Operand call(const Operand& operand,
+                 const std::vector<ExprNodePtr>& args) const
+    {
+        Operand ret;
+
+        if (operand.kind == Operand::eKindFunction) {
+            int nArgs = (int)args.size();
+            if ( (nArgs < operand.function->minArgs) || ( (operand.function->maxArgs != -1) && (nArgs > operand.function->maxArgs) ) ) {
+                throw UnsupportedExpression( std::string("wrong number of arguments for ") + operand.function->name );
+            }
+            ret.value = boost::make_shared<FunctionNode>(operand.function->function, args);
+
+            return ret;
+        }
+        if (operand.kind != Operand::eKindParamMethod) {
+            throw UnsupportedExpression("this cannot be called");
+        }
+
+        int nDims = operand.knob->getDimension();
+        if (operand.method == "get") {
+            if (args.size() > 1) {
+                throw UnsupportedExpression("wrong number of arguments for get");
+            }
+            ExprNodePtr time = args.empty() ? ExprNodePtr() : args[0];
+            bool isColor = dynamic_cast<KnobColor*>( operand.knob.get() ) != 0;
+            if ( (nDims == 1) && !isColor ) {
+                ret.value = makeKnobValue(operand.knob, operand.node, time ? eKnobCallGetAtTime : eKnobCallGet, 0, time);
+            } else {
+                ret = operand;
+                ret.kind = Operand::eKindTuple;
+                ret.time = time;
+            }
+
+            return ret;
+        }
+
+        KnobCallEnum knobCall;
+        std::size_t nTimeArgs;
+        if (operand.method == "getValue") {
+            knobCall = eKnobCallGet;
+            nTimeArgs = 0;
+        } else if (operand.method == "getValueAtTime") {
+            knobCall = eKnobCallGetAtTime;
+            nTimeArgs = 1;
+        } else {
+            assert(operand.method == "curve");
+            knobCall = eKnobCallCurve;
+            nTimeArgs = 1;
+        }
+        if ( (args.size() < nTimeArgs) || (args.size() > nTimeArgs + 1) ) {
+            throw UnsupportedExpression("wrong number of arguments for " + operand.method);
+        }
+        int dimension = args.size() > nTimeArgs ? getConstantDimension(args[nTimeArgs]) : 0;
+        if (dimension >= nDims) {
+            throw UnsupportedExpression("dimension out of range");
+        }
+        ret.value = makeKnobValue(operand.knob, operand.node, knobCall, dimension, nTimeArgs ? args[0] : ExprNodePtr());
+
+        return ret;
+    } // call
+};
+} // anon namespace
+
+struct NativeExpressionPrivate
+{
+    ExprNodePtr root;
+
+    NativeExpressionPrivate()
+        : root()
+    {
+    }
+};
+
+NativeExpression::NativeExpression()
+    : _imp( new NativeExpressionPrivate() )
+{
+}
+
+NativeExpression::~NativeExpression()
+{
+}
+
+NativeExpressionPtr
+NativeExpression::compile(const std::string& expression,
+                          const KnobIPtr& knob,
+                          int dimension,
+                          std::string* error)
+{
+    NativeExpressionPtr ret;
+
+    try {
+        Parser parser(expression, knob, dimension);
+        ExprNodePtr root = parser.parse();
+        ret.reset( new NativeExpression() );
+        ret->_imp->root = root;
+    } catch (const std::exception& e) {
+        if (error) {
+            *error = e.what();
+        }
+
+        return NativeExpressionPtr();
+    }
+
+    return ret;
+}
+
+bool
+NativeExpression::evaluate(double time,
+                           ViewIdx view,
+                           double* ret) const
+{
+    ExprEvalArgs args;
+
+    args.time = time;
+    args.view = view;
+    ExprValue value;
+    if ( !_imp->root->eval(args, &value) ) {
+        return false;
+    }
+    *ret = value.v;
+
+    return true;
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,94 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_NATIVEEXPRESSION_H
+#define NATRON_ENGINE_NATIVEEXPRESSION_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include "Engine/ViewIdx.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A knob expression compiled once to a tree of native operations, so that it can be evaluated
+ * without the Python interpreter, hence without holding the GIL, by the render threads.
+ *
+ * Only single-line expressions using the following are compiled:
+ * - integer and floating point numbers, True and False, pi and e
+ * - the + - * / // % ** operators, comparisons (not chained), and, or, not, and the "a if c else b" expression
+ * - frame, view and dimension
+ * - the functions of the math module imported by Natron, abs, min, max, int, float and round
+ * - thisParam, curve, and the parameters of thisNode, thisGroup or of the nodes of the same group, given by
+ *   their script-name, for Int, Double, Color, Boolean and Choice parameters: get(), get(frame), getValue(dimension),
+ *   getValueAtTime(frame, dimension), curve(frame, dimension) and the x, y, z or r, g, b, a members of get()
+ * The semantics of the Python version Natron is built with are respected, e.g. dividing 2 integers is an
+ * integer division with Python 2 and a true division with Python 3. Anything else is not compiled and must be
+ * executed by Python.
+ *
+ * The expression is evaluated with the same Knob functions as the Python API, but if the evaluation fails
+ * (e.g: a division by zero, or a referenced parameter which was removed) evaluate() returns false and the
+ * caller should run the Python expression, which reports the error.
+ **/
+struct NativeExpressionPrivate;
+class NativeExpression
+{
+public:
+
+    /**
+     * @brief Compiles the given expression of the given dimension of knob. The knob is used to resolve
+     * thisNode, thisParam, thisGroup and the nodes names, it may be NULL for expressions which do not use them.
+     * @returns NULL if the expression cannot be compiled, in which case error is set to the reason.
+     **/
+    static NativeExpressionPtr compile(const std::string& expression,
+                                       const KnobIPtr& knob,
+                                       int dimension,
+                                       std::string* error = 0);
+
+    ~NativeExpression();
+
+    /**
+     * @brief Evaluates the expression at the given time and view. This is thread-safe.
+     * @returns False if the evaluation failed: the Python expression must be run instead.
+     **/
+    bool evaluate(double time, ViewIdx view, double* ret) const WARN_UNUSED_RETURN;
+
+private:
+
+    NativeExpression();
+
+    boost::scoped_ptr<NativeExpressionPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_NATIVEEXPRESSION_H
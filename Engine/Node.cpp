@@ -29,8 +29,11 @@
 #include <algorithm> // min, max
 #include <bitset>
 #include <cassert>
+#include <map>
+#include <set>
 #include <stdexcept>
 #include <sstream> // stringstream
+#include <vector>
 
 #include "Global/Macros.h"
 
@@ -878,23 +881,13 @@ Node::computeHashInternal()
 } // Node::computeHashInternal
 
 void
-Node::computeHashRecursive(std::list<Node*>& marked)
+Node::getHashDependents(std::list<Node*>* dependents) const
 {
-    if ( std::find(marked.begin(), marked.end(), this) != marked.end() ) {
-        return;
-    }
-
-    bool hasChanged = computeHashInternal();
-    marked.push_back(this);
-    if (!hasChanged) {
-        //Nothing changed, no need to recurse on outputs
+    if (!_imp->effect) {
         return;
     }
 
-
     bool isRotoPaint = _imp->effect->isRotoPaintNode();
-
-    ///call it on all the outputs
     NodesList outputs;
     getOutputsWithGroupRedirection(outputs);
     for (NodesList::iterator it = outputs.begin(); it != outputs.end(); ++it) {
@@ -905,20 +898,82 @@ Node::computeHashRecursive(std::list<Node*>& marked)
         if ( isRotoPaint && attachedStroke && (attachedStroke->getContext()->getNode().get() == this) ) {
             continue;
         }
-        (*it)->computeHashRecursive(marked);
+        dependents->push_back( it->get() );
     }
 
-
-    ///If the node has a rotopaint tree, compute the hash of the nodes in the tree
+    ///If the node has a rotopaint tree, the hash of the nodes in the tree depends on this node
     if (_imp->rotoContext) {
         NodesList allItems;
         _imp->rotoContext->getRotoPaintTreeNodes(&allItems);
         for (NodesList::iterator it = allItems.begin(); it != allItems.end(); ++it) {
-            (*it)->computeHashRecursive(marked);
+            dependents->push_back( it->get() );
         }
     }
 }
 
+void
+Node::computeHashOfNodes(const std::list<Node*>& dirtyNodes)
+{
+    if ( dirtyNodes.empty() ) {
+        return;
+    }
+
+    // Nodes whose hash must be computed again: the dirty nodes and the dependents of the nodes whose hash changed
+    std::set<Node*> dirty;
+    // Nodes whose hash was already computed and has changed
+    std::set<Node*> computed;
+    if (dirtyNodes.size() == 1) {
+        // Most common case: a single node changed. If its hash did not change, there is nothing to propagate
+        Node* node = dirtyNodes.front();
+        if ( !node->computeHashInternal() ) {
+            return;
+        }
+        computed.insert(node);
+    }
+    dirty.insert( dirtyNodes.begin(), dirtyNodes.end() );
+
+    // Sort the sub-graph downstream of the dirty nodes in topological order, so that each node is
+    // computed once, after all its inputs in the sub-graph are up to date.
+    typedef std::map<Node*, std::list<Node*> > DependentsMap;
+    DependentsMap dependents;
+    std::vector<Node*> postOrder;
+    for (std::list<Node*>::const_iterator it = dirtyNodes.begin(); it != dirtyNodes.end(); ++it) {
+        if ( dependents.find(*it) != dependents.end() ) {
+            continue;
+        }
+        std::vector<std::pair<Node*, std::list<Node*>::const_iterator> > stack;
+        DependentsMap::iterator found = dependents.insert( std::make_pair( *it, std::list<Node*>() ) ).first;
+        (*it)->getHashDependents(&found->second);
+        stack.push_back( std::make_pair( *it, found->second.begin() ) );
+        while ( !stack.empty() ) {
+            Node* node = stack.back().first;
+            std::list<Node*>::const_iterator& next = stack.back().second;
+            if ( next != dependents[node].end() ) {
+                Node* dependent = *next;
+                ++next;
+                if ( dependents.find(dependent) == dependents.end() ) {
+                    DependentsMap::iterator foundDependent = dependents.insert( std::make_pair( dependent, std::list<Node*>() ) ).first;
+                    dependent->getHashDependents(&foundDependent->second);
+                    stack.push_back( std::make_pair( dependent, foundDependent->second.begin() ) );
+                }
+            } else {
+                postOrder.push_back(node);
+                stack.pop_back();
+            }
+        }
+    }
+
+    for (std::vector<Node*>::reverse_iterator it = postOrder.rbegin(); it != postOrder.rend(); ++it) {
+        if ( dirty.find(*it) == dirty.end() ) {
+            continue;
+        }
+        if ( ( computed.find(*it) != computed.end() ) || (*it)->computeHashInternal() ) {
+            const std::list<Node*>& nodeDependents = dependents[*it];
+            dirty.insert( nodeDependents.begin(), nodeDependents.end() );
+        }
+    }
+} // Node::computeHashOfNodes
+
 void
 Node::removeAllImagesFromCacheWithMatchingIDAndDifferentKey(U64 nodeHashKey)
 {
@@ -972,8 +1027,7 @@ Node::computeHash()
 
         return;
     }
-    std::list<Node*> marked;
-    computeHashRecursive(marked);
+    computeHashOfNodes( std::list<Node*>(1, this) );
 } // computeHash
 
 
@@ -4912,12 +4966,13 @@ Node::onEffectKnobValueChanged(KnobI* what,
             ///When a group is disabled we have to force a hash change of all nodes inside otherwise the image will stay cached
 
             NodesList nodes = isGroup->getNodes();
-            std::list<Node*> markedNodes;
+            std::list<Node*> dirtyNodes;
             for (NodesList::iterator it = nodes.begin(); it != nodes.end(); ++it) {
                 //This will not trigger a hash recomputation
                 (*it)->incrementKnobsAge_internal();
-                (*it)->computeHashRecursive(markedNodes);
+                dirtyNodes.push_back( it->get() );
             }
+            computeHashOfNodes(dirtyNodes);
         }
     } else if ( what == _imp->nodeLabelKnob.lock().get() ) {
         Q_EMIT nodeExtraLabelChanged( QString::fromUtf8( _imp->nodeLabelKnob.lock()->getValue().c_str() ) );
@@ -1332,7 +1332,17 @@ private:
 
     bool setStreamWarningInternal(StreamWarningEnum warning, const QString& message);
 
-    void computeHashRecursive(std::list<Node*>& marked);
+    /**
+     * @brief Returns the nodes whose hash depends on the hash of this node
+     **/
+    void getHashDependents(std::list<Node*>* dependents) const;
+
+    /**
+     * @brief Refreshes the hash of the given nodes and propagates the change downstream.
+     * The sub-graph is visited in topological order and only the nodes that have an input
+     * whose hash changed are computed again.
+     **/
+    static void computeHashOfNodes(const std::list<Node*>& dirtyNodes);
 
     /**
      * @brief Refreshes the node hash depending on its context (knobs age, inputs etc...)
@@ -89,6 +89,11 @@ public:
         _serializedNodes.push_back(s);
     }
 
+    void swap(NodeCollectionSerialization& other)
+    {
+        _serializedNodes.swap(other._serializedNodes);
+    }
+
     static bool restoreFromSerialization(const std::list<NodeSerializationPtr> & serializedNodes,
                                          const NodeCollectionPtr& group,
                                          bool createNodes,
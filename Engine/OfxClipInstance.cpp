@@ -1041,6 +1041,10 @@ OfxClipInstance::getInputImageInternal(const OfxTime time,
     if (renderData) {
         renderData->imagesBeingRendered.push_back(retCommon);
     }
+    U64 localCopySize = retCommon->getLocalCopySize();
+    if (localCopySize) {
+        effect->addInputImageCopyStats(localCopySize);
+    }
 
     return true;
 } // OfxClipInstance::getInputImageInternal
@@ -1358,6 +1362,12 @@ OfxImageCommon::getComponentsString() const
     return _imp->components;
 }
 
+U64
+OfxImageCommon::getLocalCopySize() const
+{
+    return _imp->localBuffer ? _imp->localBuffer->size() : 0;
+}
+
 OfxImageCommon::OfxImageCommon(OFX::Host::ImageEffect::ImageBase* ofxImageBase,
                                const OfxClipInstance::RenderActionDataPtr& renderData,
                                const NATRON_NAMESPACE::ImagePtr& internalImage,
@@ -338,6 +338,12 @@ public:
     const std::string& getComponentsString() const;
     NATRON_NAMESPACE::ImagePtr getInternalImage() const;
 
+    /**
+     * @brief Returns the size in bytes of the local copy of the source image given to the plug-in,
+     * or 0 if the plug-in reads the internal image directly.
+     **/
+    U64 getLocalCopySize() const;
+
 private:
 
     boost::scoped_ptr<OfxImageCommonPrivate> _imp;
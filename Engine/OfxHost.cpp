@@ -33,6 +33,8 @@
 #include <cctype> // tolower
 #include <algorithm> // transform, min, max
 #include <string>
+#include <list>
+#include <vector>
 #include <cstring> // for std::memcpy, std::memset, std::strcmp
 
 CLANG_DIAG_OFF(deprecated)
@@ -49,6 +51,7 @@ CLANG_DIAG_ON(deprecated-register)
 #ifdef OFX_SUPPORTS_MULTITHREAD
 #include <QtCore/QThread>
 #include <QtCore/QThreadStorage>
+#include <QtCore/QWaitCondition>
 #include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 // /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
@@ -113,6 +116,13 @@ CLANG_DIAG_ON(unknown-pragmas)
 //An effect may not use more than this amount of threads
 #define NATRON_MULTI_THREAD_SUITE_MAX_NUM_CPU 4
 
+//Maximum number of thread teams used by the multi-thread suite at the same time (i.e. of concurrent multiThread calls
+//using a team), the other calls use the global thread pool
+#define NATRON_MULTI_THREAD_SUITE_MAX_TEAMS 16
+
+//Number of times a thread of a team checks for a new job before going to sleep
+#define NATRON_MULTI_THREAD_SUITE_SPIN_COUNT 4000
+
 NATRON_NAMESPACE_ENTER
 // to disambiguate with the global-scope ::OfxHost
 
@@ -146,11 +156,23 @@ string_format(const std::string fmt,
     return str;
 }
 
+#ifdef OFX_SUPPORTS_MULTITHREAD
+class OfxThreadTeam;
+typedef boost::shared_ptr<OfxThreadTeam> OfxThreadTeamPtr;
+#endif
+
 struct OfxHostPrivate
 {
     OFX::Host::ImageEffect::PluginCachePtr imageEffectPluginCache;
     boost::shared_ptr<TLSHolder<OfxHost::OfxHostTLSData> > tlsData;
 
+#ifdef OFX_SUPPORTS_MULTITHREAD
+    // The thread teams which are not used by a multiThread call
+    std::list<OfxThreadTeamPtr> idleThreadTeams;
+    int threadTeamsCount;
+    QMutex threadTeamsMutex; //< protects idleThreadTeams and threadTeamsCount
+#endif
+
 #ifdef MULTI_THREAD_SUITE_USES_THREAD_SAFE_MUTEX_ALLOCATION
     std::list<QMutex*> pluginsMutexes;
     QMutex* pluginsMutexesLock; //<protects _pluginsMutexes
@@ -162,6 +184,11 @@ struct OfxHostPrivate
     OfxHostPrivate()
         : imageEffectPluginCache()
         , tlsData( new TLSHolder<OfxHost::OfxHostTLSData>() )
+#ifdef OFX_SUPPORTS_MULTITHREAD
+        , idleThreadTeams()
+        , threadTeamsCount(0)
+        , threadTeamsMutex()
+#endif
 #ifdef MULTI_THREAD_SUITE_USES_THREAD_SAFE_MUTEX_ALLOCATION
         , pluginsMutexes()
         , pluginsMutexesLock(0)
@@ -171,6 +198,16 @@ struct OfxHostPrivate
         , loadingPluginVersionMinor(0)
     {
     }
+
+#ifdef OFX_SUPPORTS_MULTITHREAD
+    /**
+     * @brief Returns a team that is not used by another multiThread call, or NULL if the maximum number
+     * of teams are in use.
+     **/
+    OfxThreadTeamPtr acquireThreadTeam();
+
+    void releaseThreadTeam(const OfxThreadTeamPtr& team);
+#endif
 };
 
 OfxHost::OfxHost()
@@ -1310,6 +1347,273 @@ private:
 
 NATRON_NAMESPACE_ANONYMOUS_EXIT
 
+class OfxThreadTeamWorker;
+
+/**
+ * @brief A team of threads kept alive between the multiThread calls of the plug-ins, which are done for each
+ * render action and sometimes for each tile, so that a call does not have to schedule nThreads tasks on the
+ * global thread pool and wait for them.
+ *
+ * For a call with nSlots threads, the thread index i is always run by the thread of slot i % nSlots: the
+ * slot 0 is the calling thread and the slot k > 0 is the k-th thread of the team. The job is dispatched by
+ * incrementing the generation of the threads of the slots, which wait for it by spinning for a short time
+ * before sleeping, and the calling thread waits on the count of slots which are not done.
+ **/
+class OfxThreadTeam
+{
+public:
+
+    OfxThreadTeam();
+
+    ~OfxThreadTeam();
+
+    /**
+     * @brief Calls func for all thread indexes from 0 to nThreads-1 on nSlots threads (the calling thread
+     * being one of them) and returns once they all returned.
+     **/
+    OfxStatus run(OfxThreadFunctionV1 func, unsigned int nThreads, unsigned int nSlots, QThread* spawnerThread, void *customArg);
+
+    void workerLoop(OfxThreadTeamWorker* worker);
+
+private:
+
+    void runSlot(unsigned int slot);
+
+    std::vector<OfxThreadTeamWorker*> _workers;
+    QMutex _mutex;
+    QWaitCondition _doneCond;
+    bool _mustQuit; //< protected by _mutex
+
+    // The current job, set before the generation of the threads is incremented
+    OfxThreadFunctionV1* _func;
+    unsigned int _nThreads;
+    unsigned int _nSlots;
+    QThread* _spawnerThread;
+    void* _customArg;
+    QAtomicInt _remainingSlots;
+    QAtomicInt _status;
+};
+
+class OfxThreadTeamWorker
+    : public QThread
+      , public AbortableThread
+{
+public:
+
+    OfxThreadTeamWorker(OfxThreadTeam* team,
+                        unsigned int slot)
+        : QThread()
+        , AbortableThread(this)
+        , jobGeneration()
+        , jobCond()
+        , sleeping(false)
+        , _team(team)
+        , _slot(slot)
+    {
+        setThreadName("Multi-thread suite");
+    }
+
+    unsigned int getSlot() const
+    {
+        return _slot;
+    }
+
+    // Incremented for each job this thread takes part in
+    QAtomicInt jobGeneration;
+
+    // Protected by the mutex of the team
+    QWaitCondition jobCond;
+    bool sleeping;
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        _team->workerLoop(this);
+    }
+
+    OfxThreadTeam* _team;
+    unsigned int _slot;
+};
+
+OfxThreadTeam::OfxThreadTeam()
+    : _workers()
+    , _mutex()
+    , _doneCond()
+    , _mustQuit(false)
+    , _func(0)
+    , _nThreads(0)
+    , _nSlots(0)
+    , _spawnerThread(0)
+    , _customArg(0)
+    , _remainingSlots()
+    , _status()
+{
+}
+
+OfxThreadTeam::~OfxThreadTeam()
+{
+    {
+        QMutexLocker k(&_mutex);
+        _mustQuit = true;
+        for (std::size_t i = 0; i < _workers.size(); ++i) {
+            _workers[i]->jobCond.wakeOne();
+        }
+    }
+    for (std::size_t i = 0; i < _workers.size(); ++i) {
+        _workers[i]->wait();
+        delete _workers[i];
+    }
+}
+
+OfxStatus
+OfxThreadTeam::run(OfxThreadFunctionV1 func,
+                   unsigned int nThreads,
+                   unsigned int nSlots,
+                   QThread* spawnerThread,
+                   void *customArg)
+{
+    assert(nSlots >= 1 && nSlots <= nThreads);
+
+    // Threads are only spawned the first time a team is used with that many slots
+    while (_workers.size() < nSlots - 1) {
+        OfxThreadTeamWorker* worker = new OfxThreadTeamWorker( this, (unsigned int)_workers.size() + 1 );
+        _workers.push_back(worker);
+        worker->start();
+    }
+
+    _func = func;
+    _nThreads = nThreads;
+    _nSlots = nSlots;
+    _spawnerThread = spawnerThread;
+    _customArg = customArg;
+    _status.fetchAndStoreOrdered(kOfxStatOK);
+    _remainingSlots.fetchAndStoreOrdered(nSlots - 1);
+
+    for (unsigned int i = 0; i < nSlots - 1; ++i) {
+        _workers[i]->jobGeneration.fetchAndAddOrdered(1);
+    }
+    {
+        // Only wake up the threads which stopped spinning
+        QMutexLocker k(&_mutex);
+        for (unsigned int i = 0; i < nSlots - 1; ++i) {
+            if (_workers[i]->sleeping) {
+                _workers[i]->jobCond.wakeOne();
+            }
+        }
+    }
+
+    runSlot(0);
+
+    for (int spin = 0; spin < NATRON_MULTI_THREAD_SUITE_SPIN_COUNT && _remainingSlots.fetchAndAddOrdered(0) > 0; ++spin) {
+    }
+    if (_remainingSlots.fetchAndAddOrdered(0) > 0) {
+        QMutexLocker k(&_mutex);
+        while (_remainingSlots.fetchAndAddOrdered(0) > 0) {
+            _doneCond.wait(&_mutex);
+        }
+    }
+
+    return (OfxStatus)_status.fetchAndAddOrdered(0);
+} // OfxThreadTeam::run
+
+void
+OfxThreadTeam::workerLoop(OfxThreadTeamWorker* worker)
+{
+#ifdef DEBUG
+    boost_adaptbx::floating_point::exception_trapping trap(boost_adaptbx::floating_point::exception_trapping::division_by_zero |
+                                                           boost_adaptbx::floating_point::exception_trapping::invalid |
+                                                           boost_adaptbx::floating_point::exception_trapping::overflow);
+#endif
+    int generation = 0;
+
+    for (;;) {
+        // Plug-ins often call multiThread several times in a row: spin for a short time before sleeping
+        for (int spin = 0; spin < NATRON_MULTI_THREAD_SUITE_SPIN_COUNT && worker->jobGeneration.fetchAndAddOrdered(0) == generation; ++spin) {
+        }
+        if (worker->jobGeneration.fetchAndAddOrdered(0) == generation) {
+            QMutexLocker k(&_mutex);
+            while ( !_mustQuit && (worker->jobGeneration.fetchAndAddOrdered(0) == generation) ) {
+                worker->sleeping = true;
+                worker->jobCond.wait(&_mutex);
+                worker->sleeping = false;
+            }
+            if (_mustQuit) {
+                return;
+            }
+        }
+        generation = worker->jobGeneration.fetchAndAddOrdered(0);
+
+        runSlot( worker->getSlot() );
+
+        if (_remainingSlots.fetchAndAddOrdered(-1) == 1) {
+            QMutexLocker k(&_mutex);
+            _doneCond.wakeOne();
+        }
+    }
+}
+
+void
+OfxThreadTeam::runSlot(unsigned int slot)
+{
+    OfxHost::OfxHostDataTLSPtr tls = appPTR->getOFXHost()->getTLSData();
+    QThread* spawnedThread = QThread::currentThread();
+    bool isSpawnerThread = spawnedThread == _spawnerThread;
+
+    if (!isSpawnerThread) {
+        appPTR->getAppTLS()->softCopy(_spawnerThread, spawnedThread);
+    }
+
+    for (unsigned int threadIndex = slot; threadIndex < _nThreads; threadIndex += _nSlots) {
+        OfxStatus stat = kOfxStatOK;
+        tls->threadIndexes.push_back( (int)threadIndex );
+        try {
+            _func(threadIndex, _nThreads, _customArg);
+        } catch (const std::bad_alloc & ba) {
+            stat = kOfxStatErrMemory;
+        } catch (...) {
+            stat = kOfxStatFailed;
+        }
+        tls->threadIndexes.pop_back();
+        if (stat != kOfxStatOK) {
+            // Keep the first error
+            _status.testAndSetOrdered(kOfxStatOK, stat);
+        }
+    }
+
+    if (!isSpawnerThread) {
+        appPTR->getAppTLS()->cleanupTLSForThread();
+    }
+}
+
+OfxThreadTeamPtr
+OfxHostPrivate::acquireThreadTeam()
+{
+    QMutexLocker k(&threadTeamsMutex);
+
+    if ( !idleThreadTeams.empty() ) {
+        // The last released team is the most likely to still have spinning threads
+        OfxThreadTeamPtr team = idleThreadTeams.back();
+        idleThreadTeams.pop_back();
+
+        return team;
+    }
+    if (threadTeamsCount >= NATRON_MULTI_THREAD_SUITE_MAX_TEAMS) {
+        return OfxThreadTeamPtr();
+    }
+    ++threadTeamsCount;
+
+    return boost::make_shared<OfxThreadTeam>();
+}
+
+void
+OfxHostPrivate::releaseThreadTeam(const OfxThreadTeamPtr& team)
+{
+    QMutexLocker k(&threadTeamsMutex);
+
+    idleThreadTeams.push_back(team);
+}
+
 
 // Function to spawn SMP threads
 //  This function will spawn nThreads separate threads of computation (typically one per CPU) to allow something to perform symmetric multi processing. Each thread will call 'func' passing in the index of the thread and the number of threads actually launched.
@@ -1338,22 +1642,47 @@ OfxHost::multiThread(OfxThreadFunctionV1 func,
     // "nThreads can be more than the value returned by multiThreadNumCPUs, however
     // the threads will be limited to the number of CPUs returned by multiThreadNumCPUs."
 
-    if ( (nThreads == 1) || (maxConcurrentThread <= 1) || (appPTR->getCurrentSettings()->getNumberOfThreads() == -1) ) {
-        try {
-            for (unsigned int i = 0; i < nThreads; ++i) {
+    // A multiThread call from a function run by multiThread is not allowed by the specification, and the
+    // other threads are busy anyway: run the functions on the calling thread, with their own indexes.
+    OfxHostDataTLSPtr tls = _imp->tlsData->getOrCreateTLSData();
+    bool isNestedCall = !tls->threadIndexes.empty() && (tls->threadIndexes.back() != -1);
+
+    if ( (nThreads == 1) || (maxConcurrentThread <= 1) || (appPTR->getCurrentSettings()->getNumberOfThreads() == -1) || isNestedCall ) {
+        OfxStatus stat = kOfxStatOK;
+        for (unsigned int i = 0; i < nThreads && stat == kOfxStatOK; ++i) {
+            tls->threadIndexes.push_back( (int)i );
+            try {
                 func(i, nThreads, customArg);
+            } catch (const std::bad_alloc & ba) {
+                stat = kOfxStatErrMemory;
+            } catch (...) {
+                stat = kOfxStatFailed;
             }
-
-            return kOfxStatOK;
-        } catch (...) {
-            return kOfxStatFailed;
+            tls->threadIndexes.pop_back();
         }
+
+        return stat;
     }
 
     QThread* spawnerThread = QThread::currentThread();
     bool useThreadPool = appPTR->getUseThreadPool();
-
+    OfxThreadTeamPtr team;
     if (useThreadPool) {
+        team = _imp->acquireThreadTeam();
+    }
+
+    if (team) {
+        unsigned int nSlots = std::min(nThreads, maxConcurrentThread);
+
+        ///The threads of the team are not in the global thread pool
+        appPTR->fetchAndAddNRunningThreads( (int)nSlots - 1 );
+        OfxStatus stat = team->run(func, nThreads, nSlots, spawnerThread, customArg);
+        appPTR->fetchAndAddNRunningThreads( 1 - (int)nSlots );
+        _imp->releaseThreadTeam(team);
+
+        return stat;
+    } else if (useThreadPool) {
+        // All the teams are used by other multiThread calls
         std::vector<unsigned int> threadIndexes(nThreads);
         for (unsigned int i = 0; i < nThreads; ++i) {
             threadIndexes[i] = i;
@@ -28,6 +28,7 @@
 #include "Global/Macros.h"
 
 #include <list>
+#include <vector>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
@@ -97,26 +98,36 @@ public:
     virtual RectD getUserRegionOfInterest() const = 0;
 
     /**
-     * @brief Should clear any partial texture overlayed previously transferred with transferBufferFromRAMtoGPU
+     * @brief Should clear any partial texture overlayed previously transferred with transferBuffersFromRAMtoGPU
      **/
     virtual void clearPartialUpdateTextures()  = 0;
 
     /**
-     * @brief This function must do the following:
-     * 1) glMapBuffer to map a GPU buffer to the RAM
-     * 2) memcpy to copy the ramBuffer to previously mapped buffer.
+     * @brief A RAM buffer to upload to the given rectangle of the texture
+     **/
+    struct TileTransfer
+    {
+        const unsigned char* ramBuffer;
+        std::size_t bytesCount;
+        TextureRect rect;
+
+        TileTransfer()
+            : ramBuffer(0), bytesCount(0), rect() {}
+    };
+
+    /**
+     * @brief This function must upload all the tiles of an update of the viewer at once:
+     * 1) glMapBuffer to map a GPU buffer large enough for all tiles to the RAM
+     * 2) memcpy to copy each ramBuffer to its offset in the mapped buffer, possibly from several threads.
      * 3) glUnmapBuffer to unmap the GPU buffer
-     * 4) glTexSubImage2D or glTexImage2D depending whether yo need to resize the texture or not.
-     **/
-    virtual void transferBufferFromRAMtoGPU(const unsigned char* ramBuffer,
-                                            size_t bytesCount,
-                                            const RectI &roiRoundedToTileSize,
-                                            const RectI& roi,
-                                            const TextureRect & tileRect,
-                                            int textureIndex,
-                                            bool isPartialRect,
-                                            bool isFirstTile,
-                                            TexturePtr* texture) = 0;
+     * 4) glTexSubImage2D or glTexImage2D for each tile depending whether yo need to resize the texture or not.
+     **/
+    virtual void transferBuffersFromRAMtoGPU(const std::vector<TileTransfer>& tiles,
+                                             const RectI &roiRoundedToTileSize,
+                                             const RectI& roi,
+                                             int textureIndex,
+                                             bool isPartialRect,
+                                             TexturePtr* texture) = 0;
     virtual void endTransferBufferFromRAMToGPU(int textureIndex,
                                                const TexturePtr& texture,
                                                const ImagePtr& image,
@@ -349,7 +349,7 @@ OutputEffectInstance::createWriterPath()
 }
 
 void
-OutputEffectInstance::notifyRenderFinished()
+OutputEffectInstance::notifyRenderFinished(bool aborted)
 {
     RenderSequenceArgs newArgs;
 
@@ -358,7 +358,7 @@ OutputEffectInstance::notifyRenderFinished()
         if ( !_renderSequenceRequests.empty() ) {
             const RenderSequenceArgs& args = _renderSequenceRequests.front();
             if (args.renderController) {
-                args.renderController->notifyFinished();
+                args.renderController->notifyFinished(aborted);
             }
             _renderSequenceRequests.pop_front();
         }
@@ -505,6 +505,17 @@ OutputEffectInstance::reportStats(int time,
         ofile << "Nb cache hit: " << nbCacheMiss << std::endl;
         ofile << "Nb cache miss: " << nbCacheMiss << std::endl;
         ofile << "Nb cache hit requiring mipmap downscaling: " << nbCacheHitButDownscaled << std::endl;
+        int nbPolygonCacheMiss, nbPolygonCacheHit;
+        it->second.getRotoPolygonCacheAccessInfos(&nbPolygonCacheMiss, &nbPolygonCacheHit);
+        if (nbPolygonCacheMiss || nbPolygonCacheHit) {
+            ofile << "Nb roto polygon cache hit: " << nbPolygonCacheHit << std::endl;
+            ofile << "Nb roto polygon cache miss: " << nbPolygonCacheMiss << std::endl;
+        }
+        int nbInputImageCopies;
+        U64 nbInputImageBytesCopied;
+        it->second.getInputImageCopyInfos(&nbInputImageCopies, &nbInputImageBytesCopied);
+        ofile << "Nb input images copied: " << nbInputImageCopies << std::endl;
+        ofile << "Input images bytes copied: " << nbInputImageBytesCopied << std::endl;
 
         const std::set<std::string> & planes = it->second.getPlanesRendered();
         ofile << "Plane(s) rendered: ";
@@ -104,7 +104,7 @@ public:
      **/
     void renderFullSequence(bool isBlocking, bool enableRenderStats, BlockingBackgroundRender* renderController, int first, int last, int frameStep);
 
-    void notifyRenderFinished();
+    void notifyRenderFinished(bool aborted);
 
     void renderCurrentFrame(bool canAbort);
 
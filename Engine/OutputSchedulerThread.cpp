@@ -29,6 +29,8 @@
 #include <list>
 #include <algorithm> // min, max
 #include <cassert>
+#include <cmath>
+#include <cstdlib> // abs
 #include <stdexcept>
 #include <sstream> // stringstream
 
@@ -61,6 +63,7 @@
 #include "Engine/RenderStats.h"
 #include "Engine/RotoContext.h"
 #include "Engine/Settings.h"
+#include "Engine/TaskScheduler.h"
 #include "Engine/Timer.h"
 #include "Engine/TimeLine.h"
 #include "Engine/TLSHolder.h"
@@ -90,6 +93,12 @@
 
 #define NATRON_SCHEDULER_ABORT_AFTER_X_UNSUCCESSFUL_ITERATIONS 5000
 
+// Current frame requests older than this are not used to predict the frames to prefetch
+#define NATRON_VIEWER_PREFETCH_HISTORY_SECONDS 0.5
+
+// Maximum number of current frame requests used to predict the frames to prefetch
+#define NATRON_VIEWER_PREFETCH_HISTORY_SIZE 8
+
 NATRON_NAMESPACE_ENTER
 
 
@@ -2627,7 +2636,7 @@ DefaultScheduler::onRenderStopped(bool aborted)
         appPTR->writeToOutputPipe(longText, QString::fromUtf8(kRenderingFinishedStringShort), true);
     }
 
-    effect->notifyRenderFinished();
+    effect->notifyRenderFinished(aborted);
 
     std::string cb = effect->getNode()->getAfterRenderCallback();
     if ( !cb.empty() ) {
@@ -3447,6 +3456,16 @@ public:
 
 typedef boost::shared_ptr<CurrentFrameFunctorArgs> CurrentFrameFunctorArgsPtr;
 
+/**
+ * @brief A speculative render of a frame around the current frame, see ViewerInstance::prefetchFrame
+ **/
+struct ViewerPrefetchRequest
+{
+    int time;
+    U64 viewerHash;
+    AbortableRenderInfoPtr abortInfo;
+};
+
 class RenderCurrentFrameFunctorRunnable;
 struct ViewerCurrentFrameRequestSchedulerPrivate
 {
@@ -3469,6 +3488,20 @@ struct ViewerCurrentFrameRequestSchedulerPrivate
     // Used to attribute an age to each renderCurrentFrameRequest
     U64 ageCounter;
 
+    // The time (in seconds since scrubTimer creation) and frame of the last current frame requests, most recent last.
+    // Only accessed on the main-thread.
+    TimeLapse scrubTimer;
+    std::list<std::pair<double, int> > scrubHistory;
+
+    // The prefetch renders started and not finished yet
+    mutable QMutex prefetchRequestsMutex;
+    QWaitCondition prefetchRequestsCond;
+    std::list<ViewerPrefetchRequest> prefetchRequests;
+
+    // The frames rendered by a prefetch for the viewer hash prefetchedFramesHash, protected by prefetchRequestsMutex
+    U64 prefetchedFramesHash;
+    std::set<int> prefetchedFrames;
+
     ViewerCurrentFrameRequestSchedulerPrivate(ViewerInstance* viewer)
         : viewer(viewer)
         , threadPool( QThreadPool::globalInstance() )
@@ -3479,9 +3512,112 @@ struct ViewerCurrentFrameRequestSchedulerPrivate
         , currentFrameRenderTasksCond()
         , currentFrameRenderTasks()
         , ageCounter(0)
+        , scrubTimer()
+        , scrubHistory()
+        , prefetchRequestsMutex()
+        , prefetchRequestsCond()
+        , prefetchRequests()
+        , prefetchedFramesHash(0)
+        , prefetchedFrames()
+    {
+    }
+
+    void appendPrefetchRequest(const ViewerPrefetchRequest& request)
     {
+        QMutexLocker k(&prefetchRequestsMutex);
+
+        prefetchRequests.push_back(request);
+    }
+
+    /**
+     * @brief Removes a finished prefetch request. If rendered is true, the frame is now cached and will not be
+     * prefetched again until the viewer hash changes.
+     **/
+    void removePrefetchRequest(const ViewerPrefetchRequest& request,
+                               bool rendered)
+    {
+        QMutexLocker k(&prefetchRequestsMutex);
+
+        if (rendered) {
+            if (request.viewerHash != prefetchedFramesHash) {
+                prefetchedFrames.clear();
+                prefetchedFramesHash = request.viewerHash;
+            }
+            prefetchedFrames.insert(request.time);
+        }
+        for (std::list<ViewerPrefetchRequest>::iterator it = prefetchRequests.begin(); it != prefetchRequests.end(); ++it) {
+            if (it->abortInfo == request.abortInfo) {
+                prefetchRequests.erase(it);
+                prefetchRequestsCond.wakeAll();
+                break;
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the frames that do not need to be prefetched for the given viewer hash: the frames
+     * being prefetched and the frames already prefetched.
+     **/
+    void getPrefetchSkippedFrames(U64 viewerHash,
+                                  std::set<int>* frames) const
+    {
+        QMutexLocker k(&prefetchRequestsMutex);
+
+        for (std::list<ViewerPrefetchRequest>::const_iterator it = prefetchRequests.begin(); it != prefetchRequests.end(); ++it) {
+            if ( (it->viewerHash == viewerHash) && !it->abortInfo->isAborted() ) {
+                frames->insert(it->time);
+            }
+        }
+        if (prefetchedFramesHash == viewerHash) {
+            frames->insert( prefetchedFrames.begin(), prefetchedFrames.end() );
+        }
+    }
+
+    /**
+     * @brief Aborts all prefetch renders, except the one of the given frame if keepFrame is true: it renders
+     * what the viewer is about to request.
+     **/
+    void abortPrefetchRequests(bool keepFrame,
+                               int time,
+                               U64 viewerHash)
+    {
+        QMutexLocker k(&prefetchRequestsMutex);
+
+        for (std::list<ViewerPrefetchRequest>::iterator it = prefetchRequests.begin(); it != prefetchRequests.end(); ++it) {
+            if ( keepFrame && (it->time == time) && (it->viewerHash == viewerHash) ) {
+                continue;
+            }
+            it->abortInfo->setAborted();
+        }
+    }
+
+    void waitForPrefetchRequests()
+    {
+        QMutexLocker k(&prefetchRequestsMutex);
+
+        while ( !prefetchRequests.empty() ) {
+            prefetchRequestsCond.wait(&prefetchRequestsMutex);
+        }
+    }
+
+    /**
+     * @brief Records a request of the given frame, used by ViewerCurrentFrameRequestScheduler::getFramesToPrefetch
+     **/
+    void addScrubHistory(int frame)
+    {
+        double now = scrubTimer.getTimeSinceCreation();
+
+        scrubHistory.push_back( std::make_pair(now, frame) );
+        while ( (int)scrubHistory.size() > NATRON_VIEWER_PREFETCH_HISTORY_SIZE ||
+                ( now - scrubHistory.front().first > NATRON_VIEWER_PREFETCH_HISTORY_SECONDS ) ) {
+            scrubHistory.pop_front();
+        }
     }
 
+    void startPrefetch(int frame,
+                       ViewIdx view,
+                       U64 viewerHash);
+
     void appendRunnableTask(RenderCurrentFrameFunctorRunnable* task)
     {
         {
@@ -3611,6 +3747,116 @@ public:
     } // run
 };
 
+class ViewerPrefetchFrameRunnable
+    : public QRunnable
+{
+    ViewerCurrentFrameRequestSchedulerPrivate* _scheduler;
+    ViewerPrefetchRequest _request;
+    ViewIdx _view;
+
+public:
+
+    ViewerPrefetchFrameRunnable(ViewerCurrentFrameRequestSchedulerPrivate* scheduler,
+                                const ViewerPrefetchRequest& request,
+                                ViewIdx view)
+        : _scheduler(scheduler)
+        , _request(request)
+        , _view(view)
+    {
+    }
+
+    virtual ~ViewerPrefetchFrameRunnable()
+    {
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        bool rendered = false;
+        try {
+            rendered = _scheduler->viewer->prefetchFrame(_request.time, _view, _request.viewerHash, _request.abortInfo);
+        } catch (...) {
+            // A failed prefetch is not reported: the frame will be rendered again when requested
+        }
+
+        ///This thread is done, clean-up its TLS
+        appPTR->getAppTLS()->cleanupTLSForThread();
+
+        _scheduler->removePrefetchRequest(_request, rendered);
+    }
+};
+
+void
+ViewerCurrentFrameRequestScheduler::getFramesToPrefetch(const std::list<std::pair<double, int> >& history,
+                                                        int frame,
+                                                        int first,
+                                                        int last,
+                                                        int count,
+                                                        const std::set<int>& skippedFrames,
+                                                        std::vector<int>* frames)
+{
+    assert( !history.empty() );
+    int delta = frame - history.front().second;
+    int nSteps = (int)history.size() - 1;
+
+    if ( (delta == 0) || (nSteps == 0) ) {
+        for (int i = 1; (int)frames->size() < count && (frame + i <= last || frame - i >= first); ++i) {
+            if ( (frame + i <= last) && !skippedFrames.count(frame + i) ) {
+                frames->push_back(frame + i);
+            }
+            if ( (frame - i >= first) && ( (int)frames->size() < count ) && !skippedFrames.count(frame - i) ) {
+                frames->push_back(frame - i);
+            }
+        }
+    } else {
+        int direction = delta > 0 ? 1 : -1;
+        int step = std::max(1, (int)std::floor( (double)std::abs(delta) / nSteps + 0.5 ) );
+        for (int f = frame + direction * step; (int)frames->size() < count && f >= first && f <= last; f += direction * step) {
+            if ( !skippedFrames.count(f) ) {
+                frames->push_back(f);
+            }
+        }
+    }
+} // ViewerCurrentFrameRequestScheduler::getFramesToPrefetch
+
+void
+ViewerCurrentFrameRequestSchedulerPrivate::startPrefetch(int frame,
+                                                         ViewIdx view,
+                                                         U64 viewerHash)
+{
+    int count = appPTR->getCurrentSettings()->getViewerPrefetchFramesCount();
+
+    if (count <= 0) {
+        return;
+    }
+
+    int first, last;
+    viewer->getTimelineBounds(&first, &last);
+
+    std::set<int> skippedFrames;
+    getPrefetchSkippedFrames(viewerHash, &skippedFrames);
+
+    std::vector<int> frames;
+    ViewerCurrentFrameRequestScheduler::getFramesToPrefetch(scrubHistory, frame, first, last, count, skippedFrames, &frames);
+
+    // Only use idle workers of the task scheduler, which renders the tiles: nothing must be waiting to be
+    // rendered, and one worker is kept for the renders of the current frame
+    TaskScheduler* scheduler = appPTR->getTaskScheduler();
+    int nIdleThreads = 0;
+    if ( scheduler && (scheduler->getQueuedTaskCount() == 0) ) {
+        nIdleThreads = scheduler->getMaxThreadCount() - 1 - scheduler->getRunningTaskCount();
+    }
+
+    for (int i = 0; i < (int)frames.size() && i < nIdleThreads; ++i) {
+        ViewerPrefetchRequest request;
+        request.time = frames[i];
+        request.viewerHash = viewerHash;
+        request.abortInfo = AbortableRenderInfo::create(true, 0);
+        appendPrefetchRequest(request);
+        // Queued after any other task of the pool
+        threadPool->start(new ViewerPrefetchFrameRunnable(this, request, view), -1);
+    }
+} // ViewerCurrentFrameRequestSchedulerPrivate::startPrefetch
+
 
 class ViewerCurrentFrameRequestSchedulerExecOnMT
     : public GenericThreadExecOnMainThreadArgs
@@ -3645,6 +3891,8 @@ ViewerCurrentFrameRequestScheduler::~ViewerCurrentFrameRequestScheduler()
     if (_imp->backupThread.quitThread(false)) {
         _imp->backupThread.waitForAbortToComplete_enforce_blocking();
     }
+    _imp->abortPrefetchRequests(false, 0, 0);
+    _imp->waitForPrefetchRequests();
 }
 
 GenericSchedulerThread::TaskQueueBehaviorEnum
@@ -3763,13 +4011,14 @@ ViewerCurrentFrameRequestSchedulerPrivate::processProducedFrame(const RenderStat
         UpdateViewerParamsPtr params = boost::dynamic_pointer_cast<UpdateViewerParams>(*it2);
         assert(params);
         if ( params && (params->tiles.size() >= 1) ) {
+            // Update the viewer first, so that the stats include the upload of the texture
+            viewer->updateViewer(params);
+
             if (stats) {
                 double timeSpent;
                 std::map<NodePtr, NodeRenderStats > ret = stats->getStats(&timeSpent);
                 viewer->reportStats(0, ViewIdx(0), timeSpent, ret);
             }
-
-            viewer->updateViewer(params);
         }
     }
 
@@ -3788,6 +4037,7 @@ ViewerCurrentFrameRequestScheduler::onAbortRequested(bool keepOldestRender)
     //This function marks all active renders of the viewer as aborted (except the oldest one)
     //and each node actually check if the render has been aborted in EffectInstance::Implementation::aborted()
     _imp->viewer->markAllOnGoingRendersAsAborted(keepOldestRender);
+    _imp->abortPrefetchRequests(false, 0, 0);
     _imp->backupThread.abortThreadedTask();
 }
 
@@ -3801,6 +4051,8 @@ void
 ViewerCurrentFrameRequestScheduler::onWaitForThreadToQuit()
 {
     _imp->waitForRunnableTasks();
+    _imp->abortPrefetchRequests(false, 0, 0);
+    _imp->waitForPrefetchRequests();
     _imp->backupThread.waitForThreadToQuit_enforce_blocking();
 }
 
@@ -3808,6 +4060,7 @@ void
 ViewerCurrentFrameRequestScheduler::onWaitForAbortCompleted()
 {
     _imp->waitForRunnableTasks();
+    _imp->waitForPrefetchRequests();
     _imp->backupThread.waitForAbortToComplete_enforce_blocking();
 }
 
@@ -3836,6 +4089,10 @@ ViewerCurrentFrameRequestScheduler::renderCurrentFrame(bool enableRenderStats,
         return;
     }
 
+    // Prefetched frames are no longer needed if the viewer requests something else
+    _imp->abortPrefetchRequests(true, frame, viewerHash);
+    _imp->addScrubHistory(frame);
+
     RenderStatsPtr stats;
     if (enableRenderStats) {
         stats.reset( new RenderStats(enableRenderStats) );
@@ -3862,6 +4119,10 @@ ViewerCurrentFrameRequestScheduler::renderCurrentFrame(bool enableRenderStats,
         rotoUse1Thread = true;
     }
 
+    // Do not prefetch while painting or tracking, or when the playback already renders the frames ahead
+    RenderEnginePtr engine = _imp->viewer->getRenderEngine();
+    const bool canPrefetch = !rotoPaintNode && !isTracking && engine && !engine->isDoingSequentialRender();
+
     ViewerArgsPtr args[2];
     if (!rotoPaintNode || isRotoNeatRender) {
         bool clearTexture[2] = {false, false};
@@ -3915,12 +4176,12 @@ ViewerCurrentFrameRequestScheduler::renderCurrentFrame(bool enableRenderStats,
                 /*
                    The texture was cached
                  */
+                _imp->viewer->updateViewer(args[i]->params);
                 if ( stats && (i == 0) ) {
                     double timeSpent;
                     std::map<NodePtr, NodeRenderStats > statResults = stats->getStats(&timeSpent);
                     _imp->viewer->reportStats(frame, view, timeSpent, statResults);
                 }
-                _imp->viewer->updateViewer(args[i]->params);
                 args[i].reset();
             }
         }
@@ -3928,6 +4189,9 @@ ViewerCurrentFrameRequestScheduler::renderCurrentFrame(bool enableRenderStats,
              ( !args[0] && ( status[0] == ViewerInstance::eViewerRenderRetCodeRender) && args[1] && ( status[1] == ViewerInstance::eViewerRenderRetCodeFail) ) ||
              ( !args[1] && ( status[1] == ViewerInstance::eViewerRenderRetCodeRender) && args[0] && ( status[0] == ViewerInstance::eViewerRenderRetCodeFail) ) ) {
             _imp->viewer->redrawViewer();
+            if (canPrefetch) {
+                _imp->startPrefetch(frame, view, viewerHash);
+            }
 
             return;
         }
@@ -3992,6 +4256,10 @@ ViewerCurrentFrameRequestScheduler::renderCurrentFrame(bool enableRenderStats,
             _imp->appendRunnableTask(task);
             _imp->threadPool->start(task);
         }
+
+        if (canPrefetch) {
+            _imp->startPrefetch(frame, view, viewerHash);
+        }
     }
 } // ViewerCurrentFrameRequestScheduler::renderCurrentFrame
 
@@ -27,6 +27,9 @@
 
 #include "Global/Macros.h"
 
+#include <list>
+#include <set>
+#include <utility>
 #include <vector>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
@@ -569,6 +572,22 @@ public:
 
     void notifyFrameProduced(const BufferableObjectPtrList& frames, const RenderStatsPtr& stats, const ViewerCurrentFrameRequestSchedulerStartArgsPtr& request);
 
+    /**
+     * @brief Predicts from the recent requests the frames that the viewer is likely to request next,
+     * most likely first: the frames following the current frame in the scrubbing direction, spaced
+     * by the average scrubbing step, or the frames on both sides if the frame did not change.
+     * @param history The time (in seconds) and frame of the recent requests, oldest first, ending with frame.
+     * @param skippedFrames Frames already cached or being prefetched: they are not returned and do not
+     * count in count.
+     **/
+    static void getFramesToPrefetch(const std::list<std::pair<double, int> >& history,
+                                    int frame,
+                                    int first,
+                                    int last,
+                                    int count,
+                                    const std::set<int>& skippedFrames,
+                                    std::vector<int>* frames);
+
 private:
 
     virtual void onWaitForAbortCompleted() OVERRIDE FINAL;
@@ -117,6 +117,9 @@ public:
     ///Various stats local to the render of a frame
     RenderStatsPtr stats;
 
+    ///The values of the knobs of the node when the render of the frame started, NULL for analysis
+    KnobsSnapshotPtr knobsSnapshot;
+
     ///The OpenGL context to use for the render of this frame
     OSGLContextWPtr openGLContext;
 
@@ -137,6 +140,9 @@ public:
     /// Is this render sequential ? True for Viewer playback or a sequential writer such as WriteFFMPEG
     bool isSequentialRender : 1;
 
+    ///Is this render a prefetch of a frame around the current frame of a viewer ? Nothing is displayed.
+    bool isPrefetch : 1;
+
     ///Was the render started in the instanceChangedAction (knobChanged)
     bool isAnalysis : 1;
 
@@ -155,6 +161,14 @@ public:
     ParallelRenderArgs();
 
     bool isCurrentFrameRenderNotAbortable() const;
+
+    /**
+     * @brief Returns the priority of the tasks of this render on the TaskScheduler, deduced from the kind of render:
+     * viewer renders of the current frame and analysis are interactive, other renders due to a user interaction
+     * (e.g: previews) are previews, viewer sequential renders are playback and all others (Write nodes and
+     * viewer prefetch) are background.
+     **/
+    RenderPriorityEnum getRenderPriority() const;
 };
 
 struct FrameViewPair
@@ -274,7 +288,8 @@ public:
                              const NodePtr& activeRotoPaintNode,
                              bool isAnalysis,
                              bool draftMode,
-                             const RenderStatsPtr& stats);
+                             const RenderStatsPtr& stats,
+                             bool isPrefetch = false);
 
     ParallelRenderArgsSetter(const boost::shared_ptr<std::map<NodePtr, ParallelRenderArgsPtr> >& args);
 
@@ -24,6 +24,7 @@
 
 #include "ProcessHandler.h"
 
+#include <algorithm> // min, max
 #include <cassert>
 #include <stdexcept>
 
@@ -38,6 +39,8 @@
 #include <QtCore/QDir>
 #include <QtCore/QDebug>
 
+#include <boost/make_shared.hpp>
+
 #ifdef DEBUG
 #include "Global/FloatingPointExceptions.h"
 #endif
@@ -48,20 +51,10 @@
 
 NATRON_NAMESPACE_ENTER
 
-ProcessHandler::ProcessHandler(const QString & projectPath,
-                               OutputEffectInstance* writer)
-    : _process(new QProcess)
-    , _writer(writer)
-    , _ipcServer(0)
-    , _bgProcessOutputSocket(0)
-    , _bgProcessInputSocket(0)
-    , _earlyCancel(false)
-    , _processLog()
-    , _processArgs()
+namespace {
+QString
+createIPCServerName()
 {
-    ///setup the server used to listen the output of the background process
-    _ipcServer = new QLocalServer();
-    QObject::connect( _ipcServer, SIGNAL(newConnection()), this, SLOT(onNewConnectionPending()) );
     QString tmpFileName;
 #if defined(Q_OS_WIN)
     tmpFileName += QString::fromUtf8("//./pipe");
@@ -91,48 +84,216 @@ ProcessHandler::ProcessHandler(const QString & projectPath,
         tmpf.remove();
 #endif
     }
-    _ipcServer->listen(tmpFileName);
 
+    return tmpFileName;
+}
+} // anon namespace
 
-    _processArgs << QString::fromUtf8("-b") << QString::fromUtf8("-w") << QString::fromUtf8( writer->getScriptName_mt_safe().c_str() );
-    _processArgs << QString::fromUtf8("--IPCpipe") <<  tmpFileName;
-    _processArgs << projectPath;
+///The number of times the frames of a failed render process may be given to a new process
+#define kProcessHandlerMaxRetries 2
 
-    ///connect the useful slots of the process
-    QObject::connect( _process, SIGNAL(readyReadStandardOutput()), this, SLOT(onStandardOutputBytesWritten()) );
-    QObject::connect( _process, SIGNAL(readyReadStandardError()), this, SLOT(onStandardErrorBytesWritten()) );
-    QObject::connect( _process, SIGNAL(error(QProcess::ProcessError)), this, SLOT(onProcessError(QProcess::ProcessError)) );
-    QObject::connect( _process, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(onProcessEnd(int,QProcess::ExitStatus)) );
+struct ProcessHandler::RenderProcess
+{
+    int index; //< index of the process, used in the log
+    QProcess* process; //< the process executing the render
+    QLocalServer* ipcServer; //< the server for IPC with the background process
+    QLocalSocket* bgProcessOutputSocket; //< the socket where data is output by the process
+
+    //the socket where data is read by the process
+    //note that this socket is initialized only when the background process sends the message
+    //kBgProcessServerCreatedShort, meaning it created its server for the input pipe and we can actually open it.
+    QLocalSocket* bgProcessInputSocket;
+    bool earlyCancel; //< true if the user pressed cancel but the bgProcessInput socket was not created yet
+    bool finished;
+    ProcessHandler::FrameRange frames; //< the frames rendered by this process
+    int nRetries; //< how many processes failed to render these frames before this one
+    QStringList processArgs;
+
+    RenderProcess()
+        : index(0)
+        , process(0)
+        , ipcServer(0)
+        , bgProcessOutputSocket(0)
+        , bgProcessInputSocket(0)
+        , earlyCancel(false)
+        , finished(false)
+        , frames()
+        , nRetries(0)
+        , processArgs()
+    {
+    }
 
+    ~RenderProcess()
+    {
+        if (ipcServer) {
+            ipcServer->close();
+            delete ipcServer;
+        }
+        if (bgProcessInputSocket) {
+            bgProcessInputSocket->close();
+            delete bgProcessInputSocket;
+        }
+        if (process) {
+            process->close();
+            delete process;
+        }
+    }
+};
 
-    ///start the process
-    _processLog.push_back( tr("Starting background rendering: %1 %2")
-                           .arg( QCoreApplication::applicationFilePath() )
-                           .arg( _processArgs.join( QString::fromUtf8(" ") ) ) );
+ProcessHandler::ProcessHandler(const QString & projectPath,
+                               OutputEffectInstance* writer,
+                               int firstFrame,
+                               int lastFrame,
+                               int frameStep,
+                               int nProcesses)
+    : _writer(writer)
+    , _projectPath(projectPath)
+    , _firstFrame(firstFrame)
+    , _lastFrame(lastFrame)
+    , _frameStep( std::max(1, frameStep) )
+    , _splitFrames(false)
+    , _processes()
+    , _renderedFrames()
+    , _nFramesToRender(0)
+    , _returnCode(0)
+    , _canceled(false)
+    , _processLog()
+{
+    _nFramesToRender = std::max(0, (_lastFrame - _firstFrame) / _frameStep + 1);
+
+    ///The frame range syntax of the command line does not handle negative frames, and a video file
+    ///can only be written by a single process: in these cases the process renders the range of the writer.
+    _splitFrames = _firstFrame >= 0 && _lastFrame >= _firstFrame && !writer->isVideoWriter();
+    std::vector<FrameRange> ranges;
+    splitFrameRange(_firstFrame, _lastFrame, _frameStep, _splitFrames ? nProcesses : 1, &ranges);
+    for (std::size_t i = 0; i < ranges.size(); ++i) {
+        createProcess(ranges[i], 0);
+    }
 }
 
 ProcessHandler::~ProcessHandler()
 {
     Q_EMIT deleted();
 
-    if (_ipcServer) {
-        _ipcServer->close();
-        delete _ipcServer;
+    ///closing the processes must not call our slots
+    for (std::list<RenderProcessPtr>::const_iterator it = _processes.begin(); it != _processes.end(); ++it) {
+        QObject::disconnect( (*it)->process, 0, this, 0 );
+    }
+    _processes.clear();
+}
+
+void
+ProcessHandler::splitFrameRange(int firstFrame,
+                                int lastFrame,
+                                int frameStep,
+                                int nProcesses,
+                                std::vector<FrameRange>* ranges)
+{
+    frameStep = std::max(1, frameStep);
+    int nFrames = std::max(0, (lastFrame - firstFrame) / frameStep + 1);
+    nProcesses = std::max( 1, std::min(nProcesses, nFrames) );
+
+    ///Range i holds the frames first + i * step, first + (i + nProcesses) * step, ...
+    ranges->resize(nProcesses);
+    for (int i = 0; i < nProcesses; ++i) {
+        FrameRange& range = (*ranges)[i];
+        range.first = firstFrame + i * frameStep;
+        range.last = lastFrame;
+        range.step = frameStep * nProcesses;
+    }
+}
+
+bool
+ProcessHandler::getRemainingFrameRange(const FrameRange& range,
+                                       const std::set<int>& renderedFrames,
+                                       FrameRange* remaining)
+{
+    for (int f = range.first; f <= range.last; f += range.step) {
+        if ( renderedFrames.find(f) == renderedFrames.end() ) {
+            remaining->first = f;
+            remaining->last = range.last;
+            remaining->step = range.step;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+QString
+ProcessHandler::getFrameRangeArgument(const FrameRange& range)
+{
+    if (range.first == range.last) {
+        return QString::number(range.first);
+    }
+
+    return QString::fromUtf8("%1-%2:%3").arg(range.first).arg(range.last).arg(range.step);
+}
+
+ProcessHandler::RenderProcessPtr
+ProcessHandler::createProcess(const FrameRange& frames,
+                              int nRetries)
+{
+    RenderProcessPtr p = boost::make_shared<RenderProcess>();
+
+    p->index = (int)_processes.size();
+    p->frames = frames;
+    p->nRetries = nRetries;
+
+    ///setup the server used to listen the output of the background process
+    p->ipcServer = new QLocalServer();
+    QObject::connect( p->ipcServer, SIGNAL(newConnection()), this, SLOT(onNewConnectionPending()) );
+    QString serverName = createIPCServerName();
+    p->ipcServer->listen(serverName);
+
+    p->processArgs << QString::fromUtf8("-b") << QString::fromUtf8("-w") << QString::fromUtf8( _writer->getScriptName_mt_safe().c_str() );
+    if (_splitFrames) {
+        p->processArgs << getFrameRangeArgument(frames);
     }
-    if (_bgProcessInputSocket) {
-        _bgProcessInputSocket->close();
-        delete _bgProcessInputSocket;
+    p->processArgs << QString::fromUtf8("--IPCpipe") <<  serverName;
+    p->processArgs << _projectPath;
+
+    ///connect the useful slots of the process
+    p->process = new QProcess;
+    QObject::connect( p->process, SIGNAL(readyReadStandardOutput()), this, SLOT(onStandardOutputBytesWritten()) );
+    QObject::connect( p->process, SIGNAL(readyReadStandardError()), this, SLOT(onStandardErrorBytesWritten()) );
+    QObject::connect( p->process, SIGNAL(error(QProcess::ProcessError)), this, SLOT(onProcessError(QProcess::ProcessError)) );
+    QObject::connect( p->process, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(onProcessEnd(int,QProcess::ExitStatus)) );
+
+    _processLog.push_back( tr("Starting background rendering: %1 %2\n")
+                           .arg( QCoreApplication::applicationFilePath() )
+                           .arg( p->processArgs.join( QString::fromUtf8(" ") ) ) );
+
+    _processes.push_back(p);
+
+    return p;
+}
+
+ProcessHandler::RenderProcessPtr
+ProcessHandler::findProcess(QObject* object) const
+{
+    if (!object) {
+        return RenderProcessPtr();
     }
-    if (_process) {
-        _process->close();
-        delete _process;
+    for (std::list<RenderProcessPtr>::const_iterator it = _processes.begin(); it != _processes.end(); ++it) {
+        if ( (object == (*it)->process) || (object == (*it)->ipcServer) ||
+             (object == (*it)->bgProcessOutputSocket) || (object == (*it)->bgProcessInputSocket) ) {
+            return *it;
+        }
     }
+
+    return RenderProcessPtr();
 }
 
 void
 ProcessHandler::startProcess()
 {
-    _process->start(QCoreApplication::applicationFilePath(), _processArgs);
+    for (std::list<RenderProcessPtr>::const_iterator it = _processes.begin(); it != _processes.end(); ++it) {
+        if ( !(*it)->finished && ( (*it)->process->state() == QProcess::NotRunning ) ) {
+            (*it)->process->start(QCoreApplication::applicationFilePath(), (*it)->processArgs);
+        }
+    }
 }
 
 const QString &
@@ -144,14 +305,16 @@ ProcessHandler::getProcessLog() const
 void
 ProcessHandler::onNewConnectionPending()
 {
+    RenderProcessPtr p = findProcess( sender() );
+
     ///accept only 1 connection!
-    if (_bgProcessOutputSocket) {
+    if (!p || p->bgProcessOutputSocket) {
         return;
     }
 
-    _bgProcessOutputSocket = _ipcServer->nextPendingConnection();
+    p->bgProcessOutputSocket = p->ipcServer->nextPendingConnection();
 
-    QObject::connect( _bgProcessOutputSocket, SIGNAL(readyRead()), this, SLOT(onDataWrittenToSocket()) );
+    QObject::connect( p->bgProcessOutputSocket, SIGNAL(readyRead()), this, SLOT(onDataWrittenToSocket()) );
 }
 
 void
@@ -160,7 +323,12 @@ ProcessHandler::onDataWrittenToSocket()
     ///always running in the main thread
     assert( QThread::currentThread() == qApp->thread() );
 
-    QString str = QString::fromUtf8( _bgProcessOutputSocket->readLine() );
+    RenderProcessPtr p = findProcess( sender() );
+    if (!p) {
+        return;
+    }
+
+    QString str = QString::fromUtf8( p->bgProcessOutputSocket->readLine() );
     while ( str.endsWith( QLatin1Char('\n') ) ) {
         str.chop(1);
     }
@@ -177,32 +345,43 @@ ProcessHandler::onDataWrittenToSocket()
             str = str.mid(0, foundProgress);
         }
         if ( !str.isEmpty() ) {
+            int frame = str.toInt();
+            if (_processes.size() > 1) {
+                ///A frame rendered again by a retry process is reported only once. The progress of each process
+                ///only covers its own frames: report the progress of the whole sequence instead.
+                if ( !_renderedFrames.insert(frame).second ) {
+                    return;
+                }
+                progressPercent = _nFramesToRender > 0 ? _renderedFrames.size() / (double)_nFramesToRender : 0.;
+            } else {
+                _renderedFrames.insert(frame);
+            }
             //The report does not have extended timer infos
-            Q_EMIT frameRendered(str.toInt(), progressPercent);
+            Q_EMIT frameRendered(frame, progressPercent);
         }
     } else if ( str.startsWith( QString::fromUtf8(kRenderingFinishedStringShort) ) ) {
         ///don't do anything
     } else if ( str.startsWith( QString::fromUtf8(kBgProcessServerCreatedShort) ) ) {
         str = str.remove( QString::fromUtf8(kBgProcessServerCreatedShort) );
         ///the bg process wants us to create the pipe for its input
-        if (!_bgProcessInputSocket) {
-            _bgProcessInputSocket = new QLocalSocket();
-            QObject::connect( _bgProcessInputSocket, SIGNAL(connected()), this, SLOT(onInputPipeConnectionMade()) );
-            _bgProcessInputSocket->connectToServer(str, QLocalSocket::ReadWrite);
+        if (!p->bgProcessInputSocket) {
+            p->bgProcessInputSocket = new QLocalSocket();
+            QObject::connect( p->bgProcessInputSocket, SIGNAL(connected()), this, SLOT(onInputPipeConnectionMade()) );
+            p->bgProcessInputSocket->connectToServer(str, QLocalSocket::ReadWrite);
         }
     } else if ( str.startsWith( QString::fromUtf8(kRenderingStartedShort) ) ) {
         ///if the user pressed cancel prior to the pipe being created, wait for it to be created and send the abort
         ///message right away
-        if (_earlyCancel) {
-            _bgProcessInputSocket->waitForConnected(5000);
-            _earlyCancel = false;
-            onProcessCanceled();
+        if (p->earlyCancel) {
+            p->bgProcessInputSocket->waitForConnected(5000);
+            p->earlyCancel = false;
+            sendAbort(p);
         }
     } else {
         _processLog.append( QString::fromUtf8("Error: Unable to interpret message.\n") );
         throw std::runtime_error("ProcessHandler::onDataWrittenToSocket() received erroneous message");
     }
-}
+} // ProcessHandler::onDataWrittenToSocket
 
 void
 ProcessHandler::onInputPipeConnectionMade()
@@ -216,7 +395,12 @@ ProcessHandler::onInputPipeConnectionMade()
 void
 ProcessHandler::onStandardOutputBytesWritten()
 {
-    QString str = QString::fromUtf8( _process->readAllStandardOutput().data() );
+    QProcess* process = qobject_cast<QProcess*>( sender() );
+
+    if (!process) {
+        return;
+    }
+    QString str = QString::fromUtf8( process->readAllStandardOutput().data() );
 
 #ifdef DEBUG
     qDebug() << "Message(stdout):" << str;
@@ -227,7 +411,12 @@ ProcessHandler::onStandardOutputBytesWritten()
 void
 ProcessHandler::onStandardErrorBytesWritten()
 {
-    QString str = QString::fromUtf8( _process->readAllStandardError().data() );
+    QProcess* process = qobject_cast<QProcess*>( sender() );
+
+    if (!process) {
+        return;
+    }
+    QString str = QString::fromUtf8( process->readAllStandardError().data() );
 
 #ifdef DEBUG
     qDebug() << "Message(stderr):" << str;
@@ -235,16 +424,28 @@ ProcessHandler::onStandardErrorBytesWritten()
     _processLog.append(QString::fromUtf8("Error(stderr): ") + str);
 }
 
+void
+ProcessHandler::sendAbort(const RenderProcessPtr& process)
+{
+    if (process->finished) {
+        return;
+    }
+    if (!process->bgProcessInputSocket) {
+        process->earlyCancel = true;
+    } else {
+        process->bgProcessInputSocket->write( ( QString::fromUtf8(kAbortRenderingStringShort) + QLatin1Char('\n') ).toUtf8() );
+        process->bgProcessInputSocket->flush();
+    }
+}
+
 void
 ProcessHandler::onProcessCanceled()
 {
     Q_EMIT processCanceled();
 
-    if (!_bgProcessInputSocket) {
-        _earlyCancel = true;
-    } else {
-        _bgProcessInputSocket->write( ( QString::fromUtf8(kAbortRenderingStringShort) + QLatin1Char('\n') ).toUtf8() );
-        _bgProcessInputSocket->flush();
+    _canceled = true;
+    for (std::list<RenderProcessPtr>::const_iterator it = _processes.begin(); it != _processes.end(); ++it) {
+        sendAbort(*it);
     }
 }
 
@@ -253,6 +454,13 @@ ProcessHandler::onProcessError(QProcess::ProcessError err)
 {
     if (err == QProcess::FailedToStart) {
         Dialogs::errorDialog( _writer->getScriptName(), tr("The render process failed to start.").toStdString() );
+
+        ///finished() is not emitted in that case
+        RenderProcessPtr p = findProcess( sender() );
+        if (p && !p->finished) {
+            p->nRetries = kProcessHandlerMaxRetries;
+            onRenderProcessEnd(p, 1);
+        }
     } else if (err == QProcess::Crashed) {
         //@TODO: find out a way to get the backtrace
     }
@@ -269,9 +477,46 @@ ProcessHandler::onProcessEnd(int exitCode,
     } else if (exitCode == 1) {
         returnCode = 1;
     }
-    Q_EMIT processFinished(returnCode);
+
+    RenderProcessPtr p = findProcess( sender() );
+    if (!p || p->finished) {
+        return;
+    }
+    onRenderProcessEnd(p, returnCode);
 }
 
+void
+ProcessHandler::onRenderProcessEnd(const RenderProcessPtr& process,
+                                   int returnCode)
+{
+    process->finished = true;
+
+    if ( (returnCode != 0) && !_canceled && _splitFrames ) {
+        ///Give the frames this process did not render to a new process. Frames are rendered concurrently
+        ///by a process so a few frames after the first missing one may be rendered again.
+        FrameRange remaining;
+        if ( !getRemainingFrameRange(process->frames, _renderedFrames, &remaining) ) {
+            ///Everything was rendered
+            returnCode = 0;
+        } else if (process->nRetries < kProcessHandlerMaxRetries) {
+            _processLog.append( tr("The render process %1 failed, rendering its remaining frames in a new process.\n").arg(process->index) );
+            createProcess(remaining, process->nRetries + 1);
+            startProcess();
+
+            return;
+        }
+    }
+
+    _returnCode = std::max(_returnCode, returnCode);
+
+    for (std::list<RenderProcessPtr>::const_iterator it = _processes.begin(); it != _processes.end(); ++it) {
+        if ( !(*it)->finished ) {
+            return;
+        }
+    }
+    Q_EMIT processFinished(_returnCode);
+} // ProcessHandler::onRenderProcessEnd
+
 ProcessInputChannel::ProcessInputChannel(const QString & mainProcessServerName)
     : QThread()
     , _mainProcessServerName(mainProcessServerName)
@@ -27,6 +27,10 @@
 
 #include "Global/Macros.h"
 
+#include <list>
+#include <set>
+#include <vector>
+
 CLANG_DIAG_OFF(deprecated)
 #include <QtCore/QProcess>
 #include <QtCore/QThread>
@@ -36,6 +40,10 @@ CLANG_DIAG_OFF(deprecated)
 #include <QtCore/QWaitCondition>
 CLANG_DIAG_ON(deprecated)
 
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#endif
+
 #include "Global/GlobalDefines.h"
 
 #include "Engine/EngineFwd.h"
@@ -84,27 +92,45 @@ class ProcessHandler
 {
     Q_OBJECT
 
-    QProcess* _process; //< the process executing the render
-    OutputEffectInstance* _writer; //< pointer to the writer that will render in the bg process
-    QLocalServer* _ipcServer; //< the server for IPC with the background process
-    QLocalSocket* _bgProcessOutputSocket; //< the socket where data is output by the process
+    struct RenderProcess;
+    typedef boost::shared_ptr<RenderProcess> RenderProcessPtr;
 
-    //the socket where data is read by the process
-    //note that this socket is initialized only when the background process sends the message
-    //kBgProcessServerCreatedShort, meaning it created its server for the input pipe and we can actually open it.
-    QLocalSocket* _bgProcessInputSocket;
-    bool _earlyCancel; //< true if the user pressed cancel but the _bgProcessInput socket was not created yet
-    QString _processLog; //< used to record the log of the process
-    QStringList _processArgs;
+    OutputEffectInstance* _writer; //< pointer to the writer that will render in the bg process
+    QString _projectPath;
+    int _firstFrame, _lastFrame, _frameStep;
+    bool _splitFrames; //< true if the frame range is given to the processes, false if they use the one of the writer
+    std::list<RenderProcessPtr> _processes; //< the processes executing the render, including the ones that ended
+    std::set<int> _renderedFrames; //< frames reported rendered by any process
+    int _nFramesToRender;
+    int _returnCode; //< the worst return code of the processes whose frames were not rendered again
+    bool _canceled;
+    QString _processLog; //< used to record the log of the processes
 
 public:
 
     /**
-     * @brief Starts a new process which will load the project specified by "projectPath".
-     * The process will render using the effect specified by writer.
+     * @brief The frames first, first + step, ... up to last, rendered by a process
+     **/
+    struct FrameRange
+    {
+        int first, last, step;
+    };
+
+    /**
+     * @brief Starts processes which will load the project specified by "projectPath".
+     * They will render the frames of the given range using the effect specified by writer.
+     * When nProcesses is greater than 1, the frames are split across nProcesses processes, each of them
+     * rendering every nProcesses-th frame of the range, so that graphs containing effects which are not
+     * thread-safe can still use all the cores. The frames not rendered by a process which failed are rendered
+     * again by a new process, a bounded number of times.
+     * The signals of this class aggregate all the processes: processFinished() is emitted once all of them are done.
      **/
     ProcessHandler(const QString & projectPath,
-                   OutputEffectInstance* writer);
+                   OutputEffectInstance* writer,
+                   int firstFrame,
+                   int lastFrame,
+                   int frameStep,
+                   int nProcesses = 1);
 
     virtual ~ProcessHandler();
 
@@ -114,6 +140,34 @@ public:
         return _writer;
     }
 
+    int getNumProcesses() const
+    {
+        return (int)_processes.size();
+    }
+
+    /**
+     * @brief Splits the frames of the given range in at most nProcesses ranges: range i holds every
+     * nProcesses-th frame starting at the i-th one. There are never more ranges than frames.
+     **/
+    static void splitFrameRange(int firstFrame,
+                                int lastFrame,
+                                int frameStep,
+                                int nProcesses,
+                                std::vector<FrameRange>* ranges);
+
+    /**
+     * @brief Returns in remaining the frames of range starting at the first one which is not in renderedFrames.
+     * Returns false if all the frames of range were rendered.
+     **/
+    static bool getRemainingFrameRange(const FrameRange& range,
+                                       const std::set<int>& renderedFrames,
+                                       FrameRange* remaining);
+
+    /**
+     * @brief Returns the frame range as given on the command line of a render process
+     **/
+    static QString getFrameRangeArgument(const FrameRange& range);
+
 public Q_SLOTS:
 
     /**
@@ -161,10 +215,20 @@ public Q_SLOTS:
     void onInputPipeConnectionMade();
 
     /**
-     * @brief Start the process execution
+     * @brief Start the processes execution
      **/
     void startProcess();
 
+private:
+
+    RenderProcessPtr createProcess(const FrameRange& frames, int nRetries);
+
+    RenderProcessPtr findProcess(QObject* object) const;
+
+    void sendAbort(const RenderProcessPtr& process);
+
+    void onRenderProcessEnd(const RenderProcessPtr& process, int returnCode);
+
 Q_SIGNALS:
 
     void deleted();
@@ -27,6 +27,7 @@
 #include <fstream>
 #include <algorithm> // min, max
 #include <ios>
+#include <sstream>
 #include <cstdlib> // strtoul
 #include <cerrno> // errno
 #include <cassert>
@@ -77,6 +78,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/KnobFile.h"
 #include "Engine/Node.h"
 #include "Engine/OutputSchedulerThread.h"
+#include "Engine/ProjectBinaryFormat.h"
 #include "Engine/ProjectPrivate.h"
 #include "Engine/ProjectSerialization.h"
 #include "Engine/RectDSerialization.h"
@@ -290,10 +292,13 @@ Project::loadProjectInternal(const QString & path,
     }
 
     bool ret = false;
+    const bool isBinaryProject = ProjectBinaryReader::isBinaryProjectFile(filePath);
     FStreamsSupport::ifstream ifile;
-    FStreamsSupport::open( &ifile, filePath.toStdString() );
-    if (!ifile) {
-        throw std::runtime_error( tr("Failed to open %1").arg(filePath).toStdString() );
+    if (!isBinaryProject) {
+        FStreamsSupport::open( &ifile, filePath.toStdString() );
+        if (!ifile) {
+            throw std::runtime_error( tr("Failed to open %1").arg(filePath).toStdString() );
+        }
     }
 
     if ( (NATRON_VERSION_MAJOR == 1) && (NATRON_VERSION_MINOR == 0) && (NATRON_VERSION_REVISION == 0) ) {
@@ -319,20 +324,50 @@ Project::loadProjectInternal(const QString & path,
 
     LoadProjectSplashScreen_RAII __raii_splashscreen__(getApp(), name);
 
+    std::list<std::string> nodesToLoad;
+    {
+        QMutexLocker k(&_imp->projectLock);
+        nodesToLoad.swap(_imp->nodesToLoad);
+    }
+
     try {
-        bool bgProject;
-        boost::archive::xml_iarchive iArchive(ifile);
-        {
-            FlagSetter __raii_loadingProjectInternal__(true, &_imp->isLoadingProjectInternal, &_imp->isLoadingProjectMutex);
+        if (isBinaryProject) {
+            ProjectBinaryReader reader(filePath);
+            {
+                FlagSetter __raii_loadingProjectInternal__(true, &_imp->isLoadingProjectInternal, &_imp->isLoadingProjectMutex);
 
-            iArchive >> boost::serialization::make_nvp("Background_project", bgProject);
-            ProjectSerialization projectSerializationObj( getApp() );
-            iArchive >> boost::serialization::make_nvp("Project", projectSerializationObj);
-            ret = load(projectSerializationObj, name, path, mustSave);
-        } // __raii_loadingProjectInternal__
+                ProjectSerialization projectSerializationObj( getApp() );
+                int nLoadedNodes = reader.readProject(nodesToLoad, &projectSerializationObj);
+#ifdef DEBUG
+                if ( nLoadedNodes < reader.getNodesCount() ) {
+                    qDebug() << "Loaded" << nLoadedNodes << "out of" << reader.getNodesCount() << "nodes";
+                }
+#else
+                Q_UNUSED(nLoadedNodes);
+#endif
+                ret = load(projectSerializationObj, name, path, mustSave);
+            } // __raii_loadingProjectInternal__
+
+            if ( !reader.isBackgroundProject() ) {
+                std::istringstream guiStream( reader.readGuiData() );
+                boost::archive::xml_iarchive guiArchive(guiStream);
+                getApp()->loadProjectGui(isAutoSave, guiArchive);
+            }
+        } else {
+            bool bgProject;
+            boost::archive::xml_iarchive iArchive(ifile);
+            {
+                FlagSetter __raii_loadingProjectInternal__(true, &_imp->isLoadingProjectInternal, &_imp->isLoadingProjectMutex);
+
+                iArchive >> boost::serialization::make_nvp("Background_project", bgProject);
+                ProjectSerialization projectSerializationObj( getApp() );
+                iArchive >> boost::serialization::make_nvp("Project", projectSerializationObj);
+                ret = load(projectSerializationObj, name, path, mustSave);
+            } // __raii_loadingProjectInternal__
 
-        if (!bgProject) {
-            getApp()->loadProjectGui(isAutoSave, iArchive);
+            if (!bgProject) {
+                getApp()->loadProjectGui(isAutoSave, iArchive);
+            }
         }
     } catch (...) {
         const ProjectBeingLoadedInfo& pInfo = getApp()->getProjectBeingLoadedInfo();
@@ -397,6 +432,14 @@ Project::loadProjectInternal(const QString & path,
     return ret;
 } // Project::loadProjectInternal
 
+void
+Project::setNodesToLoadOnNextLoad(const std::list<std::string>& scriptNames)
+{
+    QMutexLocker k(&_imp->projectLock);
+
+    _imp->nodesToLoad = scriptNames;
+}
+
 bool
 Project::saveProject(const QString & path,
                      const QString & name,
@@ -546,9 +589,11 @@ Project::saveProjectInternal(const QString & path,
     StrUtils::ensureLastPathSeparator(tmpFilename);
     tmpFilename.append( QString::number( time.toMSecsSinceEpoch() ) );
 
+    // Render saves are only read back by this version of the application, on this machine: they are always binary
+    const bool saveAsBinary = isRenderSave || appPTR->getCurrentSettings()->isSaveProjectsInBinaryFormatEnabled();
     {
         FStreamsSupport::ofstream ofile;
-        FStreamsSupport::open( &ofile, tmpFilename.toStdString() );
+        FStreamsSupport::open( &ofile, tmpFilename.toStdString(), saveAsBinary ? (std::ios_base::out | std::ios_base::binary) : std::ios_base::out );
         if (!ofile) {
             throw std::runtime_error( tr("Failed to open file ").toStdString() + tmpFilename.toStdString() );
         }
@@ -564,16 +609,32 @@ Project::saveProjectInternal(const QString & path,
         }
 
         try {
-            boost::archive::xml_oarchive oArchive(ofile);
             bool bgProject = getApp()->isBackground();
-            oArchive << boost::serialization::make_nvp("Background_project", bgProject);
             ProjectSerialization projectSerializationObj( getApp() );
             save(&projectSerializationObj);
-            oArchive << boost::serialization::make_nvp("Project", projectSerializationObj);
-            if (!bgProject) {
-                AppInstancePtr app = getApp();
-                if (app) {
-                    app->saveProjectGui(oArchive);
+            if (saveAsBinary) {
+                std::string guiData;
+                if (!bgProject) {
+                    AppInstancePtr app = getApp();
+                    if (app) {
+                        std::ostringstream guiStream;
+                        {
+                            boost::archive::xml_oarchive guiArchive(guiStream);
+                            app->saveProjectGui(guiArchive);
+                        }
+                        guiData = guiStream.str();
+                    }
+                }
+                ProjectBinaryWriter::write(ofile, bgProject, &projectSerializationObj, guiData);
+            } else {
+                boost::archive::xml_oarchive oArchive(ofile);
+                oArchive << boost::serialization::make_nvp("Background_project", bgProject);
+                oArchive << boost::serialization::make_nvp("Project", projectSerializationObj);
+                if (!bgProject) {
+                    AppInstancePtr app = getApp();
+                    if (app) {
+                        app->saveProjectGui(oArchive);
+                    }
                 }
             }
         } catch (...) {
@@ -93,6 +93,12 @@ public:
      **/
     bool loadProject(const QString & path, const QString & name, bool isUntitledAutosave = false, bool attemptToLoadAutosave = true);
 
+    /**
+     * @brief If the next project loaded is in the binary format, only the given nodes and the nodes they
+     * depend on are loaded. This is used by command-line renders which only need the Write nodes they render.
+     **/
+    void setNodesToLoadOnNextLoad(const std::list<std::string>& scriptNames);
+
 
     /**
      * @brief Saves the project with the given path and name corresponding to a file on disk.
@@ -0,0 +1,617 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ProjectBinaryFormat.h"
+
+#include <cassert>
+#include <cstring>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <streambuf>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+GCC_DIAG_OFF(unused-parameter)
+// /opt/local/include/boost/serialization/smart_cast.hpp:254:25: warning: unused parameter 'u' [-Wunused-parameter]
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/serialization/list.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+GCC_DIAG_ON(unused-parameter)
+#endif
+
+#include <QtCore/QFile>
+
+#include "Engine/KnobTypes.h"
+#include "Engine/NodeGroupSerialization.h"
+#include "Engine/NodeSerialization.h"
+#include "Engine/ProjectSerialization.h"
+
+NATRON_NAMESPACE_ENTER
+
+///Position of a serialized part in the file
+struct ProjectBinaryBlob
+{
+    U64 offset;
+    U64 size;
+
+    ProjectBinaryBlob()
+        : offset(0)
+        , size(0)
+    {
+    }
+
+    template<class Archive>
+    void serialize(Archive & ar,
+                   const unsigned int /*version*/)
+    {
+        ar & ::boost::serialization::make_nvp("Offset", offset);
+        ar & ::boost::serialization::make_nvp("Size", size);
+    }
+};
+
+struct ProjectBinaryNodeEntry
+{
+    std::string scriptName;
+    std::string pluginID;
+
+    ///Script-names of the top-level nodes this node needs to be restored properly
+    std::list<std::string> dependencies;
+    ProjectBinaryBlob blob;
+
+    template<class Archive>
+    void serialize(Archive & ar,
+                   const unsigned int /*version*/)
+    {
+        ar & ::boost::serialization::make_nvp("ScriptName", scriptName);
+        ar & ::boost::serialization::make_nvp("PluginID", pluginID);
+        ar & ::boost::serialization::make_nvp("Dependencies", dependencies);
+        ar & ::boost::serialization::make_nvp("Blob", blob);
+    }
+};
+
+struct ProjectBinaryIndex
+{
+    bool bgProject;
+
+    ///False if the project has callbacks which may reference any node, in which case all nodes must be loaded
+    bool partialLoadSupported;
+    ProjectBinaryBlob project;
+    std::vector<ProjectBinaryNodeEntry> nodes;
+    ProjectBinaryBlob gui;
+
+    ProjectBinaryIndex()
+        : bgProject(false)
+        , partialLoadSupported(true)
+        , project()
+        , nodes()
+        , gui()
+    {
+    }
+
+    template<class Archive>
+    void serialize(Archive & ar,
+                   const unsigned int /*version*/)
+    {
+        ar & ::boost::serialization::make_nvp("Background_project", bgProject);
+        ar & ::boost::serialization::make_nvp("PartialLoadSupported", partialLoadSupported);
+        ar & ::boost::serialization::make_nvp("Project", project);
+        ar & ::boost::serialization::make_nvp("Nodes", nodes);
+        ar & ::boost::serialization::make_nvp("Gui", gui);
+    }
+};
+
+///Fixed size header at the start of the file
+struct ProjectBinaryHeader
+{
+    char magic[NATRON_PROJECT_BINARY_MAGIC_SIZE];
+    U32 version;
+    U32 flags;
+    U64 indexOffset;
+    U64 indexSize;
+};
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+///Read-only stream buffer over a memory region, so that boost archives can read directly from the mapped file
+class MemoryStreamBuf
+    : public std::streambuf
+{
+public:
+
+    MemoryStreamBuf(const char* data,
+                    std::size_t size)
+    {
+        char* begin = const_cast<char*>(data);
+
+        setg(begin, begin, begin + size);
+    }
+};
+
+///Appends to names all identifiers found in a Python expression
+void
+extractIdentifiers(const std::string& expr,
+                   std::set<std::string>* names)
+{
+    std::size_t i = 0;
+
+    while ( i < expr.size() ) {
+        char c = expr[i];
+        if ( ( (c >= 'a') && (c <= 'z') ) || ( (c >= 'A') && (c <= 'Z') ) || (c == '_') ) {
+            std::size_t start = i;
+            while ( i < expr.size() ) {
+                c = expr[i];
+                if ( ( (c >= 'a') && (c <= 'z') ) || ( (c >= 'A') && (c <= 'Z') ) || ( (c >= '0') && (c <= '9') ) || (c == '_') ) {
+                    ++i;
+                } else {
+                    break;
+                }
+            }
+            names->insert( expr.substr(start, i - start) );
+        } else if ( (c >= '0') && (c <= '9') ) {
+            // skip numbers so that e.g 1e3 is not taken as an identifier
+            while ( i < expr.size() && ( ( (expr[i] >= '0') && (expr[i] <= '9') ) || ( (expr[i] >= 'a') && (expr[i] <= 'z') ) || ( (expr[i] >= 'A') && (expr[i] <= 'Z') ) || (expr[i] == '.') ) ) {
+                ++i;
+            }
+        } else {
+            ++i;
+        }
+    }
+}
+
+///Returns the name of the top-level node of a fully qualified name, e.g: Group1 for Group1.Blur1
+std::string
+getTopLevelName(const std::string& name)
+{
+    std::size_t foundDot = name.find('.');
+
+    if (foundDot == std::string::npos) {
+        return name;
+    }
+
+    return name.substr(0, foundDot);
+}
+
+void
+collectKnobReferences(const KnobSerializationBasePtr& knob,
+                      std::set<std::string>* names)
+{
+    KnobSerialization* isKnob = dynamic_cast<KnobSerialization*>( knob.get() );
+
+    if (isKnob) {
+        const std::list<MasterSerialization>& masters = isKnob->getMasters();
+        for (std::list<MasterSerialization>::const_iterator it = masters.begin(); it != masters.end(); ++it) {
+            if ( !it->masterNodeName.empty() ) {
+                names->insert( getTopLevelName(it->masterNodeName) );
+            }
+        }
+        const std::vector<std::pair<std::string, bool> >& expressions = isKnob->getExpressions();
+        for (std::size_t i = 0; i < expressions.size(); ++i) {
+            extractIdentifiers(expressions[i].first, names);
+        }
+
+        return;
+    }
+
+    GroupKnobSerialization* isGroup = dynamic_cast<GroupKnobSerialization*>( knob.get() );
+    if (isGroup) {
+        const std::list<KnobSerializationBasePtr>& children = isGroup->getChildren();
+        for (std::list<KnobSerializationBasePtr>::const_iterator it = children.begin(); it != children.end(); ++it) {
+            collectKnobReferences(*it, names);
+        }
+    }
+}
+
+/**
+ * @brief Collects the names of all nodes referenced by the node and, for a group, the nodes it contains.
+ * This is conservative: any identifier used in an expression is considered as a potential node name.
+ **/
+void
+collectNodeReferences(const NodeSerialization& node,
+                      std::set<std::string>* names)
+{
+    const std::map<std::string, std::string>& inputs = node.getInputs();
+
+    for (std::map<std::string, std::string>::const_iterator it = inputs.begin(); it != inputs.end(); ++it) {
+        if ( !it->second.empty() ) {
+            names->insert( getTopLevelName(it->second) );
+        }
+    }
+    const std::vector<std::string>& oldInputs = node.getOldInputs();
+    for (std::size_t i = 0; i < oldInputs.size(); ++i) {
+        if ( !oldInputs[i].empty() ) {
+            names->insert( getTopLevelName(oldInputs[i]) );
+        }
+    }
+    if ( !node.getMasterNodeName().empty() ) {
+        names->insert( getTopLevelName( node.getMasterNodeName() ) );
+    }
+    if ( !node.getMultiInstanceParentName().empty() ) {
+        names->insert( getTopLevelName( node.getMultiInstanceParentName() ) );
+    }
+
+    const NodeSerialization::KnobValues& knobs = node.getKnobsValues();
+    for (NodeSerialization::KnobValues::const_iterator it = knobs.begin(); it != knobs.end(); ++it) {
+        collectKnobReferences(*it, names);
+    }
+    const std::list<GroupKnobSerializationPtr>& userPages = node.getUserPages();
+    for (std::list<GroupKnobSerializationPtr>::const_iterator it = userPages.begin(); it != userPages.end(); ++it) {
+        collectKnobReferences(*it, names);
+    }
+
+    const std::list<NodeSerializationPtr>& children = node.getNodesCollection();
+    for (std::list<NodeSerializationPtr>::const_iterator it = children.begin(); it != children.end(); ++it) {
+        collectNodeReferences(**it, names);
+    }
+}
+
+///Returns true if the knob is a Python callback with a script set
+bool
+isNonEmptyCallback(const KnobSerializationPtr& serialization,
+                   const char* const* callbackNames)
+{
+    KnobIPtr knob = serialization->getKnob();
+
+    if (!knob) {
+        return false;
+    }
+    for (int i = 0; callbackNames[i]; ++i) {
+        if (knob->getName() == callbackNames[i]) {
+            KnobString* isString = dynamic_cast<KnobString*>( knob.get() );
+
+            return isString && !isString->getValue().empty();
+        }
+    }
+
+    return false;
+}
+
+///Returns true if the node or, for a group, one of the nodes it contains has a callback
+bool
+hasNodeCallbacks(const NodeSerialization& node)
+{
+    // A node callback may access any node of the project, see Node::createNodePage
+    static const char* const nodeCallbacks[] = {
+        "onParamChanged", "onInputChanged", "afterNodeCreated", "beforeNodeRemoval",
+        "beforeFrameRender", "beforeRender", "afterFrameRender", "afterRender", 0
+    };
+    const NodeSerialization::KnobValues& knobs = node.getKnobsValues();
+
+    for (NodeSerialization::KnobValues::const_iterator it = knobs.begin(); it != knobs.end(); ++it) {
+        if ( isNonEmptyCallback(*it, nodeCallbacks) ) {
+            return true;
+        }
+    }
+
+    const std::list<NodeSerializationPtr>& children = node.getNodesCollection();
+    for (std::list<NodeSerializationPtr>::const_iterator it = children.begin(); it != children.end(); ++it) {
+        if ( hasNodeCallbacks(**it) ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+///Returns true if the project or one of its nodes has a callback (e.g: afterProjectLoad) that may access any node of the project
+bool
+hasProjectWideCallbacks(const ProjectSerialization& project)
+{
+    static const char* const projectCallbacks[] = {
+        "afterProjectLoad", "afterNodeCreated", 0
+    };
+    const std::list<KnobSerializationPtr>& knobs = project.getProjectKnobsValues();
+
+    for (std::list<KnobSerializationPtr>::const_iterator it = knobs.begin(); it != knobs.end(); ++it) {
+        if ( isNonEmptyCallback(*it, projectCallbacks) ) {
+            return true;
+        }
+    }
+
+    const std::list<NodeSerializationPtr>& nodes = project.getNodesSerialization().getNodesSerialization();
+    for (std::list<NodeSerializationPtr>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        if ( hasNodeCallbacks(**it) ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template <typename T>
+void
+writeBlob(std::ostream& stream,
+          const char* name,
+          const T& obj,
+          ProjectBinaryBlob* blob)
+{
+    blob->offset = (U64)stream.tellp();
+    {
+        boost::archive::binary_oarchive oArchive(stream);
+        oArchive << boost::serialization::make_nvp(name, obj);
+    }
+    blob->size = (U64)stream.tellp() - blob->offset;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+ProjectBinaryWriter::write(std::ostream& stream,
+                           bool bgProject,
+                           ProjectSerialization* project,
+                           const std::string& guiData)
+{
+    ProjectBinaryHeader header;
+
+    std::memset( &header, 0, sizeof(header) );
+    std::memcpy(header.magic, NATRON_PROJECT_BINARY_MAGIC, NATRON_PROJECT_BINARY_MAGIC_SIZE);
+    header.version = NATRON_PROJECT_BINARY_VERSION;
+
+    // Reserve the header, it is written again once the index position is known
+    std::streampos start = stream.tellp();
+    stream.write( (const char*)&header, sizeof(header) );
+
+    ProjectBinaryIndex index;
+    index.bgProject = bgProject;
+    index.partialLoadSupported = !hasProjectWideCallbacks(*project);
+
+    // The project settings, without the nodes
+    NodeCollectionSerialization nodes;
+    project->swapNodesSerialization(&nodes);
+    try {
+        writeBlob(stream, "Project", *project, &index.project);
+    } catch (...) {
+        project->swapNodesSerialization(&nodes);
+        throw;
+    }
+    project->swapNodesSerialization(&nodes);
+
+    // Each top-level node
+    const std::list<NodeSerializationPtr>& serializedNodes = project->getNodesSerialization().getNodesSerialization();
+    std::set<std::string> topLevelNames;
+    for (std::list<NodeSerializationPtr>::const_iterator it = serializedNodes.begin(); it != serializedNodes.end(); ++it) {
+        topLevelNames.insert( (*it)->getNodeScriptName() );
+    }
+    index.nodes.resize( serializedNodes.size() );
+    std::size_t i = 0;
+    for (std::list<NodeSerializationPtr>::const_iterator it = serializedNodes.begin(); it != serializedNodes.end(); ++it, ++i) {
+        ProjectBinaryNodeEntry& entry = index.nodes[i];
+        entry.scriptName = (*it)->getNodeScriptName();
+        entry.pluginID = (*it)->getPluginID();
+
+        std::set<std::string> references;
+        collectNodeReferences(**it, &references);
+        for (std::set<std::string>::const_iterator it2 = references.begin(); it2 != references.end(); ++it2) {
+            if ( ( *it2 != entry.scriptName ) && ( topLevelNames.find(*it2) != topLevelNames.end() ) ) {
+                entry.dependencies.push_back(*it2);
+            }
+        }
+
+        writeBlob(stream, "Node", **it, &entry.blob);
+    }
+
+    // The Gui, as is
+    index.gui.offset = (U64)stream.tellp();
+    index.gui.size = guiData.size();
+    stream.write( guiData.data(), guiData.size() );
+
+    // The index
+    ProjectBinaryBlob indexBlob;
+    writeBlob(stream, "Index", index, &indexBlob);
+    header.indexOffset = indexBlob.offset;
+    header.indexSize = indexBlob.size;
+
+    std::streampos end = stream.tellp();
+    stream.seekp(start);
+    stream.write( (const char*)&header, sizeof(header) );
+    stream.seekp(end);
+
+    if (!stream) {
+        throw std::runtime_error("Failed to write the binary project");
+    }
+} // ProjectBinaryWriter::write
+
+struct ProjectBinaryReaderPrivate
+{
+    QFile file;
+    const char* data;
+    U64 size;
+    ProjectBinaryIndex index;
+
+    ProjectBinaryReaderPrivate(const QString& filePath)
+        : file(filePath)
+        , data(0)
+        , size(0)
+        , index()
+    {
+    }
+
+    template <typename T>
+    void readBlob(const ProjectBinaryBlob& blob,
+                  const char* name,
+                  T* obj) const
+    {
+        if ( (blob.offset > size) || (blob.size > size - blob.offset) ) {
+            throw std::runtime_error("Damaged binary project: invalid offset");
+        }
+        MemoryStreamBuf buf(data + blob.offset, blob.size);
+        boost::archive::binary_iarchive iArchive(buf);
+        iArchive >> boost::serialization::make_nvp(name, *obj);
+    }
+
+    /**
+     * @brief Marks in toLoad the given nodes and all the nodes they depend on
+     **/
+    void computeNodesToLoad(const std::list<std::string>& requiredNodes,
+                            std::vector<bool>* toLoad) const;
+};
+
+ProjectBinaryReader::ProjectBinaryReader(const QString& filePath)
+    : _imp( new ProjectBinaryReaderPrivate(filePath) )
+{
+    if ( !_imp->file.open(QIODevice::ReadOnly) ) {
+        throw std::runtime_error( "Failed to open " + filePath.toStdString() );
+    }
+    _imp->size = (U64)_imp->file.size();
+    if ( _imp->size < sizeof(ProjectBinaryHeader) ) {
+        throw std::runtime_error("Damaged binary project: file too small");
+    }
+    _imp->data = (const char*)_imp->file.map(0, _imp->file.size());
+    if (!_imp->data) {
+        throw std::runtime_error( "Failed to map " + filePath.toStdString() );
+    }
+
+    ProjectBinaryHeader header;
+    std::memcpy( &header, _imp->data, sizeof(header) );
+    if (std::memcmp(header.magic, NATRON_PROJECT_BINARY_MAGIC, NATRON_PROJECT_BINARY_MAGIC_SIZE) != 0) {
+        throw std::runtime_error("Not a binary project");
+    }
+    if (header.version > NATRON_PROJECT_BINARY_VERSION) {
+        throw std::runtime_error("The binary project was written by a more recent version");
+    }
+
+    ProjectBinaryBlob indexBlob;
+    indexBlob.offset = header.indexOffset;
+    indexBlob.size = header.indexSize;
+    _imp->readBlob(indexBlob, "Index", &_imp->index);
+}
+
+ProjectBinaryReader::~ProjectBinaryReader()
+{
+}
+
+bool
+ProjectBinaryReader::isBinaryProjectFile(const QString& filePath)
+{
+    QFile file(filePath);
+
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        return false;
+    }
+    char magic[NATRON_PROJECT_BINARY_MAGIC_SIZE];
+    if (file.read(magic, NATRON_PROJECT_BINARY_MAGIC_SIZE) != NATRON_PROJECT_BINARY_MAGIC_SIZE) {
+        return false;
+    }
+
+    return std::memcmp(magic, NATRON_PROJECT_BINARY_MAGIC, NATRON_PROJECT_BINARY_MAGIC_SIZE) == 0;
+}
+
+bool
+ProjectBinaryReader::isBackgroundProject() const
+{
+    return _imp->index.bgProject;
+}
+
+int
+ProjectBinaryReader::getNodesCount() const
+{
+    return (int)_imp->index.nodes.size();
+}
+
+void
+ProjectBinaryReaderPrivate::computeNodesToLoad(const std::list<std::string>& requiredNodes,
+                                               std::vector<bool>* toLoad) const
+{
+    if ( requiredNodes.empty() || !index.partialLoadSupported ) {
+        toLoad->assign(index.nodes.size(), true);
+
+        return;
+    }
+
+    toLoad->assign(index.nodes.size(), false);
+
+    std::map<std::string, std::size_t> indexOfName;
+    for (std::size_t i = 0; i < index.nodes.size(); ++i) {
+        indexOfName[index.nodes[i].scriptName] = i;
+    }
+
+    std::vector<std::size_t> stack;
+    for (std::list<std::string>::const_iterator it = requiredNodes.begin(); it != requiredNodes.end(); ++it) {
+        std::map<std::string, std::size_t>::const_iterator found = indexOfName.find( getTopLevelName(*it) );
+        if ( found != indexOfName.end() ) {
+            stack.push_back(found->second);
+        }
+    }
+
+    while ( !stack.empty() ) {
+        std::size_t i = stack.back();
+        stack.pop_back();
+        if ( (*toLoad)[i] ) {
+            continue;
+        }
+        (*toLoad)[i] = true;
+
+        const std::list<std::string>& dependencies = index.nodes[i].dependencies;
+        for (std::list<std::string>::const_iterator it = dependencies.begin(); it != dependencies.end(); ++it) {
+            std::map<std::string, std::size_t>::const_iterator found = indexOfName.find(*it);
+            if ( ( found != indexOfName.end() ) && !(*toLoad)[found->second] ) {
+                stack.push_back(found->second);
+            }
+        }
+    }
+}
+
+int
+ProjectBinaryReader::readProject(const std::list<std::string>& requiredNodes,
+                                 ProjectSerialization* project) const
+{
+    _imp->readBlob(_imp->index.project, "Project", project);
+
+    std::vector<bool> toLoad;
+    _imp->computeNodesToLoad(requiredNodes, &toLoad);
+
+    // Keep the order of the file: nodes are created in that order
+    NodeCollectionSerialization nodes;
+    int nLoaded = 0;
+    for (std::size_t i = 0; i < _imp->index.nodes.size(); ++i) {
+        if (!toLoad[i]) {
+            continue;
+        }
+        NodeSerializationPtr node = boost::make_shared<NodeSerialization>();
+        _imp->readBlob(_imp->index.nodes[i].blob, "Node", node.get());
+        nodes.addNodeSerialization(node);
+        ++nLoaded;
+    }
+    project->swapNodesSerialization(&nodes);
+
+    return nLoaded;
+}
+
+std::string
+ProjectBinaryReader::readGuiData() const
+{
+    const ProjectBinaryBlob& blob = _imp->index.gui;
+
+    if ( (blob.offset > _imp->size) || (blob.size > _imp->size - blob.offset) ) {
+        throw std::runtime_error("Damaged binary project: invalid offset");
+    }
+
+    return std::string(_imp->data + blob.offset, blob.size);
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,128 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_PROJECTBINARYFORMAT_H
+#define NATRON_ENGINE_PROJECTBINARYFORMAT_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <ostream>
+#include <string>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include <QtCore/QString>
+
+#include "Engine/EngineFwd.h"
+
+///The first bytes of a project file saved in the binary format
+#define NATRON_PROJECT_BINARY_MAGIC "NatronBP"
+#define NATRON_PROJECT_BINARY_MAGIC_SIZE 8
+
+#define NATRON_PROJECT_BINARY_VERSION_INITIAL 1
+#define NATRON_PROJECT_BINARY_VERSION NATRON_PROJECT_BINARY_VERSION_INITIAL
+
+NATRON_NAMESPACE_ENTER
+
+/*
+   Layout of a binary project file:
+
+   - a fixed size header: the magic, the format version, the offset and the size of the index
+   - the project settings, serialized without any node
+   - each node of the root NodeGroup, serialized on its own (a group embeds the nodes it contains)
+   - the state of the Gui, serialized in XML as it is in a regular project
+   - the index: for each node its script-name, the top-level nodes it depends on (through inputs,
+     links and expressions) and where it lies in the file
+
+   Each part is a separate boost binary archive so that the reader, which maps the file in memory,
+   only has to deserialize the parts it needs.
+   The binary archives are not portable across platforms nor across versions of boost: the XML format
+   remains the one to use to exchange projects.
+ */
+
+class ProjectBinaryWriter
+{
+public:
+
+    /**
+     * @brief Writes the project to the given stream, which must be opened in binary mode and be seekable.
+     * The nodes of the serialization are moved out of it while writing the project settings and are given
+     * back before returning.
+     * @param guiData The state of the Gui serialized in XML, or an empty string for background projects.
+     * This function throws on failure.
+     **/
+    static void write(std::ostream& stream,
+                      bool bgProject,
+                      ProjectSerialization* project,
+                      const std::string& guiData);
+};
+
+struct ProjectBinaryReaderPrivate;
+class ProjectBinaryReader
+{
+public:
+
+    /**
+     * @brief Maps the file in memory and reads its index. Throws if the file is not a valid binary project.
+     **/
+    explicit ProjectBinaryReader(const QString& filePath);
+
+    ~ProjectBinaryReader();
+
+    /**
+     * @brief Returns true if the file starts with NATRON_PROJECT_BINARY_MAGIC
+     **/
+    static bool isBinaryProjectFile(const QString& filePath);
+
+    bool isBackgroundProject() const;
+
+    int getNodesCount() const;
+
+    /**
+     * @brief Deserializes the project settings and the nodes of the root NodeGroup into project.
+     * If requiredNodes is not empty, only these nodes and the nodes they depend on are deserialized,
+     * unless the project has callbacks that may reference any node, in which case all nodes are.
+     * Names that do not belong to the root NodeGroup are ignored, fully qualified names
+     * (e.g: Group1.Write1) stand for their top-level group.
+     * @returns The number of nodes deserialized. This function throws on failure.
+     **/
+    int readProject(const std::list<std::string>& requiredNodes,
+                    ProjectSerialization* project) const;
+
+    /**
+     * @brief Returns the state of the Gui, serialized in XML
+     **/
+    std::string readGuiData() const;
+
+private:
+
+    boost::scoped_ptr<ProjectBinaryReaderPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_PROJECTBINARYFORMAT_H
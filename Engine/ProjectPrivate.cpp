@@ -62,6 +62,7 @@ ProjectPrivate::ProjectPrivate(Project* project)
     , builtinFormats()
     , additionalFormats()
     , formatMutex(QMutex::Recursive)
+    , nodesToLoad()
     , envVars()
     , projectName()
     , projectPath()
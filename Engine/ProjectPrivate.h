@@ -68,6 +68,7 @@ public:
     std::list<Format> builtinFormats;
     std::list<Format> additionalFormats; //< added by the user
     mutable QMutex formatMutex; //< protects builtinFormats & additionalFormats
+    std::list<std::string> nodesToLoad; //< if not empty, the nodes needed by the next load of a binary project. Protected by projectLock
 
 
     ///Project parameters (settings)
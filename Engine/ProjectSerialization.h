@@ -149,6 +149,15 @@ public:
         return _nodes;
     }
 
+    /**
+     * @brief Exchanges the nodes of the project with the given collection. This is used by the
+     * binary project format which stores each node separately from the project settings.
+     **/
+    void swapNodesSerialization(NodeCollectionSerialization* nodes)
+    {
+        _nodes.swap(*nodes);
+    }
+
     qint64 getCreationDate() const
     {
         return _creationDate;
@@ -65,6 +65,22 @@ struct NodeRenderStatsPrivate
     int nbCacheHit;
     int nbCacheHitButDownscaledImages;
 
+    //Roto shapes polygons cache access infos
+    int nbRotoPolygonCacheMisses;
+    int nbRotoPolygonCacheHits;
+
+    //Copies of the input images made to convert them to the format expected by the node
+    int nbInputImageCopies;
+    U64 nbInputImageBytesCopied;
+
+    //Time elapsed since the frame was requested when the viewer displayed its first tile, or -1
+    double firstTileLatency;
+
+    //Uploads of the viewer textures to the GPU
+    int nbTextureUploads;
+    U64 nbTextureBytesUploaded;
+    double textureUploadTime;
+
     //Is tile support enabled for this render
     bool tileSupportEnabled;
 
@@ -88,6 +104,14 @@ struct NodeRenderStatsPrivate
         , nbCacheMisses(0)
         , nbCacheHit(0)
         , nbCacheHitButDownscaledImages(0)
+        , nbRotoPolygonCacheMisses(0)
+        , nbRotoPolygonCacheHits(0)
+        , nbInputImageCopies(0)
+        , nbInputImageBytesCopied(0)
+        , firstTileLatency(-1)
+        , nbTextureUploads(0)
+        , nbTextureBytesUploaded(0)
+        , textureUploadTime(0)
         , tileSupportEnabled(false)
         , renderScaleSupportEnabled(false)
         , channelsEnabled()
@@ -127,6 +151,14 @@ NodeRenderStats::operator=(const NodeRenderStats& other)
     _imp->nbCacheMisses = other._imp->nbCacheMisses;
     _imp->nbCacheHit = other._imp->nbCacheHit;
     _imp->nbCacheHitButDownscaledImages = other._imp->nbCacheHitButDownscaledImages;
+    _imp->nbRotoPolygonCacheMisses = other._imp->nbRotoPolygonCacheMisses;
+    _imp->nbRotoPolygonCacheHits = other._imp->nbRotoPolygonCacheHits;
+    _imp->nbInputImageCopies = other._imp->nbInputImageCopies;
+    _imp->nbInputImageBytesCopied = other._imp->nbInputImageBytesCopied;
+    _imp->firstTileLatency = other._imp->firstTileLatency;
+    _imp->nbTextureUploads = other._imp->nbTextureUploads;
+    _imp->nbTextureBytesUploaded = other._imp->nbTextureBytesUploaded;
+    _imp->textureUploadTime = other._imp->textureUploadTime;
     _imp->tileSupportEnabled = other._imp->tileSupportEnabled;
     _imp->renderScaleSupportEnabled = other._imp->renderScaleSupportEnabled;
     for (int i = 0; i < 4; ++i) {
@@ -253,6 +285,72 @@ NodeRenderStats::getCacheAccessInfos(int* nbCacheMisses,
     *nbCacheHitButDownscaledImages = _imp->nbCacheHitButDownscaledImages;
 }
 
+void
+NodeRenderStats::addRotoPolygonCacheAccessInfo(bool isCacheMiss)
+{
+    if (isCacheMiss) {
+        ++_imp->nbRotoPolygonCacheMisses;
+    } else {
+        ++_imp->nbRotoPolygonCacheHits;
+    }
+}
+
+void
+NodeRenderStats::getRotoPolygonCacheAccessInfos(int* nbCacheMisses,
+                                                int* nbCacheHits) const
+{
+    *nbCacheMisses = _imp->nbRotoPolygonCacheMisses;
+    *nbCacheHits = _imp->nbRotoPolygonCacheHits;
+}
+
+void
+NodeRenderStats::addInputImageCopyInfo(U64 nbBytesCopied)
+{
+    ++_imp->nbInputImageCopies;
+    _imp->nbInputImageBytesCopied += nbBytesCopied;
+}
+
+void
+NodeRenderStats::getInputImageCopyInfos(int* nbCopies,
+                                        U64* nbBytesCopied) const
+{
+    *nbCopies = _imp->nbInputImageCopies;
+    *nbBytesCopied = _imp->nbInputImageBytesCopied;
+}
+
+void
+NodeRenderStats::setFirstTileLatency(double time)
+{
+    if (_imp->firstTileLatency < 0) {
+        _imp->firstTileLatency = time;
+    }
+}
+
+double
+NodeRenderStats::getFirstTileLatency() const
+{
+    return _imp->firstTileLatency;
+}
+
+void
+NodeRenderStats::addTextureUploadInfo(double time,
+                                      U64 nbBytes)
+{
+    ++_imp->nbTextureUploads;
+    _imp->nbTextureBytesUploaded += nbBytes;
+    _imp->textureUploadTime += time;
+}
+
+void
+NodeRenderStats::getTextureUploadInfos(int* nbUploads,
+                                       U64* nbBytes,
+                                       double* timeSpent) const
+{
+    *nbUploads = _imp->nbTextureUploads;
+    *nbBytes = _imp->nbTextureBytesUploaded;
+    *timeSpent = _imp->textureUploadTime;
+}
+
 void
 NodeRenderStats::setTilesSupported(bool tilesSupported)
 {
@@ -414,6 +512,54 @@ RenderStats::addCacheInfosForNode(const NodePtr& node,
     stats.addCacheAccessInfo(isCacheMiss, hasDownscaled);
 }
 
+void
+RenderStats::addRotoPolygonCacheInfosForNode(const NodePtr& node,
+                                             bool isCacheMiss)
+{
+    QMutexLocker k(&_imp->lock);
+
+    assert(_imp->doNodesProfiling);
+
+    NodeRenderStats& stats = _imp->findOrCreateNodeStats(node);
+    stats.addRotoPolygonCacheAccessInfo(isCacheMiss);
+}
+
+void
+RenderStats::addInputImageCopyInfosForNode(const NodePtr& node,
+                                           U64 nbBytesCopied)
+{
+    QMutexLocker k(&_imp->lock);
+
+    assert(_imp->doNodesProfiling);
+
+    NodeRenderStats& stats = _imp->findOrCreateNodeStats(node);
+    stats.addInputImageCopyInfo(nbBytesCopied);
+}
+
+void
+RenderStats::setFirstTileLatencyForNode(const NodePtr& node)
+{
+    QMutexLocker k(&_imp->lock);
+
+    assert(_imp->doNodesProfiling);
+
+    NodeRenderStats& stats = _imp->findOrCreateNodeStats(node);
+    stats.setFirstTileLatency( _imp->totalTimeSpentForFrameTimer.getTimeSinceCreation() );
+}
+
+void
+RenderStats::addTextureUploadInfosForNode(const NodePtr& node,
+                                          double timeSpent,
+                                          U64 nbBytes)
+{
+    QMutexLocker k(&_imp->lock);
+
+    assert(_imp->doNodesProfiling);
+
+    NodeRenderStats& stats = _imp->findOrCreateNodeStats(node);
+    stats.addTextureUploadInfo(timeSpent, nbBytes);
+}
+
 void
 RenderStats::addRenderInfosForNode(const NodePtr& node,
                                    const NodePtr& identity,
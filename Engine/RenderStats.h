@@ -87,6 +87,25 @@ public:
     void addCacheAccessInfo(bool isCacheMiss, bool hasDownscaled);
     void getCacheAccessInfos(int* nbCacheMisses, int* nbCacheHits, int* nbCacheHitButDownscaledImages) const;
 
+    void addRotoPolygonCacheAccessInfo(bool isCacheMiss);
+    void getRotoPolygonCacheAccessInfos(int* nbCacheMisses, int* nbCacheHits) const;
+
+    void addInputImageCopyInfo(U64 nbBytesCopied);
+    void getInputImageCopyInfos(int* nbCopies, U64* nbBytesCopied) const;
+
+    /**
+     * @brief The time in seconds between the request of the frame and the first tile displayed by the viewer,
+     * when tiles are displayed progressively. Only the first call is recorded. Returns -1 if not set.
+     **/
+    void setFirstTileLatency(double time);
+    double getFirstTileLatency() const;
+
+    /**
+     * @brief The time in seconds spent by the viewer to upload the textures of the frame to the GPU, and their size.
+     **/
+    void addTextureUploadInfo(double time, U64 nbBytes);
+    void getTextureUploadInfos(int* nbUploads, U64* nbBytes, double* timeSpent) const;
+
     void setTilesSupported(bool tilesSupported);
     bool isTilesSupportEnabled() const;
 
@@ -136,6 +155,32 @@ public:
                               bool isCacheMiss,
                               bool hasDownscaled);
 
+    /**
+     * @brief Records an access to the cache of the polygons evaluated from the roto shapes rendered by the node.
+     **/
+    void addRotoPolygonCacheInfosForNode(const NodePtr& node,
+                                         bool isCacheMiss);
+
+    /**
+     * @brief Records that an input image was copied to give it to the node in the format it expects,
+     * instead of the cached image of the input, or that the image rendered by the node was copied to
+     * return it in the format requested from it.
+     **/
+    void addInputImageCopyInfosForNode(const NodePtr& node,
+                                       U64 nbBytesCopied);
+
+    /**
+     * @brief Records for the given viewer node that the first tile of the frame is ready to be displayed.
+     **/
+    void setFirstTileLatencyForNode(const NodePtr& node);
+
+    /**
+     * @brief Records for the given viewer node an upload of the textures of the frame to the GPU.
+     **/
+    void addTextureUploadInfosForNode(const NodePtr& node,
+                                      double timeSpent,
+                                      U64 nbBytes);
+
     void addRenderInfosForNode(const NodePtr& node,
                                const NodePtr& identity,
                                const std::string& plane,
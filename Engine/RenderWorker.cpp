@@ -0,0 +1,178 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RenderWorker.h"
+
+#include <stdexcept>
+#include <string>
+
+#include "Engine/AppInstance.h"
+#include "Engine/AppManager.h"
+#include "Engine/CLArgs.h"
+#include "Engine/Project.h"
+
+NATRON_NAMESPACE_ENTER
+
+RenderWorker::RenderWorker(std::istream& input,
+                           std::ostream& output)
+    : _input(input)
+    , _output(output)
+{
+}
+
+RenderWorker::~RenderWorker()
+{
+}
+
+QStringList
+RenderWorker::splitCommandLine(const QString& line)
+{
+    QStringList ret;
+    QString current;
+    bool inQuotes = false;
+    bool hasArg = false;
+
+    for (int i = 0; i < line.size(); ++i) {
+        QChar c = line[i];
+        if ( c == QLatin1Char('"') ) {
+            inQuotes = !inQuotes;
+            // "" is an empty argument
+            hasArg = true;
+        } else if ( !inQuotes && c.isSpace() ) {
+            if (hasArg) {
+                ret.push_back(current);
+                current.clear();
+                hasArg = false;
+            }
+        } else {
+            current.push_back(c);
+            hasArg = true;
+        }
+    }
+    if (hasArg) {
+        ret.push_back(current);
+    }
+
+    return ret;
+}
+
+int
+RenderWorker::run()
+{
+    int nFailed = 0;
+    int jobIndex = 0;
+    std::string line;
+
+    while ( std::getline(_input, line) ) {
+        QString job = QString::fromUtf8( line.c_str() ).trimmed();
+        if ( job.isEmpty() || job.startsWith( QLatin1Char('#') ) ) {
+            continue;
+        }
+        if ( job == QString::fromUtf8("quit") ) {
+            break;
+        }
+
+        ++jobIndex;
+        _output << kRenderWorkerJobStartedString << ' ' << jobIndex << std::endl;
+
+        QString error;
+        bool ok = false;
+        try {
+            ok = runJob(splitCommandLine(job), &error);
+        } catch (const std::exception& e) {
+            error = QString::fromUtf8( e.what() );
+        }
+
+        if (ok) {
+            _output << kRenderWorkerJobFinishedString << ' ' << jobIndex << std::endl;
+        } else {
+            ++nFailed;
+            // The message must fit on 1 line
+            error.replace( QLatin1Char('\n'), QLatin1Char(' ') );
+            _output << kRenderWorkerJobFailedString << ' ' << jobIndex << ' ' << error.toStdString() << std::endl;
+        }
+    }
+
+    return nFailed;
+} // RenderWorker::run
+
+bool
+RenderWorker::runJob(const QStringList& arguments,
+                     QString* error)
+{
+    QStringList args = arguments;
+
+    // CLArgs expects the program name first
+    args.push_front( QCoreApplication::applicationFilePath() );
+
+    CLArgs cl(args, true);
+    if (cl.getError() > 0) {
+        *error = tr("Invalid arguments.");
+
+        return false;
+    }
+    if ( cl.isInterpreterMode() ) {
+        *error = tr("The interpreter mode cannot be used by a render job.");
+
+        return false;
+    }
+    if ( cl.getScriptFilename().isEmpty() ) {
+        *error = tr("No project or Python script file was given.");
+
+        return false;
+    }
+
+    // Each job gets its own instance. Plug-ins and caches belong to the AppManager and outlive it.
+    // The renders are blocking: they are finished when the instance is returned.
+    // If the project or script could not be loaded, the instance is already removed.
+    AppInstancePtr app = appPTR->newBackgroundInstance(cl, false);
+    if (!app) {
+        *error = tr("The project or script could not be loaded, see the log above.");
+
+        return false;
+    }
+    bool renderFailed = app->hasBlockingRenderFailed();
+
+    // Closing the project does not remove its images from the cache, the next jobs may use them
+    try {
+        app->getProject()->reset(true /*aboutToQuit*/, true /*blocking*/);
+    } catch (std::logic_error&) {
+        // ignore
+    }
+    try {
+        app->quitNow();
+    } catch (std::logic_error&) {
+        // ignore
+    }
+
+    if (renderFailed) {
+        *error = tr("The render failed, see the log above.");
+
+        return false;
+    }
+
+    return true;
+} // RenderWorker::runJob
+
+NATRON_NAMESPACE_EXIT
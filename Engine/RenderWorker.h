@@ -0,0 +1,92 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_RENDERWORKER_H
+#define NATRON_ENGINE_RENDERWORKER_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <istream>
+#include <ostream>
+
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QCoreApplication>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+CLANG_DIAG_ON(deprecated)
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A long-lived background process which renders jobs read from its input, one per line.
+ * Plug-ins, Python and the caches are initialized once for all jobs, and the image cache is kept
+ * warm between jobs: jobs rendering the same project with different Write nodes or frame ranges
+ * reuse the images computed by the previous ones.
+ *
+ * Each line holds the options and the project (or Python script) file path of one render, with the
+ * same syntax as the command-line of NatronRenderer, e.g:
+ *     -w Write1 1-10 "/path/to/my project.ntp"
+ * Empty lines and lines starting with # are ignored, the worker exits on "quit" or at the end of the input.
+ *
+ * Like the messages exchanged between ProcessHandler and ProcessInputChannel, each message written
+ * to the output is exactly 1 line: kRenderWorkerJobStartedString, then kRenderWorkerJobFinishedString or
+ * kRenderWorkerJobFailedString followed by the job number (starting at 1). The render log of the job
+ * is printed in-between.
+ **/
+class RenderWorker
+{
+    Q_DECLARE_TR_FUNCTIONS(RenderWorker)
+
+public:
+
+    RenderWorker(std::istream& input,
+                 std::ostream& output);
+
+    ~RenderWorker();
+
+    /**
+     * @brief Reads and renders jobs until the end of the input.
+     * @returns The number of jobs that failed.
+     **/
+    int run();
+
+    /**
+     * @brief Splits a line in arguments separated by spaces. Double quotes may be used to
+     * pass an argument containing spaces, they are removed.
+     **/
+    static QStringList splitCommandLine(const QString& line);
+
+private:
+
+    bool runJob(const QStringList& arguments, QString* error);
+
+    std::istream& _input;
+    std::ostream& _output;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_RENDERWORKER_H
@@ -46,6 +46,9 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 //#define ROTO_RENDER_TRIANGLES_ONLY
 
+// Render closed Beziers with cairo instead of RotoShapeRasterizer
+//#define ROTO_RENDER_BEZIER_WITH_CAIRO
+
 #include "libtess.h"
 
 #include "Engine/RotoContextPrivate.h"
@@ -67,6 +70,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/RotoContextSerialization.h"
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/RotoLayer.h"
+#include "Engine/RotoShapeRasterizer.h"
 #include "Engine/RotoStrokeItem.h"
 #include "Engine/Settings.h"
 #include "Engine/TimeLine.h"
@@ -96,11 +100,6 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 //This will enable correct evaluation of beziers
 //#define ROTO_USE_MESH_PATTERN_ONLY
 
-// The number of pressure levels is 256 on an old Wacom Graphire 4, and 512 on an entry-level Wacom Bamboo
-// 512 should be OK, see:
-// http://www.davidrevoy.com/article182/calibrating-wacom-stylus-pressure-on-krita
-#define ROTO_PRESSURE_LEVELS 512
-
 #ifndef M_PI
 #define M_PI        3.14159265358979323846264338327950288   /* pi             */
 #endif
@@ -1401,6 +1400,11 @@ RotoContext::deselectInternal(RotoItemPtr b)
         }
     }
 
+    if (isStroke) {
+        ///The stroke is no longer being edited, its dots no longer need to be kept
+        isStroke->releaseStrokeAccumulation();
+    }
+
 
     ///if the selected beziers count reaches 0 notify the gui knobs so they appear not enabled
 
@@ -2700,6 +2704,208 @@ RotoStrokeItem::renderSingleStroke(const RectD& pointsBbox,
     return distToNext;
 } // RotoStrokeItem::renderSingleStroke
 
+static bool
+strokePointsEqual(const std::pair<Point, double>& p1,
+                  const std::pair<Point, double>& p2)
+{
+    return p1.first.x == p2.first.x && p1.first.y == p2.first.y && p1.second == p2.second;
+}
+
+/**
+ * @brief Resizes the accumulation buffer to the given bounds, keeping the dots already rendered.
+ **/
+static bool
+resizeStrokeAccumulation(RotoStrokeAccumulation* acc,
+                         const RectI& bounds)
+{
+    cairo_format_t format = cairo_image_surface_get_format(acc->surface);
+    cairo_surface_t* surface = cairo_image_surface_create( format, bounds.width(), bounds.height() );
+
+    if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+        cairo_surface_destroy(surface);
+
+        return false;
+    }
+    cairo_surface_set_device_offset(surface, -bounds.x1, -bounds.y1);
+
+    RectI inter;
+    if ( bounds.intersect(acc->bounds, &inter) ) {
+        int pixelSize = (format == CAIRO_FORMAT_A8) ? 1 : 4;
+        cairo_surface_flush(acc->surface);
+        cairo_surface_flush(surface);
+        const unsigned char* srcData = cairo_image_surface_get_data(acc->surface);
+        int srcStride = cairo_image_surface_get_stride(acc->surface);
+        unsigned char* dstData = cairo_image_surface_get_data(surface);
+        int dstStride = cairo_image_surface_get_stride(surface);
+        for (int y = inter.y1; y < inter.y2; ++y) {
+            const unsigned char* srcPix = srcData + (y - acc->bounds.y1) * srcStride + (inter.x1 - acc->bounds.x1) * pixelSize;
+            unsigned char* dstPix = dstData + (y - bounds.y1) * dstStride + (inter.x1 - bounds.x1) * pixelSize;
+            std::memcpy( dstPix, srcPix, inter.width() * pixelSize );
+        }
+        cairo_surface_mark_dirty(surface);
+    }
+    cairo_surface_destroy(acc->surface);
+    acc->surface = surface;
+    acc->bounds = bounds;
+
+    return true;
+}
+
+bool
+RotoContextPrivate::accumulateStrokeDots(RotoStrokeAccumulation* acc,
+                                         cairo_format_t format,
+                                         const RectI& bounds,
+                                         const std::vector<std::vector<std::pair<Point, double> > >& points,
+                                         unsigned int mipmapLevel,
+                                         const RotoStrokeDotParams& params)
+{
+    if ( acc->surface && ( (cairo_image_surface_get_format(acc->surface) != format) || (acc->mipmapLevel != mipmapLevel) || !(acc->params == params) ) ) {
+        // All the dots changed
+        acc->reset();
+    }
+    if ( acc->surface && (acc->bounds != bounds) && !resizeStrokeAccumulation(acc, bounds) ) {
+        acc->reset();
+    }
+
+    // The position from which the stroke must be rendered
+    int strokeIndex = 0;
+    int pointIndex = 0;
+    double distToNext = 0.;
+    if (!acc->surface) {
+        acc->surface = cairo_image_surface_create( format, bounds.width(), bounds.height() );
+        if (cairo_surface_status(acc->surface) != CAIRO_STATUS_SUCCESS) {
+            acc->reset();
+
+            return false;
+        }
+        cairo_surface_set_device_offset(acc->surface, -bounds.x1, -bounds.y1);
+        acc->bounds = bounds;
+        acc->mipmapLevel = mipmapLevel;
+        acc->params = params;
+    } else {
+        // Find the first point which changed since the previous render
+        std::size_t nCommonStrokes = std::min( acc->points.size(), points.size() );
+        std::size_t s = 0;
+        while ( s < nCommonStrokes && acc->points[s].size() == points[s].size() &&
+                std::equal(points[s].begin(), points[s].end(), acc->points[s].begin(), strokePointsEqual) ) {
+            ++s;
+        }
+        std::size_t i = 0;
+        if ( (s < nCommonStrokes) && (acc->points[s].size() > 1) ) {
+            std::size_t n = std::min( acc->points[s].size(), points[s].size() );
+            while ( i < n && strokePointsEqual(acc->points[s][i], points[s][i]) ) {
+                ++i;
+            }
+        }
+        // else a single point is rendered as a dot which is not a dot of the segments of the stroke
+
+        if ( s == acc->points.size() ) {
+            // New multi-strokes were appended
+            strokeIndex = (int)s;
+            distToNext = acc->distToNext;
+        } else if ( (s + 1 == acc->points.size()) && (i == acc->points[s].size()) ) {
+            // Points were appended to the last multi-stroke, e.g: the end of the write-on range moved forward
+            strokeIndex = (int)s;
+            pointIndex = (int)i - 1;
+            distToNext = acc->distToNext;
+        } else {
+            // Some dots must be removed, e.g: points were edited or the write-on range shrank:
+            // replay the visible portion of the stroke
+            cairo_surface_flush(acc->surface);
+            std::memset( cairo_image_surface_get_data(acc->surface), 0, cairo_image_surface_get_stride(acc->surface) * cairo_image_surface_get_height(acc->surface) );
+            cairo_surface_mark_dirty(acc->surface);
+        }
+    }
+
+    if ( strokeIndex < (int)points.size() ) {
+        cairo_t* cr = cairo_create(acc->surface);
+        cairo_set_fill_rule(cr, CAIRO_FILL_RULE_WINDING);
+        cairo_set_antialias(cr, CAIRO_ANTIALIAS_NONE);
+        cairo_set_operator(cr, params.doBuildUp ? CAIRO_OPERATOR_OVER : CAIRO_OPERATOR_LIGHTEN);
+
+        std::vector<cairo_pattern_t*> dotPatterns( ROTO_PRESSURE_LEVELS, (cairo_pattern_t*)0 );
+        for (; strokeIndex < (int)points.size(); ++strokeIndex, pointIndex = 0) {
+            const std::vector<std::pair<Point, double> >& strokePoints = points[strokeIndex];
+            if (strokePoints.size() == 1) {
+                distToNext = renderStrokeDots(cr, dotPatterns, strokePoints, 0, 1, distToNext, params);
+            } else if ( pointIndex + 1 < (int)strokePoints.size() ) {
+                distToNext = renderStrokeDots(cr, dotPatterns, strokePoints, pointIndex, strokePoints.size(), distToNext, params);
+            }
+        }
+
+        for (std::size_t i = 0; i < dotPatterns.size(); ++i) {
+            if (dotPatterns[i]) {
+                cairo_pattern_destroy(dotPatterns[i]);
+                dotPatterns[i] = 0;
+            }
+        }
+        cairo_destroy(cr);
+    }
+    acc->points = points;
+    acc->distToNext = distToNext;
+
+    ///A call to cairo_surface_flush() is required before accessing the pixel data
+    ///to ensure that all pending drawing operations are finished.
+    cairo_surface_flush(acc->surface);
+
+    return true;
+} // RotoContextPrivate::accumulateStrokeDots
+
+bool
+RotoStrokeItem::renderStrokeIncrementally(const RectI& roi,
+                                          int srcNComps,
+                                          const std::list<std::list<std::pair<Point, double> > >& strokes,
+                                          bool doBuildUp,
+                                          double opacity,
+                                          double time,
+                                          unsigned int mipmapLevel,
+                                          double shapeColor[3],
+                                          bool inverted,
+                                          const ImagePtr& image)
+{
+    RotoStrokeDotParams params;
+
+    if ( strokes.empty() || !RotoContextPrivate::getStrokeDotParams(this, doBuildUp, opacity, time, mipmapLevel, &params) ) {
+        return false;
+    }
+
+    std::vector<std::vector<std::pair<Point, double> > > points;
+    for (std::list<std::list<std::pair<Point, double> > >::const_iterator it = strokes.begin(); it != strokes.end(); ++it) {
+        points.resize(points.size() + 1);
+        RotoContextPrivate::getStrokeVisiblePortion(*it, params, &points.back());
+        if ( points.back().empty() ) {
+            points.pop_back();
+            break;
+        }
+    }
+
+    cairo_format_t format = (srcNComps == 1) ? CAIRO_FORMAT_A8 : CAIRO_FORMAT_ARGB32;
+    QMutexLocker k(&_imp->accumulationMutex);
+    RotoStrokeAccumulation& acc = _imp->accumulation;
+
+    if ( !RotoContextPrivate::accumulateStrokeDots(&acc, format, roi, points, mipmapLevel, params) ) {
+        return false;
+    }
+
+    switch ( image->getBitDepth() ) {
+    case eImageBitDepthFloat:
+        convertCairoImageToNatronImage_noColor<float, 1>(acc.surface, srcNComps, image.get(), roi, shapeColor, opacity, inverted, false);
+        break;
+    case eImageBitDepthByte:
+        convertCairoImageToNatronImage_noColor<unsigned char, 255>(acc.surface, srcNComps, image.get(), roi, shapeColor, opacity, inverted, false);
+        break;
+    case eImageBitDepthShort:
+        convertCairoImageToNatronImage_noColor<unsigned short, 65535>(acc.surface, srcNComps, image.get(), roi, shapeColor, opacity, inverted, false);
+        break;
+    case eImageBitDepthHalf:
+    case eImageBitDepthNone:
+        assert(false);
+        break;
+    }
+
+    return true;
+} // RotoStrokeItem::renderStrokeIncrementally
+
 ImagePtr
 RotoDrawableItem::renderMaskFromStroke(const ImagePlaneDesc& components,
                                        const double time,
@@ -2885,6 +3091,22 @@ RotoDrawableItem::renderMaskInternal(const RectI & roi,
 
     double opacity = getOpacity(time);
 
+    if ( isStroke && isStroke->renderStrokeIncrementally(roi, srcNComps, strokes, doBuildUp, opacity, time, mipmapLevel, shapeColor, inverted, image) ) {
+        // The dots are accumulated in a buffer kept by the stroke, and only the dots which changed were rendered
+        return image;
+    }
+
+#ifndef ROTO_RENDER_BEZIER_WITH_CAIRO
+    if ( isBezier && !isBezier->isOpenBezier() ) {
+        // Closed shapes are scan-converted directly into the image, without a cairo intermediate buffer
+        RotoShapeRasterizer rasterizer(isBezier, time, startTime, endTime, timeStep, mipmapLevel);
+        ParallelRenderArgsPtr frameArgs = node->getEffectInstance()->getParallelRenderArgsTLS();
+        rasterizer.renderToImage(roi, shapeColor, opacity, inverted, image.get(), frameArgs ? frameArgs->getRenderPriority() : eRenderPriorityInteractive);
+
+        return image;
+    }
+#endif
+
     ////Allocate the cairo temporary buffer
     CairoImageWrapper imgWrapper;
 
@@ -3068,122 +3290,162 @@ getRenderDotParams(double alpha,
     }
 }
 
-double
-RotoContextPrivate::renderStroke(cairo_t* cr,
-                                 std::vector<cairo_pattern_t*>& dotPatterns,
-                                 const std::list<std::list<std::pair<Point, double> > >& strokes,
-                                 double distToNext,
-                                 const RotoDrawableItem* stroke,
-                                 bool doBuildup,
-                                 double alpha,
-                                 double time,
-                                 unsigned int mipmapLevel)
+bool
+RotoContextPrivate::getStrokeDotParams(const RotoDrawableItem* stroke,
+                                       bool doBuildup,
+                                       double opacity,
+                                       double time,
+                                       unsigned int mipmapLevel,
+                                       RotoStrokeDotParams* params)
 {
-    if ( strokes.empty() ) {
-        return distToNext;
-    }
-
     if ( !stroke || !stroke->isActivated(time) ) {
-        return distToNext;
+        return false;
     }
 
-    assert(dotPatterns.size() == ROTO_PRESSURE_LEVELS);
-
     KnobDoublePtr brushSizeKnob = stroke->getBrushSizeKnob();
     double brushSize = brushSizeKnob->getValueAtTime(time);
     KnobDoublePtr brushSpacingKnob = stroke->getBrushSpacingKnob();
     double brushSpacing = brushSpacingKnob->getValueAtTime(time);
     if (brushSpacing == 0.) {
-        return distToNext;
+        return false;
     }
 
 
-    brushSpacing = std::max(brushSpacing, 0.05);
+    params->brushSpacing = std::max(brushSpacing, 0.05);
 
     KnobDoublePtr brushHardnessKnob = stroke->getBrushHardnessKnob();
-    double brushHardness = brushHardnessKnob->getValueAtTime(time);
+    params->brushHardness = brushHardnessKnob->getValueAtTime(time);
     KnobDoublePtr visiblePortionKnob = stroke->getBrushVisiblePortionKnob();
-    double writeOnStart = visiblePortionKnob->getValueAtTime(time, 0);
-    double writeOnEnd = visiblePortionKnob->getValueAtTime(time, 1);
-    if ( (writeOnEnd - writeOnStart) <= 0. ) {
-        return distToNext;
+    params->writeOnStart = visiblePortionKnob->getValueAtTime(time, 0);
+    params->writeOnEnd = visiblePortionKnob->getValueAtTime(time, 1);
+    if ( (params->writeOnEnd - params->writeOnStart) <= 0. ) {
+        return false;
     }
 
     KnobBoolPtr pressureOpacityKnob = stroke->getPressureOpacityKnob();
     KnobBoolPtr pressureSizeKnob = stroke->getPressureSizeKnob();
     KnobBoolPtr pressureHardnessKnob = stroke->getPressureHardnessKnob();
-    bool pressureAffectsOpacity = pressureOpacityKnob->getValueAtTime(time);
-    bool pressureAffectsSize = pressureSizeKnob->getValueAtTime(time);
-    bool pressureAffectsHardness = pressureHardnessKnob->getValueAtTime(time);
-    double brushSizePixel = brushSize;
+    params->pressureAffectsOpacity = pressureOpacityKnob->getValueAtTime(time);
+    params->pressureAffectsSize = pressureSizeKnob->getValueAtTime(time);
+    params->pressureAffectsHardness = pressureHardnessKnob->getValueAtTime(time);
+    params->brushSizePixel = brushSize;
     if (mipmapLevel != 0) {
-        brushSizePixel = std::max( 1., brushSizePixel / (1 << mipmapLevel) );
+        params->brushSizePixel = std::max( 1., params->brushSizePixel / (1 << mipmapLevel) );
     }
-    cairo_set_operator(cr, doBuildup ? CAIRO_OPERATOR_OVER : CAIRO_OPERATOR_LIGHTEN);
+    params->doBuildUp = doBuildup;
+    params->opacity = opacity;
 
+    return true;
+} // RotoContextPrivate::getStrokeDotParams
 
-    for (std::list<std::list<std::pair<Point, double> > >::const_iterator strokeIt = strokes.begin(); strokeIt != strokes.end(); ++strokeIt) {
-        int firstPoint = (int)std::floor( (strokeIt->size() * writeOnStart) );
-        int endPoint = (int)std::ceil( (strokeIt->size() * writeOnEnd) );
-        assert( firstPoint >= 0 && firstPoint < (int)strokeIt->size() && endPoint > firstPoint && endPoint <= (int)strokeIt->size() );
-
-
-        ///The visible portion of the paint's stroke with points adjusted to pixel coordinates
-        std::list<std::pair<Point, double> > visiblePortion;
-        std::list<std::pair<Point, double> >::const_iterator startingIt = strokeIt->begin();
-        std::list<std::pair<Point, double> >::const_iterator endingIt = strokeIt->begin();
-        std::advance(startingIt, firstPoint);
-        std::advance(endingIt, endPoint);
-        for (std::list<std::pair<Point, double> >::const_iterator it = startingIt; it != endingIt; ++it) {
-            visiblePortion.push_back(*it);
-        }
-        if ( visiblePortion.empty() ) {
-            return distToNext;
-        }
+void
+RotoContextPrivate::getStrokeVisiblePortion(const std::list<std::pair<Point, double> >& stroke,
+                                            const RotoStrokeDotParams& params,
+                                            std::vector<std::pair<Point, double> >* visiblePortion)
+{
+    visiblePortion->clear();
+    if ( stroke.empty() ) {
+        return;
+    }
+    int firstPoint = (int)std::floor( (stroke.size() * params.writeOnStart) );
+    int endPoint = (int)std::ceil( (stroke.size() * params.writeOnEnd) );
+    assert( firstPoint >= 0 && firstPoint < (int)stroke.size() && endPoint > firstPoint && endPoint <= (int)stroke.size() );
+
+    ///The visible portion of the paint's stroke with points adjusted to pixel coordinates
+    std::list<std::pair<Point, double> >::const_iterator startingIt = stroke.begin();
+    std::list<std::pair<Point, double> >::const_iterator endingIt = stroke.begin();
+    std::advance(startingIt, firstPoint);
+    std::advance(endingIt, endPoint);
+    visiblePortion->assign(startingIt, endingIt);
+}
+
+double
+RotoContextPrivate::renderStrokeDots(cairo_t* cr,
+                                     std::vector<cairo_pattern_t*>& dotPatterns,
+                                     const std::vector<std::pair<Point, double> >& points,
+                                     std::size_t first,
+                                     std::size_t last,
+                                     double distToNext,
+                                     const RotoStrokeDotParams& params)
+{
+    assert(first < last && last <= points.size());
+    assert(dotPatterns.size() == ROTO_PRESSURE_LEVELS);
+
+    if (last - first == 1) {
+        const std::pair<Point, double>& p = points[first];
+        double internalDotRadius, externalDotRadius, spacing;
+        std::vector<std::pair<double, double> > opacityStops;
+        getRenderDotParams(params.opacity, params.brushSizePixel, params.brushHardness, params.brushSpacing, p.second, params.pressureAffectsOpacity, params.pressureAffectsSize, params.pressureAffectsHardness, &internalDotRadius, &externalDotRadius, &spacing, &opacityStops);
+        renderDot(cr, &dotPatterns, p.first, internalDotRadius, externalDotRadius, p.second, params.doBuildUp, opacityStops, params.opacity);
+
+        return distToNext;
+    }
+
+    for (std::size_t i = first; i + 1 < last; ++i) {
+        const std::pair<Point, double>& it = points[i];
+        const std::pair<Point, double>& next = points[i + 1];
+
+        //Render for each point a dot. Spacing is a percentage of brushSize:
+        //Spacing at 1 means no dot is overlapping another (so the spacing is in fact brushSize)
+        //Spacing at 0 we do not render the stroke
+
+        double dist = std::sqrt( (next.first.x - it.first.x) * (next.first.x - it.first.x) +  (next.first.y - it.first.y) * (next.first.y - it.first.y) );
 
-        std::list<std::pair<Point, double> >::iterator it = visiblePortion.begin();
+        // while the next point can be drawn on this segment, draw a point and advance
+        while (distToNext <= dist) {
+            double a = dist == 0. ? 0. : distToNext / dist;
+            Point center = {
+                it.first.x * (1 - a) + next.first.x * a,
+                it.first.y * (1 - a) + next.first.y * a
+            };
+            double pressure = it.second * (1 - a) + next.second * a;
 
-        if (visiblePortion.size() == 1) {
+            // draw the dot
             double internalDotRadius, externalDotRadius, spacing;
             std::vector<std::pair<double, double> > opacityStops;
-            getRenderDotParams(alpha, brushSizePixel, brushHardness, brushSpacing, it->second, pressureAffectsOpacity, pressureAffectsSize, pressureAffectsHardness, &internalDotRadius, &externalDotRadius, &spacing, &opacityStops);
-            renderDot(cr, &dotPatterns, it->first, internalDotRadius, externalDotRadius, it->second, doBuildup, opacityStops, alpha);
-            continue;
+            getRenderDotParams(params.opacity, params.brushSizePixel, params.brushHardness, params.brushSpacing, pressure, params.pressureAffectsOpacity, params.pressureAffectsSize, params.pressureAffectsHardness, &internalDotRadius, &externalDotRadius, &spacing, &opacityStops);
+            renderDot(cr, &dotPatterns, center, internalDotRadius, externalDotRadius, pressure, params.doBuildUp, opacityStops, params.opacity);
+
+            distToNext += spacing;
         }
 
-        std::list<std::pair<Point, double> >::iterator next = it;
-        ++next;
+        // go to the next segment
+        distToNext -= dist;
+    }
 
-        while ( next != visiblePortion.end() ) {
-            //Render for each point a dot. Spacing is a percentage of brushSize:
-            //Spacing at 1 means no dot is overlapping another (so the spacing is in fact brushSize)
-            //Spacing at 0 we do not render the stroke
-
-            double dist = std::sqrt( (next->first.x - it->first.x) * (next->first.x - it->first.x) +  (next->first.y - it->first.y) * (next->first.y - it->first.y) );
-
-            // while the next point can be drawn on this segment, draw a point and advance
-            while (distToNext <= dist) {
-                double a = dist == 0. ? 0. : distToNext / dist;
-                Point center = {
-                    it->first.x * (1 - a) + next->first.x * a,
-                    it->first.y * (1 - a) + next->first.y * a
-                };
-                double pressure = it->second * (1 - a) + next->second * a;
-
-                // draw the dot
-                double internalDotRadius, externalDotRadius, spacing;
-                std::vector<std::pair<double, double> > opacityStops;
-                getRenderDotParams(alpha, brushSizePixel, brushHardness, brushSpacing, pressure, pressureAffectsOpacity, pressureAffectsSize, pressureAffectsHardness, &internalDotRadius, &externalDotRadius, &spacing, &opacityStops);
-                renderDot(cr, &dotPatterns, center, internalDotRadius, externalDotRadius, pressure, doBuildup, opacityStops, alpha);
-
-                distToNext += spacing;
-            }
+    return distToNext;
+} // RotoContextPrivate::renderStrokeDots
 
-            // go to the next segment
-            distToNext -= dist;
-            ++next;
-            ++it;
+double
+RotoContextPrivate::renderStroke(cairo_t* cr,
+                                 std::vector<cairo_pattern_t*>& dotPatterns,
+                                 const std::list<std::list<std::pair<Point, double> > >& strokes,
+                                 double distToNext,
+                                 const RotoDrawableItem* stroke,
+                                 bool doBuildup,
+                                 double alpha,
+                                 double time,
+                                 unsigned int mipmapLevel)
+{
+    if ( strokes.empty() ) {
+        return distToNext;
+    }
+
+    RotoStrokeDotParams params;
+    if ( !getStrokeDotParams(stroke, doBuildup, alpha, time, mipmapLevel, &params) ) {
+        return distToNext;
+    }
+
+    cairo_set_operator(cr, doBuildup ? CAIRO_OPERATOR_OVER : CAIRO_OPERATOR_LIGHTEN);
+
+
+    std::vector<std::pair<Point, double> > visiblePortion;
+    for (std::list<std::list<std::pair<Point, double> > >::const_iterator strokeIt = strokes.begin(); strokeIt != strokes.end(); ++strokeIt) {
+        getStrokeVisiblePortion(*strokeIt, params, &visiblePortion);
+        if ( visiblePortion.empty() ) {
+            return distToNext;
         }
+        distToNext = renderStrokeDots(cr, dotPatterns, visiblePortion, 0, visiblePortion.size(), distToNext, params);
     }
 
 
@@ -3299,19 +3561,13 @@ RotoContextPrivate::renderBezier(cairo_t* cr,
 } // RotoContextPrivate::renderBezier
 
 void
-RotoContextPrivate::renderFeather(const Bezier* bezier,
-                                  double time,
-                                  unsigned int mipmapLevel,
-                                  double shapeColor[3],
-                                  double /*opacity*/,
-                                  double featherDist,
-                                  double fallOff,
-                                  cairo_pattern_t* mesh)
+RotoContextPrivate::computeFeatherPatches(const Bezier* bezier,
+                                          double time,
+                                          unsigned int mipmapLevel,
+                                          double featherDist,
+                                          std::vector<RotoFeatherPatch>* patches,
+                                          std::vector<Point>* innerPolygon)
 {
-    ///Note that we do not use the opacity when rendering the bezier, it is rendered with correct floating point opacity/color when converting
-    ///to the Natron image.
-
-    double fallOffInverse = 1. / fallOff;
     /*
      * We descretize the feather control points to obtain a polygon so that the feather distance will be of the same thickness around all the shape.
      * If we were to extend only the end points, the resulting bezier interpolation would create a feather with different thickness around the shape,
@@ -3345,8 +3601,15 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
 
     assert( !featherPolygon.empty() && !bezierPolygon.empty() );
 
-
-    std::list<Point> featherContour;
+    if (innerPolygon) {
+        innerPolygon->reserve( innerPolygon->size() + bezierPolygon.size() );
+        for (std::list<ParametricPoint>::const_iterator it = bezierPolygon.begin(); it != bezierPolygon.end(); ++it) {
+            Point p;
+            p.x = it->x;
+            p.y = it->y;
+            innerPolygon->push_back(p);
+        }
+    }
 
     // prepare iterators
     std::list<ParametricPoint>::iterator next = featherPolygon.begin();
@@ -3378,13 +3641,7 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
         p1.y += dy * absFeatherDist;
     }
 
-
-    double innerOpacity = 1.;
-    double outterOpacity = 0.;
-
     Point origin = p1;
-    featherContour.push_back(p1);
-
 
     // increment for first iteration
     std::list<ParametricPoint>::iterator cur = featherPolygon.begin();
@@ -3411,6 +3668,7 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
         ++prevBez;
     }
 
+    patches->reserve( patches->size() + featherPolygon.size() );
     for (;; ++cur) { // for each point in polygon
         if ( next == featherPolygon.end() ) {
             next = featherPolygon.begin();
@@ -3435,11 +3693,12 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
             continue;
         }*/
 
-        Point p0, p0p1, p1p0, p2, p2p3, p3p2, p3;
-        p0.x = prevBez->x;
-        p0.y = prevBez->y;
-        p3.x = bezIT->x;
-        p3.y = bezIT->y;
+        RotoFeatherPatch patch;
+        patch.p0.x = prevBez->x;
+        patch.p0.y = prevBez->y;
+        patch.p1 = p1;
+        patch.p3.x = bezIT->x;
+        patch.p3.y = bezIT->y;
 
         if (!mustStop) {
             norm = sqrt( (next->x - prev->x) * (next->x - prev->x) + (next->y - prev->y) * (next->y - prev->y) );
@@ -3450,21 +3709,72 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
                 dx = -( (next->y - prev->y) / norm );
                 dy = ( (next->x - prev->x) / norm );
             }
-            p2.x = cur->x;
-            p2.y = cur->y;
+            patch.p2.x = cur->x;
+            patch.p2.y = cur->y;
 
             if (!clockWise) {
-                p2.x -= dx * absFeatherDist;
-                p2.y -= dy * absFeatherDist;
+                patch.p2.x -= dx * absFeatherDist;
+                patch.p2.y -= dy * absFeatherDist;
             } else {
-                p2.x += dx * absFeatherDist;
-                p2.y += dy * absFeatherDist;
+                patch.p2.x += dx * absFeatherDist;
+                patch.p2.y += dy * absFeatherDist;
             }
         } else {
-            p2.x = origin.x;
-            p2.y = origin.y;
+            patch.p2.x = origin.x;
+            patch.p2.y = origin.y;
         }
-        featherContour.push_back(p2);
+        patches->push_back(patch);
+
+        if (mustStop) {
+            break;
+        }
+
+        p1 = patch.p2;
+
+        // increment for next iteration
+        // ++prev, ++next, ++bezIT, ++prevBez
+        if ( prev != featherPolygon.end() ) {
+            ++prev;
+        }
+        if ( next != featherPolygon.end() ) {
+            ++next;
+        }
+        if ( bezIT != bezierPolygon.end() ) {
+            ++bezIT;
+        }
+        if ( prevBez != bezierPolygon.end() ) {
+            ++prevBez;
+        }
+    }  // for each point in polygon
+} // RotoContextPrivate::computeFeatherPatches
+
+void
+RotoContextPrivate::renderFeather(const Bezier* bezier,
+                                  double time,
+                                  unsigned int mipmapLevel,
+                                  double shapeColor[3],
+                                  double /*opacity*/,
+                                  double featherDist,
+                                  double fallOff,
+                                  cairo_pattern_t* mesh)
+{
+    ///Note that we do not use the opacity when rendering the bezier, it is rendered with correct floating point opacity/color when converting
+    ///to the Natron image.
+
+    double fallOffInverse = 1. / fallOff;
+    std::vector<RotoFeatherPatch> patches;
+
+    computeFeatherPatches(bezier, time, mipmapLevel, featherDist, &patches, NULL);
+
+    double innerOpacity = 1.;
+    double outterOpacity = 0.;
+
+    for (std::vector<RotoFeatherPatch>::const_iterator it = patches.begin(); it != patches.end(); ++it) {
+        const Point& p0 = it->p0;
+        const Point& p1 = it->p1;
+        const Point& p2 = it->p2;
+        const Point& p3 = it->p3;
+        Point p0p1, p1p0, p2p3, p3p2;
 
         ///linear interpolation
         p0p1.x = (p0.x * fallOff * 2. + fallOffInverse * p1.x) / (fallOff * 2. + fallOffInverse);
@@ -3506,30 +3816,7 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
         assert(cairo_pattern_status(mesh) == CAIRO_STATUS_SUCCESS);
 
         cairo_mesh_pattern_end_patch(mesh);
-
-        if (mustStop) {
-            break;
-        }
-
-        //std::swap(innerOpacity, outterOpacity);
-
-        p1 = p2;
-
-        // increment for next iteration
-        // ++prev, ++next, ++bezIT, ++prevBez
-        if ( prev != featherPolygon.end() ) {
-            ++prev;
-        }
-        if ( next != featherPolygon.end() ) {
-            ++next;
-        }
-        if ( bezIT != bezierPolygon.end() ) {
-            ++bezIT;
-        }
-        if ( prevBez != bezierPolygon.end() ) {
-            ++prevBez;
-        }
-    }  // for each point in polygon
+    }
 } // RotoContextPrivate::renderFeather
 
 void
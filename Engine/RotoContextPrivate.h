@@ -56,6 +56,7 @@ CLANG_DIAG_ON(uninitialized)
 #include "Global/GlobalDefines.h"
 
 #include "Engine/AppManager.h"
+#include "Engine/Bezier.h"
 #include "Engine/BezierCP.h"
 #include "Engine/Curve.h"
 #include "Engine/EffectInstance.h"
@@ -63,6 +64,8 @@ CLANG_DIAG_ON(uninitialized)
 #include "Engine/KnobTypes.h"
 #include "Engine/MergingEnum.h"
 #include "Engine/Node.h"
+#include "Engine/RectD.h"
+#include "Engine/RectI.h"
 #include "Engine/RotoContext.h"
 #include "Engine/RotoPaint.h"
 #include "Engine/Transform.h"
@@ -76,6 +79,11 @@ CLANG_DIAG_ON(uninitialized)
 #define ROTO_DEFAULT_COLOR_G 1.
 #define ROTO_DEFAULT_COLOR_B 1.
 
+// The number of pressure levels is 256 on an old Wacom Graphire 4, and 512 on an entry-level Wacom Bamboo
+// 512 should be OK, see:
+// http://www.davidrevoy.com/article182/calibrating-wacom-stylus-pressure-on-krita
+#define ROTO_PRESSURE_LEVELS 512
+
 
 #define kRotoScriptNameHint "Script-name of the item for Python scripts. It cannot be edited."
 
@@ -381,6 +389,15 @@ struct RotoFeatherVertex
     bool isInner;
 };
 
+/**
+ * @brief A quad of the feather: p0 and p3 are on the shape (fully opaque), p1 and p2 on the feather (transparent).
+ * p0-p1 and p3-p2 are the falloff edges.
+ **/
+struct RotoFeatherPatch
+{
+    Point p0, p1, p2, p3;
+};
+
 struct RotoTriangleStrips
 {
     std::list<Point> vertices;
@@ -396,6 +413,50 @@ struct RotoTriangles
     std::list<Point> vertices;
 };
 
+/**
+ * @brief The parameters of a polygon evaluated by Bezier::evaluateAtTime_DeCasteljau or
+ * Bezier::evaluateFeatherPointsAtTime_DeCasteljau
+ **/
+struct BezierPolygonKey
+{
+    bool isFeather;
+    bool useGuiCurves;
+    bool evaluateIfEqual;
+    unsigned int mipmapLevel;
+    double time;
+    double precision; //< the number of points per segment or the error scale
+
+    bool operator<(const BezierPolygonKey& other) const
+    {
+        if (time != other.time) {
+            return time < other.time;
+        }
+        if (mipmapLevel != other.mipmapLevel) {
+            return mipmapLevel < other.mipmapLevel;
+        }
+        if (precision != other.precision) {
+            return precision < other.precision;
+        }
+        if (isFeather != other.isFeather) {
+            return isFeather < other.isFeather;
+        }
+        if (useGuiCurves != other.useGuiCurves) {
+            return useGuiCurves < other.useGuiCurves;
+        }
+
+        return evaluateIfEqual < other.evaluateIfEqual;
+    }
+};
+
+struct BezierPolygon
+{
+    std::list<std::list<ParametricPoint> > points; //< one list per segment
+    RectD bbox;
+    Transform::Matrix3x3 transform; //< the transform of the item when the polygon was evaluated
+};
+
+typedef boost::shared_ptr<const BezierPolygon> BezierPolygonPtr;
+
 struct BezierPrivate
 {
     BezierCPs points; //< the control points of the curve
@@ -413,6 +474,13 @@ struct BezierPrivate
     mutable QMutex guiCopyMutex;
     bool mustCopyGui;
 
+    // The polygons evaluated at a given time and mipmap level are shared by all the renders of the shape and its overlay.
+    // They are valid as long as the age of the item is polygonCacheAge.
+    mutable QMutex polygonCacheMutex;
+    mutable std::map<BezierPolygonKey, BezierPolygonPtr> polygonCache;
+    mutable U64 polygonCacheAge;
+    mutable int polygonCacheMisses, polygonCacheHits;
+
     BezierPrivate(bool isOpenBezier)
         : points()
         , featherPoints()
@@ -425,6 +493,11 @@ struct BezierPrivate
         , isOpenBezier(isOpenBezier)
         , guiCopyMutex()
         , mustCopyGui(false)
+        , polygonCacheMutex()
+        , polygonCache()
+        , polygonCacheAge(0)
+        , polygonCacheMisses(0)
+        , polygonCacheHits(0)
     {
     }
 
@@ -785,6 +858,10 @@ public:
     //Used to prevent 2 threads from writing the same image in the rotocontext
     mutable QReadWriteLock cacheAccessMutex;
 
+    // Incremented whenever a knob or a point of the item changes
+    mutable QMutex ageMutex;
+    U64 age;
+
     RotoDrawableItemPrivate(bool isPaintingNode)
         : effectNode()
         , mergeNode()
@@ -833,6 +910,8 @@ public:
         , timeOffsetMode()
         , knobs()
         , cacheAccessMutex()
+        , ageMutex()
+        , age(0)
     {
         opacity = boost::make_shared<KnobDouble>((KnobHolder*)NULL, tr(kRotoOpacityParamLabel), 1, true);
         opacity->setHintToolTip( tr(kRotoOpacityHint) );
@@ -1267,6 +1346,82 @@ public:
     }
 };
 
+/**
+ * @brief The parameters of the dots of a paint stroke, at a given time and mipmap level.
+ * The write-on range only selects the points which are rendered, so it is not part of the comparison.
+ **/
+struct RotoStrokeDotParams
+{
+    double brushSizePixel;
+    double brushSpacing;
+    double brushHardness;
+    double writeOnStart, writeOnEnd;
+    bool pressureAffectsOpacity;
+    bool pressureAffectsSize;
+    bool pressureAffectsHardness;
+    bool doBuildUp;
+    double opacity;
+
+    bool operator==(const RotoStrokeDotParams& other) const
+    {
+        return brushSizePixel == other.brushSizePixel &&
+               brushSpacing == other.brushSpacing &&
+               brushHardness == other.brushHardness &&
+               pressureAffectsOpacity == other.pressureAffectsOpacity &&
+               pressureAffectsSize == other.pressureAffectsSize &&
+               pressureAffectsHardness == other.pressureAffectsHardness &&
+               doBuildUp == other.doBuildUp &&
+               opacity == other.opacity;
+    }
+};
+
+/**
+ * @brief The buffer in which the dots of a paint stroke are accumulated across renders: a render only draws
+ * the dots of the points which were appended since the previous render, otherwise the stroke is replayed.
+ * Only the buffer of the last render is kept, and it is released when the stroke is deselected.
+ **/
+class RotoStrokeAccumulation
+{
+public:
+
+    cairo_surface_t* surface;
+    RectI bounds; //< the pixel bounds of surface
+    unsigned int mipmapLevel;
+    RotoStrokeDotParams params;
+    std::vector<std::vector<std::pair<Point, double> > > points; //< the visible portion of each multi-stroke rendered in surface
+    double distToNext; //< the distance to the next dot after the last point
+
+    RotoStrokeAccumulation()
+        : surface(0)
+        , bounds()
+        , mipmapLevel(0)
+        , params()
+        , points()
+        , distToNext(0.)
+    {
+    }
+
+    ~RotoStrokeAccumulation()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        if (surface) {
+            cairo_surface_destroy(surface);
+            surface = 0;
+        }
+        points.clear();
+        distToNext = 0.;
+    }
+
+private:
+
+    RotoStrokeAccumulation(const RotoStrokeAccumulation&);
+    RotoStrokeAccumulation& operator=(const RotoStrokeAccumulation&);
+};
+
 struct RotoStrokeItemPrivate
 {
     RotoStrokeType type;
@@ -1286,6 +1441,8 @@ struct RotoStrokeItemPrivate
     RectD wholeStrokeBboxWhilePainting;
     mutable QMutex strokeDotPatternsMutex;
     std::vector<cairo_pattern_t*> strokeDotPatterns;
+    QMutex accumulationMutex;
+    RotoStrokeAccumulation accumulation;
 
     RotoStrokeItemPrivate(RotoStrokeType type)
         : type(type)
@@ -1297,6 +1454,8 @@ struct RotoStrokeItemPrivate
         , wholeStrokeBboxWhilePainting()
         , strokeDotPatternsMutex()
         , strokeDotPatterns()
+        , accumulationMutex()
+        , accumulation()
     {
         bbox.x1 = std::numeric_limits<double>::infinity();
         bbox.x2 = -std::numeric_limits<double>::infinity();
@@ -2218,6 +2377,42 @@ public:
                           bool doBuildUp,
                           const std::vector<std::pair<double, double> >& opacityStops,
                           double opacity);
+    /**
+     * @brief Returns false if the given stroke renders nothing at the given time.
+     **/
+    static bool getStrokeDotParams(const RotoDrawableItem* stroke,
+                                   bool doBuildup,
+                                   double opacity,
+                                   double time,
+                                   unsigned int mipmapLevel,
+                                   RotoStrokeDotParams* params);
+    static void getStrokeVisiblePortion(const std::list<std::pair<Point, double> >& stroke,
+                                        const RotoStrokeDotParams& params,
+                                        std::vector<std::pair<Point, double> >* visiblePortion);
+
+    /**
+     * @brief Renders the dots of the points in [first, last), or a single dot if there is only one point.
+     * @returns The distance to the next dot after the last point
+     **/
+    static double renderStrokeDots(cairo_t* cr,
+                                   std::vector<cairo_pattern_t*>& dotPatterns,
+                                   const std::vector<std::pair<Point, double> >& points,
+                                   std::size_t first,
+                                   std::size_t last,
+                                   double distToNext,
+                                   const RotoStrokeDotParams& params);
+    /**
+     * @brief Renders the given visible portions of the multi-strokes of a paint stroke in the accumulation buffer acc,
+     * which is resized to bounds. bounds must contain all the dots of points, e.g: the bounding box of the stroke.
+     * Only the dots which were not rendered by the previous call are drawn.
+     * @returns False if the buffer could not be allocated, in which case acc is reset.
+     **/
+    static bool accumulateStrokeDots(RotoStrokeAccumulation* acc,
+                                     cairo_format_t format,
+                                     const RectI& bounds,
+                                     const std::vector<std::vector<std::pair<Point, double> > >& points,
+                                     unsigned int mipmapLevel,
+                                     const RotoStrokeDotParams& params);
     static double renderStroke(cairo_t* cr,
                                std::vector<cairo_pattern_t*>& dotPatterns,
                                const std::list<std::list<std::pair<Point, double> > >& strokes,
@@ -2228,6 +2423,7 @@ public:
                                double time,
                                unsigned int mipmapLevel);
     static void renderBezier(cairo_t* cr, const Bezier* bezier, double opacity, double time, double startTime, double endTime, double mbFrameStep, unsigned int mipmapLevel);
+    static void computeFeatherPatches(const Bezier * bezier, double time, unsigned int mipmapLevel, double featherDist, std::vector<RotoFeatherPatch>* patches, std::vector<Point>* innerPolygon);
     static void renderFeather(const Bezier * bezier, double time, unsigned int mipmapLevel, double shapeColor[3], double opacity, double featherDist, double fallOff, cairo_pattern_t * mesh);
     static void renderFeather_cairo(const std::list<RotoFeatherVertex>& vertices, double shapeColor[3],  double fallOff, cairo_pattern_t * mesh);
     static void renderInternalShape_cairo(const std::list<RotoTriangles>& triangles,
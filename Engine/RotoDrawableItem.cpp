@@ -89,11 +89,6 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 //This will enable correct evaluation of beziers
 //#define ROTO_USE_MESH_PATTERN_ONLY
 
-// The number of pressure levels is 256 on an old Wacom Graphire 4, and 512 on an entry-level Wacom Bamboo
-// 512 should be OK, see:
-// http://www.davidrevoy.com/article182/calibrating-wacom-stylus-pressure-on-krita
-#define ROTO_PRESSURE_LEVELS 512
-
 
 NATRON_NAMESPACE_ENTER
 
@@ -657,6 +652,7 @@ RotoDrawableItem::rotoKnobChanged(const KnobIPtr& knob,
 void
 RotoDrawableItem::incrementNodesAge()
 {
+    incrementAge();
     if ( getContext()->getNode()->getApp()->getProject()->isLoadingProject() ) {
         return;
     }
@@ -674,6 +670,22 @@ RotoDrawableItem::incrementNodesAge()
     }
 }
 
+U64
+RotoDrawableItem::getAge() const
+{
+    QMutexLocker k(&_imp->ageMutex);
+
+    return _imp->age;
+}
+
+void
+RotoDrawableItem::incrementAge()
+{
+    QMutexLocker k(&_imp->ageMutex);
+
+    ++_imp->age;
+}
+
 NodePtr
 RotoDrawableItem::getEffectNode() const
 {
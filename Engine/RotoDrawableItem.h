@@ -84,6 +84,14 @@ public:
 
     void incrementNodesAge();
 
+    /**
+     * @brief Returns the age of the item, which is incremented whenever one of its knobs or its points change.
+     * This is used to invalidate the geometry cached by the item.
+     **/
+    U64 getAge() const;
+
+    void incrementAge();
+
     void refreshNodesConnections();
 
     virtual void clone(const RotoItem*  other) OVERRIDE;
@@ -0,0 +1,514 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RotoShapeRasterizer.h"
+
+#include <algorithm> // min, max, sort
+#include <cassert>
+#include <cmath>
+
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+// /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
+#include <boost/bind.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+
+
+#include "Engine/AppManager.h"
+#include "Engine/Bezier.h"
+#include "Engine/Image.h"
+#include "Engine/RotoContextPrivate.h"
+#include "Engine/TaskScheduler.h"
+
+// Number of entries of the feather falloff lookup table
+#define ROTO_RASTERIZER_FALLOFF_LUT_SIZE 1024
+
+NATRON_NAMESPACE_ENTER
+
+namespace {
+
+/**
+ * @brief The falloff edges of a feather patch are cubic Bezier curves whose control points lie on the segment
+ * from the shape (0) to the feather (1), see RotoContextPrivate::renderFeather. Their position along this segment
+ * as a function of the curve parameter u, which interpolates the opacity linearly, is this polynomial.
+ **/
+inline double
+falloffPosition(double u,
+                double c1,
+                double c2)
+{
+    double v = 1. - u;
+
+    return 3. * u * v * v * c1 + 3. * u * u * v * c2 + u * u * u;
+}
+
+inline double
+cross(double ax,
+      double ay,
+      double bx,
+      double by)
+{
+    return ax * by - ay * bx;
+}
+
+/**
+ * @brief Finds (s,v) in [0,1]x[0,1] such that (x,y) is the bilinear interpolation of the 4 points of the patch,
+ * p0 being at (0,0), p1 at (1,0), p2 at (1,1) and p3 at (0,1).
+ * @returns False if the point is not inside the patch.
+ **/
+bool
+invertBilinear(const double px[4],
+               const double py[4],
+               double x,
+               double y,
+               double* s,
+               double* v)
+{
+    const double ex = px[1] - px[0], ey = py[1] - py[0];
+    const double fx = px[3] - px[0], fy = py[3] - py[0];
+    const double gx = px[0] - px[1] + px[2] - px[3], gy = py[0] - py[1] + py[2] - py[3];
+    const double hx = x - px[0], hy = y - py[0];
+    const double k2 = cross(gx, gy, fx, fy);
+    const double k1 = cross(ex, ey, fx, fy) + cross(hx, hy, gx, gy);
+    const double k0 = cross(hx, hy, ex, ey);
+    double roots[2];
+    int nRoots = 0;
+
+    if (k2 == 0.) {
+        if (k1 != 0.) {
+            roots[nRoots++] = -k0 / k1;
+        }
+    } else {
+        double delta = k1 * k1 - 4. * k0 * k2;
+        if (delta < 0.) {
+            return false;
+        }
+        delta = std::sqrt(delta);
+        // numerically stable roots, which also work when the patch is close to a parallelogram (k2 ~ 0)
+        double q = -0.5 * ( k1 + (k1 >= 0. ? delta : -delta) );
+        if (q != 0.) {
+            roots[nRoots++] = k0 / q;
+            roots[nRoots++] = q / k2;
+        } else {
+            roots[nRoots++] = 0.;
+        }
+    }
+
+    const double eps = 1e-9;
+    for (int i = 0; i < nRoots; ++i) {
+        double rv = roots[i];
+        if ( (rv < -eps) || (rv > 1. + eps) ) {
+            continue;
+        }
+        double denX = ex + gx * rv;
+        double denY = ey + gy * rv;
+        double rs;
+        if (std::abs(denX) >= std::abs(denY)) {
+            if (denX == 0.) {
+                continue;
+            }
+            rs = (hx - fx * rv) / denX;
+        } else {
+            rs = (hy - fy * rv) / denY;
+        }
+        if ( (rs < -eps) || (rs > 1. + eps) ) {
+            continue;
+        }
+        *s = std::max( 0., std::min(1., rs) );
+        *v = std::max( 0., std::min(1., rv) );
+
+        return true;
+    }
+
+    return false;
+} // invertBilinear
+
+struct EdgeCrossing
+{
+    double x;
+    int winding;
+
+    bool operator<(const EdgeCrossing& other) const
+    {
+        return x < other.x;
+    }
+};
+
+/**
+ * @brief Writes the given coverage into the image, like convertCairoImageToNatronImage_noColor in RotoContext.cpp
+ **/
+template <typename PIX, int maxValue, int dstNComps>
+void
+writeTileForComponents(const float* coverage,
+                       const RectI & tile,
+                       const double shapeColor[3],
+                       double opacity,
+                       bool inverted,
+                       Image::WriteAccess* acc)
+{
+    const float r = shapeColor[0] * opacity;
+    const float g = shapeColor[1] * opacity;
+    const float b = shapeColor[2] * opacity;
+    const int width = tile.width();
+
+    for (int y = tile.y1; y < tile.y2; ++y, coverage += width) {
+        PIX* dstPix = (PIX*)acc->pixelAt(tile.x1, y);
+        assert(dstPix);
+
+        for (int x = 0; x < width; ++x, dstPix += dstNComps) {
+            float a = !inverted ? coverage[x] * maxValue : (1.f - coverage[x]) * maxValue;
+            switch (dstNComps) {
+            case 4:
+                dstPix[0] = PIX(a * r);
+                dstPix[1] = PIX(a * g);
+                dstPix[2] = PIX(a * b);
+                dstPix[3] = PIX(a * opacity);
+                break;
+            case 1:
+                dstPix[0] = PIX(a * opacity);
+                break;
+            case 3:
+                dstPix[0] = PIX(a * r);
+                dstPix[1] = PIX(a * g);
+                dstPix[2] = PIX(a * b);
+                break;
+            case 2:
+                dstPix[0] = PIX(a * r);
+                dstPix[1] = PIX(a * g);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
+template <typename PIX, int maxValue>
+void
+writeTileForDepth(const float* coverage,
+                  const RectI & tile,
+                  const double shapeColor[3],
+                  double opacity,
+                  bool inverted,
+                  int nComps,
+                  Image::WriteAccess* acc)
+{
+    switch (nComps) {
+    case 1:
+        writeTileForComponents<PIX, maxValue, 1>(coverage, tile, shapeColor, opacity, inverted, acc);
+        break;
+    case 2:
+        writeTileForComponents<PIX, maxValue, 2>(coverage, tile, shapeColor, opacity, inverted, acc);
+        break;
+    case 3:
+        writeTileForComponents<PIX, maxValue, 3>(coverage, tile, shapeColor, opacity, inverted, acc);
+        break;
+    case 4:
+        writeTileForComponents<PIX, maxValue, 4>(coverage, tile, shapeColor, opacity, inverted, acc);
+        break;
+    default:
+        break;
+    }
+}
+
+void
+renderTileToImage(const RotoShapeRasterizer* rasterizer,
+                  const double* shapeColor,
+                  double opacity,
+                  bool inverted,
+                  ImageBitDepthEnum depth,
+                  int nComps,
+                  Image::WriteAccess* acc,
+                  const RectI & tile)
+{
+    std::vector<float> coverage( (std::size_t)tile.width() * tile.height() );
+
+    rasterizer->renderAlpha(tile, &coverage.front());
+
+    switch (depth) {
+    case eImageBitDepthFloat:
+        writeTileForDepth<float, 1>(&coverage.front(), tile, shapeColor, opacity, inverted, nComps, acc);
+        break;
+    case eImageBitDepthByte:
+        writeTileForDepth<unsigned char, 255>(&coverage.front(), tile, shapeColor, opacity, inverted, nComps, acc);
+        break;
+    case eImageBitDepthShort:
+        writeTileForDepth<unsigned short, 65535>(&coverage.front(), tile, shapeColor, opacity, inverted, nComps, acc);
+        break;
+    case eImageBitDepthHalf:
+    case eImageBitDepthNone:
+        assert(false);
+        break;
+    }
+}
+} // anon namespace
+
+RotoShapeRasterizer::RotoShapeRasterizer(const Bezier* bezier,
+                                         double time,
+                                         double startTime,
+                                         double endTime,
+                                         double mbFrameStep,
+                                         unsigned int mipmapLevel)
+    : _samples()
+{
+    ///render the bezier only if finished (closed) and activated
+    if ( !bezier->isCurveFinished() || !bezier->isActivated(time) || ( bezier->getControlPointsCount() <= 1 ) ) {
+        return;
+    }
+
+    for (double t = startTime; t <= endTime; t += mbFrameStep) {
+        addSample(bezier, t, mipmapLevel);
+    }
+}
+
+RotoShapeRasterizer::~RotoShapeRasterizer()
+{
+}
+
+void
+RotoShapeRasterizer::addSample(const Bezier* bezier,
+                               double time,
+                               unsigned int mipmapLevel)
+{
+    double fallOff = bezier->getFeatherFallOff(time);
+    double featherDist = bezier->getFeatherDistance(time);
+
+    ///Adjust the feather distance so it takes the mipmap level into account
+    if (mipmapLevel != 0) {
+        featherDist /= (1 << mipmapLevel);
+    }
+
+    std::vector<RotoFeatherPatch> featherPatches;
+    std::vector<Point> polygon;
+    RotoContextPrivate::computeFeatherPatches(bezier, time, mipmapLevel, featherDist, &featherPatches, &polygon);
+
+    _samples.push_back( Sample() );
+    Sample& sample = _samples.back();
+
+    // The edges of the shape, horizontal edges do not cross any scan-line
+    sample.edges.reserve( polygon.size() );
+    for (std::size_t i = 0; i < polygon.size(); ++i) {
+        const Point& a = polygon[i];
+        const Point& b = polygon[(i + 1) % polygon.size()];
+        if (a.y == b.y) {
+            continue;
+        }
+        Edge e;
+        e.winding = (a.y < b.y) ? 1 : -1;
+        const Point& bottom = (a.y < b.y) ? a : b;
+        const Point& top = (a.y < b.y) ? b : a;
+        e.x0 = bottom.x;
+        e.y0 = bottom.y;
+        e.y1 = top.y;
+        e.dxdy = (top.x - bottom.x) / (top.y - bottom.y);
+        sample.edges.push_back(e);
+    }
+
+    sample.patches.resize( featherPatches.size() );
+    for (std::size_t i = 0; i < featherPatches.size(); ++i) {
+        const RotoFeatherPatch& fp = featherPatches[i];
+        Patch& p = sample.patches[i];
+        p.x[0] = fp.p0.x; p.y[0] = fp.p0.y;
+        p.x[1] = fp.p1.x; p.y[1] = fp.p1.y;
+        p.x[2] = fp.p2.x; p.y[2] = fp.p2.y;
+        p.x[3] = fp.p3.x; p.y[3] = fp.p3.y;
+        p.xMin = std::min( std::min(p.x[0], p.x[1]), std::min(p.x[2], p.x[3]) );
+        p.xMax = std::max( std::max(p.x[0], p.x[1]), std::max(p.x[2], p.x[3]) );
+        p.yMin = std::min( std::min(p.y[0], p.y[1]), std::min(p.y[2], p.y[3]) );
+        p.yMax = std::max( std::max(p.y[0], p.y[1]), std::max(p.y[2], p.y[3]) );
+    }
+
+    // Tabulate the opacity as a function of the position across the feather by inverting falloffPosition.
+    // The cairo renderer paints the feather mesh pattern masked by itself (see RotoContextPrivate::applyAndDestroyMask),
+    // so the opacity is squared to give the same result.
+    const double c1 = 1. / (2. * fallOff * fallOff + 1.);
+    const double c2 = 2. / (fallOff * fallOff + 2.);
+    sample.falloff.resize(ROTO_RASTERIZER_FALLOFF_LUT_SIZE);
+    for (int i = 0; i < ROTO_RASTERIZER_FALLOFF_LUT_SIZE; ++i) {
+        double pos = i / (double)(ROTO_RASTERIZER_FALLOFF_LUT_SIZE - 1);
+        // falloffPosition is increasing on [0,1]
+        double lo = 0., hi = 1.;
+        for (int it = 0; it < 40; ++it) {
+            double mid = (lo + hi) / 2.;
+            if (falloffPosition(mid, c1, c2) < pos) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        double opacity = 1. - (lo + hi) / 2.;
+        sample.falloff[i] = (float)(opacity * opacity);
+    }
+} // RotoShapeRasterizer::addSample
+
+void
+RotoShapeRasterizer::renderAlpha(const RectI & rect,
+                                 float* buffer) const
+{
+    const std::size_t nPixels = (std::size_t)rect.width() * rect.height();
+
+    std::fill(buffer, buffer + nPixels, 0.f);
+    if ( _samples.empty() || (nPixels == 0) ) {
+        return;
+    }
+
+    std::vector<float> feather(nPixels);
+    for (std::vector<Sample>::const_iterator it = _samples.begin(); it != _samples.end(); ++it) {
+        renderSample(*it, rect, buffer, &feather.front());
+    }
+}
+
+void
+RotoShapeRasterizer::renderSample(const Sample & sample,
+                                  const RectI & rect,
+                                  float* buffer,
+                                  float* feather) const
+{
+    const int width = rect.width();
+    const double yMin = rect.y1 + 0.5;
+    const double yMax = rect.y2 - 0.5;
+
+    // Fill the inside of the shape: only the edges crossing the rectangle are considered
+    std::vector<const Edge*> edges;
+    for (std::vector<Edge>::const_iterator it = sample.edges.begin(); it != sample.edges.end(); ++it) {
+        if ( (it->y1 > yMin) && (it->y0 <= yMax) ) {
+            edges.push_back(&*it);
+        }
+    }
+
+    std::vector<EdgeCrossing> crossings;
+    for (int y = rect.y1; y < rect.y2; ++y) {
+        const double yc = y + 0.5;
+        crossings.clear();
+        for (std::vector<const Edge*>::const_iterator it = edges.begin(); it != edges.end(); ++it) {
+            const Edge& e = **it;
+            if ( (e.y0 <= yc) && (yc < e.y1) ) {
+                EdgeCrossing c;
+                c.x = e.x0 + (yc - e.y0) * e.dxdy;
+                c.winding = e.winding;
+                crossings.push_back(c);
+            }
+        }
+        if ( crossings.empty() ) {
+            continue;
+        }
+        std::sort( crossings.begin(), crossings.end() );
+
+        float* row = buffer + (std::size_t)(y - rect.y1) * width;
+        int winding = 0;
+        for (std::size_t i = 0; i + 1 < crossings.size(); ++i) {
+            winding += crossings[i].winding;
+            if (winding == 0) {
+                continue;
+            }
+            // the pixels whose center is in [x_i, x_i+1)
+            int x1 = std::max( rect.x1, (int)std::ceil(crossings[i].x - 0.5) );
+            int x2 = std::min( rect.x2, (int)std::ceil(crossings[i + 1].x - 0.5) );
+            for (int x = x1; x < x2; ++x) {
+                row[x - rect.x1] = 1.f;
+            }
+        }
+    }
+
+    // Shade the feather. As for cairo mesh patterns, a patch overwrites the previous ones where they overlap.
+    const std::size_t nPixels = (std::size_t)width * rect.height();
+    std::fill(feather, feather + nPixels, -1.f);
+    const int lutMax = (int)sample.falloff.size() - 1;
+    bool hasFeather = false;
+    for (std::vector<Patch>::const_iterator it = sample.patches.begin(); it != sample.patches.end(); ++it) {
+        int x1 = std::max( rect.x1, (int)std::ceil(it->xMin - 0.5) );
+        int x2 = std::min( rect.x2, (int)std::floor(it->xMax - 0.5) + 1 );
+        int y1 = std::max( rect.y1, (int)std::ceil(it->yMin - 0.5) );
+        int y2 = std::min( rect.y2, (int)std::floor(it->yMax - 0.5) + 1 );
+        for (int y = y1; y < y2; ++y) {
+            float* row = feather + (std::size_t)(y - rect.y1) * width - rect.x1;
+            for (int x = x1; x < x2; ++x) {
+                double s, v;
+                if ( !invertBilinear(it->x, it->y, x + 0.5, y + 0.5, &s, &v) ) {
+                    continue;
+                }
+                double lutPos = s * lutMax;
+                int i = std::min( (int)lutPos, lutMax - 1 );
+                double frac = lutPos - i;
+                row[x] = (float)( sample.falloff[i] * (1. - frac) + sample.falloff[i + 1] * frac );
+                hasFeather = true;
+            }
+        }
+    }
+
+    // Composite the feather over the shape
+    if (hasFeather) {
+        for (std::size_t i = 0; i < nPixels; ++i) {
+            if (feather[i] >= 0.f) {
+                buffer[i] = feather[i] + buffer[i] * (1.f - feather[i]);
+            }
+        }
+    }
+} // RotoShapeRasterizer::renderSample
+
+void
+RotoShapeRasterizer::renderToImage(const RectI & roi,
+                                   const double shapeColor[3],
+                                   double opacity,
+                                   bool inverted,
+                                   Image* image,
+                                   RenderPriorityEnum priority) const
+{
+    RectI bounds;
+    if ( !roi.intersect(image->getBounds(), &bounds) ) {
+        return;
+    }
+
+    ImageBitDepthEnum depth = image->getBitDepth();
+    int nComps = (int)image->getComponentsCount();
+    // The tiles are written through a single write access, as the image is locked by the calling thread
+    Image::WriteAccess acc = image->getWriteRights();
+    std::vector<RectI> tiles = bounds.splitIntoSmallerRects( appPTR->getMaxThreadCount() );
+
+    if (tiles.size() <= 1) {
+        for (std::vector<RectI>::const_iterator it = tiles.begin(); it != tiles.end(); ++it) {
+            renderTileToImage(this, shapeColor, opacity, inverted, depth, nComps, &acc, *it);
+        }
+
+        return;
+    }
+
+    // This thread renders the tiles that are not picked up by the scheduler workers while it waits,
+    // so this does not dead-lock when all the workers are busy rendering
+    TaskGroup tilesGroup(appPTR->getTaskScheduler(), priority);
+    for (std::vector<RectI>::const_iterator it = tiles.begin(); it != tiles.end(); ++it) {
+        tilesGroup.run( boost::bind(&renderTileToImage,
+                                    this,
+                                    shapeColor,
+                                    opacity,
+                                    inverted,
+                                    depth,
+                                    nComps,
+                                    &acc,
+                                    boost::cref(*it) ) );
+    }
+    tilesGroup.wait();
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,111 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef NATRON_ENGINE_ROTOSHAPERASTERIZER_H
+#define NATRON_ENGINE_ROTOSHAPERASTERIZER_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <vector>
+
+#include "Global/Enums.h"
+
+#include "Engine/RectI.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Renders a closed Bezier without cairo: the polygon returned by Bezier::evaluateAtTime_DeCasteljau is
+ * scan-converted with the non-zero winding rule, and the feather quads (see RotoContextPrivate::computeFeatherPatches)
+ * are shaded with the exact falloff curve instead of cairo mesh patterns.
+ * The result matches RotoContextPrivate::renderBezier: the shape is rendered without antialiasing by sampling the
+ * pixel centers, and each motion-blur sample is composited over the previous ones.
+ *
+ * The geometry is evaluated once in the constructor, then any rectangle can be rendered concurrently.
+ **/
+class RotoShapeRasterizer
+{
+public:
+
+    RotoShapeRasterizer(const Bezier* bezier,
+                        double time,
+                        double startTime,
+                        double endTime,
+                        double mbFrameStep,
+                        unsigned int mipmapLevel);
+
+    ~RotoShapeRasterizer();
+
+    /**
+     * @brief Renders the coverage of the shape in the given rectangle (in pixel coordinates at the mipmap level) into
+     * buffer, which must hold rect.width() * rect.height() floats, the first row being rect.y1.
+     **/
+    void renderAlpha(const RectI & rect, float* buffer) const;
+
+    /**
+     * @brief Renders the shape with the given color and opacity into the roi of the image, splitting the roi
+     * in tiles rendered by the task scheduler with the given priority.
+     **/
+    void renderToImage(const RectI & roi,
+                       const double shapeColor[3],
+                       double opacity,
+                       bool inverted,
+                       Image* image,
+                       RenderPriorityEnum priority = eRenderPriorityInteractive) const;
+
+private:
+
+    struct Edge
+    {
+        double x0, y0, y1; // y0 < y1
+        double dxdy;
+        int winding; // 1 if the edge goes up in the polygon, -1 otherwise
+    };
+
+    struct Patch
+    {
+        double x[4], y[4]; // see RotoFeatherPatch
+        double xMin, xMax, yMin, yMax;
+    };
+
+    struct Sample
+    {
+        std::vector<Edge> edges;
+        std::vector<Patch> patches;
+        // opacity of the feather as a function of the distance from the shape, from 0 to 1
+        std::vector<float> falloff;
+    };
+
+    void addSample(const Bezier* bezier, double time, unsigned int mipmapLevel);
+
+    void renderSample(const Sample & sample, const RectI & rect, float* buffer, float* feather) const;
+
+    std::vector<Sample> _samples;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_ROTOSHAPERASTERIZER_H
@@ -83,11 +83,6 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 //This will enable correct evaluation of beziers
 //#define ROTO_USE_MESH_PATTERN_ONLY
 
-// The number of pressure levels is 256 on an old Wacom Graphire 4, and 512 on an entry-level Wacom Bamboo
-// 512 should be OK, see:
-// http://www.davidrevoy.com/article182/calibrating-wacom-stylus-pressure-on-krita
-#define ROTO_PRESSURE_LEVELS 512
-
 #ifndef M_PI
 #define M_PI        3.14159265358979323846264338327950288   /* pi             */
 #endif
@@ -320,6 +315,14 @@ RotoStrokeItem::setStrokeFinished()
     resetNodesThreadSafety();
 }
 
+void
+RotoStrokeItem::releaseStrokeAccumulation()
+{
+    QMutexLocker k(&_imp->accumulationMutex);
+
+    _imp->accumulation.reset();
+}
+
 bool
 RotoStrokeItem::appendPoint(bool newStroke,
                             const RotoPoint& p)
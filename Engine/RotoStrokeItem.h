@@ -105,6 +105,23 @@ public:
                               ImagePtr *wholeStrokeImage);
 
 
+    /**
+     * @brief Renders the given strokes into the buffer in which the dots of this item are accumulated across renders,
+     * then converts the part of the buffer covering roi to image. Only the dots of the points which were appended since
+     * the previous render are drawn. If some points changed, the visible portion of the stroke is replayed.
+     * @returns False if the stroke renders nothing at the given time, in which case the image is not written.
+     **/
+    bool renderStrokeIncrementally(const RectI& roi,
+                                   int srcNComps,
+                                   const std::list<std::list<std::pair<Point, double> > >& strokes,
+                                   bool doBuildUp,
+                                   double opacity,
+                                   double time,
+                                   unsigned int mipmapLevel,
+                                   double shapeColor[3],
+                                   bool inverted,
+                                   const ImagePtr& image);
+
     bool getMostRecentStrokeChangesSinceAge(double time,
                                             int lastAge,
                                             int lastMultiStrokeIndex,
@@ -118,6 +135,11 @@ public:
 
     void setStrokeFinished();
 
+    /**
+     * @brief Frees the buffer in which the dots of this item are accumulated, see renderStrokeIncrementally()
+     **/
+    void releaseStrokeAccumulation();
+
 
     virtual void clone(const RotoItem* other) OVERRIDE FINAL;
 
@@ -24,6 +24,7 @@
 
 #include "Settings.h"
 
+#include <algorithm> // max
 #include <cassert>
 #include <stdexcept>
 
@@ -53,6 +54,7 @@
 #include "Engine/Plugin.h"
 #include "Engine/Project.h"
 #include "Engine/StandardPaths.h"
+#include "Engine/TaskScheduler.h"
 #include "Engine/Utils.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/ViewerInstance.h"
@@ -192,6 +194,15 @@ Settings::initializeKnobsGeneral()
                                                  "Disabling this will no longer save un-saved project.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ) );
     _generalTab->addKnob(_autoSaveUnSavedProjects);
 
+    _saveProjectsInBinaryFormat = AppManager::createKnob<KnobBool>( this, tr("Save projects in binary format") );
+    _saveProjectsInBinaryFormat->setName("saveProjectsInBinaryFormat");
+    _saveProjectsInBinaryFormat->setHintToolTip( tr("When activated, projects and auto-saves are written in a compact binary format "
+                                                    "which is much faster to open and allows command-line renders to only load the nodes "
+                                                    "needed by the Write nodes being rendered. Binary projects may only be opened by the same "
+                                                    "version of %1 on the same kind of machine: disable this to exchange projects "
+                                                    "in the XML format.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ) );
+    _generalTab->addKnob(_saveProjectsInBinaryFormat);
+
 
     _hostName = AppManager::createKnob<KnobChoice>( this, tr("Appear to plug-ins as") );
     _hostName->setName("pluginHostName");
@@ -326,12 +337,59 @@ Settings::initializeKnobsThreading()
     _nThreadsPerEffect->disableSlider();
     _threadingPage->addKnob(_nThreadsPerEffect);
 
+    QString renderPriorityToolTip = tr("Tiles are rendered by a pool of threads, picking first the tiles of viewer renders of "
+                                       "the current frame and of tracking, then of viewer playback, then of node previews, "
+                                       "then of Write nodes.\n"
+                                       "This controls the maximum number of threads of the pool that may render the tiles of %1 "
+                                       "at the same time, leaving the others available to more urgent renders. "
+                                       "0 means no limit.");
+
+    _interactiveRenderThreads = AppManager::createKnob<KnobInt>( this, tr("Max. threads for viewer renders (0=\"no limit\")") );
+    _interactiveRenderThreads->setName("interactiveRenderThreads");
+    _interactiveRenderThreads->setHintToolTip( renderPriorityToolTip.arg( tr("viewer renders of the current frame and of tracking") ) );
+    _interactiveRenderThreads->setMinimum(0);
+    _interactiveRenderThreads->disableSlider();
+    _threadingPage->addKnob(_interactiveRenderThreads);
+
+    _playbackRenderThreads = AppManager::createKnob<KnobInt>( this, tr("Max. threads for playback (0=\"no limit\")") );
+    _playbackRenderThreads->setName("playbackRenderThreads");
+    _playbackRenderThreads->setHintToolTip( renderPriorityToolTip.arg( tr("viewer playback") ) );
+    _playbackRenderThreads->setMinimum(0);
+    _playbackRenderThreads->disableSlider();
+    _threadingPage->addKnob(_playbackRenderThreads);
+
+    _previewRenderThreads = AppManager::createKnob<KnobInt>( this, tr("Max. threads for previews (0=\"no limit\")") );
+    _previewRenderThreads->setName("previewRenderThreads");
+    _previewRenderThreads->setHintToolTip( renderPriorityToolTip.arg( tr("node previews") ) );
+    _previewRenderThreads->setMinimum(0);
+    _previewRenderThreads->disableSlider();
+    _threadingPage->addKnob(_previewRenderThreads);
+
+    _backgroundRenderThreads = AppManager::createKnob<KnobInt>( this, tr("Max. threads for Write nodes (0=\"no limit\")") );
+    _backgroundRenderThreads->setName("backgroundRenderThreads");
+    _backgroundRenderThreads->setHintToolTip( renderPriorityToolTip.arg( tr("Write nodes rendering in this process") ) );
+    _backgroundRenderThreads->setMinimum(0);
+    _backgroundRenderThreads->disableSlider();
+    _threadingPage->addKnob(_backgroundRenderThreads);
+
     _renderInSeparateProcess = AppManager::createKnob<KnobBool>( this, tr("Render in a separate process") );
     _renderInSeparateProcess->setName("renderNewProcess");
     _renderInSeparateProcess->setHintToolTip( tr("If true, %1 will render frames to disk in "
                                                  "a separate process so that if the main application crashes, the render goes on.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ) );
     _threadingPage->addKnob(_renderInSeparateProcess);
 
+    _numberOfRenderProcesses = AppManager::createKnob<KnobInt>( this, tr("Number of render processes") );
+    _numberOfRenderProcesses->setName("nRenderProcesses");
+    _numberOfRenderProcesses->setHintToolTip( tr("When rendering in a separate process, the frames of a sequence are split across "
+                                                 "this many processes, each of them rendering every N-th frame. "
+                                                 "Use this to use all the cores of the computer when the graph contains plug-ins "
+                                                 "that are not thread-safe. "
+                                                 "Frames which were not rendered by a process that failed or crashed are rendered again by a new process. "
+                                                 "Video files are always written by a single process.") );
+    _numberOfRenderProcesses->setMinimum(1);
+    _numberOfRenderProcesses->disableSlider();
+    _threadingPage->addKnob(_numberOfRenderProcesses);
+
     _queueRenders = AppManager::createKnob<KnobBool>( this, tr("Append new renders to queue") );
     _queueRenders->setHintToolTip( tr("When checked, renders will be queued in the Progress Panel and will start only when all "
                                       "other prior tasks are done.") );
@@ -1129,6 +1187,28 @@ Settings::initializeKnobsViewers()
                                     "This may have to be disabled when using a remote display connection "
                                     "to Linux from a different OS.") );
     _viewersTab->addKnob(_viewerKeys);
+
+    _viewerProgressiveRender = AppManager::createKnob<KnobBool>( this, tr("Display tiles progressively") );
+    _viewerProgressiveRender->setName("viewerProgressiveRender");
+    _viewerProgressiveRender->setHintToolTip( tr("When checked, the tiles of the image rendered by the viewer are displayed "
+                                                 "as soon as they are rendered, starting with the tiles under the mouse cursor "
+                                                 "(or in the center of the viewer if the cursor is outside), instead of "
+                                                 "waiting for the whole image to be rendered.\n"
+                                                 "This is only used when rendering a single frame, with 8-bit viewer textures.") );
+    _viewersTab->addKnob(_viewerProgressiveRender);
+
+    _viewerPrefetchFrames = AppManager::createKnob<KnobInt>( this, tr("Frames to prefetch") );
+    _viewerPrefetchFrames->setName("viewerPrefetchFrames");
+    _viewerPrefetchFrames->setMinimum(0);
+    _viewerPrefetchFrames->setMaximum(32);
+    _viewerPrefetchFrames->disableSlider();
+    _viewerPrefetchFrames->setHintToolTip( tr("The number of frames around the current frame that the viewer renders in advance "
+                                              "into the viewer cache, when some threads are idle, in the direction in which the "
+                                              "timeline was recently scrubbed (or on both sides if the current frame did not change). "
+                                              "These renders are aborted as soon as the viewer needs to render something else.\n"
+                                              "Frames outside of the timeline in and out points are never prefetched. "
+                                              "Set to 0 to disable prefetching.") );
+    _viewersTab->addKnob(_viewerPrefetchFrames);
 } // Settings::initializeKnobsViewers
 
 void
@@ -1266,6 +1346,41 @@ Settings::initializeKnobsCaching()
     _maxDiskCacheNodeGB->setHintToolTip( tr("The maximum size that may be used by the DiskCache node on disk (in GiB)") );
     _cachingTab->addKnob(_maxDiskCacheNodeGB);
 
+    _cacheShardsCount = AppManager::createKnob<KnobInt>( this, tr("Cache shards") );
+    _cacheShardsCount->setName("cacheShards");
+    _cacheShardsCount->disableSlider();
+    _cacheShardsCount->setMinimum(0);
+    _cacheShardsCount->setMaximum(NATRON_CACHE_MAX_SHARDS);
+    _cacheShardsCount->setHintToolTip( tr("WARNING: Changing this parameter requires a restart of the application. \n"
+                                          "Number of independent parts the node, DiskCache and playback caches are split into. "
+                                          "Each part has its own lock so that render threads accessing the caches do not wait on each other, "
+                                          "at the expense of evicting the least recently used images per part rather than globally. "
+                                          "The value is rounded to the next power of 2.\n"
+                                          "1: A single part, the least recently used image is always evicted first.\n"
+                                          "0: Guess the number of parts from the number of cores. The ideal threads count for this hardware is %1.").arg( QThread::idealThreadCount() ) );
+    _cachingTab->addKnob(_cacheShardsCount);
+
+    _cacheEvictionPolicy = AppManager::createKnob<KnobChoice>( this, tr("Cache eviction policy") );
+    _cacheEvictionPolicy->setName("cacheEvictionPolicy");
+    {
+        std::vector<ChoiceOption> policies;
+        policies.push_back(ChoiceOption("lru",
+                                        tr("LRU").toStdString(),
+                                        tr("The least recently used image is evicted first.").toStdString() ));
+        policies.push_back(ChoiceOption("slru",
+                                        tr("Segmented LRU").toStdString(),
+                                        tr("Images that were used only once since they were rendered (e.g. during a playback) "
+                                           "are evicted before images that were used several times.").toStdString() ));
+        policies.push_back(ChoiceOption("cost",
+                                        tr("Render cost").toStdString(),
+                                        tr("Among the least recently used images, the one that took the least time to render "
+                                           "is evicted first, so that images that are expensive to compute stay longer in the cache.").toStdString() ));
+        _cacheEvictionPolicy->populateChoices(policies);
+    }
+    _cacheEvictionPolicy->setHintToolTip( tr("Which image the node and DiskCache caches evict first when they are full. "
+                                             "Hover each option with the mouse for a detailed description.") );
+    _cachingTab->addKnob(_cacheEvictionPolicy);
+
 
     _diskCachePath = AppManager::createKnob<KnobPath>( this, tr("Disk cache path (empty = default)") );
     _diskCachePath->setName("diskCachePath");
@@ -1435,6 +1550,7 @@ Settings::setDefaultValues()
     _enableCrashReports->setDefaultValue(true);
 #endif
     _autoSaveUnSavedProjects->setDefaultValue(true);
+    _saveProjectsInBinaryFormat->setDefaultValue(false);
     _autoSaveDelay->setDefaultValue(5, 0);
     _hostName->setDefaultValue(0);
     _customHostName->setDefaultValue(NATRON_ORGANIZATION_DOMAIN_TOPLEVEL "." NATRON_ORGANIZATION_DOMAIN_SUB "." NATRON_APPLICATION_NAME);
@@ -1446,7 +1562,12 @@ Settings::setDefaultValues()
 #endif
     _useThreadPool->setDefaultValue(true);
     _nThreadsPerEffect->setDefaultValue(0);
+    _interactiveRenderThreads->setDefaultValue(0);
+    _playbackRenderThreads->setDefaultValue(0);
+    _previewRenderThreads->setDefaultValue(0);
+    _backgroundRenderThreads->setDefaultValue(0);
     _renderInSeparateProcess->setDefaultValue(false, 0);
+    _numberOfRenderProcesses->setDefaultValue(1);
     _queueRenders->setDefaultValue(false);
 
     // General/Rendering
@@ -1500,6 +1621,8 @@ Settings::setDefaultValues()
     _unreachableRAMPercent->setDefaultValue(5);
     _maxViewerDiskCacheGB->setDefaultValue(5, 0);
     _maxDiskCacheNodeGB->setDefaultValue(10, 0);
+    _cacheShardsCount->setDefaultValue(1);
+    _cacheEvictionPolicy->setDefaultValue( (int)eCacheEvictionPolicyLRU );
     //_diskCachePath
     setCachingLabels();
 
@@ -1520,6 +1643,8 @@ Settings::setDefaultValues()
     _autoProxyLevel->setDefaultValue(1);
     _maximumNodeViewerUIOpened->setDefaultValue(2);
     _viewerKeys->setDefaultValue(true);
+    _viewerProgressiveRender->setDefaultValue(false);
+    _viewerPrefetchFrames->setDefaultValue(4);
 
     // Nodegraph
     _autoScroll->setDefaultValue(false);
@@ -2119,6 +2244,7 @@ Settings::restoreSettings(bool useDefault)
 
         appPTR->setNThreadsPerEffect( getNumberOfThreadsPerEffect() );
         appPTR->setNThreadsToRender( getNumberOfThreads() );
+        applyRenderPriorityThreadQuotas();
         appPTR->setUseThreadPool( _useThreadPool->getValue() );
         appPTR->setPluginsUseInputImageCopyToRender( _pluginUseImageCopyForSource->getValue() );
     } catch (std::logic_error&) {
@@ -2252,6 +2378,10 @@ Settings::onKnobValueChanged(KnobI* k,
             appPTR->setApplicationsCachesMaximumMemoryPercent( getRamMaximumPercent() );
         }
         setCachingLabels();
+    } else if ( k == _cacheEvictionPolicy.get() ) {
+        if (!_restoringSettings) {
+            appPTR->setApplicationsCachesEvictionPolicy( getCacheEvictionPolicy() );
+        }
     } else if ( k == _diskCachePath.get() ) {
         QString path = QString::fromUtf8(_diskCachePath->getValue().c_str());
         qputenv(NATRON_DISK_CACHE_PATH_ENV_VAR, path.toUtf8());
@@ -2269,8 +2399,15 @@ Settings::onKnobValueChanged(KnobI* k,
         } else {
             QThreadPool::globalInstance()->setMaxThreadCount(nbThreads);
         }
+        TaskScheduler* scheduler = appPTR->getTaskScheduler();
+        if (scheduler) {
+            scheduler->setMaxThreadCount( QThreadPool::globalInstance()->maxThreadCount() );
+        }
     } else if ( k == _nThreadsPerEffect.get() ) {
         appPTR->setNThreadsPerEffect( getNumberOfThreadsPerEffect() );
+    } else if ( ( k == _interactiveRenderThreads.get() ) || ( k == _playbackRenderThreads.get() ) ||
+                ( k == _previewRenderThreads.get() ) || ( k == _backgroundRenderThreads.get() ) ) {
+        applyRenderPriorityThreadQuotas();
     } else if ( k == _ocioConfigKnob.get() ) {
         if (_ocioConfigKnob->getActiveEntry().id == NATRON_CUSTOM_OCIO_CONFIG_NAME) {
             _customOcioConfigFile->setAllDimensionsEnabled(true);
@@ -2467,6 +2604,18 @@ Settings::isViewerKeysEnabled() const
     return _viewerKeys->getValue();
 }
 
+bool
+Settings::isViewerProgressiveRenderEnabled() const
+{
+    return _viewerProgressiveRender->getValue();
+}
+
+int
+Settings::getViewerPrefetchFramesCount() const
+{
+    return _viewerPrefetchFrames->getValue();
+}
+
 ///////////////////////////////////////////////////////
 // "Caching" pane
 
@@ -2494,6 +2643,24 @@ Settings::getMaximumDiskCacheNodeSize() const
     return (U64)( _maxDiskCacheNodeGB->getValue() ) * std::pow(1024., 3.);
 }
 
+unsigned int
+Settings::getCacheShardsCount() const
+{
+    int nShards = _cacheShardsCount->getValue();
+
+    if (nShards <= 0) {
+        nShards = std::max(1, QThread::idealThreadCount() * 2);
+    }
+
+    return (unsigned int)nShards;
+}
+
+CacheEvictionPolicyEnum
+Settings::getCacheEvictionPolicy() const
+{
+    return (CacheEvictionPolicyEnum)_cacheEvictionPolicy->getValue();
+}
+
 ///////////////////////////////////////////////////
 
 double
@@ -2514,6 +2681,40 @@ Settings::getNumberOfThreadsPerEffect() const
     return _nThreadsPerEffect->getValue();
 }
 
+int
+Settings::getRenderPriorityThreadQuota(RenderPriorityEnum priority) const
+{
+    switch (priority) {
+    case eRenderPriorityInteractive:
+
+        return _interactiveRenderThreads->getValue();
+    case eRenderPriorityPlayback:
+
+        return _playbackRenderThreads->getValue();
+    case eRenderPriorityPreview:
+
+        return _previewRenderThreads->getValue();
+    case eRenderPriorityBackground:
+
+        return _backgroundRenderThreads->getValue();
+    }
+
+    return 0;
+}
+
+void
+Settings::applyRenderPriorityThreadQuotas()
+{
+    TaskScheduler* scheduler = appPTR->getTaskScheduler();
+
+    if (!scheduler) {
+        return;
+    }
+    for (int i = 0; i < NATRON_RENDER_PRIORITIES_COUNT; ++i) {
+        scheduler->setPriorityThreadQuota( (RenderPriorityEnum)i, getRenderPriorityThreadQuota( (RenderPriorityEnum)i ) );
+    }
+}
+
 int
 Settings::getNumberOfThreads() const
 {
@@ -2744,6 +2945,12 @@ Settings::isRenderInSeparatedProcessEnabled() const
     return _renderInSeparateProcess->getValue();
 }
 
+int
+Settings::getNumberOfRenderProcesses() const
+{
+    return std::max(1, _numberOfRenderProcesses->getValue());
+}
+
 int
 Settings::getMaximumUndoRedoNodeGraph() const
 {
@@ -2762,6 +2969,12 @@ Settings::isAutoSaveEnabledForUnsavedProjects() const
     return _autoSaveUnSavedProjects->getValue();
 }
 
+bool
+Settings::isSaveProjectsInBinaryFormatEnabled() const
+{
+    return _saveProjectsInBinaryFormat->getValue();
+}
+
 bool
 Settings::isSnapToNodeEnabled() const
 {
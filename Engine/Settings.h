@@ -110,6 +110,10 @@ public:
 
     U64 getMaximumDiskCacheNodeSize() const;
 
+    unsigned int getCacheShardsCount() const;
+
+    CacheEvictionPolicyEnum getCacheEvictionPolicy() const;
+
     double getUnreachableRamPercent() const;
 
     bool getColorPickerLinear() const;
@@ -124,6 +128,11 @@ public:
 
     int getNumberOfThreadsPerEffect() const;
 
+    /**
+     * @brief Returns the maximum number of threads of the TaskScheduler rendering tiles of the given priority, 0 for no limit.
+     **/
+    int getRenderPriorityThreadQuota(RenderPriorityEnum priority) const;
+
     bool useGlobalThreadPool() const;
 
     void setUseGlobalThreadPool(bool use);
@@ -166,6 +175,8 @@ public:
 
     bool isRenderInSeparatedProcessEnabled() const;
 
+    int getNumberOfRenderProcesses() const;
+
     bool isRenderQueuingEnabled() const;
 
     void setRenderQueuingEnabled(bool enabled);
@@ -178,6 +189,8 @@ public:
 
     bool isAutoSaveEnabledForUnsavedProjects() const;
 
+    bool isSaveProjectsInBinaryFormatEnabled() const;
+
     bool isSnapToNodeEnabled() const;
 
     bool isCheckForUpdatesEnabled() const;
@@ -249,6 +262,8 @@ public:
     unsigned int getAutoProxyMipMapLevel() const;
     int getMaxOpenedNodesViewerContext() const;
     bool isViewerKeysEnabled() const;
+    bool isViewerProgressiveRenderEnabled() const;
+    int getViewerPrefetchFramesCount() const;
     ///////////////////////////////////////////////////////
 
     bool areRGBPixelComponentsSupported() const;
@@ -412,6 +427,8 @@ private:
 
     bool tryLoadOpenColorIOConfig();
 
+    void applyRenderPriorityThreadQuotas();
+
 
     KnobBoolPtr _natronSettingsExist;
     KnobBoolPtr _saveSettings;
@@ -425,6 +442,7 @@ private:
     KnobButtonPtr _testCrashReportButton;
 #endif
     KnobBoolPtr _autoSaveUnSavedProjects;
+    KnobBoolPtr _saveProjectsInBinaryFormat;
     KnobIntPtr _autoSaveDelay;
     KnobChoicePtr _hostName;
     KnobStringPtr _customHostName;
@@ -435,7 +453,12 @@ private:
     KnobIntPtr _numberOfParallelRenders;
     KnobBoolPtr _useThreadPool;
     KnobIntPtr _nThreadsPerEffect;
+    KnobIntPtr _interactiveRenderThreads;
+    KnobIntPtr _playbackRenderThreads;
+    KnobIntPtr _previewRenderThreads;
+    KnobIntPtr _backgroundRenderThreads;
     KnobBoolPtr _renderInSeparateProcess;
+    KnobIntPtr _numberOfRenderProcesses;
     KnobBoolPtr _queueRenders;
 
     // General/Rendering
@@ -512,6 +535,10 @@ private:
     ///The total disk space allowed for all Natron's caches
     KnobIntPtr _maxViewerDiskCacheGB;
     KnobIntPtr _maxDiskCacheNodeGB;
+
+    ///The number of independently locked shards each cache is split into
+    KnobIntPtr _cacheShardsCount;
+    KnobChoicePtr _cacheEvictionPolicy;
     KnobPathPtr _diskCachePath;
     KnobButtonPtr _wipeDiskCache;
 
@@ -527,6 +554,8 @@ private:
     KnobChoicePtr _autoProxyLevel;
     KnobIntPtr _maximumNodeViewerUIOpened;
     KnobBoolPtr _viewerKeys;
+    KnobBoolPtr _viewerProgressiveRender;
+    KnobIntPtr _viewerPrefetchFrames;
 
     // Nodegraph
     KnobPagePtr _nodegraphTab;
@@ -28,6 +28,9 @@
 #include <cassert>
 #include <stdexcept>
 
+#include <boost/make_shared.hpp>
+
+#include "Engine/AppManager.h"
 #include "Engine/OfxClipInstance.h"
 #include "Engine/OfxHost.h"
 #include "Engine/OfxParamInstance.h"
@@ -116,10 +119,30 @@ AppTLS::softCopy(QThread* fromThread,
     _spawns[toThread] = fromThread;
 }
 
+TLSSnapshotPtr
+AppTLS::takeSnapshot(QThread* fromThread)
+{
+    assert( fromThread == QThread::currentThread() );
+    TLSSnapshotPtr snapshot = boost::make_shared<TLSSnapshot>();
+    copyTLS( fromThread, snapshot.get() );
+
+    return snapshot;
+}
+
+TLSSnapshot::~TLSSnapshot()
+{
+    appPTR->getAppTLS()->cleanupTLSForThread(this);
+}
+
 void
 AppTLS::cleanupTLSForThread()
 {
-    QThread* curThread = QThread::currentThread();
+    cleanupTLSForThread( QThread::currentThread() );
+}
+
+void
+AppTLS::cleanupTLSForThread(QThread* curThread)
+{
     AbortableThread* isAbortableThread = dynamic_cast<AbortableThread*>(curThread);
 
     if (isAbortableThread) {
@@ -44,6 +44,7 @@
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QThread>
 
+#include "Engine/ThreadPool.h"
 #include "Engine/EngineFwd.h"
 
 NATRON_NAMESPACE_ENTER
@@ -134,6 +135,13 @@ public:
      **/
     void softCopy(QThread* fromThread, QThread* toThread);
 
+    /**
+     * @brief Copies the TLS of fromThread, which must be the calling thread, to a new snapshot.
+     * Threads spawned to help fromThread should copy the TLS of the snapshot with copyTLS() instead of
+     * the TLS of fromThread, which fromThread may modify while they copy it.
+     **/
+    TLSSnapshotPtr takeSnapshot(QThread* fromThread);
+
     /**
      * @brief Same as copyTLS() except that if a spawner thread was register for curThread beforehand
      * with softCopy() then the TLS will be copied from the spawner thread.
@@ -149,6 +157,11 @@ public:
      **/
     void cleanupTLSForThread();
 
+    /**
+     * @brief Cleans up the TLS of the given thread, which must not be running, e.g: a TLSSnapshot
+     **/
+    void cleanupTLSForThread(QThread* thread);
+
 private:
 
     template <typename T>
@@ -168,6 +181,32 @@ private:
 };
 
 
+/**
+ * @brief A copy of the TLS and abort info of a thread, made by AppTLS::takeSnapshot().
+ * This thread is never started: it is only used as a key for the copied data, which is
+ * cleaned up when the snapshot is destroyed.
+ **/
+class TLSSnapshot
+    : public QThread
+      , public AbortableThread
+{
+public:
+
+    TLSSnapshot()
+        : QThread()
+        , AbortableThread(this)
+    {
+    }
+
+    virtual ~TLSSnapshot();
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+    }
+};
+
 /**
  * @brief Use this class if you need to hold TLS data on an object.
  * @param T is the data type held in the thread-local storage.
@@ -0,0 +1,680 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "TaskScheduler.h"
+
+#include <algorithm> // sort
+#include <cassert>
+#include <cmath>
+#include <deque>
+#include <vector>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+
+#include "Global/GlobalDefines.h"
+#include "Engine/ThreadPool.h"
+#include "Engine/Timer.h"
+
+// Number of queue latencies kept per priority
+#define NATRON_TASK_SCHEDULER_LATENCY_SAMPLES 1024
+
+NATRON_NAMESPACE_ENTER
+
+
+struct TaskSchedulerTask
+{
+    TaskScheduler::TaskFunction func;
+    TaskGroupPrivate* group;
+    RenderPriorityEnum priority;
+    // Started when the task is queued
+    TimeLapse queuedTimer;
+
+    TaskSchedulerTask()
+        : func()
+        , group(0)
+        , priority(eRenderPriorityInteractive)
+        , queuedTimer()
+    {
+    }
+};
+
+typedef std::deque<TaskSchedulerTask> TaskDeque;
+
+struct TaskQueue
+{
+    QMutex mutex;
+    TaskDeque tasks;
+
+    TaskQueue()
+        : mutex()
+        , tasks()
+    {
+    }
+
+    /**
+     * @brief Removes a task of the given group (or any task of the given priority if group is NULL) from the queue.
+     * The owner of a deque takes its most recent task, thieves take the oldest.
+     **/
+    bool take(const TaskGroupPrivate* group,
+              RenderPriorityEnum priority,
+              bool fromBack,
+              TaskSchedulerTask* task)
+    {
+        QMutexLocker k(&mutex);
+
+        if ( tasks.empty() ) {
+            return false;
+        }
+        if (fromBack) {
+            for (TaskDeque::iterator it = tasks.end(); it != tasks.begin();) {
+                --it;
+                if ( group ? (it->group == group) : (it->priority == priority) ) {
+                    *task = *it;
+                    tasks.erase(it);
+
+                    return true;
+                }
+            }
+        } else {
+            for (TaskDeque::iterator it = tasks.begin(); it != tasks.end(); ++it) {
+                if ( group ? (it->group == group) : (it->priority == priority) ) {
+                    *task = *it;
+                    tasks.erase(it);
+
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+};
+
+struct TaskGroupPrivate
+{
+    TaskSchedulerPrivate* scheduler;
+    RenderPriorityEnum priority;
+    QMutex mutex; // protects nPendingTasks and hasFailed
+    QWaitCondition doneCond;
+    int nPendingTasks;
+    bool hasFailed;
+
+    TaskGroupPrivate(TaskSchedulerPrivate* scheduler,
+                     RenderPriorityEnum priority)
+        : scheduler(scheduler)
+        , priority(priority)
+        , mutex()
+        , doneCond()
+        , nPendingTasks(0)
+        , hasFailed(false)
+    {
+    }
+};
+
+class TaskSchedulerThread
+    : public QThread
+      , public AbortableThread
+{
+public:
+
+    TaskSchedulerThread(TaskSchedulerPrivate* scheduler,
+                        int index)
+        : QThread()
+        , AbortableThread(this)
+        , queue()
+        , _scheduler(scheduler)
+        , _index(index)
+    {
+        setThreadName("Task scheduler");
+    }
+
+    virtual ~TaskSchedulerThread()
+    {
+    }
+
+    TaskSchedulerPrivate* getScheduler() const
+    {
+        return _scheduler;
+    }
+
+    int getIndex() const
+    {
+        return _index;
+    }
+
+    // The tasks scheduled from this thread
+    TaskQueue queue;
+
+private:
+
+    virtual void run() OVERRIDE FINAL;
+
+    TaskSchedulerPrivate* _scheduler;
+    int _index;
+};
+
+struct TaskSchedulerPrivate
+{
+    // Protects threads. Only the sleepMutex may be locked before this lock.
+    mutable QReadWriteLock threadsLock;
+    std::vector<TaskSchedulerThread*> threads;
+
+    // Tasks scheduled from threads that are not workers, per priority
+    TaskQueue sharedQueues[NATRON_RENDER_PRIORITIES_COUNT];
+
+    // Number of tasks in all queues, used by idle workers to know when to go to sleep
+    QAtomicInt nQueuedTasks;
+
+    // Number of tasks of each priority in all queues
+    QAtomicInt nQueuedTasksPerPriority[NATRON_RENDER_PRIORITIES_COUNT];
+
+    // Number of workers running a task of each priority, outside of TaskGroup::wait()
+    QAtomicInt nRunningTasksPerPriority[NATRON_RENDER_PRIORITIES_COUNT];
+
+    // Maximum value of nRunningTasksPerPriority, 0 for no limit
+    QAtomicInt threadQuotas[NATRON_RENDER_PRIORITIES_COUNT];
+
+    // The last queue latencies of each priority, in seconds
+    mutable QMutex latenciesMutex;
+    std::vector<double> latencies[NATRON_RENDER_PRIORITIES_COUNT];
+    std::size_t nextLatencyIndex[NATRON_RENDER_PRIORITIES_COUNT];
+
+    // Protects all fields below
+    mutable QMutex sleepMutex;
+    QWaitCondition workAvailableCond;
+    // Workers whose index is above the thread budget sleep on this one, so that they never take the wake-up of a queued task
+    QWaitCondition overBudgetCond;
+    int maxThreadCount;
+    // Number of workers blocked in TaskGroup::wait(), each of them allows another worker to run
+    int nBlockedWorkers;
+    // Incremented whenever the tasks that idle workers may take change: a task was queued, or a task
+    // of a priority with a thread quota finished
+    U64 tasksGeneration;
+    bool mustQuit;
+
+    TaskSchedulerPrivate(int maxThreadCount)
+        : threadsLock()
+        , threads()
+        , nQueuedTasks()
+        , latenciesMutex()
+        , sleepMutex()
+        , workAvailableCond()
+        , overBudgetCond()
+        , maxThreadCount(maxThreadCount)
+        , nBlockedWorkers(0)
+        , tasksGeneration(0)
+        , mustQuit(false)
+    {
+        for (int i = 0; i < NATRON_RENDER_PRIORITIES_COUNT; ++i) {
+            nextLatencyIndex[i] = 0;
+        }
+    }
+
+    TaskSchedulerThread* getCurrentWorker() const
+    {
+        TaskSchedulerThread* worker = dynamic_cast<TaskSchedulerThread*>( QThread::currentThread() );
+
+        if ( worker && (worker->getScheduler() == this) ) {
+            return worker;
+        }
+
+        return 0;
+    }
+
+    int getThreadBudget_locked() const
+    {
+        return maxThreadCount + nBlockedWorkers;
+    }
+
+    void spawnThreads_locked()
+    {
+        int budget = getThreadBudget_locked();
+        QWriteLocker k(&threadsLock);
+
+        while ( (int)threads.size() < budget ) {
+            TaskSchedulerThread* thread = new TaskSchedulerThread( this, (int)threads.size() );
+            threads.push_back(thread);
+            thread->start();
+        }
+    }
+
+    void pushTask(const TaskSchedulerTask& task)
+    {
+        TaskSchedulerThread* worker = getCurrentWorker();
+        TaskQueue& queue = worker ? worker->queue : sharedQueues[task.priority];
+        {
+            QMutexLocker k(&queue.mutex);
+            queue.tasks.push_back(task);
+        }
+        nQueuedTasksPerPriority[task.priority].fetchAndAddOrdered(1);
+        nQueuedTasks.fetchAndAddOrdered(1);
+
+        QMutexLocker k(&sleepMutex);
+        if (mustQuit) {
+            return;
+        }
+        ++tasksGeneration;
+        spawnThreads_locked();
+        workAvailableCond.wakeOne();
+    }
+
+    /**
+     * @brief Takes a task of the given group, or of the given priority if group is NULL: first the most recent
+     * task scheduled by this worker, then the oldest one scheduled by a thread that is not a worker, then
+     * the oldest one scheduled by another worker.
+     **/
+    bool takeTask_internal(TaskSchedulerThread* worker,
+                           const TaskGroupPrivate* group,
+                           RenderPriorityEnum priority,
+                           TaskSchedulerTask* task)
+    {
+        bool found = false;
+
+        if (worker) {
+            found = worker->queue.take(group, priority, true, task);
+        }
+        if (!found) {
+            found = sharedQueues[priority].take(group, priority, false, task);
+        }
+        if (!found) {
+            QReadLocker k(&threadsLock);
+            int nThreads = (int)threads.size();
+            int first = worker ? worker->getIndex() + 1 : 0;
+            for (int i = 0; i < nThreads && !found; ++i) {
+                TaskSchedulerThread* victim = threads[(first + i) % nThreads];
+                if (victim != worker) {
+                    found = victim->queue.take(group, priority, false, task);
+                }
+            }
+        }
+        if (found) {
+            nQueuedTasksPerPriority[priority].fetchAndAddOrdered(-1);
+            nQueuedTasks.fetchAndAddOrdered(-1);
+            addLatency( priority, task->queuedTimer.getTimeSinceCreation() );
+        }
+
+        return found;
+    }
+
+    /**
+     * @brief Takes a task of the given group, whatever the thread quotas.
+     **/
+    bool takeGroupTask(TaskSchedulerThread* worker,
+                       const TaskGroupPrivate* group,
+                       TaskSchedulerTask* task)
+    {
+        return takeTask_internal(worker, group, group->priority, task);
+    }
+
+    /**
+     * @brief Takes the task of highest priority whose thread quota is not reached and reserves a slot for it
+     * in nRunningTasksPerPriority, to be released with releaseTaskSlot() once the task is run.
+     **/
+    bool takeTask(TaskSchedulerThread* worker,
+                  TaskSchedulerTask* task)
+    {
+        for (int i = 0; i < NATRON_RENDER_PRIORITIES_COUNT; ++i) {
+            if (nQueuedTasksPerPriority[i].fetchAndAddRelaxed(0) <= 0) {
+                continue;
+            }
+            int quota = threadQuotas[i].fetchAndAddRelaxed(0);
+            int nRunning = nRunningTasksPerPriority[i].fetchAndAddOrdered(1);
+            if ( (quota > 0) && (nRunning >= quota) ) {
+                nRunningTasksPerPriority[i].fetchAndAddOrdered(-1);
+                continue;
+            }
+            if ( takeTask_internal(worker, 0, (RenderPriorityEnum)i, task) ) {
+                return true;
+            }
+            releaseTaskSlot( (RenderPriorityEnum)i );
+        }
+
+        return false;
+    }
+
+    void releaseTaskSlot(RenderPriorityEnum priority)
+    {
+        nRunningTasksPerPriority[priority].fetchAndAddOrdered(-1);
+
+        // Workers may wait for this slot
+        if ( (threadQuotas[priority].fetchAndAddRelaxed(0) > 0) && (nQueuedTasksPerPriority[priority].fetchAndAddRelaxed(0) > 0) ) {
+            QMutexLocker k(&sleepMutex);
+            ++tasksGeneration;
+            workAvailableCond.wakeAll();
+        }
+    }
+
+    void addLatency(RenderPriorityEnum priority,
+                    double latency)
+    {
+        QMutexLocker k(&latenciesMutex);
+        std::vector<double>& samples = latencies[priority];
+
+        if (samples.size() < NATRON_TASK_SCHEDULER_LATENCY_SAMPLES) {
+            samples.push_back(latency);
+        } else {
+            samples[nextLatencyIndex[priority]] = latency;
+            nextLatencyIndex[priority] = (nextLatencyIndex[priority] + 1) % NATRON_TASK_SCHEDULER_LATENCY_SAMPLES;
+        }
+    }
+
+    static void runTask(const TaskSchedulerTask& task)
+    {
+        bool failed = false;
+
+        try {
+            task.func();
+        } catch (...) {
+            failed = true;
+        }
+
+        // The group may be destroyed as soon as the mutex is released
+        TaskGroupPrivate* group = task.group;
+        QMutexLocker k(&group->mutex);
+        if (failed) {
+            group->hasFailed = true;
+        }
+        --group->nPendingTasks;
+        assert(group->nPendingTasks >= 0);
+        if (group->nPendingTasks == 0) {
+            group->doneCond.wakeAll();
+        }
+    }
+
+    void setWorkerBlocked(bool blocked)
+    {
+        QMutexLocker k(&sleepMutex);
+
+        if (blocked) {
+            ++nBlockedWorkers;
+            overBudgetCond.wakeAll();
+            if ( (nQueuedTasks.fetchAndAddRelaxed(0) > 0) && !mustQuit ) {
+                spawnThreads_locked();
+                workAvailableCond.wakeAll();
+            }
+        } else {
+            --nBlockedWorkers;
+            assert(nBlockedWorkers >= 0);
+        }
+    }
+};
+
+void
+TaskSchedulerThread::run()
+{
+    for (;;) {
+        U64 generation;
+        {
+            QMutexLocker k(&_scheduler->sleepMutex);
+            for (;;) {
+                if (_scheduler->mustQuit) {
+                    return;
+                }
+                if ( _index >= _scheduler->getThreadBudget_locked() ) {
+                    // This worker may have been woken up for a queued task after the budget was lowered:
+                    // pass the wake-up on to another worker before sleeping until the budget grows
+                    if (_scheduler->nQueuedTasks.fetchAndAddRelaxed(0) > 0) {
+                        _scheduler->workAvailableCond.wakeOne();
+                    }
+                    _scheduler->overBudgetCond.wait(&_scheduler->sleepMutex);
+                } else if (_scheduler->nQueuedTasks.fetchAndAddRelaxed(0) <= 0) {
+                    _scheduler->workAvailableCond.wait(&_scheduler->sleepMutex);
+                } else {
+                    break;
+                }
+            }
+            generation = _scheduler->tasksGeneration;
+        }
+
+        TaskSchedulerTask task;
+        if ( _scheduler->takeTask(this, &task) ) {
+            TaskSchedulerPrivate::runTask(task);
+            _scheduler->releaseTaskSlot(task.priority);
+        } else {
+            // Another thread took the task in the meantime, or the priorities of the queued tasks reached
+            // their thread quota: wait until a task is queued or a slot is released.
+            QMutexLocker k(&_scheduler->sleepMutex);
+            while ( !_scheduler->mustQuit && (_scheduler->tasksGeneration == generation) ) {
+                _scheduler->workAvailableCond.wait(&_scheduler->sleepMutex);
+            }
+        }
+    }
+}
+
+TaskScheduler::TaskScheduler(int maxThreadCount)
+    : _imp( new TaskSchedulerPrivate(maxThreadCount > 0 ? maxThreadCount : QThread::idealThreadCount()) )
+{
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        QMutexLocker k(&_imp->sleepMutex);
+        _imp->mustQuit = true;
+        _imp->workAvailableCond.wakeAll();
+        _imp->overBudgetCond.wakeAll();
+    }
+
+    std::vector<TaskSchedulerThread*> threads;
+    {
+        QWriteLocker k(&_imp->threadsLock);
+        threads.swap(_imp->threads);
+    }
+    for (std::size_t i = 0; i < threads.size(); ++i) {
+        threads[i]->wait();
+        delete threads[i];
+    }
+}
+
+void
+TaskScheduler::setMaxThreadCount(int maxThreadCount)
+{
+    QMutexLocker k(&_imp->sleepMutex);
+
+    _imp->maxThreadCount = maxThreadCount > 0 ? maxThreadCount : QThread::idealThreadCount();
+    if ( (_imp->nQueuedTasks.fetchAndAddRelaxed(0) > 0) && !_imp->mustQuit ) {
+        _imp->spawnThreads_locked();
+    }
+    _imp->workAvailableCond.wakeAll();
+    _imp->overBudgetCond.wakeAll();
+}
+
+int
+TaskScheduler::getMaxThreadCount() const
+{
+    QMutexLocker k(&_imp->sleepMutex);
+
+    return _imp->maxThreadCount;
+}
+
+int
+TaskScheduler::getSpawnedThreadCount() const
+{
+    QReadLocker k(&_imp->threadsLock);
+
+    return (int)_imp->threads.size();
+}
+
+bool
+TaskScheduler::isCurrentThreadWorker() const
+{
+    return _imp->getCurrentWorker() != 0;
+}
+
+int
+TaskScheduler::getQueuedTaskCount() const
+{
+    return _imp->nQueuedTasks.fetchAndAddRelaxed(0);
+}
+
+int
+TaskScheduler::getRunningTaskCount() const
+{
+    int ret = 0;
+
+    for (int i = 0; i < NATRON_RENDER_PRIORITIES_COUNT; ++i) {
+        ret += _imp->nRunningTasksPerPriority[i].fetchAndAddRelaxed(0);
+    }
+
+    return ret;
+}
+
+void
+TaskScheduler::setPriorityThreadQuota(RenderPriorityEnum priority,
+                                      int maxThreadCount)
+{
+    _imp->threadQuotas[priority].fetchAndStoreOrdered( std::max(0, maxThreadCount) );
+
+    // Workers may take tasks that were above the previous quota
+    QMutexLocker k(&_imp->sleepMutex);
+    ++_imp->tasksGeneration;
+    _imp->workAvailableCond.wakeAll();
+}
+
+int
+TaskScheduler::getPriorityThreadQuota(RenderPriorityEnum priority) const
+{
+    return _imp->threadQuotas[priority].fetchAndAddRelaxed(0);
+}
+
+double
+TaskScheduler::getQueueLatencyPercentile(RenderPriorityEnum priority,
+                                         double percentile) const
+{
+    std::vector<double> samples;
+    {
+        QMutexLocker k(&_imp->latenciesMutex);
+        samples = _imp->latencies[priority];
+    }
+    if ( samples.empty() ) {
+        return 0.;
+    }
+    std::sort( samples.begin(), samples.end() );
+    // Nearest-rank percentile
+    int rank = (int)std::ceil( std::max(0., std::min(percentile, 100.) ) / 100. * samples.size() );
+
+    return samples[std::max(rank, 1) - 1];
+}
+
+int
+TaskScheduler::getQueueLatencySamplesCount(RenderPriorityEnum priority) const
+{
+    QMutexLocker k(&_imp->latenciesMutex);
+
+    return (int)_imp->latencies[priority].size();
+}
+
+void
+TaskScheduler::resetQueueLatencies()
+{
+    QMutexLocker k(&_imp->latenciesMutex);
+
+    for (int i = 0; i < NATRON_RENDER_PRIORITIES_COUNT; ++i) {
+        _imp->latencies[i].clear();
+        _imp->nextLatencyIndex[i] = 0;
+    }
+}
+
+TaskGroup::TaskGroup(TaskScheduler* scheduler,
+                     RenderPriorityEnum priority)
+    : _imp( new TaskGroupPrivate(scheduler ? scheduler->_imp.get() : 0, priority) )
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+    wait();
+}
+
+void
+TaskGroup::run(const TaskScheduler::TaskFunction& task)
+{
+    if (!_imp->scheduler) {
+        try {
+            task();
+        } catch (...) {
+            QMutexLocker k(&_imp->mutex);
+            _imp->hasFailed = true;
+        }
+
+        return;
+    }
+
+    {
+        QMutexLocker k(&_imp->mutex);
+        ++_imp->nPendingTasks;
+    }
+
+    TaskSchedulerTask t;
+    t.func = task;
+    t.group = _imp.get();
+    t.priority = _imp->priority;
+    _imp->scheduler->pushTask(t);
+}
+
+bool
+TaskGroup::wait()
+{
+    if (_imp->scheduler) {
+        TaskSchedulerThread* worker = _imp->scheduler->getCurrentWorker();
+
+        // Help: run the tasks of this group that are still queued in this thread
+        TaskSchedulerTask task;
+        while ( _imp->scheduler->takeGroupTask(worker, _imp.get(), &task) ) {
+            TaskSchedulerPrivate::runTask(task);
+        }
+
+        // All remaining tasks are running on other threads: only tasks of this group could
+        // have been run here without messing with the thread-local storage of the task we're in.
+        bool mustBlock;
+        {
+            QMutexLocker k(&_imp->mutex);
+            mustBlock = _imp->nPendingTasks > 0;
+        }
+        if (mustBlock) {
+            if (worker) {
+                _imp->scheduler->setWorkerBlocked(true);
+            }
+            {
+                QMutexLocker k(&_imp->mutex);
+                while (_imp->nPendingTasks > 0) {
+                    _imp->doneCond.wait(&_imp->mutex);
+                }
+            }
+            if (worker) {
+                _imp->scheduler->setWorkerBlocked(false);
+            }
+        }
+    }
+
+    QMutexLocker k(&_imp->mutex);
+
+    return !_imp->hasFailed;
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,189 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_TASKSCHEDULER_H
+#define NATRON_ENGINE_TASKSCHEDULER_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/Enums.h"
+#include "Engine/EngineFwd.h"
+
+// Number of values of RenderPriorityEnum
+#define NATRON_RENDER_PRIORITIES_COUNT (eRenderPriorityBackground + 1)
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A work-stealing task scheduler used to render tiles and pre-render inputs in parallel.
+ *
+ * Each worker thread owns a deque of tasks: tasks scheduled from a worker are pushed on its own deque
+ * and popped back in LIFO order, while idle workers steal the oldest tasks of the other deques.
+ * Tasks scheduled from a thread that is not a worker (e.g: a render thread) go to a shared queue.
+ *
+ * Unlike QtConcurrent on the global QThreadPool, waiting on a TaskGroup never just blocks:
+ * the waiting thread executes the pending tasks of that group itself, so that a tile render
+ * which itself renders an input with tiles always makes progress, even when all workers are busy.
+ * When a worker has to block because the remaining tasks of its group run on other threads,
+ * another worker is woken up (or spawned) to keep the same number of busy threads.
+ *
+ * Each group has a priority: idle workers always pick the tasks of the highest priority first, so that
+ * the tiles of an interactive viewer render are run before the queued tiles of a preview or of a Write
+ * node, and the number of workers running tasks of a given priority at the same time may be limited.
+ * The time spent by the tasks in the queues is recorded per priority.
+ **/
+struct TaskSchedulerPrivate;
+class TaskScheduler
+{
+    friend class TaskGroup;
+    friend class TaskSchedulerThread;
+
+public:
+
+    typedef boost::function0<void> TaskFunction;
+
+    /**
+     * @brief Creates a scheduler that runs at most maxThreadCount worker threads at a time.
+     * If maxThreadCount is 0, QThread::idealThreadCount() is used.
+     * Worker threads are only spawned when tasks are scheduled.
+     **/
+    TaskScheduler(int maxThreadCount = 0);
+
+    /**
+     * @brief Waits for the worker threads to finish their current task and quits them.
+     **/
+    ~TaskScheduler();
+
+    /**
+     * @brief Changes the number of workers allowed to run tasks at the same time.
+     * Workers above this limit go to sleep once their current task is done.
+     **/
+    void setMaxThreadCount(int maxThreadCount);
+
+    int getMaxThreadCount() const;
+
+    /**
+     * @brief Returns the number of worker threads spawned so far (running or sleeping).
+     **/
+    int getSpawnedThreadCount() const;
+
+    /**
+     * @brief Returns true if the calling thread is one of the workers of this scheduler.
+     **/
+    bool isCurrentThreadWorker() const;
+
+    /**
+     * @brief Returns the number of tasks waiting in the queues to be run.
+     **/
+    int getQueuedTaskCount() const;
+
+    /**
+     * @brief Returns the number of workers running a task. The tasks run by a thread waiting on their
+     * TaskGroup are not counted.
+     **/
+    int getRunningTaskCount() const;
+
+    /**
+     * @brief Limits the number of workers running tasks of the given priority at the same time.
+     * 0 means no limit other than the maximum thread count.
+     * The thread waiting on a TaskGroup runs the tasks of its group whatever the quota, so that a render
+     * always makes progress.
+     **/
+    void setPriorityThreadQuota(RenderPriorityEnum priority, int maxThreadCount);
+
+    int getPriorityThreadQuota(RenderPriorityEnum priority) const;
+
+    /**
+     * @brief Returns the given percentile (in [0, 100]) of the time, in seconds, spent in the queues by
+     * the last tasks of the given priority before being run, or 0 if no such task ran yet.
+     **/
+    double getQueueLatencyPercentile(RenderPriorityEnum priority, double percentile) const;
+
+    /**
+     * @brief Returns the number of tasks of the given priority whose latency is recorded.
+     **/
+    int getQueueLatencySamplesCount(RenderPriorityEnum priority) const;
+
+    void resetQueueLatencies();
+
+private:
+
+    boost::scoped_ptr<TaskSchedulerPrivate> _imp;
+};
+
+/**
+ * @brief A set of tasks scheduled on a TaskScheduler that can be waited on together.
+ * Tasks may only be added from the thread that created the group, and they may themselves
+ * create and wait on other groups.
+ *
+ * Example:
+ *
+ *      TaskGroup group(appPTR->getTaskScheduler(), frameArgs->getRenderPriority());
+ *      for (int i = 0; i < n; ++i) {
+ *          group.run( boost::bind(&renderTile, i) );
+ *      }
+ *      group.wait();
+ **/
+struct TaskGroupPrivate;
+class TaskGroup
+{
+    friend class TaskScheduler;
+    friend struct TaskSchedulerPrivate;
+
+public:
+
+    TaskGroup(TaskScheduler* scheduler,
+              RenderPriorityEnum priority = eRenderPriorityInteractive);
+
+    /**
+     * @brief Waits for all tasks of the group to be done.
+     **/
+    ~TaskGroup();
+
+    /**
+     * @brief Schedules the given task. If the group has no scheduler, the task is run immediately
+     * in the calling thread.
+     **/
+    void run(const TaskScheduler::TaskFunction& task);
+
+    /**
+     * @brief Runs the tasks of this group that were not picked up by a worker yet in the calling thread,
+     * then waits for the ones running in other threads.
+     * Returns false if any task of the group exited with an exception.
+     **/
+    bool wait();
+
+private:
+
+    boost::scoped_ptr<TaskGroupPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_TASKSCHEDULER_H
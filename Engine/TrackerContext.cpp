@@ -32,6 +32,8 @@ CLANG_DIAG_OFF(uninitialized)
 #include <QtCore/QWaitCondition>
 #include <QtCore/QThread>
 #include <QtCore/QCoreApplication>
+#include <QtCore/QDebug>
+#include <QtConcurrentRun> // QtCore on Qt4, QtConcurrent on Qt5
 CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
 
@@ -492,6 +494,13 @@ TrackerContext::isCurrentlyTracking() const
     return _imp->scheduler.isWorking();
 }
 
+void
+TrackerContext::getLastTrackingCacheStatistics(U64* imagesCount,
+                                               U64* rendersCount) const
+{
+    _imp->scheduler.getLastTrackingCacheStatistics(imagesCount, rendersCount);
+}
+
 void
 TrackerContext::abortTracking()
 {
@@ -1712,15 +1721,75 @@ TrackArgs::getRedrawAreasNeeded(int time,
     }
 }
 
+void
+TrackArgs::setFrameSearchRegion(int time) const
+{
+    if (!_imp->fa) {
+        return;
+    }
+    std::list<RectD> searchWindows;
+    getRedrawAreasNeeded(time, &searchWindows);
+    if ( searchWindows.empty() ) {
+        return;
+    }
+
+    // libmv moves the search window to the predicted position of the marker before tracking:
+    // pad each window by half its size to include it.
+    RectD region;
+    for (std::list<RectD>::const_iterator it = searchWindows.begin(); it != searchWindows.end(); ++it) {
+        double padX = it->width() / 2.;
+        double padY = it->height() / 2.;
+        if ( it == searchWindows.begin() ) {
+            region.set(it->x1 - padX, it->y1 - padY, it->x2 + padX, it->y2 + padY);
+        } else {
+            region.merge(it->x1 - padX, it->y1 - padY, it->x2 + padX, it->y2 + padY);
+        }
+    }
+    RectI pixelRegion;
+    region.toPixelEnclosing(0, 1., &pixelRegion);
+    _imp->fa->setFrameSearchRegion(time, pixelRegion);
+}
+
+void
+TrackArgs::prefetchFrame(int time) const
+{
+    if (!_imp->fa) {
+        return;
+    }
+    _imp->fa->prefetchFrame(time);
+
+    appPTR->getAppTLS()->cleanupTLSForThread();
+}
+
+void
+TrackArgs::getCacheStatistics(U64* imagesCount,
+                              U64* rendersCount) const
+{
+    if (!_imp->fa) {
+        *imagesCount = *rendersCount = 0;
+
+        return;
+    }
+    _imp->fa->getCacheStatistics(imagesCount, rendersCount);
+}
+
 struct TrackSchedulerPrivate
 {
     TrackerParamsProvider* paramsProvider;
     NodeWPtr node;
 
+    // Protects the statistics of the last tracking
+    mutable QMutex statisticsMutex;
+    U64 lastImagesCount;
+    U64 lastRendersCount;
+
     TrackSchedulerPrivate(TrackerParamsProvider* paramsProvider,
                           const NodeWPtr& node)
         : paramsProvider(paramsProvider)
         , node(node)
+        , statisticsMutex()
+        , lastImagesCount(0)
+        , lastRendersCount(0)
     {
     }
 
@@ -1751,6 +1820,16 @@ TrackScheduler::~TrackScheduler()
 {
 }
 
+void
+TrackScheduler::getLastTrackingCacheStatistics(U64* imagesCount,
+                                               U64* rendersCount) const
+{
+    QMutexLocker k(&_imp->statisticsMutex);
+
+    *imagesCount = _imp->lastImagesCount;
+    *rendersCount = _imp->lastRendersCount;
+}
+
 bool
 TrackSchedulerPrivate::trackStepFunctor(int trackIndex,
                                         const TrackArgs& args,
@@ -1854,8 +1933,13 @@ TrackScheduler::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
     const std::vector<TrackMarkerAndOptionsPtr>& tracks = args->getTracks();
     const int numTracks = (int)tracks.size();
     std::vector<int> trackIndexes( tracks.size() );
+    // Only the markers tracked by libmv read their images from the frame accessor
+    bool hasLibMVTracks = false;
     for (std::size_t i = 0; i < tracks.size(); ++i) {
         trackIndexes[i] = i;
+        if ( !dynamic_cast<TrackMarkerPM*>( tracks[i]->natronMarker.get() ) ) {
+            hasLibMVTracks = true;
+        }
         tracks[i]->natronMarker->notifyTrackingStarted();
         // unslave the enabled knob, since it is slaved to the gui but we may modify it
         KnobBoolPtr enabledKnob = tracks[i]->natronMarker->getEnabledKnob();
@@ -1882,7 +1966,26 @@ TrackScheduler::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
         }
 
 
+        // Renders the next frame in the frame accessor while the current one is tracked
+        QFuture<void> prefetchFuture;
+
         while (cur != end) {
+            // The previous prefetch renders the current frame: wait for it before requesting the search regions
+            // of this frame, so that only what its tile does not cover is rendered again
+            prefetchFuture.waitForFinished();
+
+            // Render the search windows of all markers at once, in the tracked frame and in the previous one
+            // which is usually the reference frame
+            args->setFrameSearchRegion(cur);
+            args->setFrameSearchRegion(cur - frameStep);
+            const int next = cur + frameStep;
+            if ( hasLibMVTracks && ( ( (frameStep > 0) && (next < end) ) || ( (frameStep < 0) && (next > end) ) ) ) {
+                // The markers are not tracked yet at the next frame: their search windows are estimated from
+                // their current position, the accessor renders what is missing when libmv requests it.
+                args->setFrameSearchRegion(next);
+                prefetchFuture = QtConcurrent::run(args.get(), &TrackArgs::prefetchFrame, next);
+            }
+
             ///Launch parallel thread for each track using the global thread pool
             QFuture<bool> future = QtConcurrent::mapped( trackIndexes,
                                                          boost::bind(&TrackSchedulerPrivate::trackStepFunctor,
@@ -1966,6 +2069,19 @@ TrackScheduler::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
                 break;
             }
         } // while (cur != end) {
+
+        prefetchFuture.waitForFinished();
+
+        U64 imagesCount, rendersCount;
+        args->getCacheStatistics(&imagesCount, &rendersCount);
+        {
+            QMutexLocker k(&_imp->statisticsMutex);
+            _imp->lastImagesCount = imagesCount;
+            _imp->lastRendersCount = rendersCount;
+        }
+#ifdef TRACE_LIB_MV
+        qDebug() << "Tracking:" << imagesCount << "images served with" << rendersCount << "renders of the input";
+#endif
     } // IsTrackingFlagSetter_RAII
     TrackerContext* isContext = dynamic_cast<TrackerContext*>(_imp->paramsProvider);
     if (isContext) {
@@ -194,6 +194,12 @@ public:
 
     bool isCurrentlyTracking() const;
 
+    /**
+     * @brief Returns the number of images requested by libmv during the last tracking and the number of renders
+     * of the input it took to produce them.
+     **/
+    void getLastTrackingCacheStatistics(U64* imagesCount, U64* rendersCount) const;
+
     void quitTrackerThread_non_blocking();
 
     bool hasTrackerThreadQuit() const;
@@ -480,6 +486,23 @@ public:
 
     void getRedrawAreasNeeded(int time, std::list<RectD>* canonicalRects) const;
 
+    /**
+     * @brief Gives the frame accessor the area covering the search windows of all markers at the given time,
+     * so that the input is rendered once for all markers.
+     **/
+    void setFrameSearchRegion(int time) const;
+
+    /**
+     * @brief Renders the input at the given time in the frame accessor cache. Called from a thread-pool thread
+     * to render the next frame while the markers are tracked at the current one.
+     **/
+    void prefetchFrame(int time) const;
+
+    /**
+     * @brief Returns the statistics of the frame accessor cache, see TrackerFrameAccessor::getCacheStatistics
+     **/
+    void getCacheStatistics(U64* imagesCount, U64* rendersCount) const;
+
 private:
 
     boost::scoped_ptr<TrackArgsPrivate> _imp;
@@ -522,6 +545,12 @@ public:
         Q_EMIT trackingFinished();
     }
 
+    /**
+     * @brief Returns the number of images requested by libmv during the last tracking and the number of renders
+     * of the input it took to produce them. The difference is the number of renders saved by the frame accessor cache.
+     **/
+    void getLastTrackingCacheStatistics(U64* imagesCount, U64* rendersCount) const;
+
 private Q_SLOTS:
 
     void doRenderCurrentFrameForViewer(ViewerInstance* viewer);
@@ -24,6 +24,7 @@
 
 #include "TrackerContextPrivate.h"
 
+#include <cmath>
 #include <sstream> // stringstream
 
 #if defined(CERES_USE_OPENMP) && defined(_OPENMP)
@@ -49,6 +50,9 @@
 //#define TRACKER_GENERATE_DATA_SEQUENTIALLY
 #endif
 
+// The minimum number of consecutive keyframes solved by the same thread, sharing their data
+#define NATRON_TRACKER_SOLVER_MIN_BATCH_SIZE 8
+
 
 NATRON_NAMESPACE_ENTER
 
@@ -1740,12 +1744,6 @@ TrackerContextPrivate::computeFundamentalFromNPoints(const bool dataSetIsManual,
                                          model(2, 0), model(2, 1), model(2, 2) );
 }
 
-struct PointWithError
-{
-    Point p1, p2;
-    double error;
-};
-
 static bool
 PointWithErrorCompareLess(const PointWithError& lhs,
                           const PointWithError& rhs)
@@ -1753,140 +1751,243 @@ PointWithErrorCompareLess(const PointWithError& lhs,
     return lhs.error < rhs.error;
 }
 
+static bool
+pointsEqual(const std::vector<Point>& lhs,
+            const std::vector<Point>& rhs)
+{
+    if ( lhs.size() != rhs.size() ) {
+        return false;
+    }
+    for (std::size_t i = 0; i < lhs.size(); ++i) {
+        if ( (lhs[i].x != rhs[i].x) || (lhs[i].y != rhs[i].y) ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static Point
+getCenterMinusTransformCenter(const KnobDoublePtr& centerKnob,
+                              const KnobDoublePtr& center,
+                              double time)
+{
+    Point p;
+
+    p.x = centerKnob->getValueAtTime(time, 0);
+    p.y = centerKnob->getValueAtTime(time, 1);
+    if (center) {
+        p.x -= center->getValueAtTime(time, 0);
+        p.y -= center->getValueAtTime(time, 1);
+    }
+
+    return p;
+}
+
 void
-TrackerContextPrivate::extractSortedPointsFromMarkers(double refTime,
+TrackerContextPrivate::initSolverBatch(double refTime,
+                                       const std::vector<double>& keyframes,
+                                       const std::vector<TrackMarkerPtr>& allMarkers,
+                                       int jitterPeriod,
+                                       const KnobDoublePtr& center,
+                                       SolverBatch* batch) const
+{
+    batch->rodRef = getInputRoDAtTime(refTime);
+    sampleMarkersCenters(refTime, keyframes, allMarkers, jitterPeriod, center, batch);
+}
+
+void
+TrackerContextPrivate::sampleMarkersCenters(double refTime,
+                                            const std::vector<double>& keyframes,
+                                            const std::vector<TrackMarkerPtr>& allMarkers,
+                                            int jitterPeriod,
+                                            const KnobDoublePtr& center,
+                                            SolverBatch* batch)
+{
+    bool useJitter = (jitterPeriod > 1);
+    if (!useJitter) {
+        batch->refCenters.resize( allMarkers.size() );
+        for (std::size_t i = 0; i < allMarkers.size(); ++i) {
+            batch->refCenters[i] = getCenterMinusTransformCenter(allMarkers[i]->getCenterKnob(), center, refTime);
+        }
+
+        return;
+    }
+
+    // Sample the centers once for the whole batch if the keyframes are whole frames close enough to each other
+    // that this reads fewer values than averaging each keyframe separately
+    if ( keyframes.empty() ) {
+        return;
+    }
+    for (std::size_t i = 0; i < keyframes.size(); ++i) {
+        if ( keyframes[i] != std::floor(keyframes[i]) ) {
+            return;
+        }
+    }
+    int halfJitter = std::max(0, jitterPeriod / 2);
+    int firstSampleTime = (int)keyframes.front() - halfJitter;
+    int samplesCount = (int)keyframes.back() + halfJitter - firstSampleTime + 1;
+    if ( samplesCount > (int)keyframes.size() * (2 * halfJitter + 1) ) {
+        return;
+    }
+    batch->firstSampleTime = firstSampleTime;
+    batch->centersPrefixSums.resize( allMarkers.size() );
+    for (std::size_t i = 0; i < allMarkers.size(); ++i) {
+        KnobDoublePtr centerKnob = allMarkers[i]->getCenterKnob();
+        std::vector<Point>& prefixSums = batch->centersPrefixSums[i];
+        prefixSums.resize(samplesCount + 1);
+        prefixSums[0].x = prefixSums[0].y = 0.;
+        for (int s = 0; s < samplesCount; ++s) {
+            Point p = getCenterMinusTransformCenter(centerKnob, center, firstSampleTime + s);
+            prefixSums[s + 1].x = prefixSums[s].x + p.x;
+            prefixSums[s + 1].y = prefixSums[s].y + p.y;
+        }
+    }
+} // TrackerContextPrivate::sampleMarkersCenters
+
+void
+TrackerContextPrivate::extractSortedPointsFromMarkers(double /*refTime*/,
                                                       double time,
-                                                      const std::vector<TrackMarkerPtr>& markers,
+                                                      const std::vector<TrackMarkerPtr>& allMarkers,
                                                       int jitterPeriod,
                                                       bool jitterAdd,
                                                       const KnobDoublePtr& center,
-                                                      std::vector<Point>* x1,
-                                                      std::vector<Point>* x2)
+                                                      SolverBatch* batch)
 {
-    assert( !markers.empty() );
+    std::vector<PointWithError>& pointsWithErrors = batch->pointsWithErrors;
 
-    std::vector<PointWithError> pointsWithErrors;
+    pointsWithErrors.clear();
     bool useJitter = (jitterPeriod > 1);
     int halfJitter = std::max(0, jitterPeriod / 2);
+    bool useSamples = useJitter && !batch->centersPrefixSums.empty();
     // Prosac expects the points to be sorted by decreasing correlation score (increasing error)
-    int pIndex = 0;
-    Point c1 = {0., 0.};
     Point c2 = {0., 0.};
     if (center) {
         // The transform parameters are all computed with respect to the transform center.
         // We must thus subtract the transform center before computation.
         // See bug https://github.com/NatronGitHub/Natron/issues/289
-        c1.x = center->getValueAtTime(refTime, 0);
-        c1.y = center->getValueAtTime(refTime, 1);
         c2.x = center->getValueAtTime(time, 0);
         c2.y = center->getValueAtTime(time, 1);
     }
-    for (std::size_t i = 0; i < markers.size(); ++i) {
-        KnobDoublePtr centerKnob = markers[i]->getCenterKnob();
-        KnobDoublePtr errorKnob = markers[i]->getErrorKnob();
+    for (std::size_t i = 0; i < allMarkers.size(); ++i) {
+        if ( !allMarkers[i]->isEnabled(time) ) {
+            continue;
+        }
+        KnobDoublePtr centerKnob = allMarkers[i]->getCenterKnob();
+        KnobDoublePtr errorKnob = allMarkers[i]->getErrorKnob();
 
         if (centerKnob->getKeyFrameIndex(ViewSpec::current(), 0, time) < 0) {
             continue;
         }
-        pointsWithErrors.resize(pointsWithErrors.size() + 1);
-
-        PointWithError& perr = pointsWithErrors[pIndex];
 
+        PointWithError perr;
         if (!useJitter) {
-            perr.p1.x = centerKnob->getValueAtTime(refTime, 0) - c1.x;
-            perr.p1.y = centerKnob->getValueAtTime(refTime, 1) - c1.y;
+            perr.p1 = batch->refCenters[i];
             perr.p2.x = centerKnob->getValueAtTime(time, 0) - c2.x;
             perr.p2.y = centerKnob->getValueAtTime(time, 1) - c2.y;
         } else {
             // Average halfJitter frames before and after refTime and time together to smooth the center
-            std::vector<Point> x2PointJitter;
-
-            for (double t = time - halfJitter; t <= time + halfJitter; t += 1.) {
-                Point p;
-                p.x = centerKnob->getValueAtTime(t, 0);
-                p.y = centerKnob->getValueAtTime(t, 1);
-                if (center) {
-                    p.x -= center->getValueAtTime(t, 0);
-                    p.y -= center->getValueAtTime(t, 1);
+            Point x2 = {0., 0.};
+            Point x2avg = {0., 0.};
+            if (useSamples) {
+                const std::vector<Point>& prefixSums = batch->centersPrefixSums[i];
+                int s = (int)time - batch->firstSampleTime;
+                assert( s - halfJitter >= 0 && s + halfJitter + 1 < (int)prefixSums.size() );
+                x2.x = prefixSums[s + 1].x - prefixSums[s].x;
+                x2.y = prefixSums[s + 1].y - prefixSums[s].y;
+                x2avg.x = (prefixSums[s + halfJitter + 1].x - prefixSums[s - halfJitter].x) / (2 * halfJitter + 1);
+                x2avg.y = (prefixSums[s + halfJitter + 1].y - prefixSums[s - halfJitter].y) / (2 * halfJitter + 1);
+            } else {
+                x2.x = centerKnob->getValueAtTime(time, 0) - c2.x;
+                x2.y = centerKnob->getValueAtTime(time, 1) - c2.y;
+                int nSamples = 0;
+                for (double t = time - halfJitter; t <= time + halfJitter; t += 1., ++nSamples) {
+                    Point p = getCenterMinusTransformCenter(centerKnob, center, t);
+                    x2avg.x += p.x;
+                    x2avg.y += p.y;
+                }
+                if (nSamples) {
+                    x2avg.x /= nSamples;
+                    x2avg.y /= nSamples;
                 }
-                x2PointJitter.push_back(p);
-            }
-            Point x2avg = {0, 0};
-            for (std::size_t i = 0; i < x2PointJitter.size(); ++i) {
-                x2avg.x += x2PointJitter[i].x;
-                x2avg.y += x2PointJitter[i].y;
-            }
-            if ( !x2PointJitter.empty() ) {
-                x2avg.x /= x2PointJitter.size();
-                x2avg.y /= x2PointJitter.size();
             }
             if (!jitterAdd) {
-                perr.p1.x = centerKnob->getValueAtTime(time, 0) - c2.x;
-                perr.p1.y = centerKnob->getValueAtTime(time, 1) - c2.y;
-                perr.p2.x = x2avg.x;
-                perr.p2.y = x2avg.y;
+                perr.p1 = x2;
+                perr.p2 = x2avg;
             } else {
                 Point highFreqX2;
-
-                Point x2;
-                x2.x = centerKnob->getValueAtTime(time, 0) - c2.x;
-                x2.y = centerKnob->getValueAtTime(time, 1) - c2.y;
                 highFreqX2.x = x2.x - x2avg.x;
                 highFreqX2.y = x2.y - x2avg.y;
 
-                perr.p1.x = x2.x;
-                perr.p1.y = x2.y;
+                perr.p1 = x2;
                 perr.p2.x = x2.x + highFreqX2.x;
                 perr.p2.y = x2.y + highFreqX2.y;
             }
         }
 
         perr.error = errorKnob->getValueAtTime(time, 0);
-        ++pIndex;
+        pointsWithErrors.push_back(perr);
     }
 
     std::sort(pointsWithErrors.begin(), pointsWithErrors.end(), PointWithErrorCompareLess);
 
-    x1->resize( pointsWithErrors.size() );
-    x2->resize( pointsWithErrors.size() );
+    batch->x1.resize( pointsWithErrors.size() );
+    batch->x2.resize( pointsWithErrors.size() );
 
     for (std::size_t i =  0; i < pointsWithErrors.size(); ++i) {
         assert(i == 0 || pointsWithErrors[i].error >= pointsWithErrors[i - 1].error);
-        (*x1)[i] = pointsWithErrors[i].p1;
-        (*x2)[i] = pointsWithErrors[i].p2;
+        batch->x1[i] = pointsWithErrors[i].p1;
+        batch->x2[i] = pointsWithErrors[i].p2;
     }
 } // TrackerContext::extractSortedPointsFromMarkers
 
+/*
+ * Returns true if the correspondences extracted in the batch at time are the same as the ones of the previous
+ * keyframe, solved at previousTime, in which case its solution can be reused. They are kept for the next keyframe.
+ */
+static bool
+checkSameCorrespondencesAsPrevious(TrackerContextPrivate::SolverBatch* batch,
+                                   const double* previousTime,
+                                   double time,
+                                   const RectD& rodTime)
+{
+    bool same = previousTime && batch->hasPrevious && (batch->previousTime == *previousTime) && (batch->previousRoD == rodTime) &&
+                pointsEqual(batch->x1, batch->previousX1) && pointsEqual(batch->x2, batch->previousX2);
+
+    if (!same) {
+        batch->previousX1 = batch->x1;
+        batch->previousX2 = batch->x2;
+        batch->previousRoD = rodTime;
+    }
+    batch->previousTime = time;
+    batch->hasPrevious = true;
+
+    return same;
+}
+
 TrackerContextPrivate::TransformData
 TrackerContextPrivate::computeTransformParamsFromTracksAtTime(double refTime,
                                                               double time,
                                                               int jitterPeriod,
                                                               bool jitterAdd,
                                                               bool robustModel,
-                                                              const std::vector<TrackMarkerPtr>& allMarkers)
+                                                              const std::vector<TrackMarkerPtr>& allMarkers,
+                                                              SolverBatch* batch,
+                                                              const TransformData* previous)
 {
-
-    RectD rodRef = getInputRoDAtTime(refTime);
     RectD rodTime = getInputRoDAtTime(time);
-    int w1 = rodRef.width();
-    int h1 = rodRef.height();
+    int w1 = batch->rodRef.width();
+    int h1 = batch->rodRef.height();
     int w2 = rodTime.width();
     int h2 = rodTime.height();
 
-    std::vector<TrackMarkerPtr> markers;
-
-    for (std::size_t i = 0; i < allMarkers.size(); ++i) {
-        if ( allMarkers[i]->isEnabled(time) ) {
-            markers.push_back(allMarkers[i]);
-        }
-    }
     TrackerContextPrivate::TransformData data;
     data.rms = 0.;
     data.time = time;
     data.valid = true;
-    assert( !markers.empty() );
-    std::vector<Point> x1, x2;
-    extractSortedPointsFromMarkers(refTime, time, markers, jitterPeriod, jitterAdd, center.lock(), &x1, &x2);
+    extractSortedPointsFromMarkers(refTime, time, allMarkers, jitterPeriod, jitterAdd, center.lock(), batch);
+    const std::vector<Point>& x1 = batch->x1;
+    const std::vector<Point>& x2 = batch->x2;
     assert( x1.size() == x2.size() );
     if ( x1.empty() ) {
         data.valid = false;
@@ -1901,6 +2002,13 @@ TrackerContextPrivate::computeTransformParamsFromTracksAtTime(double refTime,
         return data;
     }
 
+    // The markers did not move since the previous keyframe: its solution is the same
+    if ( checkSameCorrespondencesAsPrevious(batch, previous ? &previous->time : 0, time, rodTime) ) {
+        data = *previous;
+        data.time = time;
+
+        return data;
+    }
 
     const bool dataSetIsUserManual = true;
 
@@ -1925,30 +2033,23 @@ TrackerContextPrivate::computeCornerPinParamsFromTracksAtTime(double refTime,
                                                               int jitterPeriod,
                                                               bool jitterAdd,
                                                               bool robustModel,
-                                                              const std::vector<TrackMarkerPtr>& allMarkers)
+                                                              const std::vector<TrackMarkerPtr>& allMarkers,
+                                                              SolverBatch* batch,
+                                                              const CornerPinData* previous)
 {
-    RectD rodRef = getInputRoDAtTime(refTime);
     RectD rodTime = getInputRoDAtTime(time);
-    int w1 = rodRef.width();
-    int h1 = rodRef.height();
+    int w1 = batch->rodRef.width();
+    int h1 = batch->rodRef.height();
     int w2 = rodTime.width();
     int h2 = rodTime.height();
 
-
-    std::vector<TrackMarkerPtr> markers;
-
-    for (std::size_t i = 0; i < allMarkers.size(); ++i) {
-        if ( allMarkers[i]->isEnabled(time) ) {
-            markers.push_back(allMarkers[i]);
-        }
-    }
     TrackerContextPrivate::CornerPinData data;
     data.rms = 0.;
     data.time = time;
     data.valid = true;
-    assert( !markers.empty() );
-    std::vector<Point> x1, x2;
-    extractSortedPointsFromMarkers(refTime, time, markers, jitterPeriod, jitterAdd, KnobDoublePtr(), &x1, &x2);
+    extractSortedPointsFromMarkers(refTime, time, allMarkers, jitterPeriod, jitterAdd, KnobDoublePtr(), batch);
+    const std::vector<Point>& x1 = batch->x1;
+    const std::vector<Point>& x2 = batch->x2;
     assert( x1.size() == x2.size() );
     if ( x1.empty() ) {
         data.valid = false;
@@ -1962,6 +2063,13 @@ TrackerContextPrivate::computeCornerPinParamsFromTracksAtTime(double refTime,
         return data;
     }
 
+    // The markers did not move since the previous keyframe: its solution is the same
+    if ( checkSameCorrespondencesAsPrevious(batch, previous ? &previous->time : 0, time, rodTime) ) {
+        data = *previous;
+        data.time = time;
+
+        return data;
+    }
 
     if (x1.size() == 1) {
         data.h.setTranslationFromOnePoint( euclideanToHomogenous(x1[0]), euclideanToHomogenous(x2[0]) );
@@ -1985,6 +2093,68 @@ TrackerContextPrivate::computeCornerPinParamsFromTracksAtTime(double refTime,
     return data;
 } // TrackerContextPrivate::computeCornerPinParamsFromTracksAtTime
 
+std::vector<TrackerContextPrivate::TransformData>
+TrackerContextPrivate::computeTransformParamsFromTracksForKeyframes(double refTime,
+                                                                    const std::vector<double>& keyframes,
+                                                                    int jitterPeriod,
+                                                                    bool jitterAdd,
+                                                                    bool robustModel,
+                                                                    const std::vector<TrackMarkerPtr>& allMarkers)
+{
+    KnobDoublePtr centerKnob = center.lock();
+    SolverBatch batch;
+
+    initSolverBatch(refTime, keyframes, allMarkers, jitterPeriod, centerKnob, &batch);
+
+    std::vector<TransformData> ret;
+    ret.reserve( keyframes.size() );
+    for (std::size_t i = 0; i < keyframes.size(); ++i) {
+        ret.push_back( computeTransformParamsFromTracksAtTime(refTime, keyframes[i], jitterPeriod, jitterAdd, robustModel, allMarkers, &batch, i > 0 ? &ret[i - 1] : 0) );
+    }
+
+    return ret;
+}
+
+std::vector<TrackerContextPrivate::CornerPinData>
+TrackerContextPrivate::computeCornerPinParamsFromTracksForKeyframes(double refTime,
+                                                                    const std::vector<double>& keyframes,
+                                                                    int jitterPeriod,
+                                                                    bool jitterAdd,
+                                                                    bool robustModel,
+                                                                    const std::vector<TrackMarkerPtr>& allMarkers)
+{
+    SolverBatch batch;
+
+    initSolverBatch(refTime, keyframes, allMarkers, jitterPeriod, KnobDoublePtr(), &batch);
+
+    std::vector<CornerPinData> ret;
+    ret.reserve( keyframes.size() );
+    for (std::size_t i = 0; i < keyframes.size(); ++i) {
+        ret.push_back( computeCornerPinParamsFromTracksAtTime(refTime, keyframes[i], jitterPeriod, jitterAdd, robustModel, allMarkers, &batch, i > 0 ? &ret[i - 1] : 0) );
+    }
+
+    return ret;
+}
+
+void
+TrackerContextPrivate::splitKeyframesInBatches(const std::set<double>& keyframes,
+                                               std::vector<std::vector<double> >* batches)
+{
+    // Enough batches to keep all threads busy, each one large enough for its keyframes to share their data
+    int nThreads = std::max(1, QThreadPool::globalInstance()->maxThreadCount());
+    int nKeys = (int)keyframes.size();
+    int batchSize = std::max( NATRON_TRACKER_SOLVER_MIN_BATCH_SIZE, (nKeys + nThreads * 4 - 1) / (nThreads * 4) );
+
+    batches->clear();
+    for (std::set<double>::const_iterator it = keyframes.begin(); it != keyframes.end(); ++it) {
+        if ( batches->empty() || ( (int)batches->back().size() >= batchSize ) ) {
+            batches->push_back( std::vector<double>() );
+            batches->back().reserve(batchSize);
+        }
+        batches->back().push_back(*it);
+    }
+}
+
 
 struct CornerPinPoints
 {
@@ -2385,24 +2555,23 @@ TrackerContextPrivate::computeCornerParamsFromTracks()
 {
 #ifndef TRACKER_GENERATE_DATA_SEQUENTIALLY
     lastSolveRequest.tWatcher.reset();
-    lastSolveRequest.cpWatcher.reset( new QFutureWatcher<TrackerContextPrivate::CornerPinData>() );
+    splitKeyframesInBatches(lastSolveRequest.keyframes, &lastSolveRequest.keyframeBatches);
+    lastSolveRequest.cpWatcher.reset( new QFutureWatcher<std::vector<TrackerContextPrivate::CornerPinData> >() );
     QObject::connect( lastSolveRequest.cpWatcher.get(), SIGNAL(finished()), this, SLOT(onCornerPinSolverWatcherFinished()) );
     QObject::connect( lastSolveRequest.cpWatcher.get(), SIGNAL(progressValueChanged(int)), this, SLOT(onCornerPinSolverWatcherProgress(int)) );
-    lastSolveRequest.cpWatcher->setFuture( QtConcurrent::mapped( lastSolveRequest.keyframes, boost::bind(&TrackerContextPrivate::computeCornerPinParamsFromTracksAtTime, this, lastSolveRequest.refTime, _1, lastSolveRequest.jitterPeriod, lastSolveRequest.jitterAdd, lastSolveRequest.robustModel, lastSolveRequest.allMarkers) ) );
+    lastSolveRequest.cpWatcher->setFuture( QtConcurrent::mapped( lastSolveRequest.keyframeBatches, boost::bind(&TrackerContextPrivate::computeCornerPinParamsFromTracksForKeyframes, this, lastSolveRequest.refTime, _1, lastSolveRequest.jitterPeriod, lastSolveRequest.jitterAdd, lastSolveRequest.robustModel, lastSolveRequest.allMarkers) ) );
 #else
     NodePtr thisNode = node.lock();
     QList<CornerPinData> validResults;
     {
-        int nKeys = (int)lastSolveRequest.keyframes.size();
-        int keyIndex = 0;
-        for (std::set<double>::const_iterator it = lastSolveRequest.keyframes.begin(); it != lastSolveRequest.keyframes.end(); ++it, ++keyIndex) {
-            CornerPinData data = computeCornerPinParamsFromTracksAtTime(lastSolveRequest.refTime, *it, lastSolveRequest.jitterPeriod, lastSolveRequest.jitterAdd, lastSolveRequest.robustModel, lastSolveRequest.allMarkers);
-            if (data.valid) {
-                validResults.push_back(data);
+        std::vector<double> keyframes( lastSolveRequest.keyframes.begin(), lastSolveRequest.keyframes.end() );
+        std::vector<CornerPinData> results = computeCornerPinParamsFromTracksForKeyframes(lastSolveRequest.refTime, keyframes, lastSolveRequest.jitterPeriod, lastSolveRequest.jitterAdd, lastSolveRequest.robustModel, lastSolveRequest.allMarkers);
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            if (results[i].valid) {
+                validResults.push_back(results[i]);
             }
-            double progress = (keyIndex + 1) / (double)nKeys;
-            thisNode->getApp()->progressUpdate(thisNode, progress);
         }
+        thisNode->getApp()->progressUpdate(thisNode, 1.);
     }
     computeCornerParamsFromTracksEnd(lastSolveRequest.refTime, lastSolveRequest.maxFittingError, validResults);
 #endif
@@ -2587,41 +2756,55 @@ TrackerContextPrivate::computeTransformParamsFromTracks()
 {
 #ifndef TRACKER_GENERATE_DATA_SEQUENTIALLY
     lastSolveRequest.cpWatcher.reset();
-    lastSolveRequest.tWatcher.reset( new QFutureWatcher<TrackerContextPrivate::TransformData>() );
+    splitKeyframesInBatches(lastSolveRequest.keyframes, &lastSolveRequest.keyframeBatches);
+    lastSolveRequest.tWatcher.reset( new QFutureWatcher<std::vector<TrackerContextPrivate::TransformData> >() );
     QObject::connect( lastSolveRequest.tWatcher.get(), SIGNAL(finished()), this, SLOT(onTransformSolverWatcherFinished()) );
     QObject::connect( lastSolveRequest.tWatcher.get(), SIGNAL(progressValueChanged(int)), this, SLOT(onTransformSolverWatcherProgress(int)) );
-    lastSolveRequest.tWatcher->setFuture( QtConcurrent::mapped( lastSolveRequest.keyframes, boost::bind(&TrackerContextPrivate::computeTransformParamsFromTracksAtTime, this, lastSolveRequest.refTime, _1, lastSolveRequest.jitterPeriod, lastSolveRequest.jitterAdd, lastSolveRequest.robustModel, lastSolveRequest.allMarkers) ) );
+    lastSolveRequest.tWatcher->setFuture( QtConcurrent::mapped( lastSolveRequest.keyframeBatches, boost::bind(&TrackerContextPrivate::computeTransformParamsFromTracksForKeyframes, this, lastSolveRequest.refTime, _1, lastSolveRequest.jitterPeriod, lastSolveRequest.jitterAdd, lastSolveRequest.robustModel, lastSolveRequest.allMarkers) ) );
 #else
     NodePtr thisNode = node.lock();
     QList<TransformData> validResults;
     {
-        int nKeys = lastSolveRequest.keyframes.size();
-        int keyIndex = 0;
-        for (std::set<double>::const_iterator it = lastSolveRequest.keyframes.begin(); it != lastSolveRequest.keyframes.end(); ++it, ++keyIndex) {
-            TransformData data = computeTransformParamsFromTracksAtTime(lastSolveRequest.refTime, *it, lastSolveRequest.jitterPeriod, lastSolveRequest.jitterAdd, lastSolveRequest.robustModel, lastSolveRequest.allMarkers);
-            if (data.valid) {
-                validResults.push_back(data);
+        std::vector<double> keyframes( lastSolveRequest.keyframes.begin(), lastSolveRequest.keyframes.end() );
+        std::vector<TransformData> results = computeTransformParamsFromTracksForKeyframes(lastSolveRequest.refTime, keyframes, lastSolveRequest.jitterPeriod, lastSolveRequest.jitterAdd, lastSolveRequest.robustModel, lastSolveRequest.allMarkers);
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            if (results[i].valid) {
+                validResults.push_back(results[i]);
             }
-            double progress = (keyIndex + 1) / (double)nKeys;
-            thisNode->getApp()->progressUpdate(thisNode, progress);
         }
+        thisNode->getApp()->progressUpdate(thisNode, 1.);
     }
     computeTransformParamsFromTracksEnd(lastSolveRequest.refTime, lastSolveRequest.maxFittingError, validResults);
 #endif
 } // TrackerContextPrivate::computeTransformParamsFromTracks
 
+template <typename DATATYPE>
+static QList<DATATYPE>
+flattenBatchesResults(const QList<std::vector<DATATYPE> >& batchesResults)
+{
+    QList<DATATYPE> ret;
+
+    for (typename QList<std::vector<DATATYPE> >::const_iterator it = batchesResults.begin(); it != batchesResults.end(); ++it) {
+        for (typename std::vector<DATATYPE>::const_iterator it2 = it->begin(); it2 != it->end(); ++it2) {
+            ret.push_back(*it2);
+        }
+    }
+
+    return ret;
+}
+
 void
 TrackerContextPrivate::onCornerPinSolverWatcherFinished()
 {
     assert(lastSolveRequest.cpWatcher);
-    computeCornerParamsFromTracksEnd( lastSolveRequest.refTime, lastSolveRequest.maxFittingError, lastSolveRequest.cpWatcher->future().results() );
+    computeCornerParamsFromTracksEnd( lastSolveRequest.refTime, lastSolveRequest.maxFittingError, flattenBatchesResults( lastSolveRequest.cpWatcher->future().results() ) );
 }
 
 void
 TrackerContextPrivate::onTransformSolverWatcherFinished()
 {
     assert(lastSolveRequest.tWatcher);
-    computeTransformParamsFromTracksEnd( lastSolveRequest.refTime, lastSolveRequest.maxFittingError, lastSolveRequest.tWatcher->future().results() );
+    computeTransformParamsFromTracksEnd( lastSolveRequest.refTime, lastSolveRequest.maxFittingError, flattenBatchesResults( lastSolveRequest.tWatcher->future().results() ) );
 }
 
 void
@@ -2665,6 +2848,7 @@ TrackerContextPrivate::endSolve()
     lastSolveRequest.cpWatcher.reset();
     lastSolveRequest.tWatcher.reset();
     lastSolveRequest.keyframes.clear();
+    lastSolveRequest.keyframeBatches.clear();
     lastSolveRequest.allMarkers.clear();
     setSolverParamsEnabled(true);
     NodePtr n = node.lock();
@@ -30,6 +30,8 @@
 #include "TrackerContext.h"
 
 #include <list>
+#include <set>
+#include <vector>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/utility.hpp>
@@ -359,6 +361,15 @@ public:
 };
 
 
+/**
+ * @brief A correspondence between the reference frame and the solved frame, with the tracking error of the marker
+ **/
+struct PointWithError
+{
+    Point p1, p2;
+    double error;
+};
+
 class TrackerContextPrivate
     : public QObject
 {
@@ -479,8 +490,8 @@ public:
         double rms;
     };
 
-    typedef boost::shared_ptr<QFutureWatcher<CornerPinData> > CornerPinSolverWatcher;
-    typedef boost::shared_ptr<QFutureWatcher<TransformData> > TransformSolverWatcher;
+    typedef boost::shared_ptr<QFutureWatcher<std::vector<CornerPinData> > > CornerPinSolverWatcher;
+    typedef boost::shared_ptr<QFutureWatcher<std::vector<TransformData> > > TransformSolverWatcher;
 
     struct SolveRequest
     {
@@ -488,6 +499,8 @@ public:
         TransformSolverWatcher tWatcher;
         double refTime;
         std::set<double> keyframes;
+        // The keyframes split in batches of consecutive keyframes, solved in parallel
+        std::vector<std::vector<double> > keyframeBatches;
         int jitterPeriod;
         bool jitterAdd;
         bool robustModel;
@@ -627,7 +640,74 @@ public:
                                               double *RMS = 0);
 
     /**
-     * @brief Extracts the values of the center point of the given markers at x1Time and x2Time.
+     * @brief The data shared by the solves of consecutive keyframes: the data at the reference frame, the sampled
+     * centers of the markers and the work allocations.
+     **/
+    struct SolverBatch
+    {
+        // The input RoD at the reference time
+        RectD rodRef;
+
+        // The center of each marker at the reference time, minus the transform center
+        std::vector<Point> refCenters;
+
+        // When the centers are averaged over the jitter period, the center of each marker minus the transform center
+        // sampled at each frame from firstSampleTime, stored as prefix sums so that averaging a window is a subtraction.
+        // Empty if the centers must be read from the knobs.
+        std::vector<std::vector<Point> > centersPrefixSums;
+        int firstSampleTime;
+
+        // Work vectors, allocated once for the whole batch
+        std::vector<PointWithError> pointsWithErrors;
+        std::vector<Point> x1, x2;
+
+        // The correspondences of the previous keyframe: if they did not change, its solution is reused
+        std::vector<Point> previousX1, previousX2;
+        RectD previousRoD;
+        double previousTime;
+        bool hasPrevious;
+
+        SolverBatch()
+            : rodRef()
+            , refCenters()
+            , centersPrefixSums()
+            , firstSampleTime(0)
+            , pointsWithErrors()
+            , x1()
+            , x2()
+            , previousX1()
+            , previousX2()
+            , previousRoD()
+            , previousTime(0.)
+            , hasPrevious(false)
+        {
+        }
+    };
+
+    /**
+     * @brief Initializes the batch used to solve the given keyframes, in increasing order.
+     **/
+    void initSolverBatch(double refTime,
+                         const std::vector<double>& keyframes,
+                         const std::vector<TrackMarkerPtr>& allMarkers,
+                         int jitterPeriod,
+                         const KnobDoublePtr& center,
+                         SolverBatch* batch) const;
+
+    /**
+     * @brief Reads the centers of the markers needed by the given keyframes into the batch: at the reference time,
+     * or over the keyframes and their jitter period if jitterPeriod > 1.
+     **/
+    static void sampleMarkersCenters(double refTime,
+                                     const std::vector<double>& keyframes,
+                                     const std::vector<TrackMarkerPtr>& allMarkers,
+                                     int jitterPeriod,
+                                     const KnobDoublePtr& center,
+                                     SolverBatch* batch);
+
+    /**
+     * @brief Extracts the values of the center point of the enabled markers at x1Time and x2Time to the x1 and x2
+     * vectors of the batch.
      * @param jitterPeriod If jitterPeriod > 1 this is the amount of frames that will be averaged together to add
      * jitter or remove jitter.
      * @param jitterAdd If jitterPeriod > 1 this parameter is disregarded. Otherwise, if jitterAdd is false, then
@@ -637,28 +717,54 @@ public:
      * points to increase shaking/motion
      **/
     static void extractSortedPointsFromMarkers(double x1Time, double x2Time,
-                                               const std::vector<TrackMarkerPtr>& markers,
+                                               const std::vector<TrackMarkerPtr>& allMarkers,
                                                int jitterPeriod,
                                                bool jitterAdd,
                                                const KnobDoublePtr& center,
-                                               std::vector<Point>* x1,
-                                               std::vector<Point>* x2);
-
+                                               SolverBatch* batch);
 
+    /**
+     * @brief Solves the transform at the given time. previous is the result of the previous keyframe of the batch,
+     * if any: it is reused if the correspondences did not change.
+     **/
     TransformData computeTransformParamsFromTracksAtTime(double refTime,
                                                          double time,
                                                          int jitterPeriod,
                                                          bool jitterAdd,
                                                          bool robustModel,
-                                                         const std::vector<TrackMarkerPtr>& allMarkers);
+                                                         const std::vector<TrackMarkerPtr>& allMarkers,
+                                                         SolverBatch* batch,
+                                                         const TransformData* previous);
 
     CornerPinData computeCornerPinParamsFromTracksAtTime(double refTime,
                                                          double time,
                                                          int jitterPeriod,
                                                          bool jitterAdd,
                                                          bool robustModel,
-                                                         const std::vector<TrackMarkerPtr>& allMarkers);
+                                                         const std::vector<TrackMarkerPtr>& allMarkers,
+                                                         SolverBatch* batch,
+                                                         const CornerPinData* previous);
 
+    /**
+     * @brief Solves the given keyframes one after another with the same batch. The solver maps this function
+     * over the batches of keyframes given by splitKeyframesInBatches.
+     **/
+    std::vector<TransformData> computeTransformParamsFromTracksForKeyframes(double refTime,
+                                                                           const std::vector<double>& keyframes,
+                                                                           int jitterPeriod,
+                                                                           bool jitterAdd,
+                                                                           bool robustModel,
+                                                                           const std::vector<TrackMarkerPtr>& allMarkers);
+
+    std::vector<CornerPinData> computeCornerPinParamsFromTracksForKeyframes(double refTime,
+                                                                           const std::vector<double>& keyframes,
+                                                                           int jitterPeriod,
+                                                                           bool jitterAdd,
+                                                                           bool robustModel,
+                                                                           const std::vector<TrackMarkerPtr>& allMarkers);
+
+    static void splitKeyframesInBatches(const std::set<double>& keyframes,
+                                        std::vector<std::vector<double> >* batches);
 
     void resetTransformParamsAnimation();
 
@@ -23,7 +23,13 @@
 // ***** END PYTHON BLOCK *****
 
 #include "TrackerFrameAccessor.h"
+#include "TrackerFrameAccessorPrivate.h"
 
+#include <cstring> // memcpy
+#include <list>
+#include <map>
+
+#include <boost/make_shared.hpp>
 #include <boost/utility.hpp>
 
 GCC_DIAG_OFF(unused-function)
@@ -35,6 +41,8 @@ GCC_DIAG_ON(unused-function)
 GCC_DIAG_ON(unused-parameter)
 
 #include <QtCore/QDebug>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
 
 #include "Engine/AbortableRenderInfo.h"
 #include "Engine/AppInstance.h"
@@ -45,86 +53,12 @@ GCC_DIAG_ON(unused-parameter)
 #include "Engine/Node.h"
 #include "Engine/TrackerContext.h"
 
+// The number of frames whose pyramid is kept in the cache
+#define NATRON_TRACKER_FRAME_ACCESSOR_MAX_FRAMES 8
+
 NATRON_NAMESPACE_ENTER
 
 namespace  {
-struct FrameAccessorCacheKey
-{
-    int frame;
-    int mipMapLevel;
-    mv::FrameAccessor::InputMode mode;
-};
-
-struct CacheKey_compare_less
-{
-    bool operator() (const FrameAccessorCacheKey & lhs,
-                     const FrameAccessorCacheKey & rhs) const
-    {
-        if (lhs.frame < rhs.frame) {
-            return true;
-        } else if (lhs.frame > rhs.frame) {
-            return false;
-        } else {
-            if (lhs.mipMapLevel < rhs.mipMapLevel) {
-                return true;
-            } else if (lhs.mipMapLevel > rhs.mipMapLevel) {
-                return false;
-            } else {
-                if ( (int)lhs.mode < (int)rhs.mode ) {
-                    return true;
-                } else if ( (int)lhs.mode > (int)rhs.mode ) {
-                    return false;
-                } else {
-                    return false;
-                }
-            }
-        }
-    }
-};
-
-
-class MvFloatImage
-    : public libmv::Array3D<float>
-{
-public:
-
-    MvFloatImage()
-        : libmv::Array3D<float>()
-    {
-    }
-
-    MvFloatImage(int height,
-                 int width)
-        : libmv::Array3D<float>(height, width)
-    {
-    }
-
-    MvFloatImage(float* data,
-                 int height,
-                 int width)
-        : libmv::Array3D<float>(data, height, width)
-    {
-    }
-
-    virtual ~MvFloatImage()
-    {
-    }
-};
-
-typedef boost::shared_ptr<MvFloatImage> MvFloatImagePtr;
-
-struct FrameAccessorCacheEntry
-{
-    MvFloatImagePtr image;
-
-    // If null, this is the full image
-    RectI bounds;
-    unsigned int referenceCount;
-};
-
-typedef std::multimap<FrameAccessorCacheKey, FrameAccessorCacheEntry, CacheKey_compare_less > FrameAccessorCache;
-
-
 template <bool doR, bool doG, bool doB>
 void
 natronImageToLibMvFloatImageForChannels(const Image* source,
@@ -203,15 +137,115 @@ natronImageToLibMvFloatImage(bool enabledChannels[3],
         }
     }
 }
+
 } // anon namespace
 
+const FrameAccessorTile*
+FrameAccessorFrame::findTile(unsigned int level,
+                             const RectI& roi) const
+{
+    std::map<unsigned int, FrameAccessorTiles>::const_iterator found = levels.find(level);
+
+    if ( found == levels.end() ) {
+        return 0;
+    }
+    for (FrameAccessorTiles::const_iterator it = found->second.begin(); it != found->second.end(); ++it) {
+        if ( it->requested.contains(roi) ) {
+            return &*it;
+        }
+    }
+
+    return 0;
+}
+
+void
+FrameAccessorTile::downscale(FrameAccessorTile* dst) const
+{
+    dst->requested = requested.downscalePowerOfTwoLargestEnclosed(1);
+    dst->bounds = bounds.downscalePowerOfTwoLargestEnclosed(1);
+    if ( !image || dst->bounds.isNull() ) {
+        dst->bounds.clear();
+
+        return;
+    }
+
+    int w = dst->bounds.width();
+    int h = dst->bounds.height();
+    dst->image = boost::make_shared<MvFloatImage>(h, w);
+
+    const int srcRowElements = bounds.width();
+    const float* srcPixels = image->Data() + (dst->bounds.y1 * 2 - bounds.y1) * srcRowElements + (dst->bounds.x1 * 2 - bounds.x1);
+    float* dstPixels = dst->image->Data();
+    for (int y = 0; y < h; ++y, srcPixels += 2 * srcRowElements) {
+        const float* srcRow = srcPixels;
+        const float* srcNextRow = srcPixels + srcRowElements;
+        for (int x = 0; x < w; ++x, srcRow += 2, srcNextRow += 2, ++dstPixels) {
+            *dstPixels = (srcRow[0] + srcRow[1] + srcNextRow[0] + srcNextRow[1]) * 0.25f;
+        }
+    }
+}
+
+const FrameAccessorTile*
+FrameAccessorFrame::findOrDeriveTile(unsigned int level,
+                                     const RectI& roi)
+{
+    const FrameAccessorTile* tile = findTile(level, roi);
+
+    if ( tile || (level == 0) ) {
+        return tile;
+    }
+
+    const FrameAccessorTile* parent = findOrDeriveTile(level - 1, roi.upscalePowerOfTwo(1));
+    if (!parent) {
+        return 0;
+    }
+
+    FrameAccessorTile derived;
+    parent->downscale(&derived);
+    FrameAccessorTiles& tiles = levels[level];
+    tiles.push_back(derived);
+
+    return &tiles.back();
+}
+
+MvFloatImagePtr
+FrameAccessorTile::extractImage(const RectI& roi) const
+{
+    RectI rect;
+
+    if ( !image || !roi.intersect(bounds, &rect) ) {
+        return MvFloatImagePtr();
+    }
+
+    int w = rect.width();
+    int h = rect.height();
+    MvFloatImagePtr ret = boost::make_shared<MvFloatImage>(h, w);
+    const int srcRowElements = bounds.width();
+    const float* srcPixels = image->Data() + (rect.y1 - bounds.y1) * srcRowElements + (rect.x1 - bounds.x1);
+    float* dstPixels = ret->Data();
+    for (int y = 0; y < h; ++y, srcPixels += srcRowElements, dstPixels += w) {
+        std::memcpy( dstPixels, srcPixels, w * sizeof(float) );
+    }
+
+    return ret;
+}
+
 
 struct TrackerFrameAccessorPrivate
 {
     const TrackerContext* context;
     NodePtr trackerInput;
     mutable QMutex cacheMutex;
+
+    // Signaled when a frame is done rendering
+    QWaitCondition cacheCond;
     FrameAccessorCache cache;
+
+    // The images given to libmv, until it releases them
+    std::map<MvFloatImage*, MvFloatImagePtr> servedImages;
+    U64 accessCount;
+    U64 imagesCount;
+    U64 rendersCount;
     bool enabledChannels[3];
     int formatHeight;
 
@@ -221,7 +255,12 @@ struct TrackerFrameAccessorPrivate
         : context(context)
         , trackerInput()
         , cacheMutex()
+        , cacheCond()
         , cache()
+        , servedImages()
+        , accessCount(0)
+        , imagesCount(0)
+        , rendersCount(0)
         , enabledChannels()
         , formatHeight(formatHeight)
     {
@@ -231,128 +270,74 @@ struct TrackerFrameAccessorPrivate
             this->enabledChannels[i] = enabledChannels[i];
         }
     }
-};
 
-TrackerFrameAccessor::TrackerFrameAccessor(const TrackerContext* context,
-                                           bool enabledChannels[3],
-                                           int formatHeight)
-    : mv::FrameAccessor()
-    , _imp( new TrackerFrameAccessorPrivate(context, enabledChannels, formatHeight) )
-{
-}
-
-TrackerFrameAccessor::~TrackerFrameAccessor()
-{
-}
-
-void
-TrackerFrameAccessor::getEnabledChannels(bool* r,
-                                         bool* g,
-                                         bool* b) const
-{
-    *r = _imp->enabledChannels[0];
-    *g = _imp->enabledChannels[1];
-    *b = _imp->enabledChannels[2];
-}
-
-double
-TrackerFrameAccessor::invertYCoordinate(double yIn,
-                                        double formatHeight)
-{
-    return formatHeight - 1 - yIn;
-}
-
-void
-TrackerFrameAccessor::convertLibMVRegionToRectI(const mv::Region& region,
-                                                int /*formatHeight*/,
-                                                RectI* roi)
-{
-    roi->x1 = region.min(0);
-    roi->x2 = region.max(0);
-    roi->y1 = region.min(1);
-    //roi->y1 = invertYCoordinate(region.max(1), formatHeight);
-    roi->y2 = region.max(1);
-    //roi->y2 = invertYCoordinate(region.min(1), formatHeight);
-}
+    /**
+     * @brief Returns the cache entry of the given frame, creating it if needed. Must be called with cacheMutex locked.
+     **/
+    FrameAccessorFrame& getFrame(int frame);
+
+    /**
+     * @brief Renders the input in roi at level 0 and converts it to grayscale. Must be called without cacheMutex locked.
+     **/
+    bool renderInput(int frame, const RectI& roi, const RectD& precomputedRoD, FrameAccessorTile* tile);
+
+    /**
+     * @brief Renders roi at level 0 of the given frame and adds it to the cache. Must be called with cacheMutex
+     * locked by locker: it is unlocked during the render.
+     **/
+    FrameAccessorFrame& renderFrame(QMutexLocker* locker, int frame, const RectI& roi, const RectD& precomputedRoD, bool* ok);
+};
 
-/*
- * @brief This is called by LibMV to retrieve an image either for reference or as search frame.
- */
-mv::FrameAccessor::Key
-TrackerFrameAccessor::GetImage(int /*clip*/,
-                               int frame,
-                               mv::FrameAccessor::InputMode input_mode,
-                               int downscale,            // Downscale by 2^downscale.
-                               const mv::Region* region,     // Get full image if NULL.
-                               const mv::FrameAccessor::Transform* /*transform*/, // May be NULL.
-                               mv::FloatImage** destination)
+FrameAccessorFrame&
+TrackerFrameAccessorPrivate::getFrame(int frame)
 {
-    // Since libmv only uses MONO images for now we have only optimized for this case, remove and handle properly
-    // other case(s) when they get integrated into libmv.
-    assert(input_mode == mv::FrameAccessor::MONO);
-
-
-    FrameAccessorCacheKey key;
-    key.frame = frame;
-    key.mipMapLevel = downscale;
-    key.mode = input_mode;
-
-    /*
-       Check if a frame exists in the cache with matching key and bounds enclosing the given region
-     */
-    RectI roi;
-    if (region) {
-        convertLibMVRegionToRectI(*region, _imp->formatHeight, &roi);
-
-        QMutexLocker k(&_imp->cacheMutex);
-        std::pair<FrameAccessorCache::iterator, FrameAccessorCache::iterator> range = _imp->cache.equal_range(key);
-        for (FrameAccessorCache::iterator it = range.first; it != range.second; ++it) {
-            if ( (roi.x1 >= it->second.bounds.x1) && (roi.x2 <= it->second.bounds.x2) &&
-                 ( roi.y1 >= it->second.bounds.y1) && ( roi.y2 <= it->second.bounds.y2) ) {
-#ifdef TRACE_LIB_MV
-                qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "Found cached image at frame" << frame << "with RoI x1="
-                         << region->min(0) << "y1=" << region->max(1) << "x2=" << region->max(0) << "y2=" << region->min(1);
-#endif
-                // LibMV is kinda dumb on this we must necessarily copy the data either via CopyFrom or the
-                // assignment constructor:
-                // EDIT: fixed libmv
-                *destination = it->second.image.get();
-                //destination->CopyFrom<float>(*it->second.image);
-                ++it->second.referenceCount;
-
-                return (mv::FrameAccessor::Key)it->second.image.get();
+    // Expects cacheMutex to be locked
+    assert( !cacheMutex.tryLock() );
+
+    FrameAccessorCache::iterator found = cache.find(frame);
+    if ( found == cache.end() ) {
+        // Evict the least recently accessed frame which is not being rendered. Frames are usually tracked
+        // against the previous frame or a keyframe, so only a few of them need to stay in the cache.
+        if ( (int)cache.size() >= NATRON_TRACKER_FRAME_ACCESSOR_MAX_FRAMES ) {
+            FrameAccessorCache::iterator oldest = cache.end();
+            for (FrameAccessorCache::iterator it = cache.begin(); it != cache.end(); ++it) {
+                if ( !it->second.rendering && ( ( oldest == cache.end() ) || (it->second.lastAccess < oldest->second.lastAccess) ) ) {
+                    oldest = it;
+                }
+            }
+            if ( oldest != cache.end() ) {
+                cache.erase(oldest);
             }
         }
+        found = cache.insert( std::make_pair( frame, FrameAccessorFrame() ) ).first;
     }
+    found->second.lastAccess = ++accessCount;
+
+    return found->second;
+}
 
+bool
+TrackerFrameAccessorPrivate::renderInput(int frame,
+                                         const RectI& roi,
+                                         const RectD& precomputedRoD,
+                                         FrameAccessorTile* tile)
+{
     EffectInstancePtr effect;
-    if (_imp->trackerInput) {
-        effect = _imp->trackerInput->getEffectInstance();
+
+    if (trackerInput) {
+        effect = trackerInput->getEffectInstance();
     }
     if (!effect) {
-        return (mv::FrameAccessor::Key)0;
+        return false;
     }
 
-    // Not in accessor cache, call renderRoI
     RenderScale scale;
-    scale.y = scale.x = Image::getScaleFromMipMapLevel( (unsigned int)downscale );
-
-
-    RectD precomputedRoD;
-    if (!region) {
-        bool isProjectFormat;
-        StatusEnum stat = effect->getRegionOfDefinition_public(_imp->trackerInput->getHashValue(), frame, scale, ViewIdx(0), &precomputedRoD, &isProjectFormat);
-        if (stat == eStatusFailed) {
-            return (mv::FrameAccessor::Key)0;
-        }
-        double par = effect->getAspectRatio(-1);
-        precomputedRoD.toPixelEnclosing( (unsigned int)downscale, par, &roi );
-    }
+    scale.y = scale.x = 1.;
 
     std::list<ImagePlaneDesc> components;
     components.push_back( ImagePlaneDesc::getRGBComponents() );
 
-    NodePtr node = _imp->context->getNode();
+    NodePtr node = context->getNode();
     const bool isRenderUserInteraction = true;
     const bool isSequentialRender = false;
     AbortableRenderInfoPtr abortInfo = AbortableRenderInfo::create(false, 0);
@@ -374,7 +359,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
                                               RenderStatsPtr() ); // Stats
     EffectInstance::RenderRoIArgs args( frame,
                                         scale,
-                                        downscale,
+                                        0,
                                         ViewIdx(0),
                                         false,
                                         roi,
@@ -382,31 +367,37 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
                                         components,
                                         eImageBitDepthFloat,
                                         true,
-                                        _imp->context->getNode()->getEffectInstance().get(),
+                                        node->getEffectInstance().get(),
                                         eStorageModeRAM /*returnOpenGLTex*/,
                                         frame);
     std::map<ImagePlaneDesc, ImagePtr> planes;
     EffectInstance::RenderRoIRetCode stat = effect->renderRoI(args, &planes);
+    {
+        QMutexLocker k(&cacheMutex);
+        ++rendersCount;
+    }
     if ( (stat != EffectInstance::eRenderRoIRetCodeOk) || planes.empty() ) {
 #ifdef TRACE_LIB_MV
         qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "Failed to call renderRoI on input at frame" << frame << "with RoI x1="
                  << roi.x1 << "y1=" << roi.y1 << "x2=" << roi.x2 << "y2=" << roi.y2;
 #endif
 
-        return (mv::FrameAccessor::Key)0;
+        return false;
     }
 
     assert( !planes.empty() );
     const ImagePtr& sourceImage = planes.begin()->second;
     RectI sourceBounds = sourceImage->getBounds();
-    RectI intersectedRoI;
-    if ( !roi.intersect(sourceBounds, &intersectedRoI) ) {
+    tile->requested = roi;
+    if ( !roi.intersect(sourceBounds, &tile->bounds) ) {
 #ifdef TRACE_LIB_MV
         qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "RoI does not intersect the source image bounds (RoI x1="
                  << roi.x1 << "y1=" << roi.y1 << "x2=" << roi.x2 << "y2=" << roi.y2 << ")";
 #endif
+        // Keep the tile anyway: there is nothing to render in this area
+        tile->bounds.clear();
 
-        return (mv::FrameAccessor::Key)0;
+        return true;
     }
 
 #ifdef TRACE_LIB_MV
@@ -417,30 +408,225 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
     /*
        Copy the Natron image to the LivMV float image
      */
-    FrameAccessorCacheEntry entry;
-    entry.image = boost::make_shared<MvFloatImage>( intersectedRoI.height(), intersectedRoI.width() );
-    entry.bounds = intersectedRoI;
-    entry.referenceCount = 1;
-    natronImageToLibMvFloatImage(_imp->enabledChannels,
+    tile->image = boost::make_shared<MvFloatImage>( tile->bounds.height(), tile->bounds.width() );
+    natronImageToLibMvFloatImage(enabledChannels,
                                  sourceImage.get(),
-                                 intersectedRoI,
-                                 *entry.image);
-    // we ignore the transform parameter and do it in natronImageToLibMvFloatImage instead
+                                 tile->bounds,
+                                 *tile->image);
+
+    return true;
+} // TrackerFrameAccessorPrivate::renderInput
+
+FrameAccessorFrame&
+TrackerFrameAccessorPrivate::renderFrame(QMutexLocker* locker,
+                                         int frame,
+                                         const RectI& roi,
+                                         const RectD& precomputedRoD,
+                                         bool* ok)
+{
+    getFrame(frame).rendering = true;
+    locker->unlock();
+
+    FrameAccessorTile tile;
+    *ok = renderInput(frame, roi, precomputedRoD, &tile);
+
+    locker->relock();
+    FrameAccessorFrame& f = getFrame(frame);
+    f.rendering = false;
+    if (*ok) {
+        f.levels[0].push_back(tile);
+    }
+    cacheCond.wakeAll();
+
+    return f;
+}
+
+TrackerFrameAccessor::TrackerFrameAccessor(const TrackerContext* context,
+                                           bool enabledChannels[3],
+                                           int formatHeight)
+    : mv::FrameAccessor()
+    , _imp( new TrackerFrameAccessorPrivate(context, enabledChannels, formatHeight) )
+{
+}
+
+TrackerFrameAccessor::~TrackerFrameAccessor()
+{
+#ifdef TRACE_LIB_MV
+    qDebug() << "FrameAccessor:" << _imp->imagesCount << "images served with" << _imp->rendersCount << "renders of the input";
+#endif
+}
 
-    *destination = entry.image.get();
-    //destination->CopyFrom<float>(*entry.image);
+void
+TrackerFrameAccessor::getCacheStatistics(U64* imagesCount,
+                                         U64* rendersCount) const
+{
+    QMutexLocker k(&_imp->cacheMutex);
+
+    *imagesCount = _imp->imagesCount;
+    *rendersCount = _imp->rendersCount;
+}
 
-    //insert into the cache
+void
+TrackerFrameAccessor::getEnabledChannels(bool* r,
+                                         bool* g,
+                                         bool* b) const
+{
+    *r = _imp->enabledChannels[0];
+    *g = _imp->enabledChannels[1];
+    *b = _imp->enabledChannels[2];
+}
+
+void
+TrackerFrameAccessor::setFrameSearchRegion(int frame,
+                                           const RectI& region)
+{
+    QMutexLocker k(&_imp->cacheMutex);
+    FrameAccessorFrame& f = _imp->getFrame(frame);
+
+    if ( !f.findTile(0, region) ) {
+        f.searchRegion = region;
+    }
+}
+
+void
+TrackerFrameAccessor::prefetchFrame(int frame)
+{
+    QMutexLocker k(&_imp->cacheMutex);
+    FrameAccessorFrame& f = _imp->getFrame(frame);
+
+    if ( f.rendering || f.searchRegion.isNull() ) {
+        // Already being rendered, or already in the cache
+        return;
+    }
+    RectI roi = f.searchRegion;
+    f.searchRegion.clear();
+
+    bool ok;
+    _imp->renderFrame( &k, frame, roi, RectD(), &ok );
+}
+
+
+double
+TrackerFrameAccessor::invertYCoordinate(double yIn,
+                                        double formatHeight)
+{
+    return formatHeight - 1 - yIn;
+}
+
+void
+TrackerFrameAccessor::convertLibMVRegionToRectI(const mv::Region& region,
+                                                int /*formatHeight*/,
+                                                RectI* roi)
+{
+    roi->x1 = region.min(0);
+    roi->x2 = region.max(0);
+    roi->y1 = region.min(1);
+    //roi->y1 = invertYCoordinate(region.max(1), formatHeight);
+    roi->y2 = region.max(1);
+    //roi->y2 = invertYCoordinate(region.min(1), formatHeight);
+}
+
+/*
+ * @brief This is called by LibMV to retrieve an image either for reference or as search frame.
+ * All requests for a frame are served from a grayscale pyramid of that frame: the search windows of all markers
+ * are rendered at once at level 0 (see setFrameSearchRegion), and the downscaled levels are derived from it.
+ */
+mv::FrameAccessor::Key
+TrackerFrameAccessor::GetImage(int /*clip*/,
+                               int frame,
+                               mv::FrameAccessor::InputMode input_mode,
+                               int downscale,            // Downscale by 2^downscale.
+                               const mv::Region* region,     // Get full image if NULL.
+                               const mv::FrameAccessor::Transform* /*transform*/, // May be NULL.
+                               mv::FloatImage** destination)
+{
+    // Since libmv only uses MONO images for now we have only optimized for this case, remove and handle properly
+    // other case(s) when they get integrated into libmv.
+    assert(input_mode == mv::FrameAccessor::MONO);
+    Q_UNUSED(input_mode);
+
+    const unsigned int level = (unsigned int)downscale;
+    RectI roi;
+    RectD precomputedRoD;
+    if (region) {
+        convertLibMVRegionToRectI(*region, _imp->formatHeight, &roi);
+    } else {
+        EffectInstancePtr effect;
+        if (_imp->trackerInput) {
+            effect = _imp->trackerInput->getEffectInstance();
+        }
+        if (!effect) {
+            return (mv::FrameAccessor::Key)0;
+        }
+        RenderScale scale;
+        scale.y = scale.x = 1.;
+        bool isProjectFormat;
+        StatusEnum stat = effect->getRegionOfDefinition_public(_imp->trackerInput->getHashValue(), frame, scale, ViewIdx(0), &precomputedRoD, &isProjectFormat);
+        if (stat == eStatusFailed) {
+            return (mv::FrameAccessor::Key)0;
+        }
+        double par = effect->getAspectRatio(-1);
+        precomputedRoD.toPixelEnclosing( level, par, &roi );
+    }
+
+    MvFloatImagePtr image;
     {
         QMutexLocker k(&_imp->cacheMutex);
-        _imp->cache.insert( std::make_pair(key, entry) );
+        ++_imp->imagesCount;
+
+        bool found = false;
+        for (;;) {
+            FrameAccessorFrame& f = _imp->getFrame(frame);
+            const FrameAccessorTile* tile = f.findOrDeriveTile(level, roi);
+            if (tile) {
+                image = tile->extractImage(roi);
+                found = true;
+                break;
+            }
+            if (!f.rendering) {
+                break;
+            }
+            // Another thread is rendering this frame, it most likely covers the requested area
+            _imp->cacheCond.wait(&_imp->cacheMutex);
+        }
+
+        if (!found) {
+            // Render the requested area at level 0 and merge it with the search windows of all the other markers
+            // at this frame, so that their requests are served by this render.
+            FrameAccessorFrame& f = _imp->getFrame(frame);
+            RectI renderRoI = roi.upscalePowerOfTwo(level);
+            if ( !f.searchRegion.isNull() ) {
+                renderRoI.merge(f.searchRegion);
+                f.searchRegion.clear();
+            }
+            bool ok;
+            FrameAccessorFrame& renderedFrame = _imp->renderFrame(&k, frame, renderRoI, precomputedRoD, &ok);
+            if (ok) {
+                const FrameAccessorTile* levelTile = renderedFrame.findOrDeriveTile(level, roi);
+                if (levelTile) {
+                    image = levelTile->extractImage(roi);
+                }
+            }
+        }
+
+        if (image) {
+            _imp->servedImages[image.get()] = image;
+        }
     }
+
+    if (!image) {
 #ifdef TRACE_LIB_MV
-    qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "Rendered frame" << frame << "with RoI x1="
-             << intersectedRoI.x1 << "y1=" << intersectedRoI.y1 << "x2=" << intersectedRoI.x2 << "y2=" << intersectedRoI.y2;
+        qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "No image at frame" << frame << "with RoI x1="
+                 << roi.x1 << "y1=" << roi.y1 << "x2=" << roi.x2 << "y2=" << roi.y2;
 #endif
 
-    return (mv::FrameAccessor::Key)entry.image.get();
+        return (mv::FrameAccessor::Key)0;
+    }
+
+    // we ignore the transform parameter and do it in natronImageToLibMvFloatImage instead
+    *destination = image.get();
+
+    return (mv::FrameAccessor::Key)image.get();
 } // TrackerFrameAccessor::GetImage
 
 
@@ -450,16 +636,7 @@ TrackerFrameAccessor::ReleaseImage(Key key)
     MvFloatImage* imgKey = (MvFloatImage*)key;
     QMutexLocker k(&_imp->cacheMutex);
 
-    for (FrameAccessorCache::iterator it = _imp->cache.begin(); it != _imp->cache.end(); ++it) {
-        if (it->second.image.get() == imgKey) {
-            --it->second.referenceCount;
-            if (!it->second.referenceCount) {
-                _imp->cache.erase(it);
-
-                return;
-            }
-        }
-    }
+    _imp->servedImages.erase(imgKey);
 }
 
 /*
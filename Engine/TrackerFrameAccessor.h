@@ -31,6 +31,7 @@
 #include <boost/scoped_ptr.hpp>
 #endif
 
+#include "Global/GlobalDefines.h"
 #include "Engine/EngineFwd.h"
 
 #include <libmv/autotrack/frame_accessor.h>
@@ -53,6 +54,24 @@ public:
 
     void getEnabledChannels(bool* r, bool* g, bool* b) const;
 
+    /**
+     * @brief Set the area, in pixel coordinates at full scale, covering the search windows of all markers at the given frame.
+     * The first request of an image at this frame renders this whole area, so that the requests of all markers
+     * are served by a single render of the input.
+     **/
+    void setFrameSearchRegion(int frame, const RectI& region);
+
+    /**
+     * @brief Renders the search region of the given frame into the cache, if it is not already there.
+     * This is used to render the next frame while libmv tracks the current one.
+     **/
+    void prefetchFrame(int frame);
+
+    /**
+     * @brief Returns the number of images requested by libmv and the number of renders of the input it took to produce them.
+     * The difference is the number of renders saved by the cache.
+     **/
+    void getCacheStatistics(U64* imagesCount, U64* rendersCount) const;
 
     // Get a possibly-filtered version of a frame of a video. Downscale will
     // cause the input image to get downscaled by 2^downscale for pyramid access.
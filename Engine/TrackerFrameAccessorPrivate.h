@@ -0,0 +1,142 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef TRACKERFRAMEACCESSORPRIVATE_H
+#define TRACKERFRAMEACCESSORPRIVATE_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <map>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#endif
+
+GCC_DIAG_OFF(unused-function)
+GCC_DIAG_OFF(unused-parameter)
+#include <libmv/image/array_nd.h>
+GCC_DIAG_ON(unused-function)
+GCC_DIAG_ON(unused-parameter)
+
+#include "Global/GlobalDefines.h"
+#include "Engine/RectI.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER
+
+class MvFloatImage
+    : public libmv::Array3D<float>
+{
+public:
+
+    MvFloatImage()
+        : libmv::Array3D<float>()
+    {
+    }
+
+    MvFloatImage(int height,
+                 int width)
+        : libmv::Array3D<float>(height, width)
+    {
+    }
+
+    MvFloatImage(float* data,
+                 int height,
+                 int width)
+        : libmv::Array3D<float>(data, height, width)
+    {
+    }
+
+    virtual ~MvFloatImage()
+    {
+    }
+};
+
+typedef boost::shared_ptr<MvFloatImage> MvFloatImagePtr;
+
+/*
+ * A grayscale image of a frame at a given level of the pyramid.
+ * requested is the area that was asked for, bounds is the area actually available, that is the requested
+ * area clipped to the bounds of the input image.
+ */
+struct FrameAccessorTile
+{
+    MvFloatImagePtr image;
+    RectI requested;
+    RectI bounds;
+
+    /**
+     * @brief Box-filters this tile to the next level of the pyramid. Only the complete 2x2 blocks of this tile are kept.
+     **/
+    void downscale(FrameAccessorTile* dst) const;
+
+    /**
+     * @brief Copies the part of this tile within roi to a new image, since libmv expects an image of the size of the
+     * region it requested. Returns NULL if this tile does not contain anything in roi.
+     **/
+    MvFloatImagePtr extractImage(const RectI& roi) const;
+};
+
+typedef std::list<FrameAccessorTile> FrameAccessorTiles;
+
+struct FrameAccessorFrame
+{
+    // The tiles of each level of the pyramid: the tiles of level 0 are rendered, the others are derived from them
+    std::map<unsigned int, FrameAccessorTiles> levels;
+
+    // The area at level 0 covering the search windows of all markers at this frame, rendered at once on the first request
+    RectI searchRegion;
+
+    // True while a thread renders this frame: other threads wait for it instead of rendering the same area
+    bool rendering;
+
+    // Used to evict the frames which were not accessed for the longest time
+    U64 lastAccess;
+
+    FrameAccessorFrame()
+        : levels()
+        , searchRegion()
+        , rendering(false)
+        , lastAccess(0)
+    {
+    }
+
+    /**
+     * @brief Returns a tile of the given level whose requested area contains roi, or NULL.
+     **/
+    const FrameAccessorTile* findTile(unsigned int level, const RectI& roi) const;
+
+    /**
+     * @brief Returns a tile of the given level whose requested area contains roi, deriving it from the lower
+     * levels of the pyramid if needed. Returns NULL if level 0 must be rendered first.
+     **/
+    const FrameAccessorTile* findOrDeriveTile(unsigned int level, const RectI& roi);
+};
+
+typedef std::map<int, FrameAccessorFrame> FrameAccessorCache;
+
+NATRON_NAMESPACE_EXIT
+
+#endif // TRACKERFRAMEACCESSORPRIVATE_H
@@ -89,9 +89,11 @@ public:
         , abortInfo()
         , isSequential(false)
         , isPartialRect(false)
+        , isProgressiveTile(false)
         , isViewerPaused(false)
         , recenterViewport(false)
         , viewportCenter()
+        , stats()
     {
     }
 
@@ -153,12 +155,18 @@ public:
     // Is this a marker overlay used when tracking ?
     bool isPartialRect;
 
+    // Is this a partial rect displaying a tile before the whole frame is rendered ?
+    bool isProgressiveTile;
+
     // Is the viewer paused ?
     bool isViewerPaused;
 
     // Should we center the viewer on the viewportCenter
     bool recenterViewport;
     Point viewportCenter;
+
+    // The stats of the render, the time spent uploading the texture is recorded in it
+    RenderStatsPtr stats;
 };
 
 
@@ -180,6 +180,7 @@ ViewerInstance::ViewerInstance(NodePtr node)
     QObject::connect( this, SIGNAL(disconnectTextureRequest(int,bool)), this, SLOT(executeDisconnectTextureRequestOnMainThread(int,bool)) );
     QObject::connect( _imp.get(), SIGNAL(mustRedrawViewer()), this, SLOT(redrawViewer()) );
     QObject::connect( this, SIGNAL(s_callRedrawOnMainThread()), this, SLOT(redrawViewer()) );
+    QObject::connect( _imp.get(), SIGNAL(progressiveTilesAvailable()), _imp.get(), SLOT(onProgressiveTilesAvailable()), Qt::QueuedConnection );
 }
 
 ViewerInstance::~ViewerInstance()
@@ -387,8 +388,9 @@ public:
                                    const NodePtr& rotoPaintNode,
                                    const NodePtr& viewerInput,
                                    bool draftMode,
-                                   const RenderStatsPtr& stats)
-        : ParallelRenderArgsSetter(time, view, isRenderUserInteraction, isSequential, abortInfo, treeRoot, textureIndex, timeline, rotoPaintNode, isAnalysis, draftMode, stats)
+                                   const RenderStatsPtr& stats,
+                                   bool isPrefetch = false)
+        : ParallelRenderArgsSetter(time, view, isRenderUserInteraction, isSequential, abortInfo, treeRoot, textureIndex, timeline, rotoPaintNode, isAnalysis, draftMode, stats, isPrefetch)
         , rotoNode(rotoPaintNode)
         , viewerNode(treeRoot)
         , viewerInputNode()
@@ -401,7 +403,7 @@ public:
             U64 nodeHash = viewerInput->getHashValue();
 
 
-            viewerInput->getEffectInstance()->setParallelRenderArgsTLS(time, view, isRenderUserInteraction, isSequential, nodeHash,  abortInfo, treeRoot, 1, NodeFrameRequestPtr(), _openGLContext.lock(), textureIndex, timeline, isAnalysis, false, NodesList(), viewerInput->getCurrentRenderThreadSafety(), viewerInput->getCurrentOpenGLRenderSupport(), doNanHandling, draftMode, stats);
+            viewerInput->getEffectInstance()->setParallelRenderArgsTLS(time, view, isRenderUserInteraction, isSequential, nodeHash,  abortInfo, treeRoot, 1, NodeFrameRequestPtr(), _openGLContext.lock(), textureIndex, timeline, isAnalysis, false, NodesList(), viewerInput->getCurrentRenderThreadSafety(), viewerInput->getCurrentOpenGLRenderSupport(), doNanHandling, draftMode, stats, isPrefetch);
         }
     }
 
@@ -574,6 +576,7 @@ ViewerInstance::getViewerArgsAndRenderViewer(SequenceTime time,
                 status[i] = renderViewer_internal(view,
                                                   QThread::currentThread() == qApp->thread(), // singleThreaded
                                                   false, // isSequentialRender
+                                                  false, // isPrefetch
                                                   viewerHash,
                                                   canAbort,
                                                   rotoPaintNode,
@@ -608,6 +611,60 @@ ViewerInstance::getViewerArgsAndRenderViewer(SequenceTime time,
     return eViewerRenderRetCodeRender;
 } // ViewerInstance::getViewerArgsAndRenderViewer
 
+bool
+ViewerInstance::prefetchFrame(SequenceTime time,
+                              ViewIdx view,
+                              U64 viewerHash,
+                              const AbortableRenderInfoPtr& abortInfo)
+{
+    if ( !_imp->uiContext || abortInfo->isAborted() ) {
+        return false;
+    }
+
+    // Only the A input is prefetched. The render age of the viewer is not incremented since nothing is displayed.
+    ViewerArgs args;
+    ViewerRenderRetCode stat = getRenderViewerArgsAndCheckCache(time, true, view, 0, viewerHash, NodePtr(), abortInfo, RenderStatsPtr(), &args);
+
+    if ( (stat != eViewerRenderRetCodeRender) || !args.params || args.params->isViewerPaused ) {
+        return false;
+    }
+
+    // Textures that do not go to the ViewerCache would be lost
+    if (args.forceRender || args.userRoIEnabled || args.autoContrast || args.isDoingPartialUpdates) {
+        return false;
+    }
+
+    if ( !args.mustComputeRoDAndLookupCache && ( args.params->nbCachedTile == (int)args.params->tiles.size() ) ) {
+        // Already cached
+        return false;
+    }
+
+    try {
+        stat = renderViewer_internal(view,
+                                     false, // singleThreaded
+                                     true, // isSequentialRender
+                                     true, // isPrefetch
+                                     viewerHash,
+                                     true, // canAbort
+                                     NodePtr(),
+                                     true, // useTLS
+                                     ViewerCurrentFrameRequestSchedulerStartArgsPtr(),
+                                     RenderStatsPtr(),
+                                     args);
+    } catch (...) {
+        stat = eViewerRenderRetCodeFail;
+    }
+    args.isRenderingFlag.reset();
+
+    // Do not hold the cached textures
+    for (std::list<UpdateViewerParams::CachedTile>::iterator it = args.params->tiles.begin(); it != args.params->tiles.end(); ++it) {
+        it->cachedData.reset();
+    }
+    args.params->tiles.clear();
+
+    return stat == eViewerRenderRetCodeRender && !abortInfo->isAborted();
+} // ViewerInstance::prefetchFrame
+
 ViewerInstance::ViewerRenderRetCode
 ViewerInstance::renderViewer(ViewIdx view,
                              bool singleThreaded,
@@ -653,7 +710,7 @@ ViewerInstance::renderViewer(ViewIdx view,
                 }
             }
             if (args[i]) {
-                ret[i] = renderViewer_internal(view, singleThreaded, isSequentialRender, viewerHash, canAbort, rotoPaintNode, useTLS, request,
+                ret[i] = renderViewer_internal(view, singleThreaded, isSequentialRender, false /*isPrefetch*/, viewerHash, canAbort, rotoPaintNode, useTLS, request,
                                                i == 0 ? stats : RenderStatsPtr(),
                                                *args[i]);
 
@@ -944,6 +1001,26 @@ ViewerInstance::setupMinimalUpdateViewerParams(const SequenceTime time,
         outArgs->isDoingPartialUpdates = _imp->isDoingPartialUpdates;
     }
 
+    // Tiles are displayed progressively only for single frame renders: the partial textures are drawn without the
+    // viewer shader, so 32-bit textures which need it are excluded
+    outArgs->progressiveRender = !isSequential && textureIndex == 0 && outArgs->params->depth == eImageBitDepthByte &&
+                                 appPTR->getCurrentSettings()->isViewerProgressiveRenderEnabled();
+    if (outArgs->progressiveRender) {
+        // Start with the tiles under the mouse cursor, or at the center of the viewport if the cursor is outside.
+        // The cursor position can only be read from the main thread
+        RectD viewport = _imp->uiContext->getViewportRect();
+        outArgs->progressiveCenter.x = (viewport.x1 + viewport.x2) / 2.;
+        outArgs->progressiveCenter.y = (viewport.y1 + viewport.y2) / 2.;
+        if ( QThread::currentThread() == qApp->thread() ) {
+            double x, y;
+            _imp->uiContext->getCursorPosition(x, y);
+            if ( viewport.contains(x, y) ) {
+                outArgs->progressiveCenter.x = x;
+                outArgs->progressiveCenter.y = y;
+            }
+        }
+    }
+
     // Fill the gamma LUT if it has never been filled yet
     bool gammaLookupEmpty;
     {
@@ -1291,6 +1368,7 @@ ViewerInstance::getRenderViewerArgsAndCheckCache(SequenceTime time,
 
     // Fetch the render parameters from the Viewer UI
     setupMinimalUpdateViewerParams(time, view, textureIndex, abortInfo, isSequential, outArgs);
+    outArgs->params->stats = stats;
 
     // Try to look-up the cache but do so only if we have a RoD valid in the cache because
 
@@ -1298,10 +1376,64 @@ ViewerInstance::getRenderViewerArgsAndCheckCache(SequenceTime time,
     return getRoDAndLookupCache(true, viewerHash, rotoPaintNode, stats, outArgs);
 }
 
+namespace {
+struct ProgressiveTile
+{
+    double distance;
+    RectI rect;
+};
+
+struct ProgressiveTileCompareDistanceLess
+{
+    bool operator() (const ProgressiveTile& lhs,
+                     const ProgressiveTile& rhs) const
+    {
+        return lhs.distance < rhs.distance;
+    }
+};
+}
+
+void
+ViewerInstance::ViewerInstancePrivate::getProgressiveRenderBatches(const std::list<UpdateViewerParams::CachedTile>& tiles,
+                                                                   const RectI& roi,
+                                                                   double centerX,
+                                                                   double centerY,
+                                                                   std::vector<RectI>* batches)
+{
+    std::vector<ProgressiveTile> sortedTiles;
+
+    for (std::list<UpdateViewerParams::CachedTile>::const_iterator it = tiles.begin(); it != tiles.end(); ++it) {
+        if (it->isCached) {
+            continue;
+        }
+        ProgressiveTile tile;
+        double dx = (it->rect.x1 + it->rect.x2) / 2. - centerX;
+        double dy = (it->rect.y1 + it->rect.y2) / 2. - centerY;
+        tile.distance = dx * dx + dy * dy;
+        tile.rect = it->rect;
+        sortedTiles.push_back(tile);
+    }
+    std::sort( sortedTiles.begin(), sortedTiles.end(), ProgressiveTileCompareDistanceLess() );
+
+    std::size_t batchSize = 1;
+    std::size_t i = 0;
+    while ( i + batchSize < sortedTiles.size() ) {
+        RectI batch = sortedTiles[i].rect;
+        for (std::size_t j = i + 1; j < i + batchSize; ++j) {
+            batch.merge(sortedTiles[j].rect);
+        }
+        batches->push_back(batch);
+        i += batchSize;
+        batchSize *= 2;
+    }
+    batches->push_back(roi);
+}
+
 ViewerInstance::ViewerRenderRetCode
 ViewerInstance::renderViewer_internal(ViewIdx view,
                                       bool singleThreaded,
                                       bool isSequentialRender,
+                                      bool isPrefetch,
                                       U64 viewerHash,
                                       bool /*canAbort*/,
                                       const NodePtr& rotoPaintNode,
@@ -1328,7 +1460,8 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
                                                             rotoPaintNode,
                                                             inArgs.activeInputToRender->getNode(),
                                                             inArgs.draftModeEnabled,
-                                                            stats) );
+                                                            stats,
+                                                            isPrefetch) );
 #else
         frameArgs = boost::make_shared<ViewerParallelRenderArgsSetter>(inArgs.params->time,
                                                                        inArgs.params->view,
@@ -1342,7 +1475,8 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
                                                                        rotoPaintNode,
                                                                        inArgs.activeInputToRender->getNode(),
                                                                        inArgs.draftModeEnabled,
-                                                                       stats);
+                                                                       stats,
+                                                                       isPrefetch);
 #endif
     }
 
@@ -1484,11 +1618,22 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
     }
 
     EffectInstance::NotifyInputNRenderingStarted_RAII inputNIsRendering_RAII(getNode().get(), inArgs.activeInputIndex);
+
+    // In progressive mode the tiles are rendered in batches, each displayed as soon as it is done.
+    // When rendering from the main thread, nothing could be displayed before the end of the render anyway.
+    const bool progressive = inArgs.progressiveRender && useTextureCache && !singleThreaded && !isSequentialRender;
     std::vector<RectI> splitRoi;
     if (inArgs.isDoingPartialUpdates) {
         for (std::list<UpdateViewerParams::CachedTile>::iterator it = inArgs.params->tiles.begin(); it != inArgs.params->tiles.end(); ++it) {
             splitRoi.push_back(it->rect);
         }
+    } else if (progressive) {
+        const double scale = Image::getScaleFromMipMapLevel(inArgs.params->mipMapLevel);
+        ViewerInstancePrivate::getProgressiveRenderBatches(inArgs.params->tiles,
+                                                           roi,
+                                                           inArgs.progressiveCenter.x * scale / inArgs.params->pixelAspectRatio,
+                                                           inArgs.progressiveCenter.y * scale,
+                                                           &splitRoi);
     } else {
         /*
            Just render 1 tile
@@ -1771,7 +1916,12 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
                 return eViewerRenderRetCodeRedraw;
             }
             std::string inputToRenderName = inArgs.activeInputToRender->getNode()->getScriptName_mt_safe();
+            const bool isLastBatch = rectIndex + 1 == splitRoi.size();
             for (std::list<UpdateViewerParams::CachedTile>::iterator it = updateParams->tiles.begin(); it != updateParams->tiles.end(); ++it) {
+                // In progressive mode, skip the tiles rendered by a previous batch and those left for the next ones
+                if ( progressive && !it->isCached && ( it->ramBuffer || ( !isLastBatch && !viewerRenderRoI.contains(it->rect) ) ) ) {
+                    continue;
+                }
                 if (it->isCached) {
                     assert(it->ramBuffer);
                 } else {
@@ -1896,7 +2046,7 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
             }
         } else {
             bool runInCurrentThread = QThreadPool::globalInstance()->activeThreadCount() >= QThreadPool::globalInstance()->maxThreadCount();
-            if ( !runInCurrentThread && (splitRoi.size() > 1) ) {
+            if ( !runInCurrentThread && (splitRoi.size() > 1) && !progressive ) {
                 runInCurrentThread = true;
             }
 
@@ -1977,6 +2127,23 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
             }
         } // if (singleThreaded)
 
+        // Display the tiles of this batch right away, the last one is displayed with the whole frame
+        if ( progressive && (rectIndex + 1 < splitRoi.size()) ) {
+            std::list<UpdateViewerParams::CachedTile> renderedTiles = unCachedTiles;
+            if (rectIndex == 0) {
+                // The cached tiles are displayed along with the first batch
+                for (std::list<UpdateViewerParams::CachedTile>::const_iterator it = updateParams->tiles.begin(); it != updateParams->tiles.end(); ++it) {
+                    if (it->isCached) {
+                        renderedTiles.push_back(*it);
+                    }
+                }
+            }
+            _imp->publishProgressiveTiles(updateParams, renderedTiles);
+        }
+        if ( progressive && stats && stats->isInDepthProfilingEnabled() ) {
+            // Only the first batch is recorded
+            stats->setFirstTileLatencyForNode( getNode() );
+        }
 
         if ( colorImage && stats && stats->isInDepthProfilingEnabled() ) {
             stats->addRenderInfosForNode( getNode(), NodePtr(), colorImage->getComponents().getChannelsLabel(), viewerRenderRoI, viewerRenderTimeRecorder->getTimeSinceCreation() );
@@ -2917,8 +3084,11 @@ ViewerInstance::ViewerInstancePrivate::updateViewer(UpdateViewerParamsPtr params
     bool doUpdate = true;
 
 
-    bool isImageUpToDate = checkAndUpdateDisplayAge( params->textureIndex, params->abortInfo->getRenderAge() );
-    (void)isImageUpToDate;
+    // A tile displayed progressively does not mean that its frame is displayed
+    if (!params->isProgressiveTile) {
+        bool isImageUpToDate = checkAndUpdateDisplayAge( params->textureIndex, params->abortInfo->getRenderAge() );
+        (void)isImageUpToDate;
+    }
 
     // Don't uncomment: if the image was rendered so far, render it to the display texture so that the user get some feedback
    /* if ( !params->isPartialRect && !params->isSequential && !isImageUpToDate) {
@@ -2930,8 +3100,9 @@ ViewerInstance::ViewerInstancePrivate::updateViewer(UpdateViewerParamsPtr params
 
         assert( (params->isPartialRect && params->tiles.size() == 1) || !params->isPartialRect );
 
-        TexturePtr texture;
-        bool isFirstTile = true;
+        // All tiles are uploaded at once so that their copy to the GPU buffer can be shared by several threads
+        std::vector<OpenGLViewerI::TileTransfer> transfers;
+        transfers.reserve( params->tiles.size() );
         for (std::list<UpdateViewerParams::CachedTile>::iterator it = params->tiles.begin(); it != params->tiles.end(); ++it) {
             if (!it->ramBuffer) {
                 continue;
@@ -2940,14 +3111,28 @@ ViewerInstance::ViewerInstancePrivate::updateViewer(UpdateViewerParamsPtr params
             // For cached tiles, some tiles might not have the standard tile, (i.e: the last tile column/row).
             // Since the internal buffer is rounded to the tile size anyway we want the glTexSubImage2D call to ensure
             // that we upload the full internal buffer
-            TextureRect texRect;
-            texRect.par = it->rect.par;
-            texRect.closestPo2 = it->rect.closestPo2;
-            texRect.set(it->rectRounded);
-    
-            assert(params->roi.contains(texRect));
-            uiContext->transferBufferFromRAMtoGPU(it->ramBuffer, it->bytesCount, params->roi, params->roiNotRoundedToTileSize, texRect, params->textureIndex, params->isPartialRect, isFirstTile, &texture);
-            isFirstTile = false;
+            OpenGLViewerI::TileTransfer transfer;
+            transfer.ramBuffer = it->ramBuffer;
+            transfer.bytesCount = it->bytesCount;
+            transfer.rect.par = it->rect.par;
+            transfer.rect.closestPo2 = it->rect.closestPo2;
+            transfer.rect.set(it->rectRounded);
+
+            assert( params->roi.contains(transfer.rect) );
+            transfers.push_back(transfer);
+        }
+
+        TexturePtr texture;
+        {
+            TimeLapse uploadTimer;
+            uiContext->transferBuffersFromRAMtoGPU(transfers, params->roi, params->roiNotRoundedToTileSize, params->textureIndex, params->isPartialRect, &texture);
+            if ( params->stats && params->stats->isInDepthProfilingEnabled() ) {
+                U64 nbBytes = 0;
+                for (std::size_t i = 0; i < transfers.size(); ++i) {
+                    nbBytes += transfers[i].bytesCount;
+                }
+                params->stats->addTextureUploadInfosForNode(instance->getNode(), uploadTimer.getTimeSinceCreation(), nbBytes);
+            }
         }
 
 
@@ -2987,6 +3172,63 @@ ViewerInstance::ViewerInstancePrivate::updateViewer(UpdateViewerParamsPtr params
     //    updateViewerCond.wakeOne();
 } // ViewerInstance::ViewerInstancePrivate::updateViewer
 
+void
+ViewerInstance::ViewerInstancePrivate::publishProgressiveTiles(const UpdateViewerParamsPtr& params,
+                                                               const std::list<UpdateViewerParams::CachedTile>& tiles)
+{
+    if ( tiles.empty() ) {
+        return;
+    }
+    {
+        QMutexLocker k(&progressiveTilesMutex);
+        for (std::list<UpdateViewerParams::CachedTile>::const_iterator it = tiles.begin(); it != tiles.end(); ++it) {
+            // Each tile is a partial rect: the buffer is held by the cache entry of the tile
+            UpdateViewerParamsPtr tileParams = boost::make_shared<UpdateViewerParams>(*params);
+            tileParams->mustFreeRamBuffer = false;
+            tileParams->isPartialRect = true;
+            tileParams->isProgressiveTile = true;
+            tileParams->recenterViewport = false;
+            tileParams->tiles.clear();
+            tileParams->tiles.push_back(*it);
+            progressiveTiles.push_back(tileParams);
+        }
+    }
+    Q_EMIT progressiveTilesAvailable();
+}
+
+void
+ViewerInstance::ViewerInstancePrivate::onProgressiveTilesAvailable()
+{
+    // always running in the main thread
+    assert( qApp && qApp->thread() == QThread::currentThread() );
+
+    std::list<UpdateViewerParamsPtr> tiles;
+    {
+        QMutexLocker k(&progressiveTilesMutex);
+        tiles.swap(progressiveTiles);
+    }
+
+    bool hasUpdated = false;
+    for (std::list<UpdateViewerParamsPtr>::iterator it = tiles.begin(); it != tiles.end(); ++it) {
+        // Ignore the tiles of a frame which was displayed already, or which is older than the displayed frame:
+        // the viewer cleared the partial textures when the frame was displayed
+        {
+            QMutexLocker k(&renderAgeMutex);
+            if ( (*it)->abortInfo->getRenderAge() <= displayAge[(*it)->textureIndex] ) {
+                continue;
+            }
+        }
+        if ( instance->isViewerPaused( (*it)->textureIndex ) ) {
+            continue;
+        }
+        updateViewer(*it);
+        hasUpdated = true;
+    }
+    if (hasUpdated) {
+        redrawViewer();
+    }
+}
+
 bool
 ViewerInstance::isInputOptional(int n) const
 {
@@ -60,6 +60,9 @@ public:
     bool userRoIEnabled;
     bool mustComputeRoDAndLookupCache;
     bool isDoingPartialUpdates;
+    // If true, tiles are displayed as soon as they are rendered, from the closest to progressiveCenter (in canonical coordinates)
+    bool progressiveRender;
+    Point progressiveCenter;
 };
 
 class ViewerInstance
@@ -215,6 +218,18 @@ public:
                                                      ViewerArgsPtr* argsA,
                                                      ViewerArgsPtr* argsB);
 
+    /**
+     * @brief Renders the given frame of the A input in the ViewerCache without displaying it, so that the next
+     * request of the viewer for this frame finds it in the cache. The render is sequential so that it is not
+     * discarded because the timeline is not at the given time, and it stops as soon as abortInfo is aborted.
+     * @returns True if the frame was rendered, false if it was already cached, cannot be cached or the render
+     * was aborted.
+     **/
+    bool prefetchFrame(SequenceTime time,
+                       ViewIdx view,
+                       U64 viewerHash,
+                       const AbortableRenderInfoPtr& abortInfo);
+
     void aboutToUpdateTextures();
 
     void updateViewer(UpdateViewerParamsPtr & frame);
@@ -423,6 +438,7 @@ private:
     ViewerRenderRetCode renderViewer_internal(ViewIdx view,
                                               bool singleThreaded,
                                               bool isSequentialRender,
+                                              bool isPrefetch,
                                               U64 viewerHash,
                                               bool canAbort,
                                               const NodePtr& rotoPaintNode,
@@ -150,6 +150,8 @@ public:
         , viewportCenter()
         , viewportCenterSet(false)
         , isDoingPartialUpdates(false)
+        , progressiveTilesMutex()
+        , progressiveTiles()
         , renderAgeMutex()
         , renderAge()
         , displayAge()
@@ -168,6 +170,25 @@ public:
         Q_EMIT mustRedrawViewer();
     }
 
+    /**
+     * @brief Called by a render thread when tiles of the texture are rendered, before the whole frame is done.
+     * They are displayed by the main thread on top of the current texture until the frame is displayed.
+     **/
+    void publishProgressiveTiles(const UpdateViewerParamsPtr& params,
+                                 const std::list<UpdateViewerParams::CachedTile>& tiles);
+
+    /**
+     * @brief Splits the tiles which are not cached in batches to render one after another, the closest to the given center
+     * (in pixel coordinates) first. The first batch is a single tile so that it is displayed as soon as possible, then
+     * the size of the batches doubles, so that the number of renders stays small. Each batch is the bounding box of its tiles,
+     * and the last one is the whole roi so that all the tiles are rendered as when rendering the roi at once.
+     **/
+    static void getProgressiveRenderBatches(const std::list<UpdateViewerParams::CachedTile>& tiles,
+                                            const RectI& roi,
+                                            double centerX,
+                                            double centerY,
+                                            std::vector<RectI>* batches);
+
 public:
 
     virtual void lock(const FrameEntryPtr& entry) OVERRIDE FINAL
@@ -357,10 +378,17 @@ public Q_SLOTS:
      **/
     void updateViewer(UpdateViewerParamsPtr params);
 
+    /**
+     * @brief Displays the tiles published with publishProgressiveTiles() whose frame was not displayed yet.
+     **/
+    void onProgressiveTilesAvailable();
+
 Q_SIGNALS:
 
     void mustRedrawViewer();
 
+    void progressiveTilesAvailable();
+
 public:
     const ViewerInstance* const instance;
     OpenGLViewerI* uiContext; // written in the main thread before render thread creation, accessed from render thread
@@ -416,6 +444,10 @@ public:
 
     //True if during tracking
     bool isDoingPartialUpdates;
+
+    // The tiles published by the render threads, waiting to be displayed by the main thread
+    QMutex progressiveTilesMutex;
+    std::list<UpdateViewerParamsPtr> progressiveTiles;
     mutable QMutex renderAgeMutex; // protects renderAge lastRenderAge currentRenderAges
     U64 renderAge[2];
     U64 displayAge[2];
@@ -467,6 +467,21 @@ enum StorageModeEnum
     eStorageModeGLTex //< will be allocated as an OpenGL texture
 };
 
+enum CacheEvictionPolicyEnum
+{
+    eCacheEvictionPolicyLRU = 0, //< evict the least recently used entry
+    eCacheEvictionPolicySLRU, //< segmented LRU: entries used only once are evicted before entries used several times
+    eCacheEvictionPolicyCostAware //< evict the entry that was the fastest to render among the least recently used ones
+};
+
+enum RenderPriorityEnum
+{
+    eRenderPriorityInteractive = 0, //< renders of the current frame of a viewer, and analysis such as tracking
+    eRenderPriorityPlayback, //< viewer playback
+    eRenderPriorityPreview, //< node previews and other renders that are not displayed by a viewer
+    eRenderPriorityBackground //< renders of Write nodes and viewer prefetch
+};
+
 enum OrientationEnum
 {
     eOrientationHorizontal = 0x1,
@@ -105,10 +105,26 @@ typedef OfxRangeD RangeD;
 
 #define kBgProcessServerCreatedShort "--bg_server_created"
 
+///these are written on its standard output by a render worker (--worker), followed by the job number
+#define kRenderWorkerJobStartedString "Job started:"
+
+#define kRenderWorkerJobFinishedString "Job finished:"
+
+#define kRenderWorkerJobFailedString "Job failed:"
+
 //Increment this to wipe all disk cache structure and ensure that the user has a clean cache when starting the next version of Natron
 #define NATRON_CACHE_VERSION 4
 #define kNatronCacheVersionSettingsKey "NatronCacheVersionSettingsKey"
 
+//Upper bound of the number of independently locked shards a cache may be split into
+#define NATRON_CACHE_MAX_SHARDS 64
+
+//Maximum share of the records (in %) kept in the protected segment by the SLRU cache eviction policy
+#define NATRON_CACHE_SLRU_PROTECTED_PERCENT 80
+
+//Number of least recently used entries among which the cost-aware cache eviction policy picks the cheapest
+#define NATRON_CACHE_COST_EVICTION_WINDOW 8
+
 
 #define kNodeGraphObjectName "nodeGraph"
 #define kCurveEditorObjectName "curveEditor"
@@ -245,6 +245,17 @@ CurveGui::getInternalCurve() const
     return _internalCurve;
 }
 
+void
+CurveGui::evaluateMany(bool useExpr,
+                       const std::vector<double>& xs,
+                       std::vector<double>* ys) const
+{
+    ys->resize( xs.size() );
+    for (std::size_t i = 0; i < xs.size(); ++i) {
+        (*ys)[i] = evaluate(useExpr, xs[i]);
+    }
+}
+
 static void
 drawLineStrip(const std::vector<float>& vertices,
               const QPointF& btmLeft,
@@ -341,30 +352,43 @@ CurveGui::drawCurve(int curveIndex,
             bool isX1AKey = false;
             KeyFrame x1Key;
             KeyFrameSet::const_iterator lastUpperIt = keyframes.end();
+            // First find the points of the curve to draw, then evaluate all those which are not keyframes at once
+            std::vector<double> xs, ys;
+            std::vector<std::size_t> evaluatedIndices;
 
             while ( x1 < (widgetWidth - 1) ) {
-                double x, y;
+                double x;
                 if (!isX1AKey) {
                     x = _curveWidget->toZoomCoordinates(x1, 0).x();
-                    y = evaluate(false, x);
+                    evaluatedIndices.push_back(vertices.size() + 1);
+                    xs.push_back(x);
+                    vertices.push_back( (float)x );
+                    vertices.push_back(0.f);
                 } else {
                     x = x1Key.getTime();
-                    y = x1Key.getValue();
+                    vertices.push_back( (float)x );
+                    vertices.push_back( (float)x1Key.getValue() );
                 }
 
-                vertices.push_back( (float)x );
-                vertices.push_back( (float)y );
                 nextPointForSegment(x, keyframes, isPeriodic, parametricRange.first, parametricRange.second,  &lastUpperIt, &x2, &x1Key, &isX1AKey);
                 x1 = x2;
             }
             //also add the last point
             {
                 double x = _curveWidget->toZoomCoordinates(x1, 0).x();
-                double y = evaluate(false, x);
+                evaluatedIndices.push_back(vertices.size() + 1);
+                xs.push_back(x);
                 vertices.push_back( (float)x );
-                vertices.push_back( (float)y );
+                vertices.push_back(0.f);
+            }
+
+            evaluateMany(false, xs, &ys);
+            assert( ys.size() == evaluatedIndices.size() );
+            for (std::size_t i = 0; i < evaluatedIndices.size(); ++i) {
+                vertices[evaluatedIndices[i]] = (float)ys[i];
             }
         } catch (...) {
+            vertices.clear();
         }
     }
 
@@ -674,6 +698,25 @@ KnobCurveGui::evaluate(bool useExpr,
     }
 }
 
+void
+KnobCurveGui::evaluateMany(bool useExpr,
+                           const std::vector<double>& xs,
+                           std::vector<double>* ys) const
+{
+    KnobIPtr knob = getInternalKnob();
+
+    KnobParametric* isParametric = dynamic_cast<KnobParametric*>( knob.get() );
+    if (isParametric) {
+        isParametric->getParametricCurve(_dimension)->getValuesAt(xs, ys, false);
+    } else if (useExpr) {
+        CurveGui::evaluateMany(useExpr, xs, ys);
+    } else {
+        assert(_internalCurve);
+
+        _internalCurve->getValuesAt(xs, ys, false);
+    }
+}
+
 CurvePtr
 KnobCurveGui::getInternalCurve() const
 {
@@ -34,8 +34,11 @@
 #include <QCheckBox>
 #include <QItemSelectionModel>
 #include <QtCore/QRegExp>
+#include <QtCore/QStringList>
 
+#include "Engine/AppManager.h"
 #include "Engine/Node.h"
+#include "Engine/TaskScheduler.h"
 #include "Engine/Timer.h"
 #include "Engine/Utils.h" // convertFromPlainText
 #include "Engine/ViewIdx.h"
@@ -64,8 +67,12 @@
 #define COL_NB_CACHE_HIT 13
 #define COL_NB_CACHE_HIT_DOWNSCALED 14
 #define COL_NB_CACHE_MISS 15
+#define COL_NB_ROTO_POLYGON_CACHE_HIT 16
+#define COL_NB_ROTO_POLYGON_CACHE_MISS 17
+#define COL_NB_INPUT_IMAGE_COPIES 18
+#define COL_INPUT_IMAGE_BYTES_COPIED 19
 
-#define NUM_COLS 16
+#define NUM_COLS 20
 
 NATRON_NAMESPACE_ENTER
 
@@ -645,6 +652,132 @@ public:
                 }
             }
         }
+        {
+            TableItem* item = 0;
+            int nb = 0;
+            if (exists) {
+                item = view->item(row, COL_NB_ROTO_POLYGON_CACHE_HIT);
+                if (item) {
+                    nb = item->text().toInt();
+                }
+            } else {
+                item = new TableItem;
+                QString tt = NATRON_NAMESPACE::convertFromPlainText(tr("The number of times the polygon of a Roto shape was found in the cache instead of being evaluated."), NATRON_NAMESPACE::WhiteSpaceNormal);
+                item->setToolTip(tt);
+                item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+            }
+            assert(item);
+            if (item) {
+                int nbPolygonCacheMiss, nbPolygonCacheHits;
+                stats.getRotoPolygonCacheAccessInfos(&nbPolygonCacheMiss, &nbPolygonCacheHits);
+                nb += nbPolygonCacheHits;
+
+                QString str = QString::number(nb);
+                if (nodeUi) {
+                    item->setTextColor(Qt::black);
+                    item->setBackgroundColor(c);
+                }
+                item->setText(str);
+                if (!exists) {
+                    view->setItem(row, COL_NB_ROTO_POLYGON_CACHE_HIT, item);
+                }
+            }
+        }
+        {
+            TableItem* item = 0;
+            int nb = 0;
+            if (exists) {
+                item = view->item(row, COL_NB_ROTO_POLYGON_CACHE_MISS);
+                if (item) {
+                    nb = item->text().toInt();
+                }
+            } else {
+                item = new TableItem;
+                QString tt = NATRON_NAMESPACE::convertFromPlainText(tr("The number of times the polygon of a Roto shape had to be evaluated."), NATRON_NAMESPACE::WhiteSpaceNormal);
+                item->setToolTip(tt);
+                item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+            }
+            assert(item);
+            if (item) {
+                int nbPolygonCacheMiss, nbPolygonCacheHits;
+                stats.getRotoPolygonCacheAccessInfos(&nbPolygonCacheMiss, &nbPolygonCacheHits);
+                nb += nbPolygonCacheMiss;
+
+                QString str = QString::number(nb);
+                if (nodeUi) {
+                    item->setTextColor(Qt::black);
+                    item->setBackgroundColor(c);
+                }
+                item->setText(str);
+                if (!exists) {
+                    view->setItem(row, COL_NB_ROTO_POLYGON_CACHE_MISS, item);
+                }
+            }
+        }
+        {
+            TableItem* item = 0;
+            int nb = 0;
+            if (exists) {
+                item = view->item(row, COL_NB_INPUT_IMAGE_COPIES);
+                if (item) {
+                    nb = item->text().toInt();
+                }
+            } else {
+                item = new TableItem;
+                QString tt = NATRON_NAMESPACE::convertFromPlainText(tr("The number of times an input image had to be copied to give it to the node in the format it expects, instead of the cached image of the input."), NATRON_NAMESPACE::WhiteSpaceNormal);
+                item->setToolTip(tt);
+                item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+            }
+            assert(item);
+            if (item) {
+                int nbInputImageCopies;
+                U64 nbInputImageBytesCopied;
+                stats.getInputImageCopyInfos(&nbInputImageCopies, &nbInputImageBytesCopied);
+                nb += nbInputImageCopies;
+
+                QString str = QString::number(nb);
+                if (nodeUi) {
+                    item->setTextColor(Qt::black);
+                    item->setBackgroundColor(c);
+                }
+                item->setText(str);
+                if (!exists) {
+                    view->setItem(row, COL_NB_INPUT_IMAGE_COPIES, item);
+                }
+            }
+        }
+        {
+            TableItem* item = 0;
+            qulonglong nb = 0;
+            if (exists) {
+                item = view->item(row, COL_INPUT_IMAGE_BYTES_COPIED);
+                if (item) {
+                    nb = item->text().toULongLong();
+                }
+            } else {
+                item = new TableItem;
+                QString tt = NATRON_NAMESPACE::convertFromPlainText(tr("The number of bytes of the copies of the input images."), NATRON_NAMESPACE::WhiteSpaceNormal);
+                item->setToolTip(tt);
+                item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+            }
+            assert(item);
+            if (item) {
+                int nbInputImageCopies;
+                U64 nbInputImageBytesCopied;
+                stats.getInputImageCopyInfos(&nbInputImageCopies, &nbInputImageBytesCopied);
+                nb += nbInputImageBytesCopied;
+
+                QString str = QString::number(nb);
+                if (nodeUi) {
+                    item->setTextColor(Qt::black);
+                    item->setBackgroundColor(c);
+                }
+                item->setText(str);
+                if (!exists) {
+                    view->setItem(row, COL_INPUT_IMAGE_BYTES_COPIED, item);
+                }
+            }
+        }
         if (!exists) {
             rows.push_back(node);
         }
@@ -703,7 +836,12 @@ struct RenderStatsDialogPrivate
     Label* totalTimeSpentDescLabel;
     Label* totalTimeSpentValueLabel;
     double totalSpentTime;
+    Label* firstTileLatencyDescLabel;
+    Label* firstTileLatencyValueLabel;
+    Label* textureUploadDescLabel;
+    Label* textureUploadValueLabel;
     Button* resetButton;
+    Label* queueLatencyLabel;
     QWidget* filterContainer;
     QHBoxLayout* filterLayout;
     Label* filtersLabel;
@@ -729,7 +867,12 @@ struct RenderStatsDialogPrivate
         , totalTimeSpentDescLabel(0)
         , totalTimeSpentValueLabel(0)
         , totalSpentTime(0)
+        , firstTileLatencyDescLabel(0)
+        , firstTileLatencyValueLabel(0)
+        , textureUploadDescLabel(0)
+        , textureUploadValueLabel(0)
         , resetButton(0)
+        , queueLatencyLabel(0)
         , filterContainer(0)
         , filterLayout(0)
         , filtersLabel(0)
@@ -746,6 +889,8 @@ struct RenderStatsDialogPrivate
 
     void editNodeRow(const NodePtr& node, const NodeRenderStats& stats);
 
+    void refreshQueueLatencies();
+
     void updateVisibleRowsInternal(const QString& nameFilter, const QString& pluginIDFilter);
 };
 
@@ -810,6 +955,31 @@ RenderStatsDialog::RenderStatsDialog(Gui* gui)
     _imp->globalInfosLayout->addWidget(_imp->totalTimeSpentDescLabel);
     _imp->globalInfosLayout->addWidget(_imp->totalTimeSpentValueLabel);
 
+    _imp->globalInfosLayout->addSpacing(10);
+
+    QString latencyTt = NATRON_NAMESPACE::convertFromPlainText(tr("When the viewer displays tiles progressively, this is the time between the request of "
+                                                                  "the last frame and the display of its first tile, followed by the time to "
+                                                                  "display the whole frame."), NATRON_NAMESPACE::WhiteSpaceNormal);
+    _imp->firstTileLatencyDescLabel = new Label(tr("Time to first tile:"), _imp->globalInfosContainer);
+    _imp->firstTileLatencyDescLabel->setToolTip(latencyTt);
+    _imp->firstTileLatencyValueLabel = new Label(QString::fromUtf8("-"), _imp->globalInfosContainer);
+    _imp->firstTileLatencyValueLabel->setToolTip(latencyTt);
+
+    _imp->globalInfosLayout->addWidget(_imp->firstTileLatencyDescLabel);
+    _imp->globalInfosLayout->addWidget(_imp->firstTileLatencyValueLabel);
+
+    _imp->globalInfosLayout->addSpacing(10);
+
+    QString uploadTt = NATRON_NAMESPACE::convertFromPlainText(tr("The time spent by the viewer to upload the textures of the last frame "
+                                                                 "to the GPU, followed by their size."), NATRON_NAMESPACE::WhiteSpaceNormal);
+    _imp->textureUploadDescLabel = new Label(tr("Texture upload:"), _imp->globalInfosContainer);
+    _imp->textureUploadDescLabel->setToolTip(uploadTt);
+    _imp->textureUploadValueLabel = new Label(QString::fromUtf8("-"), _imp->globalInfosContainer);
+    _imp->textureUploadValueLabel->setToolTip(uploadTt);
+
+    _imp->globalInfosLayout->addWidget(_imp->textureUploadDescLabel);
+    _imp->globalInfosLayout->addWidget(_imp->textureUploadValueLabel);
+
     _imp->resetButton = new Button(tr("Reset"), _imp->globalInfosContainer);
     _imp->resetButton->setToolTip( tr("Clears the statistics.") );
     QObject::connect( _imp->resetButton, SIGNAL(clicked(bool)), this, SLOT(resetStats()) );
@@ -819,6 +989,13 @@ RenderStatsDialog::RenderStatsDialog(Gui* gui)
 
     _imp->mainLayout->addWidget(_imp->globalInfosContainer);
 
+    _imp->queueLatencyLabel = new Label(this);
+    _imp->queueLatencyLabel->setToolTip( NATRON_NAMESPACE::convertFromPlainText(tr("The median, 90th and 99th percentiles of the time spent by the last "
+                                                                                   "tiles of each kind of render waiting for a thread, "
+                                                                                   "see the Threading tab of the Preferences."), NATRON_NAMESPACE::WhiteSpaceNormal) );
+    _imp->mainLayout->addWidget(_imp->queueLatencyLabel);
+    _imp->refreshQueueLatencies();
+
     _imp->filterContainer = new QWidget(this);
     _imp->filterLayout = new QHBoxLayout(_imp->filterContainer);
 
@@ -890,7 +1067,11 @@ RenderStatsDialog::RenderStatsDialog(Gui* gui)
         << tr("Rendered Planes")
         << tr("Cache Hits")
         << tr("Cache Hits Higher Scale")
-        << tr("Cache Misses");
+        << tr("Cache Misses")
+        << tr("Roto Polygon Cache Hits")
+        << tr("Roto Polygon Cache Misses")
+        << tr("Input Image Copies")
+        << tr("Input Image Bytes Copied");
 
     _imp->view->setColumnCount( dimensionNames.size() );
     _imp->view->setHorizontalHeaderLabels(dimensionNames);
@@ -964,6 +1145,10 @@ RenderStatsDialog::refreshAdvancedColsVisibility()
     _imp->view->setColumnHidden(COL_NB_CACHE_HIT, !checked);
     _imp->view->setColumnHidden(COL_NB_CACHE_HIT_DOWNSCALED, !checked);
     _imp->view->setColumnHidden(COL_NB_CACHE_MISS, !checked);
+    _imp->view->setColumnHidden(COL_NB_ROTO_POLYGON_CACHE_HIT, !checked);
+    _imp->view->setColumnHidden(COL_NB_ROTO_POLYGON_CACHE_MISS, !checked);
+    _imp->view->setColumnHidden(COL_NB_INPUT_IMAGE_COPIES, !checked);
+    _imp->view->setColumnHidden(COL_INPUT_IMAGE_BYTES_COPIED, !checked);
 }
 
 void
@@ -972,6 +1157,42 @@ RenderStatsDialog::resetStats()
     _imp->model->clearRows();
     _imp->totalTimeSpentValueLabel->setText( QString::fromUtf8("0.0 sec") );
     _imp->totalSpentTime = 0;
+    _imp->firstTileLatencyValueLabel->setText( QString::fromUtf8("-") );
+    _imp->textureUploadValueLabel->setText( QString::fromUtf8("-") );
+    TaskScheduler* scheduler = appPTR->getTaskScheduler();
+    if (scheduler) {
+        scheduler->resetQueueLatencies();
+    }
+    _imp->refreshQueueLatencies();
+}
+
+void
+RenderStatsDialogPrivate::refreshQueueLatencies()
+{
+    TaskScheduler* scheduler = appPTR->getTaskScheduler();
+
+    if (!scheduler) {
+        queueLatencyLabel->setText( QString() );
+
+        return;
+    }
+
+    const QString names[NATRON_RENDER_PRIORITIES_COUNT] = {
+        RenderStatsDialog::tr("viewer"), RenderStatsDialog::tr("playback"), RenderStatsDialog::tr("previews"), RenderStatsDialog::tr("Write nodes")
+    };
+    QStringList classes;
+    for (int i = 0; i < NATRON_RENDER_PRIORITIES_COUNT; ++i) {
+        RenderPriorityEnum priority = (RenderPriorityEnum)i;
+        if (scheduler->getQueueLatencySamplesCount(priority) == 0) {
+            classes.push_back( RenderStatsDialog::tr("%1: -").arg(names[i]) );
+        } else {
+            classes.push_back( RenderStatsDialog::tr("%1: %2 / %3 / %4 ms").arg(names[i])
+                               .arg(scheduler->getQueueLatencyPercentile(priority, 50) * 1000., 0, 'f', 2)
+                               .arg(scheduler->getQueueLatencyPercentile(priority, 90) * 1000., 0, 'f', 2)
+                               .arg(scheduler->getQueueLatencyPercentile(priority, 99) * 1000., 0, 'f', 2) );
+        }
+    }
+    queueLatencyLabel->setText( RenderStatsDialog::tr("Tiles waiting time (p50 / p90 / p99): %1").arg( classes.join( QString::fromUtf8(", ") ) ) );
 }
 
 void
@@ -990,8 +1211,21 @@ RenderStatsDialog::addStats(int /*time*/,
 
     for (std::map<NodePtr, NodeRenderStats >::const_iterator it = stats.begin(); it != stats.end(); ++it) {
         _imp->model->editNodeRow(it->first, it->second);
+        double firstTileLatency = it->second.getFirstTileLatency();
+        if (firstTileLatency >= 0) {
+            _imp->firstTileLatencyValueLabel->setText( tr("%1 (full frame: %2)").arg( Timer::printAsTime(firstTileLatency, false) ).arg( Timer::printAsTime(wallTime, false) ) );
+        }
+        int nbTextureUploads;
+        U64 nbTextureBytesUploaded;
+        double textureUploadTime;
+        it->second.getTextureUploadInfos(&nbTextureUploads, &nbTextureBytesUploaded, &textureUploadTime);
+        if (nbTextureUploads > 0) {
+            _imp->textureUploadValueLabel->setText( tr("%1 (%2 MB)").arg( Timer::printAsTime(textureUploadTime, false) ).arg(nbTextureBytesUploaded / (1024. * 1024.), 0, 'f', 1) );
+        }
     }
 
+    _imp->refreshQueueLatencies();
+
     updateVisibleRows();
     if ( !stats.empty() ) {
         _imp->view->header()->setSortIndicator(COL_TIME, Qt::DescendingOrder);
@@ -30,6 +30,13 @@
 #include <cstring> // for std::memcpy, std::memset, std::strcmp, std::strchr
 #include <stdexcept>
 
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+// /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
+#include <boost/bind.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+#endif
+
 #include "Global/GLIncludes.h" //!<must be included before QGlWidget because of gl.h and glew.h
 
 #if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
@@ -48,9 +55,12 @@ GCC_DIAG_UNUSED_PRIVATE_FIELD_OFF
 #include <QtGui/QMouseEvent>
 GCC_DIAG_UNUSED_PRIVATE_FIELD_ON
 #include <QtOpenGL/QGLShaderProgram>
+#include <QtCore/QThreadPool>
+#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
 #include <QTreeWidget>
 #include <QTabBar>
 
+#include "Engine/AppManager.h"
 #include "Engine/Lut.h"
 #include "Engine/Node.h"
 #include "Engine/NodeGuiI.h"
@@ -1557,20 +1567,41 @@ ViewerGL::endTransferBufferFromRAMToGPU(int textureIndex,
     }
 } // ViewerGL::endTransferBufferFromRAMToGPU
 
+// Offsets of the tiles in the PBO are aligned so that the copies and the texture reads never straddle a float
+#define NATRON_VIEWER_PBO_TILE_ALIGNMENT 16
+// Copies smaller than this are not worth dispatching to the thread pool
+#define NATRON_VIEWER_PBO_MIN_COPY_CHUNK_SIZE (1024 * 1024)
+
+namespace {
+struct PboCopyChunk
+{
+    unsigned char* dst;
+    const unsigned char* src;
+    std::size_t bytesCount;
+};
+
 void
-ViewerGL::transferBufferFromRAMtoGPU(const unsigned char* ramBuffer,
-                                     size_t bytesCount,
-                                     const RectI &roiRoundedToTileSize,
-                                     const RectI& roi,
-                                     const TextureRect & tileRect,
-                                     int textureIndex,
-                                     bool isPartialRect,
-                                     bool isFirstTile,
-                                     TexturePtr* texture)
+copyChunkToPbo(const PboCopyChunk& chunk)
+{
+    std::memcpy(chunk.dst, chunk.src, chunk.bytesCount);
+}
+}
+
+void
+ViewerGL::transferBuffersFromRAMtoGPU(const std::vector<TileTransfer>& tiles,
+                                      const RectI &roiRoundedToTileSize,
+                                      const RectI& roi,
+                                      int textureIndex,
+                                      bool isPartialRect,
+                                      TexturePtr* texture)
 {
     // always running in the main thread
     assert( qApp && qApp->thread() == QThread::currentThread() );
     assert( QGLContext::currentContext() == context() );
+    assert( (isPartialRect && tiles.size() == 1) || !isPartialRect );
+    if ( tiles.empty() ) {
+        return;
+    }
     GLenum e = glGetError();
     Q_UNUSED(e);
 
@@ -1581,7 +1612,8 @@ ViewerGL::transferBufferFromRAMtoGPU(const unsigned char* ramBuffer,
         qDebug() << "(ViewerGL::allocateAndMapPBO): Another PBO is currently mapped, glMap failed.";
     }
 
-    // We use 2 PBOs to make use of asynchronous data uploading
+    // We use 2 PBOs to make use of asynchronous data uploading: each update of the viewer
+    // uploads all its tiles from a single PBO, the previous one may still be read by the GPU.
     GLuint pboId = getPboID(_imp->updateViewerPboIndex);
 
     // The bitdepth of the texture
@@ -1606,8 +1638,9 @@ ViewerGL::transferBufferFromRAMtoGPU(const unsigned char* ramBuffer,
             Texture::getRecommendedTexParametersForRGBAByteTexture(&format, &internalFormat, &glType);
         }
         tex.reset( new Texture(GL_TEXTURE_2D, GL_LINEAR, GL_NEAREST, GL_CLAMP_TO_EDGE, dataType, format, internalFormat, glType) );
-        textureRectangle = tileRect;
+        textureRectangle = tiles.front().rect;
     } else {
+        const TextureRect& tileRect = tiles.front().rect;
         // re-use the existing texture if possible
         tex = _imp->displayTextures[textureIndex].texture;
         if (tex->type() != dataType) {
@@ -1618,6 +1651,7 @@ ViewerGL::transferBufferFromRAMtoGPU(const unsigned char* ramBuffer,
                 Texture::getRecommendedTexParametersForRGBAByteTexture(&format, &internalFormat, &glType);
             }
             _imp->displayTextures[textureIndex].texture.reset( new Texture(GL_TEXTURE_2D, GL_LINEAR, GL_NEAREST, GL_CLAMP_TO_EDGE, dataType, format, internalFormat, glType) );
+            tex = _imp->displayTextures[textureIndex].texture;
         }
         textureRectangle.set(roiRoundedToTileSize);
         _imp->displayTextures[textureIndex].roiNotRoundedToTileSize.set(roi);
@@ -1625,9 +1659,16 @@ ViewerGL::transferBufferFromRAMtoGPU(const unsigned char* ramBuffer,
         _imp->displayTextures[textureIndex].roiNotRoundedToTileSize.par = tileRect.par;
         textureRectangle.par = tileRect.par;
         textureRectangle.closestPo2 = tileRect.closestPo2;
-        if (isFirstTile) {
-            tex->ensureTextureHasSize(textureRectangle, 0);
-        }
+        tex->ensureTextureHasSize(textureRectangle, 0);
+    }
+
+    // Lay out the tiles one after another in the PBO
+    std::vector<std::size_t> offsets( tiles.size() );
+    std::size_t pboSize = 0;
+    for (std::size_t i = 0; i < tiles.size(); ++i) {
+        offsets[i] = pboSize;
+        pboSize += tiles[i].bytesCount;
+        pboSize = ( (pboSize + NATRON_VIEWER_PBO_TILE_ALIGNMENT - 1) / NATRON_VIEWER_PBO_TILE_ALIGNMENT ) * NATRON_VIEWER_PBO_TILE_ALIGNMENT;
     }
 
     // bind PBO to update texture source
@@ -1640,26 +1681,58 @@ ViewerGL::transferBufferFromRAMtoGPU(const unsigned char* ramBuffer,
     // If you do that, the previous data in PBO will be discarded and
     // glMapBufferARB() returns a new allocated pointer immediately
     // even if GPU is still working with the previous data.
-    glBufferDataARB(GL_PIXEL_UNPACK_BUFFER_ARB, bytesCount, NULL, GL_DYNAMIC_DRAW_ARB);
+    glBufferDataARB(GL_PIXEL_UNPACK_BUFFER_ARB, pboSize, NULL, GL_STREAM_DRAW_ARB);
 
     // map the buffer object into client's memory
     GLvoid *ret = glMapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, GL_WRITE_ONLY_ARB);
     glCheckError();
     assert(ret);
-    assert(ramBuffer);
-    if (ret && ramBuffer) {
-        // update data directly on the mapped buffer
-        std::memcpy(ret, (void*)ramBuffer, bytesCount);
-        GLboolean result = glUnmapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB); // release the mapped buffer
-        assert(result == GL_TRUE);
-        Q_UNUSED(result);
+    if (!ret) {
+        glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, currentBoundPBO);
+
+        return;
+    }
+
+    // Split the copies in chunks so that a frame made of a few large tiles is also copied by several threads:
+    // the main thread only waits for the copy of the largest chunk instead of the whole frame.
+    std::size_t chunkSize = std::max( (std::size_t)NATRON_VIEWER_PBO_MIN_COPY_CHUNK_SIZE, pboSize / std::max(1, appPTR->getMaxThreadCount()) );
+    std::vector<PboCopyChunk> chunks;
+    for (std::size_t i = 0; i < tiles.size(); ++i) {
+        assert(tiles[i].ramBuffer);
+        if (!tiles[i].ramBuffer) {
+            continue;
+        }
+        for (std::size_t copied = 0; copied < tiles[i].bytesCount; copied += chunkSize) {
+            PboCopyChunk chunk;
+            chunk.dst = (unsigned char*)ret + offsets[i] + copied;
+            chunk.src = tiles[i].ramBuffer + copied;
+            chunk.bytesCount = std::min(chunkSize, tiles[i].bytesCount - copied);
+            chunks.push_back(chunk);
+        }
     }
+    bool runInCurrentThread = QThreadPool::globalInstance()->activeThreadCount() >= QThreadPool::globalInstance()->maxThreadCount();
+    if ( runInCurrentThread || (chunks.size() <= 1) ) {
+        for (std::vector<PboCopyChunk>::const_iterator it = chunks.begin(); it != chunks.end(); ++it) {
+            copyChunkToPbo(*it);
+        }
+    } else {
+        QtConcurrent::map( chunks, boost::bind(&copyChunkToPbo, _1) ).waitForFinished();
+    }
+
+    GLboolean result = glUnmapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB); // release the mapped buffer
+    assert(result == GL_TRUE);
+    Q_UNUSED(result);
     glCheckError();
 
     // copy pixels from PBO to texture object
     // using glBindTexture followed by glTexSubImage2D.
-    // Use offset instead of pointer (last parameter is 0).
-    tex->fillOrAllocateTexture(textureRectangle, tileRect, true, 0);
+    // Use offsets in the PBO instead of pointers.
+    for (std::size_t i = 0; i < tiles.size(); ++i) {
+        if (!tiles[i].ramBuffer) {
+            continue;
+        }
+        tex->fillOrAllocateTexture(textureRectangle, tiles[i].rect, true, (const unsigned char*)0 + offsets[i]);
+    }
 
     // restore previously bound PBO
     glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, currentBoundPBO);
@@ -1669,7 +1742,7 @@ ViewerGL::transferBufferFromRAMtoGPU(const unsigned char* ramBuffer,
     *texture = tex;
 
     _imp->updateViewerPboIndex = (_imp->updateViewerPboIndex + 1) % 2;
-} // ViewerGL::transferBufferFromRAMtoGPU
+} // ViewerGL::transferBuffersFromRAMtoGPU
 
 void
 ViewerGL::clearLastRenderedImage()
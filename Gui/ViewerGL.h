@@ -160,23 +160,20 @@ public:
     virtual bool isViewerUIVisible() const OVERRIDE FINAL WARN_UNUSED_RETURN;
 
     /**
-     *@brief Copies the data stored in the  RAM buffer into the currently
+     *@brief Copies the data stored in the RAM buffers of the tiles into the currently
      * used texture.
      * It does:
-     * 1) glMapBuffer
-     * 2) memcpy to copy data from RAM to GPU
+     * 1) glMapBuffer of a single PBO holding all tiles
+     * 2) memcpy to copy data from RAM to GPU, split across the thread pool
      * 3) glUnmapBuffer
-     * 4) glTexSubImage2D or glTexImage2D depending whether we resize the texture or not.
-     **/
-    virtual void transferBufferFromRAMtoGPU(const unsigned char* ramBuffer,
-                                            size_t bytesCount,
-                                            const RectI &roiRoundedToTileSize,
-                                            const RectI& roi,
-                                            const TextureRect & tileRect,
-                                            int textureIndex,
-                                            bool isPartialRect,
-                                            bool isFirstTile,
-                                            TexturePtr* texture) OVERRIDE FINAL;
+     * 4) glTexSubImage2D or glTexImage2D for each tile depending whether we resize the texture or not.
+     **/
+    virtual void transferBuffersFromRAMtoGPU(const std::vector<TileTransfer>& tiles,
+                                             const RectI &roiRoundedToTileSize,
+                                             const RectI& roi,
+                                             int textureIndex,
+                                             bool isPartialRect,
+                                             TexturePtr* texture) OVERRIDE FINAL;
     virtual void endTransferBufferFromRAMToGPU(int textureIndex,
                                                const TexturePtr& texture,
                                                const ImagePtr& image,
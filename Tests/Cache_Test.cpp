@@ -0,0 +1,413 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstdio>
+#include <list>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QThread>
+
+#include "Engine/Cache.h"
+#include "Engine/Image.h"
+#include "Engine/ImageParams.h"
+#include "Engine/LRUHashTable.h"
+#include "Engine/Timer.h"
+#include "Engine/ViewIdx.h"
+
+NATRON_NAMESPACE_USING
+
+// Number of distinct keys looked-up by the benchmark threads
+#define CACHE_TEST_KEYS_COUNT 1024
+
+// Number of look-ups done by each benchmark thread
+#define CACHE_TEST_LOOKUPS_PER_THREAD 20000
+
+namespace {
+
+ImageKey
+makeTestKey(U64 nodeHash)
+{
+    return ImageKey(0, nodeHash, false, 0, ViewIdx(0), 1., false, false);
+}
+
+ImageParamsPtr
+makeTestParams()
+{
+    RectI bounds(0, 0, 16, 16);
+    RectD rod(0, 0, 16, 16);
+
+    return boost::make_shared<ImageParams>(rod, 1., 0, bounds, eImageBitDepthFloat, eImageFieldingOrderNone, eImagePremultiplicationPremultiplied, false, ImagePlaneDesc::getRGBAComponents(), eStorageModeRAM, GL_TEXTURE_2D);
+}
+
+class CacheLookupThread
+    : public QThread
+{
+    Cache<Image>* _cache;
+    ImageParamsPtr _params;
+    unsigned int _seed;
+    int _nLookups;
+
+public:
+
+    CacheLookupThread(Cache<Image>* cache,
+                      const ImageParamsPtr& params,
+                      unsigned int seed,
+                      int nLookups = CACHE_TEST_LOOKUPS_PER_THREAD)
+        : QThread()
+        , _cache(cache)
+        , _params(params)
+        , _seed(seed)
+        , _nLookups(nLookups)
+    {
+    }
+
+    virtual ~CacheLookupThread()
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        // Simple LCG so that each thread walks the keys in its own order
+        unsigned int state = _seed;
+
+        for (int i = 0; i < _nLookups; ++i) {
+            state = state * 1664525u + 1013904223u;
+            ImagePtr image;
+            _cache->getOrCreate(makeTestKey( (state >> 8) % CACHE_TEST_KEYS_COUNT ), _params, 0, &image);
+        }
+    }
+};
+
+double
+runLookupBenchmark(unsigned int nShards,
+                   int nThreads)
+{
+    Cache<Image> cache("CacheTest", NATRON_CACHE_VERSION, 1024ULL * 1024ULL * 1024ULL, 1., nShards);
+    ImageParamsPtr params = makeTestParams();
+    std::vector<CacheLookupThread*> threads;
+
+    for (int i = 0; i < nThreads; ++i) {
+        threads.push_back( new CacheLookupThread(&cache, params, i + 1) );
+    }
+
+    TimeLapse timer;
+    for (int i = 0; i < nThreads; ++i) {
+        threads[i]->start();
+    }
+    for (int i = 0; i < nThreads; ++i) {
+        threads[i]->wait();
+        delete threads[i];
+    }
+    double elapsed = timer.getTimeElapsedReset();
+
+    cache.clear();
+    cache.waitForDeleterThread();
+
+    return elapsed;
+}
+
+// Inserts nKeys records, looks them up nLookups times in a pseudo-random order and evicts them all
+template <typename CONTAINER>
+double
+runContainerBenchmark(int nKeys,
+                      int nLookups)
+{
+    CONTAINER container;
+    std::vector<boost::shared_ptr<int> > values;
+
+    for (int i = 0; i < nKeys; ++i) {
+        values.push_back( boost::make_shared<int>(i) );
+    }
+
+    TimeLapse timer;
+    for (int i = 0; i < nKeys; ++i) {
+        container.insert( (U64)i * 2654435761ULL, values[i] );
+    }
+    unsigned int state = 1;
+    int found = 0;
+    for (int i = 0; i < nLookups; ++i) {
+        state = state * 1664525u + 1013904223u;
+        if ( container( (U64)( (state >> 8) % nKeys ) * 2654435761ULL ) != container.end() ) {
+            ++found;
+        }
+    }
+    EXPECT_EQ(found, nLookups);
+
+    values.clear();
+    int evicted = 0;
+    while ( container.evict().second ) {
+        ++evicted;
+    }
+    EXPECT_EQ(evicted, nKeys);
+
+    return timer.getTimeElapsedReset();
+}
+
+// The cost of a value is the int it points to
+struct IntValueCost
+{
+    double operator()(const boost::shared_ptr<int> & value) const
+    {
+        return *value;
+    }
+};
+} // anon namespace
+
+TEST(IntrusiveLRUHashTable, LRUOrder)
+{
+    IntrusiveLRUHashTable<U64, boost::shared_ptr<int> > table;
+    boost::shared_ptr<int> a = boost::make_shared<int>(1);
+    boost::shared_ptr<int> b = boost::make_shared<int>(2);
+    boost::shared_ptr<int> c = boost::make_shared<int>(3);
+    boost::shared_ptr<int> d = boost::make_shared<int>(4);
+
+    table.insert(1, a);
+    table.insert(2, b);
+    table.insert(3, c);
+    table.insert(3, d);
+    EXPECT_EQ(table.size(), 3u);
+    EXPECT_EQ(table(3)->second.size(), (std::size_t)2);
+
+    // Entries still referenced outside of the table cannot be evicted
+    EXPECT_FALSE( table.evict().second );
+
+    // Touch 1 so that 2 becomes the least recently used
+    ASSERT_TRUE( table(1) != table.end() );
+    a.reset();
+    b.reset();
+    c.reset();
+    d.reset();
+    EXPECT_EQ(table.evict().first, (U64)2);
+    EXPECT_EQ(table.evict().first, (U64)3);
+    EXPECT_EQ(table.evict().first, (U64)3);
+    EXPECT_EQ(table.evict().first, (U64)1);
+    EXPECT_FALSE( table.evict().second );
+    EXPECT_EQ(table.size(), 0u);
+
+    // Erasing keeps the other records reachable
+    for (U64 i = 0; i < 1000; ++i) {
+        table.insert( i, boost::make_shared<int>( (int)i ) );
+    }
+    for (U64 i = 0; i < 1000; i += 2) {
+        table.erase( table(i) );
+    }
+    for (U64 i = 0; i < 1000; ++i) {
+        EXPECT_EQ( table(i) != table.end(), (i % 2) == 1 );
+    }
+}
+
+TEST(IntrusiveLRUHashTable, SLRUKeepsReusedRecords)
+{
+    IntrusiveLRUHashTable<U64, boost::shared_ptr<int> > table;
+
+    table.setEvictionPolicy(eCacheEvictionPolicySLRU);
+
+    // 1 is used twice, then a sequence of records used once (e.g: a playback) is inserted
+    table.insert( 1, boost::make_shared<int>(1) );
+    ASSERT_TRUE( table(1) != table.end() );
+    for (U64 i = 2; i < 10; ++i) {
+        table.insert( i, boost::make_shared<int>( (int)i ) );
+    }
+
+    // The records used once are evicted first, although 1 is the least recently used
+    for (U64 i = 2; i < 10; ++i) {
+        EXPECT_EQ(table.evict().first, i);
+    }
+    EXPECT_EQ(table.evict().first, (U64)1);
+    EXPECT_FALSE( table.evict().second );
+
+    // Back to LRU, the protected records are kept
+    table.insert( 1, boost::make_shared<int>(1) );
+    table.insert( 2, boost::make_shared<int>(2) );
+    ASSERT_TRUE( table(1) != table.end() );
+    table.setEvictionPolicy(eCacheEvictionPolicyLRU);
+    EXPECT_EQ(table.size(), 2u);
+    EXPECT_EQ(table.evict().first, (U64)2);
+    EXPECT_EQ(table.evict().first, (U64)1);
+}
+
+///The internal look-ups of the cache (peek) do not change the eviction order, only client look-ups do
+TEST(IntrusiveLRUHashTable, PeekKeepsRecency)
+{
+    IntrusiveLRUHashTable<U64, boost::shared_ptr<int> > table;
+
+    table.insert( 1, boost::make_shared<int>(1) );
+    table.insert( 2, boost::make_shared<int>(2) );
+    ASSERT_TRUE( table.peek(1) != table.end() );
+    EXPECT_TRUE( table.peek(3) == table.end() );
+    // Adding a value to an existing record does not touch it either
+    table.insert( 1, boost::make_shared<int>(3) );
+    EXPECT_EQ(table.evict().first, (U64)1);
+    EXPECT_EQ(table.evict().first, (U64)1);
+    EXPECT_EQ(table.evict().first, (U64)2);
+
+    // A peeked record is not promoted to the protected segment
+    table.setEvictionPolicy(eCacheEvictionPolicySLRU);
+    table.insert( 1, boost::make_shared<int>(1) );
+    table.insert( 2, boost::make_shared<int>(2) );
+    ASSERT_TRUE( table.peek(1) != table.end() );
+    ASSERT_TRUE( table(2) != table.end() );
+    EXPECT_EQ(table.evict().first, (U64)1);
+    EXPECT_EQ(table.evict().first, (U64)2);
+}
+
+TEST(IntrusiveLRUHashTable, CostAwareEvictsCheapest)
+{
+    IntrusiveLRUHashTable<U64, boost::shared_ptr<int>, IntValueCost> table;
+
+    table.setEvictionPolicy(eCacheEvictionPolicyCostAware);
+    table.insert( 1, boost::make_shared<int>(5000) );
+    table.insert( 2, boost::make_shared<int>(3) );
+    table.insert( 3, boost::make_shared<int>(40) );
+    EXPECT_EQ(table.evict().first, (U64)2);
+    EXPECT_EQ(table.evict().first, (U64)3);
+    EXPECT_EQ(table.evict().first, (U64)1);
+
+    // Only the NATRON_CACHE_COST_EVICTION_WINDOW least recently used values are candidates
+    table.insert( 1, boost::make_shared<int>(5000) );
+    for (U64 i = 2; i < NATRON_CACHE_COST_EVICTION_WINDOW + 2; ++i) {
+        table.insert( i, boost::make_shared<int>(100) );
+    }
+    table.insert( NATRON_CACHE_COST_EVICTION_WINDOW + 2, boost::make_shared<int>(0) );
+    EXPECT_EQ(table.evict().first, (U64)2);
+}
+
+// Not a pass/fail test: prints the time taken by the previous and the intrusive LRU containers.
+// Disabled by default, run with --gtest_also_run_disabled_tests
+TEST(IntrusiveLRUHashTable, DISABLED_Benchmark)
+{
+    const int nKeys = 100000;
+    const int nLookups = 2000000;
+    double boostTime = runContainerBenchmark<BoostLRUHashTable<U64, boost::shared_ptr<int> > >(nKeys, nLookups);
+    double intrusiveTime = runContainerBenchmark<IntrusiveLRUHashTable<U64, boost::shared_ptr<int> > >(nKeys, nLookups);
+
+    printf("LRU containers: %d keys, %d lookups: BoostLRUHashTable %.3f s, IntrusiveLRUHashTable %.3f s\n", nKeys, nLookups, boostTime, intrusiveTime);
+}
+
+TEST(Cache, ShardedLookupReturnsCreatedEntries)
+{
+    Cache<Image> cache("CacheTest", NATRON_CACHE_VERSION, 1024ULL * 1024ULL * 1024ULL, 1., 16);
+    ImageParamsPtr params = makeTestParams();
+
+    ASSERT_EQ(cache.getShardsCount(), (std::size_t)16);
+
+    std::vector<ImagePtr> created;
+    for (U64 i = 0; i < 256; ++i) {
+        ImagePtr image;
+        EXPECT_FALSE( cache.getOrCreate(makeTestKey(i), params, 0, &image) );
+        ASSERT_TRUE(image);
+        created.push_back(image);
+    }
+
+    for (U64 i = 0; i < 256; ++i) {
+        std::list<ImagePtr> found;
+        ASSERT_TRUE( cache.get(makeTestKey(i), &found) );
+        ASSERT_EQ(found.size(), (std::size_t)1);
+        EXPECT_EQ(found.front(), created[i]);
+    }
+
+    std::list<ImagePtr> copy;
+    cache.getCopy(&copy);
+    EXPECT_EQ(copy.size(), created.size());
+
+    cache.removeEntry(created[0]);
+    std::list<ImagePtr> notFound;
+    EXPECT_FALSE( cache.get(makeTestKey(0), &notFound) );
+
+    created.clear();
+    copy.clear();
+    cache.clear();
+    cache.waitForDeleterThread();
+}
+
+TEST(Cache, ShardCountIsPowerOf2)
+{
+    Cache<Image> single("CacheTest", NATRON_CACHE_VERSION, 0, 1.);
+    EXPECT_EQ(single.getShardsCount(), (std::size_t)1);
+
+    Cache<Image> rounded("CacheTest", NATRON_CACHE_VERSION, 0, 1., 5);
+    EXPECT_EQ(rounded.getShardsCount(), (std::size_t)8);
+
+    Cache<Image> capped("CacheTest", NATRON_CACHE_VERSION, 0, 1., 1000);
+    EXPECT_EQ(capped.getShardsCount(), (std::size_t)NATRON_CACHE_MAX_SHARDS);
+}
+
+///Concurrent look-ups of the same keys on a sharded cache create each entry once
+TEST(Cache, ConcurrentLookups)
+{
+    Cache<Image> cache("CacheTest", NATRON_CACHE_VERSION, 1024ULL * 1024ULL * 1024ULL, 1., 4);
+    ImageParamsPtr params = makeTestParams();
+    std::vector<CacheLookupThread*> threads;
+
+    for (int i = 0; i < 8; ++i) {
+        threads.push_back( new CacheLookupThread(&cache, params, i + 1, 2000) );
+    }
+    for (std::size_t i = 0; i < threads.size(); ++i) {
+        threads[i]->start();
+    }
+    for (std::size_t i = 0; i < threads.size(); ++i) {
+        threads[i]->wait();
+        delete threads[i];
+    }
+
+    std::size_t nFoundKeys = 0;
+    for (U64 i = 0; i < CACHE_TEST_KEYS_COUNT; ++i) {
+        std::list<ImagePtr> found;
+        if ( cache.get(makeTestKey(i), &found) ) {
+            EXPECT_EQ(found.size(), (std::size_t)1);
+            ++nFoundKeys;
+        }
+    }
+    EXPECT_GT(nFoundKeys, (std::size_t)0);
+
+    std::list<ImagePtr> copy;
+    cache.getCopy(&copy);
+    EXPECT_EQ(copy.size(), nFoundKeys);
+
+    copy.clear();
+    cache.clear();
+    cache.waitForDeleterThread();
+}
+
+// Not a pass/fail test: prints the look-up throughput of a single shard vs. a sharded cache
+// for 1 to 64 concurrent threads.
+// Disabled by default, run with --gtest_also_run_disabled_tests
+TEST(Cache, DISABLED_ContentionBenchmark)
+{
+    const unsigned int shardCounts[2] = { 1, 32 };
+
+    for (int nThreads = 1; nThreads <= 64; nThreads *= 2) {
+        for (int s = 0; s < 2; ++s) {
+            double elapsed = runLookupBenchmark(shardCounts[s], nThreads);
+            double lookupsPerSec = elapsed > 0 ? (double)nThreads * CACHE_TEST_LOOKUPS_PER_THREAD / elapsed : 0.;
+            printf("Cache contention: %2d threads, %2u shard(s): %.3f s, %.0f lookups/s\n", nThreads, shardCounts[s], elapsed, lookupsPerSec);
+        }
+    }
+}
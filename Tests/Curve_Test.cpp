@@ -124,3 +124,39 @@ TEST(Curve, Basic)
 }
 
 
+
+TEST(Curve, GetValuesAt)
+{
+    Curve c;
+    std::vector<double> times, values;
+
+    // empty curve
+    times.push_back(-1.);
+    times.push_back(0.5);
+    c.getValuesAt(times, &values);
+    ASSERT_EQ( times.size(), values.size() );
+    EXPECT_EQ( 0., values[0] );
+    EXPECT_EQ( 0., values[1] );
+
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(0., 0., 0., 0., eKeyframeTypeLinear) ) );
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(10., 100., 0., 0., eKeyframeTypeLinear) ) );
+    times.clear();
+    for (int i = -20; i <= 40; ++i) {
+        times.push_back(i * 0.5);
+    }
+    c.getValuesAt(times, &values);
+    ASSERT_EQ( times.size(), values.size() );
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        EXPECT_EQ( c.getValueAt(times[i]), values[i] );
+    }
+
+    // the values must follow the modifications of the curve
+    EXPECT_EQ( 50., c.getValueAt(5.) );
+    c.setYRange(0., 40.);
+    EXPECT_EQ( 40., c.getValueAt(5.) );
+    EXPECT_EQ( 50., c.getValueAt(5., false) );
+    EXPECT_FALSE( c.addKeyFrame( KeyFrame(10., 0., 0., 0., eKeyframeTypeLinear) ) );
+    EXPECT_EQ( 0., c.getValueAt(5.) );
+    c.clearKeyFrames();
+    EXPECT_EQ( 0., c.getValueAt(5.) );
+}
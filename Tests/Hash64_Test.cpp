@@ -90,3 +90,32 @@ TEST(Hash64,
     EXPECT_NE(hash1, hash2);
 } // TEST
 
+
+TEST(Hash64,
+     ContinueFromPrefix)
+{
+    Hash64 prefix;
+
+    for (int i = 0; i < 16; ++i) {
+        prefix.append<int>(i * 7);
+    }
+    prefix.computeHash();
+    ASSERT_TRUE( prefix.valid() );
+
+    Hash64 full;
+    for (int i = 0; i < 16; ++i) {
+        full.append<int>(i * 7);
+    }
+    full.append<double>(0.5);
+    full.append<U64>(42);
+    full.computeHash();
+
+    // A copy of the hash continues from the state of the prefix
+    Hash64 continued = prefix;
+    continued.append<double>(0.5);
+    continued.append<U64>(42);
+    continued.computeHash();
+
+    EXPECT_EQ( full.value(), continued.value() );
+    EXPECT_NE( prefix.value(), continued.value() );
+}
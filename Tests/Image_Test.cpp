@@ -24,10 +24,17 @@
 
 #include "Global/Macros.h"
 
+#include <cstdio>
 #include <cstring>
 #include <gtest/gtest.h>
 
+#include "BaseTest.h"
+
+#include "Engine/AppInstance.h"
+#include "Engine/CPUFeatures.h"
+#include "Engine/EffectInstance.h"
 #include "Engine/Image.h"
+#include "Engine/Timer.h"
 #include "Engine/ViewIdx.h"
 
 NATRON_NAMESPACE_USING
@@ -159,3 +166,168 @@ TEST(ImageKeyTest, Difference) {
     ASSERT_TRUE(keyHash1 != keyHash2);
 }
 
+
+namespace {
+ImagePtr
+createTestImage(const ImagePlaneDesc& comps,
+                ImageBitDepthEnum depth,
+                const RectI& bounds,
+                unsigned int mipMapLevel)
+{
+    RectD rod;
+
+    bounds.toCanonical_noClipping(mipMapLevel, 1., &rod);
+
+    return boost::make_shared<Image>(comps, rod, bounds, mipMapLevel, 1., depth, eImagePremultiplicationPremultiplied, eImageFieldingOrderNone);
+}
+
+std::size_t
+getImageBufferSize(const ImagePtr& img)
+{
+    return (std::size_t)img->getRowElements() * img->getBounds().height() * getSizeOfForBitDepth( img->getBitDepth() );
+}
+
+// Floats are kept in [0,1] so that no NaN payload gets compared
+void
+fillImageRandom(const ImagePtr& img)
+{
+    Image::WriteAccess acc( img.get() );
+    const RectI& bounds = img->getBounds();
+    unsigned char* data = acc.pixelAt(bounds.x1, bounds.y1);
+    std::size_t size = getImageBufferSize(img);
+
+    if (img->getBitDepth() == eImageBitDepthFloat) {
+        float* pix = (float*)data;
+        for (std::size_t i = 0; i < size / sizeof(float); ++i) {
+            // coverity[dont_call]
+            pix[i] = (float)rand() / RAND_MAX;
+        }
+    } else {
+        for (std::size_t i = 0; i < size; ++i) {
+            // coverity[dont_call]
+            data[i] = (unsigned char)(rand() & 0xff);
+        }
+    }
+}
+
+ImagePtr
+halveImage(const ImagePtr& src,
+           SIMDLevelEnum maxLevel)
+{
+    const RectI& srcBounds = src->getBounds();
+    RectI dstBounds = srcBounds.downscalePowerOfTwoSmallestEnclosing(1);
+    ImagePtr dst = createTestImage(src->getComponents(), src->getBitDepth(), dstBounds, 1);
+
+    setMaximumSIMDLevel(maxLevel);
+    src->downscaleMipMap(src->getRoD(), srcBounds, 0, 1, false, dst.get());
+    setMaximumSIMDLevel(eSIMDLevelAVX2);
+
+    return dst;
+}
+} // anon namespace
+
+// The SIMD box-filters must give exactly the same mipmaps as the scalar code
+TEST(ImageTest, HalveSIMDIsBitExact)
+{
+    srand(2000);
+    ImageBitDepthEnum depths[3] = { eImageBitDepthByte, eImageBitDepthShort, eImageBitDepthFloat };
+    ImagePlaneDesc comps[3] = { ImagePlaneDesc::getAlphaComponents(), ImagePlaneDesc::getRGBComponents(), ImagePlaneDesc::getRGBAComponents() };
+    // Odd and negative edges exercise the partial blocks on the borders
+    RectI bounds[3] = { RectI(0, 0, 256, 64), RectI(-3, -7, 517, 101), RectI(1, 1, 40, 12) };
+
+    for (int d = 0; d < 3; ++d) {
+        for (int c = 0; c < 3; ++c) {
+            for (int b = 0; b < 3; ++b) {
+                ImagePtr src = createTestImage(comps[c], depths[d], bounds[b], 0);
+                fillImageRandom(src);
+
+                ImagePtr scalar = halveImage(src, eSIMDLevelNone);
+                ImagePtr simd = halveImage(src, getSupportedSIMDLevel());
+                ASSERT_TRUE( scalar->getBounds() == simd->getBounds() );
+
+                Image::ReadAccess scalarAcc( scalar.get() );
+                Image::ReadAccess simdAcc( simd.get() );
+                const RectI& dstBounds = scalar->getBounds();
+                EXPECT_EQ( 0, memcmp( scalarAcc.pixelAt(dstBounds.x1, dstBounds.y1), simdAcc.pixelAt(dstBounds.x1, dstBounds.y1), getImageBufferSize(scalar) ) )
+                    << "depth " << d << " components " << comps[c].getNumComponents() << " bounds " << b;
+            }
+        }
+    }
+}
+
+// Prints the mipmap halving throughput of 4K and 8K RGBA plates for each instruction set
+TEST(ImageTest, HalveBenchmark)
+{
+    const int nIterations = 3;
+    RectI plates[2] = { RectI(0, 0, 4096, 2160), RectI(0, 0, 8192, 4320) };
+    ImageBitDepthEnum depths[3] = { eImageBitDepthByte, eImageBitDepthShort, eImageBitDepthFloat };
+    const char* depthNames[3] = { "8-bit", "16-bit", "float" };
+    const char* levelNames[3] = { "scalar", "SSE2", "AVX2" };
+
+    for (int p = 0; p < 2; ++p) {
+        for (int d = 0; d < 3; ++d) {
+            ImagePtr src = createTestImage(ImagePlaneDesc::getRGBAComponents(), depths[d], plates[p], 0);
+            fillImageRandom(src);
+            for (int level = eSIMDLevelNone; level <= (int)getSupportedSIMDLevel(); ++level) {
+                // Warm up so that the output buffer allocation is not timed on the first pass only
+                halveImage(src, (SIMDLevelEnum)level);
+                TimeLapse timer;
+                for (int i = 0; i < nIterations; ++i) {
+                    halveImage(src, (SIMDLevelEnum)level);
+                }
+                double seconds = timer.getTimeSinceCreation();
+                double mpix = (double)plates[p].area() * nIterations / 1e6;
+                printf("halve %dx%d %s RGBA, %s: %.1f MPix/s\n", plates[p].width(), plates[p].height(), depthNames[d], levelNames[level], seconds > 0 ? mpix / seconds : 0.);
+            }
+        }
+    }
+}
+
+// A converted input image covers only the requested RoI clipped to the input bounds, with the pixels of the input
+TEST_F(BaseTest, ConvertImageRoI)
+{
+    srand(2000);
+    RectI bounds(-3, -7, 100, 60);
+    ImagePtr rgba = createTestImage(ImagePlaneDesc::getRGBAComponents(), eImageBitDepthFloat, bounds, 0);
+    fillImageRandom(rgba);
+
+    // Nothing to convert: the input image itself
+    EXPECT_EQ( rgba, EffectInstance::convertPlanesFormatsIfNeeded(getApp(), rgba, RectI(10, 5, 50, 200), ImagePlaneDesc::getRGBAComponents(),
+                                                                   eImageBitDepthFloat, false, eImagePremultiplicationOpaque, -1) );
+
+    RectI rois[3] = { RectI(10, 5, 50, 200), RectI(-20, -20, 5, 0), RectI(-3, -7, 100, 60) };
+    for (int r = 0; r < 3; ++r) {
+        RectI expectedBounds;
+        ASSERT_TRUE( rois[r].intersect(bounds, &expectedBounds) );
+
+        // Float to float does not change the values, opaque does not unpremultiply
+        ImagePtr rgb = EffectInstance::convertPlanesFormatsIfNeeded(getApp(), rgba, rois[r], ImagePlaneDesc::getRGBComponents(),
+                                                                    eImageBitDepthFloat, false, eImagePremultiplicationOpaque, -1);
+        ASSERT_TRUE(rgb);
+        ASSERT_NE(rgba, rgb);
+        EXPECT_TRUE( rgb->getBounds() == expectedBounds ) << "roi " << r;
+        EXPECT_EQ( 3, (int)rgb->getComponentsCount() );
+
+        Image::ReadAccess srcAcc( rgba.get() );
+        Image::ReadAccess dstAcc( rgb.get() );
+        int nDiffs = 0;
+        for (int y = expectedBounds.y1; y < expectedBounds.y2; ++y) {
+            for (int x = expectedBounds.x1; x < expectedBounds.x2; ++x) {
+                const float* src = (const float*)srcAcc.pixelAt(x, y);
+                const float* dst = (const float*)dstAcc.pixelAt(x, y);
+                for (int c = 0; c < 3; ++c) {
+                    if (src[c] != dst[c]) {
+                        ++nDiffs;
+                    }
+                }
+            }
+        }
+        EXPECT_EQ(0, nDiffs) << "roi " << r;
+    }
+
+    // A RoI outside of the image converts the whole image
+    ImagePtr rgb = EffectInstance::convertPlanesFormatsIfNeeded(getApp(), rgba, RectI(200, 200, 300, 300), ImagePlaneDesc::getRGBComponents(),
+                                                                eImageBitDepthFloat, false, eImagePremultiplicationOpaque, -1);
+    ASSERT_TRUE(rgb);
+    EXPECT_TRUE( rgb->getBounds() == bounds );
+}
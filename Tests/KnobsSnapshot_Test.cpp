@@ -0,0 +1,191 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <gtest/gtest.h>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/make_shared.hpp>
+#endif
+
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+
+#include "BaseTest.h"
+
+#include "Engine/AbortableRenderInfo.h"
+#include "Engine/Curve.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/KnobsSnapshot.h"
+#include "Engine/Node.h"
+#include "Engine/ParallelRenderArgs.h"
+
+NATRON_NAMESPACE_USING
+
+///The snapshot keeps the values of the knobs at the time it was taken
+TEST_F(BaseTest, KnobsSnapshot)
+{
+    NodePtr node = createNode( QString::fromUtf8(PLUGINID_NATRON_DOT) );
+
+    ASSERT_TRUE(node);
+    EffectInstancePtr effect = node->getEffectInstance();
+    KnobDoublePtr constant = effect->createDoubleKnob("constant", "Constant", 1);
+    KnobDoublePtr animated = effect->createDoubleKnob("animated", "Animated", 1);
+    KnobDoublePtr expression = effect->createDoubleKnob("expression", "Expression", 1);
+    constant->setValue(1.);
+    animated->setValueAtTime(0, 0., ViewSpec::all(), 0);
+    animated->setValueAtTime(10, 10., ViewSpec::all(), 0);
+    expression->setExpression(0, "frame", false, true);
+
+    KnobsSnapshot snapshot(*effect);
+
+    constant->setValue(2.);
+    animated->setValueAtTime(10, 20., ViewSpec::all(), 0);
+
+    const KnobsSnapshot::DimensionValue* value = snapshot.getValue(constant.get(), 0);
+    ASSERT_TRUE(value);
+    EXPECT_FALSE(value->animation);
+    EXPECT_EQ(1., value->value);
+
+    value = snapshot.getValue(animated.get(), 0);
+    ASSERT_TRUE(value);
+    ASSERT_TRUE(value->animation);
+    EXPECT_EQ( 5., value->curve->getValueAt(*value->animation, 5.) );
+    EXPECT_EQ( 10., animated->getValueAtTime(5.) );
+
+    // Expressions are evaluated by the knob
+    EXPECT_FALSE( snapshot.getValue(expression.get(), 0) );
+}
+
+namespace {
+
+///Reads the knobs like a render thread: the knob values are read from the snapshot of the render args set on the thread,
+///the main thread changing the knobs while the render is in progress
+class SnapshotRenderThread
+    : public QThread
+{
+    EffectInstancePtr _effect;
+    KnobDoublePtr _constant;
+    KnobDoublePtr _animated;
+
+public:
+
+    QSemaphore renderStarted, knobsChanged;
+    double constantBefore, constantAfter, constantAfterRender;
+    double animatedBefore, animatedAfter, animatedAfterRender;
+    bool readFromSnapshot, readFromSnapshotAfterRender;
+
+    SnapshotRenderThread(const EffectInstancePtr& effect,
+                         const KnobDoublePtr& constant,
+                         const KnobDoublePtr& animated)
+        : QThread()
+        , _effect(effect)
+        , _constant(constant)
+        , _animated(animated)
+        , renderStarted()
+        , knobsChanged()
+        , constantBefore(0.)
+        , constantAfter(0.)
+        , constantAfterRender(0.)
+        , animatedBefore(0.)
+        , animatedAfter(0.)
+        , animatedAfterRender(0.)
+        , readFromSnapshot(false)
+        , readFromSnapshotAfterRender(false)
+    {
+    }
+
+    virtual ~SnapshotRenderThread()
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        AbortableRenderInfoPtr abortInfo = AbortableRenderInfo::create(false, 0);
+        ParallelRenderArgsPtr args = boost::make_shared<ParallelRenderArgs>();
+
+        args->abortInfo = abortInfo;
+        args->knobsSnapshot = boost::make_shared<KnobsSnapshot>(*_effect);
+        _effect->setParallelRenderArgsTLS(args);
+
+        constantBefore = _constant->getValue();
+        animatedBefore = _animated->getValueAtTime(5.);
+
+        renderStarted.release();
+        knobsChanged.acquire();
+
+        constantAfter = _constant->getValue();
+        animatedAfter = _animated->getValueAtTime(5.);
+        double value;
+        readFromSnapshot = _constant->getValueFromKnobsSnapshot(0., 0, true, &value);
+
+        _effect->invalidateParallelRenderArgsTLS();
+
+        constantAfterRender = _constant->getValue();
+        animatedAfterRender = _animated->getValueAtTime(5.);
+        readFromSnapshotAfterRender = _constant->getValueFromKnobsSnapshot(0., 0, true, &value);
+    }
+};
+}
+
+///During a render the knobs return the values of the snapshot set on the render thread, whatever the main thread does
+TEST_F(BaseTest, KnobsSnapshotDuringRender)
+{
+    NodePtr node = createNode( QString::fromUtf8(PLUGINID_NATRON_DOT) );
+
+    ASSERT_TRUE(node);
+    EffectInstancePtr effect = node->getEffectInstance();
+    KnobDoublePtr constant = effect->createDoubleKnob("constant", "Constant", 1);
+    KnobDoublePtr animated = effect->createDoubleKnob("animated", "Animated", 1);
+    constant->setValue(1.);
+    animated->setValueAtTime(0, 0., ViewSpec::all(), 0);
+    animated->setValueAtTime(10, 10., ViewSpec::all(), 0);
+
+    SnapshotRenderThread thread(effect, constant, animated);
+    thread.start();
+
+    thread.renderStarted.acquire();
+    constant->setValue(2.);
+    animated->setValueAtTime(10, 20., ViewSpec::all(), 0);
+    thread.knobsChanged.release();
+    ASSERT_TRUE( thread.wait() );
+
+    EXPECT_EQ(1., thread.constantBefore);
+    EXPECT_EQ(5., thread.animatedBefore);
+    EXPECT_TRUE(thread.readFromSnapshot);
+    EXPECT_EQ(1., thread.constantAfter);
+    EXPECT_EQ(5., thread.animatedAfter);
+
+    // Once the render is done, the live values are read
+    EXPECT_FALSE(thread.readFromSnapshotAfterRender);
+    EXPECT_EQ(2., thread.constantAfterRender);
+    EXPECT_EQ(10., thread.animatedAfterRender);
+
+    // The main thread never reads the snapshot
+    EXPECT_EQ( 2., constant->getValue() );
+}
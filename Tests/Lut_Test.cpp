@@ -24,9 +24,23 @@
 
 #include "Global/Macros.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
+#include <limits>
+#include <vector>
+
 #include <gtest/gtest.h>
+
+#ifndef Q_MOC_RUN
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+#include <boost/math/special_functions/fpclassify.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+#endif
+
+#include "Engine/CPUFeatures.h"
 #include "Engine/Lut.h"
+#include "Engine/RectI.h"
 
 NATRON_NAMESPACE_USING
 using namespace NATRON_NAMESPACE::Color;
@@ -51,3 +65,148 @@ TEST(Lut, IntConversions) {
         EXPECT_EQ( i, uint8xxToChar( charToUint8xx(i) ) );
     }
 }
+
+namespace {
+struct NamedLut
+{
+    const char* name;
+    const Lut* lut;
+    // max relative error of the batched conversions, relative to max(|value|, 1e-3)
+    double tolerance;
+};
+
+std::vector<NamedLut>
+getBuiltinLuts()
+{
+    std::vector<NamedLut> luts;
+    NamedLut l;
+#define NATRON_ADD_LUT(func, tol) l.name = # func; l.lut = LutManager::func(); l.tolerance = tol; luts.push_back(l);
+    // polynomial approximations
+    NATRON_ADD_LUT(sRGBLut, 1e-5)
+    NATRON_ADD_LUT(Rec709Lut, 1e-5)
+    // table interpolations
+    NATRON_ADD_LUT(CineonLut, 2e-3)
+    NATRON_ADD_LUT(Gamma1_8Lut, 2e-3)
+    NATRON_ADD_LUT(Gamma2_2Lut, 2e-3)
+    NATRON_ADD_LUT(PanalogLut, 2e-3)
+    NATRON_ADD_LUT(ViperLogLut, 2e-3)
+    NATRON_ADD_LUT(REDLogLut, 2e-3)
+    NATRON_ADD_LUT(AlexaV3LogCLut, 2e-3)
+    NATRON_ADD_LUT(SLog1Lut, 2e-3)
+    NATRON_ADD_LUT(SLog2Lut, 2e-3)
+    NATRON_ADD_LUT(SLog3Lut, 2e-3)
+    NATRON_ADD_LUT(VLogLut, 2e-3)
+#undef NATRON_ADD_LUT
+    for (std::size_t i = 0; i < luts.size(); ++i) {
+        luts[i].lut->validate();
+    }
+
+    return luts;
+}
+
+double
+relativeError(float value,
+              float ref)
+{
+    return std::fabs( (double)value - ref ) / std::max( std::fabs( (double)ref ), 1e-3 );
+}
+} // anon namespace
+
+// The batched conversions must stay close to the scalar transfer functions, whatever the instruction set
+TEST(Lut, BatchFloatConversions) {
+    std::vector<float> values;
+    for (int i = 0; i <= 100000; ++i) {
+        values.push_back(-0.1f + 1.7f * i / 100000.f);
+    }
+    // an odd count exercises the tails of the kernels
+    values.push_back(1000.f);
+    values.push_back(1e-20f);
+
+    std::vector<NamedLut> luts = getBuiltinLuts();
+    std::vector<float> converted( values.size() );
+    for (int level = eSIMDLevelNone; level <= (int)getSupportedSIMDLevel(); ++level) {
+        setMaximumSIMDLevel( (SIMDLevelEnum)level );
+        for (std::size_t l = 0; l < luts.size(); ++l) {
+            const Lut* lut = luts[l].lut;
+            lut->fromColorSpaceFloatToLinearFloatBatch( &values[0], &converted[0], (int)values.size() );
+            double maxErrorFrom = 0.;
+            for (std::size_t i = 0; i < values.size(); ++i) {
+                float ref = lut->fromColorSpaceFloatToLinearFloat(values[i]);
+                if ( (boost::math::isfinite)(ref) ) {
+                    maxErrorFrom = std::max( maxErrorFrom, relativeError(converted[i], ref) );
+                }
+            }
+            EXPECT_LE(maxErrorFrom, luts[l].tolerance) << luts[l].name << " from, SIMD level " << level;
+
+            lut->toColorSpaceFloatFromLinearFloatBatch( &values[0], &converted[0], (int)values.size() );
+            double maxErrorTo = 0.;
+            for (std::size_t i = 0; i < values.size(); ++i) {
+                float ref = lut->toColorSpaceFloatFromLinearFloat(values[i]);
+                // the log curves go to -infinity just below 0, where a table cannot follow them
+                if ( (values[i] >= 0.f) && (boost::math::isfinite)(ref) ) {
+                    maxErrorTo = std::max( maxErrorTo, relativeError(converted[i], ref) );
+                }
+            }
+            EXPECT_LE(maxErrorTo, luts[l].tolerance) << luts[l].name << " to, SIMD level " << level;
+        }
+    }
+    setMaximumSIMDLevel(eSIMDLevelAVX2);
+}
+
+TEST(Lut, BatchFloatConversionsKeepNaN) {
+    std::vector<NamedLut> luts = getBuiltinLuts();
+    float values[5] = { 0.5f, std::numeric_limits<float>::quiet_NaN(), 0.25f, 0.75f, std::numeric_limits<float>::quiet_NaN() };
+    float converted[5];
+
+    for (int level = eSIMDLevelNone; level <= (int)getSupportedSIMDLevel(); ++level) {
+        setMaximumSIMDLevel( (SIMDLevelEnum)level );
+        for (std::size_t l = 0; l < luts.size(); ++l) {
+            luts[l].lut->toColorSpaceFloatFromLinearFloatBatch(values, converted, 5);
+            EXPECT_TRUE( (boost::math::isnan)(converted[1]) && (boost::math::isnan)(converted[4]) ) << luts[l].name;
+            EXPECT_FALSE( (boost::math::isnan)(converted[0]) ) << luts[l].name;
+        }
+    }
+    setMaximumSIMDLevel(eSIMDLevelAVX2);
+}
+
+// The packed conversions go through the batched ones: check them against per pixel conversions
+TEST(Lut, PackedConversions) {
+    const Lut* lut = LutManager::sRGBLut();
+    const int width = 37;
+    const int height = 5;
+    RectI bounds(0, 0, width, height);
+    std::vector<float> linear(width * height * 4);
+
+    srand(2000);
+    for (std::size_t i = 0; i < linear.size(); ++i) {
+        // coverity[dont_call]
+        linear[i] = (float)rand() / RAND_MAX;
+    }
+
+    // linear RGBA -> premultiplied sRGB bytes, dithered by at most 1
+    std::vector<unsigned char> bytes(width * height * 4);
+    lut->to_byte_packed(&bytes[0], &linear[0], bounds, bounds, bounds, ePixelPackingRGBA, ePixelPackingRGBA, true, true);
+    for (int y = 0; y < height; ++y) {
+        const float* src = &linear[(height - 1 - y) * width * 4];
+        const unsigned char* dst = &bytes[y * width * 4];
+        for (int x = 0; x < width; ++x) {
+            for (int k = 0; k < 3; ++k) {
+                int ref = lut->toColorSpaceUint8FromLinearFloatFast(src[x * 4 + k] * src[x * 4 + 3]);
+                EXPECT_LE(std::abs(ref - dst[x * 4 + k]), 1);
+            }
+            EXPECT_EQ( floatToInt<256>(src[x * 4 + 3]), dst[x * 4 + 3] );
+        }
+    }
+
+    // premultiplied sRGB floats -> linear
+    std::vector<float> converted(width * height * 4);
+    lut->from_float_packed(&converted[0], &linear[0], bounds, bounds, bounds, ePixelPackingRGBA, ePixelPackingRGBA, false, true);
+    for (std::size_t i = 0; i < linear.size(); i += 4) {
+        float a = linear[i + 3];
+        for (int k = 0; k < 3; ++k) {
+            float ref = a > 0.f ? lut->fromColorSpaceFloatToLinearFloat(linear[i + k] / a) * a : 0.f;
+            EXPECT_LE(relativeError(converted[i + k], ref), 1e-5);
+        }
+        EXPECT_EQ(a, converted[i + 3]);
+    }
+}
@@ -0,0 +1,243 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstdio>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "BaseTest.h"
+
+#include "Engine/EffectInstance.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/NativeExpression.h"
+#include "Engine/Node.h"
+#include "Engine/Timer.h"
+
+#define NATIVE_EXPRESSION_TEST_FRAMES_COUNT 2000
+
+NATRON_NAMESPACE_USING
+
+namespace {
+bool
+evaluate(const std::string& expr,
+         double time,
+         double* ret)
+{
+    NativeExpressionPtr native = NativeExpression::compile( expr, KnobIPtr(), 0 );
+
+    return native && native->evaluate(time, ViewIdx(0), ret);
+}
+}
+
+///The arithmetic follows the Python version Natron is built with
+TEST(NativeExpression, Arithmetic)
+{
+    double ret = 0.;
+
+    EXPECT_TRUE( evaluate("frame * 2 + 1", 3, &ret) );
+    EXPECT_EQ(7., ret);
+    EXPECT_TRUE( evaluate("frame / 2", 3.5, &ret) );
+    EXPECT_EQ(1.75, ret);
+    EXPECT_TRUE( evaluate("frame / 2.", 3, &ret) );
+    EXPECT_EQ(1.5, ret);
+    EXPECT_TRUE( evaluate("-7 // 2", 0, &ret) );
+    EXPECT_EQ(-4., ret);
+#if PY_MAJOR_VERSION >= 3
+    // True division, even of an integral frame
+    EXPECT_TRUE( evaluate("frame / 2", 3, &ret) );
+    EXPECT_EQ(1.5, ret);
+    EXPECT_TRUE( evaluate("-7 / 2", 0, &ret) );
+    EXPECT_EQ(-3.5, ret);
+    // Half to even
+    EXPECT_TRUE( evaluate("round(2.5)", 0, &ret) );
+    EXPECT_EQ(2., ret);
+    EXPECT_TRUE( evaluate("round(-2.5) + round(3.5) + round(-0.5)", 0, &ret) );
+    EXPECT_EQ(2., ret);
+    // round returns an int
+    EXPECT_TRUE( evaluate("round(2.6) / 2", 0, &ret) );
+    EXPECT_EQ(1.5, ret);
+    EXPECT_TRUE( evaluate("round(2.6) // 2", 0, &ret) );
+    EXPECT_EQ(1., ret);
+#else
+    // Integer division of an integral frame
+    EXPECT_TRUE( evaluate("frame / 2", 3, &ret) );
+    EXPECT_EQ(1., ret);
+    EXPECT_TRUE( evaluate("-7 / 2", 0, &ret) );
+    EXPECT_EQ(-4., ret);
+    // Half away from zero
+    EXPECT_TRUE( evaluate("round(2.5)", 0, &ret) );
+    EXPECT_EQ(3., ret);
+    EXPECT_TRUE( evaluate("round(-2.5) + round(3.5) + round(-0.5)", 0, &ret) );
+    EXPECT_EQ(0., ret);
+    // round returns a float
+    EXPECT_TRUE( evaluate("round(2.) / 4", 0, &ret) );
+    EXPECT_EQ(0.5, ret);
+#endif
+    EXPECT_TRUE( evaluate("7 % -3", 0, &ret) );
+    EXPECT_EQ(-2., ret);
+    EXPECT_TRUE( evaluate("-7.5 % 2", 0, &ret) );
+    EXPECT_EQ(0.5, ret);
+    EXPECT_TRUE( evaluate("-2 ** 2", 0, &ret) );
+    EXPECT_EQ(-4., ret);
+    EXPECT_TRUE( evaluate("2 ** -1", 0, &ret) );
+    EXPECT_EQ(0.5, ret);
+    EXPECT_TRUE( evaluate("max(1, frame, 3) + min(2., 4)", 5, &ret) );
+    EXPECT_EQ(7., ret);
+    EXPECT_TRUE( evaluate("round(-2.7) + int(3.7) + sqrt(16)", 0, &ret) );
+    EXPECT_EQ(4., ret);
+    EXPECT_TRUE( evaluate("1 if frame > 5 and not frame == 7 else 2", 6, &ret) );
+    EXPECT_EQ(1., ret);
+    EXPECT_TRUE( evaluate("1 if frame > 5 and not frame == 7 else 2", 7, &ret) );
+    EXPECT_EQ(2., ret);
+
+    // Errors are reported by Python
+    EXPECT_FALSE( evaluate("1 / (frame - 1)", 1, &ret) );
+    EXPECT_FALSE( evaluate("sqrt(frame)", -1, &ret) );
+}
+
+///Expressions which need Python are not compiled
+TEST(NativeExpression, Unsupported)
+{
+    const char* exprs[] = {
+        "random()", "\"a\"", "010", "0x10", "1 < frame < 3", "[1, 2][0]", "frame +", "ret = 1", "thisNode.a.get()", 0
+    };
+
+    for (const char** expr = exprs; *expr; ++expr) {
+        EXPECT_FALSE( NativeExpression::compile( *expr, KnobIPtr(), 0 ) ) << *expr;
+    }
+}
+
+///Compares the native and Python evaluations of an expression reading another parameter, and their cost per frame
+TEST_F(BaseTest, NativeExpressionKnobReference)
+{
+    NodePtr node = createNode( QString::fromUtf8(PLUGINID_NATRON_DOT) );
+
+    ASSERT_TRUE(node);
+    EffectInstancePtr effect = node->getEffectInstance();
+    KnobDoublePtr source = effect->createDoubleKnob("source", "Source", 1);
+    KnobDoublePtr native = effect->createDoubleKnob("native", "Native", 1);
+    KnobDoublePtr python = effect->createDoubleKnob("python", "Python", 1);
+    source->setValueAtTime(0, 0., ViewSpec::all(), 0);
+    source->setValueAtTime(NATIVE_EXPRESSION_TEST_FRAMES_COUNT, 100., ViewSpec::all(), 0);
+
+    native->setExpression(0, "thisNode.source.get() * 2", false, true);
+    EXPECT_TRUE( native->isExpressionNative(0) );
+    // The same expression with a "ret" variable is executed by Python
+    python->setExpression(0, "ret = thisNode.source.get() * 2", true, true);
+    EXPECT_FALSE( python->isExpressionNative(0) );
+
+    for (int i = 0; i < NATIVE_EXPRESSION_TEST_FRAMES_COUNT; i += 100) {
+        EXPECT_DOUBLE_EQ( python->getValueAtTime(i), native->getValueAtTime(i) );
+    }
+
+    // Benchmark
+    const KnobDoublePtr benchKnobs[2] = { native, python };
+    const char* benchNames[2] = { "native", "python" };
+    for (int b = 0; b < 2; ++b) {
+        benchKnobs[b]->clearExpressionsResults(0);
+        TimeLapse timer;
+        for (int i = 0; i < NATIVE_EXPRESSION_TEST_FRAMES_COUNT; ++i) {
+            ignore_result( benchKnobs[b]->getValueAtTime(i) );
+        }
+        double seconds = timer.getTimeSinceCreation();
+        printf("expression evaluation, %s: %.3f us per frame\n", benchNames[b], seconds * 1e6 / NATIVE_EXPRESSION_TEST_FRAMES_COUNT);
+    }
+}
+
+///Parameters whose expressions read each other are evaluated the same way natively and by Python:
+///the parameter whose expression is being evaluated returns its static value
+TEST_F(BaseTest, NativeExpressionRecursion)
+{
+    NodePtr node = createNode( QString::fromUtf8(PLUGINID_NATRON_DOT) );
+
+    ASSERT_TRUE(node);
+    EffectInstancePtr effect = node->getEffectInstance();
+    KnobDoublePtr nativeA = effect->createDoubleKnob("nativeA", "Native A", 1);
+    KnobDoublePtr nativeB = effect->createDoubleKnob("nativeB", "Native B", 1);
+    KnobDoublePtr nativeSelf = effect->createDoubleKnob("nativeSelf", "Native Self", 1);
+    KnobDoublePtr pythonA = effect->createDoubleKnob("pythonA", "Python A", 1);
+    KnobDoublePtr pythonB = effect->createDoubleKnob("pythonB", "Python B", 1);
+    KnobDoublePtr pythonSelf = effect->createDoubleKnob("pythonSelf", "Python Self", 1);
+    nativeA->setValue(10.);
+    nativeB->setValue(20.);
+    nativeSelf->setValue(30.);
+    pythonA->setValue(10.);
+    pythonB->setValue(20.);
+    pythonSelf->setValue(30.);
+
+    nativeA->setExpression(0, "thisNode.nativeB.get() + 1", false, true);
+    nativeB->setExpression(0, "thisNode.nativeA.get() + 1", false, true);
+    nativeSelf->setExpression(0, "thisNode.nativeSelf.get() + 1", false, true);
+    pythonA->setExpression(0, "ret = thisNode.pythonB.get() + 1", true, true);
+    pythonB->setExpression(0, "ret = thisNode.pythonA.get() + 1", true, true);
+    pythonSelf->setExpression(0, "ret = thisNode.pythonSelf.get() + 1", true, true);
+    EXPECT_TRUE( nativeA->isExpressionNative(0) );
+    EXPECT_TRUE( nativeB->isExpressionNative(0) );
+    EXPECT_TRUE( nativeSelf->isExpressionNative(0) );
+    EXPECT_FALSE( pythonA->isExpressionNative(0) );
+
+    for (int i = 0; i < 2; ++i) {
+        nativeA->clearExpressionsResults(0);
+        nativeB->clearExpressionsResults(0);
+        nativeSelf->clearExpressionsResults(0);
+        pythonA->clearExpressionsResults(0);
+        pythonB->clearExpressionsResults(0);
+        pythonSelf->clearExpressionsResults(0);
+
+        // A reads B which reads the static value of A
+        EXPECT_EQ( 12., pythonA->getValueAtTime(i) );
+        EXPECT_EQ( pythonA->getValueAtTime(i), nativeA->getValueAtTime(i) );
+        EXPECT_EQ( pythonB->getValueAtTime(i), nativeB->getValueAtTime(i) );
+        EXPECT_EQ( 31., pythonSelf->getValueAtTime(i) );
+        EXPECT_EQ( pythonSelf->getValueAtTime(i), nativeSelf->getValueAtTime(i) );
+    }
+}
+
+///The divisions and roundings give the same values natively and through the Python interpreter
+TEST_F(BaseTest, NativeExpressionPythonSemantics)
+{
+    NodePtr node = createNode( QString::fromUtf8(PLUGINID_NATRON_DOT) );
+
+    ASSERT_TRUE(node);
+    EffectInstancePtr effect = node->getEffectInstance();
+    const char* exprs[] = {
+        "frame / 2", "-7 / 2 + frame", "round(frame + 0.5)", "round(-frame - 0.5)", "round(frame / 4.) / 2", 0
+    };
+
+    int i = 0;
+    for (const char** expr = exprs; *expr; ++expr, ++i) {
+        KnobDoublePtr native = effect->createDoubleKnob("native" + std::string(1, 'A' + i), "Native", 1);
+        KnobDoublePtr python = effect->createDoubleKnob("python" + std::string(1, 'A' + i), "Python", 1);
+        native->setExpression(0, *expr, false, true);
+        EXPECT_TRUE( native->isExpressionNative(0) ) << *expr;
+        python->setExpression(0, std::string("ret = ") + *expr, true, true);
+        EXPECT_FALSE( python->isExpressionNative(0) ) << *expr;
+        for (int frame = 0; frame < 8; ++frame) {
+            EXPECT_EQ( python->getValueAtTime(frame), native->getValueAtTime(frame) ) << *expr << " at frame " << frame;
+        }
+    }
+}
@@ -0,0 +1,120 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstdio>
+#include <vector>
+
+#include "BaseTest.h"
+
+#include "Engine/EffectInstance.h"
+#include "Engine/Node.h"
+#include "Engine/Timer.h"
+
+// Number of nodes of the synthetic graph
+#define NODE_HASH_TEST_NODES_COUNT 2000
+
+// Number of knob changes timed by the benchmark
+#define NODE_HASH_TEST_UPDATES_COUNT 50
+
+NATRON_NAMESPACE_USING
+
+class NodeHashTest
+    : public BaseTest
+{
+protected:
+
+    ///Builds a binary tree of Dot nodes, each node is connected to its parent
+    void createDotTree(std::vector<NodePtr>* nodes)
+    {
+        const QString dotPluginID = QString::fromUtf8(PLUGINID_NATRON_DOT);
+
+        nodes->reserve(NODE_HASH_TEST_NODES_COUNT);
+        for (int i = 0; i < NODE_HASH_TEST_NODES_COUNT; ++i) {
+            NodePtr node = createNode(dotPluginID);
+            ASSERT_TRUE(node);
+            if (i > 0) {
+                connectNodes( (*nodes)[(i - 1) / 2], node, 0, true );
+            }
+            nodes->push_back(node);
+        }
+    }
+};
+
+///Only the nodes downstream of a change get a new hash
+TEST_F(NodeHashTest, LargeGraph)
+{
+    std::vector<NodePtr> nodes;
+
+    createDotTree(&nodes);
+    ASSERT_EQ( (std::size_t)NODE_HASH_TEST_NODES_COUNT, nodes.size() );
+
+    // A change of the root changes the hash of the whole graph
+    std::vector<U64> hashes( nodes.size() );
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        hashes[i] = nodes[i]->getHashValue();
+    }
+    nodes[0]->incrementKnobsAge();
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        EXPECT_NE( hashes[i], nodes[i]->getHashValue() );
+        hashes[i] = nodes[i]->getHashValue();
+    }
+
+    // A change of a leaf only changes the leaf
+    nodes.back()->incrementKnobsAge();
+    for (std::size_t i = 0; i + 1 < nodes.size(); ++i) {
+        EXPECT_EQ( hashes[i], nodes[i]->getHashValue() );
+    }
+    EXPECT_NE( hashes.back(), nodes.back()->getHashValue() );
+
+    // Refreshing a node whose knobs did not change does not change anything
+    hashes.back() = nodes.back()->getHashValue();
+    nodes[0]->computeHash();
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        EXPECT_EQ( hashes[i], nodes[i]->getHashValue() );
+    }
+}
+
+// Not a pass/fail test: prints the cost of refreshing the hashes when a knob of the root or of a leaf
+// of the graph changes, e.g: a slider being dragged.
+// Disabled by default, run with --gtest_also_run_disabled_tests
+TEST_F(NodeHashTest, DISABLED_Benchmark)
+{
+    std::vector<NodePtr> nodes;
+
+    createDotTree(&nodes);
+    ASSERT_EQ( (std::size_t)NODE_HASH_TEST_NODES_COUNT, nodes.size() );
+
+    const NodePtr benchNodes[2] = { nodes.front(), nodes.back() };
+    const char* benchNames[2] = { "root", "leaf" };
+    for (int b = 0; b < 2; ++b) {
+        TimeLapse timer;
+        for (int i = 0; i < NODE_HASH_TEST_UPDATES_COUNT; ++i) {
+            benchNodes[b]->incrementKnobsAge();
+        }
+        double seconds = timer.getTimeSinceCreation();
+        printf("node hash, %d nodes, %s change: %.3f ms\n", NODE_HASH_TEST_NODES_COUNT, benchNames[b], seconds * 1000. / NODE_HASH_TEST_UPDATES_COUNT);
+    }
+}
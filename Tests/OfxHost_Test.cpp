@@ -0,0 +1,144 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstdio>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QAtomicInt>
+
+#include "BaseTest.h"
+
+#include "Engine/AppManager.h"
+#include "Engine/OfxHost.h"
+#include "Engine/Timer.h"
+
+#define OFX_HOST_TEST_THREADS_COUNT 16
+#define OFX_HOST_TEST_BENCHMARK_CALLS_COUNT 20000
+
+NATRON_NAMESPACE_USING
+
+#ifdef OFX_SUPPORTS_MULTITHREAD
+
+namespace {
+struct MultiThreadTestArgs
+{
+    OfxHost* host;
+    std::vector<QAtomicInt> calls;
+    QAtomicInt wrongIndexes;
+    QAtomicInt nestedCalls;
+
+    MultiThreadTestArgs()
+        : host( const_cast<OfxHost*>( appPTR->getOFXHost() ) )
+        , calls(OFX_HOST_TEST_THREADS_COUNT)
+        , wrongIndexes()
+        , nestedCalls()
+    {
+    }
+};
+
+void
+countCalls(unsigned int threadIndex,
+           unsigned int threadMax,
+           void *customArg)
+{
+    MultiThreadTestArgs* args = (MultiThreadTestArgs*)customArg;
+    unsigned int index = threadMax;
+
+    if ( (args->host->multiThreadIndex(&index) != kOfxStatOK) || (index != threadIndex) || !args->host->multiThreadIsSpawnedThread() ) {
+        args->wrongIndexes.fetchAndAddOrdered(1);
+    }
+    args->calls[threadIndex].fetchAndAddOrdered(1);
+}
+
+void
+nestedCalls(unsigned int threadIndex,
+            unsigned int /*threadMax*/,
+            void *customArg)
+{
+    MultiThreadTestArgs* args = (MultiThreadTestArgs*)customArg;
+    MultiThreadTestArgs nestedArgs;
+
+    // A nested call runs on the calling thread, with its own indexes
+    if ( args->host->multiThread(countCalls, OFX_HOST_TEST_THREADS_COUNT, &nestedArgs) == kOfxStatOK ) {
+        args->nestedCalls.fetchAndAddOrdered(1);
+    }
+    for (int i = 0; i < OFX_HOST_TEST_THREADS_COUNT; ++i) {
+        if ( nestedArgs.calls[i].fetchAndAddOrdered(0) != 1 ) {
+            args->wrongIndexes.fetchAndAddOrdered(1);
+        }
+    }
+    unsigned int index = 0;
+    if ( (args->host->multiThreadIndex(&index) != kOfxStatOK) || (index != threadIndex) ) {
+        args->wrongIndexes.fetchAndAddOrdered(1);
+    }
+}
+
+void
+noOp(unsigned int /*threadIndex*/,
+     unsigned int /*threadMax*/,
+     void */*customArg*/)
+{
+}
+}
+
+///Each thread index is run exactly once, with the thread index returned by the suite
+TEST_F(BaseTest, OfxHostMultiThread)
+{
+    MultiThreadTestArgs args;
+
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ( kOfxStatOK, args.host->multiThread(countCalls, OFX_HOST_TEST_THREADS_COUNT, &args) );
+    }
+    for (int i = 0; i < OFX_HOST_TEST_THREADS_COUNT; ++i) {
+        EXPECT_EQ( 100, args.calls[i].fetchAndAddOrdered(0) );
+    }
+    EXPECT_EQ( 0, args.wrongIndexes.fetchAndAddOrdered(0) );
+
+    ASSERT_EQ( kOfxStatOK, args.host->multiThread(nestedCalls, OFX_HOST_TEST_THREADS_COUNT, &args) );
+    EXPECT_EQ( OFX_HOST_TEST_THREADS_COUNT, args.nestedCalls.fetchAndAddOrdered(0) );
+    EXPECT_EQ( 0, args.wrongIndexes.fetchAndAddOrdered(0) );
+}
+
+// Not a pass/fail test: prints the cost of a multiThread call of a function which does nothing.
+// Disabled by default, run with --gtest_also_run_disabled_tests
+TEST_F(BaseTest, DISABLED_OfxHostMultiThreadDispatch)
+{
+    OfxHost* host = const_cast<OfxHost*>( appPTR->getOFXHost() );
+    unsigned int nCPUs = 1;
+
+    ASSERT_EQ( kOfxStatOK, host->multiThreadNumCPUS(&nCPUs) );
+
+    TimeLapse timer;
+    for (int i = 0; i < OFX_HOST_TEST_BENCHMARK_CALLS_COUNT; ++i) {
+        ASSERT_EQ( kOfxStatOK, host->multiThread(noOp, nCPUs, 0) );
+    }
+    double seconds = timer.getTimeSinceCreation();
+    printf("multiThread dispatch, %u threads: %.3f us per call\n", nCPUs, seconds * 1e6 / OFX_HOST_TEST_BENCHMARK_CALLS_COUNT);
+}
+
+#endif // OFX_SUPPORTS_MULTITHREAD
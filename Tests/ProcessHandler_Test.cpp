@@ -0,0 +1,171 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <algorithm> // min
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QString>
+
+#include "Engine/ProcessHandler.h"
+
+NATRON_NAMESPACE_USING
+
+typedef ProcessHandler::FrameRange FrameRange;
+
+static FrameRange
+makeRange(int first,
+          int last,
+          int step)
+{
+    FrameRange r;
+
+    r.first = first;
+    r.last = last;
+    r.step = step;
+
+    return r;
+}
+
+///Checks that every frame of the range is rendered by exactly one process, each process rendering the frames in order
+static void
+checkSplit(int firstFrame,
+           int lastFrame,
+           int frameStep,
+           int nProcesses)
+{
+    std::vector<FrameRange> ranges;
+
+    ProcessHandler::splitFrameRange(firstFrame, lastFrame, frameStep, nProcesses, &ranges);
+
+    int nFrames = (lastFrame - firstFrame) / frameStep + 1;
+    ASSERT_EQ( std::min(nFrames, nProcesses), (int)ranges.size() );
+
+    std::multiset<int> frames;
+    for (std::size_t i = 0; i < ranges.size(); ++i) {
+        EXPECT_EQ(firstFrame + (int)i * frameStep, ranges[i].first);
+        EXPECT_EQ(lastFrame, ranges[i].last);
+        EXPECT_EQ(frameStep * (int)ranges.size(), ranges[i].step);
+        for (int f = ranges[i].first; f <= ranges[i].last; f += ranges[i].step) {
+            frames.insert(f);
+        }
+    }
+    std::multiset<int> expected;
+    for (int f = firstFrame; f <= lastFrame; f += frameStep) {
+        expected.insert(f);
+    }
+    EXPECT_TRUE(frames == expected);
+}
+
+TEST(ProcessHandler, SplitFrameRange)
+{
+    checkSplit(1, 12, 1, 4);
+    checkSplit(0, 99, 1, 8);
+    checkSplit(10, 50, 5, 3);
+}
+
+///The frames do not divide evenly between the processes: the first ones render one more frame
+TEST(ProcessHandler, SplitUnevenFrameRange)
+{
+    checkSplit(1, 10, 1, 4);
+    checkSplit(1, 10, 1, 3);
+    checkSplit(0, 99, 7, 5);
+    checkSplit(3, 4, 1, 2);
+
+    std::vector<FrameRange> ranges;
+    ProcessHandler::splitFrameRange(1, 10, 1, 4, &ranges);
+    ASSERT_EQ(4, (int)ranges.size());
+    // 1,5,9 - 2,6,10 - 3,7 - 4,8
+    EXPECT_EQ( QString::fromUtf8("1-10:4"), ProcessHandler::getFrameRangeArgument(ranges[0]) );
+    EXPECT_EQ( QString::fromUtf8("4-10:4"), ProcessHandler::getFrameRangeArgument(ranges[3]) );
+}
+
+///There are never more processes than frames, and a single frame is given as a single number
+TEST(ProcessHandler, SplitOneFrameRange)
+{
+    std::vector<FrameRange> ranges;
+
+    ProcessHandler::splitFrameRange(5, 5, 1, 4, &ranges);
+    ASSERT_EQ(1, (int)ranges.size());
+    EXPECT_EQ(5, ranges[0].first);
+    EXPECT_EQ(5, ranges[0].last);
+    EXPECT_EQ( QString::fromUtf8("5"), ProcessHandler::getFrameRangeArgument(ranges[0]) );
+
+    checkSplit(1, 3, 1, 8);
+    checkSplit(0, 20, 10, 16);
+
+    // The last process of 1-3 renders only frame 3
+    ProcessHandler::splitFrameRange(1, 3, 1, 8, &ranges);
+    ASSERT_EQ(3, (int)ranges.size());
+    EXPECT_EQ( QString::fromUtf8("3"), ProcessHandler::getFrameRangeArgument(ranges[2]) );
+
+    // A single process renders the whole range
+    ProcessHandler::splitFrameRange(1, 10, 2, 1, &ranges);
+    ASSERT_EQ(1, (int)ranges.size());
+    EXPECT_EQ( QString::fromUtf8("1-10:2"), ProcessHandler::getFrameRangeArgument(ranges[0]) );
+}
+
+///The frames of a failed process are rendered again from its first frame which was not rendered
+TEST(ProcessHandler, RetryFailedFrameRange)
+{
+    // 2, 5, 8, 11, 14, 17, 20
+    FrameRange range = makeRange(2, 20, 3);
+    std::set<int> rendered;
+    FrameRange remaining;
+
+    // Nothing rendered: the whole range
+    ASSERT_TRUE( ProcessHandler::getRemainingFrameRange(range, rendered, &remaining) );
+    EXPECT_EQ(2, remaining.first);
+    EXPECT_EQ(20, remaining.last);
+    EXPECT_EQ(3, remaining.step);
+
+    // Frames rendered by the other processes are ignored, as well as the ones after the first missing frame
+    rendered.insert(2);
+    rendered.insert(3);
+    rendered.insert(5);
+    rendered.insert(11);
+    ASSERT_TRUE( ProcessHandler::getRemainingFrameRange(range, rendered, &remaining) );
+    EXPECT_EQ(8, remaining.first);
+    EXPECT_EQ(20, remaining.last);
+    EXPECT_EQ(3, remaining.step);
+    EXPECT_EQ( QString::fromUtf8("8-20:3"), ProcessHandler::getFrameRangeArgument(remaining) );
+
+    // The retried range fails again after rendering a few more frames
+    FrameRange retried = remaining;
+    rendered.insert(8);
+    rendered.insert(14);
+    rendered.insert(17);
+    ASSERT_TRUE( ProcessHandler::getRemainingFrameRange(retried, rendered, &remaining) );
+    EXPECT_EQ(20, remaining.first);
+    EXPECT_EQ( QString::fromUtf8("20"), ProcessHandler::getFrameRangeArgument(remaining) );
+
+    // Everything was rendered before the process failed
+    rendered.insert(20);
+    EXPECT_FALSE( ProcessHandler::getRemainingFrameRange(range, rendered, &remaining) );
+    EXPECT_FALSE( ProcessHandler::getRemainingFrameRange(makeRange(20, 20, 3), rendered, &remaining) );
+}
@@ -0,0 +1,110 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <set>
+#include <string>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+
+#include "BaseTest.h"
+
+#include "Global/FStreamsSupport.h"
+
+#include "Engine/AppInstance.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/Node.h"
+#include "Engine/Project.h"
+#include "Engine/ProjectBinaryFormat.h"
+#include "Engine/ProjectSerialization.h"
+
+NATRON_NAMESPACE_USING
+
+namespace {
+std::set<std::string>
+getNodeNames(const ProjectSerialization& project)
+{
+    std::set<std::string> names;
+    const std::list<NodeSerializationPtr>& nodes = project.getNodesSerialization().getNodesSerialization();
+
+    for (std::list<NodeSerializationPtr>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        names.insert( (*it)->getNodeScriptName() );
+    }
+
+    return names;
+}
+}
+
+///Writes a graph of 2 branches in the binary format and reads back either the whole graph or a single branch
+TEST_F(BaseTest, ProjectBinaryFormatPartialLoad)
+{
+    const QString dotPluginID = QString::fromUtf8(PLUGINID_NATRON_DOT);
+    NodePtr a = createNode(dotPluginID);
+    NodePtr b = createNode(dotPluginID);
+    NodePtr c = createNode(dotPluginID);
+    NodePtr d = createNode(dotPluginID);
+
+    ASSERT_TRUE(a && b && c && d);
+    connectNodes(a, b, 0, true);
+    connectNodes(c, d, 0, true);
+
+    ProjectSerialization projectSerialization( getApp() );
+    projectSerialization.initialize( getApp()->getProject().get() );
+
+    QString filePath = QDir::tempPath() + QString::fromUtf8("/ProjectBinaryFormat_Test.ntp");
+    {
+        FStreamsSupport::ofstream ofile;
+        FStreamsSupport::open( &ofile, filePath.toStdString(), std::ios_base::out | std::ios_base::binary );
+        ASSERT_TRUE(ofile);
+        ProjectBinaryWriter::write(ofile, true, &projectSerialization, std::string());
+    }
+    // The nodes were given back to the serialization
+    EXPECT_EQ( 4, (int)projectSerialization.getNodesSerialization().getNodesSerialization().size() );
+
+    ASSERT_TRUE( ProjectBinaryReader::isBinaryProjectFile(filePath) );
+    {
+        ProjectBinaryReader reader(filePath);
+        EXPECT_TRUE( reader.isBackgroundProject() );
+        EXPECT_EQ( 4, reader.getNodesCount() );
+
+        // Everything
+        ProjectSerialization all( getApp() );
+        EXPECT_EQ( 4, reader.readProject(std::list<std::string>(), &all) );
+        EXPECT_EQ( getNodeNames(projectSerialization), getNodeNames(all) );
+
+        // Only the branch of b
+        std::list<std::string> required;
+        required.push_back( b->getScriptName() );
+        ProjectSerialization partial( getApp() );
+        EXPECT_EQ( 2, reader.readProject(required, &partial) );
+        std::set<std::string> names = getNodeNames(partial);
+        EXPECT_EQ( 2, (int)names.size() );
+        EXPECT_TRUE( names.find( a->getScriptName() ) != names.end() );
+        EXPECT_TRUE( names.find( b->getScriptName() ) != names.end() );
+    }
+    QFile::remove(filePath);
+}
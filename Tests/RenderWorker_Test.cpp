@@ -0,0 +1,86 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "BaseTest.h"
+
+#include "Global/GlobalDefines.h"
+#include "Engine/RenderWorker.h"
+
+NATRON_NAMESPACE_USING
+
+TEST(RenderWorker, SplitCommandLine)
+{
+    QStringList args = RenderWorker::splitCommandLine( QString::fromUtf8("  -w Write1   1-10 \"/path/to/my project.ntp\" \"\"") );
+
+    ASSERT_EQ(5, args.size());
+    EXPECT_EQ( QString::fromUtf8("-w"), args[0] );
+    EXPECT_EQ( QString::fromUtf8("Write1"), args[1] );
+    EXPECT_EQ( QString::fromUtf8("1-10"), args[2] );
+    EXPECT_EQ( QString::fromUtf8("/path/to/my project.ntp"), args[3] );
+    EXPECT_TRUE( args[4].isEmpty() );
+
+    EXPECT_TRUE( RenderWorker::splitCommandLine( QString::fromUtf8("   ") ).isEmpty() );
+}
+
+TEST(RenderWorker, IgnoresCommentsAndStopsOnQuit)
+{
+    // No job is run: comments and empty lines are skipped and nothing is read after quit
+    std::istringstream input("# a comment\n\n   \nquit\n-w Write1 /nonexistent.ntp\n");
+    std::ostringstream output;
+    RenderWorker worker(input, output);
+
+    EXPECT_EQ( 0, worker.run() );
+    EXPECT_TRUE( output.str().empty() );
+}
+
+///A job which cannot be loaded is reported as failed and the next jobs still run
+TEST_F(BaseTest, RenderWorkerFailedJobs)
+{
+    std::istringstream input("-w Write1\n-w Write1 /nonexistent/project.ntp\n");
+    std::ostringstream output;
+    RenderWorker worker(input, output);
+
+    EXPECT_EQ( 2, worker.run() );
+
+    std::istringstream lines( output.str() );
+    std::string line;
+    for (int i = 1; i <= 2; ++i) {
+        std::ostringstream started;
+        started << kRenderWorkerJobStartedString << ' ' << i;
+        ASSERT_TRUE( std::getline(lines, line) );
+        EXPECT_EQ( started.str(), line );
+
+        std::ostringstream failed;
+        failed << kRenderWorkerJobFailedString << ' ' << i << ' ';
+        ASSERT_TRUE( std::getline(lines, line) );
+        EXPECT_EQ( 0u, line.find( failed.str() ) );
+    }
+    EXPECT_FALSE( std::getline(lines, line) );
+}
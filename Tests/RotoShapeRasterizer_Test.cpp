@@ -0,0 +1,155 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cmath>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <cairo/cairo.h>
+
+#include "BaseTest.h"
+
+#include "Engine/Bezier.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/Node.h"
+#include "Engine/RotoContext.h"
+#include "Engine/RotoContextPrivate.h"
+#include "Engine/RotoShapeRasterizer.h"
+
+NATRON_NAMESPACE_USING
+
+///Compares the native rasterizer with the cairo renderer, pixel by pixel
+TEST_F(BaseTest, RotoShapeRasterizer)
+{
+    NodePtr node = createNode( QString::fromUtf8(PLUGINID_NATRON_ROTO) );
+
+    ASSERT_TRUE(node);
+    RotoContextPtr context = node->getRotoContext();
+    ASSERT_TRUE(context);
+
+    const RectI roi(0, 0, 400, 300);
+    const int nPixels = roi.width() * roi.height();
+    const double fallOffs[2] = { 1., 2.5 };
+
+    for (int f = 0; f < 2; ++f) {
+        BezierPtr bezier = context->makeEllipse(200, 150, 200, true, 0);
+        ASSERT_TRUE(bezier);
+        bezier->getFeatherKnob()->setValue(30.);
+        bezier->getFeatherFallOffKnob()->setValue(fallOffs[f]);
+
+        // cairo, as in RotoDrawableItem::renderMaskInternal
+        cairo_surface_t* cairoImg = cairo_image_surface_create( CAIRO_FORMAT_A8, roi.width(), roi.height() );
+        cairo_surface_set_device_offset(cairoImg, -roi.x1, -roi.y1);
+        cairo_t* cr = cairo_create(cairoImg);
+        cairo_set_fill_rule(cr, CAIRO_FILL_RULE_WINDING);
+        cairo_set_antialias(cr, CAIRO_ANTIALIAS_NONE);
+        RotoContextPrivate::renderBezier(cr, bezier.get(), 1., 0, 0, 0, 1, 0);
+        cairo_surface_flush(cairoImg);
+
+        RotoShapeRasterizer rasterizer(bezier.get(), 0, 0, 0, 1, 0);
+        std::vector<float> native(nPixels);
+        rasterizer.renderAlpha(roi, &native.front());
+
+        const unsigned char* cdata = cairo_image_surface_get_data(cairoImg);
+        int stride = cairo_image_surface_get_stride(cairoImg);
+        double sumDiff = 0.;
+        int nDifferent = 0;
+        for (int y = 0; y < roi.height(); ++y) {
+            for (int x = 0; x < roi.width(); ++x) {
+                double diff = std::abs(cdata[y * stride + x] / 255. - native[y * roi.width() + x]);
+                sumDiff += diff;
+                if (diff > 0.1) {
+                    ++nDifferent;
+                }
+            }
+        }
+        cairo_destroy(cr);
+        cairo_surface_destroy(cairoImg);
+
+        // The pixels inside the shape and on the feather border may only differ by rounding
+        EXPECT_EQ( 1.f, native[150 * roi.width() + 200] );
+        EXPECT_EQ( 0.f, native[5 * roi.width() + 5] );
+        EXPECT_LT( sumDiff / nPixels, 0.01 ) << "falloff " << fallOffs[f];
+        EXPECT_LT( nDifferent, nPixels / 100 ) << "falloff " << fallOffs[f];
+
+        context->removeItem(bezier);
+    }
+}
+
+///The polygons of a shape are evaluated once, and again after the shape changes
+TEST_F(BaseTest, BezierPolygonCache)
+{
+    NodePtr node = createNode( QString::fromUtf8(PLUGINID_NATRON_ROTO) );
+
+    ASSERT_TRUE(node);
+    RotoContextPtr context = node->getRotoContext();
+    ASSERT_TRUE(context);
+    BezierPtr bezier = context->makeEllipse(200, 150, 200, true, 0);
+    ASSERT_TRUE(bezier);
+
+    std::list<ParametricPoint> points[3];
+    RectD bbox[3];
+    // A miss first, then a hit, then a miss after the shape changed
+    const int expectedMisses[3] = { 1, 0, 1 };
+    for (int i = 0; i < 3; ++i) {
+        if (i == 2) {
+            bezier->movePointByIndex(1, 0, 10., 0.);
+        }
+        int missesBefore, hitsBefore;
+        bezier->getPolygonCacheAccessInfos(&missesBefore, &hitsBefore);
+        bbox[i].setupInfinity();
+        bezier->evaluateAtTime_DeCasteljau(false, 0, 0,
+#ifdef ROTO_BEZIER_EVAL_ITERATIVE
+                                           50,
+#else
+                                           1.,
+#endif
+                                           &points[i], &bbox[i]);
+        ASSERT_FALSE( points[i].empty() );
+        int misses, hits;
+        bezier->getPolygonCacheAccessInfos(&misses, &hits);
+        EXPECT_EQ(expectedMisses[i], misses - missesBefore) << "evaluation " << i;
+        EXPECT_EQ(1 - expectedMisses[i], hits - hitsBefore) << "evaluation " << i;
+    }
+
+    // The cached polygon is the evaluated one
+    ASSERT_EQ( points[0].size(), points[1].size() );
+    for (std::list<ParametricPoint>::const_iterator it0 = points[0].begin(), it1 = points[1].begin(); it0 != points[0].end(); ++it0, ++it1) {
+        EXPECT_EQ(it0->x, it1->x);
+        EXPECT_EQ(it0->y, it1->y);
+    }
+    EXPECT_EQ(bbox[0].x1, bbox[1].x1);
+    EXPECT_EQ(bbox[0].x2, bbox[1].x2);
+    EXPECT_EQ(bbox[0].y1, bbox[1].y1);
+    EXPECT_EQ(bbox[0].y2, bbox[1].y2);
+
+    // Moving the right point invalidates it
+    EXPECT_DOUBLE_EQ(bbox[0].x2 + 10., bbox[2].x2);
+
+    context->removeItem(bezier);
+}
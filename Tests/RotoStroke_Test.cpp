@@ -0,0 +1,239 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <cairo/cairo.h>
+
+#include "Engine/RotoContextPrivate.h"
+
+NATRON_NAMESPACE_USING
+
+namespace {
+void
+destroyPatterns(std::vector<cairo_pattern_t*>& dotPatterns)
+{
+    for (std::size_t i = 0; i < dotPatterns.size(); ++i) {
+        if (dotPatterns[i]) {
+            cairo_pattern_destroy(dotPatterns[i]);
+        }
+    }
+}
+}
+
+///Rendering a stroke in several parts, as the accumulation buffer of a stroke does, draws the same dots as rendering it at once
+TEST(RotoStroke, RenderStrokeDotsInParts)
+{
+    RotoStrokeDotParams params;
+    params.brushSizePixel = 12.;
+    params.brushSpacing = 0.1;
+    params.brushHardness = 0.3;
+    params.writeOnStart = 0.;
+    params.writeOnEnd = 1.;
+    params.pressureAffectsOpacity = true;
+    params.pressureAffectsSize = true;
+    params.pressureAffectsHardness = false;
+    params.doBuildUp = true;
+    params.opacity = 0.5;
+
+    // A spiral
+    std::vector<std::pair<Point, double> > points;
+    for (int i = 0; i < 500; ++i) {
+        double a = i * 0.05;
+        Point p = { 100. + std::cos(a) * (10. + i * 0.15), 100. + std::sin(a) * (10. + i * 0.15) };
+        points.push_back( std::make_pair( p, 0.5 + 0.5 * std::sin(a * 0.3) ) );
+    }
+
+    const int width = 200, height = 200;
+    cairo_surface_t* surfaces[2] = {
+        cairo_image_surface_create(CAIRO_FORMAT_A8, width, height), cairo_image_surface_create(CAIRO_FORMAT_A8, width, height)
+    };
+    double distToNext[2] = { 0., 0. };
+    for (int s = 0; s < 2; ++s) {
+        cairo_t* cr = cairo_create(surfaces[s]);
+        cairo_set_antialias(cr, CAIRO_ANTIALIAS_NONE);
+        cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+        std::vector<cairo_pattern_t*> dotPatterns( ROTO_PRESSURE_LEVELS, (cairo_pattern_t*)0 );
+        if (s == 0) {
+            distToNext[s] = RotoContextPrivate::renderStrokeDots(cr, dotPatterns, points, 0, points.size(), 0., params);
+        } else {
+            // The last point of a part is the first point of the next one
+            std::size_t first = 0;
+            while (first + 1 < points.size()) {
+                std::size_t last = std::min(first + 37, points.size() - 1);
+                distToNext[s] = RotoContextPrivate::renderStrokeDots(cr, dotPatterns, points, first, last + 1, distToNext[s], params);
+                first = last;
+            }
+        }
+        destroyPatterns(dotPatterns);
+        cairo_destroy(cr);
+        cairo_surface_flush(surfaces[s]);
+    }
+
+    EXPECT_DOUBLE_EQ(distToNext[0], distToNext[1]);
+    int stride = cairo_image_surface_get_stride(surfaces[0]);
+    ASSERT_EQ( stride, cairo_image_surface_get_stride(surfaces[1]) );
+    EXPECT_EQ( 0, std::memcmp(cairo_image_surface_get_data(surfaces[0]), cairo_image_surface_get_data(surfaces[1]), stride * height) );
+
+    // Something was drawn
+    const unsigned char* data = cairo_image_surface_get_data(surfaces[0]);
+    int nonZero = 0;
+    for (int i = 0; i < stride * height; ++i) {
+        nonZero += data[i] != 0;
+    }
+    EXPECT_GT(nonZero, 0);
+
+    cairo_surface_destroy(surfaces[0]);
+    cairo_surface_destroy(surfaces[1]);
+}
+
+namespace {
+RotoStrokeDotParams
+getAccumulationTestParams()
+{
+    RotoStrokeDotParams params;
+
+    params.brushSizePixel = 10.;
+    params.brushSpacing = 0.1;
+    params.brushHardness = 0.5;
+    params.writeOnStart = 0.;
+    params.writeOnEnd = 1.;
+    params.pressureAffectsOpacity = true;
+    params.pressureAffectsSize = false;
+    params.pressureAffectsHardness = false;
+    params.doBuildUp = true;
+    params.opacity = 1.;
+
+    return params;
+}
+
+// A spiral of nPoints points around (cx, cy)
+std::vector<std::pair<Point, double> >
+makeSpiral(int nPoints,
+           double cx,
+           double cy)
+{
+    std::vector<std::pair<Point, double> > points;
+
+    for (int i = 0; i < nPoints; ++i) {
+        double a = i * 0.05;
+        Point p = { cx + std::cos(a) * (5. + i * 0.1), cy + std::sin(a) * (5. + i * 0.1) };
+        points.push_back( std::make_pair( p, 0.5 + 0.5 * std::sin(a * 0.3) ) );
+    }
+
+    return points;
+}
+
+// Compares the accumulation buffer acc with the stroke rendered at once in a new buffer
+void
+expectSameAsFullRender(const RotoStrokeAccumulation& acc,
+                       const std::vector<std::vector<std::pair<Point, double> > >& points,
+                       const RectI& bounds,
+                       const RotoStrokeDotParams& params)
+{
+    RotoStrokeAccumulation full;
+
+    ASSERT_TRUE( RotoContextPrivate::accumulateStrokeDots(&full, CAIRO_FORMAT_A8, bounds, points, 0, params) );
+    ASSERT_TRUE(acc.surface);
+    ASSERT_EQ(bounds, acc.bounds);
+    EXPECT_DOUBLE_EQ(full.distToNext, acc.distToNext);
+    int stride = cairo_image_surface_get_stride(full.surface);
+    ASSERT_EQ( stride, cairo_image_surface_get_stride(acc.surface) );
+    EXPECT_EQ( 0, std::memcmp(cairo_image_surface_get_data(full.surface), cairo_image_surface_get_data(acc.surface), stride * bounds.height()) );
+}
+}
+
+///Points appended to a stroke and new multi-strokes are rendered incrementally to the same result as a full render
+TEST(RotoStroke, AccumulateAppendedPoints)
+{
+    RotoStrokeDotParams params = getAccumulationTestParams();
+    RectI bounds(0, 0, 200, 200);
+    std::vector<std::pair<Point, double> > spiral = makeSpiral(400, 100., 100.);
+    RotoStrokeAccumulation acc;
+    std::vector<std::vector<std::pair<Point, double> > > points(1);
+
+    for (std::size_t n = 1; n <= spiral.size(); n += 57) {
+        points[0].assign( spiral.begin(), spiral.begin() + n );
+        ASSERT_TRUE( RotoContextPrivate::accumulateStrokeDots(&acc, CAIRO_FORMAT_A8, bounds, points, 0, params) );
+    }
+    expectSameAsFullRender(acc, points, bounds, params);
+
+    // A new multi-stroke
+    points.push_back( makeSpiral(100, 50., 50.) );
+    ASSERT_TRUE( RotoContextPrivate::accumulateStrokeDots(&acc, CAIRO_FORMAT_A8, bounds, points, 0, params) );
+    expectSameAsFullRender(acc, points, bounds, params);
+
+    // A write-on range shrinking to a prefix of the stroke
+    points.pop_back();
+    points[0].resize(150);
+    ASSERT_TRUE( RotoContextPrivate::accumulateStrokeDots(&acc, CAIRO_FORMAT_A8, bounds, points, 0, params) );
+    expectSameAsFullRender(acc, points, bounds, params);
+}
+
+///Editing a point of a stroke removes the dots which were rendered from it
+TEST(RotoStroke, AccumulateEditedPoint)
+{
+    RotoStrokeDotParams params = getAccumulationTestParams();
+    RectI bounds(0, 0, 200, 200);
+    RotoStrokeAccumulation acc;
+    std::vector<std::vector<std::pair<Point, double> > > points( 1, makeSpiral(400, 100., 100.) );
+
+    ASSERT_TRUE( RotoContextPrivate::accumulateStrokeDots(&acc, CAIRO_FORMAT_A8, bounds, points, 0, params) );
+
+    points[0][200].first.x += 15.;
+    points[0][200].second = 1.;
+    ASSERT_TRUE( RotoContextPrivate::accumulateStrokeDots(&acc, CAIRO_FORMAT_A8, bounds, points, 0, params) );
+    expectSameAsFullRender(acc, points, bounds, params);
+
+    // The last point
+    points[0].back().first.y -= 10.;
+    ASSERT_TRUE( RotoContextPrivate::accumulateStrokeDots(&acc, CAIRO_FORMAT_A8, bounds, points, 0, params) );
+    expectSameAsFullRender(acc, points, bounds, params);
+}
+
+///The dots already rendered are kept when the bounding box of the stroke grows
+TEST(RotoStroke, AccumulateResizedBounds)
+{
+    RotoStrokeDotParams params = getAccumulationTestParams();
+    std::vector<std::pair<Point, double> > spiral = makeSpiral(400, 150., 150.);
+    RotoStrokeAccumulation acc;
+    std::vector<std::vector<std::pair<Point, double> > > points(1);
+
+    // The first 100 points lie within 20 pixels of the center, plus the brush radius
+    points[0].assign( spiral.begin(), spiral.begin() + 100 );
+    ASSERT_TRUE( RotoContextPrivate::accumulateStrokeDots(&acc, CAIRO_FORMAT_A8, RectI(120, 120, 180, 180), points, 0, params) );
+
+    points[0] = spiral;
+    RectI bounds(90, 90, 210, 210);
+    ASSERT_TRUE( RotoContextPrivate::accumulateStrokeDots(&acc, CAIRO_FORMAT_A8, bounds, points, 0, params) );
+    expectSameAsFullRender(acc, points, bounds, params);
+}
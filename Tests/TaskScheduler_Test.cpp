@@ -0,0 +1,338 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <algorithm> // max
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/bind.hpp>
+#endif
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+#include <QtCore/QSemaphore>
+#include <QtCore/QWaitCondition>
+
+#include "Engine/ParallelRenderArgs.h"
+#include "Engine/TaskScheduler.h"
+
+NATRON_NAMESPACE_USING
+
+namespace {
+
+void
+incrementTask(QAtomicInt* counter)
+{
+    counter->fetchAndAddOrdered(1);
+}
+
+// Mimics a tiled render whose tiles render their inputs with tiles: each task spawns
+// a nested group and waits on it from within the scheduler.
+void
+nestedTask(TaskScheduler* scheduler,
+           int depth,
+           int width,
+           QAtomicInt* counter)
+{
+    counter->fetchAndAddOrdered(1);
+    if (depth == 0) {
+        return;
+    }
+    TaskGroup group(scheduler);
+    for (int i = 0; i < width; ++i) {
+        group.run( boost::bind(&nestedTask, scheduler, depth - 1, width, counter) );
+    }
+    group.wait();
+}
+
+void
+throwingTask()
+{
+    throw std::runtime_error("task failure");
+}
+
+void
+signalTask(QSemaphore* done)
+{
+    done->release();
+}
+
+// Blocks the worker running it until unblock is released
+void
+blockingTask(QSemaphore* started,
+             QSemaphore* unblock)
+{
+    started->release();
+    unblock->acquire();
+}
+
+void
+recordTask(QMutex* mutex,
+           std::vector<RenderPriorityEnum>* order,
+           RenderPriorityEnum priority,
+           QSemaphore* done)
+{
+    {
+        QMutexLocker k(mutex);
+        order->push_back(priority);
+    }
+    done->release();
+}
+
+// Counts the tasks running at the same time
+void
+concurrentTask(QMutex* mutex,
+               int* nRunning,
+               int* maxRunning,
+               QSemaphore* done)
+{
+    {
+        QMutexLocker k(mutex);
+        ++*nRunning;
+        *maxRunning = std::max(*maxRunning, *nRunning);
+    }
+    {
+        // Sleep a bit so that tasks would overlap without quota
+        QMutex sleepMutex;
+        QWaitCondition sleepCond;
+        QMutexLocker k(&sleepMutex);
+        sleepCond.wait(&sleepMutex, 5);
+    }
+    {
+        QMutexLocker k(mutex);
+        --*nRunning;
+    }
+    done->release();
+}
+
+// Number of tasks run by nestedTask(depth, width), including the root task
+int
+nestedTaskCount(int depth,
+                int width)
+{
+    int count = 1;
+    int levelCount = 1;
+
+    for (int i = 0; i < depth; ++i) {
+        levelCount *= width;
+        count += levelCount;
+    }
+
+    return count;
+}
+}
+
+TEST(TaskScheduler, RunsAllTasks)
+{
+    TaskScheduler scheduler(4);
+    QAtomicInt counter;
+    {
+        TaskGroup group(&scheduler);
+        for (int i = 0; i < 1000; ++i) {
+            group.run( boost::bind(&incrementTask, &counter) );
+        }
+        EXPECT_TRUE( group.wait() );
+    }
+    EXPECT_EQ( 1000, counter.fetchAndAddRelaxed(0) );
+    EXPECT_LE(scheduler.getSpawnedThreadCount(), 4);
+    EXPECT_FALSE( scheduler.isCurrentThreadWorker() );
+}
+
+TEST(TaskScheduler, NestedGroupsDoNotDeadlock)
+{
+    // With a single worker, a thread pool that blocks while waiting would deadlock (or serialize) here
+    const int maxThreads[2] = {1, 4};
+
+    for (int i = 0; i < 2; ++i) {
+        TaskScheduler scheduler(maxThreads[i]);
+        QAtomicInt counter;
+        nestedTask(&scheduler, 4, 6, &counter);
+        EXPECT_EQ( nestedTaskCount(4, 6), counter.fetchAndAddRelaxed(0) );
+    }
+}
+
+TEST(TaskScheduler, ConcurrentNestedGroups)
+{
+    // Several nested groups waited on at the same time by different workers
+    TaskScheduler scheduler(3);
+    QAtomicInt counter;
+    {
+        TaskGroup group(&scheduler);
+        for (int i = 0; i < 8; ++i) {
+            group.run( boost::bind(&nestedTask, &scheduler, 3, 5, &counter) );
+        }
+        EXPECT_TRUE( group.wait() );
+    }
+    EXPECT_EQ( 8 * nestedTaskCount(3, 5), counter.fetchAndAddRelaxed(0) );
+}
+
+TEST(TaskScheduler, ReportsFailures)
+{
+    TaskScheduler scheduler(2);
+    QAtomicInt counter;
+    TaskGroup group(&scheduler);
+
+    group.run( boost::bind(&incrementTask, &counter) );
+    group.run(&throwingTask);
+    group.run( boost::bind(&incrementTask, &counter) );
+    EXPECT_FALSE( group.wait() );
+    EXPECT_EQ( 2, counter.fetchAndAddRelaxed(0) );
+}
+
+TEST(TaskScheduler, NoSchedulerRunsInline)
+{
+    QAtomicInt counter;
+    TaskGroup group(0);
+
+    group.run( boost::bind(&incrementTask, &counter) );
+    EXPECT_EQ( 1, counter.fetchAndAddRelaxed(0) );
+    EXPECT_TRUE( group.wait() );
+}
+
+// Workers above a lowered thread budget must not swallow the wake-up of a queued task
+TEST(TaskScheduler, LoweredBudgetStillRunsTasks)
+{
+    const int nThreads = 4;
+    TaskScheduler scheduler(nThreads);
+    QSemaphore started, unblock, done;
+
+    // Spawn all the workers, then let them go idle
+    {
+        TaskGroup group(&scheduler);
+        for (int i = 0; i < nThreads; ++i) {
+            group.run( boost::bind(&blockingTask, &started, &unblock) );
+        }
+        ASSERT_TRUE( started.tryAcquire(nThreads, 5000) );
+        unblock.release(nThreads);
+        EXPECT_TRUE( group.wait() );
+    }
+    ASSERT_EQ( nThreads, scheduler.getSpawnedThreadCount() );
+
+    scheduler.setMaxThreadCount(1);
+    for (int i = 0; i < 50; ++i) {
+        TaskGroup group(&scheduler);
+        group.run( boost::bind(&signalTask, &done) );
+        // Do not wait on the group, which would run the task in this thread
+        ASSERT_TRUE( done.tryAcquire(1, 5000) ) << "task " << i << " was not run by a worker";
+        EXPECT_TRUE( group.wait() );
+    }
+}
+
+TEST(TaskScheduler, RunsHighestPriorityFirst)
+{
+    TaskScheduler scheduler(1);
+    QSemaphore started, unblock, done;
+    QMutex mutex;
+    std::vector<RenderPriorityEnum> order;
+
+    // Keep the only worker busy while the tasks are queued
+    TaskGroup blockingGroup(&scheduler);
+    blockingGroup.run( boost::bind(&blockingTask, &started, &unblock) );
+    started.acquire();
+
+    TaskGroup backgroundGroup(&scheduler, eRenderPriorityBackground);
+    TaskGroup previewGroup(&scheduler, eRenderPriorityPreview);
+    TaskGroup interactiveGroup(&scheduler, eRenderPriorityInteractive);
+    for (int i = 0; i < 3; ++i) {
+        backgroundGroup.run( boost::bind(&recordTask, &mutex, &order, eRenderPriorityBackground, &done) );
+        previewGroup.run( boost::bind(&recordTask, &mutex, &order, eRenderPriorityPreview, &done) );
+    }
+    for (int i = 0; i < 3; ++i) {
+        interactiveGroup.run( boost::bind(&recordTask, &mutex, &order, eRenderPriorityInteractive, &done) );
+    }
+    unblock.release();
+
+    // Let the worker run everything: waiting on the groups would run their tasks in this thread
+    done.acquire(9);
+    EXPECT_TRUE( blockingGroup.wait() );
+
+    ASSERT_EQ(9, (int)order.size());
+    for (int i = 0; i < 9; ++i) {
+        EXPECT_EQ( i < 3 ? eRenderPriorityInteractive : (i < 6 ? eRenderPriorityPreview : eRenderPriorityBackground), order[i] );
+    }
+    EXPECT_EQ( 3, scheduler.getQueueLatencySamplesCount(eRenderPriorityBackground) );
+    EXPECT_LE( scheduler.getQueueLatencyPercentile(eRenderPriorityInteractive, 50),
+               scheduler.getQueueLatencyPercentile(eRenderPriorityBackground, 50) );
+}
+
+TEST(TaskScheduler, RespectsPriorityThreadQuota)
+{
+    TaskScheduler scheduler(4);
+    QSemaphore done;
+    QMutex mutex;
+    int nRunning = 0;
+    int maxRunning = 0;
+
+    scheduler.setPriorityThreadQuota(eRenderPriorityBackground, 1);
+    EXPECT_EQ( 1, scheduler.getPriorityThreadQuota(eRenderPriorityBackground) );
+    {
+        TaskGroup group(&scheduler, eRenderPriorityBackground);
+        for (int i = 0; i < 8; ++i) {
+            group.run( boost::bind(&concurrentTask, &mutex, &nRunning, &maxRunning, &done) );
+        }
+        // Only the workers run the tasks
+        done.acquire(8);
+        EXPECT_TRUE( group.wait() );
+    }
+    EXPECT_EQ(1, maxRunning);
+
+    // Without quota the tasks run concurrently
+    scheduler.setPriorityThreadQuota(eRenderPriorityBackground, 0);
+    maxRunning = 0;
+    {
+        TaskGroup group(&scheduler, eRenderPriorityBackground);
+        for (int i = 0; i < 8; ++i) {
+            group.run( boost::bind(&concurrentTask, &mutex, &nRunning, &maxRunning, &done) );
+        }
+        done.acquire(8);
+        EXPECT_TRUE( group.wait() );
+    }
+    EXPECT_GE(maxRunning, 1);
+    EXPECT_LE(maxRunning, 4);
+
+    scheduler.resetQueueLatencies();
+    EXPECT_EQ( 0, scheduler.getQueueLatencySamplesCount(eRenderPriorityBackground) );
+    EXPECT_EQ( 0., scheduler.getQueueLatencyPercentile(eRenderPriorityBackground, 99) );
+}
+
+TEST(TaskScheduler, PrefetchHasTheLowestPriority)
+{
+    ParallelRenderArgs args;
+
+    EXPECT_EQ( eRenderPriorityBackground, args.getRenderPriority() );
+    args.isRenderResponseToUserInteraction = true;
+    EXPECT_EQ( eRenderPriorityPreview, args.getRenderPriority() );
+    args.isAnalysis = true;
+    EXPECT_EQ( eRenderPriorityInteractive, args.getRenderPriority() );
+
+    // A prefetch never competes with the other renders, whatever the other flags
+    args.isSequentialRender = true;
+    args.isPrefetch = true;
+    EXPECT_EQ( eRenderPriorityBackground, args.getRenderPriority() );
+}
@@ -43,10 +43,23 @@ SOURCES += \
     google-test/src/gtest-all.cc \
     google-mock/src/gmock-all.cc \
     BaseTest.cpp \
+    Cache_Test.cpp \
     Hash64_Test.cpp \
     Image_Test.cpp \
     Lut_Test.cpp \
     KnobFile_Test.cpp \
+    KnobsSnapshot_Test.cpp \
+    NativeExpression_Test.cpp \
+    NodeHash_Test.cpp \
+    OfxHost_Test.cpp \
+    ProcessHandler_Test.cpp \
+    ProjectBinaryFormat_Test.cpp \
+    RenderWorker_Test.cpp \
+    RotoShapeRasterizer_Test.cpp \
+    RotoStroke_Test.cpp \
+    TaskScheduler_Test.cpp \
+    ViewerPrefetch_Test.cpp \
+    ViewerProgressiveRender_Test.cpp \
     Curve_Test.cpp \
     Tracker_Test.cpp \
     wmain.cpp
@@ -25,11 +25,17 @@
 #include "Global/Macros.h"
 
 #include <vector>
+#include <set>
 #include <cmath>
 #include <cstdlib>
+#include <algorithm>
 
 #include <gtest/gtest.h>
 
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/make_shared.hpp>
+#endif
+
 #if ( ( __GNUC__ * 100) + __GNUC_MINOR__) >= 408
 GCC_DIAG_OFF(maybe-uninitialized)
 #endif
@@ -39,9 +45,21 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #if ( ( __GNUC__ * 100) + __GNUC_MINOR__) >= 408
 GCC_DIAG_ON(maybe-uninitialized)
 #endif
+#include <libmv/autotrack/region.h>
 
+#include "BaseTest.h"
+
+#include "Engine/EffectInstance.h"
 #include "Engine/EngineFwd.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/Node.h"
+#include "Engine/TrackMarker.h"
+#include "Engine/TrackerContext.h"
+#include "Engine/TrackerContextPrivate.h"
 #include "Engine/Transform.h"
+#include "Engine/TrackerFrameAccessor.h"
+#include "Engine/TrackerFrameAccessorPrivate.h"
+#include "Engine/ViewIdx.h"
 #include "Global/GlobalDefines.h"
 
 NATRON_NAMESPACE_USING
@@ -470,3 +488,288 @@ TEST(ModelSearch, HomographyNPoints)
     }
     testHomography(x1);
 }
+
+// A tile whose pixel (x, y) has the value x + 100 * y
+static FrameAccessorTile
+makeTile(const RectI& requested,
+         const RectI& bounds)
+{
+    FrameAccessorTile tile;
+
+    tile.requested = requested;
+    tile.bounds = bounds;
+    tile.image = boost::make_shared<MvFloatImage>( bounds.height(), bounds.width() );
+    float* pixels = tile.image->Data();
+    for (int y = bounds.y1; y < bounds.y2; ++y) {
+        for (int x = bounds.x1; x < bounds.x2; ++x, ++pixels) {
+            *pixels = x + 100 * y;
+        }
+    }
+
+    return tile;
+}
+
+TEST(TrackerFrameAccessor, DownscaleTile)
+{
+    // Only the complete 2x2 blocks are kept: the first column of the source is dropped
+    FrameAccessorTile src = makeTile( RectI(0, 0, 6, 4), RectI(1, 0, 6, 4) );
+    FrameAccessorTile dst;
+
+    src.downscale(&dst);
+    EXPECT_EQ( RectI(0, 0, 3, 2), dst.requested );
+    EXPECT_EQ( RectI(1, 0, 3, 2), dst.bounds );
+    ASSERT_TRUE(dst.image);
+    ASSERT_EQ( 2, dst.image->Width() );
+    ASSERT_EQ( 2, dst.image->Height() );
+    const float* pixels = dst.image->Data();
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 1; x < 3; ++x, ++pixels) {
+            // Average of the source pixels (2x, 2y) to (2x + 1, 2y + 1)
+            EXPECT_FLOAT_EQ( (2 * x + 0.5) + 100 * (2 * y + 0.5), *pixels );
+        }
+    }
+
+    // No complete block
+    src = makeTile( RectI(0, 0, 4, 4), RectI(1, 1, 2, 2) );
+    src.downscale(&dst);
+    EXPECT_TRUE( dst.bounds.isNull() );
+}
+
+TEST(TrackerFrameAccessor, FindOrDeriveTile)
+{
+    FrameAccessorFrame frame;
+
+    // Nothing rendered yet
+    EXPECT_FALSE( frame.findOrDeriveTile(0, RectI(0, 0, 2, 2)) );
+    EXPECT_FALSE( frame.findOrDeriveTile(2, RectI(0, 0, 2, 2)) );
+    EXPECT_TRUE( frame.levels[2].empty() );
+
+    frame.levels[0].push_back( makeTile( RectI(0, 0, 8, 8), RectI(0, 0, 8, 8) ) );
+
+    // Level 2 is derived from level 1, itself derived from level 0
+    const FrameAccessorTile* tile = frame.findOrDeriveTile(2, RectI(0, 0, 2, 2));
+    ASSERT_TRUE(tile);
+    EXPECT_EQ( 1u, frame.levels[1].size() );
+    EXPECT_EQ( 1u, frame.levels[2].size() );
+    EXPECT_EQ( RectI(0, 0, 2, 2), tile->bounds );
+    ASSERT_TRUE(tile->image);
+    // Average of the 4x4 block of level 0
+    EXPECT_FLOAT_EQ( 1.5 + 100 * 1.5, tile->image->Data()[0] );
+
+    // The derived tiles are found again instead of being derived twice
+    EXPECT_EQ( tile, frame.findOrDeriveTile(2, RectI(1, 1, 2, 2)) );
+    EXPECT_EQ( 1u, frame.levels[1].size() );
+    EXPECT_EQ( 1u, frame.levels[2].size() );
+
+    // Outside of the rendered area: level 0 must be rendered
+    EXPECT_FALSE( frame.findOrDeriveTile(0, RectI(4, 4, 12, 12)) );
+    EXPECT_FALSE( frame.findOrDeriveTile(1, RectI(2, 2, 6, 6)) );
+}
+
+TEST(TrackerFrameAccessor, ExtractImage)
+{
+    FrameAccessorTile tile = makeTile( RectI(0, 0, 8, 8), RectI(2, 2, 6, 6) );
+
+    // Only the part within the bounds of the tile is copied
+    MvFloatImagePtr image = tile.extractImage( RectI(0, 0, 4, 5) );
+    ASSERT_TRUE(image);
+    ASSERT_EQ( 2, image->Width() );
+    ASSERT_EQ( 3, image->Height() );
+    const float* pixels = image->Data();
+    for (int y = 2; y < 5; ++y) {
+        for (int x = 2; x < 4; ++x, ++pixels) {
+            EXPECT_FLOAT_EQ( x + 100 * y, *pixels );
+        }
+    }
+
+    EXPECT_FALSE( tile.extractImage( RectI(6, 6, 8, 8) ) );
+
+    tile.image.reset();
+    EXPECT_FALSE( tile.extractImage( RectI(0, 0, 4, 5) ) );
+}
+
+namespace {
+// Extracts the correspondences of the markers at time with the given batch and solves the similarity from them
+void
+solveKeyframe(double refTime,
+              double time,
+              const std::vector<TrackMarkerPtr>& markers,
+              int jitterPeriod,
+              bool jitterAdd,
+              TrackerContextPrivate::SolverBatch* batch,
+              Point* translation,
+              double* rotation,
+              double* scale)
+{
+    TrackerContextPrivate::extractSortedPointsFromMarkers(refTime, time, markers, jitterPeriod, jitterAdd, KnobDoublePtr(), batch);
+    TrackerContextPrivate::computeSimilarityFromNPoints(true, false, batch->x1, batch->x2, 1920, 1080, 1920, 1080, translation, rotation, scale);
+}
+}
+
+///The keyframes solved in batches, with the marker centers sampled once per batch, give the same results as
+///the keyframes solved one by one reading the center knobs, including at the edges of the batches.
+TEST_F(BaseTest, TrackerSolverBatches)
+{
+    NodePtr tracker = createNode( QString::fromUtf8(PLUGINID_NATRON_TRACKER) );
+    ASSERT_TRUE(tracker);
+    TrackerContextPtr context = tracker->getTrackerContext();
+    ASSERT_TRUE(context);
+
+    const int nMarkers = 6;
+    const int firstFrame = 0;
+    const int lastFrame = 60;
+    std::vector<TrackMarkerPtr> markers;
+    for (int m = 0; m < nMarkers; ++m) {
+        TrackMarkerPtr marker = context->createMarker();
+        ASSERT_TRUE(marker);
+        KnobDoublePtr centerKnob = marker->getCenterKnob();
+        KnobDoublePtr errorKnob = marker->getErrorKnob();
+        for (int t = firstFrame; t <= lastFrame; ++t) {
+            // A translation with some noise, so that the averaged centers differ from the centers
+            centerKnob->setValueAtTime(t, 100. + 150. * m + 3. * t + 2. * std::sin(0.7 * t + m), ViewSpec::all(), 0);
+            centerKnob->setValueAtTime(t, 200. + 90. * m + 1.5 * t + 2. * std::cos(0.9 * t + m), ViewSpec::all(), 1);
+            errorKnob->setValueAtTime(t, 0.01 * (m + 1), ViewSpec::all(), 0);
+        }
+        markers.push_back(marker);
+    }
+
+    const double refTime = 30.;
+    std::set<double> keyframes;
+    for (int t = 4; t <= 56; ++t) {
+        keyframes.insert(t);
+    }
+
+    // The batches are consecutive, in order, and cover all the keyframes
+    std::vector<std::vector<double> > batches;
+    TrackerContextPrivate::splitKeyframesInBatches(keyframes, &batches);
+    ASSERT_FALSE( batches.empty() );
+    std::vector<double> allKeys;
+    for (std::size_t b = 0; b < batches.size(); ++b) {
+        ASSERT_FALSE( batches[b].empty() );
+        if (b + 1 < batches.size()) {
+            EXPECT_EQ( batches[0].size(), batches[b].size() );
+        } else {
+            EXPECT_LE( batches[b].size(), batches[0].size() );
+        }
+        allKeys.insert( allKeys.end(), batches[b].begin(), batches[b].end() );
+    }
+    EXPECT_TRUE( allKeys == std::vector<double>( keyframes.begin(), keyframes.end() ) );
+
+    // A single keyframe is a single batch
+    std::vector<std::vector<double> > singleBatch;
+    TrackerContextPrivate::splitKeyframesInBatches(std::set<double>(keyframes.begin(), ++keyframes.begin()), &singleBatch);
+    ASSERT_EQ( 1, (int)singleBatch.size() );
+    EXPECT_EQ( 1, (int)singleBatch[0].size() );
+
+    // An even period has the same window as the odd period above it
+    const int jitterPeriods[] = {0, 5, 10};
+    for (int j = 0; j < 3; ++j) {
+        int jitterPeriod = jitterPeriods[j];
+        for (int add = 0; add < 2; ++add) {
+            bool jitterAdd = (add != 0);
+            for (std::size_t b = 0; b < batches.size(); ++b) {
+                TrackerContextPrivate::SolverBatch batched;
+                TrackerContextPrivate::sampleMarkersCenters(refTime, batches[b], markers, jitterPeriod, KnobDoublePtr(), &batched);
+                if (jitterPeriod > 1) {
+                    // The jitter is averaged with the prefix sums of the batch
+                    ASSERT_FALSE( batched.centersPrefixSums.empty() );
+                }
+                for (std::size_t k = 0; k < batches[b].size(); ++k) {
+                    double time = batches[b][k];
+                    Point batchedTranslation;
+                    double batchedRotation, batchedScale;
+                    solveKeyframe(refTime, time, markers, jitterPeriod, jitterAdd, &batched, &batchedTranslation, &batchedRotation, &batchedScale);
+
+                    // Unbatched: the centers are read from the knobs
+                    TrackerContextPrivate::SolverBatch single;
+                    TrackerContextPrivate::sampleMarkersCenters(refTime, std::vector<double>(1, time), markers, jitterPeriod, KnobDoublePtr(), &single);
+                    single.centersPrefixSums.clear();
+                    Point singleTranslation;
+                    double singleRotation, singleScale;
+                    solveKeyframe(refTime, time, markers, jitterPeriod, jitterAdd, &single, &singleTranslation, &singleRotation, &singleScale);
+
+                    ASSERT_EQ( nMarkers, (int)batched.x1.size() );
+                    ASSERT_EQ( single.x1.size(), batched.x1.size() );
+                    ASSERT_EQ( single.x2.size(), batched.x2.size() );
+                    for (std::size_t i = 0; i < single.x1.size(); ++i) {
+                        EXPECT_NEAR(single.x1[i].x, batched.x1[i].x, 1e-6);
+                        EXPECT_NEAR(single.x1[i].y, batched.x1[i].y, 1e-6);
+                        EXPECT_NEAR(single.x2[i].x, batched.x2[i].x, 1e-6);
+                        EXPECT_NEAR(single.x2[i].y, batched.x2[i].y, 1e-6);
+                    }
+                    EXPECT_NEAR(singleTranslation.x, batchedTranslation.x, 1e-6);
+                    EXPECT_NEAR(singleTranslation.y, batchedTranslation.y, 1e-6);
+                    EXPECT_NEAR(singleRotation, batchedRotation, 1e-6);
+                    EXPECT_NEAR(singleScale, batchedScale, 1e-6);
+                }
+            }
+        }
+    }
+}
+
+///Tracking several markers over several frames, the way TrackScheduler drives the frame accessor, renders the input
+///once per frame: all the other images requested by libmv are served from the cache.
+TEST_F(BaseTest, TrackerFrameAccessorRendersSaved)
+{
+    NodePtr generator = createNode(_generatorPluginID);
+    NodePtr tracker = createNode( QString::fromUtf8(PLUGINID_NATRON_TRACKER) );
+    ASSERT_TRUE(generator && tracker);
+    connectNodes(generator, tracker, 0, true);
+    TrackerContextPtr context = tracker->getTrackerContext();
+    ASSERT_TRUE(context);
+
+    // No tracking yet
+    U64 imagesCount, rendersCount;
+    context->getLastTrackingCacheStatistics(&imagesCount, &rendersCount);
+    EXPECT_EQ( 0u, imagesCount );
+    EXPECT_EQ( 0u, rendersCount );
+
+    bool enabledChannels[3] = {true, true, true};
+    TrackerFrameAccessor accessor(context.get(), enabledChannels, 1080);
+
+    const int nMarkers = 4;
+    const int nFrames = 5;
+    const int nLevels = 3;
+    const int windowSize = 64;
+    U64 expectedImages = 0;
+    for (int frame = 0; frame < nFrames; ++frame) {
+        // The search windows of the markers at this frame
+        std::vector<RectI> windows;
+        RectI searchRegion;
+        for (int m = 0; m < nMarkers; ++m) {
+            // Aligned on the lowest level, so that the windows of all levels are derived from the rendered area
+            RectI window(200 * m + 4 * frame, 100 + 4 * frame, 200 * m + 4 * frame + windowSize, 100 + 4 * frame + windowSize);
+            windows.push_back(window);
+            if ( searchRegion.isNull() ) {
+                searchRegion = window;
+            } else {
+                searchRegion.merge(window);
+            }
+        }
+        accessor.setFrameSearchRegion(frame, searchRegion);
+
+        for (int m = 0; m < nMarkers; ++m) {
+            // Each marker reads the pyramid of the current frame and of the previous frame, its reference
+            for (int f = std::max(0, frame - 1); f <= frame; ++f) {
+                for (int level = 0; level < nLevels; ++level) {
+                    RectI roi = windows[m].downscalePowerOfTwoSmallestEnclosing(level);
+                    mv::Region region;
+                    region.min(0) = roi.x1;
+                    region.min(1) = roi.y1;
+                    region.max(0) = roi.x2;
+                    region.max(1) = roi.y2;
+                    mv::FloatImage* image = 0;
+                    mv::FrameAccessor::Key key = accessor.GetImage(0, f, mv::FrameAccessor::MONO, level, &region, 0, &image);
+                    ++expectedImages;
+                    ASSERT_TRUE(key);
+                    ASSERT_TRUE(image);
+                    accessor.ReleaseImage(key);
+                }
+            }
+        }
+    }
+
+    accessor.getCacheStatistics(&imagesCount, &rendersCount);
+    EXPECT_EQ( expectedImages, imagesCount );
+    EXPECT_EQ( (U64)nFrames, rendersCount );
+}
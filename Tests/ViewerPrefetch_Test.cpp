@@ -0,0 +1,133 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Engine/OutputSchedulerThread.h"
+
+NATRON_NAMESPACE_USING
+
+namespace {
+// Requests of the given frames, one every 0.1 second
+std::list<std::pair<double, int> >
+makeHistory(const int* frames,
+            int nFrames)
+{
+    std::list<std::pair<double, int> > ret;
+
+    for (int i = 0; i < nFrames; ++i) {
+        ret.push_back( std::make_pair(i * 0.1, frames[i]) );
+    }
+
+    return ret;
+}
+}
+
+TEST(ViewerPrefetch, FollowsScrubbingDirection)
+{
+    std::set<int> skipped;
+    std::vector<int> frames;
+
+    // Scrubbing forward, 2 frames at a time
+    const int forward[] = { 10, 12, 14 };
+    ViewerCurrentFrameRequestScheduler::getFramesToPrefetch(makeHistory(forward, 3), 14, 1, 100, 3, skipped, &frames);
+    ASSERT_EQ(3u, frames.size());
+    EXPECT_EQ(16, frames[0]);
+    EXPECT_EQ(18, frames[1]);
+    EXPECT_EQ(20, frames[2]);
+
+    // Scrubbing backward, 1 frame at a time
+    const int backward[] = { 50, 49, 48, 47 };
+    frames.clear();
+    ViewerCurrentFrameRequestScheduler::getFramesToPrefetch(makeHistory(backward, 4), 47, 1, 100, 2, skipped, &frames);
+    ASSERT_EQ(2u, frames.size());
+    EXPECT_EQ(46, frames[0]);
+    EXPECT_EQ(45, frames[1]);
+
+    // The frame did not change: both sides, closest first
+    const int still[] = { 30 };
+    frames.clear();
+    ViewerCurrentFrameRequestScheduler::getFramesToPrefetch(makeHistory(still, 1), 30, 1, 100, 4, skipped, &frames);
+    ASSERT_EQ(4u, frames.size());
+    EXPECT_EQ(31, frames[0]);
+    EXPECT_EQ(29, frames[1]);
+    EXPECT_EQ(32, frames[2]);
+    EXPECT_EQ(28, frames[3]);
+}
+
+TEST(ViewerPrefetch, StaysInTimelineBounds)
+{
+    std::set<int> skipped;
+    std::vector<int> frames;
+
+    const int forward[] = { 95, 97, 99 };
+    ViewerCurrentFrameRequestScheduler::getFramesToPrefetch(makeHistory(forward, 3), 99, 1, 100, 5, skipped, &frames);
+    EXPECT_TRUE( frames.empty() );
+
+    const int backward[] = { 4, 3, 2 };
+    frames.clear();
+    ViewerCurrentFrameRequestScheduler::getFramesToPrefetch(makeHistory(backward, 3), 2, 1, 100, 5, skipped, &frames);
+    ASSERT_EQ(1u, frames.size());
+    EXPECT_EQ(1, frames[0]);
+
+    // On the first frame only the frames after it can be prefetched
+    const int still[] = { 1, 1 };
+    frames.clear();
+    ViewerCurrentFrameRequestScheduler::getFramesToPrefetch(makeHistory(still, 2), 1, 1, 3, 5, skipped, &frames);
+    ASSERT_EQ(2u, frames.size());
+    EXPECT_EQ(2, frames[0]);
+    EXPECT_EQ(3, frames[1]);
+}
+
+TEST(ViewerPrefetch, SkipsCachedFrames)
+{
+    std::set<int> skipped;
+    std::vector<int> frames;
+
+    // The frames already cached or being prefetched do not count
+    skipped.insert(11);
+    skipped.insert(13);
+    const int forward[] = { 9, 10 };
+    ViewerCurrentFrameRequestScheduler::getFramesToPrefetch(makeHistory(forward, 2), 10, 1, 100, 3, skipped, &frames);
+    ASSERT_EQ(3u, frames.size());
+    EXPECT_EQ(12, frames[0]);
+    EXPECT_EQ(14, frames[1]);
+    EXPECT_EQ(15, frames[2]);
+
+    skipped.insert(9);
+    const int still[] = { 10 };
+    frames.clear();
+    ViewerCurrentFrameRequestScheduler::getFramesToPrefetch(makeHistory(still, 1), 10, 1, 100, 3, skipped, &frames);
+    ASSERT_EQ(3u, frames.size());
+    EXPECT_EQ(12, frames[0]);
+    EXPECT_EQ(8, frames[1]);
+    EXPECT_EQ(7, frames[2]);
+}
@@ -0,0 +1,191 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * Copyright (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <algorithm>
+#include <list>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Engine/RectI.h"
+#include "Engine/UpdateViewerParams.h"
+#include "Engine/ViewerInstancePrivate.h"
+
+NATRON_NAMESPACE_USING
+
+namespace {
+const int kTileSize = 256;
+const int kTilesX = 8;
+const int kTilesY = 6;
+
+// A grid of tiles covering the roi, the tiles of the block [cachedX1, cachedX2) x [cachedY1, cachedY2) are cached
+std::list<UpdateViewerParams::CachedTile>
+makeTiles(int cachedX1,
+          int cachedY1,
+          int cachedX2,
+          int cachedY2)
+{
+    std::list<UpdateViewerParams::CachedTile> tiles;
+
+    for (int y = 0; y < kTilesY; ++y) {
+        for (int x = 0; x < kTilesX; ++x) {
+            UpdateViewerParams::CachedTile tile;
+            tile.rect.set(x * kTileSize, y * kTileSize, (x + 1) * kTileSize, (y + 1) * kTileSize);
+            tile.rectRounded = tile.rect;
+            tile.isCached = x >= cachedX1 && x < cachedX2 && y >= cachedY1 && y < cachedY2;
+            tiles.push_back(tile);
+        }
+    }
+
+    return tiles;
+}
+
+bool
+compareDistanceLess(const std::pair<double, RectI>& lhs,
+                    const std::pair<double, RectI>& rhs)
+{
+    return lhs.first < rhs.first;
+}
+
+// The tiles which are not cached, closest to the center first
+std::vector<RectI>
+getSortedUncachedTiles(const std::list<UpdateViewerParams::CachedTile>& tiles,
+                       double centerX,
+                       double centerY)
+{
+    std::vector<std::pair<double, RectI> > sorted;
+
+    for (std::list<UpdateViewerParams::CachedTile>::const_iterator it = tiles.begin(); it != tiles.end(); ++it) {
+        if (!it->isCached) {
+            double dx = (it->rect.x1 + it->rect.x2) / 2. - centerX;
+            double dy = (it->rect.y1 + it->rect.y2) / 2. - centerY;
+            sorted.push_back( std::make_pair( dx * dx + dy * dy, (RectI)it->rect ) );
+        }
+    }
+    std::sort( sorted.begin(), sorted.end(), compareDistanceLess );
+    std::vector<RectI> ret;
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+        ret.push_back(sorted[i].second);
+    }
+
+    return ret;
+}
+}
+
+TEST(ViewerProgressiveRender, Batches)
+{
+    const RectI roi(0, 0, kTilesX * kTileSize, kTilesY * kTileSize);
+    // Not on a tile boundary, so that no two tiles are at the same distance
+    const double centerX = 900.3;
+    const double centerY = 650.7;
+
+    // The 2x2 tiles around the center are cached
+    std::list<UpdateViewerParams::CachedTile> tiles = makeTiles(3, 2, 5, 4);
+    std::vector<RectI> batches;
+    ViewerInstance::ViewerInstancePrivate::getProgressiveRenderBatches(tiles, roi, centerX, centerY, &batches);
+
+    std::vector<RectI> sorted = getSortedUncachedTiles(tiles, centerX, centerY);
+    ASSERT_EQ( (std::size_t)(kTilesX * kTilesY - 4), sorted.size() );
+
+    // 1 + 2 + 4 + 8 + 16 tiles, then the roi for the 13 remaining tiles
+    ASSERT_EQ( 6u, batches.size() );
+
+    // The first batch is the single closest tile which is not cached
+    EXPECT_EQ( sorted[0], batches[0] );
+    EXPECT_EQ( kTileSize, batches[0].width() );
+    EXPECT_EQ( kTileSize, batches[0].height() );
+
+    // Then the size of the batches doubles: each one is the bounding box of the next closest tiles
+    std::size_t first = 0;
+    std::size_t batchSize = 1;
+    for (std::size_t b = 0; b + 1 < batches.size(); ++b) {
+        ASSERT_LE( first + batchSize, sorted.size() );
+        RectI expected = sorted[first];
+        for (std::size_t i = first + 1; i < first + batchSize; ++i) {
+            expected.merge(sorted[i]);
+        }
+        EXPECT_EQ( expected, batches[b] );
+        first += batchSize;
+        batchSize *= 2;
+    }
+    // The last batch completes the roi
+    ASSERT_LT( first, sorted.size() );
+    EXPECT_EQ( roi, batches.back() );
+
+    // Render the batches the way the viewer does: a batch renders the tiles it contains which were not rendered by
+    // a previous batch, the last one renders all the remaining tiles. Cached tiles are never rendered.
+    std::vector<int> renderCount( tiles.size(), 0 );
+    for (std::size_t b = 0; b < batches.size(); ++b) {
+        const bool isLastBatch = b + 1 == batches.size();
+        std::size_t t = 0;
+        for (std::list<UpdateViewerParams::CachedTile>::const_iterator it = tiles.begin(); it != tiles.end(); ++it, ++t) {
+            if ( it->isCached || (renderCount[t] > 0) || ( !isLastBatch && !batches[b].contains(it->rect) ) ) {
+                continue;
+            }
+            ++renderCount[t];
+        }
+    }
+    std::size_t t = 0;
+    for (std::list<UpdateViewerParams::CachedTile>::const_iterator it = tiles.begin(); it != tiles.end(); ++it, ++t) {
+        EXPECT_EQ( it->isCached ? 0 : 1, renderCount[t] );
+    }
+
+    // The first batch is not one of the cached tiles around the center
+    for (std::list<UpdateViewerParams::CachedTile>::const_iterator it = tiles.begin(); it != tiles.end(); ++it) {
+        if (it->isCached) {
+            EXPECT_FALSE( batches[0].intersects(it->rect) );
+        }
+    }
+}
+
+TEST(ViewerProgressiveRender, FewTiles)
+{
+    const RectI roi(0, 0, kTilesX * kTileSize, kTilesY * kTileSize);
+    std::vector<RectI> batches;
+
+    // Everything is cached: the roi is rendered at once
+    std::list<UpdateViewerParams::CachedTile> tiles = makeTiles(0, 0, kTilesX, kTilesY);
+    ViewerInstance::ViewerInstancePrivate::getProgressiveRenderBatches(tiles, roi, 0., 0., &batches);
+    ASSERT_EQ( 1u, batches.size() );
+    EXPECT_EQ( roi, batches[0] );
+
+    // A single tile is not cached: the roi is rendered at once
+    tiles = makeTiles(0, 0, kTilesX, kTilesY);
+    tiles.back().isCached = false;
+    batches.clear();
+    ViewerInstance::ViewerInstancePrivate::getProgressiveRenderBatches(tiles, roi, 0., 0., &batches);
+    ASSERT_EQ( 1u, batches.size() );
+    EXPECT_EQ( roi, batches[0] );
+
+    // Two tiles: the closest one first, then the roi
+    tiles.front().isCached = false;
+    batches.clear();
+    ViewerInstance::ViewerInstancePrivate::getProgressiveRenderBatches(tiles, roi, 0., 0., &batches);
+    ASSERT_EQ( 2u, batches.size() );
+    EXPECT_EQ( (RectI)tiles.front().rect, batches[0] );
+    EXPECT_EQ( roi, batches[1] );
+}